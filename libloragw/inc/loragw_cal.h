@@ -54,6 +54,23 @@ struct lgw_sx125x_cal_tx_result_s {
 
 int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, struct lgw_tx_gain_lut_s * txgain_lut);
 
+/**
+@brief Restore the results of a previous sx125x calibration, if it was done in the same conditions
+@param path             Calibration cache file
+@param eui              Concentrator EUI
+@param temperature      Current concentrator temperature, in degree celcius
+@param rf_chain_cfg     The RF chains current configuration
+@param txgain_lut       The TX gain LUTs, DC offsets are filled on success
+@return LGW_HAL_SUCCESS if the calibration was restored, LGW_HAL_ERROR if radios must be calibrated
+*/
+int sx1302_cal_cache_load(const char * path, uint64_t eui, float temperature, struct lgw_conf_rxrf_s * rf_chain_cfg, struct lgw_tx_gain_lut_s * txgain_lut);
+
+/**
+@brief Save the results of the last sx125x calibration along with the conditions it was done in
+@return LGW_HAL_SUCCESS if success, LGW_HAL_ERROR otherwise
+*/
+int sx1302_cal_cache_save(const char * path, uint64_t eui, float temperature, struct lgw_conf_rxrf_s * rf_chain_cfg, struct lgw_tx_gain_lut_s * txgain_lut);
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,75 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Capture of the SX1302 RX buffer content to a file, and "replay" transport
+    streaming a capture back through the RX buffer FIFO, to run the HAL and its
+    applications on recorded traffic without a concentrator.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORAGW_CAPTURE_H
+#define _LORAGW_CAPTURE_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types*/
+#include <stdbool.h>    /* bool type */
+
+#include "config.h"     /* library configuration options (dynamically generated) */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LGW_CAPTURE_SUCCESS     0
+#define LGW_CAPTURE_ERROR       -1
+
+/*
+Capture file format, all fields little endian:
+    header:  "LGWRXCAP" (8 bytes), format version (1 byte)
+    records: delay since the previous record in us (4 bytes, saturated),
+             number of bytes (2 bytes), RX buffer bytes as fetched by the host
+*/
+#define LGW_CAPTURE_MAGIC       "LGWRXCAP"
+#define LGW_CAPTURE_MAGIC_SIZE  8
+#define LGW_CAPTURE_VERSION     1
+#define LGW_CAPTURE_HEADER_SIZE (LGW_CAPTURE_MAGIC_SIZE + 1)
+#define LGW_CAPTURE_RECORD_HEAD 6
+#define LGW_CAPTURE_RECORD_MAX  4096    /* size of the SX1302 RX buffer */
+
+#define LGW_REPLAY_SPEED_SEP    '@'     /* "replay:file@10" replays 10 times faster, "@0" as fast as fetched */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Start logging the RX buffer content fetched by the host
+@param path file to be created, overwritten if it exists
+@return LGW_CAPTURE_SUCCESS/LGW_CAPTURE_ERROR
+*/
+int lgw_capture_start(const char * path);
+
+/**
+@brief Stop logging and close the capture file, if any
+*/
+void lgw_capture_stop(void);
+
+/**
+@brief Append a record with the bytes just fetched from the RX buffer, does nothing if not capturing
+@param data RX buffer bytes
+@param size number of bytes
+@return LGW_CAPTURE_SUCCESS, LGW_CAPTURE_ERROR if the record could not be written (capture is stopped)
+*/
+int lgw_capture_write(const uint8_t * data, uint16_t size);
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
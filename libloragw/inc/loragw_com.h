@@ -0,0 +1,143 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Transport layer between the register layer and the LoRa concentrator.
+    The Linux spidev and RX capture replay transports are built in, other
+    transports (SPI bridges, simulation) can be registered by the application
+    and are selected by a prefix in the connection path.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORAGW_COM_H
+#define _LORAGW_COM_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types*/
+#include <stdbool.h>    /* bool type */
+
+#include "config.h"     /* library configuration options (dynamically generated) */
+#include "loragw_spi.h" /* SPI frame format, burst descriptors and statistics */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LGW_COM_SUCCESS     0
+#define LGW_COM_ERROR       -1
+
+#define LGW_COM_NB_MAX      4   /* number of transports that can be registered, spidev excluded */
+#define LGW_COM_PATH_SEP    ':' /* "name:path" selects the transport named "name" */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct lgw_com_s
+@brief Operations of a transport, all on the same frame format as loragw_spi
+
+Every operation returns LGW_COM_SUCCESS or LGW_COM_ERROR, and is called with
+the register layer lock held (see lgw_reg_lock). The optional operations can be
+left NULL, they are then emulated with the mandatory ones. A transport sending
+several transfers in one message (deep FIFO, DMA chains...) should provide
+them, the register layer relies on them to batch its accesses.
+Transports must account every message they send with lgw_com_account.
+*/
+struct lgw_com_s {
+    const char * name;  /*!< transport selected by the "name:" prefix of the connection path */
+    bool simulated;     /*!< no concentrator behind the link, lgw_start skips the radios, sensor and firmwares bring-up */
+
+    /* link management */
+    int (*open)(const char * path, void **com_target_ptr);      /*!< path without its "name:" prefix */
+    int (*close)(void *com_target);
+    int (*set_speed)(void *com_target, uint32_t speed_hz);      /*!< optional, fixed clock if NULL */
+    uint32_t (*get_msg_size_max)(void);                         /*!< largest message, commands included */
+
+    /* concentrator register and memory accesses */
+    int (*w)(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t data);
+    int (*r)(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data);
+    int (*wb)(void *com_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size);
+    int (*rb)(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size);
+    int (*wb_chunks)(void *com_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size, uint16_t chunk_size); /*!< optional */
+    int (*rb_chunks)(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, uint16_t chunk_size, bool fifo_mode); /*!< optional */
+    int (*wb_multi)(void *com_target, uint8_t spi_mux_target, const struct lgw_spi_burst_s *bursts, uint16_t nb_bursts); /*!< optional */
+
+    /* raw full-duplex frame, first byte is the SPI mux target, used for the radio commands */
+    int (*xfer)(void *com_target, lgw_spi_op_t op, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size);
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Make a transport available to lgw_connect, before the concentrator is connected
+@param com operations of the transport, must remain valid while connected
+@return LGW_COM_SUCCESS, LGW_COM_ERROR if the name is already used or if there is no room left
+*/
+int lgw_com_register(const struct lgw_com_s * com);
+
+/**
+@brief Open the link to the concentrator with the transport selected by the path
+@param com_path "name:path" for a registered transport, or a spidev device path
+@param com_target_ptr pointer on a generic pointer to the link (transport dependant)
+@return LGW_COM_SUCCESS/LGW_COM_ERROR
+*/
+int lgw_com_open(const char * com_path, void **com_target_ptr);
+
+/**
+@brief Close the link opened by lgw_com_open
+*/
+int lgw_com_close(void *com_target);
+
+/**
+@brief Get the name of the transport of the link opened, "spidev" for the built-in one
+*/
+const char * lgw_com_name(void);
+
+/**
+@brief Check if the link opened has no concentrator behind it (see struct lgw_com_s)
+*/
+bool lgw_com_simulated(void);
+
+/**
+@brief Transport operations, see struct lgw_com_s and the loragw_spi functions of the same name
+*/
+int lgw_com_set_speed(void *com_target, uint32_t speed_hz);
+uint32_t lgw_com_get_msg_size_max(void);
+int lgw_com_w(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t data);
+int lgw_com_r(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data);
+int lgw_com_wb(void *com_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size);
+int lgw_com_rb(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size);
+int lgw_com_wb_chunks(void *com_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size, uint16_t chunk_size);
+int lgw_com_rb_chunks(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, uint16_t chunk_size, bool fifo_mode);
+int lgw_com_wb_multi(void *com_target, uint8_t spi_mux_target, const struct lgw_spi_burst_s *bursts, uint16_t nb_bursts);
+int lgw_com_xfer(void *com_target, lgw_spi_op_t op, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size);
+
+/**
+@brief Account for a message sent by a transport in the traffic statistics
+@param spi_mux_target SPI mux target the message was sent to
+@param op type of access
+@param bytes number of bytes clocked, commands included
+@param latency_us time spent sending the message
+@param error the message failed
+*/
+void lgw_com_account(uint8_t spi_mux_target, lgw_spi_op_t op, uint32_t bytes, uint32_t latency_us, bool error);
+
+/**
+@brief Get the traffic counters
+@param stats pointer to receive the counters
+@param reset clear the counters after they have been copied
+*/
+void lgw_com_get_stats(struct lgw_spi_stats_s *stats, bool reset);
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -57,6 +57,27 @@ void dbg_generate_random_payload(uint32_t pkt_cnt, uint8_t * buffer_expected, ui
 */
 int dbg_check_payload(struct lgw_conf_debug_s * context, FILE * file, uint8_t * payload_received, uint8_t size, uint8_t ref_payload_idx, uint8_t sf);
 
+/**
+@brief Start the thread checking the received payloads against the reference payloads of the debug context
+@param context debug context, its reference payloads are only accessed by the thread until dbg_payload_check_stop
+@param file log file for errors, NULL if none
+@return 0 if the thread is running, -1 otherwise
+*/
+int dbg_payload_check_start(struct lgw_conf_debug_s * context, FILE * file);
+
+/**
+@brief Queue a received payload to be checked, never blocks (the payload is not checked if the queue is full)
+@param payload received payload
+@param size payload size
+@param sf spreading factor of the packet, for the log
+*/
+void dbg_payload_check_queue(const uint8_t * payload, uint8_t size, uint8_t sf);
+
+/**
+@brief Check the queued payloads, stop the thread and log the aggregated results
+*/
+void dbg_payload_check_stop(void);
+
 /**
 @brief
 @param
@@ -0,0 +1,75 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Filtering of the received packets, applied by lgw_receive as soon as they
+    are parsed: CRC status policy, DevAddr allow/deny list and suppression of
+    the duplicates received on several IF chains.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORAGW_FILTER_H
+#define _LORAGW_FILTER_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types*/
+#include <stdbool.h>    /* bool type */
+
+#include "config.h"     /* library configuration options (dynamically generated) */
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LGW_FILTER_SUCCESS      0
+#define LGW_FILTER_ERROR        -1
+
+/* values returned by lgw_filter_check */
+#define LGW_FILTER_PASS         0
+#define LGW_FILTER_DROP_CRC     1
+#define LGW_FILTER_DROP_DEVADDR 2
+#define LGW_FILTER_DROP_DUP     3
+
+#define LGW_FILTER_DUP_NB       32      /* packets remembered for the duplicates suppression */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Apply a new filter configuration, the duplicates history is cleared
+@param conf filter configuration, NULL to return all packets
+@return LGW_FILTER_SUCCESS/LGW_FILTER_ERROR
+*/
+int lgw_filter_setconf(const struct lgw_conf_rxfilter_s * conf);
+
+/**
+@brief Forget the packets previously returned, to be called when the concentrator counter restarts
+*/
+void lgw_filter_reset(void);
+
+/**
+@brief Check if a packet has to be returned, and count the packets dropped
+@param p packet parsed from the RX buffer, is remembered for the duplicates suppression if it is returned
+@return LGW_FILTER_PASS or the reason why the packet has to be dropped
+*/
+int lgw_filter_check(const struct lgw_pkt_rx_s * p);
+
+/**
+@brief Copy the number of packets dropped to the RX statistics
+@param stats the nb_drop_* fields are set, the others are not modified
+@param reset clear the counters after they have been copied
+*/
+void lgw_filter_get_stats(struct lgw_rx_stats_s * stats, bool reset);
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -26,6 +26,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <time.h>       /* time library */
 #include <termios.h>    /* speed_t */
 #include <unistd.h>     /* ssize_t */
+#include <stddef.h>     /* size_t */
 
 #include "config.h"     /* library configuration options (dynamically generated) */
 
@@ -92,6 +93,26 @@ enum gps_msg {
 #define LGW_GPS_UBX_SYNC_CHAR     (0xB5)
 #define LGW_GPS_NMEA_SYNC_CHAR    (0x24)
 
+#define LGW_GPS_FRAME_MAX         (256) /* longest frame that can be decoded */
+#define LGW_GPS_NMEA_FIELD_MAX    (30)  /* max number of fields of a NMEA sentence */
+
+/**
+@struct lgw_gps_parser_s
+@brief State of the UBX/NMEA stream parser, see lgw_gps_parse_stream
+*/
+struct lgw_gps_parser_s {
+    int         state;          /*!> current state of the parser */
+    size_t      size;           /*!> number of bytes of the current frame received so far */
+    size_t      expected;       /*!> total size of the current UBX frame, or position of the NMEA checksum */
+    uint8_t     ck_a;           /*!> UBX Fletcher checksum, first byte */
+    uint8_t     ck_b;           /*!> UBX Fletcher checksum, second byte */
+    uint8_t     ck_rcv[2];      /*!> received checksum (UBX bytes or NMEA hexadecimal characters) */
+    uint8_t     nmea_ck;        /*!> NMEA XOR checksum */
+    int         nb_fields;      /*!> number of NMEA fields found so far */
+    int         str_index[LGW_GPS_NMEA_FIELD_MAX]; /*!> start of each NMEA field in frame */
+    char        frame[LGW_GPS_FRAME_MAX]; /*!> frame being received, NMEA separators replaced by null chars */
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
@@ -143,6 +164,43 @@ lock must be acquired before calling either function.
 */
 enum gps_msg lgw_parse_ubx(const char* serial_buff, size_t buff_size, size_t *msg_size);
 
+/**
+@brief Reset a UBX/NMEA stream parser, to be called before its first use
+
+@param parser pointer to the parser state
+*/
+void lgw_gps_parser_init(struct lgw_gps_parser_s *parser);
+
+/**
+@brief Feed bytes read from the GPS serial port to a stream parser
+
+@param parser pointer to the parser state, kept between calls
+@param serial_buff pointer to the bytes received
+@param buff_size number of bytes received
+@param consumed pointer to store the number of bytes processed
+@return type of frame parsed, UNKNOWN if no frame was completed
+
+Bytes are processed one by one and checksums are computed on the fly, so a
+frame split over several reads is never scanned twice. The function returns as
+soon as a frame is complete, so that the caller can act on it (typically read
+the PPS timestamp counter on UBX_NAV_TIMEGPS) before processing the remaining
+bytes, starting at serial_buff + *consumed.
+The frames are decoded into the same global set of variables as the
+lgw_parse_nmea/lgw_parse_ubx functions, with the same locking requirements.
+*/
+enum gps_msg lgw_gps_parse_stream(struct lgw_gps_parser_s *parser, const char *serial_buff, size_t buff_size, size_t *consumed);
+
+/**
+@brief Estimate how long until the frame being received by a parser is complete
+
+@param parser pointer to the parser state
+@return estimated time in microseconds, 0 if the parser is waiting for a new frame
+
+Sleeping that long before the next read lets the serial driver buffer the rest
+of the frame, so that it can be fetched with a single read.
+*/
+uint32_t lgw_gps_parser_wait_us(const struct lgw_gps_parser_s *parser);
+
 /**
 @brief Get the GPS solution (space & time) for the concentrator
 
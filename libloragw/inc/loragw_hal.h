@@ -23,6 +23,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <stdbool.h>    /* bool type */
 
 #include "config.h"     /* library configuration options (dynamically generated) */
+#include "loragw_spi.h" /* SPI statistics */
 
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC MACROS -------------------------------------------------------- */
@@ -44,6 +45,13 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define LGW_HAL_ERROR       -1
 #define LGW_LBT_ISSUE       1
 
+/* number of concentrator boards driven by one process, see lgw_board_select() */
+#if LOW_MEMORY == 1
+#define LGW_BOARD_NB        1
+#else
+#define LGW_BOARD_NB        4
+#endif
+
 /* radio-specific parameters */
 #define LGW_XTAL_FREQU      32000000            /* frequency of the RF reference oscillator */
 #define LGW_RF_CHAIN_NB     2                   /* number of RF chains */
@@ -99,6 +107,12 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define STAT_CRC_BAD    0x11
 #define STAT_CRC_OK     0x10
 
+/* values available for the 'devaddr_mode' parameter of the RX filter */
+#define LGW_FILTER_DEVADDR_OFF      0   /* no DevAddr filtering */
+#define LGW_FILTER_DEVADDR_ALLOW    1   /* only data frames from the listed DevAddr are returned */
+#define LGW_FILTER_DEVADDR_DENY     2   /* data frames from the listed DevAddr are dropped */
+#define LGW_FILTER_DEVADDR_MAX      256 /* max number of DevAddr in the list */
+
 /* values available for the 'tx_mode' parameter */
 #define IMMEDIATE       0
 #define TIMESTAMPED     1
@@ -150,7 +164,14 @@ struct lgw_conf_board_s {
     bool    lorawan_public; /*!> Enable ONLY for *public* networks using the LoRa MAC protocol */
     uint8_t clksrc;         /*!> Index of RF chain which provides clock to concentrator */
     bool    full_duplex;    /*!> Indicates if the gateway operates in full duplex mode or not */
-    char    spidev_path[64];/*!> Path to access the SPI device to connect to the SX1302 */
+    char    spidev_path[64];/*!> Path to access the SPI device to connect to the SX1302, or "name:path" for a registered transport (see loragw_com.h) */
+    uint32_t spi_speed;     /*!> SPI clock in Hz, 0 for default (SPI_SPEED) */
+    uint16_t spi_chunk_size;/*!> Max size of a SPI memory burst in bytes, 0 for default (LGW_BURST_CHUNK), capped by the spidev buffer size */
+    uint32_t temperature_refresh_ms; /*!> Max age of the temperature used for RSSI compensation in ms, 0 for default (10s) */
+    char    cal_cache_path[128]; /*!> File where sx125x calibration results are saved and reused on next start, empty to always calibrate */
+    bool    fast_start;     /*!> Poll the radios status during lgw_start instead of waiting for worst case delays */
+    char    rx_capture_path[128]; /*!> File where the RX buffer content is logged for replay (see loragw_capture.h), empty to disable */
+    uint16_t rx_buffer_size; /*!> Max number of bytes read from the SX1302 RX buffer per fetch, 0 for default (4096), the others are read by the next fetch */
 };
 
 /**
@@ -207,12 +228,14 @@ struct lgw_pkt_rx_s {
     uint8_t     if_chain;       /*!> by which IF chain was packet received */
     uint8_t     status;         /*!> status of the received packet */
     uint32_t    count_us;       /*!> internal concentrator counter for timestamping, 1 microsecond resolution */
+    uint64_t    count_us_64;    /*!> count_us extended to 64 bits, never wraps */
     uint8_t     rf_chain;       /*!> through which RF chain the packet was received */
     uint8_t     modem_id;
     uint8_t     modulation;     /*!> modulation used by the packet */
     uint8_t     bandwidth;      /*!> modulation bandwidth (LoRa only) */
     uint32_t    datarate;       /*!> RX datarate of the packet (SF for LoRa) */
     uint8_t     coderate;       /*!> error-correcting code of the packet (LoRa only) */
+    uint32_t    airtime_us;     /*!> time on air of the packet in microseconds, 0 if unknown */
     float       rssic;          /*!> average RSSI of the channel in dB */
     float       rssis;          /*!> average RSSI of the signal in dB */
     float       snr;            /*!> average packet SNR, in dB (LoRa only) */
@@ -297,6 +320,77 @@ struct lgw_conf_timestamp_s {
     uint8_t nb_symbols;
 };
 
+/**
+@struct lgw_conf_rxfilter_s
+@brief Configuration structure of the packets dropped by lgw_receive, right after being parsed
+*/
+struct lgw_conf_rxfilter_s {
+    bool        crc_ok;             /*!> Return the packets received with a valid payload CRC */
+    bool        crc_bad;            /*!> Return the packets received with a payload CRC error */
+    bool        no_crc;             /*!> Return the packets received without payload CRC */
+    uint8_t     devaddr_mode;       /*!> LGW_FILTER_DEVADDR_OFF/ALLOW/DENY, for LoRaWAN data frames with a valid CRC only */
+    uint16_t    devaddr_nb;         /*!> Number of DevAddr in the list */
+    uint32_t    devaddr[LGW_FILTER_DEVADDR_MAX]; /*!> DevAddr list */
+    uint32_t    dedup_window_us;    /*!> Drop the valid packets with the same payload as a packet returned less than this ago (eg. received on adjacent channels), 0 to disable */
+};
+
+/**
+@struct lgw_start_phase_s
+@brief Duration and SPI traffic of one phase of lgw_start
+*/
+struct lgw_start_phase_s {
+    uint32_t duration_us;   /*!> Time spent in the phase, monotonic clock */
+    uint32_t spi_transfers; /*!> Number of SPI messages sent during the phase */
+};
+
+/**
+@struct lgw_start_stats_s
+@brief Breakdown of the time spent in the last lgw_start, see lgw_get_start_stats
+*/
+struct lgw_start_stats_s {
+    struct lgw_start_phase_s connect;       /*!> SPI link opened and configured */
+    struct lgw_start_phase_s calibration;   /*!> Temperature sensor, radios reset and calibration (cal_fw included) */
+    struct lgw_start_phase_s cal_fw;        /*!> sx125x calibration firmware load and run, 0 if restored from cache or sx1250 */
+    struct lgw_start_phase_s radio_setup;   /*!> Radios reset and configured for RX */
+    struct lgw_start_phase_s sx1302_config; /*!> Channelizer, modems and demodulators configuration */
+    struct lgw_start_phase_s agc_fw;        /*!> AGC firmware load and start */
+    struct lgw_start_phase_s arb_fw;        /*!> ARB firmware load and start */
+    struct lgw_start_phase_s total;         /*!> Whole lgw_start */
+};
+
+/**
+@struct lgw_rx_stats_s
+@brief RX buffer fill level and near-full counters, see lgw_get_rx_stats
+*/
+struct lgw_rx_stats_s {
+    uint32_t nb_fetch;      /*!> Number of reads of the SX1302 RX buffer */
+    uint64_t nb_bytes;      /*!> Number of bytes read from the SX1302 RX buffer */
+    uint16_t level_max;     /*!> High-water mark of the SX1302 RX buffer fill level, in bytes */
+    uint32_t nb_near_full;  /*!> Fetches finding the SX1302 RX buffer without room for a largest packet, a high-water mark and not a count of dropped packets */
+    uint32_t nb_partial;    /*!> Fetches leaving bytes in the SX1302 RX buffer, its fill level being above rx_buffer_size */
+    uint32_t nb_pkt_left;   /*!> lgw_receive calls returning max_pkt packets with more still pending */
+    uint32_t nb_drop_crc_ok;    /*!> Packets with a valid CRC dropped by the RX filter */
+    uint32_t nb_drop_crc_bad;   /*!> Packets with a CRC error dropped by the RX filter */
+    uint32_t nb_drop_no_crc;    /*!> Packets without CRC dropped by the RX filter */
+    uint32_t nb_drop_devaddr;   /*!> Packets with a valid CRC dropped by the RX filter DevAddr list */
+    uint32_t nb_drop_dup;       /*!> Duplicates with a valid CRC dropped by the RX filter */
+};
+
+/**
+@struct lgw_arb_stats_s
+@brief Preamble detections and demodulator allocations of the multi-SF channels, see lgw_get_arb_stats
+*/
+struct lgw_arb_stats_s {
+    uint8_t  sf;                        /*!> Spreading factor counted by the ARB firmware, 0 if not counting */
+    uint32_t nb_detect[LGW_MULTI_NB];   /*!> Preambles detected on each multi-SF channel */
+    uint32_t nb_alloc[LGW_MULTI_NB];    /*!> Detections given a demodulator, the others are dropped by the SX1302 */
+};
+
+/**
+@brief Concentrator board handle, from 0 to LGW_BOARD_NB-1
+*/
+typedef uint8_t lgw_handle_t;
+
 /**
 @struct lgw_context_s
 @brief Configuration context shared across modules
@@ -321,6 +415,24 @@ typedef struct lgw_context_s {
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
+/**
+@brief Select the concentrator board the calling thread accesses
+@param board handle of the board, all following HAL calls of the thread apply to it
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+
+Each board has its own configuration, link and state: the setconf, start, receive and send
+functions of different boards can be called concurrently from different threads.
+Threads access board 0 until they select another one. The board must not be changed while
+a register batch is open (see lgw_reg_batch_start).
+*/
+int lgw_board_select(lgw_handle_t board);
+
+/**
+@brief Get the concentrator board the calling thread accesses
+@return handle of the board selected by lgw_board_select(), 0 by default
+*/
+lgw_handle_t lgw_board_selected(void);
+
 /**
 @brief Configure the gateway board
 @param conf structure containing the configuration parameters
@@ -344,6 +456,20 @@ int lgw_rxrf_setconf(uint8_t rf_chain, struct lgw_conf_rxrf_s * conf);
 */
 int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf);
 
+/**
+@brief Change the channel plan of a running concentrator, without restarting it
+The whole plan is checked first and left unchanged on error. Only the
+channelizer, LoRa service modem and FSK modem settings that differ from the
+running ones are programmed, the radios are not touched; IF chains must use
+RF chains enabled at start. Disabling the LoRa service or FSK chain stops its
+modem. Packets still in the RX buffer are reported with the new plan. If the
+chip cannot be programmed, the previous plan is kept as the configuration but
+the chip may run a mix of both: restart the concentrator.
+@param conf array of LGW_IF_CHAIN_NB IF chain configurations, as for lgw_rxif_setconf
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_rxif_reconf(struct lgw_conf_rxif_s * conf);
+
 /**
 @brief Configure the Tx gain LUT
 @param pointer to structure defining the LUT
@@ -365,6 +491,13 @@ int lgw_timestamp_setconf(struct lgw_conf_timestamp_s * conf);
 */
 int lgw_debug_setconf(struct lgw_conf_debug_s * conf);
 
+/**
+@brief Configure the packets dropped by lgw_receive (all packets are returned by default), can be called while running
+@param pointer to structure defining the config to be applied
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_rxfilter_setconf(struct lgw_conf_rxfilter_s * conf);
+
 /**
 @brief Connect to the LoRa concentrator, reset it and configure it according to previously set parameters
 @return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
@@ -382,9 +515,27 @@ int lgw_stop(void);
 @param max_pkt maximum number of packet that must be retrieved (equal to the size of the array of struct)
 @param pkt_data pointer to an array of struct that will receive the packet metadata and payload pointers
 @return LGW_HAL_ERROR id the operation failed, else the number of packets retrieved
+
+Once the concentrator is started, lgw_receive/lgw_receive_wait (RX path),
+lgw_send/lgw_status/lgw_abort_tx (TX path), lgw_get_instcnt/lgw_get_trigcnt and
+lgw_get_temperature can be called from different threads without an external
+lock: the HAL serializes SPI accesses with short critical sections, so a TX is
+not delayed by a whole RX fetch. lgw_start/lgw_stop and the _setconf functions
+must not be called concurrently with any other HAL function.
 */
 int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s * pkt_data);
 
+/**
+@brief Wait for packets to be available in the LoRa concentrator RX buffer
+@param timeout_ms maximum time to wait, in milliseconds (0 to only check the RX buffer once)
+@return LGW_HAL_ERROR id the operation failed, 1 if packets can be fetched with lgw_receive, 0 on timeout
+
+The SX1302 RX buffer is polled with an exponential backoff (from 1ms up to 32ms)
+so that an idle gateway does not generate a constant stream of SPI transactions,
+while a packet arriving right after a previous one is picked up quickly.
+*/
+int lgw_receive_wait(uint32_t timeout_ms);
+
 /**
 @brief Schedule a packet to be send immediately or after a delay depending on tx_mode
 @param pkt_data structure containing the data and metadata for the packet to send
@@ -411,6 +562,26 @@ the protocol.
 */
 int lgw_send(struct lgw_pkt_tx_s * pkt_data);
 
+/**
+@brief Program a packet in the TX modem of its RF chain, to be triggered later by lgw_tx_arm
+The packet is checked and programmed as by lgw_send, configuration and payload,
+so that lgw_tx_arm only writes the trigger registers. The RF chain must be free
+(no packet scheduled nor emitted). The staged packet is discarded by lgw_send
+or lgw_abort_tx on the same RF chain, and by the next lgw_tx_stage.
+@param pkt_data structure containing the data and metadata for the packet to stage
+@param stage_id pointer to the identifier of the staged packet, to be given to lgw_tx_arm
+@return LGW_HAL_ERROR if the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_tx_stage(struct lgw_pkt_tx_s * pkt_data, uint32_t * stage_id);
+
+/**
+@brief Trigger a packet staged by lgw_tx_stage, in the TX mode it was staged with
+@param rf_chain RF chain of the staged packet
+@param stage_id identifier returned by lgw_tx_stage
+@return LGW_HAL_ERROR if the packet is not staged anymore (send it with lgw_send) or the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_tx_arm(uint8_t rf_chain, uint32_t stage_id);
+
 /**
 @brief Give the the status of different part of the LoRa concentrator
 @param select is used to select what status we want to know
@@ -439,6 +610,13 @@ int lgw_get_trigcnt(uint32_t * trig_cnt_us);
 */
 int lgw_get_instcnt(uint32_t * inst_cnt_us);
 
+/**
+@brief Return instateneous value of internal counter, extended to 64 bits
+@param inst_cnt_us pointer to receive timestamp value, same lower 32 bits as lgw_get_instcnt
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_get_instcnt64(uint64_t * inst_cnt_us);
+
 /**
 @brief Return the LoRa concentrator EUI
 @param eui pointer to receive eui
@@ -450,9 +628,44 @@ int lgw_get_eui(uint64_t * eui);
 @brief Return the temperature measured by the LoRa concentrator sensor
 @param temperature The temperature measured, in degree celcius
 @return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+
+The sensor is always read. The value is also kept for RSSI temperature
+compensation in lgw_receive(), which otherwise reads the sensor at most once
+every temperature_refresh_ms (see lgw_conf_board_s).
 */
 int lgw_get_temperature(float * temperature);
 
+/**
+@brief Return where the last successful lgw_start spent its time
+@param stats pointer to receive the duration and SPI traffic of each phase
+@return LGW_HAL_ERROR if the concentrator has not been started, LGW_HAL_SUCCESS else
+*/
+int lgw_get_start_stats(struct lgw_start_stats_s * stats);
+
+/**
+@brief Return the SPI traffic counters of the concentrator link
+@param stats pointer to receive the number of messages, bytes and latency histogram per mux target and type of access
+@param reset clear the counters after they have been copied, to get the traffic of an interval
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_get_spi_stats(struct lgw_spi_stats_s * stats, bool reset);
+
+/**
+@brief Return the RX buffer fill level and near-full counters
+@param stats pointer to receive the counters, accumulated since lgw_start or the last reset
+@param reset clear the counters after they have been copied, to get the activity of an interval
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_get_rx_stats(struct lgw_rx_stats_s * stats, bool reset);
+
+/**
+@brief Return the preamble detections and demodulator allocations of each multi-SF channel
+@param stats pointer to receive the counters, accumulated since lgw_start or the last reset
+@param reset clear the counters after they have been copied, to get the activity of an interval
+@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+*/
+int lgw_get_arb_stats(struct lgw_arb_stats_s * stats, bool reset);
+
 /**
 @brief Allow user to check the version/options of the library once compiled
 @return pointer on a human-readable null terminated string
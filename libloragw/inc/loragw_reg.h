@@ -1428,12 +1428,93 @@ int reg_r_align32(void *spi_target, uint8_t spi_mux_target, struct lgw_reg_s r,
     SX1302_REG_TX_TOP_A_DUMMY_LORA_DUMMY : \
     SX1302_REG_TX_TOP_B_DUMMY_LORA_DUMMY)
 
+/* Fields of the registers accessed for each received or transmitted packet,
+   copied from the register table as "address, offset, length, sign", for the
+   lgw_reg_rf/lgw_reg_wf/lgw_reg_rbf accessors. Single-byte fields only, checked
+   against the register table by test_loragw_reg_fields. */
+#define SX1302_REGF_AGC_MCU_CTRL_PARITY_ERROR 0x5780, 0, 1, false
+#define SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE0_MCU_MAIL_BOX_WR_DATA 0x578C, 0, 8, false
+#define SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE1_MCU_MAIL_BOX_WR_DATA 0x578B, 0, 8, false
+#define SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE2_MCU_MAIL_BOX_WR_DATA 0x578A, 0, 8, false
+#define SX1302_REGF_ARB_MCU_ARB_DEBUG_STS_0_ARB_DEBUG_STS_0 0x608D, 0, 8, false
+#define SX1302_REGF_ARB_MCU_CTRL_PARITY_ERROR 0x6080, 0, 1, false
+#define SX1302_REGF_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES 0x58C8, 0, 5, false
+#define SX1302_REGF_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP 0x6105, 0, 8, false
+#define SX1302_REGF_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS 0x6101, 0, 8, false
+
+#define SX1302_REGF_TX_TOP_ADDR(rf_chain, offs) ((((rf_chain) == 0) ? 0x5200 : 0x5400) + (offs))
+#define SX1302_REGF_TX_TOP_AGC_TX_BW_AGC_TX_BW(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x0C), 0, 8, false
+#define SX1302_REGF_TX_TOP_AGC_TX_PWR_AGC_TX_PWR(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x0D), 0, 8, false
+#define SX1302_REGF_TX_TOP_FRAME_SYNCH_0_PEAK1_POS(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x6D), 0, 5, true
+#define SX1302_REGF_TX_TOP_FRAME_SYNCH_1_PEAK2_POS(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x6E), 0, 5, true
+#define SX1302_REGF_TX_TOP_FSK_BIT_RATE_LSB_BIT_RATE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x45), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_BIT_RATE_MSB_BIT_RATE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x44), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_CFG_0_CRC_EN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x41), 1, 1, false
+#define SX1302_REGF_TX_TOP_FSK_CFG_0_CRC_IBM(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x41), 4, 1, false
+#define SX1302_REGF_TX_TOP_FSK_CFG_0_DCFREE_ENC(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x41), 2, 2, false
+#define SX1302_REGF_TX_TOP_FSK_CFG_0_PKT_MODE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x41), 0, 1, false
+#define SX1302_REGF_TX_TOP_FSK_MOD_FSK_GAUSSIAN_EN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x46), 0, 1, false
+#define SX1302_REGF_TX_TOP_FSK_MOD_FSK_GAUSSIAN_SELECT_BT(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x46), 1, 2, false
+#define SX1302_REGF_TX_TOP_FSK_MOD_FSK_PREAMBLE_SEQ(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x46), 4, 1, false
+#define SX1302_REGF_TX_TOP_FSK_MOD_FSK_REF_PATTERN_EN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x46), 3, 1, false
+#define SX1302_REGF_TX_TOP_FSK_MOD_FSK_REF_PATTERN_SIZE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x46), 5, 3, false
+#define SX1302_REGF_TX_TOP_FSK_PKT_LEN_PKT_LENGTH(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x40), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_PREAMBLE_SIZE_LSB_PREAMBLE_SIZE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x43), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_PREAMBLE_SIZE_MSB_PREAMBLE_SIZE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x42), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE0_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x4E), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE1_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x4D), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE2_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x4C), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE3_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x4B), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE4_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x4A), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE5_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x49), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE6_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x48), 0, 8, false
+#define SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE7_FSK_REF_PATTERN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x47), 0, 8, false
+#define SX1302_REGF_TX_TOP_GEN_CFG_0_MODULATION_TYPE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x09), 0, 1, false
+#define SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE0_TIMER_DELAYED_TRIG(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x04), 0, 8, false
+#define SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE1_TIMER_DELAYED_TRIG(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x03), 0, 8, false
+#define SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE2_TIMER_DELAYED_TRIG(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x02), 0, 8, false
+#define SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE3_TIMER_DELAYED_TRIG(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x01), 0, 8, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_0_MODEM_BW(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x60), 4, 4, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_0_MODEM_SF(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x60), 0, 4, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_1_CODING_RATE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x61), 0, 3, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_1_PPM_OFFSET(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x61), 4, 2, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_1_PPM_OFFSET_HDR_CTRL(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x61), 6, 2, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_2_CADRXTX(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x62), 4, 2, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_2_CRC_EN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x62), 0, 1, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_2_FINE_SYNCH_EN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x62), 7, 1, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_2_IMPLICIT_HEADER(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x62), 1, 1, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_2_MODEM_EN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x62), 6, 1, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG0_3_PAYLOAD_LENGTH(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x63), 0, 8, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG1_1_MODEM_START(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x65), 7, 1, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG1_2_PREAMBLE_SYMB_NB(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x66), 0, 8, false
+#define SX1302_REGF_TX_TOP_TXRX_CFG1_3_PREAMBLE_SYMB_NB(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x67), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_CFG0_0_CHIRP_INVERT(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x69), 1, 1, false
+#define SX1302_REGF_TX_TOP_TX_CFG0_0_CHIRP_LOWPASS(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x69), 4, 3, false
+#define SX1302_REGF_TX_TOP_TX_CFG0_0_CONTINUOUS(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x69), 0, 1, false
+#define SX1302_REGF_TX_TOP_TX_CTRL_WRITE_BUFFER(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x07), 0, 1, false
+#define SX1302_REGF_TX_TOP_TX_FSM_STATUS_TX_STATUS(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x11), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_CTRL_TX_IF_SRC(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x20), 0, 2, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x28), 0, 4, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x29), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_RF_H_FREQ_RF(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x25), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_RF_L_FREQ_RF(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x27), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_RF_M_FREQ_RF(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x26), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_IQ_GAIN_IQ_GAIN(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x22), 0, 2, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_I_OFFSET_I_OFFSET(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x23), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_Q_OFFSET_Q_OFFSET(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x24), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_RFFE_IF_TEST_MOD_FREQ(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x2A), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_START_DELAY_LSB_TX_START_DELAY(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x06), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_START_DELAY_MSB_TX_START_DELAY(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x05), 0, 8, false
+#define SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_DELAYED(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x00), 1, 1, false
+#define SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_GPS(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x00), 2, 1, false
+#define SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_IMMEDIATE(rf_chain) SX1302_REGF_TX_TOP_ADDR(rf_chain, 0x00), 0, 1, false
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
 /**
 @brief Connect LoRa concentrator by opening SPI link
-@param spidev_path path to the SPI device to be used to connect to the SX1302
+@param spidev_path path to the SPI device to be used to connect to the SX1302, or "name:path" for a transport registered with lgw_com_register
 @return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
 */
 int lgw_connect(const char * spidev_path);
@@ -1488,6 +1569,122 @@ TODO
 */
 int lgw_mem_rb(uint16_t mem_addr, uint8_t *data, uint16_t size, bool fifo_mode);
 
+/**
+@brief Take the lock serializing all accesses to the concentrator SPI link
+Every register and memory access function takes it internally, so it only needs
+to be held explicitly around a sequence of accesses that must not be interleaved
+with other threads' accesses. The lock is recursive.
+*/
+void lgw_reg_lock(void);
+
+/**
+@brief Release the lock taken with lgw_reg_lock()
+*/
+void lgw_reg_unlock(void);
+
+/**
+@brief Configure the SPI link of the connected concentrator
+@param speed_hz SPI clock, in Hz, 0 to keep the current clock
+@param chunk_size max number of bytes per memory burst, 0 for the largest the spidev buffer allows
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+
+Memory bursts (lgw_mem_wb/lgw_mem_rb) are split in chunks which are combined
+in as few SPI messages as the spidev buffer size allows.
+*/
+int lgw_reg_spi_setconf(uint32_t speed_hz, uint16_t chunk_size);
+
+/**
+@brief Enable or disable the shadow copy of the SX1302 register file
+@param enable true to keep host-only registers in RAM, false to always access the chip
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+
+When enabled (default), register bytes that are only modified by the host are cached:
+read-modify-write of a bitfield is a single SPI write and reads do not access the chip.
+Status, pulse, self-clearing and MCU-shared registers are never cached.
+*/
+int lgw_reg_shadow_enable(bool enable);
+
+/**
+@brief Start queuing register writes instead of sending them one by one
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+
+Writes issued by lgw_reg_w until lgw_reg_batch_end are queued in order, writes
+to adjacent addresses being merged in a single burst. The queue is submitted as
+one multi-transfer SPI message when the batch ends, when it is full, or before
+any access that cannot be served without the chip (read, burst, memory access).
+The SPI lock (see lgw_reg_lock) is held by the calling thread until the batch ends.
+*/
+int lgw_reg_batch_start(void);
+
+/**
+@brief Submit queued register writes and stop queuing
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_batch_end(void);
+
+/**
+@brief Write the bits of a register byte selected by mask, addressed by SPI address
+@param addr register address
+@param mask bits to be written, 0xFF to write the byte without reading it
+@param data new value of the bits, already shifted to their position
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+
+Same shadow copy and batch handling as lgw_reg_w, without the register table
+lookup. Used through lgw_reg_wf with the SX1302_REGF_* field descriptors.
+*/
+int lgw_reg_w_byte(uint16_t addr, uint8_t mask, uint8_t data);
+
+/**
+@brief Read a register byte addressed by SPI address
+@param addr register address
+@param data pointer to the byte read
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_r_byte(uint16_t addr, uint8_t *data);
+
+/**
+@brief Burst read of registers addressed by SPI address, as lgw_reg_rb
+@param addr address of the first register
+@param data pointer to the bytes read
+@param size number of bytes to read
+@return status of register operation (LGW_REG_SUCCESS/LGW_REG_ERROR)
+*/
+int lgw_reg_rb_addr(uint16_t addr, uint8_t *data, uint16_t size);
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC INLINE FUNCTIONS ---------------------------------------------- */
+
+/* Register accessors taking a SX1302_REGF_* field descriptor, eg.
+   lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_0_MODEM_SF(rf_chain), sf).
+   Address, mask and shift are resolved at compile time. */
+
+static inline int lgw_reg_wf(uint16_t addr, uint8_t offs, uint8_t leng, bool sign, int32_t reg_value) {
+    (void)sign;
+    return lgw_reg_w_byte(addr, (uint8_t)(((1 << leng) - 1) << offs), (uint8_t)(reg_value << offs));
+}
+
+static inline int lgw_reg_rf(uint16_t addr, uint8_t offs, uint8_t leng, bool sign, int32_t *reg_value) {
+    uint8_t u = 0;
+    int err;
+
+    err = lgw_reg_r_byte(addr, &u);
+    u = (uint8_t)(u << (8 - leng - offs)); /* left-align the data */
+    if (sign == true) {
+        *reg_value = (int32_t)((int8_t)u >> (8 - leng)); /* ARITHMETIC right shift */
+    } else {
+        *reg_value = (int32_t)(u >> (8 - leng));
+    }
+
+    return err;
+}
+
+static inline int lgw_reg_rbf(uint16_t addr, uint8_t offs, uint8_t leng, bool sign, uint8_t *data, uint16_t size) {
+    (void)offs;
+    (void)leng;
+    (void)sign;
+    return lgw_reg_rb_addr(addr, data, size);
+}
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
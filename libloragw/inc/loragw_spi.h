@@ -23,6 +23,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
 #include <stdint.h>        /* C99 types*/
+#include <stdbool.h>       /* bool type */
 
 #include "config.h"    /* library configuration options (dynamically generated) */
 
@@ -39,6 +40,61 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define LGW_SPI_MUX_TARGET_RADIOA   0x01
 #define LGW_SPI_MUX_TARGET_RADIOB   0x02
 
+#define LGW_SPI_MUX_TARGET_NB       3   /* SX1302 and the two radios */
+
+#define LGW_SPI_MSG_BURST_MAX       32  /* max number of bursts combined in a single SPI message */
+
+#define LGW_SPI_LAT_BIN_NB          8   /* number of bins of the SPI message latency histograms */
+#define LGW_SPI_LAT_BINS_US         { 50, 100, 200, 500, 1000, 2000, 5000 } /* upper bound of each bin but the last one, in us */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct lgw_spi_burst_s
+@brief Description of a burst write, to be combined with others in a single SPI message
+*/
+struct lgw_spi_burst_s {
+    uint16_t        address;    /*!< address of the first byte to write */
+    uint16_t        size;       /*!< number of bytes to write (LGW_BURST_CHUNK max) */
+    const uint8_t   *data;      /*!< pointer to the data to write */
+};
+
+/**
+@enum lgw_spi_op_t
+@brief Type of SPI access, statistics are kept for each of them
+*/
+typedef enum {
+    LGW_SPI_OP_WRITE,       /*!< single register write */
+    LGW_SPI_OP_READ,        /*!< single register read */
+    LGW_SPI_OP_WRITE_BURST, /*!< burst, chunked or multiple burst write */
+    LGW_SPI_OP_READ_BURST,  /*!< burst or chunked read */
+    LGW_SPI_OP_NB
+} lgw_spi_op_t;
+
+/**
+@struct lgw_spi_op_stats_s
+@brief SPI messages of one type sent to one SPI mux target
+*/
+struct lgw_spi_op_stats_s {
+    uint32_t    transfers;      /*!< number of SPI messages (ioctl calls) */
+    uint32_t    errors;         /*!< number of SPI messages that failed */
+    uint64_t    bytes;          /*!< number of bytes clocked, commands included */
+    uint64_t    latency_sum_us; /*!< total time spent in the ioctl calls */
+    uint32_t    latency_max_us; /*!< longest ioctl call */
+    uint32_t    latency_hist[LGW_SPI_LAT_BIN_NB]; /*!< ioctl calls per latency bin, see LGW_SPI_LAT_BINS_US */
+};
+
+/**
+@struct lgw_spi_stats_s
+@brief SPI traffic counters, per mux target and type of access
+*/
+struct lgw_spi_stats_s {
+    struct lgw_spi_op_stats_s   target[LGW_SPI_MUX_TARGET_NB][LGW_SPI_OP_NB];
+};
+
+struct spi_ioc_transfer; /* see linux/spi/spidev.h */
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
@@ -51,6 +107,20 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 int lgw_spi_open(const char * spidev_path, void **spi_target_ptr);
 
+/**
+@brief LoRa concentrator SPI clock configuration
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param speed_hz maximum SPI clock, in Hz
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_set_speed(void *spi_target, uint32_t speed_hz);
+
+/**
+@brief Get the maximum number of bytes that can be sent in one SPI message
+@return the spidev buffer size detected when the SPI device was opened
+*/
+uint32_t lgw_spi_get_msg_size_max(void);
+
 /**
 @brief LoRa concentrator SPI close
 @param spi_target generic pointer to SPI target (implementation dependant)
@@ -97,6 +167,70 @@ int lgw_spi_wb(void *spi_target, uint8_t spi_mux_target, uint16_t address, const
 */
 int lgw_spi_rb(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size);
 
+/**
+@brief LoRa concentrator SPI burst write, split in chunks at increasing addresses
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param spi_mux_target SPI mux target (SX1302 or radio)
+@param address address of the first byte to write
+@param data pointer to byte array that will be sent to the LoRa concentrator
+@param size size of the transfer, in byte(s)
+@param chunk_size max size of a chunk, in byte(s), 0 for the largest possible
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+
+Chunks are combined in as few SPI messages as the spidev buffer size allows.
+*/
+int lgw_spi_wb_chunks(void *spi_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size, uint16_t chunk_size);
+
+/**
+@brief LoRa concentrator SPI burst read, split in chunks
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param spi_mux_target SPI mux target (SX1302 or radio)
+@param address address of the first byte to read
+@param data pointer to byte array that will be written from the LoRa concentrator
+@param size size of the transfer, in byte(s)
+@param chunk_size max size of a chunk, in byte(s), 0 for the largest possible
+@param fifo_mode if true, all chunks are read from the same address
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+
+Chunks are combined in as few SPI messages as the spidev buffer size allows.
+*/
+int lgw_spi_rb_chunks(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, uint16_t chunk_size, bool fifo_mode);
+
+/**
+@brief LoRa concentrator SPI multiple burst write, in as few SPI messages as possible
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param spi_mux_target SPI mux target (SX1302 or radio)
+@param bursts array of bursts to be written, in order
+@param nb_bursts number of bursts in the array
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+
+Each burst is a separate transfer (chip select toggled in between), but up to
+LGW_SPI_MSG_BURST_MAX bursts are submitted to the kernel in one ioctl call.
+*/
+int lgw_spi_wb_multi(void *spi_target, uint8_t spi_mux_target, const struct lgw_spi_burst_s *bursts, uint16_t nb_bursts);
+
+/**
+@brief LoRa concentrator SPI raw frame, full-duplex
+@param spi_target generic pointer to SPI target (implementation dependant)
+@param op type of access, for the statistics
+@param tx_data frame to send, its first byte is the SPI mux target
+@param rx_data buffer receiving the frame read back, same size, NULL for a write
+@param size size of the frame, in byte(s)
+@return status of register operation (LGW_SPI_SUCCESS/LGW_SPI_ERROR)
+*/
+int lgw_spi_xfer(void *spi_target, lgw_spi_op_t op, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size);
+
+/**
+@brief Send a SPI message and account for it in the SPI statistics (see lgw_com_account)
+@param spi_device file descriptor of the spidev device
+@param spi_mux_target SPI mux target the message is sent to
+@param op type of access
+@param k transfers composing the message
+@param nb_xfer number of transfers
+@return return value of the SPI_IOC_MESSAGE ioctl
+*/
+int lgw_spi_message(int spi_device, uint8_t spi_mux_target, lgw_spi_op_t op, struct spi_ioc_transfer *k, unsigned nb_xfer);
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -31,6 +31,12 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC CONSTANTS ----------------------------------------------------- */
 
+#define SX1250_MODE_STDBY_RC    0x02 /* chip mode, as returned by GET_STATUS */
+#define SX1250_MODE_STDBY_XOSC  0x03
+#define SX1250_MODE_TX          0x06
+
+#define SX1250_CMD_SIZE_MAX     8    /* parameters of a command in a sequence */
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC TYPES --------------------------------------------------------- */
 
@@ -88,11 +94,23 @@ typedef enum {
     SET_RAMP_3400U          = 0x07
 } sx1250_ramp_time_t;
 
+/* command of a sequence sent with sx1250_write_commands */
+struct sx1250_cmd_s {
+    sx1250_op_code_t    op_code;
+    uint8_t             size;
+    uint8_t             data[SX1250_CMD_SIZE_MAX];
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
-int sx1250_write_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *data, uint16_t size);
+int sx1250_write_command(uint8_t rf_chain, sx1250_op_code_t op_code, const uint8_t *data, uint16_t size);
 int sx1250_read_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *data, uint16_t size);
+int sx1250_write_commands(uint8_t rf_chain, const struct sx1250_cmd_s *cmds, unsigned nb_cmds); /* stops on the first failure */
+
+void sx1250_set_fast_start(bool enable);
+int sx1250_wait_mode(uint8_t rf_chain, uint8_t mode, uint32_t timeout_ms);
+int sx1250_wait_ready(uint8_t rf_chain, uint32_t timeout_ms); /* wait_ms(timeout_ms) unless fast start is enabled */
 
 int sx1250_calibrate(uint8_t rf_chain, uint32_t freq_hz);
 int sx1250_setup(uint8_t rf_chain, uint32_t freq_hz, bool single_input_mode);
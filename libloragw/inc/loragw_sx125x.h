@@ -119,6 +119,15 @@ radio_reg_t;
 
 #define RADIO_TOTALREGS 51
 
+/**
+@struct lgw_sx125x_reg_val_s
+@brief Register value of a sequence written with lgw_sx125x_reg_w_seq
+*/
+struct lgw_sx125x_reg_val_s {
+    radio_reg_t idx;
+    uint8_t     data;
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC CONSTANTS ----------------------------------------------------- */
 /*
@@ -141,8 +150,33 @@ F_register(24bit) = F_rf (Hz) / F_step(Hz)
 
 int sx125x_setup(uint8_t rf_chain, uint8_t rf_clkout, bool rf_enable, uint8_t rf_radio_type, uint32_t freq_hz);
 
+/**
+@brief Wait for a radio to answer on SPI after its reset has been released
+@param rf_chain RF chain of the radio
+@param timeout_ms Maximum time to wait in ms
+@return 0 if the radio is ready, -1 on timeout
+*/
+int sx125x_wait_ready(uint8_t rf_chain, uint32_t timeout_ms);
+
 int lgw_sx125x_reg_w(radio_reg_t idx, uint8_t data, uint8_t rf_chain);
 int lgw_sx125x_reg_r(radio_reg_t idx, uint8_t *data, uint8_t rf_chain);
 
+/**
+@brief Write a sequence of radio registers
+The fields of a same address following each other are merged in a single
+write, and values already in the radio are not written again.
+@param regs Registers and values, in programming order
+@param nb_regs Number of registers
+@param rf_chain RF chain of the radio
+@return LGW_REG_SUCCESS, LGW_REG_ERROR if a write failed (the sequence is then stopped)
+*/
+int lgw_sx125x_reg_w_seq(const struct lgw_sx125x_reg_val_s *regs, unsigned nb_regs, uint8_t rf_chain);
+
+/**
+@brief Forget the register values known for a radio, to be called when it is
+reset or when a firmware may program it
+*/
+void lgw_sx125x_shadow_reset(uint8_t rf_chain);
+
 #endif
 /* --- EOF ------------------------------------------------------------------ */
@@ -111,6 +111,12 @@ int sx1302_update(void);
 */
 int sx1302_radio_clock_select(uint8_t rf_chain);
 
+/**
+@brief Select how radios are brought up by sx1302_radio_reset and sx1250_setup
+@param enable true to poll the radios status, false to wait for the worst case delays
+*/
+void sx1302_radio_fast_start(bool enable);
+
 /**
 @brief Apply the radio reset sequence to the required RF chain index
 @param rf_chain The RF chain index of the radio to be reset
@@ -139,9 +145,12 @@ int sx1302_radio_host_ctrl(bool host_ctrl);
 @param context_rf_chain The RF chains array from which to get RF chains current configuration
 @param clksrc           The RF chain index which provides the clock source
 @param txgain_lut       A pointer to the TX gain LUT to be filled
+@param cal_cache_path   File where sx125x calibration results are reused from and saved to, NULL to always calibrate
+@param temperature      Current concentrator temperature, part of the calibration cache key
+@param cal_fw           Filled with the duration and SPI traffic of the sx125x calibration firmware if it was run, can be NULL
 @return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
 */
-int sx1302_radio_calibrate(struct lgw_conf_rxrf_s * context_rf_chain, uint8_t clksrc, struct lgw_tx_gain_lut_s * txgain_lut);
+int sx1302_radio_calibrate(struct lgw_conf_rxrf_s * context_rf_chain, uint8_t clksrc, struct lgw_tx_gain_lut_s * txgain_lut, const char * cal_cache_path, float temperature, struct lgw_start_phase_s * cal_fw);
 
 /**
 @brief Configure the PA and LNA LUTs
@@ -237,6 +246,13 @@ int sx1302_gps_enable(bool enable);
 */
 uint32_t sx1302_timestamp_counter(bool pps);
 
+/**
+@brief Get the current SX1302 internal counter value, extended to 64-bits
+@param pps      True for getting the counter value at last PPS
+@return the counter value in microseconds, never wraps
+*/
+uint64_t sx1302_timestamp_counter64(bool pps);
+
 /**
 @brief TODO
 @param TODO
@@ -343,9 +359,25 @@ uint8_t sx1302_arb_get_debug_stats_alloc(uint8_t channel);
 void sx1302_arb_print_debug_stats(void);
 
 /**
-@brief TODO
-@param TODO
-@return TODO
+@brief Accumulate the ARB detect and allocation counters of the multi-SF channels
+@param  refresh Read the counters even if they were read less than ARB_STATS_REFRESH_MS ago
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int sx1302_arb_update_debug_stats(bool refresh);
+
+/**
+@brief Get the detections and demodulator allocations accumulated by sx1302_arb_update_debug_stats
+@param  stats A pointer to allocated memory to hold the counters
+@param  reset Clear the counters after they have been copied
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int sx1302_arb_get_stats(struct lgw_arb_stats_s * stats, bool reset);
+
+/**
+@brief Compute the CRC16 of a LoRa payload, as done by the SX1302 modems
+@param data pointer to the payload
+@param size size of the payload, in bytes
+@return the payload CRC16
 */
 uint16_t sx1302_lora_payload_crc(const uint8_t * data, uint8_t size);
 
@@ -357,6 +389,28 @@ uint16_t sx1302_lora_payload_crc(const uint8_t * data, uint8_t size);
 */
 int sx1302_fetch(uint8_t * nb_pkt);
 
+/**
+@brief Set the max number of bytes read from the SX1302 RX buffer by each fetch
+@param  size Number of bytes, from RX_BUFFER_PKT_MAX to RX_BUFFER_SIZE
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int sx1302_rx_buffer_setconf(uint16_t size);
+
+/**
+@brief Get the RX buffer fill level and near-full counters, updated by sx1302_fetch
+@param  stats A pointer to allocated memory to hold the counters
+@param  reset Clear the counters after they have been copied
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int sx1302_get_rx_stats(struct lgw_rx_stats_s * stats, bool reset);
+
+/**
+@brief Check if there are packets waiting to be parsed or bytes available in the SX1302 RX buffer
+@param  pending A pointer to allocated memory to hold the RX buffer status
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int sx1302_rx_pending(bool * pending);
+
 /**
 @brief Parse and return the next packet available in rx_buffer.
 @param context      Gateway configuration context
@@ -420,6 +474,23 @@ int sx1302_tx_configure(lgw_radio_type_t radio_type);
 */
 int sx1302_send(lgw_radio_type_t radio_type, struct lgw_tx_gain_lut_s * tx_lut, bool lwan_public, struct lgw_conf_rxif_s * context_fsk, struct lgw_pkt_tx_s * pkt_data);
 
+/**
+@brief Program the TX configuration and payload of a packet, without triggering it
+@param tx_start_delay pointer to the TX start delay of the packet, to be given to sx1302_tx_arm
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int sx1302_tx_stage(lgw_radio_type_t radio_type, struct lgw_tx_gain_lut_s * tx_lut, bool lwan_public, struct lgw_conf_rxif_s * context_fsk, struct lgw_pkt_tx_s * pkt_data, uint16_t * tx_start_delay);
+
+/**
+@brief Trigger a packet programmed by sx1302_tx_stage
+@param rf_chain the TX chain of the packet
+@param tx_mode IMMEDIATE, TIMESTAMPED or ON_GPS
+@param count_us timestamp of the TX, for TIMESTAMPED mode
+@param tx_start_delay TX start delay returned by sx1302_tx_stage
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int sx1302_tx_arm(uint8_t rf_chain, uint8_t tx_mode, uint32_t count_us, uint16_t tx_start_delay);
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
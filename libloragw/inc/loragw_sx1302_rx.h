@@ -26,6 +26,9 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC CONSTANTS ----------------------------------------------------- */
 
+#define RX_BUFFER_SIZE      4096    /* size of the SX1302 RX buffer, in bytes */
+#define RX_BUFFER_PKT_MAX   788     /* largest packet stored in the RX buffer: metadata, 255 bytes payload, 255 timestamp metrics */
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC MACROS -------------------------------------------------------- */
 
@@ -44,7 +47,7 @@ typedef struct rx_packet_s {
     uint8_t     rx_rate_sf;                 /* LoRa only */
     uint8_t     modem_id;
     int32_t     frequency_offset_error;     /* LoRa only */
-    uint8_t     payload[255];
+    const uint8_t * payload;                /* points into the rx_buffer, valid until next fetch */
     bool        payload_crc_error;
     bool        sync_error;                 /* LoRa only */
     bool        header_error;               /* LoRa only */
@@ -59,8 +62,6 @@ typedef struct rx_packet_s {
     uint32_t    timestamp_cnt;
     uint16_t    rx_crc16_value;             /* LoRa only */
     uint8_t     num_ts_metrics_stored;      /* LoRa only */
-    uint8_t     timestamp_avg[255];         /* LoRa only */
-    uint8_t     timestamp_stddev[255];      /* LoRa only */
     uint8_t     packet_checksum;
 } rx_packet_t;
 
@@ -69,10 +70,13 @@ typedef struct rx_packet_s {
 @brief buffer to hold the data fetched from the sx1302 RX buffer
 */
 typedef struct rx_buffer_s {
-    uint8_t buffer[4096];   /*!> byte array to hald the data fetched from the RX buffer */
+    uint8_t buffer[RX_BUFFER_SIZE]; /*!> byte array to hald the data fetched from the RX buffer */
     uint16_t buffer_size;   /*!> The number of bytes currently stored in the buffer */
     int buffer_index;       /*!> Current parsing index in the buffer */
     uint8_t buffer_pkt_nb;
+    uint16_t buffer_capacity; /*!> Max number of bytes held by the buffer, the remaining bytes are left in the SX1302 for the next fetch */
+    uint16_t fifo_level;    /*!> Number of bytes in the SX1302 RX buffer at the last fetch */
+    uint16_t fifo_read;     /*!> Number of bytes read from the SX1302 RX buffer at the last fetch */
 } rx_buffer_t;
 
 /* -------------------------------------------------------------------------- */
@@ -85,6 +89,14 @@ typedef struct rx_buffer_s {
 */
 int rx_buffer_new(rx_buffer_t * self);
 
+/**
+@brief Set the max number of bytes held by the rx_buffer, read from the SX1302 on each fetch
+@param self     A pointer to a rx_buffer handler
+@param capacity Number of bytes, from RX_BUFFER_PKT_MAX to RX_BUFFER_SIZE
+@return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
+*/
+int rx_buffer_set_capacity(rx_buffer_t * self, uint16_t capacity);
+
 /**
 @brief Reset the rx_buffer instance
 @param self     A pointer to a rx_buffer handler
@@ -94,6 +106,8 @@ int rx_buffer_del(rx_buffer_t * self);
 
 /**
 @brief Fetch packets from the SX1302 internal RX buffer, and count packets available.
+The bytes of a packet not entirely read by the previous fetch, when the SX1302
+held more than the buffer capacity, are kept and completed by this one.
 @param self     A pointer to a rx_buffer handler
 @return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
 */
@@ -101,6 +115,8 @@ int rx_buffer_fetch(rx_buffer_t * self);
 
 /**
 @brief Parse the rx_buffer and return the first packet available in the given structure.
+The payload is not copied: pkt->payload points into the rx_buffer and remains
+valid until the next call to rx_buffer_new() or rx_buffer_fetch().
 @param self     A pointer to a rx_buffer handler
 @param pkt      A pointer to the structure to receive the packet parsed
 @return LGW_REG_SUCCESS if success, LGW_REG_ERROR otherwise
@@ -11,6 +11,8 @@ Description:
     Handles the conversion of a 32-bits 32MHz counter into a 32-bits 1 MHz counter.
     This modules MUST be called regularly by the application to maintain counter
     wrapping handling for conversion in 1MHz counter.
+    Between two reads of the counter, its value is extrapolated from the host
+    monotonic clock, which also gives a 64-bits counter that never wraps.
     Provides function to compute the correction to be applied to the received
     timestamp for demodulation processing time.
 
@@ -46,6 +48,9 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 struct timestamp_info_s {
     uint32_t counter_us_27bits_ref;     /* reference value (last read) */
     uint8_t  counter_us_27bits_wrap;    /* rollover/wrap status */
+    uint64_t counter_us_64bits_ref;     /* reference value extended to 64-bits */
+    uint64_t host_ref_us;               /* host monotonic time of the last read, in microseconds */
+    bool     host_ref_valid;            /* the counter has been read at least once */
 };
 typedef struct timestamp_counter_s {
     struct timestamp_info_s inst; /* holds current reference of the instantaneous counter */
@@ -78,6 +83,22 @@ void timestamp_counter_delete(timestamp_counter_t * self);
 */
 void timestamp_counter_update(timestamp_counter_t * self, bool pps, uint32_t cnt);
 
+/**
+@brief Read the counter only if the reference is older than max_age_ms, to maintain the wrapping status
+@param self         Pointer to the counter handler
+@param pps          Set to true to refresh the PPS trig counter status
+@param max_age_ms   Maximum age of the reference before the counter is read again
+@return N/A
+*/
+void timestamp_counter_refresh(timestamp_counter_t * self, bool pps, uint32_t max_age_ms);
+
+/**
+@brief Estimate the current instantaneous counter from the reference and the host monotonic clock
+@param self     Pointer to the counter handler
+@return the estimated 64-bits counter, in microseconds
+*/
+uint64_t timestamp_counter_extrapolate(timestamp_counter_t * self);
+
 /**
 @brief Convert the 27-bits counter given by the SX1302 to a 32-bits counter which wraps on a uint32_t.
 @param self     Pointer to the counter handler
@@ -95,6 +116,14 @@ uint32_t timestamp_counter_expand(timestamp_counter_t * self, bool pps, uint32_t
 */
 uint32_t timestamp_pkt_expand(timestamp_counter_t * self, uint32_t cnt_us);
 
+/**
+@brief Convert the 27-bits packet timestamp to a 64-bits counter, without reading the SX1302 counter
+@param self     Pointer to the counter handler
+@param cnt_us   The packet 27-bits counter to be expanded, received less than 67 seconds ago
+@return the 64-bits counter
+*/
+uint64_t timestamp_pkt_expand64(timestamp_counter_t * self, uint32_t cnt_us);
+
 /**
 @brief Reads the SX1302 internal counter register, and return the 32-bits 1 MHz counter
 @param self     Pointer to the counter handler
@@ -103,6 +132,14 @@ uint32_t timestamp_pkt_expand(timestamp_counter_t * self, uint32_t cnt_us);
 */
 uint32_t timestamp_counter_get(timestamp_counter_t * self, bool pps);
 
+/**
+@brief Reads the SX1302 internal counter register, and return the 64-bits 1 MHz counter
+@param self     Pointer to the counter handler
+@param pps      Set to true to expand the counter based on the PPS trig wrapping status
+@return the current 64-bits counter
+*/
+uint64_t timestamp_counter_get64(timestamp_counter_t * self, bool pps);
+
 /**
 @brief Get the timestamp correction to applied to the packet timestamp
 @param ifmod            modem type
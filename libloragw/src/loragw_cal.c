@@ -16,6 +16,13 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
 #include <stdint.h>     /* C99 types */
 #include <stdio.h>      /* printf fprintf */
 #include <stdlib.h>     /* malloc free */
@@ -24,6 +31,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <string.h>     /* memset */
 #include <inttypes.h>
 #include <math.h>
+#include <time.h>       /* clock_gettime */
 
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
@@ -60,13 +68,48 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define CAL_TX_TONE_FREQ_HZ     250000
 #define CAL_ITER                3 /* Number of calibration iterations */
 #define CAL_TX_CORR_DURATION    0 /* 0:1ms, 1:2ms, 2:4ms, 3:8ms */
+#define CAL_RX_PLL_TIMEOUT_MS   10 /* max time for both radios to lock for Rx image calibration */
+#define CAL_TX_PLL_TIMEOUT_MS   2  /* max time for the radio to lock for Tx DC offset calibration */
+
+#define CAL_CACHE_MAGIC         0x4C414353 /* "SCAL" */
+#define CAL_CACHE_VERSION       1
+#define CAL_CACHE_TEMP_BAND     10 /* degC, radios are calibrated again when the temperature changes of band */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* Calibration results and the conditions they were obtained in, as saved in the cache file */
+struct cal_cache_s {
+    uint32_t    magic;
+    uint32_t    version;
+    uint64_t    eui;                /* concentrator the radios belong to */
+    int32_t     temp_band;          /* temperature / CAL_CACHE_TEMP_BAND */
+    struct {
+        uint8_t     enable;
+        uint8_t     tx_enable;
+        uint8_t     type;
+        uint32_t    freq_hz;
+        int8_t      rx_image_amp;   /* Rx IQ mismatch corrections */
+        int8_t      rx_image_phi;
+        uint8_t     lut_size;
+        struct {
+            uint8_t     dac_gain;
+            uint8_t     mix_gain;
+            int8_t      offset_i;   /* Tx DC offsets */
+            int8_t      offset_q;
+        } lut[TX_GAIN_LUT_SIZE_MAX];
+    } rf[LGW_RF_CHAIN_NB];
+};
 
 /* -------------------------------------------------------------------------- */
 /* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
 
-/* Record Rx IQ mismatch corrections from calibration */
-static int8_t rf_rx_image_amp[LGW_RF_CHAIN_NB] = {0, 0};
-static int8_t rf_rx_image_phi[LGW_RF_CHAIN_NB] = {0, 0};
+/* Concentrator board accessed by the calling thread */
+extern __thread lgw_handle_t lgw_board;
+
+/* Record Rx IQ mismatch corrections from calibration, for each board */
+static int8_t rf_rx_image_amp[LGW_BOARD_NB][LGW_RF_CHAIN_NB];
+static int8_t rf_rx_image_phi[LGW_BOARD_NB][LGW_RF_CHAIN_NB];
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
@@ -81,9 +124,176 @@ void cal_tx_result_sort(struct lgw_sx125x_cal_tx_result_s *res_tx, struct lgw_sx
 bool cal_tx_result_assert(struct lgw_sx125x_cal_tx_result_s *res_tx_min, struct lgw_sx125x_cal_tx_result_s *res_tx_max);
 int sx125x_cal_tx_dc_offset(uint8_t rf_chain, uint32_t freq_hz, uint8_t dac_gain, uint8_t mix_gain, uint8_t radio_type, struct lgw_sx125x_cal_tx_result_s * res);
 
+static uint32_t cal_elapsed_ms(const struct timespec * start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Poll the PLL lock status of the radios instead of waiting for the worst case settling time.
+   The first read is done after 1ms so that a lock status left from the previous configuration is not trusted. */
+static bool cal_wait_pll_lock(uint8_t rx, uint8_t tx, uint32_t timeout_ms) {
+    struct timespec start;
+    uint8_t rx_pll_locked = 0, tx_pll_locked = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    wait_ms(1);
+    do {
+        if (rx_pll_locked == 0) {
+            lgw_sx125x_reg_r(SX125x_REG_MODE_STATUS__RX_PLL_LOCKED, &rx_pll_locked, rx);
+        }
+        if (tx_pll_locked == 0) {
+            lgw_sx125x_reg_r(SX125x_REG_MODE_STATUS__TX_PLL_LOCKED, &tx_pll_locked, tx);
+        }
+        if ((rx_pll_locked != 0) && (tx_pll_locked != 0)) {
+            return true;
+        }
+    } while (cal_elapsed_ms(&start) <= timeout_ms);
+
+    return false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void cal_cache_fill(struct cal_cache_s * cache, uint64_t eui, float temperature, const struct lgw_conf_rxrf_s * rf_chain_cfg, const struct lgw_tx_gain_lut_s * txgain_lut) {
+    int i, j;
+
+    memset(cache, 0, sizeof *cache); /* padding included, to compare and save the whole structure */
+    cache->magic = CAL_CACHE_MAGIC;
+    cache->version = CAL_CACHE_VERSION;
+    cache->eui = eui;
+    cache->temp_band = (int32_t)floorf(temperature / CAL_CACHE_TEMP_BAND);
+    for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
+        cache->rf[i].enable = rf_chain_cfg[i].enable;
+        cache->rf[i].tx_enable = rf_chain_cfg[i].tx_enable;
+        cache->rf[i].type = (uint8_t)rf_chain_cfg[i].type;
+        cache->rf[i].freq_hz = rf_chain_cfg[i].freq_hz;
+        cache->rf[i].rx_image_amp = rf_rx_image_amp[lgw_board][i];
+        cache->rf[i].rx_image_phi = rf_rx_image_phi[lgw_board][i];
+        cache->rf[i].lut_size = txgain_lut[i].size;
+        for (j = 0; j < txgain_lut[i].size; j++) {
+            cache->rf[i].lut[j].dac_gain = txgain_lut[i].lut[j].dac_gain;
+            cache->rf[i].lut[j].mix_gain = txgain_lut[i].lut[j].mix_gain;
+            cache->rf[i].lut[j].offset_i = txgain_lut[i].lut[j].offset_i;
+            cache->rf[i].lut[j].offset_q = txgain_lut[i].lut[j].offset_q;
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Only the calibration conditions are compared, not the results */
+static bool cal_cache_match(const struct cal_cache_s * saved, const struct cal_cache_s * current) {
+    int i, j;
+
+    if ((saved->magic != current->magic) || (saved->version != current->version) || (saved->eui != current->eui) || (saved->temp_band != current->temp_band)) {
+        return false;
+    }
+    for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
+        if ((saved->rf[i].enable != current->rf[i].enable) ||
+            (saved->rf[i].tx_enable != current->rf[i].tx_enable) ||
+            (saved->rf[i].type != current->rf[i].type) ||
+            (saved->rf[i].freq_hz != current->rf[i].freq_hz) ||
+            (saved->rf[i].lut_size != current->rf[i].lut_size)) {
+            return false;
+        }
+        for (j = 0; j < current->rf[i].lut_size; j++) {
+            if ((saved->rf[i].lut[j].dac_gain != current->rf[i].lut[j].dac_gain) || (saved->rf[i].lut[j].mix_gain != current->rf[i].lut[j].mix_gain)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
+int sx1302_cal_cache_load(const char * path, uint64_t eui, float temperature, struct lgw_conf_rxrf_s * rf_chain_cfg, struct lgw_tx_gain_lut_s * txgain_lut) {
+    FILE * f;
+    struct cal_cache_s saved, current;
+    size_t n;
+    int i, j;
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        DEBUG_PRINTF("INFO: no calibration cache in %s\n", path);
+        return LGW_HAL_ERROR;
+    }
+    n = fread(&saved, 1, sizeof saved, f);
+    fclose(f);
+    if (n != sizeof saved) {
+        printf("WARNING: invalid calibration cache %s, ignored\n", path);
+        return LGW_HAL_ERROR;
+    }
+
+    cal_cache_fill(&current, eui, temperature, rf_chain_cfg, txgain_lut);
+    if (cal_cache_match(&saved, &current) == false) {
+        printf("INFO: calibration cache %s does not match the current conditions, radios will be calibrated\n", path);
+        return LGW_HAL_ERROR;
+    }
+
+    /* Apply saved IQ mismatch compensation */
+    for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
+        rf_rx_image_amp[lgw_board][i] = saved.rf[i].rx_image_amp;
+        rf_rx_image_phi[lgw_board][i] = saved.rf[i].rx_image_phi;
+    }
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_AMP_COEFF_RADIO_A_AMP_COEFF, (int32_t)rf_rx_image_amp[lgw_board][0]);
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_PHI_COEFF_RADIO_A_PHI_COEFF, (int32_t)rf_rx_image_phi[lgw_board][0]);
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_AMP_COEFF_RADIO_B_AMP_COEFF, (int32_t)rf_rx_image_amp[lgw_board][1]);
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_PHI_COEFF_RADIO_B_PHI_COEFF, (int32_t)rf_rx_image_phi[lgw_board][1]);
+
+    /* Fill saved DC offsets in Tx LUT */
+    for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
+        for (j = 0; j < txgain_lut[i].size; j++) {
+            txgain_lut[i].lut[j].offset_i = saved.rf[i].lut[j].offset_i;
+            txgain_lut[i].lut[j].offset_q = saved.rf[i].lut[j].offset_q;
+        }
+    }
+
+    printf("INFO: radio calibration restored from %s (RadioA amp:%d phi:%d, RadioB amp:%d phi:%d)\n", path, rf_rx_image_amp[lgw_board][0], rf_rx_image_phi[lgw_board][0], rf_rx_image_amp[lgw_board][1], rf_rx_image_phi[lgw_board][1]);
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1302_cal_cache_save(const char * path, uint64_t eui, float temperature, struct lgw_conf_rxrf_s * rf_chain_cfg, struct lgw_tx_gain_lut_s * txgain_lut) {
+    FILE * f;
+    struct cal_cache_s cache;
+    char tmp_path[256];
+    size_t n;
+
+    if (snprintf(tmp_path, sizeof tmp_path, "%s.tmp", path) >= (int)sizeof tmp_path) {
+        printf("ERROR: calibration cache path too long\n");
+        return LGW_HAL_ERROR;
+    }
+
+    cal_cache_fill(&cache, eui, temperature, rf_chain_cfg, txgain_lut);
+
+    /* Written aside then renamed, a restart never finds a partial file */
+    f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        printf("ERROR: impossible to create calibration cache %s\n", tmp_path);
+        return LGW_HAL_ERROR;
+    }
+    n = fwrite(&cache, 1, sizeof cache, f);
+    if ((fclose(f) != 0) || (n != sizeof cache) || (rename(tmp_path, path) != 0)) {
+        printf("ERROR: failed to write calibration cache %s\n", path);
+        remove(tmp_path);
+        return LGW_HAL_ERROR;
+    }
+    DEBUG_PRINTF("INFO: radio calibration saved in %s\n", path);
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, struct lgw_tx_gain_lut_s * txgain_lut) {
     int i, j, k;
     uint8_t val;
@@ -98,6 +308,11 @@ int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, str
     bool unique_gains;
     struct lgw_sx125x_cal_rx_result_s cal_rx[CAL_ITER], cal_rx_min, cal_rx_max;
     struct lgw_sx125x_cal_tx_result_s cal_tx[CAL_ITER], cal_tx_min, cal_tx_max;
+    struct timespec start_cal, start_phase;
+    uint32_t rx_ms[LGW_RF_CHAIN_NB] = {0, 0};
+    uint32_t tx_ms[LGW_RF_CHAIN_NB] = {0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &start_cal);
 
     /* Wait for AGC fw to be started, and VERSION available in mailbox */
     sx1302_agc_wait_status(0x01); /* fw has started, VERSION is ready in mailbox */
@@ -120,6 +335,8 @@ int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, str
     /* Run Rx image calibration */
     for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
         if (rf_chain_cfg[i].enable) {
+            clock_gettime(CLOCK_MONOTONIC, &start_phase);
+
             /* Calibration using the other radio for Tx */
             if (rf_chain_cfg[0].type == rf_chain_cfg[1].type) {
                 cal_rx_result_init(&cal_rx_min, &cal_rx_max);
@@ -156,21 +373,22 @@ int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, str
                     x_max_idx = j;
                 }
             }
-            rf_rx_image_amp[i] = cal_rx[x_max_idx].amp;
-            rf_rx_image_phi[i] = cal_rx[x_max_idx].phi;
+            rf_rx_image_amp[lgw_board][i] = cal_rx[x_max_idx].amp;
+            rf_rx_image_phi[lgw_board][i] = cal_rx[x_max_idx].phi;
+            rx_ms[i] = cal_elapsed_ms(&start_phase);
 
             DEBUG_PRINTF("INFO: Rx image calibration of radio %d succeeded. Improved image rejection from %2d to %2d dB (Amp:%3d Phi:%3d)\n", i, cal_rx[x_max_idx].rej_init, cal_rx[x_max_idx].rej, cal_rx[x_max_idx].amp, cal_rx[x_max_idx].phi);
         } else {
-            rf_rx_image_amp[i] = 0;
-            rf_rx_image_phi[i] = 0;
+            rf_rx_image_amp[lgw_board][i] = 0;
+            rf_rx_image_phi[lgw_board][i] = 0;
         }
     }
 
     /* Apply calibrated IQ mismatch compensation */
-    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_AMP_COEFF_RADIO_A_AMP_COEFF, (int32_t)rf_rx_image_amp[0]);
-    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_PHI_COEFF_RADIO_A_PHI_COEFF, (int32_t)rf_rx_image_phi[0]);
-    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_AMP_COEFF_RADIO_B_AMP_COEFF, (int32_t)rf_rx_image_amp[1]);
-    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_PHI_COEFF_RADIO_B_PHI_COEFF, (int32_t)rf_rx_image_phi[1]);
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_AMP_COEFF_RADIO_A_AMP_COEFF, (int32_t)rf_rx_image_amp[lgw_board][0]);
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_PHI_COEFF_RADIO_A_PHI_COEFF, (int32_t)rf_rx_image_phi[lgw_board][0]);
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_AMP_COEFF_RADIO_B_AMP_COEFF, (int32_t)rf_rx_image_amp[lgw_board][1]);
+    lgw_reg_w(SX1302_REG_RADIO_FE_IQ_COMP_PHI_COEFF_RADIO_B_PHI_COEFF, (int32_t)rf_rx_image_phi[lgw_board][1]);
 
     /* Get List of unique combinations of DAC and mixer gains */
     for (k = 0; k < LGW_RF_CHAIN_NB; k++) {
@@ -193,6 +411,7 @@ int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, str
     /* Run Tx image calibration */
     for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
         if (rf_chain_cfg[i].tx_enable) {
+            clock_gettime(CLOCK_MONOTONIC, &start_phase);
             for (j = 0; j < nb_gains[i]; j++) {
                 cal_tx_result_init(&cal_tx_min, &cal_tx_max);
                 for (k = 0; k < CAL_ITER; k++){
@@ -222,6 +441,7 @@ int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, str
 
                 DEBUG_PRINTF("INFO: Tx DC offset calibration of radio %d for DAC gain %d and mixer gain %2d succeeded. Improved DC rejection by %2d dB (I:%4d Q:%4d)\n", i, dac_gain[i][j], mix_gain[i][j], cal_tx[x_max_idx].rej, cal_tx[x_max_idx].offset_i, cal_tx[x_max_idx].offset_q);
             }
+            tx_ms[i] = cal_elapsed_ms(&start_phase);
         }
     }
 
@@ -240,14 +460,15 @@ int sx1302_cal_start(uint8_t version, struct lgw_conf_rxrf_s * rf_chain_cfg, str
 
     printf("-------------------------------------------------------------------\n");
     printf("Radio calibration completed:\n");
-    printf("  RadioA: amp:%d phi:%d\n", rf_rx_image_amp[0], rf_rx_image_phi[0]);
-    printf("  RadioB: amp:%d phi:%d\n", rf_rx_image_amp[1], rf_rx_image_phi[1]);
+    printf("  RadioA: amp:%d phi:%d\n", rf_rx_image_amp[lgw_board][0], rf_rx_image_phi[lgw_board][0]);
+    printf("  RadioB: amp:%d phi:%d\n", rf_rx_image_amp[lgw_board][1], rf_rx_image_phi[lgw_board][1]);
     for (k = 0; k < LGW_RF_CHAIN_NB; k++) {
         printf("  TX calibration params for rf_chain %d:\n", k);
         for (i = 0; i < txgain_lut[k].size; i++) {
             printf("  -- power:%d\tdac:%u\tmix:%u\toffset_i:%d\toffset_q:%d\n", txgain_lut[k].lut[i].rf_power, txgain_lut[k].lut[i].dac_gain, txgain_lut[k].lut[i].mix_gain, txgain_lut[k].lut[i].offset_i, txgain_lut[k].lut[i].offset_q);
         }
     }
+    printf("  Duration: %u ms (RadioA rx:%u tx:%u ms, RadioB rx:%u tx:%u ms, %u+%u Tx gains)\n", cal_elapsed_ms(&start_cal), rx_ms[0], tx_ms[0], rx_ms[1], tx_ms[1], nb_gains[0], nb_gains[1]);
     printf("-------------------------------------------------------------------\n");
 
     return LGW_HAL_SUCCESS;
@@ -260,7 +481,6 @@ int sx125x_cal_rx_image(uint8_t rf_chain, uint32_t freq_hz, bool use_loopback, u
     uint32_t rx_freq_hz, tx_freq_hz;
     uint32_t rx_freq_int, rx_freq_frac;
     uint32_t tx_freq_int, tx_freq_frac;
-    uint8_t rx_pll_locked, tx_pll_locked;
     uint8_t rx_threshold = 8; /* Used by AGC to set decimation gain to increase signal and its image: value is MSB => x * 256 */
 
     printf("\n%s: rf_chain:%u, freq_hz:%u, loopback:%d, radio_type:%d\n", __FUNCTION__, rf_chain, freq_hz, use_loopback, radio_type);
@@ -293,40 +513,41 @@ int sx125x_cal_rx_image(uint8_t rf_chain, uint32_t freq_hz, bool use_loopback, u
             DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d FOR RADIO TYPE\n", radio_type);
             return LGW_HAL_ERROR;
     }
-    lgw_sx125x_reg_w(SX125x_REG_FRF_RX_MSB, 0xFF & rx_freq_int, rx);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_RX_MID, 0xFF & (rx_freq_frac >> 8), rx);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_RX_LSB, 0xFF & rx_freq_frac, rx);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_TX_MSB, 0xFF & tx_freq_int, tx);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_TX_MID, 0xFF & (tx_freq_frac >> 8), tx);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_TX_LSB, 0xFF & tx_freq_frac, tx);
-
-    /* Radio settings for calibration */
-    //sx125x_reg_w(SX125x_RX_ANA_GAIN__LNA_ZIN, 1, rx); /* Default: 1 */
-    //sx125x_reg_w(SX125x_RX_ANA_GAIN__BB_GAIN, 15, rx); /* Default: 15 */
-    //sx125x_reg_w(SX125x_RX_ANA_GAIN__LNA_GAIN, 1, rx); /* Default: 1 */
-    lgw_sx125x_reg_w(SX125x_REG_RX_BW__BB_BW, 0, rx);
-    lgw_sx125x_reg_w(SX125x_REG_RX_BW__ADC_TRIM, 6, rx);
-    //sx125x_reg_w(SX125x_RX_BW__ADC_BW, 7, rx);  /* Default: 7 */
-    lgw_sx125x_reg_w(SX125x_REG_RX_PLL_BW__PLL_BW, 0, rx);
-    lgw_sx125x_reg_w(SX125x_REG_TX_BW__PLL_BW, 0, tx);
-    //sx125x_reg_w(SX125x_TX_BW__ANA_BW, 0, tx); /* Default: 0 */
-    lgw_sx125x_reg_w(SX125x_REG_TX_DAC_BW, 5, tx);
-    //sx125x_reg_w(SX125x_CLK_SELECT__DAC_CLK_SELECT, 0, tx); /* Use internal clock, in case no Tx connection from SX1302, Default: 0  */
+    /* Radio settings for calibration, unchanged values are not written again from one step to the next */
+    struct lgw_sx125x_reg_val_s rx_regs[] = {
+        {SX125x_REG_FRF_RX_MSB, 0xFF & rx_freq_int},
+        {SX125x_REG_FRF_RX_MID, 0xFF & (rx_freq_frac >> 8)},
+        {SX125x_REG_FRF_RX_LSB, 0xFF & rx_freq_frac},
+        //{SX125x_REG_RX_ANA_GAIN__LNA_ZIN, 1}, /* Default: 1 */
+        //{SX125x_REG_RX_ANA_GAIN__BB_GAIN, 15}, /* Default: 15 */
+        //{SX125x_REG_RX_ANA_GAIN__LNA_GAIN, 1}, /* Default: 1 */
+        {SX125x_REG_RX_BW__BB_BW, 0},
+        {SX125x_REG_RX_BW__ADC_TRIM, 6},
+        //{SX125x_REG_RX_BW__ADC_BW, 7},  /* Default: 7 */
+        {SX125x_REG_RX_PLL_BW__PLL_BW, 0}
+    };
+    struct lgw_sx125x_reg_val_s tx_regs[] = {
+        {SX125x_REG_FRF_TX_MSB, 0xFF & tx_freq_int},
+        {SX125x_REG_FRF_TX_MID, 0xFF & (tx_freq_frac >> 8)},
+        {SX125x_REG_FRF_TX_LSB, 0xFF & tx_freq_frac},
+        {SX125x_REG_TX_GAIN__DAC_GAIN, 3},
+        {SX125x_REG_TX_GAIN__MIX_GAIN, (use_loopback == true) ? 10 : 15}, //8
+        {SX125x_REG_TX_BW__PLL_BW, 0},
+        //{SX125x_REG_TX_BW__ANA_BW, 0}, /* Default: 0 */
+        {SX125x_REG_TX_DAC_BW, 5},
+        //{SX125x_REG_CLK_SELECT__DAC_CLK_SELECT, 0}, /* Use internal clock, in case no Tx connection from SX1302, Default: 0  */
+        {SX125x_REG_CLK_SELECT__RF_LOOPBACK_EN, 1}
+    };
+
+    lgw_sx125x_reg_w_seq(rx_regs, ARRAY_SIZE(rx_regs), rx);
+    lgw_sx125x_reg_w_seq(tx_regs, ARRAY_SIZE(tx_regs) - ((use_loopback == true) ? 0 : 1), tx); /* loopback enabled last, if used */
     if (use_loopback == true) {
-        lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__DAC_GAIN, 3, tx);
-        lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__MIX_GAIN, 10, tx); //8
-        lgw_sx125x_reg_w(SX125x_REG_CLK_SELECT__RF_LOOPBACK_EN, 1, tx);
         lgw_sx125x_reg_w(SX125x_REG_MODE, 15, tx);
     } else {
-        lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__DAC_GAIN, 3, tx);
-        lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__MIX_GAIN, 15, tx);
         lgw_sx125x_reg_w(SX125x_REG_MODE, 3, rx);
         lgw_sx125x_reg_w(SX125x_REG_MODE, 13, tx);
     }
-    wait_ms(10);
-    lgw_sx125x_reg_r(SX125x_REG_MODE_STATUS__RX_PLL_LOCKED, &rx_pll_locked, rx);
-    lgw_sx125x_reg_r(SX125x_REG_MODE_STATUS__TX_PLL_LOCKED, &tx_pll_locked, tx);
-    if ((rx_pll_locked == 0) || (tx_pll_locked == 0)) {
+    if (cal_wait_pll_lock(rx, tx, CAL_RX_PLL_TIMEOUT_MS) == false) {
         DEBUG_MSG("ERROR: PLL failed to lock\n");
         return LGW_HAL_ERROR;
     }
@@ -414,7 +635,6 @@ int sx125x_cal_tx_dc_offset(uint8_t rf_chain, uint32_t freq_hz, uint8_t dac_gain
     uint32_t rx_freq_hz, tx_freq_hz;
     uint32_t rx_freq_int, rx_freq_frac;
     uint32_t tx_freq_int, tx_freq_frac;
-    uint8_t rx_pll_locked, tx_pll_locked;
     uint16_t reg;
     uint8_t tx_threshold = 64;
     int i;
@@ -441,33 +661,33 @@ int sx125x_cal_tx_dc_offset(uint8_t rf_chain, uint32_t freq_hz, uint8_t dac_gain
             DEBUG_PRINTF("ERROR: UNEXPECTED VALUE %d FOR RADIO TYPE\n", radio_type);
             return LGW_HAL_ERROR;
     }
-    lgw_sx125x_reg_w(SX125x_REG_FRF_RX_MSB, 0xFF & rx_freq_int, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_RX_MID, 0xFF & (rx_freq_frac >> 8), rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_RX_LSB, 0xFF & rx_freq_frac, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_TX_MSB, 0xFF & tx_freq_int, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_TX_MID, 0xFF & (tx_freq_frac >> 8), rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_FRF_TX_LSB, 0xFF & tx_freq_frac, rf_chain);
-
-    /* Radio settings for calibration */
-    //lgw_sx125x_reg_w(SX125x_RX_ANA_GAIN__LNA_ZIN, 1, rf_chain); /* Default: 1 */
-    //lgw_sx125x_reg_w(SX125x_RX_ANA_GAIN__BB_GAIN, 15, rf_chain); /* Default: 15 */
-    //lgw_sx125x_reg_w(SX125x_RX_ANA_GAIN__LNA_GAIN, 1, rf_chain); /* Default: 1 */
-    lgw_sx125x_reg_w(SX125x_REG_RX_BW__BB_BW, 0, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_RX_BW__ADC_TRIM, 6, rf_chain);
-    //lgw_sx125x_reg_w(SX125x_RX_BW__ADC_BW, 7, rf_chain);  /* Default: 7 */
-    lgw_sx125x_reg_w(SX125x_REG_RX_PLL_BW__PLL_BW, 0, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_TX_BW__PLL_BW, 0, rf_chain);
-    //lgw_sx125x_reg_w(SX125x_TX_BW__ANA_BW, 0, rf_chain); /* Default: 0 */
-    lgw_sx125x_reg_w(SX125x_REG_TX_DAC_BW, 5, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_CLK_SELECT__DAC_CLK_SELECT, 1, rf_chain); /* Use external clock from SX1302 */
-    lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__DAC_GAIN, dac_gain, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__MIX_GAIN, mix_gain, rf_chain);
-    lgw_sx125x_reg_w(SX125x_REG_CLK_SELECT__RF_LOOPBACK_EN, 1, rf_chain);
+    /* Radio settings for calibration, unchanged values are not written again from one gain to the next */
+    struct lgw_sx125x_reg_val_s regs[] = {
+        {SX125x_REG_FRF_RX_MSB, 0xFF & rx_freq_int},
+        {SX125x_REG_FRF_RX_MID, 0xFF & (rx_freq_frac >> 8)},
+        {SX125x_REG_FRF_RX_LSB, 0xFF & rx_freq_frac},
+        {SX125x_REG_FRF_TX_MSB, 0xFF & tx_freq_int},
+        {SX125x_REG_FRF_TX_MID, 0xFF & (tx_freq_frac >> 8)},
+        {SX125x_REG_FRF_TX_LSB, 0xFF & tx_freq_frac},
+        {SX125x_REG_TX_GAIN__DAC_GAIN, dac_gain},
+        {SX125x_REG_TX_GAIN__MIX_GAIN, mix_gain},
+        //{SX125x_REG_TX_BW__ANA_BW, 0}, /* Default: 0 */
+        {SX125x_REG_TX_BW__PLL_BW, 0},
+        {SX125x_REG_TX_DAC_BW, 5},
+        //{SX125x_REG_RX_ANA_GAIN__LNA_ZIN, 1}, /* Default: 1 */
+        //{SX125x_REG_RX_ANA_GAIN__BB_GAIN, 15}, /* Default: 15 */
+        //{SX125x_REG_RX_ANA_GAIN__LNA_GAIN, 1}, /* Default: 1 */
+        {SX125x_REG_RX_BW__BB_BW, 0},
+        {SX125x_REG_RX_BW__ADC_TRIM, 6},
+        //{SX125x_REG_RX_BW__ADC_BW, 7},  /* Default: 7 */
+        {SX125x_REG_RX_PLL_BW__PLL_BW, 0},
+        {SX125x_REG_CLK_SELECT__DAC_CLK_SELECT, 1}, /* Use external clock from SX1302 */
+        {SX125x_REG_CLK_SELECT__RF_LOOPBACK_EN, 1}
+    };
+
+    lgw_sx125x_reg_w_seq(regs, ARRAY_SIZE(regs), rf_chain);
     lgw_sx125x_reg_w(SX125x_REG_MODE, 15, rf_chain);
-    wait_ms(1);
-    lgw_sx125x_reg_r(SX125x_REG_MODE_STATUS__RX_PLL_LOCKED, &rx_pll_locked, rf_chain);
-    lgw_sx125x_reg_r(SX125x_REG_MODE_STATUS__TX_PLL_LOCKED, &tx_pll_locked, rf_chain);
-    if ((rx_pll_locked == 0) || (tx_pll_locked == 0)) {
+    if (cal_wait_pll_lock(rf_chain, rf_chain, CAL_TX_PLL_TIMEOUT_MS) == false) {
         DEBUG_MSG("ERROR: PLL failed to lock\n");
         return LGW_HAL_ERROR;
     }
@@ -493,7 +713,7 @@ int sx125x_cal_tx_dc_offset(uint8_t rf_chain, uint32_t freq_hz, uint8_t dac_gain
 #if TX_CALIB_DONE_BY_HAL /* For debug */
 
     lgw_reg_w(SX1302_REG_RADIO_FE_SIG_ANA_CFG_FORCE_HAL_CTRL, 1);
-    agc_cal_tx_dc_offset(rf_chain, CAL_TX_TONE_FREQ_HZ * 64e-6, rf_rx_image_amp[rf_chain], rf_rx_image_phi[rf_chain], tx_threshold, 0, &(res->offset_i), &(res->offset_q), &(res->rej));
+    agc_cal_tx_dc_offset(rf_chain, CAL_TX_TONE_FREQ_HZ * 64e-6, rf_rx_image_amp[lgw_board][rf_chain], rf_rx_image_phi[lgw_board][rf_chain], tx_threshold, 0, &(res->offset_i), &(res->offset_q), &(res->rej));
     lgw_reg_w(SX1302_REG_RADIO_FE_SIG_ANA_CFG_FORCE_HAL_CTRL, 0);
 
 #else
@@ -507,8 +727,8 @@ int sx125x_cal_tx_dc_offset(uint8_t rf_chain, uint32_t freq_hz, uint8_t dac_gain
     sx1302_agc_mailbox_write(3, 0x01); /* sync */
     sx1302_agc_wait_status(0x01);
 
-    sx1302_agc_mailbox_write(2, rf_rx_image_amp[rf_chain]); /* amp */
-    sx1302_agc_mailbox_write(1, rf_rx_image_phi[rf_chain]); /* phi */
+    sx1302_agc_mailbox_write(2, rf_rx_image_amp[lgw_board][rf_chain]); /* amp */
+    sx1302_agc_mailbox_write(1, rf_rx_image_phi[lgw_board][rf_chain]); /* phi */
 
     sx1302_agc_mailbox_write(3, 0x02); /* sync */
     sx1302_agc_wait_status(0x02);
@@ -550,35 +770,29 @@ int sx125x_cal_tx_dc_offset(uint8_t rf_chain, uint32_t freq_hz, uint8_t dac_gain
     sx1302_agc_mailbox_write(3, 0x07); /* sync */
 
     /* -----------------------------------------------*/
-    /* DEBUG: Get IQ offsets selected for iterations */
-    uint8_t index[12];
-
-    sx1302_agc_wait_status(0x08);
-    sx1302_agc_mailbox_read(3, &index[0]);
-    sx1302_agc_mailbox_read(2, &index[1]);
-    sx1302_agc_mailbox_read(1, &index[2]);
-    sx1302_agc_mailbox_read(0, &index[3]);
-    sx1302_agc_mailbox_write(3, 0x08); /* sync */
-
-    sx1302_agc_wait_status(0x09);
-    sx1302_agc_mailbox_read(3, &index[4]);
-    sx1302_agc_mailbox_read(2, &index[5]);
-    sx1302_agc_mailbox_read(1, &index[6]);
-    sx1302_agc_mailbox_read(0, &index[7]);
-    sx1302_agc_mailbox_write(3, 0x09); /* sync */
-
-    sx1302_agc_wait_status(0x0a);
-    sx1302_agc_mailbox_read(3, &index[8]);
-    sx1302_agc_mailbox_read(2, &index[9]);
-    sx1302_agc_mailbox_read(1, &index[10]);
-    sx1302_agc_mailbox_read(0, &index[11]);
-    sx1302_agc_mailbox_write(3, 0x0a); /* sync */
-
+    /* DEBUG: Get IQ offsets selected for iterations and TX_SIG returned by signal analyzer.
+       The fw waits for each step to be acknowledged, mailboxes are only read when debugging. */
 #if DEBUG_CAL == 1
+    uint8_t index[12];
+    uint8_t msb[40];
+    uint8_t lsb[40];
     int16_t lut_calib[9] = {64, 43, 28, 19, 13, 8, 6, 4, 2};
     int16_t offset_i_tmp = 0;
     int16_t offset_q_tmp = 0;
+#endif /* DEBUG_CAL */
 
+    for (i = 0; i < 3; i++) {
+        sx1302_agc_wait_status(0x08 + i);
+#if DEBUG_CAL == 1
+        sx1302_agc_mailbox_read(3, &index[4*i]);
+        sx1302_agc_mailbox_read(2, &index[4*i+1]);
+        sx1302_agc_mailbox_read(1, &index[4*i+2]);
+        sx1302_agc_mailbox_read(0, &index[4*i+3]);
+#endif /* DEBUG_CAL */
+        sx1302_agc_mailbox_write(3, 0x08 + i); /* sync */
+    }
+
+#if DEBUG_CAL == 1
     printf("IQ sequence:");
     for (i = 0; i < 9; i++) {
         if (index[i] == 0) {
@@ -601,21 +815,16 @@ int sx125x_cal_tx_dc_offset(uint8_t rf_chain, uint32_t freq_hz, uint8_t dac_gain
         printf("i:%d q:%d\n", offset_i_tmp, offset_q_tmp);
     }
     printf("\n");
-
 #endif /* DEBUG_CAL */
-    /* -----------------------------------------------*/
-
-    /* -----------------------------------------------*/
-    /* DEBUG: Get TX_SIG returned by siognal analyzer */
-    uint8_t msb[40];
-    uint8_t lsb[40];
 
     for (i = 0; i < 20; i++) {
         sx1302_agc_wait_status(0x0c + i);
+#if DEBUG_CAL == 1
         sx1302_agc_mailbox_read(3, &msb[2*i]);
         sx1302_agc_mailbox_read(2, &lsb[2*i]);
         sx1302_agc_mailbox_read(1, &msb[2*i+1]);
         sx1302_agc_mailbox_read(0, &lsb[2*i+1]);
+#endif /* DEBUG_CAL */
         sx1302_agc_mailbox_write(3, 0x0c + i); /* sync */
     }
     sx1302_agc_wait_status(0x0c + 20);
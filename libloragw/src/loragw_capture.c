@@ -0,0 +1,450 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Capture of the SX1302 RX buffer content to a file, and "replay" transport
+    streaming a capture back through the RX buffer FIFO, to run the HAL and its
+    applications on recorded traffic without a concentrator.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <stdio.h>      /* printf fprintf fopen fread fwrite */
+#include <stdlib.h>     /* strtod */
+#include <string.h>     /* memset, memcpy, strrchr */
+#include <time.h>       /* clock_gettime */
+
+#include "loragw_capture.h"
+#include "loragw_com.h"
+#include "loragw_reg.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_SPI == 1
+    #define DEBUG_MSG(str)                fprintf(stderr, str)
+    #define DEBUG_PRINTF(fmt, args...)    fprintf(stderr,"%s:%d: "fmt, __FUNCTION__, __LINE__, args)
+    #define CHECK_NULL(a)                if(a==NULL){fprintf(stderr,"%s:%d: ERROR: NULL POINTER AS ARGUMENT\n", __FUNCTION__, __LINE__);return LGW_CAPTURE_ERROR;}
+#else
+    #define DEBUG_MSG(str)
+    #define DEBUG_PRINTF(fmt, args...)
+    #define CHECK_NULL(a)                if(a==NULL){return LGW_CAPTURE_ERROR;}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define REPLAY_MEM_SIZE         0x10000 /* SX1302 address space */
+#define REPLAY_RX_BUFFER_ADDR   0x4000  /* SX1302 RX buffer, read in FIFO mode */
+#define REPLAY_PATH_SIZE        128
+
+/* bytes clocked on top of the data by loragw_spi: mux target, address, read dummy byte */
+#define REPLAY_CMD_SIZE_WRITE   3
+#define REPLAY_CMD_SIZE_READ    4
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+extern const struct lgw_reg_s loregs[LGW_TOTALREGS+1];
+
+/* capture */
+static FILE * capture_file = NULL;
+static struct timespec capture_time;        /* time of the last record */
+
+/* replay */
+static FILE * replay_file = NULL;
+static int replay_device = -1;              /* passed as the link target, only checked for NULL */
+static double replay_speed = 1.0;           /* 0 to release the records as soon as the host asks */
+static struct timespec replay_start;
+static double replay_due_us = 0.0;          /* release time of the next record, from replay_start */
+static uint32_t replay_nb_records = 0;
+
+static uint8_t replay_mem[REPLAY_MEM_SIZE]; /* SX1302 registers and memories written by the host */
+
+static uint8_t rec_cur[LGW_CAPTURE_RECORD_MAX];     /* record being read by the host */
+static uint16_t rec_cur_size = 0;
+static uint16_t rec_cur_rd = 0;
+static uint8_t rec_next[LGW_CAPTURE_RECORD_MAX];    /* record waiting for its release time */
+static uint16_t rec_next_size = 0;
+static bool rec_next_valid = false;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static double elapsed_us(const struct timespec * from) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double)(now.tv_sec - from->tv_sec) * 1E6) + ((double)(now.tv_nsec - from->tv_nsec) / 1E3);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void replay_load_next(void) {
+    uint8_t head[LGW_CAPTURE_RECORD_HEAD];
+    uint32_t delay_us;
+
+    rec_next_valid = false;
+    if (replay_file == NULL) {
+        return;
+    }
+
+    if (fread(head, 1, sizeof head, replay_file) != sizeof head) {
+        printf("INFO: end of RX capture replay, %u records\n", replay_nb_records);
+        fclose(replay_file);
+        replay_file = NULL;
+        return;
+    }
+    delay_us = (uint32_t)head[0] | ((uint32_t)head[1] << 8) | ((uint32_t)head[2] << 16) | ((uint32_t)head[3] << 24);
+    rec_next_size = (uint16_t)head[4] | ((uint16_t)head[5] << 8);
+    if ((rec_next_size == 0) || (rec_next_size > LGW_CAPTURE_RECORD_MAX) || (fread(rec_next, 1, rec_next_size, replay_file) != rec_next_size)) {
+        printf("ERROR: corrupted RX capture record %u, replay stopped\n", replay_nb_records);
+        fclose(replay_file);
+        replay_file = NULL;
+        return;
+    }
+
+    if (replay_speed > 0.0) {
+        replay_due_us += (double)delay_us / replay_speed;
+    }
+    rec_next_valid = true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint16_t replay_rx_level(bool refresh) {
+    /* the next record is only released once the previous one has been read entirely */
+    if ((refresh == true) && (rec_cur_rd == rec_cur_size) && (rec_next_valid == true) && (elapsed_us(&replay_start) >= replay_due_us)) {
+        memcpy(rec_cur, rec_next, rec_next_size);
+        rec_cur_size = rec_next_size;
+        rec_cur_rd = 0;
+        replay_nb_records += 1;
+        replay_load_next();
+    }
+
+    return rec_cur_size - rec_cur_rd;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint8_t replay_mem_read(uint16_t address) {
+    /* the RX buffer fill level is computed from the records, refreshed when its MSB is read first */
+    if (address == loregs[SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES].addr) {
+        return (uint8_t)(replay_rx_level(true) >> 8);
+    }
+    if (address == loregs[SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_LSB_RX_BUFFER_NB_BYTES].addr) {
+        return (uint8_t)(replay_rx_level(false) >> 0);
+    }
+
+    return replay_mem[address];
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void replay_mem_burst_read(uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, bool fifo_mode) {
+    uint16_t nb;
+    int i;
+
+    /* radios are not modelled */
+    if (spi_mux_target != LGW_SPI_MUX_TARGET_SX1302) {
+        memset(data, 0, size);
+        return;
+    }
+
+    /* host reading the packets: consume the current record, the SX1302 sends zeros once it is empty */
+    if ((address == REPLAY_RX_BUFFER_ADDR) && (fifo_mode == true)) {
+        nb = replay_rx_level(false);
+        nb = (size < nb) ? size : nb;
+        memcpy(data, &rec_cur[rec_cur_rd], nb);
+        memset(&data[nb], 0, size - nb);
+        rec_cur_rd += nb;
+        return;
+    }
+
+    for (i = 0; i < size; i++) {
+        data[i] = replay_mem_read((uint16_t)(address + (fifo_mode ? 0 : i)));
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void replay_mem_burst_write(uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size) {
+    int i;
+
+    if (spi_mux_target != LGW_SPI_MUX_TARGET_SX1302) {
+        return;
+    }
+    for (i = 0; i < size; i++) {
+        replay_mem[(uint16_t)(address + i)] = data[i];
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_open(const char * path, void **com_target_ptr) {
+    char file_path[REPLAY_PATH_SIZE];
+    uint8_t header[LGW_CAPTURE_HEADER_SIZE];
+    char * sep;
+
+    /* check input variables */
+    CHECK_NULL(path);
+    CHECK_NULL(com_target_ptr);
+
+    if (replay_file != NULL) {
+        fclose(replay_file);
+        replay_file = NULL;
+    }
+
+    /* "file@speed" */
+    strncpy(file_path, path, sizeof file_path);
+    file_path[sizeof file_path - 1] = '\0'; /* ensure string termination */
+    replay_speed = 1.0;
+    sep = strrchr(file_path, LGW_REPLAY_SPEED_SEP);
+    if (sep != NULL) {
+        *sep = '\0';
+        replay_speed = strtod(sep + 1, NULL);
+        if (replay_speed < 0.0) {
+            printf("ERROR: invalid RX capture replay speed %s\n", sep + 1);
+            return LGW_CAPTURE_ERROR;
+        }
+    }
+
+    replay_file = fopen(file_path, "rb");
+    if (replay_file == NULL) {
+        printf("ERROR: failed to open RX capture %s\n", file_path);
+        return LGW_CAPTURE_ERROR;
+    }
+    if ((fread(header, 1, sizeof header, replay_file) != sizeof header) || (memcmp(header, LGW_CAPTURE_MAGIC, LGW_CAPTURE_MAGIC_SIZE) != 0) || (header[LGW_CAPTURE_MAGIC_SIZE] != LGW_CAPTURE_VERSION)) {
+        printf("ERROR: %s is not a supported RX capture\n", file_path);
+        fclose(replay_file);
+        replay_file = NULL;
+        return LGW_CAPTURE_ERROR;
+    }
+
+    /* chip as after reset, expected by lgw_connect */
+    memset(replay_mem, 0, sizeof replay_mem);
+    replay_mem[loregs[SX1302_REG_COMMON_VERSION_VERSION].addr] = (uint8_t)loregs[SX1302_REG_COMMON_VERSION_VERSION].dflt;
+
+    rec_cur_size = 0;
+    rec_cur_rd = 0;
+    replay_nb_records = 0;
+    replay_due_us = 0.0;
+    clock_gettime(CLOCK_MONOTONIC, &replay_start);
+    replay_load_next();
+
+    if (replay_speed > 0.0) {
+        printf("INFO: replaying RX capture %s, %.1f times the recorded rate\n", file_path, replay_speed);
+    } else {
+        printf("INFO: replaying RX capture %s, as fast as fetched\n", file_path);
+    }
+
+    *com_target_ptr = (void *)&replay_device;
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_close(void *com_target) {
+    CHECK_NULL(com_target);
+
+    if (replay_file != NULL) {
+        fclose(replay_file);
+        replay_file = NULL;
+    }
+    rec_next_valid = false;
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t replay_get_msg_size_max(void) {
+    return LGW_CAPTURE_RECORD_MAX;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_w(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t data) {
+    CHECK_NULL(com_target);
+
+    replay_mem_burst_write(spi_mux_target, address, &data, 1);
+    lgw_com_account(spi_mux_target, LGW_SPI_OP_WRITE, REPLAY_CMD_SIZE_WRITE + 1, 0, false);
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_r(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data) {
+    CHECK_NULL(com_target);
+    CHECK_NULL(data);
+
+    replay_mem_burst_read(spi_mux_target, address, data, 1, false);
+    lgw_com_account(spi_mux_target, LGW_SPI_OP_READ, REPLAY_CMD_SIZE_READ + 1, 0, false);
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_wb(void *com_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size) {
+    CHECK_NULL(com_target);
+    CHECK_NULL(data);
+
+    replay_mem_burst_write(spi_mux_target, address, data, size);
+    lgw_com_account(spi_mux_target, LGW_SPI_OP_WRITE_BURST, REPLAY_CMD_SIZE_WRITE + size, 0, false);
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_rb(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size) {
+    CHECK_NULL(com_target);
+    CHECK_NULL(data);
+
+    replay_mem_burst_read(spi_mux_target, address, data, size, false);
+    lgw_com_account(spi_mux_target, LGW_SPI_OP_READ_BURST, REPLAY_CMD_SIZE_READ + size, 0, false);
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_rb_chunks(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, uint16_t chunk_size, bool fifo_mode) {
+    (void)chunk_size; /* no buffer limit, a single message */
+
+    CHECK_NULL(com_target);
+    CHECK_NULL(data);
+
+    replay_mem_burst_read(spi_mux_target, address, data, size, fifo_mode);
+    lgw_com_account(spi_mux_target, LGW_SPI_OP_READ_BURST, REPLAY_CMD_SIZE_READ + size, 0, false);
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int replay_xfer(void *com_target, lgw_spi_op_t op, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size) {
+    CHECK_NULL(com_target);
+    CHECK_NULL(tx_data);
+
+    /* radio commands are not modelled, reads return zeros */
+    if (rx_data != NULL) {
+        memset(rx_data, 0, size);
+    }
+    lgw_com_account(tx_data[0], op, size, 0, false);
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
+
+const struct lgw_com_s lgw_replay_com = {
+    .name = "replay",
+    .simulated = true,
+    .open = replay_open,
+    .close = replay_close,
+    .set_speed = NULL,
+    .get_msg_size_max = replay_get_msg_size_max,
+    .w = replay_w,
+    .r = replay_r,
+    .wb = replay_wb,
+    .rb = replay_rb,
+    .wb_chunks = NULL,
+    .rb_chunks = replay_rb_chunks,
+    .wb_multi = NULL,
+    .xfer = replay_xfer
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lgw_capture_start(const char * path) {
+    uint8_t header[LGW_CAPTURE_HEADER_SIZE];
+
+    /* check input variables */
+    CHECK_NULL(path);
+
+    lgw_capture_stop();
+
+    capture_file = fopen(path, "wb");
+    if (capture_file == NULL) {
+        printf("ERROR: failed to create RX capture %s\n", path);
+        return LGW_CAPTURE_ERROR;
+    }
+    memcpy(header, LGW_CAPTURE_MAGIC, LGW_CAPTURE_MAGIC_SIZE);
+    header[LGW_CAPTURE_MAGIC_SIZE] = LGW_CAPTURE_VERSION;
+    if (fwrite(header, 1, sizeof header, capture_file) != sizeof header) {
+        printf("ERROR: failed to write RX capture %s\n", path);
+        lgw_capture_stop();
+        return LGW_CAPTURE_ERROR;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &capture_time);
+
+    printf("INFO: capturing RX buffer content to %s\n", path);
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_capture_stop(void) {
+    if (capture_file != NULL) {
+        fclose(capture_file);
+        capture_file = NULL;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_capture_write(const uint8_t * data, uint16_t size) {
+    uint8_t head[LGW_CAPTURE_RECORD_HEAD];
+    struct timespec now;
+    int64_t delay_us;
+    uint32_t d;
+
+    if ((capture_file == NULL) || (size == 0)) {
+        return LGW_CAPTURE_SUCCESS;
+    }
+    CHECK_NULL(data);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    delay_us = ((int64_t)(now.tv_sec - capture_time.tv_sec) * 1000000) + ((now.tv_nsec - capture_time.tv_nsec) / 1000);
+    capture_time = now;
+    d = (delay_us < (int64_t)UINT32_MAX) ? (uint32_t)delay_us : UINT32_MAX;
+
+    head[0] = (uint8_t)(d >> 0);
+    head[1] = (uint8_t)(d >> 8);
+    head[2] = (uint8_t)(d >> 16);
+    head[3] = (uint8_t)(d >> 24);
+    head[4] = (uint8_t)(size >> 0);
+    head[5] = (uint8_t)(size >> 8);
+    if ((fwrite(head, 1, sizeof head, capture_file) != sizeof head) || (fwrite(data, 1, size, capture_file) != size)) {
+        printf("ERROR: failed to write RX capture record, capture stopped\n");
+        lgw_capture_stop();
+        return LGW_CAPTURE_ERROR;
+    }
+
+    return LGW_CAPTURE_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,318 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Transport layer between the register layer and the LoRa concentrator.
+    The Linux spidev and RX capture replay transports are built in, other
+    transports (SPI bridges, simulation) can be registered by the application
+    and are selected by a prefix in the connection path.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <stdio.h>      /* printf fprintf */
+#include <string.h>     /* memset, strlen, strncmp */
+
+#include "loragw_com.h"
+#include "loragw_hal.h"  /* LGW_BOARD_NB */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_SPI == 1
+    #define DEBUG_MSG(str)                fprintf(stderr, str)
+    #define DEBUG_PRINTF(fmt, args...)    fprintf(stderr,"%s:%d: "fmt, __FUNCTION__, __LINE__, args)
+    #define CHECK_NULL(a)                if(a==NULL){fprintf(stderr,"%s:%d: ERROR: NULL POINTER AS ARGUMENT\n", __FUNCTION__, __LINE__);return LGW_COM_ERROR;}
+#else
+    #define DEBUG_MSG(str)
+    #define DEBUG_PRINTF(fmt, args...)
+    #define CHECK_NULL(a)                if(a==NULL){return LGW_COM_ERROR;}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+/* bytes sent before the data of a burst: mux target, address, dummy byte of a read */
+#define COM_CMD_SIZE_READ   4
+
+/* -------------------------------------------------------------------------- */
+/* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
+
+extern const struct lgw_com_s lgw_spi_com;
+extern const struct lgw_com_s lgw_replay_com;
+
+extern __thread lgw_handle_t lgw_board;
+
+uint32_t lgw_com_nb_transfers[LGW_BOARD_NB]; /* number of messages sent to each board since the library was loaded, wraps */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static const struct lgw_com_s * const com_builtin[] = { &lgw_spi_com, &lgw_replay_com };
+static const struct lgw_com_s * com_registered[LGW_COM_NB_MAX];
+static const struct lgw_com_s * com[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = &lgw_spi_com }; /* transport of the link opened, or the last one */
+
+/* Traffic counters of each board, updated under the register layer lock (see lgw_reg_lock) */
+static struct lgw_spi_stats_s com_stats[LGW_BOARD_NB];
+static const uint32_t com_lat_bins_us[LGW_SPI_LAT_BIN_NB - 1] = LGW_SPI_LAT_BINS_US;
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lgw_com_register(const struct lgw_com_s * c) {
+    int i;
+
+    /* check input variables */
+    CHECK_NULL(c);
+    CHECK_NULL(c->name);
+    if ((c->open == NULL) || (c->close == NULL) || (c->get_msg_size_max == NULL) || (c->w == NULL) ||
+        (c->r == NULL) || (c->wb == NULL) || (c->rb == NULL) || (c->xfer == NULL)) {
+        DEBUG_PRINTF("ERROR: TRANSPORT %s IS MISSING MANDATORY OPERATIONS\n", c->name);
+        return LGW_COM_ERROR;
+    }
+    for (i = 0; i < (int)(sizeof com_builtin / sizeof com_builtin[0]); i++) {
+        if (strcmp(c->name, com_builtin[i]->name) == 0) {
+            DEBUG_PRINTF("ERROR: TRANSPORT NAME %s IS RESERVED\n", c->name);
+            return LGW_COM_ERROR;
+        }
+    }
+
+    for (i = 0; i < LGW_COM_NB_MAX; i++) {
+        if (com_registered[i] == c) {
+            return LGW_COM_SUCCESS;
+        }
+        if ((com_registered[i] != NULL) && (strcmp(com_registered[i]->name, c->name) == 0)) {
+            DEBUG_PRINTF("ERROR: TRANSPORT %s ALREADY REGISTERED\n", c->name);
+            return LGW_COM_ERROR;
+        }
+    }
+    for (i = 0; i < LGW_COM_NB_MAX; i++) {
+        if (com_registered[i] == NULL) {
+            com_registered[i] = c;
+            return LGW_COM_SUCCESS;
+        }
+    }
+
+    DEBUG_MSG("ERROR: NO ROOM LEFT TO REGISTER A TRANSPORT\n");
+    return LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_open(const char * com_path, void **com_target_ptr) {
+    const char * path = com_path;
+    const char * sep;
+    size_t name_len;
+    int i;
+
+    /* check input variables */
+    CHECK_NULL(com_path);
+    CHECK_NULL(com_target_ptr);
+
+    /* "name:path" selects a transport, device paths without a known prefix are spidev ones */
+    com[lgw_board] = &lgw_spi_com;
+    sep = strchr(com_path, LGW_COM_PATH_SEP);
+    if (sep != NULL) {
+        name_len = (size_t)(sep - com_path);
+        for (i = 0; i < (int)(sizeof com_builtin / sizeof com_builtin[0]); i++) {
+            if ((strlen(com_builtin[i]->name) == name_len) && (strncmp(com_path, com_builtin[i]->name, name_len) == 0)) {
+                com[lgw_board] = com_builtin[i];
+                path = sep + 1;
+            }
+        }
+        for (i = 0; i < LGW_COM_NB_MAX; i++) {
+            if ((com_registered[i] != NULL) && (strlen(com_registered[i]->name) == name_len) && (strncmp(com_path, com_registered[i]->name, name_len) == 0)) {
+                com[lgw_board] = com_registered[i];
+                path = sep + 1;
+                break;
+            }
+        }
+    }
+    DEBUG_PRINTF("Note: opening %s with the %s transport\n", path, com[lgw_board]->name);
+
+    return (com[lgw_board]->open(path, com_target_ptr) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_close(void *com_target) {
+    return (com[lgw_board]->close(com_target) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+const char * lgw_com_name(void) {
+    return com[lgw_board]->name;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+bool lgw_com_simulated(void) {
+    return com[lgw_board]->simulated;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_set_speed(void *com_target, uint32_t speed_hz) {
+    if (com[lgw_board]->set_speed == NULL) {
+        DEBUG_PRINTF("Note: %s transport has a fixed clock\n", com[lgw_board]->name);
+        return LGW_COM_SUCCESS;
+    }
+    return (com[lgw_board]->set_speed(com_target, speed_hz) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint32_t lgw_com_get_msg_size_max(void) {
+    return com[lgw_board]->get_msg_size_max();
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_w(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t data) {
+    return (com[lgw_board]->w(com_target, spi_mux_target, address, data) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_r(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data) {
+    return (com[lgw_board]->r(com_target, spi_mux_target, address, data) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_wb(void *com_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size) {
+    return (com[lgw_board]->wb(com_target, spi_mux_target, address, data, size) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_rb(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size) {
+    return (com[lgw_board]->rb(com_target, spi_mux_target, address, data, size) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_wb_chunks(void *com_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size, uint16_t chunk_size) {
+    uint16_t offset, size_to_do;
+
+    if (com[lgw_board]->wb_chunks != NULL) {
+        return (com[lgw_board]->wb_chunks(com_target, spi_mux_target, address, data, size, chunk_size) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+    }
+
+    /* one burst per chunk */
+    CHECK_NULL(data);
+    if (chunk_size == 0) {
+        chunk_size = (uint16_t)(com[lgw_board]->get_msg_size_max() - COM_CMD_SIZE_READ);
+    }
+    for (offset = 0; offset < size; offset += size_to_do) {
+        size_to_do = ((size - offset) < chunk_size) ? (size - offset) : chunk_size;
+        if (com[lgw_board]->wb(com_target, spi_mux_target, address + offset, data + offset, size_to_do) != 0) {
+            return LGW_COM_ERROR;
+        }
+    }
+
+    return LGW_COM_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_rb_chunks(void *com_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, uint16_t chunk_size, bool fifo_mode) {
+    uint16_t offset, size_to_do;
+
+    if (com[lgw_board]->rb_chunks != NULL) {
+        return (com[lgw_board]->rb_chunks(com_target, spi_mux_target, address, data, size, chunk_size, fifo_mode) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+    }
+
+    /* one burst per chunk, always from the same address in FIFO mode */
+    CHECK_NULL(data);
+    if (chunk_size == 0) {
+        chunk_size = (uint16_t)(com[lgw_board]->get_msg_size_max() - COM_CMD_SIZE_READ);
+    }
+    for (offset = 0; offset < size; offset += size_to_do) {
+        size_to_do = ((size - offset) < chunk_size) ? (size - offset) : chunk_size;
+        if (com[lgw_board]->rb(com_target, spi_mux_target, fifo_mode ? address : (address + offset), data + offset, size_to_do) != 0) {
+            return LGW_COM_ERROR;
+        }
+    }
+
+    return LGW_COM_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_wb_multi(void *com_target, uint8_t spi_mux_target, const struct lgw_spi_burst_s *bursts, uint16_t nb_bursts) {
+    int i;
+
+    if (com[lgw_board]->wb_multi != NULL) {
+        return (com[lgw_board]->wb_multi(com_target, spi_mux_target, bursts, nb_bursts) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+    }
+
+    /* one burst after the other */
+    CHECK_NULL(bursts);
+    for (i = 0; i < nb_bursts; i++) {
+        if (com[lgw_board]->wb(com_target, spi_mux_target, bursts[i].address, bursts[i].data, bursts[i].size) != 0) {
+            return LGW_COM_ERROR;
+        }
+    }
+
+    return LGW_COM_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_com_xfer(void *com_target, lgw_spi_op_t op, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size) {
+    return (com[lgw_board]->xfer(com_target, op, tx_data, rx_data, size) == 0) ? LGW_COM_SUCCESS : LGW_COM_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_com_account(uint8_t spi_mux_target, lgw_spi_op_t op, uint32_t bytes, uint32_t latency_us, bool error) {
+    struct lgw_spi_op_stats_s *st;
+    int i;
+
+    lgw_com_nb_transfers[lgw_board] += 1;
+    if ((spi_mux_target >= LGW_SPI_MUX_TARGET_NB) || (op >= LGW_SPI_OP_NB)) {
+        return;
+    }
+
+    st = &com_stats[lgw_board].target[spi_mux_target][op];
+    st->transfers += 1;
+    if (error == true) {
+        st->errors += 1;
+    }
+    st->bytes += bytes;
+    st->latency_sum_us += latency_us;
+    if (latency_us > st->latency_max_us) {
+        st->latency_max_us = latency_us;
+    }
+    i = 0;
+    while ((i < (LGW_SPI_LAT_BIN_NB - 1)) && (latency_us >= com_lat_bins_us[i])) {
+        i++;
+    }
+    st->latency_hist[i] += 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_com_get_stats(struct lgw_spi_stats_s *stats, bool reset) {
+    if (stats != NULL) {
+        *stats = com_stats[lgw_board];
+    }
+    if (reset == true) {
+        memset(&com_stats[lgw_board], 0, sizeof com_stats[lgw_board]);
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -21,6 +21,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <stdio.h>      /* printf fprintf */
 #include <string.h>     /* memcmp */
 #include <time.h>
+#include <pthread.h>
 
 #include "loragw_aux.h"
 #include "loragw_reg.h"
@@ -38,17 +39,117 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE CONSTANTS & TYPES -------------------------------------------- */
 
+#define DBG_CHECK_RING_SIZE     256     /* received payloads waiting to be checked, power of 2 */
+#define DBG_REF_PAYLOAD_NB      16      /* size of lgw_conf_debug_s.ref_payload */
+
+struct dbg_check_s {
+    uint8_t payload[255];
+    uint8_t size;
+    uint8_t sf;
+};
+
+/* Aggregated results of the payload checks, per reference payload */
+struct dbg_check_stats_s {
+    uint32_t nb_ok;
+    uint32_t nb_error;
+    uint32_t nb_missed;
+    uint32_t nb_bits_flipped;
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
 static tinymt32_t tinymt;
 
+/* Deferred payload checks: the RX path only copies the payload in the ring, a worker does the rest */
+static pthread_t thrid_check;
+static pthread_mutex_t mx_check = PTHREAD_MUTEX_INITIALIZER; /* check ring and worker state */
+static pthread_cond_t cond_check = PTHREAD_COND_INITIALIZER;
+static bool check_running = false;
+static struct dbg_check_s check_ring[DBG_CHECK_RING_SIZE];
+static uint32_t check_head = 0; /* number of payloads queued */
+static uint32_t check_tail = 0; /* number of payloads checked */
+static uint32_t check_dropped = 0; /* ring full */
+static struct lgw_conf_debug_s * check_context = NULL;
+static FILE * check_file = NULL;
+static struct dbg_check_stats_s check_stats[DBG_REF_PAYLOAD_NB];
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
+static void check_one(const struct dbg_check_s * check);
+static void * thread_check(void * arg);
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
+static void check_one(const struct dbg_check_s * check) {
+    int i, j, res;
+    uint32_t prev_cnt;
+    uint8_t diff;
+    struct conf_ref_payload_s * ref;
+    struct dbg_check_stats_s * stats;
+
+    for (i = 0; (i < check_context->nb_ref_payload) && (i < DBG_REF_PAYLOAD_NB); i++) {
+        ref = &(check_context->ref_payload[i]);
+        stats = &check_stats[i];
+        prev_cnt = ref->prev_cnt;
+        res = dbg_check_payload(check_context, check_file, (uint8_t *)check->payload, check->size, i, check->sf);
+        if (res == 0) {
+            continue; /* ignored */
+        }
+
+        /* The first packet of a reference payload gives the start of its counter */
+        if (((stats->nb_ok + stats->nb_error) > 0) && (ref->prev_cnt > (prev_cnt + 1))) {
+            stats->nb_missed += ref->prev_cnt - prev_cnt - 1;
+        }
+
+        if (res == 1) {
+            stats->nb_ok += 1;
+        } else {
+            stats->nb_error += 1;
+            for (j = 0; j < check->size; j++) {
+                for (diff = check->payload[j] ^ ref->payload[j]; diff != 0; diff &= diff - 1) {
+                    stats->nb_bits_flipped += 1;
+                }
+            }
+            printf("ERROR: 0x%08X payload error\n", ref->id);
+            if (check_file != NULL) {
+                fprintf(check_file, "ERROR: 0x%08X payload error\n", ref->id);
+                dbg_log_payload_diff_to_file(check_file, (uint8_t *)check->payload, ref->payload, check->size);
+            }
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void * thread_check(void * arg) {
+    struct dbg_check_s check;
+
+    (void)arg;
+
+    pthread_mutex_lock(&mx_check);
+    while (true) {
+        while ((check_running == true) && (check_head == check_tail)) {
+            pthread_cond_wait(&cond_check, &mx_check);
+        }
+        if (check_head == check_tail) {
+            break; /* stopped, and everything queued has been checked */
+        }
+        check = check_ring[check_tail % DBG_CHECK_RING_SIZE];
+        check_tail += 1;
+        pthread_mutex_unlock(&mx_check);
+
+        check_one(&check);
+
+        pthread_mutex_lock(&mx_check);
+    }
+    pthread_mutex_unlock(&mx_check);
+
+    return NULL;
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
@@ -199,3 +300,83 @@ int dbg_check_payload(struct lgw_conf_debug_s * context, FILE * file, uint8_t *
 
     return 0; /* ignored */
 }
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int dbg_payload_check_start(struct lgw_conf_debug_s * context, FILE * file) {
+    if (check_running == true) {
+        return 0;
+    }
+
+    check_context = context;
+    check_file = file;
+    check_head = check_tail = check_dropped = 0;
+    memset(check_stats, 0, sizeof check_stats);
+
+    check_running = true;
+    if (pthread_create(&thrid_check, NULL, thread_check, NULL) != 0) {
+        printf("ERROR: failed to start the payload check thread\n");
+        check_running = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void dbg_payload_check_queue(const uint8_t * payload, uint8_t size, uint8_t sf) {
+    struct dbg_check_s * check;
+
+    pthread_mutex_lock(&mx_check);
+    if (check_running == false) {
+        pthread_mutex_unlock(&mx_check);
+        return;
+    }
+    if ((check_head - check_tail) >= DBG_CHECK_RING_SIZE) {
+        check_dropped += 1; /* never wait for the worker on the RX path */
+    } else {
+        check = &check_ring[check_head % DBG_CHECK_RING_SIZE];
+        memcpy(check->payload, payload, size);
+        check->size = size;
+        check->sf = sf;
+        check_head += 1;
+        pthread_cond_signal(&cond_check);
+    }
+    pthread_mutex_unlock(&mx_check);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void dbg_payload_check_stop(void) {
+    int i;
+    struct dbg_check_stats_s * stats;
+
+    pthread_mutex_lock(&mx_check);
+    if (check_running == false) {
+        pthread_mutex_unlock(&mx_check);
+        return;
+    }
+    check_running = false;
+    pthread_cond_signal(&cond_check);
+    pthread_mutex_unlock(&mx_check);
+    pthread_join(thrid_check, NULL);
+
+    /* Summary of the run */
+    for (i = 0; (i < check_context->nb_ref_payload) && (i < DBG_REF_PAYLOAD_NB); i++) {
+        stats = &check_stats[i];
+        printf("INFO: 0x%08X payload check: %u ok, %u error (%u bits flipped), %u missed\n", check_context->ref_payload[i].id, stats->nb_ok, stats->nb_error, stats->nb_bits_flipped, stats->nb_missed);
+        if (check_file != NULL) {
+            fprintf(check_file, "INFO: 0x%08X payload check: %u ok, %u error (%u bits flipped), %u missed\n", check_context->ref_payload[i].id, stats->nb_ok, stats->nb_error, stats->nb_bits_flipped, stats->nb_missed);
+        }
+    }
+    if (check_dropped > 0) {
+        printf("WARNING: %u payloads not checked, the check thread did not keep up\n", check_dropped);
+        if (check_file != NULL) {
+            fprintf(check_file, "WARNING: %u payloads not checked, the check thread did not keep up\n", check_dropped);
+        }
+    }
+    if (check_file != NULL) {
+        fflush(check_file);
+    }
+}
@@ -0,0 +1,309 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Filtering of the received packets, applied by lgw_receive as soon as they
+    are parsed: CRC status policy, DevAddr allow/deny list and suppression of
+    the duplicates received on several IF chains.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <stdio.h>      /* printf fprintf */
+#include <string.h>     /* memset */
+
+#include "loragw_hal.h"
+#include "loragw_filter.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#if DEBUG_HAL == 1
+    #define DEBUG_MSG(str)                fprintf(stderr, str)
+    #define DEBUG_PRINTF(fmt, args...)    fprintf(stderr,"%s:%d: "fmt, __FUNCTION__, __LINE__, args)
+#else
+    #define DEBUG_MSG(str)
+    #define DEBUG_PRINTF(fmt, args...)
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEVADDR_SET_BITS    9       /* open addressing, 2 * LGW_FILTER_DEVADDR_MAX slots: at most half full */
+#define DEVADDR_SET_SIZE    (1 << DEVADDR_SET_BITS)
+#define DEVADDR_MIN_SIZE    8       /* MHDR, DevAddr, FCtrl, FCnt */
+
+/* LoRaWAN MHDR message types carrying a DevAddr: (un)confirmed data up/down */
+#define MTYPE_DATA_FIRST    2
+#define MTYPE_DATA_LAST     5
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct dup_entry_s {
+    uint32_t hash;      /* payload hash */
+    uint32_t count_us;  /* reception time */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+/* Each board has its own filter, see lgw_board_select() */
+
+/* CRC policy, everything is returned until configured */
+static bool filter_crc_ok[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = true };
+static bool filter_crc_bad[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = true };
+static bool filter_no_crc[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = true };
+
+/* DevAddr set, 0 marks an empty slot so DevAddr 0 is kept aside */
+static uint8_t  devaddr_mode[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = LGW_FILTER_DEVADDR_OFF };
+static uint32_t devaddr_set[LGW_BOARD_NB][DEVADDR_SET_SIZE];
+static bool     devaddr_zero[LGW_BOARD_NB];
+
+/* last packets returned, for duplicates suppression */
+static uint32_t dup_window_us[LGW_BOARD_NB];
+static struct dup_entry_s dup_hist[LGW_BOARD_NB][LGW_FILTER_DUP_NB];
+static int dup_nb[LGW_BOARD_NB];
+static int dup_idx[LGW_BOARD_NB]; /* next entry to be written */
+
+/* packets dropped */
+static struct lgw_rx_stats_s filter_stats[LGW_BOARD_NB];
+
+/* -------------------------------------------------------------------------- */
+/* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
+
+extern __thread lgw_handle_t lgw_board;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static inline uint32_t devaddr_slot(uint32_t devaddr) {
+    /* Fibonacci hashing, the top bits of the product depend on all the DevAddr bits */
+    return (devaddr * 2654435761u) >> (32 - DEVADDR_SET_BITS);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void devaddr_insert(uint32_t devaddr) {
+    uint32_t i;
+
+    if (devaddr == 0) {
+        devaddr_zero[lgw_board] = true;
+        return;
+    }
+    for (i = devaddr_slot(devaddr); devaddr_set[lgw_board][i] != 0; i = (i + 1) & (DEVADDR_SET_SIZE - 1)) {
+        if (devaddr_set[lgw_board][i] == devaddr) {
+            return;
+        }
+    }
+    devaddr_set[lgw_board][i] = devaddr;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool devaddr_listed(uint32_t devaddr) {
+    uint32_t i;
+
+    if (devaddr == 0) {
+        return devaddr_zero[lgw_board];
+    }
+    for (i = devaddr_slot(devaddr); devaddr_set[lgw_board][i] != 0; i = (i + 1) & (DEVADDR_SET_SIZE - 1)) {
+        if (devaddr_set[lgw_board][i] == devaddr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t payload_hash(const uint8_t * data, uint16_t size) {
+    uint32_t h = 2166136261u; /* FNV-1a */
+    int i;
+
+    for (i = 0; i < size; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h ^ size;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool dup_seen(uint32_t hash, uint32_t count_us) {
+    uint32_t diff;
+    int i;
+
+    for (i = 0; i < dup_nb[lgw_board]; i++) {
+        if (dup_hist[lgw_board][i].hash != hash) {
+            continue;
+        }
+        /* time between the receptions, whatever their order and the counter wrap-around */
+        diff = count_us - dup_hist[lgw_board][i].count_us;
+        if (diff > 0x80000000) {
+            diff = -diff;
+        }
+        if (diff < dup_window_us[lgw_board]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lgw_filter_setconf(const struct lgw_conf_rxfilter_s * conf) {
+    int i;
+
+    if (conf == NULL) {
+        filter_crc_ok[lgw_board] = true;
+        filter_crc_bad[lgw_board] = true;
+        filter_no_crc[lgw_board] = true;
+        devaddr_mode[lgw_board] = LGW_FILTER_DEVADDR_OFF;
+        dup_window_us[lgw_board] = 0;
+        lgw_filter_reset();
+        return LGW_FILTER_SUCCESS;
+    }
+
+    if (conf->devaddr_mode > LGW_FILTER_DEVADDR_DENY) {
+        printf("ERROR: invalid DevAddr filter mode %u\n", conf->devaddr_mode);
+        return LGW_FILTER_ERROR;
+    }
+    if (conf->devaddr_nb > LGW_FILTER_DEVADDR_MAX) {
+        printf("ERROR: too many DevAddr in the filter list (%u, max %u)\n", conf->devaddr_nb, LGW_FILTER_DEVADDR_MAX);
+        return LGW_FILTER_ERROR;
+    }
+    if (conf->dedup_window_us > INT32_MAX) {
+        printf("ERROR: duplicates window too long (%u us)\n", conf->dedup_window_us);
+        return LGW_FILTER_ERROR;
+    }
+
+    filter_crc_ok[lgw_board] = conf->crc_ok;
+    filter_crc_bad[lgw_board] = conf->crc_bad;
+    filter_no_crc[lgw_board] = conf->no_crc;
+
+    devaddr_mode[lgw_board] = conf->devaddr_mode;
+    memset(devaddr_set[lgw_board], 0, sizeof devaddr_set[lgw_board]);
+    devaddr_zero[lgw_board] = false;
+    for (i = 0; i < conf->devaddr_nb; i++) {
+        devaddr_insert(conf->devaddr[i]);
+    }
+
+    dup_window_us[lgw_board] = conf->dedup_window_us;
+    lgw_filter_reset();
+
+    DEBUG_PRINTF("Note: RX filter: crc_ok:%d crc_bad:%d no_crc:%d devaddr_mode:%u devaddr_nb:%u dedup_window_us:%u\n", filter_crc_ok[lgw_board], filter_crc_bad[lgw_board], filter_no_crc[lgw_board],
+                                                                                                                      devaddr_mode[lgw_board], conf->devaddr_nb, dup_window_us[lgw_board]);
+
+    return LGW_FILTER_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_filter_reset(void) {
+    dup_nb[lgw_board] = 0;
+    dup_idx[lgw_board] = 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_filter_check(const struct lgw_pkt_rx_s * p) {
+    uint32_t devaddr;
+    uint32_t hash;
+    uint8_t mtype;
+
+    if (p == NULL) {
+        return LGW_FILTER_PASS;
+    }
+
+    /* CRC policy, cheapest first */
+    switch (p->status) {
+        case STAT_CRC_OK:
+            if (filter_crc_ok[lgw_board] == false) {
+                filter_stats[lgw_board].nb_drop_crc_ok += 1;
+                return LGW_FILTER_DROP_CRC;
+            }
+            break;
+        case STAT_CRC_BAD:
+            if (filter_crc_bad[lgw_board] == false) {
+                filter_stats[lgw_board].nb_drop_crc_bad += 1;
+                return LGW_FILTER_DROP_CRC;
+            }
+            break;
+        case STAT_NO_CRC:
+            if (filter_no_crc[lgw_board] == false) {
+                filter_stats[lgw_board].nb_drop_no_crc += 1;
+                return LGW_FILTER_DROP_CRC;
+            }
+            break;
+        default:
+            break;
+    }
+
+    /* The next filters rely on the payload content, only valid packets are checked */
+    if (p->status != STAT_CRC_OK) {
+        return LGW_FILTER_PASS;
+    }
+
+    /* DevAddr of LoRaWAN data frames, other frames (join...) are not filtered */
+    if ((devaddr_mode[lgw_board] != LGW_FILTER_DEVADDR_OFF) && (p->size >= DEVADDR_MIN_SIZE)) {
+        mtype = p->payload[0] >> 5;
+        if ((mtype >= MTYPE_DATA_FIRST) && (mtype <= MTYPE_DATA_LAST)) {
+            devaddr  = (uint32_t)p->payload[1];
+            devaddr |= (uint32_t)p->payload[2] << 8;
+            devaddr |= (uint32_t)p->payload[3] << 16;
+            devaddr |= (uint32_t)p->payload[4] << 24;
+            if (devaddr_listed(devaddr) != (devaddr_mode[lgw_board] == LGW_FILTER_DEVADDR_ALLOW)) {
+                filter_stats[lgw_board].nb_drop_devaddr += 1;
+                return LGW_FILTER_DROP_DEVADDR;
+            }
+        }
+    }
+
+    /* Same payload returned shortly before */
+    if (dup_window_us[lgw_board] > 0) {
+        hash = payload_hash(p->payload, p->size);
+        if (dup_seen(hash, p->count_us) == true) {
+            filter_stats[lgw_board].nb_drop_dup += 1;
+            return LGW_FILTER_DROP_DUP;
+        }
+        dup_hist[lgw_board][dup_idx[lgw_board]].hash = hash;
+        dup_hist[lgw_board][dup_idx[lgw_board]].count_us = p->count_us;
+        dup_idx[lgw_board] = (dup_idx[lgw_board] + 1) % LGW_FILTER_DUP_NB;
+        if (dup_nb[lgw_board] < LGW_FILTER_DUP_NB) {
+            dup_nb[lgw_board] += 1;
+        }
+    }
+
+    return LGW_FILTER_PASS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_filter_get_stats(struct lgw_rx_stats_s * stats, bool reset) {
+    if (stats == NULL) {
+        return;
+    }
+
+    stats->nb_drop_crc_ok = filter_stats[lgw_board].nb_drop_crc_ok;
+    stats->nb_drop_crc_bad = filter_stats[lgw_board].nb_drop_crc_bad;
+    stats->nb_drop_no_crc = filter_stats[lgw_board].nb_drop_no_crc;
+    stats->nb_drop_devaddr = filter_stats[lgw_board].nb_drop_devaddr;
+    stats->nb_drop_dup = filter_stats[lgw_board].nb_drop_dup;
+    if (reset == true) {
+        memset(&filter_stats[lgw_board], 0, sizeof filter_stats[lgw_board]);
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
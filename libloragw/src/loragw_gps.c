@@ -61,6 +61,20 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #define UBX_MSG_NAVTIMEGPS_LEN  16
 
+#define BYTE_TIME_US        (10 * 1000000 / 9600) /* 8N1 frame at the default baudrate */
+#define UBX_PAYLOAD_MAX     1024 /* longer payloads are considered as a false sync */
+#define NMEA_TYPICAL_SIZE   72 /* to estimate when a sentence being received ends */
+
+/* states of the stream parser */
+enum {
+    PARSER_SYNC = 0,    /* waiting for a sync char */
+    PARSER_UBX_SYNC2,   /* UBX first sync char received */
+    PARSER_UBX_HEADER,  /* UBX class, ID and length */
+    PARSER_UBX_BODY,    /* UBX payload and checksum */
+    PARSER_NMEA_BODY,   /* NMEA sentence, until the checksum delimiter */
+    PARSER_NMEA_CHECKSUM /* NMEA checksum characters */
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
@@ -105,6 +119,10 @@ static bool match_label(const char *s, char *label, int size, char wildcard);
 
 static int str_chop(char *s, int buff_size, char separator, int *idx_ary, int max_idx);
 
+static enum gps_msg ubx_decode(const char *serial_buff);
+
+static enum gps_msg nmea_decode(const char *parser_buf, const int *str_index, int nb_fields);
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
@@ -250,6 +268,141 @@ int str_chop(char *s, int buff_size, char separator, int *idx_ary, int max_idx)
     return j;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/*
+Decode a complete UBX frame (sync chars included) whose checksum has been
+verified, and update the GPS time variables.
+*/
+static enum gps_msg ubx_decode(const char *serial_buff) {
+    bool valid = 0;    /* iTOW, fTOW and week validity */
+
+    /* Check for Class 0x01 (NAV) and ID 0x20 (NAV-TIMEGPS) */
+    if ((serial_buff[2] == 0x01) && (serial_buff[3] == 0x20)) {
+        /* Check validity of information */
+        valid = serial_buff[17] & 0x3; /* towValid, weekValid */
+        if (valid) {
+            /* Parse buffer to extract GPS time */
+            /* Warning: payload byte ordering is Little Endian */
+            gps_iTOW =  (uint8_t)serial_buff[6];
+            gps_iTOW |= (uint8_t)serial_buff[7] << 8;
+            gps_iTOW |= (uint8_t)serial_buff[8] << 16;
+            gps_iTOW |= (uint8_t)serial_buff[9] << 24; /* GPS time of week, in ms */
+
+            gps_fTOW =  (uint8_t)serial_buff[10];
+            gps_fTOW |= (uint8_t)serial_buff[11] << 8;
+            gps_fTOW |= (uint8_t)serial_buff[12] << 16;
+            gps_fTOW |= (uint8_t)serial_buff[13] << 24; /* Fractional part of iTOW, in ns */
+
+            gps_week =  (uint8_t)serial_buff[14];
+            gps_week |= (uint8_t)serial_buff[15] << 8; /* GPS week number */
+
+            gps_time_ok = true;
+#if 0
+            /* For debug */
+            {
+                short ubx_gps_hou = 0; /* hours (0-23) */
+                short ubx_gps_min = 0; /* minutes (0-59) */
+                short ubx_gps_sec = 0; /* seconds (0-59) */
+
+                /* Format GPS time in hh:mm:ss based on iTOW */
+                ubx_gps_sec = (gps_iTOW / 1000) % 60;
+                ubx_gps_min = (gps_iTOW / 1000 / 60) % 60;
+                ubx_gps_hou = (gps_iTOW / 1000 / 60 / 60) % 24;
+                printf("  GPS time = %02d:%02d:%02d\n", ubx_gps_hou, ubx_gps_min, ubx_gps_sec);
+            }
+#endif
+        } else { /* valid */
+            gps_time_ok = false;
+        }
+
+        return UBX_NAV_TIMEGPS;
+    } else if ((serial_buff[2] == 0x05) && (serial_buff[3] == 0x00)) {
+        DEBUG_MSG("NOTE: UBX ACK-NAK received\n");
+        return IGNORED;
+    } else if ((serial_buff[2] == 0x05) && (serial_buff[3] == 0x01)) {
+        DEBUG_MSG("NOTE: UBX ACK-ACK received\n");
+        return IGNORED;
+    } else { /* not a supported message */
+        DEBUG_MSG("ERROR: UBX message is not supported (%02x %02x)\n", serial_buff[2], serial_buff[3]);
+        return IGNORED;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/*
+Decode a NMEA sentence whose checksum has been verified and whose fields have
+been chopped (str_index[0] pointing to the '$' of the label), and update the
+GPS time and position variables.
+*/
+static enum gps_msg nmea_decode(const char *parser_buf, const int *str_index, int nb_fields) {
+    int i, j, k;
+
+    if (match_label(parser_buf, "$G?RMC", 6, '?')) {
+        /*
+        NMEA sentence format: $xxRMC,time,status,lat,NS,long,EW,spd,cog,date,mv,mvEW,posMode*cs<CR><LF>
+        Valid fix: $GPRMC,083559.34,A,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,A*00
+        No fix: $GPRMC,,V,,,,,,,,,,N*00
+        */
+        if (nb_fields != 13) {
+            DEBUG_MSG("Warning: invalid RMC sentence (number of fields)\n");
+            return IGNORED;
+        }
+        /* parse GPS status */
+        gps_mod = *(parser_buf + str_index[12]); /* get first character, no need to bother with sscanf */
+        if ((gps_mod != 'N') && (gps_mod != 'A') && (gps_mod != 'D')) {
+            gps_mod = 'N';
+        }
+        /* parse complete time */
+        i = sscanf(parser_buf + str_index[1], "%2hd%2hd%2hd%4f", &gps_hou, &gps_min, &gps_sec, &gps_fra);
+        j = sscanf(parser_buf + str_index[9], "%2hd%2hd%2hd", &gps_day, &gps_mon, &gps_yea);
+        if ((i == 4) && (j == 3)) {
+            if ((gps_mod == 'A') || (gps_mod == 'D')) {
+                gps_time_ok = true;
+                DEBUG_MSG("Note: Valid RMC sentence, GPS locked, date: 20%02d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, gps_fra + (float)gps_sec);
+            } else {
+                gps_time_ok = false;
+                DEBUG_MSG("Note: Valid RMC sentence, no satellite fix, estimated date: 20%02d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, gps_fra + (float)gps_sec);
+            }
+        } else {
+            /* could not get a valid hour AND date */
+            gps_time_ok = false;
+            DEBUG_MSG("Note: Valid RMC sentence, mode %c, no date\n", gps_mod);
+        }
+        return NMEA_RMC;
+    } else if (match_label(parser_buf, "$G?GGA", 6, '?')) {
+        /*
+        NMEA sentence format: $xxGGA,time,lat,NS,long,EW,quality,numSV,HDOP,alt,M,sep,M,diffAge,diffStation*cs<CR><LF>
+        Valid fix: $GPGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,*5B
+        */
+        if (nb_fields != 15) {
+            DEBUG_MSG("Warning: invalid GGA sentence (number of fields)\n");
+            return IGNORED;
+        }
+        /* parse number of satellites used for fix */
+        sscanf(parser_buf + str_index[7], "%hd", &gps_sat);
+        /* parse 3D coordinates */
+        i = sscanf(parser_buf + str_index[2], "%2hd%10lf", &gps_dla, &gps_mla);
+        gps_ola = *(parser_buf + str_index[3]);
+        j = sscanf(parser_buf + str_index[4], "%3hd%10lf", &gps_dlo, &gps_mlo);
+        gps_olo = *(parser_buf + str_index[5]);
+        k = sscanf(parser_buf + str_index[9], "%hd", &gps_alt);
+        if ((i == 2) && (j == 2) && (k == 1) && ((gps_ola=='N')||(gps_ola=='S')) && ((gps_olo=='E')||(gps_olo=='W'))) {
+            gps_pos_ok = true;
+            DEBUG_MSG("Note: Valid GGA sentence, %d sat, lat %02ddeg %06.3fmin %c, lon %03ddeg%06.3fmin %c, alt %d\n", gps_sat, gps_dla, gps_mla, gps_ola, gps_dlo, gps_mlo, gps_olo, gps_alt);
+        } else {
+            /* could not get a valid latitude, longitude AND altitude */
+            gps_pos_ok = false;
+            DEBUG_MSG("Note: Valid GGA sentence, %d sat, no coordinates\n", gps_sat);
+        }
+        return NMEA_GGA;
+    } else {
+        DEBUG_MSG("Note: ignored NMEA sentence\n"); /* quite verbose */
+        return IGNORED;
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
@@ -338,8 +491,10 @@ int lgw_gps_enable(char *tty_path, char *gps_family, speed_t target_brate, int *
     ttyopt.c_lflag &= ~ECHOK;  /* do not echo NL after KILL character */
 
     /* settings for non-canonical mode
-       read will block for until the lesser of VMIN or requested chars have been received */
-    ttyopt.c_cc[VMIN]  = LGW_GPS_MIN_MSG_SIZE;
+       read will block until at least one char has been received, then return
+       all the chars available (up to the requested size), so that the end of
+       a frame is never held back waiting for the next one */
+    ttyopt.c_cc[VMIN]  = 1;
     ttyopt.c_cc[VTIME] = 0;
 
     /* set new serial ports parameters */
@@ -393,7 +548,6 @@ int lgw_gps_disable(int fd) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 enum gps_msg lgw_parse_ubx(const char *serial_buff, size_t buff_size, size_t *msg_size) {
-    bool valid = 0;    /* iTOW, fTOW and week validity */
     unsigned int payload_length;
     uint8_t ck_a, ck_b;
     uint8_t ck_a_rcv, ck_b_rcv;
@@ -439,56 +593,7 @@ enum gps_msg lgw_parse_ubx(const char *serial_buff, size_t buff_size, size_t *ms
 
             /* Compare checksums and parse if OK */
             if ((ck_a == ck_a_rcv) && (ck_b == ck_b_rcv)) {
-                /* Check for Class 0x01 (NAV) and ID 0x20 (NAV-TIMEGPS) */
-                if ((serial_buff[2] == 0x01) && (serial_buff[3] == 0x20)) {
-                    /* Check validity of information */
-                    valid = serial_buff[17] & 0x3; /* towValid, weekValid */
-                    if (valid) {
-                        /* Parse buffer to extract GPS time */
-                        /* Warning: payload byte ordering is Little Endian */
-                        gps_iTOW =  (uint8_t)serial_buff[6];
-                        gps_iTOW |= (uint8_t)serial_buff[7] << 8;
-                        gps_iTOW |= (uint8_t)serial_buff[8] << 16;
-                        gps_iTOW |= (uint8_t)serial_buff[9] << 24; /* GPS time of week, in ms */
-
-                        gps_fTOW =  (uint8_t)serial_buff[10];
-                        gps_fTOW |= (uint8_t)serial_buff[11] << 8;
-                        gps_fTOW |= (uint8_t)serial_buff[12] << 16;
-                        gps_fTOW |= (uint8_t)serial_buff[13] << 24; /* Fractional part of iTOW, in ns */
-
-                        gps_week =  (uint8_t)serial_buff[14];
-                        gps_week |= (uint8_t)serial_buff[15] << 8; /* GPS week number */
-
-                        gps_time_ok = true;
-#if 0
-                        /* For debug */
-                        {
-                            short ubx_gps_hou = 0; /* hours (0-23) */
-                            short ubx_gps_min = 0; /* minutes (0-59) */
-                            short ubx_gps_sec = 0; /* seconds (0-59) */
-
-                            /* Format GPS time in hh:mm:ss based on iTOW */
-                            ubx_gps_sec = (gps_iTOW / 1000) % 60;
-                            ubx_gps_min = (gps_iTOW / 1000 / 60) % 60;
-                            ubx_gps_hou = (gps_iTOW / 1000 / 60 / 60) % 24;
-                            printf("  GPS time = %02d:%02d:%02d\n", ubx_gps_hou, ubx_gps_min, ubx_gps_sec);
-                        }
-#endif
-                    } else { /* valid */
-                        gps_time_ok = false;
-                    }
-
-                    return UBX_NAV_TIMEGPS;
-                } else if ((serial_buff[2] == 0x05) && (serial_buff[3] == 0x00)) {
-                    DEBUG_MSG("NOTE: UBX ACK-NAK received\n");
-                    return IGNORED;
-                } else if ((serial_buff[2] == 0x05) && (serial_buff[3] == 0x01)) {
-                    DEBUG_MSG("NOTE: UBX ACK-ACK received\n");
-                    return IGNORED;
-                } else { /* not a supported message */
-                    DEBUG_MSG("ERROR: UBX message is not supported (%02x %02x)\n", serial_buff[2], serial_buff[3]);
-                    return IGNORED;
-                }
+                return ubx_decode(serial_buff);
             } else { /* checksum failed */
                 DEBUG_MSG("ERROR: UBX message is corrupted, checksum failed\n");
                 return INVALID;
@@ -506,10 +611,9 @@ enum gps_msg lgw_parse_ubx(const char *serial_buff, size_t buff_size, size_t *ms
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 enum gps_msg lgw_parse_nmea(const char *serial_buff, int buff_size) {
-    int i, j, k;
-    int str_index[30]; /* string index from the string chopping */
+    int str_index[LGW_GPS_NMEA_FIELD_MAX]; /* string index from the string chopping */
     int nb_fields; /* number of strings detected by string chopping */
-    char parser_buf[256]; /* parsing modifies buffer so need a local copy */
+    char parser_buf[LGW_GPS_FRAME_MAX]; /* parsing modifies buffer so need a local copy */
 
     /* check input parameters */
     if (serial_buff == NULL) {
@@ -528,74 +632,198 @@ enum gps_msg lgw_parse_nmea(const char *serial_buff, int buff_size) {
     } else if (!validate_nmea_checksum(serial_buff, buff_size)) {
         DEBUG_MSG("Warning: invalid NMEA sentence (bad checksum)\n");
         return INVALID;
-    } else if (match_label(serial_buff, "$G?RMC", 6, '?')) {
-        /*
-        NMEA sentence format: $xxRMC,time,status,lat,NS,long,EW,spd,cog,date,mv,mvEW,posMode*cs<CR><LF>
-        Valid fix: $GPRMC,083559.34,A,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,A*00
-        No fix: $GPRMC,,V,,,,,,,,,,N*00
-        */
-        memcpy(parser_buf, serial_buff, buff_size);
-        parser_buf[buff_size] = '\0';
-        nb_fields = str_chop(parser_buf, buff_size, ',', str_index, ARRAY_SIZE(str_index));
-        if (nb_fields != 13) {
-            DEBUG_MSG("Warning: invalid RMC sentence (number of fields)\n");
-            return IGNORED;
-        }
-        /* parse GPS status */
-        gps_mod = *(parser_buf + str_index[12]); /* get first character, no need to bother with sscanf */
-        if ((gps_mod != 'N') && (gps_mod != 'A') && (gps_mod != 'D')) {
-            gps_mod = 'N';
-        }
-        /* parse complete time */
-        i = sscanf(parser_buf + str_index[1], "%2hd%2hd%2hd%4f", &gps_hou, &gps_min, &gps_sec, &gps_fra);
-        j = sscanf(parser_buf + str_index[9], "%2hd%2hd%2hd", &gps_day, &gps_mon, &gps_yea);
-        if ((i == 4) && (j == 3)) {
-            if ((gps_mod == 'A') || (gps_mod == 'D')) {
-                gps_time_ok = true;
-                DEBUG_MSG("Note: Valid RMC sentence, GPS locked, date: 20%02d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, gps_fra + (float)gps_sec);
-            } else {
-                gps_time_ok = false;
-                DEBUG_MSG("Note: Valid RMC sentence, no satellite fix, estimated date: 20%02d-%02d-%02dT%02d:%02d:%06.3fZ\n", gps_yea, gps_mon, gps_day, gps_hou, gps_min, gps_fra + (float)gps_sec);
-            }
-        } else {
-            /* could not get a valid hour AND date */
-            gps_time_ok = false;
-            DEBUG_MSG("Note: Valid RMC sentence, mode %c, no date\n", gps_mod);
-        }
-        return NMEA_RMC;
-    } else if (match_label(serial_buff, "$G?GGA", 6, '?')) {
-        /*
-        NMEA sentence format: $xxGGA,time,lat,NS,long,EW,quality,numSV,HDOP,alt,M,sep,M,diffAge,diffStation*cs<CR><LF>
-        Valid fix: $GPGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,*5B
-        */
-        memcpy(parser_buf, serial_buff, buff_size);
-        parser_buf[buff_size] = '\0';
-        nb_fields = str_chop(parser_buf, buff_size, ',', str_index, ARRAY_SIZE(str_index));
-        if (nb_fields != 15) {
-            DEBUG_MSG("Warning: invalid GGA sentence (number of fields)\n");
-            return IGNORED;
-        }
-        /* parse number of satellites used for fix */
-        sscanf(parser_buf + str_index[7], "%hd", &gps_sat);
-        /* parse 3D coordinates */
-        i = sscanf(parser_buf + str_index[2], "%2hd%10lf", &gps_dla, &gps_mla);
-        gps_ola = *(parser_buf + str_index[3]);
-        j = sscanf(parser_buf + str_index[4], "%3hd%10lf", &gps_dlo, &gps_mlo);
-        gps_olo = *(parser_buf + str_index[5]);
-        k = sscanf(parser_buf + str_index[9], "%hd", &gps_alt);
-        if ((i == 2) && (j == 2) && (k == 1) && ((gps_ola=='N')||(gps_ola=='S')) && ((gps_olo=='E')||(gps_olo=='W'))) {
-            gps_pos_ok = true;
-            DEBUG_MSG("Note: Valid GGA sentence, %d sat, lat %02ddeg %06.3fmin %c, lon %03ddeg%06.3fmin %c, alt %d\n", gps_sat, gps_dla, gps_mla, gps_ola, gps_dlo, gps_mlo, gps_olo, gps_alt);
-        } else {
-            /* could not get a valid latitude, longitude AND altitude */
-            gps_pos_ok = false;
-            DEBUG_MSG("Note: Valid GGA sentence, %d sat, no coordinates\n", gps_sat);
+    }
+
+    /* fields are split in place, as the stream parser does */
+    memcpy(parser_buf, serial_buff, buff_size);
+    parser_buf[buff_size] = '\0';
+    nb_fields = str_chop(parser_buf, buff_size, ',', str_index, ARRAY_SIZE(str_index));
+    return nmea_decode(parser_buf, str_index, nb_fields);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_gps_parser_init(struct lgw_gps_parser_s *parser) {
+    if (parser == NULL) {
+        return;
+    }
+    memset(parser, 0, sizeof *parser);
+    parser->state = PARSER_SYNC;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+enum gps_msg lgw_gps_parse_stream(struct lgw_gps_parser_s *parser, const char *serial_buff, size_t buff_size, size_t *consumed) {
+    size_t i = 0;
+    uint8_t c;
+
+    /* check input parameters */
+    if (consumed == NULL) {
+        return UNKNOWN;
+    }
+    *consumed = 0;
+    if ((parser == NULL) || (serial_buff == NULL)) {
+        return UNKNOWN;
+    }
+
+    while (i < buff_size) {
+        c = (uint8_t)serial_buff[i];
+
+        switch (parser->state) {
+            case PARSER_SYNC:
+                if (c == LGW_GPS_UBX_SYNC_CHAR) {
+                    parser->frame[0] = (char)c;
+                    parser->size = 1;
+                    parser->state = PARSER_UBX_SYNC2;
+                } else if (c == LGW_GPS_NMEA_SYNC_CHAR) {
+                    parser->frame[0] = (char)c;
+                    parser->size = 1;
+                    parser->nmea_ck = 0;
+                    parser->str_index[0] = 0;
+                    parser->nb_fields = 1;
+                    parser->state = PARSER_NMEA_BODY;
+                }
+                i += 1;
+                break;
+
+            case PARSER_UBX_SYNC2:
+                if (c != 0x62) {
+                    /* false sync, the byte is processed again as it may start another frame */
+                    parser->state = PARSER_SYNC;
+                    break;
+                }
+                parser->frame[parser->size++] = (char)c;
+                parser->ck_a = 0;
+                parser->ck_b = 0;
+                parser->state = PARSER_UBX_HEADER;
+                i += 1;
+                break;
+
+            case PARSER_UBX_HEADER:
+                /* 8-bit Fletcher checksum, computed over class, ID, length and payload */
+                parser->frame[parser->size++] = (char)c;
+                parser->ck_a += c;
+                parser->ck_b += parser->ck_a;
+                i += 1;
+                if (parser->size == 6) {
+                    /* header + payload + checksum */
+                    parser->expected = 6 + ((uint8_t)parser->frame[4] | ((uint8_t)parser->frame[5] << 8)) + 2;
+                    if (parser->expected > (6 + UBX_PAYLOAD_MAX + 2)) {
+                        DEBUG_MSG("ERROR: UBX payload length too large, false sync\n");
+                        parser->state = PARSER_SYNC;
+                    } else {
+                        parser->state = PARSER_UBX_BODY;
+                    }
+                }
+                break;
+
+            case PARSER_UBX_BODY:
+                if (parser->size < (parser->expected - 2)) {
+                    parser->ck_a += c;
+                    parser->ck_b += parser->ck_a;
+                } else {
+                    parser->ck_rcv[parser->size - (parser->expected - 2)] = c;
+                }
+                if (parser->size < sizeof parser->frame) {
+                    parser->frame[parser->size] = (char)c;
+                }
+                parser->size += 1;
+                i += 1;
+                if (parser->size == parser->expected) {
+                    parser->state = PARSER_SYNC;
+                    *consumed = i;
+                    if ((parser->ck_a != parser->ck_rcv[0]) || (parser->ck_b != parser->ck_rcv[1])) {
+                        DEBUG_MSG("ERROR: UBX message is corrupted, checksum failed\n");
+                        return INVALID;
+                    }
+                    if (parser->expected > sizeof parser->frame) {
+                        DEBUG_MSG("Note: UBX message too long to be decoded (%02x %02x)\n", parser->frame[2], parser->frame[3]);
+                        return IGNORED;
+                    }
+                    return ubx_decode(parser->frame);
+                }
+                break;
+
+            case PARSER_NMEA_BODY:
+                if ((c < 0x20) || (c > 0x7E) || (c == LGW_GPS_NMEA_SYNC_CHAR) || (parser->size >= (sizeof parser->frame - 1))) {
+                    /* truncated or garbled sentence, the byte is processed again as it may start another frame */
+                    DEBUG_MSG("Warning: invalid NMEA sentence (unexpected char)\n");
+                    parser->state = PARSER_SYNC;
+                    break;
+                }
+                if (c == '*') {
+                    parser->frame[parser->size++] = '\0'; /* terminates the last field */
+                    parser->expected = parser->size;
+                    parser->state = PARSER_NMEA_CHECKSUM;
+                } else if (c == ',') {
+                    /* chop fields on the fly, as str_chop does */
+                    parser->nmea_ck ^= c;
+                    parser->frame[parser->size++] = '\0';
+                    if (parser->nb_fields < LGW_GPS_NMEA_FIELD_MAX) {
+                        parser->str_index[parser->nb_fields++] = parser->size;
+                    }
+                } else {
+                    parser->nmea_ck ^= c;
+                    parser->frame[parser->size++] = (char)c;
+                }
+                i += 1;
+                break;
+
+            case PARSER_NMEA_CHECKSUM:
+                parser->ck_rcv[parser->size - parser->expected] = c;
+                parser->size += 1;
+                i += 1;
+                if ((parser->size - parser->expected) == 2) {
+                    /* no need to wait for the end of line */
+                    parser->state = PARSER_SYNC;
+                    *consumed = i;
+                    if ((parser->ck_rcv[0] != (uint8_t)nibble_to_hexchar(parser->nmea_ck / 16)) || (parser->ck_rcv[1] != (uint8_t)nibble_to_hexchar(parser->nmea_ck % 16))) {
+                        DEBUG_MSG("Warning: invalid NMEA sentence (bad checksum)\n");
+                        return INVALID;
+                    }
+                    return nmea_decode(parser->frame, parser->str_index, parser->nb_fields);
+                }
+                break;
+
+            default:
+                parser->state = PARSER_SYNC;
+                break;
         }
-        return NMEA_GGA;
-    } else {
-        DEBUG_MSG("Note: ignored NMEA sentence\n"); /* quite verbose */
-        return IGNORED;
     }
+
+    *consumed = i;
+    return UNKNOWN;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint32_t lgw_gps_parser_wait_us(const struct lgw_gps_parser_s *parser) {
+    size_t missing;
+
+    if (parser == NULL) {
+        return 0;
+    }
+
+    switch (parser->state) {
+        case PARSER_UBX_SYNC2:
+        case PARSER_UBX_HEADER:
+            missing = 6 + 2 - parser->size; /* at least the header and checksum */
+            break;
+        case PARSER_UBX_BODY:
+            missing = parser->expected - parser->size;
+            break;
+        case PARSER_NMEA_BODY:
+            missing = (parser->size < NMEA_TYPICAL_SIZE) ? (NMEA_TYPICAL_SIZE - parser->size) : 3; /* at least '*' and checksum */
+            break;
+        case PARSER_NMEA_CHECKSUM:
+            missing = 2 - (parser->size - parser->expected);
+            break;
+        default:
+            missing = 0;
+            break;
+    }
+
+    return (uint32_t)(missing * BYTE_TIME_US);
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
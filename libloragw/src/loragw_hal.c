@@ -27,20 +27,24 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <stdbool.h>    /* bool type */
 #include <stdio.h>      /* printf fprintf */
 #include <string.h>     /* memcpy */
-#include <math.h>       /* pow, cell */
 #include <time.h>
 #include <unistd.h>     /* symlink, unlink */
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 
 #include "loragw_reg.h"
 #include "loragw_hal.h"
 #include "loragw_aux.h"
 #include "loragw_spi.h"
+#include "loragw_com.h"
+#include "loragw_capture.h"
+#include "loragw_filter.h"
 #include "loragw_i2c.h"
 #include "loragw_sx1250.h"
 #include "loragw_sx125x.h"
 #include "loragw_sx1302.h"
+#include "loragw_sx1302_rx.h"
 #include "loragw_stts751.h"
 #include "loragw_debug.h"
 
@@ -67,17 +71,17 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #define TRACE()             fprintf(stderr, "@ %s %d\n", __FUNCTION__, __LINE__);
 
-#define CONTEXT_STARTED         lgw_context.is_started
-#define CONTEXT_SPI             lgw_context.board_cfg.spidev_path
-#define CONTEXT_LWAN_PUBLIC     lgw_context.board_cfg.lorawan_public
-#define CONTEXT_BOARD           lgw_context.board_cfg
-#define CONTEXT_RF_CHAIN        lgw_context.rf_chain_cfg
-#define CONTEXT_IF_CHAIN        lgw_context.if_chain_cfg
-#define CONTEXT_LORA_SERVICE    lgw_context.lora_service_cfg
-#define CONTEXT_FSK             lgw_context.fsk_cfg
-#define CONTEXT_TX_GAIN_LUT     lgw_context.tx_gain_lut
-#define CONTEXT_TIMESTAMP       lgw_context.timestamp_cfg
-#define CONTEXT_DEBUG           lgw_context.debug_cfg
+#define CONTEXT_STARTED         lgw_context[lgw_board].is_started
+#define CONTEXT_SPI             lgw_context[lgw_board].board_cfg.spidev_path
+#define CONTEXT_LWAN_PUBLIC     lgw_context[lgw_board].board_cfg.lorawan_public
+#define CONTEXT_BOARD           lgw_context[lgw_board].board_cfg
+#define CONTEXT_RF_CHAIN        lgw_context[lgw_board].rf_chain_cfg
+#define CONTEXT_IF_CHAIN        lgw_context[lgw_board].if_chain_cfg
+#define CONTEXT_LORA_SERVICE    lgw_context[lgw_board].lora_service_cfg
+#define CONTEXT_FSK             lgw_context[lgw_board].fsk_cfg
+#define CONTEXT_TX_GAIN_LUT     lgw_context[lgw_board].tx_gain_lut
+#define CONTEXT_TIMESTAMP       lgw_context[lgw_board].timestamp_cfg
+#define CONTEXT_DEBUG           lgw_context[lgw_board].debug_cfg
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE CONSTANTS & TYPES -------------------------------------------- */
@@ -94,6 +98,27 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define LGW_RF_RX_FREQ_MIN          100E6
 #define LGW_RF_RX_FREQ_MAX          1E9
 
+/* Polling intervals used by lgw_receive_wait() while the RX buffer is empty */
+#define RX_WAIT_POLL_MIN_MS         1   /* first poll interval, after data was last seen */
+#define RX_WAIT_POLL_MAX_MS         32  /* poll interval upper bound on idle gateways */
+
+/* Temperature used for RSSI compensation is read from the sensor at most once per interval */
+#define TEMPERATURE_REFRESH_MS      10000
+#define TEMPERATURE_SIMULATED       25.0    /* no sensor behind a simulated link, see lgw_com_simulated() */
+
+/* LoRa time on air: payload bits coded per block of (CR+4) symbols, 4*(SF-2*DE), indexed by SF */
+/* Note: low datarate optimization (DE) is enabled for SF11 and SF12 */
+static const uint8_t toa_bits_per_block[13] = { 0, 0, 0, 0, 0, 0, 0, 28, 32, 36, 40, 36, 40 };
+
+/* Packet programmed in the TX modem of a RF chain by lgw_tx_stage(), waiting for lgw_tx_arm() */
+struct tx_stage_s {
+    bool        valid;          /* cleared once triggered or overwritten */
+    uint32_t    id;
+    uint8_t     tx_mode;
+    uint32_t    count_us;
+    uint16_t    start_delay;    /* from sx1302_tx_stage() */
+};
+
 /* Version string, used to identify the library version/options once compiled */
 const char lgw_version_string[] = "Version: " LIBLORAGW_VERSION ";";
 
@@ -106,17 +131,21 @@ const char lgw_version_string[] = "Version: " LIBLORAGW_VERSION ";";
 
 /*
 The following static variable holds the gateway configuration provided by the
-user that need to be propagated in the drivers.
+user that need to be propagated in the drivers, for each concentrator board.
 
 Parameters validity and coherency is verified by the _setconf functions and
 the _start and _send functions assume they are valid.
 */
-static lgw_context_t lgw_context = {
+static lgw_context_t lgw_context[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = {
     .is_started = false,
     .board_cfg.spidev_path = "/dev/spidev0.0",
     .board_cfg.lorawan_public = true,
     .board_cfg.clksrc = 0,
     .board_cfg.full_duplex = false,
+    .board_cfg.spi_speed = SPI_SPEED,
+    .board_cfg.spi_chunk_size = LGW_BURST_CHUNK,
+    .board_cfg.temperature_refresh_ms = TEMPERATURE_REFRESH_MS,
+    .board_cfg.rx_buffer_size = RX_BUFFER_SIZE,
     .rf_chain_cfg = {{0}},
     .if_chain_cfg = {{0}},
     .lora_service_cfg = {
@@ -175,20 +204,58 @@ static lgw_context_t lgw_context = {
         .nb_ref_payload = 0,
         .log_file_name = "loragw_hal.log"
     }
-};
+} };
 
 /* File handle to write debug logs */
 FILE * log_file = NULL;
 
+/* Each board state below is indexed by the board selected by the calling thread, see lgw_board_select() */
+
 /* I2C temperature sensor handles */
-static int     ts_fd = -1;
-static uint8_t ts_addr = 0xFF;
+static int     ts_fd[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = -1 };
+static uint8_t ts_addr[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = 0xFF };
+
+/* Last temperature read from the sensor, see temperature_get() */
+static float            ts_temperature[LGW_BOARD_NB];
+static struct timespec  ts_time[LGW_BOARD_NB];
+static bool             ts_valid[LGW_BOARD_NB];
+
+/* No concentrator behind the link (RX capture replay...), only the SX1302 registers are configured */
+static bool chip_simulated[LGW_BOARD_NB];
+
+/* RX and TX paths locks, SPI accesses are serialized by the register layer (see lgw_reg_lock) */
+static pthread_mutex_t mx_hal_rx[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = PTHREAD_MUTEX_INITIALIZER }; /* RX buffer, temperature cache */
+static pthread_mutex_t mx_hal_tx[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = PTHREAD_MUTEX_INITIALIZER }; /* TX programming, staged packets */
+
+/* Staged packets, see lgw_tx_stage() */
+static struct tx_stage_s tx_stage[LGW_BOARD_NB][LGW_RF_CHAIN_NB];
+static uint32_t tx_stage_last_id[LGW_BOARD_NB];
+
+/* lgw_receive calls leaving packets to be returned by the next one, see lgw_get_rx_stats() */
+static uint32_t rx_nb_pkt_left[LGW_BOARD_NB];
+
+/* Time spent in each phase of the last lgw_start, see lgw_get_start_stats() */
+static struct lgw_start_stats_s start_stats[LGW_BOARD_NB];
+static bool             start_stats_valid[LGW_BOARD_NB];
+static struct timespec  phase_time[LGW_BOARD_NB]; /* beginning of the current phase */
+static uint32_t         phase_spi[LGW_BOARD_NB];  /* SPI messages sent before the current phase */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
 int32_t lgw_sf_getval(int x);
 int32_t lgw_bw_getval(int x);
+uint32_t lgw_lora_toa_us(uint8_t bandwidth, uint32_t datarate, uint8_t coderate, uint16_t preamble, bool no_header, bool crc_en, uint16_t size);
+uint32_t lgw_fsk_toa_us(uint32_t datarate, uint16_t preamble, uint8_t sync_word_size, bool crc_en, uint16_t size);
+
+/* -------------------------------------------------------------------------- */
+/* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
+
+/* Concentrator board accessed by the calling thread */
+extern __thread lgw_handle_t lgw_board;
+
+/* SPI messages counters, see lgw_get_start_stats() */
+extern uint32_t lgw_com_nb_transfers[LGW_BOARD_NB];
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
@@ -218,106 +285,105 @@ int32_t lgw_sf_getval(int x) {
     }
 }
 
-/* -------------------------------------------------------------------------- */
-/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_board_setconf(struct lgw_conf_board_s * conf) {
-    CHECK_NULL(conf);
+/* Returns 0 if the modulation parameters are not supported */
+uint32_t lgw_lora_toa_us(uint8_t bandwidth, uint32_t datarate, uint8_t coderate, uint16_t preamble, bool no_header, bool crc_en, uint16_t size) {
+    int32_t bw_khz, sf, num, den, blocks;
+    uint32_t payloadSymbNb;
+    uint64_t qsymb;
 
-    /* check if the concentrator is running */
-    if (CONTEXT_STARTED == true) {
-        DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
-        return LGW_HAL_ERROR;
+    bw_khz = lgw_bw_getval(bandwidth) / 1000;
+    sf = lgw_sf_getval(datarate);
+    if ((bw_khz <= 0) || (sf == -1)) {
+        return 0;
+    }
+    /* TODO: update formula for SF5/SF6 */
+    if (sf < 7) {
+        sf = 7;
     }
 
-    /* set internal config according to parameters */
-    CONTEXT_LWAN_PUBLIC = conf->lorawan_public;
-    CONTEXT_BOARD.clksrc = conf->clksrc;
-    CONTEXT_BOARD.full_duplex = conf->full_duplex;
-    strncpy(CONTEXT_SPI, conf->spidev_path, sizeof CONTEXT_SPI);
-    CONTEXT_SPI[sizeof CONTEXT_SPI - 1] = '\0'; /* ensure string termination */
+    /* Number of payload symbols */
+    num = 8*size - 4*sf + 28 + ((crc_en == true) ? 16 : 0) - ((no_header == true) ? 20 : 0);
+    den = toa_bits_per_block[sf];
+    blocks = (num > 0) ? ((num + den - 1) / den) : (num / den); /* ceil(num/den), C division truncates toward zero */
+    payloadSymbNb = 8 + blocks * (coderate + 4);
 
-    DEBUG_PRINTF("Note: board configuration: spidev_path: %s, lorawan_public:%d, clksrc:%d, full_duplex:%d\n",  CONTEXT_SPI,
-                                                                                                                CONTEXT_LWAN_PUBLIC,
-                                                                                                                CONTEXT_BOARD.clksrc,
-                                                                                                                CONTEXT_BOARD.full_duplex);
+    /* (preamble + 4.25 + payload) symbols of 2^SF/BW ms, in quarters of symbol to stay exact */
+    qsymb = (uint64_t)(4 * ((uint32_t)preamble + payloadSymbNb) + 17) << sf;
 
-    return LGW_HAL_SUCCESS;
+    return (uint32_t)((qsymb * 250) / (uint32_t)bw_khz);
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_rxrf_setconf(uint8_t rf_chain, struct lgw_conf_rxrf_s * conf) {
-    CHECK_NULL(conf);
+/* Returns 0 if the datarate is null */
+uint32_t lgw_fsk_toa_us(uint32_t datarate, uint16_t preamble, uint8_t sync_word_size, bool crc_en, uint16_t size) {
+    uint64_t bits;
 
-    /* check if the concentrator is running */
-    if (CONTEXT_STARTED == true) {
-        DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
-        return LGW_HAL_ERROR;
+    if (datarate == 0) {
+        return 0;
     }
 
-    if (conf->enable == false) {
-        /* nothing to do */
-        DEBUG_PRINTF("Note: rf_chain %d disabled\n", rf_chain);
-        return LGW_HAL_SUCCESS;
-    }
+    /* PREAMBLE + SYNC_WORD + PKT_LEN + PKT_PAYLOAD + CRC */
+    bits = 8 * (uint64_t)(preamble + sync_word_size + 1 + size + ((crc_en == true) ? 2 : 0));
 
-    /* check input range (segfault prevention) */
-    if (rf_chain >= LGW_RF_CHAIN_NB) {
-        DEBUG_MSG("ERROR: NOT A VALID RF_CHAIN NUMBER\n");
-        return LGW_HAL_ERROR;
+    return (uint32_t)((bits * 1000000) / datarate);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Record the duration and SPI traffic of a phase of lgw_start, the next phase begins now */
+static void phase_end(struct lgw_start_phase_s * phase) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    phase->duration_us = (uint32_t)((now.tv_sec - phase_time[lgw_board].tv_sec) * 1000000 + (now.tv_nsec - phase_time[lgw_board].tv_nsec) / 1000);
+    phase->spi_transfers = lgw_com_nb_transfers[lgw_board] - phase_spi[lgw_board];
+    phase_time[lgw_board] = now;
+    phase_spi[lgw_board] = lgw_com_nb_transfers[lgw_board];
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Get the concentrator temperature, reading the sensor only if the cached value is too old */
+static int temperature_get(bool refresh, float * temperature) {
+    struct timespec now;
+    int64_t age_ms;
+
+    if (chip_simulated[lgw_board] == true) {
+        *temperature = TEMPERATURE_SIMULATED;
+        return LGW_HAL_SUCCESS;
     }
 
-    /* check if radio type is supported */
-    if ((conf->type != LGW_RADIO_TYPE_SX1255) && (conf->type != LGW_RADIO_TYPE_SX1257) && (conf->type != LGW_RADIO_TYPE_SX1250)) {
-        DEBUG_PRINTF("ERROR: NOT A VALID RADIO TYPE (%d)\n", conf->type);
-        return LGW_HAL_ERROR;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((refresh == false) && (ts_valid[lgw_board] == true)) {
+        age_ms = ((int64_t)(now.tv_sec - ts_time[lgw_board].tv_sec) * 1000) + ((now.tv_nsec - ts_time[lgw_board].tv_nsec) / 1000000);
+        if (age_ms < (int64_t)CONTEXT_BOARD.temperature_refresh_ms) {
+            *temperature = ts_temperature[lgw_board];
+            return LGW_HAL_SUCCESS;
+        }
     }
 
-    /* check if the radio central frequency is valid */
-    if ((conf->freq_hz < LGW_RF_RX_FREQ_MIN) || (conf->freq_hz > LGW_RF_RX_FREQ_MAX)) {
-        DEBUG_PRINTF("ERROR: NOT A VALID RADIO CENTER FREQUENCY, PLEASE CHECK IF IT HAS BEEN GIVEN IN HZ (%u)\n", conf->freq_hz);
+    if (stts751_get_temperature(ts_fd[lgw_board], ts_addr[lgw_board], &ts_temperature[lgw_board]) != LGW_I2C_SUCCESS) {
+        ts_valid[lgw_board] = false;
         return LGW_HAL_ERROR;
     }
+    ts_time[lgw_board] = now;
+    ts_valid[lgw_board] = true;
+    DEBUG_PRINTF("Note: temperature sensor read, %.1f C\n", ts_temperature[lgw_board]);
 
-    /* set internal config according to parameters */
-    CONTEXT_RF_CHAIN[rf_chain].enable = conf->enable;
-    CONTEXT_RF_CHAIN[rf_chain].freq_hz = conf->freq_hz;
-    CONTEXT_RF_CHAIN[rf_chain].rssi_offset = conf->rssi_offset;
-    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_a = conf->rssi_tcomp.coeff_a;
-    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_b = conf->rssi_tcomp.coeff_b;
-    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_c = conf->rssi_tcomp.coeff_c;
-    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_d = conf->rssi_tcomp.coeff_d;
-    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_e = conf->rssi_tcomp.coeff_e;
-    CONTEXT_RF_CHAIN[rf_chain].type = conf->type;
-    CONTEXT_RF_CHAIN[rf_chain].tx_enable = conf->tx_enable;
-    CONTEXT_RF_CHAIN[rf_chain].single_input_mode = conf->single_input_mode;
-
-    DEBUG_PRINTF("Note: rf_chain %d configuration; en:%d freq:%d rssi_offset:%f radio_type:%d tx_enable:%d single_input_mode:%d\n",  rf_chain,
-                                                                                                                CONTEXT_RF_CHAIN[rf_chain].enable,
-                                                                                                                CONTEXT_RF_CHAIN[rf_chain].freq_hz,
-                                                                                                                CONTEXT_RF_CHAIN[rf_chain].rssi_offset,
-                                                                                                                CONTEXT_RF_CHAIN[rf_chain].type,
-                                                                                                                CONTEXT_RF_CHAIN[rf_chain].tx_enable,
-                                                                                                                CONTEXT_RF_CHAIN[rf_chain].single_input_mode);
-
+    *temperature = ts_temperature[lgw_board];
     return LGW_HAL_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf) {
+/* check an IF chain configuration and commit it to the given context */
+static int rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf, struct lgw_conf_rxif_s * if_cfg, struct lgw_conf_rxif_s * lora_service_cfg, struct lgw_conf_rxif_s * fsk_cfg) {
     int32_t bw_hz;
     uint32_t rf_rx_bandwidth;
 
-    CHECK_NULL(conf);
-
-    /* check if the concentrator is running */
-    if (CONTEXT_STARTED == true) {
-        DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
-        return LGW_HAL_ERROR;
-    }
-
     /* check input range (segfault prevention) */
     if (if_chain >= LGW_IF_CHAIN_NB) {
         DEBUG_PRINTF("ERROR: %d NOT A VALID IF_CHAIN NUMBER\n", if_chain);
@@ -326,8 +392,8 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf) {
 
     /* if chain is disabled, don't care about most parameters */
     if (conf->enable == false) {
-        CONTEXT_IF_CHAIN[if_chain].enable = false;
-        CONTEXT_IF_CHAIN[if_chain].freq_hz = 0;
+        if_cfg[if_chain].enable = false;
+        if_cfg[if_chain].freq_hz = 0;
         DEBUG_PRINTF("Note: if_chain %d disabled\n", if_chain);
         return LGW_HAL_SUCCESS;
     }
@@ -383,21 +449,21 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf) {
                 return LGW_HAL_ERROR;
             }
             /* set internal configuration  */
-            CONTEXT_IF_CHAIN[if_chain].enable = conf->enable;
-            CONTEXT_IF_CHAIN[if_chain].rf_chain = conf->rf_chain;
-            CONTEXT_IF_CHAIN[if_chain].freq_hz = conf->freq_hz;
-            CONTEXT_LORA_SERVICE.bandwidth = conf->bandwidth;
-            CONTEXT_LORA_SERVICE.datarate = conf->datarate;
-            CONTEXT_LORA_SERVICE.implicit_hdr = conf->implicit_hdr;
-            CONTEXT_LORA_SERVICE.implicit_payload_length = conf->implicit_payload_length;
-            CONTEXT_LORA_SERVICE.implicit_crc_en   = conf->implicit_crc_en;
-            CONTEXT_LORA_SERVICE.implicit_coderate = conf->implicit_coderate;
+            if_cfg[if_chain].enable = conf->enable;
+            if_cfg[if_chain].rf_chain = conf->rf_chain;
+            if_cfg[if_chain].freq_hz = conf->freq_hz;
+            lora_service_cfg->bandwidth = conf->bandwidth;
+            lora_service_cfg->datarate = conf->datarate;
+            lora_service_cfg->implicit_hdr = conf->implicit_hdr;
+            lora_service_cfg->implicit_payload_length = conf->implicit_payload_length;
+            lora_service_cfg->implicit_crc_en   = conf->implicit_crc_en;
+            lora_service_cfg->implicit_coderate = conf->implicit_coderate;
 
             DEBUG_PRINTF("Note: LoRa 'std' if_chain %d configuration; en:%d freq:%d bw:%d dr:%d\n", if_chain,
-                                                                                                    CONTEXT_IF_CHAIN[if_chain].enable,
-                                                                                                    CONTEXT_IF_CHAIN[if_chain].freq_hz,
-                                                                                                    CONTEXT_LORA_SERVICE.bandwidth,
-                                                                                                    CONTEXT_LORA_SERVICE.datarate);
+                                                                                                    if_cfg[if_chain].enable,
+                                                                                                    if_cfg[if_chain].freq_hz,
+                                                                                                    lora_service_cfg->bandwidth,
+                                                                                                    lora_service_cfg->datarate);
             break;
 
         case IF_LORA_MULTI:
@@ -418,13 +484,13 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf) {
                 return LGW_HAL_ERROR;
             }
             /* set internal configuration  */
-            CONTEXT_IF_CHAIN[if_chain].enable = conf->enable;
-            CONTEXT_IF_CHAIN[if_chain].rf_chain = conf->rf_chain;
-            CONTEXT_IF_CHAIN[if_chain].freq_hz = conf->freq_hz;
+            if_cfg[if_chain].enable = conf->enable;
+            if_cfg[if_chain].rf_chain = conf->rf_chain;
+            if_cfg[if_chain].freq_hz = conf->freq_hz;
 
             DEBUG_PRINTF("Note: LoRa 'multi' if_chain %d configuration; en:%d freq:%d\n",   if_chain,
-                                                                                            CONTEXT_IF_CHAIN[if_chain].enable,
-                                                                                            CONTEXT_IF_CHAIN[if_chain].freq_hz);
+                                                                                            if_cfg[if_chain].enable,
+                                                                                            if_cfg[if_chain].freq_hz);
             break;
 
         case IF_FSK_STD:
@@ -445,29 +511,355 @@ int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf) {
                 return LGW_HAL_ERROR;
             }
             /* set internal configuration  */
-            CONTEXT_IF_CHAIN[if_chain].enable = conf->enable;
-            CONTEXT_IF_CHAIN[if_chain].rf_chain = conf->rf_chain;
-            CONTEXT_IF_CHAIN[if_chain].freq_hz = conf->freq_hz;
-            CONTEXT_FSK.bandwidth = conf->bandwidth;
-            CONTEXT_FSK.datarate = conf->datarate;
+            if_cfg[if_chain].enable = conf->enable;
+            if_cfg[if_chain].rf_chain = conf->rf_chain;
+            if_cfg[if_chain].freq_hz = conf->freq_hz;
+            fsk_cfg->bandwidth = conf->bandwidth;
+            fsk_cfg->datarate = conf->datarate;
             if (conf->sync_word > 0) {
-                CONTEXT_FSK.sync_word_size = conf->sync_word_size;
-                CONTEXT_FSK.sync_word = conf->sync_word;
+                fsk_cfg->sync_word_size = conf->sync_word_size;
+                fsk_cfg->sync_word = conf->sync_word;
             }
             DEBUG_PRINTF("Note: FSK if_chain %d configuration; en:%d freq:%d bw:%d dr:%d (%d real dr) sync:0x%0*" PRIu64 "\n", if_chain,
-                                                                                                                        CONTEXT_IF_CHAIN[if_chain].enable,
-                                                                                                                        CONTEXT_IF_CHAIN[if_chain].freq_hz,
-                                                                                                                        CONTEXT_FSK.bandwidth,
-                                                                                                                        CONTEXT_FSK.datarate,
-                                                                                                                        LGW_XTAL_FREQU/(LGW_XTAL_FREQU/CONTEXT_FSK.datarate),
-                                                                                                                        2*CONTEXT_FSK.sync_word_size,
-                                                                                                                        CONTEXT_FSK.sync_word);
+                                                                                                                        if_cfg[if_chain].enable,
+                                                                                                                        if_cfg[if_chain].freq_hz,
+                                                                                                                        fsk_cfg->bandwidth,
+                                                                                                                        fsk_cfg->datarate,
+                                                                                                                        LGW_XTAL_FREQU/(LGW_XTAL_FREQU/fsk_cfg->datarate),
+                                                                                                                        2*fsk_cfg->sync_word_size,
+                                                                                                                        fsk_cfg->sync_word);
             break;
 
-        default:
-            DEBUG_PRINTF("ERROR: IF CHAIN %d TYPE NOT SUPPORTED\n", if_chain);
+        default:
+            DEBUG_PRINTF("ERROR: IF CHAIN %d TYPE NOT SUPPORTED\n", if_chain);
+            return LGW_HAL_ERROR;
+    }
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* program the changed parts of a channel plan into the running chip, see lgw_rxif_reconf() */
+static int rxif_reconf_chip(bool chan_changed, bool service_changed, bool fsk_changed, struct lgw_conf_rxif_s * if_cfg, struct lgw_conf_rxif_s * lora_service_cfg, struct lgw_conf_rxif_s * fsk_cfg) {
+    if (chan_changed == true) {
+        if (sx1302_channelizer_configure(if_cfg, false) != LGW_REG_SUCCESS) {
+            return LGW_REG_ERROR;
+        }
+    }
+
+    if (service_changed == true) {
+        if (if_cfg[8].enable == true) {
+            if (sx1302_lora_service_correlator_configure(lora_service_cfg) != LGW_REG_SUCCESS) {
+                return LGW_REG_ERROR;
+            }
+            if (sx1302_lora_service_modem_configure(lora_service_cfg, CONTEXT_RF_CHAIN[0].freq_hz) != LGW_REG_SUCCESS) {
+                return LGW_REG_ERROR;
+            }
+            if (sx1302_lora_syncword(CONTEXT_LWAN_PUBLIC, lora_service_cfg->datarate) != LGW_REG_SUCCESS) {
+                return LGW_REG_ERROR;
+            }
+        }
+        /* a disabled chain stops demodulating, an enabled one restarts with its new settings */
+        if (lgw_reg_w(SX1302_REG_COMMON_GEN_MBWSSF_MODEM_ENABLE, (if_cfg[8].enable == true) ? 0x01 : 0x00) != LGW_REG_SUCCESS) {
+            return LGW_REG_ERROR;
+        }
+    }
+
+    if (fsk_changed == true) {
+        if (if_cfg[9].enable == true) {
+            if (sx1302_fsk_configure(fsk_cfg) != LGW_REG_SUCCESS) {
+                return LGW_REG_ERROR;
+            }
+        }
+        if (lgw_reg_w(SX1302_REG_COMMON_GEN_FSK_MODEM_ENABLE, (if_cfg[9].enable == true) ? 0x01 : 0x00) != LGW_REG_SUCCESS) {
+            return LGW_REG_ERROR;
+        }
+    }
+
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* check a packet to be sent, see lgw_send() */
+static int tx_check(struct lgw_pkt_tx_s * pkt_data) {
+    /* check if the concentrator is running */
+    if (CONTEXT_STARTED == false) {
+        DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, START IT BEFORE SENDING\n");
+        return LGW_HAL_ERROR;
+    }
+
+    CHECK_NULL(pkt_data);
+
+    /* check input range (segfault prevention) */
+    if (pkt_data->rf_chain >= LGW_RF_CHAIN_NB) {
+        DEBUG_MSG("ERROR: INVALID RF_CHAIN TO SEND PACKETS\n");
+        return LGW_HAL_ERROR;
+    }
+
+    /* check input variables */
+    if (CONTEXT_RF_CHAIN[pkt_data->rf_chain].tx_enable == false) {
+        DEBUG_MSG("ERROR: SELECTED RF_CHAIN IS DISABLED FOR TX ON SELECTED BOARD\n");
+        return LGW_HAL_ERROR;
+    }
+    if (CONTEXT_RF_CHAIN[pkt_data->rf_chain].enable == false) {
+        DEBUG_MSG("ERROR: SELECTED RF_CHAIN IS DISABLED\n");
+        return LGW_HAL_ERROR;
+    }
+    if (!IS_TX_MODE(pkt_data->tx_mode)) {
+        DEBUG_MSG("ERROR: TX_MODE NOT SUPPORTED\n");
+        return LGW_HAL_ERROR;
+    }
+    if (pkt_data->modulation == MOD_LORA) {
+        if (!IS_LORA_BW(pkt_data->bandwidth)) {
+            DEBUG_MSG("ERROR: BANDWIDTH NOT SUPPORTED BY LORA TX\n");
+            return LGW_HAL_ERROR;
+        }
+        if (!IS_LORA_DR(pkt_data->datarate)) {
+            DEBUG_MSG("ERROR: DATARATE NOT SUPPORTED BY LORA TX\n");
+            return LGW_HAL_ERROR;
+        }
+        if (!IS_LORA_CR(pkt_data->coderate)) {
+            DEBUG_MSG("ERROR: CODERATE NOT SUPPORTED BY LORA TX\n");
+            return LGW_HAL_ERROR;
+        }
+        if (pkt_data->size > 255) {
+            DEBUG_MSG("ERROR: PAYLOAD LENGTH TOO BIG FOR LORA TX\n");
+            return LGW_HAL_ERROR;
+        }
+    } else if (pkt_data->modulation == MOD_FSK) {
+        if((pkt_data->f_dev < 1) || (pkt_data->f_dev > 200)) {
+            DEBUG_MSG("ERROR: TX FREQUENCY DEVIATION OUT OF ACCEPTABLE RANGE\n");
+            return LGW_HAL_ERROR;
+        }
+        if(!IS_FSK_DR(pkt_data->datarate)) {
+            DEBUG_MSG("ERROR: DATARATE NOT SUPPORTED BY FSK IF CHAIN\n");
+            return LGW_HAL_ERROR;
+        }
+        if (pkt_data->size > 255) {
+            DEBUG_MSG("ERROR: PAYLOAD LENGTH TOO BIG FOR FSK TX\n");
+            return LGW_HAL_ERROR;
+        }
+    } else if (pkt_data->modulation == MOD_CW) {
+        /* do nothing */
+    } else {
+        DEBUG_MSG("ERROR: INVALID TX MODULATION\n");
+        return LGW_HAL_ERROR;
+    }
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lgw_board_select(lgw_handle_t board) {
+    if (board >= LGW_BOARD_NB) {
+        DEBUG_PRINTF("ERROR: NOT A VALID BOARD (%u), %u BOARDS SUPPORTED\n", board, LGW_BOARD_NB);
+        return LGW_HAL_ERROR;
+    }
+
+    lgw_board = board;
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+lgw_handle_t lgw_board_selected(void) {
+    return lgw_board;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_board_setconf(struct lgw_conf_board_s * conf) {
+    CHECK_NULL(conf);
+
+    /* check if the concentrator is running */
+    if (CONTEXT_STARTED == true) {
+        DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
+        return LGW_HAL_ERROR;
+    }
+
+    /* check that the RX buffer can hold the largest packet */
+    if ((conf->rx_buffer_size != 0) && ((conf->rx_buffer_size < RX_BUFFER_PKT_MAX) || (conf->rx_buffer_size > RX_BUFFER_SIZE))) {
+        printf("ERROR: rx_buffer_size %u out of range [%u..%u]\n", conf->rx_buffer_size, RX_BUFFER_PKT_MAX, RX_BUFFER_SIZE);
+        return LGW_HAL_ERROR;
+    }
+
+    /* set internal config according to parameters */
+    CONTEXT_LWAN_PUBLIC = conf->lorawan_public;
+    CONTEXT_BOARD.clksrc = conf->clksrc;
+    CONTEXT_BOARD.full_duplex = conf->full_duplex;
+    strncpy(CONTEXT_SPI, conf->spidev_path, sizeof CONTEXT_SPI);
+    CONTEXT_SPI[sizeof CONTEXT_SPI - 1] = '\0'; /* ensure string termination */
+    CONTEXT_BOARD.spi_speed = (conf->spi_speed != 0) ? conf->spi_speed : SPI_SPEED;
+    CONTEXT_BOARD.spi_chunk_size = (conf->spi_chunk_size != 0) ? conf->spi_chunk_size : LGW_BURST_CHUNK;
+    CONTEXT_BOARD.temperature_refresh_ms = (conf->temperature_refresh_ms != 0) ? conf->temperature_refresh_ms : TEMPERATURE_REFRESH_MS;
+    strncpy(CONTEXT_BOARD.cal_cache_path, conf->cal_cache_path, sizeof CONTEXT_BOARD.cal_cache_path);
+    CONTEXT_BOARD.cal_cache_path[sizeof CONTEXT_BOARD.cal_cache_path - 1] = '\0'; /* ensure string termination */
+    CONTEXT_BOARD.fast_start = conf->fast_start;
+    strncpy(CONTEXT_BOARD.rx_capture_path, conf->rx_capture_path, sizeof CONTEXT_BOARD.rx_capture_path);
+    CONTEXT_BOARD.rx_capture_path[sizeof CONTEXT_BOARD.rx_capture_path - 1] = '\0'; /* ensure string termination */
+    CONTEXT_BOARD.rx_buffer_size = (conf->rx_buffer_size != 0) ? conf->rx_buffer_size : RX_BUFFER_SIZE;
+
+    DEBUG_PRINTF("Note: board configuration: spidev_path: %s, lorawan_public:%d, clksrc:%d, full_duplex:%d\n",  CONTEXT_SPI,
+                                                                                                                CONTEXT_LWAN_PUBLIC,
+                                                                                                                CONTEXT_BOARD.clksrc,
+                                                                                                                CONTEXT_BOARD.full_duplex);
+    DEBUG_PRINTF("Note: board configuration: spi_speed:%u, spi_chunk_size:%u, temperature_refresh_ms:%u, fast_start:%d, rx_buffer_size:%u\n", CONTEXT_BOARD.spi_speed,
+                                                                                                            CONTEXT_BOARD.spi_chunk_size,
+                                                                                                            CONTEXT_BOARD.temperature_refresh_ms,
+                                                                                                            CONTEXT_BOARD.fast_start,
+                                                                                                            CONTEXT_BOARD.rx_buffer_size);
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_rxrf_setconf(uint8_t rf_chain, struct lgw_conf_rxrf_s * conf) {
+    CHECK_NULL(conf);
+
+    /* check if the concentrator is running */
+    if (CONTEXT_STARTED == true) {
+        DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
+        return LGW_HAL_ERROR;
+    }
+
+    if (conf->enable == false) {
+        /* nothing to do */
+        DEBUG_PRINTF("Note: rf_chain %d disabled\n", rf_chain);
+        return LGW_HAL_SUCCESS;
+    }
+
+    /* check input range (segfault prevention) */
+    if (rf_chain >= LGW_RF_CHAIN_NB) {
+        DEBUG_MSG("ERROR: NOT A VALID RF_CHAIN NUMBER\n");
+        return LGW_HAL_ERROR;
+    }
+
+    /* check if radio type is supported */
+    if ((conf->type != LGW_RADIO_TYPE_SX1255) && (conf->type != LGW_RADIO_TYPE_SX1257) && (conf->type != LGW_RADIO_TYPE_SX1250)) {
+        DEBUG_PRINTF("ERROR: NOT A VALID RADIO TYPE (%d)\n", conf->type);
+        return LGW_HAL_ERROR;
+    }
+
+    /* check if the radio central frequency is valid */
+    if ((conf->freq_hz < LGW_RF_RX_FREQ_MIN) || (conf->freq_hz > LGW_RF_RX_FREQ_MAX)) {
+        DEBUG_PRINTF("ERROR: NOT A VALID RADIO CENTER FREQUENCY, PLEASE CHECK IF IT HAS BEEN GIVEN IN HZ (%u)\n", conf->freq_hz);
+        return LGW_HAL_ERROR;
+    }
+
+    /* set internal config according to parameters */
+    CONTEXT_RF_CHAIN[rf_chain].enable = conf->enable;
+    CONTEXT_RF_CHAIN[rf_chain].freq_hz = conf->freq_hz;
+    CONTEXT_RF_CHAIN[rf_chain].rssi_offset = conf->rssi_offset;
+    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_a = conf->rssi_tcomp.coeff_a;
+    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_b = conf->rssi_tcomp.coeff_b;
+    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_c = conf->rssi_tcomp.coeff_c;
+    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_d = conf->rssi_tcomp.coeff_d;
+    CONTEXT_RF_CHAIN[rf_chain].rssi_tcomp.coeff_e = conf->rssi_tcomp.coeff_e;
+    CONTEXT_RF_CHAIN[rf_chain].type = conf->type;
+    CONTEXT_RF_CHAIN[rf_chain].tx_enable = conf->tx_enable;
+    CONTEXT_RF_CHAIN[rf_chain].single_input_mode = conf->single_input_mode;
+
+    DEBUG_PRINTF("Note: rf_chain %d configuration; en:%d freq:%d rssi_offset:%f radio_type:%d tx_enable:%d single_input_mode:%d\n",  rf_chain,
+                                                                                                                CONTEXT_RF_CHAIN[rf_chain].enable,
+                                                                                                                CONTEXT_RF_CHAIN[rf_chain].freq_hz,
+                                                                                                                CONTEXT_RF_CHAIN[rf_chain].rssi_offset,
+                                                                                                                CONTEXT_RF_CHAIN[rf_chain].type,
+                                                                                                                CONTEXT_RF_CHAIN[rf_chain].tx_enable,
+                                                                                                                CONTEXT_RF_CHAIN[rf_chain].single_input_mode);
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_rxif_setconf(uint8_t if_chain, struct lgw_conf_rxif_s * conf) {
+    CHECK_NULL(conf);
+
+    /* check if the concentrator is running */
+    if (CONTEXT_STARTED == true) {
+        DEBUG_MSG("ERROR: CONCENTRATOR IS RUNNING, STOP IT BEFORE TOUCHING CONFIGURATION\n");
+        return LGW_HAL_ERROR;
+    }
+
+    return rxif_setconf(if_chain, conf, CONTEXT_IF_CHAIN, &CONTEXT_LORA_SERVICE, &CONTEXT_FSK);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_rxif_reconf(struct lgw_conf_rxif_s * conf) {
+    struct lgw_conf_rxif_s if_cfg[LGW_IF_CHAIN_NB];
+    struct lgw_conf_rxif_s lora_service_cfg;
+    struct lgw_conf_rxif_s fsk_cfg;
+    bool chan_changed = false;
+    bool service_changed;
+    bool fsk_changed;
+    int err = LGW_REG_SUCCESS;
+    int i;
+
+    CHECK_NULL(conf);
+
+    if (CONTEXT_STARTED == false) {
+        DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, USE LGW_RXIF_SETCONF\n");
+        return LGW_HAL_ERROR;
+    }
+
+    /* check the whole channel plan before touching the running one */
+    memcpy(if_cfg, CONTEXT_IF_CHAIN, sizeof if_cfg);
+    lora_service_cfg = CONTEXT_LORA_SERVICE;
+    fsk_cfg = CONTEXT_FSK;
+    for (i = 0; i < LGW_IF_CHAIN_NB; i++) {
+        if (rxif_setconf(i, &conf[i], if_cfg, &lora_service_cfg, &fsk_cfg) != LGW_HAL_SUCCESS) {
+            return LGW_HAL_ERROR;
+        }
+        if ((if_cfg[i].enable == true) && (CONTEXT_RF_CHAIN[if_cfg[i].rf_chain].enable == false)) {
+            DEBUG_PRINTF("ERROR: IF CHAIN %d ON DISABLED RF_CHAIN %u\n", i, if_cfg[i].rf_chain);
             return LGW_HAL_ERROR;
+        }
+        if ((if_cfg[i].enable != CONTEXT_IF_CHAIN[i].enable) || (if_cfg[i].rf_chain != CONTEXT_IF_CHAIN[i].rf_chain) || (if_cfg[i].freq_hz != CONTEXT_IF_CHAIN[i].freq_hz)) {
+            chan_changed = true;
+        }
+    }
+    service_changed = (if_cfg[8].enable != CONTEXT_IF_CHAIN[8].enable) ||
+                      ((if_cfg[8].enable == true) && ((lora_service_cfg.bandwidth != CONTEXT_LORA_SERVICE.bandwidth) ||
+                                                      (lora_service_cfg.datarate != CONTEXT_LORA_SERVICE.datarate) ||
+                                                      (lora_service_cfg.implicit_hdr != CONTEXT_LORA_SERVICE.implicit_hdr) ||
+                                                      (lora_service_cfg.implicit_payload_length != CONTEXT_LORA_SERVICE.implicit_payload_length) ||
+                                                      (lora_service_cfg.implicit_crc_en != CONTEXT_LORA_SERVICE.implicit_crc_en) ||
+                                                      (lora_service_cfg.implicit_coderate != CONTEXT_LORA_SERVICE.implicit_coderate)));
+    fsk_changed = (if_cfg[9].enable != CONTEXT_IF_CHAIN[9].enable) ||
+                  ((if_cfg[9].enable == true) && ((fsk_cfg.bandwidth != CONTEXT_FSK.bandwidth) ||
+                                                  (fsk_cfg.datarate != CONTEXT_FSK.datarate) ||
+                                                  (fsk_cfg.sync_word_size != CONTEXT_FSK.sync_word_size) ||
+                                                  (fsk_cfg.sync_word != CONTEXT_FSK.sync_word)));
+
+    /* no packet fetched nor sent while the plan changes, the radios keep running */
+    pthread_mutex_lock(&mx_hal_rx[lgw_board]);
+    pthread_mutex_lock(&mx_hal_tx[lgw_board]);
+    if (chip_simulated[lgw_board] == false) {
+        err = rxif_reconf_chip(chan_changed, service_changed, fsk_changed, if_cfg, &lora_service_cfg, &fsk_cfg);
+    }
+    if (err == LGW_REG_SUCCESS) {
+        /* the context only describes what the chip runs */
+        memcpy(CONTEXT_IF_CHAIN, if_cfg, sizeof if_cfg);
+        CONTEXT_LORA_SERVICE = lora_service_cfg;
+        CONTEXT_FSK = fsk_cfg;
     }
+    pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
+    pthread_mutex_unlock(&mx_hal_rx[lgw_board]);
+
+    if (err != LGW_REG_SUCCESS) {
+        printf("ERROR: failed to reconfigure the channel plan, the previous one may be partially overwritten\n");
+        return LGW_HAL_ERROR;
+    }
+
+    printf("INFO: channel plan reconfigured (channels:%s lora_std:%s fsk:%s)\n", (chan_changed == true) ? "updated" : "unchanged",
+                                                                              (service_changed == true) ? "updated" : "unchanged",
+                                                                              (fsk_changed == true) ? "updated" : "unchanged");
 
     return LGW_HAL_SUCCESS;
 }
@@ -541,6 +933,21 @@ int lgw_timestamp_setconf(struct lgw_conf_timestamp_s * conf) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+int lgw_rxfilter_setconf(struct lgw_conf_rxfilter_s * conf) {
+    int err;
+
+    CHECK_NULL(conf);
+
+    /* applied between two lgw_receive calls */
+    pthread_mutex_lock(&mx_hal_rx[lgw_board]);
+    err = lgw_filter_setconf(conf);
+    pthread_mutex_unlock(&mx_hal_rx[lgw_board]);
+
+    return (err == LGW_FILTER_SUCCESS) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int lgw_debug_setconf(struct lgw_conf_debug_s * conf) {
     int i;
 
@@ -572,52 +979,118 @@ int lgw_debug_setconf(struct lgw_conf_debug_s * conf) {
 int lgw_start(void) {
     int i, err;
     int reg_stat;
+    const char * cal_cache_path;
+    float cal_temperature = 0.0;
+    struct timespec start_time;
+    uint32_t start_spi;
 
     if (CONTEXT_STARTED == true) {
         DEBUG_MSG("Note: LoRa concentrator already started, restarting it now\n");
     }
 
+    memset(&start_stats[lgw_board], 0, sizeof start_stats[lgw_board]);
+    start_stats_valid[lgw_board] = false;
+    clock_gettime(CLOCK_MONOTONIC, &phase_time[lgw_board]);
+    phase_spi[lgw_board] = lgw_com_nb_transfers[lgw_board];
+    start_time = phase_time[lgw_board];
+    start_spi = phase_spi[lgw_board];
+
     reg_stat = lgw_connect(CONTEXT_SPI);
     if (reg_stat == LGW_REG_ERROR) {
         DEBUG_MSG("ERROR: FAIL TO CONNECT BOARD\n");
         return LGW_HAL_ERROR;
     }
 
-    /* Calibrate radios */
-    err = sx1302_radio_calibrate(&CONTEXT_RF_CHAIN[0], CONTEXT_BOARD.clksrc, &CONTEXT_TX_GAIN_LUT[0]);
-    if (err != LGW_REG_SUCCESS) {
-        printf("ERROR: radio calibration failed\n");
+    /* Configure SPI clock and memory burst size before loading firmwares */
+    reg_stat = lgw_reg_spi_setconf(CONTEXT_BOARD.spi_speed, CONTEXT_BOARD.spi_chunk_size);
+    if (reg_stat == LGW_REG_ERROR) {
+        printf("ERROR: failed to configure SPI link (speed:%u Hz, chunk size:%u)\n", CONTEXT_BOARD.spi_speed, CONTEXT_BOARD.spi_chunk_size);
         return LGW_HAL_ERROR;
     }
+    phase_end(&start_stats[lgw_board].connect);
 
-    /* Setup radios for RX */
-    for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
-        if (CONTEXT_RF_CHAIN[i].enable == true) {
-            sx1302_radio_reset(i, CONTEXT_RF_CHAIN[i].type);
-            switch (CONTEXT_RF_CHAIN[i].type) {
-                case LGW_RADIO_TYPE_SX1250:
-                    sx1250_setup(i, CONTEXT_RF_CHAIN[i].freq_hz, CONTEXT_RF_CHAIN[i].single_input_mode);
-                    break;
-                case LGW_RADIO_TYPE_SX1255:
-                case LGW_RADIO_TYPE_SX1257:
-                    sx125x_setup(i, CONTEXT_BOARD.clksrc, true, CONTEXT_RF_CHAIN[i].type, CONTEXT_RF_CHAIN[i].freq_hz);
-                    break;
-                default:
-                    DEBUG_PRINTF("ERROR: RADIO TYPE NOT SUPPORTED (RF_CHAIN %d)\n", i);
-                    return LGW_HAL_ERROR;
+    /* Radios, temperature sensor and firmwares are only brought up on a real concentrator */
+    chip_simulated[lgw_board] = lgw_com_simulated();
+    if (chip_simulated[lgw_board] == true) {
+        printf("INFO: no concentrator behind the %s link, only the SX1302 registers are configured\n", lgw_com_name());
+    }
+
+    /* Poll radios status during bring-up, or wait for worst case delays */
+    sx1302_radio_fast_start(CONTEXT_BOARD.fast_start);
+
+    if (chip_simulated[lgw_board] == false) {
+        /* Try to configure temperature sensor STTS751-0DP3F */
+        ts_addr[lgw_board] = I2C_PORT_TEMP_SENSOR_0;
+        i2c_linuxdev_open(I2C_DEVICE, ts_addr[lgw_board], &ts_fd[lgw_board]);
+        err = stts751_configure(ts_fd[lgw_board], ts_addr[lgw_board]);
+        if (err != LGW_I2C_SUCCESS) {
+            i2c_linuxdev_close(ts_fd[lgw_board]);
+            ts_fd[lgw_board] = -1;
+            /* Not found, try to configure temperature sensor STTS751-1DP3F */
+            ts_addr[lgw_board] = I2C_PORT_TEMP_SENSOR_1;
+            i2c_linuxdev_open(I2C_DEVICE, ts_addr[lgw_board], &ts_fd[lgw_board]);
+            err = stts751_configure(ts_fd[lgw_board], ts_addr[lgw_board]);
+            if (err != LGW_I2C_SUCCESS) {
+                printf("ERROR: failed to configure the temperature sensor\n");
+                return LGW_HAL_ERROR;
+            }
+        }
+        ts_valid[lgw_board] = false;
+    }
+
+    if (chip_simulated[lgw_board] == false) {
+        /* Calibrate radios, or restore a previous calibration done in the same conditions */
+        cal_cache_path = NULL;
+        if (CONTEXT_BOARD.cal_cache_path[0] != '\0') {
+            if (temperature_get(true, &cal_temperature) == LGW_HAL_SUCCESS) {
+                cal_cache_path = CONTEXT_BOARD.cal_cache_path;
+            } else {
+                printf("WARNING: temperature unknown, calibration cache not used\n");
             }
-            sx1302_radio_set_mode(i, CONTEXT_RF_CHAIN[i].type);
+        }
+        err = sx1302_radio_calibrate(&CONTEXT_RF_CHAIN[0], CONTEXT_BOARD.clksrc, &CONTEXT_TX_GAIN_LUT[0], cal_cache_path, cal_temperature, &start_stats[lgw_board].cal_fw);
+        if (err != LGW_REG_SUCCESS) {
+            printf("ERROR: radio calibration failed\n");
+            return LGW_HAL_ERROR;
         }
     }
+    phase_end(&start_stats[lgw_board].calibration);
+
+    if (chip_simulated[lgw_board] == false) {
+        /* Setup radios for RX */
+        for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
+            if (CONTEXT_RF_CHAIN[i].enable == true) {
+                sx1302_radio_reset(i, CONTEXT_RF_CHAIN[i].type);
+                switch (CONTEXT_RF_CHAIN[i].type) {
+                    case LGW_RADIO_TYPE_SX1250:
+                        sx1250_setup(i, CONTEXT_RF_CHAIN[i].freq_hz, CONTEXT_RF_CHAIN[i].single_input_mode);
+                        break;
+                    case LGW_RADIO_TYPE_SX1255:
+                    case LGW_RADIO_TYPE_SX1257:
+                        sx125x_setup(i, CONTEXT_BOARD.clksrc, true, CONTEXT_RF_CHAIN[i].type, CONTEXT_RF_CHAIN[i].freq_hz);
+                        break;
+                    default:
+                        DEBUG_PRINTF("ERROR: RADIO TYPE NOT SUPPORTED (RF_CHAIN %d)\n", i);
+                        return LGW_HAL_ERROR;
+                }
+                sx1302_radio_set_mode(i, CONTEXT_RF_CHAIN[i].type);
+            }
+        }
 
-    /* Select the radio which provides the clock to the sx1302 */
-    sx1302_radio_clock_select(CONTEXT_BOARD.clksrc);
+        /* Select the radio which provides the clock to the sx1302 */
+        sx1302_radio_clock_select(CONTEXT_BOARD.clksrc);
 
-    /* Release host control on radio (will be controlled by AGC) */
-    sx1302_radio_host_ctrl(false);
+        /* Release host control on radio (will be controlled by AGC) */
+        sx1302_radio_host_ctrl(false);
+    }
+    phase_end(&start_stats[lgw_board].radio_setup);
 
     /* Basic initialization of the sx1302 */
     sx1302_init(&CONTEXT_TIMESTAMP);
+    sx1302_rx_buffer_setconf(CONTEXT_BOARD.rx_buffer_size); /* range checked by lgw_board_setconf */
+    rx_nb_pkt_left[lgw_board] = 0;
+    lgw_filter_reset(); /* counter restarted */
+    memset(tx_stage[lgw_board], 0, sizeof tx_stage[lgw_board]); /* TX modems reset */
 
     /* Configure PA/LNA LUTs */
     sx1302_pa_lna_lut_configure();
@@ -648,34 +1121,39 @@ int lgw_start(void) {
 
     /* enable demodulators - to be done before starting AGC/ARB */
     sx1302_modem_enable();
-
-    /* Load firmware */
-    switch (CONTEXT_RF_CHAIN[CONTEXT_BOARD.clksrc].type) {
-        case LGW_RADIO_TYPE_SX1250:
-            DEBUG_MSG("Loading AGC fw for sx1250\n");
-            if (sx1302_agc_load_firmware(agc_firmware_sx1250) != LGW_HAL_SUCCESS) {
-                return LGW_HAL_ERROR;
-            }
-            break;
-        case LGW_RADIO_TYPE_SX1257:
-            DEBUG_MSG("Loading AGC fw for sx125x\n");
-            if (sx1302_agc_load_firmware(agc_firmware_sx125x) != LGW_HAL_SUCCESS) {
-                return LGW_HAL_ERROR;
-            }
-            break;
-        default:
-            break;
-    }
-    if (sx1302_agc_start(FW_VERSION_AGC, CONTEXT_RF_CHAIN[CONTEXT_BOARD.clksrc].type, SX1302_AGC_RADIO_GAIN_AUTO, SX1302_AGC_RADIO_GAIN_AUTO, (CONTEXT_BOARD.full_duplex == true) ? 1 : 0) != LGW_HAL_SUCCESS) {
-        return LGW_HAL_ERROR;
-    }
-    DEBUG_MSG("Loading ARB fw\n");
-    if (sx1302_arb_load_firmware(arb_firmware) != LGW_HAL_SUCCESS) {
-        return LGW_HAL_ERROR;
-    }
-    if (sx1302_arb_start(FW_VERSION_ARB) != LGW_HAL_SUCCESS) {
-        return LGW_HAL_ERROR;
+    phase_end(&start_stats[lgw_board].sx1302_config);
+
+    if (chip_simulated[lgw_board] == false) {
+        /* Load firmware */
+        switch (CONTEXT_RF_CHAIN[CONTEXT_BOARD.clksrc].type) {
+            case LGW_RADIO_TYPE_SX1250:
+                DEBUG_MSG("Loading AGC fw for sx1250\n");
+                if (sx1302_agc_load_firmware(agc_firmware_sx1250) != LGW_HAL_SUCCESS) {
+                    return LGW_HAL_ERROR;
+                }
+                break;
+            case LGW_RADIO_TYPE_SX1257:
+                DEBUG_MSG("Loading AGC fw for sx125x\n");
+                if (sx1302_agc_load_firmware(agc_firmware_sx125x) != LGW_HAL_SUCCESS) {
+                    return LGW_HAL_ERROR;
+                }
+                break;
+            default:
+                break;
+        }
+        if (sx1302_agc_start(FW_VERSION_AGC, CONTEXT_RF_CHAIN[CONTEXT_BOARD.clksrc].type, SX1302_AGC_RADIO_GAIN_AUTO, SX1302_AGC_RADIO_GAIN_AUTO, (CONTEXT_BOARD.full_duplex == true) ? 1 : 0) != LGW_HAL_SUCCESS) {
+            return LGW_HAL_ERROR;
+        }
+        phase_end(&start_stats[lgw_board].agc_fw);
+        DEBUG_MSG("Loading ARB fw\n");
+        if (sx1302_arb_load_firmware(arb_firmware) != LGW_HAL_SUCCESS) {
+            return LGW_HAL_ERROR;
+        }
+        if (sx1302_arb_start(FW_VERSION_ARB) != LGW_HAL_SUCCESS) {
+            return LGW_HAL_ERROR;
+        }
     }
+    phase_end(&start_stats[lgw_board].arb_fw);
 
     /* static TX configuration */
     sx1302_tx_configure(CONTEXT_RF_CHAIN[CONTEXT_BOARD.clksrc].type);
@@ -711,34 +1189,43 @@ int lgw_start(void) {
     }
 #endif
 
+    /* Log the RX buffer content for later replay */
+    if (CONTEXT_BOARD.rx_capture_path[0] != '\0') {
+        if (lgw_capture_start(CONTEXT_BOARD.rx_capture_path) != LGW_CAPTURE_SUCCESS) {
+            return LGW_HAL_ERROR;
+        }
+    }
+
     /* Configure the pseudo-random generator (For Debug) */
     dbg_init_random();
 
+    /* Check the payloads of the reference devices (For Debug) */
+    if (CONTEXT_DEBUG.nb_ref_payload > 0) {
+        if (dbg_payload_check_start(&CONTEXT_DEBUG, log_file) != 0) {
+            return LGW_HAL_ERROR;
+        }
+    }
+
 #if 0
     /* Configure a GPIO to be toggled for debug purpose */
     dbg_init_gpio();
 #endif
 
-    /* Try to configure temperature sensor STTS751-0DP3F */
-    ts_addr = I2C_PORT_TEMP_SENSOR_0;
-    i2c_linuxdev_open(I2C_DEVICE, ts_addr, &ts_fd);
-    err = stts751_configure(ts_fd, ts_addr);
-    if (err != LGW_I2C_SUCCESS) {
-        i2c_linuxdev_close(ts_fd);
-        ts_fd = -1;
-        /* Not found, try to configure temperature sensor STTS751-1DP3F */
-        ts_addr = I2C_PORT_TEMP_SENSOR_1;
-        i2c_linuxdev_open(I2C_DEVICE, ts_addr, &ts_fd);
-        err = stts751_configure(ts_fd, ts_addr);
-        if (err != LGW_I2C_SUCCESS) {
-            printf("ERROR: failed to configure the temperature sensor\n");
-            return LGW_HAL_ERROR;
-        }
-    }
 
     /* set hal state */
     CONTEXT_STARTED = true;
 
+    phase_time[lgw_board] = start_time;
+    phase_spi[lgw_board] = start_spi;
+    phase_end(&start_stats[lgw_board].total);
+    start_stats_valid[lgw_board] = true;
+    printf("INFO: concentrator started in %u ms (connect:%u calibration:%u radios:%u config:%u firmwares:%u)\n", start_stats[lgw_board].total.duration_us / 1000,
+                                                                                                            start_stats[lgw_board].connect.duration_us / 1000,
+                                                                                                            start_stats[lgw_board].calibration.duration_us / 1000,
+                                                                                                            start_stats[lgw_board].radio_setup.duration_us / 1000,
+                                                                                                            start_stats[lgw_board].sx1302_config.duration_us / 1000,
+                                                                                                            (start_stats[lgw_board].agc_fw.duration_us + start_stats[lgw_board].arb_fw.duration_us) / 1000);
+
     return LGW_HAL_SUCCESS;
 }
 
@@ -752,20 +1239,29 @@ int lgw_stop(void) {
         lgw_abort_tx(i);
     }
 
+    /* Finish the pending payload checks before their log is closed */
+    dbg_payload_check_stop();
+
     /* Close log file */
     if (log_file != NULL) {
         fclose(log_file);
         log_file = NULL;
     }
 
+    /* Close RX capture file */
+    lgw_capture_stop();
+
     DEBUG_MSG("INFO: Disconnecting\n");
     lgw_disconnect();
 
-    DEBUG_MSG("INFO: Closing I2C\n");
-    err = i2c_linuxdev_close(ts_fd);
-    if (err != 0) {
-        printf("ERROR: failed to close I2C device (err=%i)\n", err);
+    if (chip_simulated[lgw_board] == false) {
+        DEBUG_MSG("INFO: Closing I2C\n");
+        err = i2c_linuxdev_close(ts_fd[lgw_board]);
+        if (err != 0) {
+            printf("ERROR: failed to close I2C device (err=%i)\n", err);
+        }
     }
+    ts_valid[lgw_board] = false;
 
     CONTEXT_STARTED = false;
     return LGW_HAL_SUCCESS;
@@ -773,11 +1269,14 @@ int lgw_stop(void) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
+static int receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
     int res;
     uint8_t  nb_pkt_fetched = 0;
     uint16_t nb_pkt_found = 0;
     uint16_t nb_pkt_left = 0;
+    uint16_t nb_pkt_parse;
+    uint16_t i;
+    bool temperature_valid = false;
     float current_temperature, rssi_temperature_offset;
 
     /* Check that AGC/ARB firmwares are not corrupted, and update internal counter */
@@ -787,44 +1286,68 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
         return LGW_HAL_ERROR;
     }
 
-    /* Get packets from SX1302, if any */
-    res = sx1302_fetch(&nb_pkt_fetched);
+    /* Accumulate the demodulator allocation counters, read only when the last sample is outdated */
+    res = sx1302_arb_update_debug_stats(false);
     if (res != LGW_REG_SUCCESS) {
-        printf("ERROR: failed to fetch packets from SX1302\n");
-        return LGW_HAL_ERROR;
-    }
-    if (nb_pkt_fetched == 0) {
-        return 0;
-    }
-    if (nb_pkt_fetched > max_pkt) {
-        nb_pkt_left = nb_pkt_fetched - max_pkt;
-        printf("WARNING: not enough space allocated, fetched %d packet(s), %d will be left in RX buffer\n", nb_pkt_fetched, nb_pkt_left);
-    }
-
-    /* Apply RSSI temperature compensation */
-    res = stts751_get_temperature(ts_fd, ts_addr, &current_temperature);
-    if (res != LGW_I2C_SUCCESS) {
-        printf("ERROR: failed to get current temperature\n");
         return LGW_HAL_ERROR;
     }
 
-    /* Iterate on the RX buffer to get parsed packets */
-    for (nb_pkt_found = 0; nb_pkt_found < ((nb_pkt_fetched <= max_pkt) ? nb_pkt_fetched : max_pkt); nb_pkt_found++) {
-        /* Get packet and move to next one */
-        res = sx1302_parse(&lgw_context, &pkt_data[nb_pkt_found]);
+    /* Drain the SX1302 RX buffer, fetching again once the packets fetched are parsed, until max_pkt are returned */
+    while (nb_pkt_found < max_pkt) {
+        /* Get packets from SX1302, if any */
+        res = sx1302_fetch(&nb_pkt_fetched);
         if (res != LGW_REG_SUCCESS) {
-            printf("ERROR: failed to parse fetched packet %d, aborting...\n", nb_pkt_found);
+            printf("ERROR: failed to fetch packets from SX1302\n");
             return LGW_HAL_ERROR;
         }
+        if (nb_pkt_fetched == 0) {
+            break;
+        }
+
+        /* Apply RSSI temperature compensation, the sensor is only read when the cached value is outdated */
+        if (temperature_valid == false) {
+            res = temperature_get(false, &current_temperature);
+            if (res != LGW_HAL_SUCCESS) {
+                printf("ERROR: failed to get current temperature\n");
+                return LGW_HAL_ERROR;
+            }
+            temperature_valid = true;
+        }
+
+        /* Iterate on the RX buffer to get parsed packets */
+        nb_pkt_parse = nb_pkt_fetched;
+        if (nb_pkt_parse > (max_pkt - nb_pkt_found)) {
+            nb_pkt_parse = max_pkt - nb_pkt_found;
+            nb_pkt_left = nb_pkt_fetched - nb_pkt_parse;
+        }
+        for (i = 0; i < nb_pkt_parse; i++) {
+            /* Get packet and move to next one */
+            res = sx1302_parse(&lgw_context[lgw_board], &pkt_data[nb_pkt_found]);
+            if (res != LGW_REG_SUCCESS) {
+                printf("ERROR: failed to parse fetched packet %d, aborting...\n", nb_pkt_found);
+                return LGW_HAL_ERROR;
+            }
+
+            /* Drop the unwanted packets before any further processing, their slot is reused */
+            if (lgw_filter_check(&pkt_data[nb_pkt_found]) != LGW_FILTER_PASS) {
+                continue;
+            }
+
+            /* Appli RSSI offset calibrated for the board */
+            pkt_data[nb_pkt_found].rssic += CONTEXT_RF_CHAIN[pkt_data[nb_pkt_found].rf_chain].rssi_offset;
+            pkt_data[nb_pkt_found].rssis += CONTEXT_RF_CHAIN[pkt_data[nb_pkt_found].rf_chain].rssi_offset;
 
-        /* Appli RSSI offset calibrated for the board */
-        pkt_data[nb_pkt_found].rssic += CONTEXT_RF_CHAIN[pkt_data[nb_pkt_found].rf_chain].rssi_offset;
-        pkt_data[nb_pkt_found].rssis += CONTEXT_RF_CHAIN[pkt_data[nb_pkt_found].rf_chain].rssi_offset;
+            rssi_temperature_offset = sx1302_rssi_get_temperature_offset(&CONTEXT_RF_CHAIN[pkt_data[nb_pkt_found].rf_chain].rssi_tcomp, current_temperature);
+            pkt_data[nb_pkt_found].rssic += rssi_temperature_offset;
+            pkt_data[nb_pkt_found].rssis += rssi_temperature_offset;
+            DEBUG_PRINTF("INFO: RSSI temperature offset applied: %.3f dB (current temperature %.1f C)\n", rssi_temperature_offset, current_temperature);
+            nb_pkt_found += 1;
+        }
+    }
 
-        rssi_temperature_offset = sx1302_rssi_get_temperature_offset(&CONTEXT_RF_CHAIN[pkt_data[nb_pkt_found].rf_chain].rssi_tcomp, current_temperature);
-        pkt_data[nb_pkt_found].rssic += rssi_temperature_offset;
-        pkt_data[nb_pkt_found].rssis += rssi_temperature_offset;
-        DEBUG_PRINTF("INFO: RSSI temperature offset applied: %.3f dB (current temperature %.1f C)\n", rssi_temperature_offset, current_temperature);
+    /* Not enough space allocated, the packets left in RX buffer are returned by the next call */
+    if (nb_pkt_left > 0) {
+        rx_nb_pkt_left[lgw_board] += 1;
     }
 
     DEBUG_PRINTF("INFO: nb pkt found:%u left:%u\n", nb_pkt_found, nb_pkt_left);
@@ -834,72 +1357,144 @@ int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_send(struct lgw_pkt_tx_s * pkt_data) {
-    /* check if the concentrator is running */
+int lgw_receive(uint8_t max_pkt, struct lgw_pkt_rx_s *pkt_data) {
+    int res;
+
+    pthread_mutex_lock(&mx_hal_rx[lgw_board]);
+    res = receive(max_pkt, pkt_data);
+    pthread_mutex_unlock(&mx_hal_rx[lgw_board]);
+
+    return res;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_receive_wait(uint32_t timeout_ms) {
+    int err;
+    bool pending = false;
+    uint32_t poll_ms = RX_WAIT_POLL_MIN_MS;
+    uint32_t elapsed_ms = 0;
+    struct timespec start_time, current_time;
+
+    /* Check that the concentrator is running */
     if (CONTEXT_STARTED == false) {
-        DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, START IT BEFORE SENDING\n");
+        printf("ERROR: concentrator is not running, cannot wait for packets\n");
         return LGW_HAL_ERROR;
     }
 
-    CHECK_NULL(pkt_data);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    while (true) {
+        pthread_mutex_lock(&mx_hal_rx[lgw_board]);
+        err = sx1302_rx_pending(&pending);
+        pthread_mutex_unlock(&mx_hal_rx[lgw_board]);
+        if (err != LGW_REG_SUCCESS) {
+            return LGW_HAL_ERROR;
+        }
+        if (pending == true) {
+            return 1;
+        }
 
-    /* check input range (segfault prevention) */
-    if (pkt_data->rf_chain >= LGW_RF_CHAIN_NB) {
-        DEBUG_MSG("ERROR: INVALID RF_CHAIN TO SEND PACKETS\n");
+        /* Check for timeout */
+        clock_gettime(CLOCK_MONOTONIC, &current_time);
+        elapsed_ms = (uint32_t)((current_time.tv_sec - start_time.tv_sec) * 1000 + (current_time.tv_nsec - start_time.tv_nsec) / 1000000);
+        if (elapsed_ms >= timeout_ms) {
+            return 0;
+        }
+
+        /* Back off exponentially, without sleeping past the timeout */
+        if (poll_ms > (timeout_ms - elapsed_ms)) {
+            poll_ms = timeout_ms - elapsed_ms;
+        }
+        wait_ms(poll_ms);
+        if (poll_ms < RX_WAIT_POLL_MAX_MS) {
+            poll_ms *= 2;
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_send(struct lgw_pkt_tx_s * pkt_data) {
+    int err;
+
+    if (tx_check(pkt_data) != LGW_HAL_SUCCESS) {
         return LGW_HAL_ERROR;
     }
 
-    /* check input variables */
-    if (CONTEXT_RF_CHAIN[pkt_data->rf_chain].tx_enable == false) {
-        DEBUG_MSG("ERROR: SELECTED RF_CHAIN IS DISABLED FOR TX ON SELECTED BOARD\n");
+    pthread_mutex_lock(&mx_hal_tx[lgw_board]);
+    tx_stage[lgw_board][pkt_data->rf_chain].valid = false; /* TX modem reprogrammed */
+    err = sx1302_send(CONTEXT_RF_CHAIN[pkt_data->rf_chain].type, &CONTEXT_TX_GAIN_LUT[pkt_data->rf_chain], CONTEXT_LWAN_PUBLIC, &CONTEXT_FSK, pkt_data);
+    pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
+
+    return err;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_tx_stage(struct lgw_pkt_tx_s * pkt_data, uint32_t * stage_id) {
+    int err;
+    struct tx_stage_s * stage;
+
+    CHECK_NULL(stage_id);
+    if (tx_check(pkt_data) != LGW_HAL_SUCCESS) {
         return LGW_HAL_ERROR;
     }
-    if (CONTEXT_RF_CHAIN[pkt_data->rf_chain].enable == false) {
-        DEBUG_MSG("ERROR: SELECTED RF_CHAIN IS DISABLED\n");
+
+    pthread_mutex_lock(&mx_hal_tx[lgw_board]);
+
+    /* the TX modem cannot be programmed while a packet is scheduled or emitted */
+    stage = &tx_stage[lgw_board][pkt_data->rf_chain];
+    stage->valid = false;
+    if (sx1302_tx_status(pkt_data->rf_chain) != TX_FREE) {
+        pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
+        DEBUG_PRINTF("ERROR: TX CHAIN %u BUSY, CANNOT STAGE PACKET\n", pkt_data->rf_chain);
         return LGW_HAL_ERROR;
     }
-    if (!IS_TX_MODE(pkt_data->tx_mode)) {
-        DEBUG_MSG("ERROR: TX_MODE NOT SUPPORTED\n");
+    err = sx1302_tx_stage(CONTEXT_RF_CHAIN[pkt_data->rf_chain].type, &CONTEXT_TX_GAIN_LUT[pkt_data->rf_chain], CONTEXT_LWAN_PUBLIC, &CONTEXT_FSK, pkt_data, &stage->start_delay);
+    if (err == LGW_REG_SUCCESS) {
+        tx_stage_last_id[lgw_board] += 1;
+        stage->id = tx_stage_last_id[lgw_board];
+        stage->tx_mode = pkt_data->tx_mode;
+        stage->count_us = pkt_data->count_us;
+        stage->valid = true;
+        *stage_id = stage->id;
+    }
+
+    pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
+
+    return (err == LGW_REG_SUCCESS) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_tx_arm(uint8_t rf_chain, uint32_t stage_id) {
+    int err;
+    struct tx_stage_s * stage;
+
+    /* check if the concentrator is running */
+    if (CONTEXT_STARTED == false) {
+        DEBUG_MSG("ERROR: CONCENTRATOR IS NOT RUNNING, START IT BEFORE SENDING\n");
         return LGW_HAL_ERROR;
     }
-    if (pkt_data->modulation == MOD_LORA) {
-        if (!IS_LORA_BW(pkt_data->bandwidth)) {
-            DEBUG_MSG("ERROR: BANDWIDTH NOT SUPPORTED BY LORA TX\n");
-            return LGW_HAL_ERROR;
-        }
-        if (!IS_LORA_DR(pkt_data->datarate)) {
-            DEBUG_MSG("ERROR: DATARATE NOT SUPPORTED BY LORA TX\n");
-            return LGW_HAL_ERROR;
-        }
-        if (!IS_LORA_CR(pkt_data->coderate)) {
-            DEBUG_MSG("ERROR: CODERATE NOT SUPPORTED BY LORA TX\n");
-            return LGW_HAL_ERROR;
-        }
-        if (pkt_data->size > 255) {
-            DEBUG_MSG("ERROR: PAYLOAD LENGTH TOO BIG FOR LORA TX\n");
-            return LGW_HAL_ERROR;
-        }
-    } else if (pkt_data->modulation == MOD_FSK) {
-        if((pkt_data->f_dev < 1) || (pkt_data->f_dev > 200)) {
-            DEBUG_MSG("ERROR: TX FREQUENCY DEVIATION OUT OF ACCEPTABLE RANGE\n");
-            return LGW_HAL_ERROR;
-        }
-        if(!IS_FSK_DR(pkt_data->datarate)) {
-            DEBUG_MSG("ERROR: DATARATE NOT SUPPORTED BY FSK IF CHAIN\n");
-            return LGW_HAL_ERROR;
-        }
-        if (pkt_data->size > 255) {
-            DEBUG_MSG("ERROR: PAYLOAD LENGTH TOO BIG FOR FSK TX\n");
-            return LGW_HAL_ERROR;
-        }
-    } else if (pkt_data->modulation == MOD_CW) {
-        /* do nothing */
-    } else {
-        DEBUG_MSG("ERROR: INVALID TX MODULATION\n");
+    if (rf_chain >= LGW_RF_CHAIN_NB) {
+        DEBUG_MSG("ERROR: INVALID RF_CHAIN TO SEND PACKETS\n");
+        return LGW_HAL_ERROR;
+    }
+
+    pthread_mutex_lock(&mx_hal_tx[lgw_board]);
+
+    stage = &tx_stage[lgw_board][rf_chain];
+    if ((stage->valid == false) || (stage->id != stage_id)) {
+        pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
+        DEBUG_PRINTF("ERROR: PACKET %u NOT STAGED ON TX CHAIN %u ANYMORE\n", stage_id, rf_chain);
         return LGW_HAL_ERROR;
     }
+    stage->valid = false;
+    err = sx1302_tx_arm(rf_chain, stage->tx_mode, stage->count_us, stage->start_delay);
+
+    pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
 
-    return sx1302_send(CONTEXT_RF_CHAIN[pkt_data->rf_chain].type, &CONTEXT_TX_GAIN_LUT[pkt_data->rf_chain], CONTEXT_LWAN_PUBLIC, &CONTEXT_FSK, pkt_data);
+    return (err == LGW_REG_SUCCESS) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -917,7 +1512,10 @@ int lgw_status(uint8_t rf_chain, uint8_t select, uint8_t *code) {
         if (CONTEXT_STARTED == false) {
             *code = TX_OFF;
         } else {
+            /* not interleaved with the programming or abort of a packet on the same chain */
+            pthread_mutex_lock(&mx_hal_tx[lgw_board]);
             *code = sx1302_tx_status(rf_chain);
+            pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
         }
     } else if (select == RX_STATUS) {
         if (CONTEXT_STARTED == false) {
@@ -937,6 +1535,8 @@ int lgw_status(uint8_t rf_chain, uint8_t select, uint8_t *code) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int lgw_abort_tx(uint8_t rf_chain) {
+    int err;
+
     /* check input variables */
     if (rf_chain >= LGW_RF_CHAIN_NB) {
         DEBUG_MSG("ERROR: NOT A VALID RF_CHAIN NUMBER\n");
@@ -944,7 +1544,12 @@ int lgw_abort_tx(uint8_t rf_chain) {
     }
 
     /* Abort current TX */
-    return sx1302_tx_abort(rf_chain);
+    pthread_mutex_lock(&mx_hal_tx[lgw_board]);
+    tx_stage[lgw_board][rf_chain].valid = false;
+    err = sx1302_tx_abort(rf_chain);
+    pthread_mutex_unlock(&mx_hal_tx[lgw_board]);
+
+    return err;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -969,6 +1574,78 @@ int lgw_get_instcnt(uint32_t* inst_cnt_us) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+int lgw_get_instcnt64(uint64_t* inst_cnt_us) {
+    CHECK_NULL(inst_cnt_us);
+
+    *inst_cnt_us = sx1302_timestamp_counter64(false);
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_get_start_stats(struct lgw_start_stats_s * stats) {
+    CHECK_NULL(stats);
+
+    if (start_stats_valid[lgw_board] == false) {
+        return LGW_HAL_ERROR;
+    }
+    *stats = start_stats[lgw_board];
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_get_spi_stats(struct lgw_spi_stats_s * stats, bool reset) {
+    CHECK_NULL(stats);
+
+    /* consistent snapshot, no SPI message in progress */
+    lgw_reg_lock();
+    lgw_com_get_stats(stats, reset);
+    lgw_reg_unlock();
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_get_rx_stats(struct lgw_rx_stats_s * stats, bool reset) {
+    CHECK_NULL(stats);
+
+    /* consistent snapshot, no fetch in progress */
+    pthread_mutex_lock(&mx_hal_rx[lgw_board]);
+    sx1302_get_rx_stats(stats, reset);
+    lgw_filter_get_stats(stats, reset);
+    stats->nb_pkt_left = rx_nb_pkt_left[lgw_board];
+    if (reset == true) {
+        rx_nb_pkt_left[lgw_board] = 0;
+    }
+    pthread_mutex_unlock(&mx_hal_rx[lgw_board]);
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_get_arb_stats(struct lgw_arb_stats_s * stats, bool reset) {
+    int err = LGW_HAL_SUCCESS;
+
+    CHECK_NULL(stats);
+
+    /* take the counts since the last sample of lgw_receive, no fetch in progress */
+    pthread_mutex_lock(&mx_hal_rx[lgw_board]);
+    if ((CONTEXT_STARTED == true) && (sx1302_arb_update_debug_stats(true) != LGW_REG_SUCCESS)) {
+        err = LGW_HAL_ERROR;
+    }
+    sx1302_arb_get_stats(stats, reset);
+    pthread_mutex_unlock(&mx_hal_rx[lgw_board]);
+
+    return err;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int lgw_get_eui(uint64_t* eui) {
     CHECK_NULL(eui);
 
@@ -981,9 +1658,15 @@ int lgw_get_eui(uint64_t* eui) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int lgw_get_temperature(float* temperature) {
+    int err;
+
     CHECK_NULL(temperature);
 
-    if (stts751_get_temperature(ts_fd, ts_addr, temperature) != LGW_I2C_SUCCESS) {
+    /* always read the sensor, and refresh the value used for RSSI compensation */
+    pthread_mutex_lock(&mx_hal_rx[lgw_board]);
+    err = temperature_get(true, temperature);
+    pthread_mutex_unlock(&mx_hal_rx[lgw_board]);
+    if (err != LGW_HAL_SUCCESS) {
         return LGW_HAL_ERROR;
     }
 
@@ -999,11 +1682,7 @@ const char* lgw_version_info() {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 uint32_t lgw_time_on_air(struct lgw_pkt_tx_s *packet) {
-    int32_t val;
-    uint8_t SF, H, DE;
-    uint16_t BW;
-    uint32_t payloadSymbNb, Tpacket;
-    double Tsym, Tpreamble, Tpayload, Tfsk;
+    uint32_t Tpacket;
 
     if (packet == NULL) {
         DEBUG_MSG("ERROR: Failed to compute time on air, wrong parameter\n");
@@ -1011,45 +1690,20 @@ uint32_t lgw_time_on_air(struct lgw_pkt_tx_s *packet) {
     }
 
     if (packet->modulation == MOD_LORA) {
-        /* Get bandwidth */
-        val = lgw_bw_getval(packet->bandwidth);
-        if (val != -1) {
-            BW = (uint16_t)(val / 1E3);
-        } else {
+        if (lgw_bw_getval(packet->bandwidth) == -1) {
             DEBUG_PRINTF("ERROR: Cannot compute time on air for this packet, unsupported bandwidth (0x%02X)\n", packet->bandwidth);
             return 0;
         }
-
-        /* Get datarate */
-        val = lgw_sf_getval(packet->datarate);
-        if (val != -1) {
-            SF = (uint8_t)val;
-            /* TODO: update formula for SF5/SF6 */
-            if (SF < 7) {
-                DEBUG_MSG("WARNING: clipping time on air computing to SF7 for SF5/SF6\n");
-                SF = 7;
-            }
-        } else {
+        if (lgw_sf_getval(packet->datarate) == -1) {
             DEBUG_PRINTF("ERROR: Cannot compute time on air for this packet, unsupported datarate (0x%02X)\n", packet->datarate);
             return 0;
         }
+        if (lgw_sf_getval(packet->datarate) < 7) {
+            DEBUG_MSG("WARNING: clipping time on air computing to SF7 for SF5/SF6\n");
+        }
 
-        /* Duration of 1 symbol */
-        Tsym = pow(2, SF) / BW;
-
-        /* Duration of preamble */
-        Tpreamble = ((double)(packet->preamble) + 4.25) * Tsym;
-
-        /* Duration of payload */
-        H = (packet->no_header==false) ? 0 : 1; /* header is always enabled, except for beacons */
-        DE = (SF >= 11) ? 1 : 0; /* Low datarate optimization enabled for SF11 and SF12 */
-
-        payloadSymbNb = 8 + (ceil((double)(8*packet->size - 4*SF + 28 + 16 - 20*H) / (double)(4*(SF - 2*DE))) * (packet->coderate + 4)); /* Explicitely cast to double to keep precision of the division */
-
-        Tpayload = payloadSymbNb * Tsym;
-
-        /* Duration of packet */
-        Tpacket = Tpreamble + Tpayload;
+        /* Duration of packet, CRC always counted */
+        Tpacket = lgw_lora_toa_us(packet->bandwidth, packet->datarate, packet->coderate, packet->preamble, packet->no_header, true, packet->size) / 1000;
     } else if (packet->modulation == MOD_FSK) {
         /* PREAMBLE + SYNC_WORD + PKT_LEN + PKT_PAYLOAD + CRC
                 PREAMBLE: default 5 bytes
@@ -1058,10 +1712,13 @@ uint32_t lgw_time_on_air(struct lgw_pkt_tx_s *packet) {
                 PKT_PAYLOAD: x bytes
                 CRC: 0 or 2 bytes
         */
-        Tfsk = (8 * (double)(packet->preamble + CONTEXT_FSK.sync_word_size + 1 + packet->size + ((packet->no_crc == true) ? 0 : 2)) / (double)packet->datarate) * 1E3;
+        if (packet->datarate == 0) {
+            DEBUG_MSG("ERROR: Cannot compute time on air for this packet, null FSK datarate\n");
+            return 0;
+        }
 
         /* Duration of packet */
-        Tpacket = (uint32_t)Tfsk + 1; /* add margin for rounding */
+        Tpacket = (lgw_fsk_toa_us(packet->datarate, packet->preamble, CONTEXT_FSK.sync_word_size, !packet->no_crc, packet->size) / 1000) + 1; /* add margin for rounding */
     } else {
         Tpacket = 0;
         DEBUG_PRINTF("ERROR: Cannot compute time on air for this packet, unsupported modulation (0x%02X)\n", packet->modulation);
@@ -19,12 +19,23 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
 #include <stdint.h>     /* C99 types */
 #include <stdbool.h>    /* bool type */
 #include <stdio.h>      /* printf fprintf */
+#include <string.h>     /* memset, memcpy */
+#include <pthread.h>
 
 #include "loragw_spi.h"
+#include "loragw_com.h"
 #include "loragw_reg.h"
+#include "loragw_hal.h"  /* LGW_BOARD_NB */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
@@ -1108,32 +1119,257 @@ const struct lgw_reg_s loregs[LGW_TOTALREGS+1] = {
     {0,0,0,0,0,0,0,0}
 };
 
+/* Shadow copy of the register file, from TX_TOP_A to the end of OTP pages */
+#define SHADOW_ADDR_START   SX1302_REG_TX_TOP_A_BASE_ADDR
+#define SHADOW_ADDR_END     0x6200
+#define SHADOW_SIZE         (SHADOW_ADDR_END - SHADOW_ADDR_START)
+
+#define SHADOW_CACHEABLE    0x01 /* byte is only modified by the host */
+#define SHADOW_VALID        0x02 /* byte value in shadow copy matches the chip */
+
+/* Queue of register writes, see lgw_reg_batch_start() */
+#define BATCH_BURST_MAX     64
+#define BATCH_DATA_MAX      256
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
+/* Each concentrator board has its own state, the one accessed is selected per thread (see lgw_board) */
+static bool    shadow_enabled[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = true };
+static uint8_t shadow_data[LGW_BOARD_NB][SHADOW_SIZE];
+static uint8_t shadow_flags[LGW_BOARD_NB][SHADOW_SIZE];
+
+static bool     batch_active[LGW_BOARD_NB];
+static uint8_t  batch_data[LGW_BOARD_NB][BATCH_DATA_MAX];
+static uint16_t batch_data_size[LGW_BOARD_NB];
+static struct lgw_spi_burst_s batch_bursts[LGW_BOARD_NB][BATCH_BURST_MAX];
+static uint16_t batch_nb_bursts[LGW_BOARD_NB];
+
+/* Memory burst access chunk size, 0 for the largest the SPI link allows */
+static uint16_t mem_chunk_size[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = LGW_BURST_CHUNK };
+
+/* Lock serializing SPI accesses, shadow copy and batch state (recursive) */
+static pthread_mutex_t mx_spi[LGW_BOARD_NB];
+static pthread_once_t mx_spi_once = PTHREAD_ONCE_INIT;
+
 /* -------------------------------------------------------------------------- */
 /* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
 
-void *lgw_spi_target = NULL; /*! generic pointer to the SPI device */
+__thread lgw_handle_t lgw_board = 0; /*! concentrator board accessed by the calling thread, see lgw_board_select() */
+
+void *lgw_spi_target[LGW_BOARD_NB]; /*! generic pointers to the SPI devices */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
 
+static void mx_spi_init(void) {
+    pthread_mutexattr_t attr;
+    int i;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    for (i = 0; i < LGW_BOARD_NB; i++) {
+        pthread_mutex_init(&mx_spi[i], &attr);
+    }
+    pthread_mutexattr_destroy(&attr);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Build the list of register bytes that can be kept in the shadow copy, and invalidate their values */
+static void shadow_init(void) {
+    int i, j, size_byte;
+    uint16_t addr;
+    bool volatile_block;
+
+    memset(shadow_flags[lgw_board], 0, sizeof shadow_flags[lgw_board]);
+    if (shadow_enabled[lgw_board] == false) {
+        return;
+    }
+
+    /* first pass: all bytes holding a register are candidates */
+    for (i = 0; i < LGW_TOTALREGS; i++) {
+        size_byte = (loregs[i].leng + loregs[i].offs + 7) / 8;
+        for (j = 0; j < size_byte; j++) {
+            addr = loregs[i].addr + j;
+            if ((addr >= SHADOW_ADDR_START) && (addr < SHADOW_ADDR_END)) {
+                shadow_flags[lgw_board][addr - SHADOW_ADDR_START] = SHADOW_CACHEABLE;
+            }
+        }
+    }
+
+    /* second pass: exclude bytes holding at least one status, pulse or self-clearing register */
+    for (i = 0; i < LGW_TOTALREGS; i++) {
+        addr = loregs[i].addr;
+        /* blocks shared with the MCUs or updated by the hardware */
+        volatile_block = ((addr >= SX1302_REG_GPIO_BASE_ADDR) && (addr < SX1302_REG_RADIO_FE_BASE_ADDR)) ||
+                         ((addr >= SX1302_REG_AGC_MCU_BASE_ADDR) && (addr < SX1302_REG_CLK_CTRL_BASE_ADDR)) ||
+                         (addr >= SX1302_REG_CAPTURE_RAM_BASE_ADDR);
+        if ((loregs[i].rdon == 1) || (loregs[i].chck == 0) || (volatile_block == true)) {
+            size_byte = (loregs[i].leng + loregs[i].offs + 7) / 8;
+            for (j = 0; j < size_byte; j++) {
+                addr = loregs[i].addr + j;
+                if ((addr >= SHADOW_ADDR_START) && (addr < SHADOW_ADDR_END)) {
+                    shadow_flags[lgw_board][addr - SHADOW_ADDR_START] = 0;
+                }
+            }
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Get the shadow copy of a register byte, return false if the chip must be accessed */
+static bool shadow_get(uint8_t spi_mux_target, uint16_t addr, uint8_t *data) {
+    int idx = addr - SHADOW_ADDR_START;
+
+    if ((spi_mux_target != LGW_SPI_MUX_TARGET_SX1302) || (idx < 0) || (idx >= SHADOW_SIZE)) {
+        return false;
+    }
+    if (shadow_flags[lgw_board][idx] != (SHADOW_CACHEABLE | SHADOW_VALID)) {
+        return false;
+    }
+    *data = shadow_data[lgw_board][idx];
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Update the shadow copy of cacheable register bytes after a chip access, invalidate them if the access failed */
+static void shadow_set(int spi_stat, uint8_t spi_mux_target, uint16_t addr, const uint8_t *data, uint16_t size) {
+    int i;
+    int idx = addr - SHADOW_ADDR_START;
+
+    if (spi_mux_target != LGW_SPI_MUX_TARGET_SX1302) {
+        return;
+    }
+    for (i = 0; i < size; i++, idx++) {
+        if ((idx >= 0) && (idx < SHADOW_SIZE) && ((shadow_flags[lgw_board][idx] & SHADOW_CACHEABLE) != 0)) {
+            if (spi_stat == LGW_SPI_SUCCESS) {
+                shadow_data[lgw_board][idx] = data[i];
+                shadow_flags[lgw_board][idx] |= SHADOW_VALID;
+            } else {
+                /* chip content unknown, read it again next time */
+                shadow_flags[lgw_board][idx] &= ~SHADOW_VALID;
+            }
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Submit all queued register writes */
+static int batch_flush(void) {
+    int spi_stat = LGW_SPI_SUCCESS;
+    int i;
+
+    if (batch_nb_bursts[lgw_board] > 0) {
+        DEBUG_PRINTF("Note: flushing %u register bursts (%u bytes)\n", batch_nb_bursts[lgw_board], batch_data_size[lgw_board]);
+        spi_stat = lgw_com_wb_multi(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, batch_bursts[lgw_board], batch_nb_bursts[lgw_board]);
+        if (spi_stat != LGW_SPI_SUCCESS) {
+            /* the shadow copy was updated when the writes were queued */
+            for (i = 0; i < batch_nb_bursts[lgw_board]; i++) {
+                shadow_set(spi_stat, LGW_SPI_MUX_TARGET_SX1302, batch_bursts[lgw_board][i].address, NULL, batch_bursts[lgw_board][i].size);
+            }
+        }
+    }
+    batch_nb_bursts[lgw_board] = 0;
+    batch_data_size[lgw_board] = 0;
+
+    return spi_stat;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Write register bytes, or queue them if a batch is active. Adjacent writes are merged in the same burst */
+static int reg_write(void *spi_target, uint8_t spi_mux_target, uint16_t addr, const uint8_t *data, uint16_t size) {
+    int spi_stat = LGW_SPI_SUCCESS;
+    struct lgw_spi_burst_s *last;
+
+    if ((batch_active[lgw_board] == false) || (spi_target != lgw_spi_target[lgw_board]) || (spi_mux_target != LGW_SPI_MUX_TARGET_SX1302) || (size > BATCH_DATA_MAX)) {
+        if (batch_active[lgw_board] == true) {
+            /* keep write ordering */
+            spi_stat += batch_flush();
+        }
+        if (size == 1) {
+            spi_stat += lgw_com_w(spi_target, spi_mux_target, addr, data[0]);
+        } else {
+            spi_stat += lgw_com_wb(spi_target, spi_mux_target, addr, data, size);
+        }
+        return spi_stat;
+    }
+
+    /* make room in the queue if needed */
+    if (((batch_data_size[lgw_board] + size) > BATCH_DATA_MAX) || (batch_nb_bursts[lgw_board] == BATCH_BURST_MAX)) {
+        spi_stat += batch_flush();
+    }
+
+    /* append data to the previous burst if contiguous, add a new one otherwise */
+    memcpy(&batch_data[lgw_board][batch_data_size[lgw_board]], data, size);
+    last = (batch_nb_bursts[lgw_board] > 0) ? &batch_bursts[lgw_board][batch_nb_bursts[lgw_board] - 1] : NULL;
+    if ((last != NULL) && ((last->address + last->size) == addr) && ((last->size + size) <= LGW_BURST_CHUNK)) {
+        last->size += size;
+    } else {
+        batch_bursts[lgw_board][batch_nb_bursts[lgw_board]].address = addr;
+        batch_bursts[lgw_board][batch_nb_bursts[lgw_board]].size = size;
+        batch_bursts[lgw_board][batch_nb_bursts[lgw_board]].data = &batch_data[lgw_board][batch_data_size[lgw_board]];
+        batch_nb_bursts[lgw_board] += 1;
+    }
+    batch_data_size[lgw_board] += size;
+
+    return spi_stat;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Write the bits of a register byte selected by mask, data being already shifted */
+static int reg_w_byte(void *spi_target, uint8_t spi_mux_target, uint16_t addr, uint8_t mask, uint8_t data) {
+    int spi_stat = LGW_SPI_SUCCESS;
+    uint8_t buf = 0;
+
+    if (mask != 0xFF) {
+        /* read-modify-write, the read is skipped if the byte is in the shadow copy */
+        if (shadow_get(spi_mux_target, addr, &buf) == false) {
+            if (batch_active[lgw_board] == true) {
+                spi_stat += batch_flush();
+            }
+            spi_stat += lgw_com_r(spi_target, spi_mux_target, addr, &buf);
+        }
+    }
+    buf = (~mask & buf) | (mask & data); /* mixing old & new data */
+    spi_stat += reg_write(spi_target, spi_mux_target, addr, &buf, 1);
+    shadow_set(spi_stat, spi_mux_target, addr, &buf, 1);
+
+    return spi_stat;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Read a register byte, from the shadow copy if possible */
+static int reg_r_byte(void *spi_target, uint8_t spi_mux_target, uint16_t addr, uint8_t *data) {
+    int spi_stat = LGW_SPI_SUCCESS;
+
+    if (shadow_get(spi_mux_target, addr, data) == false) {
+        if (batch_active[lgw_board] == true) {
+            spi_stat += batch_flush();
+        }
+        spi_stat += lgw_com_r(spi_target, spi_mux_target, addr, data);
+        shadow_set(spi_stat, spi_mux_target, addr, data, 1);
+    }
+
+    return spi_stat;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int reg_w_align32(void *spi_target, uint8_t spi_mux_target, struct lgw_reg_s r, int32_t reg_value) {
     int spi_stat = LGW_REG_SUCCESS;
     int i, size_byte;
     uint8_t buf[4] = "\x00\x00\x00\x00";
 
-    if ((r.leng == 8) && (r.offs == 0)) {
-        /* direct write */
-        spi_stat += lgw_spi_w(spi_target, spi_mux_target, r.addr, (uint8_t)reg_value);
-    } else if ((r.offs + r.leng) <= 8) {
-        /* single-byte read-modify-write, offs:[0-7], leng:[1-7] */
-        spi_stat += lgw_spi_r(spi_target, spi_mux_target, r.addr, &buf[0]);
-        buf[1] = ((1 << r.leng) - 1) << r.offs; /* bit mask */
-        buf[2] = ((uint8_t)reg_value) << r.offs; /* new data offsetted */
-        buf[3] = (~buf[1] & buf[0]) | (buf[1] & buf[2]); /* mixing old & new data */
-        spi_stat += lgw_spi_w(spi_target, spi_mux_target, r.addr, buf[3]);
+    if ((r.offs + r.leng) <= 8) {
+        /* single-byte write, offs:[0-7], leng:[1-8] */
+        spi_stat += reg_w_byte(spi_target, spi_mux_target, r.addr, ((1 << r.leng) - 1) << r.offs, ((uint8_t)reg_value) << r.offs);
     } else if ((r.offs == 0) && (r.leng > 0) && (r.leng <= 32)) {
         /* multi-byte direct write routine */
         size_byte = (r.leng + 7) / 8; /* add a byte if it's not an exact multiple of 8 */
@@ -1143,7 +1379,8 @@ int reg_w_align32(void *spi_target, uint8_t spi_mux_target, struct lgw_reg_s r,
             buf[i] = (uint8_t)(0x000000FF & reg_value);
             reg_value = (reg_value >> 8);
         }
-        spi_stat += lgw_spi_wb(spi_target, spi_mux_target, r.addr, buf, size_byte); /* write the register in one burst */
+        spi_stat += reg_write(spi_target, spi_mux_target, r.addr, buf, size_byte); /* write the register in one burst */
+        shadow_set(spi_stat, spi_mux_target, r.addr, buf, size_byte);
     } else {
         /* register spanning multiple memory bytes but with an offset */
         DEBUG_MSG("ERROR: REGISTER SIZE AND OFFSET ARE NOT SUPPORTED\n");
@@ -1164,7 +1401,7 @@ int reg_r_align32(void *spi_target, uint8_t spi_mux_target, struct lgw_reg_s r,
 
     if ((r.offs + r.leng) <= 8) {
         /* read one byte, then shift and mask bits to get reg value with sign extension if needed */
-        spi_stat += lgw_spi_r(spi_target, spi_mux_target, r.addr, &bufu[0]);
+        spi_stat += reg_r_byte(spi_target, spi_mux_target, r.addr, &bufu[0]);
         bufu[1] = bufu[0] << (8 - r.leng - r.offs); /* left-align the data */
         if (r.sign == true) {
             bufs[2] = bufs[1] >> (8 - r.leng); /* right align the data with sign extension (ARITHMETIC right shift) */
@@ -1175,7 +1412,18 @@ int reg_r_align32(void *spi_target, uint8_t spi_mux_target, struct lgw_reg_s r,
         }
     } else if ((r.offs == 0) && (r.leng > 0) && (r.leng <= 32)) {
         size_byte = (r.leng + 7) / 8; /* add a byte if it's not an exact multiple of 8 */
-        spi_stat += lgw_spi_rb(spi_target, spi_mux_target, r.addr, bufu, size_byte);
+        for (i = 0; i < size_byte; i++) {
+            if (shadow_get(spi_mux_target, r.addr + i, &bufu[i]) == false) {
+                break;
+            }
+        }
+        if (i < size_byte) {
+            if (batch_active[lgw_board] == true) {
+                spi_stat += batch_flush();
+            }
+            spi_stat += lgw_com_rb(spi_target, spi_mux_target, r.addr, bufu, size_byte);
+            shadow_set(spi_stat, spi_mux_target, r.addr, bufu, size_byte);
+        }
         u = 0;
         for (i=(size_byte-1); i>=0; --i) {
             u = (uint32_t)bufu[i] + (u << 8); /* transform a 4-byte array into a 32 bit word */
@@ -1208,20 +1456,20 @@ int lgw_connect(const char * spidev_path) {
         DEBUG_MSG("ERROR: SPIDEV PATH IS NOT SET\n");
         return LGW_REG_ERROR;
     }
-    if (lgw_spi_target != NULL) {
+    if (lgw_spi_target[lgw_board] != NULL) {
         DEBUG_MSG("WARNING: concentrator was already connected\n");
-        lgw_spi_close(lgw_spi_target);
+        lgw_com_close(lgw_spi_target[lgw_board]);
     }
 
     /* open the SPI link */
-    spi_stat = lgw_spi_open(spidev_path, &lgw_spi_target);
+    spi_stat = lgw_com_open(spidev_path, &lgw_spi_target[lgw_board]);
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR CONNECTING CONCENTRATOR\n");
         return LGW_REG_ERROR;
     }
 
     /* check SX1302 version */
-    spi_stat = lgw_spi_r(lgw_spi_target, LGW_SPI_MUX_TARGET_SX1302, loregs[SX1302_REG_COMMON_VERSION_VERSION].addr, &u);
+    spi_stat = lgw_com_r(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, loregs[SX1302_REG_COMMON_VERSION_VERSION].addr, &u);
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR READING CHIP VERSION REGISTER\n");
         return LGW_REG_ERROR;
@@ -1232,6 +1480,9 @@ int lgw_connect(const char * spidev_path) {
     }
     DEBUG_PRINTF("Note: chip version is 0x%02X (v%u.%u)\n", u, (u >> 4) & 0x0F, u & 0x0F) ;
 
+    /* chip may have been reset, start with an empty shadow copy */
+    shadow_init();
+
     DEBUG_MSG("Note: success connecting the concentrator\n");
     return LGW_REG_SUCCESS;
 }
@@ -1240,9 +1491,15 @@ int lgw_connect(const char * spidev_path) {
 
 /* Concentrator disconnect */
 int lgw_disconnect(void) {
-    if (lgw_spi_target != NULL) {
-        lgw_spi_close(lgw_spi_target);
-        lgw_spi_target = NULL;
+    if (lgw_spi_target[lgw_board] != NULL) {
+        lgw_reg_lock();
+        lgw_com_close(lgw_spi_target[lgw_board]);
+        lgw_spi_target[lgw_board] = NULL;
+        memset(shadow_flags[lgw_board], 0, sizeof shadow_flags[lgw_board]);
+        batch_active[lgw_board] = false;
+        batch_nb_bursts[lgw_board] = 0;
+        batch_data_size[lgw_board] = 0;
+        lgw_reg_unlock();
         DEBUG_MSG("Note: success disconnecting the concentrator\n");
         return LGW_REG_SUCCESS;
     } else {
@@ -1265,7 +1522,7 @@ int lgw_reg_w(uint16_t register_id, int32_t reg_value) {
     }
 
     /* check if SPI is initialised */
-    if (lgw_spi_target == NULL) {
+    if (lgw_spi_target[lgw_board] == NULL) {
         DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
         return LGW_REG_ERROR;
     }
@@ -1279,7 +1536,9 @@ int lgw_reg_w(uint16_t register_id, int32_t reg_value) {
         return LGW_REG_ERROR;
     }
 
-    spi_stat += reg_w_align32(lgw_spi_target, LGW_SPI_MUX_TARGET_SX1302, r, reg_value);
+    lgw_reg_lock();
+    spi_stat += reg_w_align32(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, r, reg_value);
+    lgw_reg_unlock();
 
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER WRITE\n");
@@ -1304,7 +1563,7 @@ int lgw_reg_r(uint16_t register_id, int32_t *reg_value) {
     }
 
     /* check if SPI is initialised */
-    if (lgw_spi_target == NULL) {
+    if (lgw_spi_target[lgw_board] == NULL) {
         DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
         return LGW_REG_ERROR;
     }
@@ -1312,7 +1571,9 @@ int lgw_reg_r(uint16_t register_id, int32_t *reg_value) {
     /* get register struct from the struct array */
     r = loregs[register_id];
 
-    spi_stat += reg_r_align32(lgw_spi_target, LGW_SPI_MUX_TARGET_SX1302, r, reg_value);
+    lgw_reg_lock();
+    spi_stat += reg_r_align32(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, r, reg_value);
+    lgw_reg_unlock();
 
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER WRITE\n");
@@ -1341,7 +1602,7 @@ int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
     }
 
     /* check if SPI is initialised */
-    if (lgw_spi_target == NULL) {
+    if (lgw_spi_target[lgw_board] == NULL) {
         DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
         return LGW_REG_ERROR;
     }
@@ -1355,8 +1616,18 @@ int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
         return LGW_REG_ERROR;
     }
 
+    lgw_reg_lock();
+
+    /* submit queued register writes first */
+    if (batch_active[lgw_board] == true) {
+        spi_stat += batch_flush();
+    }
+
     /* do the burst write */
-    spi_stat += lgw_spi_wb(lgw_spi_target, LGW_SPI_MUX_TARGET_SX1302, r.addr, data, size);
+    spi_stat += lgw_com_wb(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, r.addr, data, size);
+    shadow_set(spi_stat, LGW_SPI_MUX_TARGET_SX1302, r.addr, data, size);
+
+    lgw_reg_unlock();
 
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BURST WRITE\n");
@@ -1370,8 +1641,68 @@ int lgw_reg_wb(uint16_t register_id, uint8_t *data, uint16_t size) {
 
 /* Point to a register by name and do a burst read */
 int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size) {
+    /* check input parameters */
+    if (register_id >= LGW_TOTALREGS) {
+        DEBUG_MSG("ERROR: REGISTER NUMBER OUT OF DEFINED RANGE\n");
+        return LGW_REG_ERROR;
+    }
+
+    return lgw_reg_rb_addr(loregs[register_id].addr, data, size);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_reg_w_byte(uint16_t addr, uint8_t mask, uint8_t data) {
+    int spi_stat;
+
+    /* check if SPI is initialised */
+    if (lgw_spi_target[lgw_board] == NULL) {
+        DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+        return LGW_REG_ERROR;
+    }
+
+    lgw_reg_lock();
+    spi_stat = reg_w_byte(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, addr, mask, data);
+    lgw_reg_unlock();
+
+    if (spi_stat != LGW_SPI_SUCCESS) {
+        DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER WRITE\n");
+        return LGW_REG_ERROR;
+    } else {
+        return LGW_REG_SUCCESS;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_reg_r_byte(uint16_t addr, uint8_t *data) {
+    int spi_stat;
+
+    /* check input parameters */
+    CHECK_NULL(data);
+
+    /* check if SPI is initialised */
+    if (lgw_spi_target[lgw_board] == NULL) {
+        DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+        return LGW_REG_ERROR;
+    }
+
+    lgw_reg_lock();
+    spi_stat = reg_r_byte(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, addr, data);
+    lgw_reg_unlock();
+
+    if (spi_stat != LGW_SPI_SUCCESS) {
+        DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER READ\n");
+        return LGW_REG_ERROR;
+    } else {
+        return LGW_REG_SUCCESS;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_reg_rb_addr(uint16_t addr, uint8_t *data, uint16_t size) {
     int spi_stat = LGW_SPI_SUCCESS;
-    struct lgw_reg_s r;
 
     /* check input parameters */
     CHECK_NULL(data);
@@ -1379,22 +1710,25 @@ int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size) {
         DEBUG_MSG("ERROR: BURST OF NULL LENGTH\n");
         return LGW_REG_ERROR;
     }
-    if (register_id >= LGW_TOTALREGS) {
-        DEBUG_MSG("ERROR: REGISTER NUMBER OUT OF DEFINED RANGE\n");
-        return LGW_REG_ERROR;
-    }
 
     /* check if SPI is initialised */
-    if (lgw_spi_target == NULL) {
+    if (lgw_spi_target[lgw_board] == NULL) {
         DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
         return LGW_REG_ERROR;
     }
 
-    /* get register struct from the struct array */
-    r = loregs[register_id];
+    lgw_reg_lock();
+
+    /* submit queued register writes first */
+    if (batch_active[lgw_board] == true) {
+        spi_stat += batch_flush();
+    }
 
     /* do the burst read */
-    spi_stat += lgw_spi_rb(lgw_spi_target, LGW_SPI_MUX_TARGET_SX1302, r.addr, data, size);
+    spi_stat += lgw_com_rb(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, addr, data, size);
+    shadow_set(spi_stat, LGW_SPI_MUX_TARGET_SX1302, addr, data, size);
+
+    lgw_reg_unlock();
 
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BURST READ\n");
@@ -1408,11 +1742,6 @@ int lgw_reg_rb(uint16_t register_id, uint8_t *data, uint16_t size) {
 
 int lgw_mem_wb(uint16_t mem_addr, const uint8_t *data, uint16_t size) {
     int spi_stat = LGW_SPI_SUCCESS;
-    int chunk_cnt = 0;
-    uint16_t addr = mem_addr;
-    uint16_t sz_todo = size;
-    uint16_t chunk_size;
-    const uint16_t CHUNK_SIZE_MAX = 1024;
 
     /* check input parameters */
     CHECK_NULL(data);
@@ -1422,25 +1751,24 @@ int lgw_mem_wb(uint16_t mem_addr, const uint8_t *data, uint16_t size) {
     }
 
     /* check if SPI is initialised */
-    if (lgw_spi_target == NULL) {
+    if (lgw_spi_target[lgw_board] == NULL) {
         DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
         return LGW_REG_ERROR;
     }
 
-    /* write memory by chunks */
-    while (sz_todo > 0) {
-        /* full or partial chunk ? */
-        chunk_size = (sz_todo > CHUNK_SIZE_MAX) ? CHUNK_SIZE_MAX : sz_todo;
+    lgw_reg_lock();
 
-        /* do the burst write */
-        spi_stat += lgw_spi_wb(lgw_spi_target, LGW_SPI_MUX_TARGET_SX1302, addr, &data[chunk_cnt * CHUNK_SIZE_MAX], chunk_size);
-
-        /* prepare for next write */
-        addr += chunk_size;
-        sz_todo -= chunk_size;
-        chunk_cnt += 1;
+    /* submit queued register writes first */
+    if (batch_active[lgw_board] == true) {
+        spi_stat += batch_flush();
     }
 
+    /* write memory by chunks, combined in as few SPI messages as possible */
+    spi_stat += lgw_com_wb_chunks(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, mem_addr, data, size, mem_chunk_size[lgw_board]);
+    shadow_set(spi_stat, LGW_SPI_MUX_TARGET_SX1302, mem_addr, data, size);
+
+    lgw_reg_unlock();
+
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BURST WRITE\n");
         return LGW_REG_ERROR;
@@ -1453,11 +1781,6 @@ int lgw_mem_wb(uint16_t mem_addr, const uint8_t *data, uint16_t size) {
 
 int lgw_mem_rb(uint16_t mem_addr, uint8_t *data, uint16_t size, bool fifo_mode) {
     int spi_stat = LGW_SPI_SUCCESS;
-    int chunk_cnt = 0;
-    uint16_t addr = mem_addr;
-    uint16_t sz_todo = size;
-    uint16_t chunk_size;
-    const uint16_t CHUNK_SIZE_MAX = 1024;
 
     /* check input parameters */
     CHECK_NULL(data);
@@ -1467,35 +1790,128 @@ int lgw_mem_rb(uint16_t mem_addr, uint8_t *data, uint16_t size, bool fifo_mode)
     }
 
     /* check if SPI is initialised */
-    if (lgw_spi_target == NULL) {
+    if (lgw_spi_target[lgw_board] == NULL) {
         DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
         return LGW_REG_ERROR;
     }
 
-    /* read memory by chunks */
-    while (sz_todo > 0) {
-        /* full or partial chunk ? */
-        chunk_size = (sz_todo > CHUNK_SIZE_MAX) ? CHUNK_SIZE_MAX : sz_todo;
+    lgw_reg_lock();
+
+    /* submit queued register writes first */
+    if (batch_active[lgw_board] == true) {
+        spi_stat += batch_flush();
+    }
+
+    /* read memory by chunks, combined in as few SPI messages as possible */
+    /* do not increment the address when the target memory is in FIFO mode (auto-increment) */
+    spi_stat += lgw_com_rb_chunks(lgw_spi_target[lgw_board], LGW_SPI_MUX_TARGET_SX1302, mem_addr, data, size, mem_chunk_size[lgw_board], fifo_mode);
+
+    lgw_reg_unlock();
+
+    if (spi_stat != LGW_SPI_SUCCESS) {
+        DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BURST READ\n");
+        return LGW_REG_ERROR;
+    } else {
+        return LGW_REG_SUCCESS;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-        /* do the burst read */
-        spi_stat += lgw_spi_rb(lgw_spi_target, LGW_SPI_MUX_TARGET_SX1302, addr, &data[chunk_cnt * CHUNK_SIZE_MAX], chunk_size);
+int lgw_reg_spi_setconf(uint32_t speed_hz, uint16_t chunk_size) {
+    int spi_stat;
 
-        /* do not increment the address when the target memory is in FIFO mode (auto-increment) */
-        if (fifo_mode == false) {
-            addr += chunk_size;
+    /* check if SPI is initialised */
+    if (lgw_spi_target[lgw_board] == NULL) {
+        DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+        return LGW_REG_ERROR;
+    }
+
+    if (speed_hz != 0) {
+        lgw_reg_lock();
+        spi_stat = lgw_com_set_speed(lgw_spi_target[lgw_board], speed_hz);
+        lgw_reg_unlock();
+        if (spi_stat != LGW_SPI_SUCCESS) {
+            DEBUG_PRINTF("ERROR: FAILED TO SET SPI SPEED TO %u HZ\n", speed_hz);
+            return LGW_REG_ERROR;
         }
+    }
+    mem_chunk_size[lgw_board] = chunk_size;
+
+    DEBUG_PRINTF("Note: SPI speed %u Hz, memory chunk size %u (%s message size %u)\n", speed_hz, chunk_size, lgw_com_name(), lgw_com_get_msg_size_max());
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_reg_shadow_enable(bool enable) {
+    lgw_reg_lock();
+    shadow_enabled[lgw_board] = enable;
+
+    /* rebuild or clear the shadow copy, values will be read again from the chip */
+    shadow_init();
+    lgw_reg_unlock();
+
+    DEBUG_PRINTF("Note: register shadow copy %s\n", (enable == true) ? "enabled" : "disabled");
+    return LGW_REG_SUCCESS;
+}
 
-        /* prepare for next read */
-        sz_todo -= chunk_size;
-        chunk_cnt += 1;
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_reg_batch_start(void) {
+    /* check if SPI is initialised */
+    if (lgw_spi_target[lgw_board] == NULL) {
+        DEBUG_MSG("ERROR: CONCENTRATOR UNCONNECTED\n");
+        return LGW_REG_ERROR;
+    }
+
+    /* the lock is held until the end of the batch, other threads wait for it to be submitted */
+    lgw_reg_lock();
+    if (batch_active[lgw_board] == true) {
+        DEBUG_MSG("WARNING: register batch already started\n");
+        lgw_reg_unlock(); /* keep a single lock level for the batch */
+    }
+    batch_active[lgw_board] = true;
+
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_reg_batch_end(void) {
+    int spi_stat;
+
+    lgw_reg_lock();
+    if (batch_active[lgw_board] == false) {
+        DEBUG_MSG("WARNING: no register batch started\n");
+        lgw_reg_unlock();
+        return LGW_REG_SUCCESS;
     }
 
+    spi_stat = batch_flush();
+    batch_active[lgw_board] = false;
+    lgw_reg_unlock();
+    lgw_reg_unlock(); /* taken by lgw_reg_batch_start() */
+
     if (spi_stat != LGW_SPI_SUCCESS) {
-        DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BURST READ\n");
+        DEBUG_MSG("ERROR: SPI ERROR DURING REGISTER BATCH WRITE\n");
         return LGW_REG_ERROR;
     } else {
         return LGW_REG_SUCCESS;
     }
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_reg_lock(void) {
+    pthread_once(&mx_spi_once, mx_spi_init);
+    pthread_mutex_lock(&mx_spi[lgw_board]);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_reg_unlock(void) {
+    pthread_mutex_unlock(&mx_spi[lgw_board]);
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -19,18 +19,29 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
 #include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
 #include <stdio.h>      /* printf fprintf */
 #include <stdlib.h>     /* malloc free */
 #include <unistd.h>     /* lseek, close */
 #include <fcntl.h>      /* open */
 #include <string.h>     /* memset */
+#include <time.h>       /* clock_gettime */
 
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
 
 #include "loragw_spi.h"
+#include "loragw_com.h"
 #include "loragw_aux.h"
+#include "loragw_hal.h"  /* LGW_BOARD_NB */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
@@ -52,6 +63,103 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define READ_ACCESS     0x00
 #define WRITE_ACCESS    0x80
 
+#define SPIDEV_BUFSIZ_PATH      "/sys/module/spidev/parameters/bufsiz"
+#define SPIDEV_BUFSIZ_DEFAULT   4096    /* spidev default, used if the module parameter cannot be read */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static uint32_t spi_speed[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = SPI_SPEED }; /* current SPI clock of each board, in Hz */
+static uint32_t spi_bufsiz = SPIDEV_BUFSIZ_DEFAULT; /* max number of bytes in one spidev message */
+
+/* -------------------------------------------------------------------------- */
+/* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
+
+extern __thread lgw_handle_t lgw_board;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static uint32_t spidev_get_bufsiz(void) {
+    FILE *fp;
+    unsigned long bufsiz = 0;
+
+    fp = fopen(SPIDEV_BUFSIZ_PATH, "r");
+    if (fp == NULL) {
+        DEBUG_MSG("Note: spidev bufsiz not available, using default\n");
+        return SPIDEV_BUFSIZ_DEFAULT;
+    }
+    if ((fscanf(fp, "%lu", &bufsiz) != 1) || (bufsiz == 0)) {
+        bufsiz = SPIDEV_BUFSIZ_DEFAULT;
+    }
+    fclose(fp);
+
+    return (uint32_t)bufsiz;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Burst access split in chunks, as many chunks as possible being combined in one SPI message */
+static int spi_burst_chunks(int spi_device, uint8_t spi_mux_target, uint8_t access, uint16_t address, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size, uint16_t chunk_size, bool inc_addr) {
+    uint8_t command[LGW_SPI_MSG_BURST_MAX][4];
+    uint8_t command_size;
+    struct spi_ioc_transfer k[2 * LGW_SPI_MSG_BURST_MAX];
+    uint16_t addr = address;
+    int offset = 0;
+    int nb_chunks, msg_size, size_to_do, byte_transfered;
+
+    /* a read command has a dummy byte after the address */
+    command_size = (access == READ_ACCESS) ? 4 : 3;
+
+    /* a chunk, with its command, must fit in one spidev message */
+    if ((chunk_size == 0) || (chunk_size > (spi_bufsiz - command_size))) {
+        chunk_size = spi_bufsiz - command_size;
+    }
+
+    while (offset < size) {
+        /* prepare as many chunks as fit in one message, chip select is released after each chunk */
+        memset(&k, 0, sizeof(k)); /* clear k */
+        nb_chunks = 0;
+        msg_size = 0;
+        while ((offset < size) && (nb_chunks < LGW_SPI_MSG_BURST_MAX)) {
+            size_to_do = ((size - offset) < chunk_size) ? (size - offset) : chunk_size;
+            if ((nb_chunks > 0) && ((msg_size + command_size + size_to_do) > (int)spi_bufsiz)) {
+                break;
+            }
+            command[nb_chunks][0] = spi_mux_target;
+            command[nb_chunks][1] = access | ((addr >> 8) & 0x7F);
+            command[nb_chunks][2] =          ((addr >> 0) & 0xFF);
+            command[nb_chunks][3] = 0x00;
+            k[2*nb_chunks].tx_buf = (unsigned long) &command[nb_chunks][0];
+            k[2*nb_chunks].len = command_size;
+            if (tx_data != NULL) {
+                k[2*nb_chunks+1].tx_buf = (unsigned long)(tx_data + offset);
+            } else {
+                k[2*nb_chunks+1].rx_buf = (unsigned long)(rx_data + offset);
+            }
+            k[2*nb_chunks+1].len = size_to_do;
+            k[2*nb_chunks+1].cs_change = 1;
+            msg_size += command_size + size_to_do;
+            offset += size_to_do;
+            if (inc_addr == true) {
+                addr += size_to_do;
+            }
+            nb_chunks += 1;
+        }
+        k[2*nb_chunks-1].cs_change = 0; /* end of message releases chip select */
+
+        /* I/O transaction */
+        byte_transfered = lgw_spi_message(spi_device, spi_mux_target, (access == READ_ACCESS) ? LGW_SPI_OP_READ_BURST : LGW_SPI_OP_WRITE_BURST, k, 2 * nb_chunks);
+        DEBUG_PRINTF("CHUNKED BURST: %d chunks # to trans %d # transferred %d \n", nb_chunks, msg_size, byte_transfered);
+        if (byte_transfered != msg_size) {
+            DEBUG_MSG("ERROR: SPI CHUNKED BURST FAILURE\n");
+            return LGW_SPI_ERROR;
+        }
+    }
+
+    return LGW_SPI_SUCCESS;
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
@@ -91,6 +199,7 @@ int lgw_spi_open(const char * spidev_path, void **spi_target_ptr) {
     }
 
     /* setting SPI max clk (in Hz) */
+    spi_speed[lgw_board] = SPI_SPEED;
     i = SPI_SPEED;
     a = ioctl(dev, SPI_IOC_WR_MAX_SPEED_HZ, &i);
     b = ioctl(dev, SPI_IOC_RD_MAX_SPEED_HZ, &i);
@@ -122,6 +231,10 @@ int lgw_spi_open(const char * spidev_path, void **spi_target_ptr) {
         return LGW_SPI_ERROR;
     }
 
+    /* get the max size of a SPI message */
+    spi_bufsiz = spidev_get_bufsiz();
+    DEBUG_PRINTF("Note: spidev bufsiz is %u bytes\n", spi_bufsiz);
+
     *spi_device = dev;
     *spi_target_ptr = (void *)spi_device;
     DEBUG_MSG("Note: SPI port opened and configured ok\n");
@@ -130,6 +243,42 @@ int lgw_spi_open(const char * spidev_path, void **spi_target_ptr) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+/* SPI clock configuration */
+int lgw_spi_set_speed(void *spi_target, uint32_t speed_hz) {
+    int spi_device;
+    int a, b;
+    uint32_t i;
+
+    /* check input variables */
+    CHECK_NULL(spi_target);
+    if (speed_hz == 0) {
+        DEBUG_MSG("ERROR: SPI SPEED CANNOT BE NULL\n");
+        return LGW_SPI_ERROR;
+    }
+
+    spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
+
+    i = speed_hz;
+    a = ioctl(spi_device, SPI_IOC_WR_MAX_SPEED_HZ, &i);
+    b = ioctl(spi_device, SPI_IOC_RD_MAX_SPEED_HZ, &i);
+    if ((a < 0) || (b < 0)) {
+        DEBUG_MSG("ERROR: SPI PORT FAIL TO SET MAX SPEED\n");
+        return LGW_SPI_ERROR;
+    }
+    spi_speed[lgw_board] = i;
+
+    DEBUG_PRINTF("Note: SPI speed set to %u Hz\n", spi_speed[lgw_board]);
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint32_t lgw_spi_get_msg_size_max(void) {
+    return spi_bufsiz;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 /* SPI release */
 int lgw_spi_close(void *spi_target) {
     int spi_device;
@@ -179,10 +328,10 @@ int lgw_spi_w(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_
     memset(&k, 0, sizeof(k)); /* clear k */
     k.tx_buf = (unsigned long) out_buf;
     k.len = command_size;
-    k.speed_hz = SPI_SPEED;
+    k.speed_hz = spi_speed[lgw_board];
     k.cs_change = 0;
     k.bits_per_word = 8;
-    a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+    a = lgw_spi_message(spi_device, spi_mux_target, LGW_SPI_OP_WRITE, &k, 1);
 
     /* determine return code */
     if (a != (int)k.len) {
@@ -225,7 +374,7 @@ int lgw_spi_r(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_
     k.rx_buf = (unsigned long) in_buf;
     k.len = command_size;
     k.cs_change = 0;
-    a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+    a = lgw_spi_message(spi_device, spi_mux_target, LGW_SPI_OP_READ, &k, 1);
 
     /* determine return code */
     if (a != (int)k.len) {
@@ -278,7 +427,7 @@ int lgw_spi_wb(void *spi_target, uint8_t spi_mux_target, uint16_t address, const
         offset = i * LGW_BURST_CHUNK;
         k[1].tx_buf = (unsigned long)(data + offset);
         k[1].len = chunk_size;
-        byte_transfered += (ioctl(spi_device, SPI_IOC_MESSAGE(2), &k) - k[0].len );
+        byte_transfered += (lgw_spi_message(spi_device, spi_mux_target, LGW_SPI_OP_WRITE_BURST, k, 2) - k[0].len );
         DEBUG_PRINTF("BURST WRITE: to trans %d # chunk %d # transferred %d \n", size_to_do, chunk_size, byte_transfered);
         size_to_do -= chunk_size; /* subtract the quantity of data already transferred */
     }
@@ -334,7 +483,7 @@ int lgw_spi_rb(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8
         offset = i * LGW_BURST_CHUNK;
         k[1].rx_buf = (unsigned long)(data + offset);
         k[1].len = chunk_size;
-        byte_transfered += (ioctl(spi_device, SPI_IOC_MESSAGE(2), &k) - k[0].len );
+        byte_transfered += (lgw_spi_message(spi_device, spi_mux_target, LGW_SPI_OP_READ_BURST, k, 2) - k[0].len );
         DEBUG_PRINTF("BURST READ: to trans %d # chunk %d # transferred %d \n", size_to_do, chunk_size, byte_transfered);
         size_to_do -= chunk_size;  /* subtract the quantity of data already transferred */
     }
@@ -349,4 +498,175 @@ int lgw_spi_rb(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8
     }
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Chunked burst write, chunks combined in SPI messages */
+int lgw_spi_wb_chunks(void *spi_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size, uint16_t chunk_size) {
+    /* check input parameters */
+    CHECK_NULL(spi_target);
+    CHECK_NULL(data);
+    if (size == 0) {
+        DEBUG_MSG("ERROR: BURST OF NULL LENGTH\n");
+        return LGW_SPI_ERROR;
+    }
+
+    return spi_burst_chunks(*(int *)spi_target, spi_mux_target, WRITE_ACCESS, address, data, NULL, size, chunk_size, true);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Chunked burst read, chunks combined in SPI messages */
+int lgw_spi_rb_chunks(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, uint16_t chunk_size, bool fifo_mode) {
+    /* check input parameters */
+    CHECK_NULL(spi_target);
+    CHECK_NULL(data);
+    if (size == 0) {
+        DEBUG_MSG("ERROR: BURST OF NULL LENGTH\n");
+        return LGW_SPI_ERROR;
+    }
+
+    return spi_burst_chunks(*(int *)spi_target, spi_mux_target, READ_ACCESS, address, NULL, data, size, chunk_size, !fifo_mode);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Multiple burst write, combined in SPI messages */
+int lgw_spi_wb_multi(void *spi_target, uint8_t spi_mux_target, const struct lgw_spi_burst_s *bursts, uint16_t nb_bursts) {
+    int spi_device;
+    uint8_t command[LGW_SPI_MSG_BURST_MAX][3];
+    struct spi_ioc_transfer k[2 * LGW_SPI_MSG_BURST_MAX];
+    int nb_msg_bursts;
+    int size_to_do, byte_transfered;
+    int i, j;
+
+    /* check input parameters */
+    CHECK_NULL(spi_target);
+    CHECK_NULL(bursts);
+    for (i = 0; i < nb_bursts; i++) {
+        CHECK_NULL(bursts[i].data);
+        if ((bursts[i].size == 0) || (bursts[i].size > LGW_BURST_CHUNK)) {
+            DEBUG_PRINTF("ERROR: WRONG BURST SIZE %u (burst %d)\n", bursts[i].size, i);
+            return LGW_SPI_ERROR;
+        }
+    }
+
+    spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
+
+    for (i = 0; i < nb_bursts; i += nb_msg_bursts) {
+        nb_msg_bursts = ((nb_bursts - i) < LGW_SPI_MSG_BURST_MAX) ? (nb_bursts - i) : LGW_SPI_MSG_BURST_MAX;
+
+        /* do not exceed the spidev message size */
+        size_to_do = 0;
+        for (j = 0; j < nb_msg_bursts; j++) {
+            if ((j > 0) && ((size_to_do + 3 + bursts[i+j].size) > (int)spi_bufsiz)) {
+                nb_msg_bursts = j;
+                break;
+            }
+            size_to_do += 3 + bursts[i+j].size;
+        }
+
+        /* prepare command bytes and transfers, chip select is released after each burst */
+        memset(&k, 0, sizeof(k)); /* clear k */
+        size_to_do = 0;
+        for (j = 0; j < nb_msg_bursts; j++) {
+            command[j][0] = spi_mux_target;
+            command[j][1] = WRITE_ACCESS | ((bursts[i+j].address >> 8) & 0x7F);
+            command[j][2] =                ((bursts[i+j].address >> 0) & 0xFF);
+            k[2*j].tx_buf = (unsigned long) &command[j][0];
+            k[2*j].len = 3;
+            k[2*j].cs_change = 0;
+            k[2*j+1].tx_buf = (unsigned long) bursts[i+j].data;
+            k[2*j+1].len = bursts[i+j].size;
+            k[2*j+1].cs_change = (j < (nb_msg_bursts - 1)) ? 1 : 0;
+            size_to_do += 3 + bursts[i+j].size;
+        }
+
+        /* I/O transaction */
+        byte_transfered = lgw_spi_message(spi_device, spi_mux_target, LGW_SPI_OP_WRITE_BURST, k, 2 * nb_msg_bursts);
+        DEBUG_PRINTF("MULTI BURST WRITE: %d bursts # to trans %d # transferred %d \n", nb_msg_bursts, size_to_do, byte_transfered);
+        if (byte_transfered != size_to_do) {
+            DEBUG_MSG("ERROR: SPI MULTI BURST WRITE FAILURE\n");
+            return LGW_SPI_ERROR;
+        }
+    }
+
+    DEBUG_MSG("Note: SPI multi burst write success\n");
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_spi_xfer(void *spi_target, lgw_spi_op_t op, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size) {
+    struct spi_ioc_transfer k;
+    int a;
+
+    /* check input variables */
+    CHECK_NULL(spi_target);
+    CHECK_NULL(tx_data);
+    if (size == 0) {
+        DEBUG_MSG("ERROR: FRAME OF NULL LENGTH\n");
+        return LGW_SPI_ERROR;
+    }
+
+    /* I/O transaction, radio commands are written at the default SPI speed */
+    memset(&k, 0, sizeof(k)); /* clear k */
+    k.tx_buf = (unsigned long) tx_data;
+    k.rx_buf = (unsigned long) rx_data;
+    k.len = size;
+    k.cs_change = 0;
+    if (rx_data == NULL) {
+        k.speed_hz = SPI_SPEED;
+        k.bits_per_word = 8;
+    }
+    a = lgw_spi_message(*(int *)spi_target, tx_data[0], op, &k, 1);
+
+    /* determine return code */
+    if (a != (int)k.len) {
+        DEBUG_MSG("ERROR: SPI FRAME FAILURE\n");
+        return LGW_SPI_ERROR;
+    } else {
+        return LGW_SPI_SUCCESS;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_spi_message(int spi_device, uint8_t spi_mux_target, lgw_spi_op_t op, struct spi_ioc_transfer *k, unsigned nb_xfer) {
+    struct timespec start, end;
+    uint32_t bytes = 0;
+    unsigned i;
+    int a;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    a = ioctl(spi_device, SPI_IOC_MESSAGE(nb_xfer), k);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (i = 0; i < nb_xfer; i++) {
+        bytes += k[i].len;
+    }
+    lgw_com_account(spi_mux_target, op, bytes, (uint32_t)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000), (a < 0));
+
+    return a;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- TRANSPORT DEFINITION ------------------------------------------------- */
+
+const struct lgw_com_s lgw_spi_com = {
+    .name = "spidev",
+    .simulated = false,
+    .open = lgw_spi_open,
+    .close = lgw_spi_close,
+    .set_speed = lgw_spi_set_speed,
+    .get_msg_size_max = lgw_spi_get_msg_size_max,
+    .w = lgw_spi_w,
+    .r = lgw_spi_r,
+    .wb = lgw_spi_wb,
+    .rb = lgw_spi_rb,
+    .wb_chunks = lgw_spi_wb_chunks,
+    .rb_chunks = lgw_spi_rb_chunks,
+    .wb_multi = lgw_spi_wb_multi,
+    .xfer = lgw_spi_xfer
+};
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -16,20 +16,27 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
 #include <stdint.h>     /* C99 types */
 #include <stdio.h>      /* printf fprintf */
 #include <stdlib.h>     /* malloc free */
 #include <unistd.h>     /* lseek, close */
 #include <fcntl.h>      /* open */
 #include <string.h>     /* memset */
-
-#include <sys/ioctl.h>
-#include <linux/spi/spidev.h>
+#include <time.h>       /* clock_gettime */
 
 #include "loragw_spi.h"
+#include "loragw_com.h"
 #include "loragw_reg.h"
 #include "loragw_aux.h"
 #include "loragw_sx1250.h"
+#include "loragw_hal.h"  /* LGW_BOARD_NB */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
@@ -51,30 +58,69 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* --- PRIVATE CONSTANTS ---------------------------------------------------- */
 
 #define WAIT_BUSY_SX1250_MS  1
+#define WAIT_MODE_SX1250_MS  10 /* worst case delay for a mode change */
+#define WAIT_CALIB_SX1250_MS 10 /* worst case duration of a calibration */
+
+/* chip modes reported by a radio that is not busy: a busy radio ignores the
+   command and leaves MISO undriven, read as mode 0x0 or 0x7 */
+#define SX1250_MODE_FIRST    SX1250_MODE_STDBY_RC
+#define SX1250_MODE_LAST     SX1250_MODE_TX
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static bool fast_start[LGW_BOARD_NB]; /* poll the chip mode instead of waiting for the worst case delay */
 
 /* -------------------------------------------------------------------------- */
 /* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
 
-extern void *lgw_spi_target; /*! generic pointer to the SPI device */
+extern __thread lgw_handle_t lgw_board; /*! concentrator board accessed by the calling thread */
+extern void *lgw_spi_target[LGW_BOARD_NB]; /*! generic pointers to the SPI devices */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static uint32_t elapsed_us(const struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* GET_STATUS without waiting for the radio, to poll it */
+static int get_status(uint8_t rf_chain, uint8_t *mode) {
+    uint8_t out_buf[3];
+    uint8_t in_buf[3];
+
+    CHECK_NULL(lgw_spi_target[lgw_board]);
+
+    out_buf[0] = (rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB;
+    out_buf[1] = (uint8_t)GET_STATUS;
+    out_buf[2] = 0x00;
+    if (lgw_com_xfer(lgw_spi_target[lgw_board], LGW_SPI_OP_READ, out_buf, in_buf, sizeof out_buf) != LGW_COM_SUCCESS) {
+        return LGW_SPI_ERROR;
+    }
+
+    *mode = (uint8_t)TAKE_N_BITS_FROM(in_buf[2], 4, 3);
+    return LGW_SPI_SUCCESS;
+}
 
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
-int sx1250_write_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *data, uint16_t size) {
-    int spi_device;
+int sx1250_write_command(uint8_t rf_chain, sx1250_op_code_t op_code, const uint8_t *data, uint16_t size) {
     int cmd_size = 2; /* header + op_code */
     uint8_t out_buf[cmd_size + size];
     uint8_t command_size;
-    struct spi_ioc_transfer k;
     int a, i;
 
     /* wait BUSY */
-    wait_ms(WAIT_BUSY_SX1250_MS);
+    sx1250_wait_ready(rf_chain, WAIT_BUSY_SX1250_MS);
 
     /* check input variables */
-    CHECK_NULL(lgw_spi_target);
-
-    spi_device = *(int *)lgw_spi_target; /* must check that spi_target is not null beforehand */
+    CHECK_NULL(lgw_spi_target[lgw_board]);
 
     /* prepare frame to be sent */
     out_buf[0] = (rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB;
@@ -85,16 +131,10 @@ int sx1250_write_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *da
     command_size = cmd_size + size;
 
     /* I/O transaction */
-    memset(&k, 0, sizeof(k)); /* clear k */
-    k.tx_buf = (unsigned long) out_buf;
-    k.len = command_size;
-    k.speed_hz = SPI_SPEED;
-    k.cs_change = 0;
-    k.bits_per_word = 8;
-    a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+    a = lgw_com_xfer(lgw_spi_target[lgw_board], LGW_SPI_OP_WRITE, out_buf, NULL, command_size);
 
     /* determine return code */
-    if (a != (int)k.len) {
+    if (a != LGW_COM_SUCCESS) {
         DEBUG_MSG("ERROR: SPI WRITE FAILURE\n");
         return LGW_SPI_ERROR;
     } else {
@@ -106,23 +146,19 @@ int sx1250_write_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *da
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int sx1250_read_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *data, uint16_t size) {
-    int spi_device;
     int cmd_size = 2; /* header + op_code + NOP */
     uint8_t out_buf[cmd_size + size];
     uint8_t command_size;
     uint8_t in_buf[ARRAY_SIZE(out_buf)];
-    struct spi_ioc_transfer k;
     int a, i;
 
     /* wait BUSY */
-    wait_ms(WAIT_BUSY_SX1250_MS);
+    sx1250_wait_ready(rf_chain, WAIT_BUSY_SX1250_MS);
 
     /* check input variables */
-    CHECK_NULL(lgw_spi_target);
+    CHECK_NULL(lgw_spi_target[lgw_board]);
     CHECK_NULL(data);
 
-    spi_device = *(int *)lgw_spi_target; /* must check that spi_target is not null beforehand */
-
     /* prepare frame to be sent */
     out_buf[0] = (rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB;
     out_buf[1] = (uint8_t)op_code;
@@ -132,15 +168,10 @@ int sx1250_read_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *dat
     command_size = cmd_size + size;
 
     /* I/O transaction */
-    memset(&k, 0, sizeof(k)); /* clear k */
-    k.tx_buf = (unsigned long) out_buf;
-    k.rx_buf = (unsigned long) in_buf;
-    k.len = command_size;
-    k.cs_change = 0;
-    a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+    a = lgw_com_xfer(lgw_spi_target[lgw_board], LGW_SPI_OP_READ, out_buf, in_buf, command_size);
 
     /* determine return code */
-    if (a != (int)k.len) {
+    if (a != LGW_COM_SUCCESS) {
         DEBUG_MSG("ERROR: SPI READ FAILURE\n");
         return LGW_SPI_ERROR;
     } else {
@@ -153,6 +184,75 @@ int sx1250_read_command(uint8_t rf_chain, sx1250_op_code_t op_code, uint8_t *dat
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+int sx1250_write_commands(uint8_t rf_chain, const struct sx1250_cmd_s *cmds, unsigned nb_cmds) {
+    unsigned i;
+
+    CHECK_NULL(cmds);
+
+    for (i = 0; i < nb_cmds; i++) {
+        if (sx1250_write_command(rf_chain, cmds[i].op_code, cmds[i].data, cmds[i].size) != LGW_SPI_SUCCESS) {
+            DEBUG_PRINTF("ERROR: command %u of the sequence (0x%02X) failed\n", i, cmds[i].op_code);
+            return LGW_SPI_ERROR;
+        }
+    }
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void sx1250_set_fast_start(bool enable) {
+    fast_start[lgw_board] = enable;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1250_wait_mode(uint8_t rf_chain, uint8_t mode, uint32_t timeout_ms) {
+    struct timespec start;
+    uint8_t status;
+
+    if (fast_start[lgw_board] == false) {
+        wait_ms(timeout_ms);
+        status = 0x00;
+        sx1250_read_command(rf_chain, GET_STATUS, &status, 1);
+        return ((uint8_t)(TAKE_N_BITS_FROM(status, 4, 3)) == mode) ? 0 : -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        if ((get_status(rf_chain, &status) == LGW_SPI_SUCCESS) && (status == mode)) {
+            return 0;
+        }
+    } while (elapsed_us(&start) < (timeout_ms * 1000));
+
+    return -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1250_wait_ready(uint8_t rf_chain, uint32_t timeout_ms) {
+    struct timespec start;
+    uint8_t mode;
+
+    if (fast_start[lgw_board] == false) {
+        wait_ms(timeout_ms);
+        return 0;
+    }
+
+    /* an SPI transaction takes a few tens of us, no need to sleep between polls */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        if ((get_status(rf_chain, &mode) == LGW_SPI_SUCCESS) && (mode >= SX1250_MODE_FIRST) && (mode <= SX1250_MODE_LAST)) {
+            return 0;
+        }
+    } while (elapsed_us(&start) < (timeout_ms * 1000));
+
+    DEBUG_PRINTF("WARNING: SX1250_%u still busy after %u ms\n", rf_chain, timeout_ms);
+    return -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int sx1250_calibrate(uint8_t rf_chain, uint32_t freq_hz) {
     uint8_t buff[16];
 
@@ -182,7 +282,7 @@ int sx1250_calibrate(uint8_t rf_chain, uint32_t freq_hz) {
     sx1250_write_command(rf_chain, CALIBRATE_IMAGE, buff, 2);
 
     /* Wait for calibration to complete */
-    wait_ms(10);
+    sx1250_wait_ready(rf_chain, WAIT_CALIB_SX1250_MS);
 
     buff[0] = 0x00;
     buff[1] = 0x00;
@@ -201,16 +301,30 @@ int sx1250_calibrate(uint8_t rf_chain, uint32_t freq_hz) {
 int sx1250_setup(uint8_t rf_chain, uint32_t freq_hz, bool single_input_mode) {
     int32_t freq_reg;
     uint8_t buff[16];
+    struct sx1250_cmd_s rx_cmds[3];
+
+    /* register settings, sent back to back once the radio runs on XOSC */
+    static const struct sx1250_cmd_s setup_cmds[] = {
+        /* Set Bitrate to maximum (to lower TX to FS switch time) */
+        {WRITE_REGISTER, 3, {0x06, 0xA1, 0x01}},
+        {WRITE_REGISTER, 3, {0x06, 0xA2, 0x00}},
+        {WRITE_REGISTER, 3, {0x06, 0xA3, 0x00}},
+        /* Configure DIO for Rx */
+        {WRITE_REGISTER, 3, {0x05, 0x82, 0x00}}, /* Drive strength to min */
+        {WRITE_REGISTER, 3, {0x05, 0x83, 0x00}}, /* Input enable, all disabled */
+        {WRITE_REGISTER, 3, {0x05, 0x84, 0x00}}, /* No pull up */
+        {WRITE_REGISTER, 3, {0x05, 0x85, 0x00}}, /* No pull down */
+        {WRITE_REGISTER, 3, {0x05, 0x80, 0x00}}, /* Output enable, all enabled */
+        /* Set fix gain (??) */
+        {WRITE_REGISTER, 3, {0x08, 0xB6, 0x2A}}
+    };
 
     /* Set Radio in Standby for calibrations */
     buff[0] = (uint8_t)STDBY_RC;
     sx1250_write_command(rf_chain, SET_STANDBY, buff, 1);
-    wait_ms(10);
 
     /* Get status to check Standby mode has been properly set */
-    buff[0] = 0x00;
-    sx1250_read_command(rf_chain, GET_STATUS, buff, 1);
-    if ((uint8_t)(TAKE_N_BITS_FROM(buff[0], 4, 3)) != 0x02) {
+    if (sx1250_wait_mode(rf_chain, SX1250_MODE_STDBY_RC, WAIT_MODE_SX1250_MS) != 0) {
         printf("ERROR: Failed to set SX1250_%u in STANDBY_RC mode\n", rf_chain);
         return -1;
     }
@@ -218,84 +332,42 @@ int sx1250_setup(uint8_t rf_chain, uint32_t freq_hz, bool single_input_mode) {
     /* Run all calibrations (TCXO) */
     buff[0] = 0x7F;
     sx1250_write_command(rf_chain, CALIBRATE, buff, 1);
-    wait_ms(10);
+    sx1250_wait_ready(rf_chain, WAIT_CALIB_SX1250_MS); /* busy during calibration */
 
     /* Set Radio in Standby with XOSC ON */
     buff[0] = (uint8_t)STDBY_XOSC;
     sx1250_write_command(rf_chain, SET_STANDBY, buff, 1);
-    wait_ms(10);
 
     /* Get status to check Standby mode has been properly set */
-    buff[0] = 0x00;
-    sx1250_read_command(rf_chain, GET_STATUS, buff, 1);
-    if ((uint8_t)(TAKE_N_BITS_FROM(buff[0], 4, 3)) != 0x03) {
+    if (sx1250_wait_mode(rf_chain, SX1250_MODE_STDBY_XOSC, WAIT_MODE_SX1250_MS) != 0) {
         printf("ERROR: Failed to set SX1250_%u in STANDBY_XOSC mode\n", rf_chain);
         return -1;
     }
 
-    /* Set Bitrate to maximum (to lower TX to FS switch time) */
-    buff[0] = 0x06;
-    buff[1] = 0xA1;
-    buff[2] = 0x01;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3);
-    buff[0] = 0x06;
-    buff[1] = 0xA2;
-    buff[2] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3);
-    buff[0] = 0x06;
-    buff[1] = 0xA3;
-    buff[2] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3);
-
-    /* Configure DIO for Rx */
-    buff[0] = 0x05;
-    buff[1] = 0x82;
-    buff[2] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3); /* Drive strength to min */
-    buff[0] = 0x05;
-    buff[1] = 0x83;
-    buff[2] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3); /* Input enable, all disabled */
-    buff[0] = 0x05;
-    buff[1] = 0x84;
-    buff[2] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3); /* No pull up */
-    buff[0] = 0x05;
-    buff[1] = 0x85;
-    buff[2] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3); /* No pull down */
-    buff[0] = 0x05;
-    buff[1] = 0x80;
-    buff[2] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3); /* Output enable, all enabled */
-
-    /* Set fix gain (??) */
-    buff[0] = 0x08;
-    buff[1] = 0xB6;
-    buff[2] = 0x2A;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 3);
+    sx1250_write_commands(rf_chain, setup_cmds, ARRAY_SIZE(setup_cmds));
 
     /* Set frequency */
     freq_reg = SX1250_FREQ_TO_REG(freq_hz);
-    buff[0] = (uint8_t)(freq_reg >> 24);
-    buff[1] = (uint8_t)(freq_reg >> 16);
-    buff[2] = (uint8_t)(freq_reg >> 8);
-    buff[3] = (uint8_t)(freq_reg >> 0);
-    sx1250_write_command(rf_chain, SET_RF_FREQUENCY, buff, 4);
+    rx_cmds[0].op_code = SET_RF_FREQUENCY;
+    rx_cmds[0].size = 4;
+    rx_cmds[0].data[0] = (uint8_t)(freq_reg >> 24);
+    rx_cmds[0].data[1] = (uint8_t)(freq_reg >> 16);
+    rx_cmds[0].data[2] = (uint8_t)(freq_reg >> 8);
+    rx_cmds[0].data[3] = (uint8_t)(freq_reg >> 0);
 
     /* Set frequency offset to 0 */
-    buff[0] = 0x08;
-    buff[1] = 0x8F;
-    buff[2] = 0x00;
-    buff[3] = 0x00;
-    buff[4] = 0x00;
-    sx1250_write_command(rf_chain, WRITE_REGISTER, buff, 5);
+    rx_cmds[1].op_code = WRITE_REGISTER;
+    rx_cmds[1].size = 5;
+    memset(rx_cmds[1].data, 0, 5);
+    rx_cmds[1].data[0] = 0x08;
+    rx_cmds[1].data[1] = 0x8F;
 
     /* Set Radio in Rx mode, necessary to give a clock to SX1302 */
-    buff[0] = 0xFF;
-    buff[1] = 0xFF;
-    buff[2] = 0xFF;
-    sx1250_write_command(rf_chain, SET_RX, buff, 3); /* Rx Continuous */
+    rx_cmds[2].op_code = SET_RX;
+    rx_cmds[2].size = 3;
+    memset(rx_cmds[2].data, 0xFF, 3); /* Rx Continuous */
+
+    sx1250_write_commands(rf_chain, rx_cmds, ARRAY_SIZE(rx_cmds));
 
     /* Select single input or differential input mode */
     if (single_input_mode == true) {
@@ -19,11 +19,10 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <stdbool.h>    /* bool type */
 #include <stdio.h>      /* printf fprintf */
 #include <string.h>     /* memset */
-#include <sys/ioctl.h>
-#include <linux/spi/spidev.h>
 
 #include "loragw_sx125x.h"
 #include "loragw_spi.h"
+#include "loragw_com.h"
 #include "loragw_aux.h"
 #include "loragw_reg.h"
 #include "loragw_hal.h"
@@ -49,10 +48,19 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* --- PRIVATE CONSTANTS ---------------------------------------------------- */
 
 #define PLL_LOCK_MAX_ATTEMPTS 5
+#define POR_DELAY_MS            5   /* radio not ready before this delay after its reset is released */
 
 #define READ_ACCESS     0x00
 #define WRITE_ACCESS    0x80
 
+#define REG_ADDR_NB     0x80    /* 7-bit register address */
+
+/* registers changed by the radio itself (VERSION, MODE_STATUS), or whose
+   writes trigger a state change (MODE), always accessed */
+#define REG_ADDR_MODE           0
+#define REG_ADDR_VERSION        7
+#define REG_ADDR_MODE_STATUS    17
+
 static const struct radio_reg_s sx125x_regs[RADIO_TOTALREGS] = {
     {0,0,8}, /* MODE */
     {0,3,1}, /* MODE__PA_DRIVER_EN */
@@ -110,26 +118,28 @@ static const struct radio_reg_s sx125x_regs[RADIO_TOTALREGS] = {
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
-extern void *lgw_spi_target; /*! generic pointer to the SPI device */
+extern __thread lgw_handle_t lgw_board; /*! concentrator board accessed by the calling thread */
+extern void *lgw_spi_target[LGW_BOARD_NB]; /*! generic pointers to the SPI devices */
+
+/* last value written to or read from each radio register of each board, used to skip
+   the writes of unchanged values and the reads of read-modify-write accesses */
+static uint8_t reg_shadow[LGW_BOARD_NB][LGW_RF_CHAIN_NB][REG_ADDR_NB];
+static bool reg_shadow_ok[LGW_BOARD_NB][LGW_RF_CHAIN_NB][REG_ADDR_NB];
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
 
 /* Simple read */
 int sx125x_reg_r(void *spi_target, uint8_t spi_mux_target, uint8_t address, uint8_t *data) {
-    int spi_device;
     uint8_t out_buf[3];
     uint8_t command_size;
     uint8_t in_buf[ARRAY_SIZE(out_buf)];
-    struct spi_ioc_transfer k;
     int a;
 
     /* check input variables */
     CHECK_NULL(spi_target);
     CHECK_NULL(data);
 
-    spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
-
     /* prepare frame to be sent */
     out_buf[0] = spi_mux_target;
     out_buf[1] = READ_ACCESS | (address & 0x7F);
@@ -137,15 +147,10 @@ int sx125x_reg_r(void *spi_target, uint8_t spi_mux_target, uint8_t address, uint
     command_size = 3;
 
     /* I/O transaction */
-    memset(&k, 0, sizeof(k)); /* clear k */
-    k.tx_buf = (unsigned long) out_buf;
-    k.rx_buf = (unsigned long) in_buf;
-    k.len = command_size;
-    k.cs_change = 0;
-    a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+    a = lgw_com_xfer(spi_target, LGW_SPI_OP_READ, out_buf, in_buf, command_size);
 
     /* determine return code */
-    if (a != (int)k.len) {
+    if (a != LGW_COM_SUCCESS) {
         DEBUG_MSG("ERROR: SPI READ FAILURE\n");
         return LGW_SPI_ERROR;
     } else {
@@ -158,17 +163,13 @@ int sx125x_reg_r(void *spi_target, uint8_t spi_mux_target, uint8_t address, uint
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int sx125x_reg_w(void *spi_target, uint8_t spi_mux_target, uint8_t address, uint8_t data) {
-    int spi_device;
     uint8_t out_buf[3];
     uint8_t command_size;
-    struct spi_ioc_transfer k;
     int a;
 
     /* check input variables */
     CHECK_NULL(spi_target);
 
-    spi_device = *(int *)spi_target; /* must check that spi_target is not null beforehand */
-
     /* prepare frame to be sent */
     out_buf[0] = spi_mux_target;
     out_buf[1] = WRITE_ACCESS | (address & 0x7F);
@@ -176,16 +177,10 @@ int sx125x_reg_w(void *spi_target, uint8_t spi_mux_target, uint8_t address, uint
     command_size = 3;
 
     /* I/O transaction */
-    memset(&k, 0, sizeof(k)); /* clear k */
-    k.tx_buf = (unsigned long) out_buf;
-    k.len = command_size;
-    k.speed_hz = SPI_SPEED;
-    k.cs_change = 0;
-    k.bits_per_word = 8;
-    a = ioctl(spi_device, SPI_IOC_MESSAGE(1), &k);
+    a = lgw_com_xfer(spi_target, LGW_SPI_OP_WRITE, out_buf, NULL, command_size);
 
     /* determine return code */
-    if (a != (int)k.len) {
+    if (a != LGW_COM_SUCCESS) {
         DEBUG_MSG("ERROR: SPI WRITE FAILURE\n");
         return LGW_SPI_ERROR;
     } else {
@@ -196,50 +191,121 @@ int sx125x_reg_w(void *spi_target, uint8_t spi_mux_target, uint8_t address, uint
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_sx125x_reg_w(radio_reg_t idx, uint8_t data, uint8_t rf_chain) {
+static bool reg_shadowed(uint8_t address) {
+    return (address != REG_ADDR_MODE) && (address != REG_ADDR_VERSION) && (address != REG_ADDR_MODE_STATUS);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int reg_get(uint8_t rf_chain, uint8_t address, uint8_t *data) {
+    int spi_stat;
 
+    if ((reg_shadowed(address) == true) && (reg_shadow_ok[lgw_board][rf_chain][address] == true)) {
+        *data = reg_shadow[lgw_board][rf_chain][address];
+        return LGW_SPI_SUCCESS;
+    }
+
+    spi_stat = sx125x_reg_r(lgw_spi_target[lgw_board], ((rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB), address, data);
+    if (spi_stat == LGW_SPI_SUCCESS) {
+        reg_shadow[lgw_board][rf_chain][address] = *data;
+        reg_shadow_ok[lgw_board][rf_chain][address] = true;
+    }
+    return spi_stat;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int reg_set(uint8_t rf_chain, uint8_t address, uint8_t data) {
+    uint8_t spi_mux_target = (rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB;
+    uint8_t val_check = 0;
     int spi_stat;
+
+    if ((reg_shadowed(address) == true) && (reg_shadow_ok[lgw_board][rf_chain][address] == true) && (reg_shadow[lgw_board][rf_chain][address] == data)) {
+        return LGW_SPI_SUCCESS; /* already in the radio */
+    }
+
+    /* Check that we can read what we have written */
+    reg_shadow_ok[lgw_board][rf_chain][address] = false;
+    spi_stat = sx125x_reg_w(lgw_spi_target[lgw_board], spi_mux_target, address, data);
+    spi_stat |= sx125x_reg_r(lgw_spi_target[lgw_board], spi_mux_target, address, &val_check);
+    if ((spi_stat != LGW_SPI_SUCCESS) || (val_check != data)) {
+        printf("ERROR: sx125x register 0x%02X write failed (w:%u r:%u)!!\n", address, data, val_check);
+        return LGW_SPI_ERROR;
+    }
+
+    reg_shadow[lgw_board][rf_chain][address] = data;
+    reg_shadow_ok[lgw_board][rf_chain][address] = true;
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_sx125x_reg_w(radio_reg_t idx, uint8_t data, uint8_t rf_chain) {
+    struct lgw_sx125x_reg_val_s reg;
+
+    reg.idx = idx;
+    reg.data = data;
+    return lgw_sx125x_reg_w_seq(&reg, 1, rf_chain);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_sx125x_reg_w_seq(const struct lgw_sx125x_reg_val_s *regs, unsigned nb_regs, uint8_t rf_chain) {
     struct radio_reg_s reg;
     uint8_t mask;
-    uint8_t r;
+    uint8_t set_mask;
     uint8_t w;
-    uint8_t val_check;
+    uint8_t r;
+    unsigned i, j;
 
     /* checking input parameters */
+    CHECK_NULL(regs);
     if (rf_chain >= LGW_RF_CHAIN_NB) {
         DEBUG_MSG("ERROR: INVALID RF_CHAIN\n");
         return LGW_REG_ERROR;
     }
-    if (idx >= RADIO_TOTALREGS) {
-        DEBUG_MSG("ERROR: REGISTER NUMBER OUT OF DEFINED RANGE\n");
-        return LGW_REG_ERROR;
+    for (i = 0; i < nb_regs; i++) {
+        if (regs[i].idx >= RADIO_TOTALREGS) {
+            DEBUG_MSG("ERROR: REGISTER NUMBER OUT OF DEFINED RANGE\n");
+            return LGW_REG_ERROR;
+        }
     }
 
-    reg = sx125x_regs[idx];
+    for (i = 0; i < nb_regs; i = j) {
+        /* merge the fields of the same address */
+        w = 0;
+        set_mask = 0;
+        for (j = i; (j < nb_regs) && (sx125x_regs[regs[j].idx].addr == sx125x_regs[regs[i].idx].addr); j++) {
+            reg = sx125x_regs[regs[j].idx];
+            mask = ((1 << reg.leng) - 1) << reg.offs;
+            w = (w & ~mask) | ((regs[j].data << reg.offs) & mask);
+            set_mask |= mask;
+        }
+        reg = sx125x_regs[regs[i].idx];
 
-    if ((reg.leng == 8) && (reg.offs == 0)){
-        /* direct write */
-        spi_stat = sx125x_reg_w(lgw_spi_target, ((rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB), reg.addr, data);
-    } else {
-        /* read-modify-write */
-        spi_stat = sx125x_reg_r(lgw_spi_target, ((rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB), reg.addr, &r);
-        mask = ((1 << reg.leng) - 1) << reg.offs;
-        w = (r & ~mask) | ((data << reg.offs) & mask);
-        spi_stat |= sx125x_reg_w(lgw_spi_target, ((rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB), reg.addr, w);
-    }
+        /* read-modify-write, unless the whole register is set */
+        if (set_mask != 0xFF) {
+            if (reg_get(rf_chain, reg.addr, &r) != LGW_SPI_SUCCESS) {
+                DEBUG_MSG("ERROR: SPI ERROR DURING RADIO REGISTER WRITE\n");
+                return LGW_REG_ERROR;
+            }
+            w = (r & ~set_mask) | w;
+        }
 
-    /* Check that we can read what we have written */
-    lgw_sx125x_reg_r(idx, &val_check, rf_chain);
-    if (val_check != data) {
-        printf("ERROR: sx125x register %d write failed (w:%u r:%u)!!\n", idx, data, val_check);
-        spi_stat = LGW_SPI_ERROR;
+        if (reg_set(rf_chain, reg.addr, w) != LGW_SPI_SUCCESS) {
+            DEBUG_MSG("ERROR: SPI ERROR DURING RADIO REGISTER WRITE\n");
+            return LGW_REG_ERROR;
+        }
     }
 
-    if (spi_stat != LGW_SPI_SUCCESS) {
-        DEBUG_MSG("ERROR: SPI ERROR DURING RADIO REGISTER WRITE\n");
-        return LGW_REG_ERROR;
-    } else {
-        return LGW_REG_SUCCESS;
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_sx125x_shadow_reset(uint8_t rf_chain) {
+    if (rf_chain < LGW_RF_CHAIN_NB) {
+        memset(reg_shadow_ok[lgw_board][rf_chain], 0, sizeof reg_shadow_ok[lgw_board][rf_chain]);
     }
 }
 
@@ -264,16 +330,19 @@ int lgw_sx125x_reg_r(radio_reg_t idx, uint8_t *data, uint8_t rf_chain) {
 
     reg = sx125x_regs[idx];
 
-    spi_stat = sx125x_reg_r(lgw_spi_target, ((rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB), reg.addr, &r);
-    mask = ((1 << reg.leng) - 1) << reg.offs;
-    *data = (r & mask) >> reg.offs;
-
+    /* explicit reads always access the radio */
+    spi_stat = sx125x_reg_r(lgw_spi_target[lgw_board], ((rf_chain == 0) ? LGW_SPI_MUX_TARGET_RADIOA : LGW_SPI_MUX_TARGET_RADIOB), reg.addr, &r);
     if (spi_stat != LGW_SPI_SUCCESS) {
         DEBUG_MSG("ERROR: SPI ERROR DURING RADIO REGISTER READ\n");
         return LGW_REG_ERROR;
-    } else {
-        return LGW_REG_SUCCESS;
     }
+
+    mask = ((1 << reg.leng) - 1) << reg.offs;
+    *data = (r & mask) >> reg.offs;
+    reg_shadow[lgw_board][rf_chain][reg.addr] = r;
+    reg_shadow_ok[lgw_board][rf_chain][reg.addr] = true;
+
+    return LGW_REG_SUCCESS;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -288,6 +357,25 @@ int sx125x_setup(uint8_t rf_chain, uint8_t rf_clkout, bool rf_enable, uint8_t rf
     int cpt_attempts = 0;
     uint8_t val;
 
+    /* gains and trims, applied in one sequence */
+    static const struct lgw_sx125x_reg_val_s setup_regs[] = {
+        /* Tx gain and trim */
+        {SX125x_REG_TX_GAIN__MIX_GAIN, SX125x_TX_MIX_GAIN},
+        {SX125x_REG_TX_GAIN__DAC_GAIN, SX125x_TX_DAC_GAIN},
+        {SX125x_REG_TX_BW__ANA_BW, SX125x_TX_ANA_BW},
+        {SX125x_REG_TX_BW__PLL_BW, SX125x_TX_PLL_BW},
+        {SX125x_REG_TX_DAC_BW, SX125x_TX_DAC_BW},
+        /* Rx gain and trim */
+        {SX125x_REG_RX_ANA_GAIN__LNA_ZIN, SX125x_LNA_ZIN},
+        {SX125x_REG_RX_ANA_GAIN__BB_GAIN, SX125x_RX_BB_GAIN},
+        {SX125x_REG_RX_ANA_GAIN__LNA_GAIN, SX125x_RX_LNA_GAIN},
+        {SX125x_REG_RX_BW__BB_BW, SX125x_RX_BB_BW},
+        {SX125x_REG_RX_BW__ADC_TRIM, SX125x_RX_ADC_TRIM},
+        {SX125x_REG_RX_BW__ADC_BW, SX125x_RX_ADC_BW},
+        {SX125x_REG_RX_PLL_BW__ADC_TEMP_EN, SX125x_ADC_TEMP},
+        {SX125x_REG_RX_PLL_BW__PLL_BW, SX125x_RX_PLL_BW}
+    };
+
     if (rf_chain >= LGW_RF_CHAIN_NB) {
         DEBUG_MSG("ERROR: INVALID RF_CHAIN\n");
         return -1;
@@ -321,26 +409,7 @@ int sx125x_setup(uint8_t rf_chain, uint8_t rf_clkout, bool rf_enable, uint8_t rf
     }
 
     if (rf_enable == true) {
-        /* Tx gain and trim */
-        lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__MIX_GAIN, SX125x_TX_MIX_GAIN, rf_chain);
-        lgw_sx125x_reg_w(SX125x_REG_TX_GAIN__DAC_GAIN, SX125x_TX_DAC_GAIN, rf_chain);
-
-        lgw_sx125x_reg_w(SX125x_REG_TX_BW__ANA_BW, SX125x_TX_ANA_BW, rf_chain);
-        lgw_sx125x_reg_w(SX125x_REG_TX_BW__PLL_BW, SX125x_TX_PLL_BW, rf_chain);
-
-        lgw_sx125x_reg_w(SX125x_REG_TX_DAC_BW, SX125x_TX_DAC_BW, rf_chain);
-
-        /* Rx gain and trim */
-        lgw_sx125x_reg_w(SX125x_REG_RX_ANA_GAIN__LNA_ZIN, SX125x_LNA_ZIN, rf_chain);
-        lgw_sx125x_reg_w(SX125x_REG_RX_ANA_GAIN__BB_GAIN, SX125x_RX_BB_GAIN, rf_chain);
-        lgw_sx125x_reg_w(SX125x_REG_RX_ANA_GAIN__LNA_GAIN, SX125x_RX_LNA_GAIN, rf_chain);
-
-        lgw_sx125x_reg_w(SX125x_REG_RX_BW__BB_BW, SX125x_RX_BB_BW, rf_chain);
-        lgw_sx125x_reg_w(SX125x_REG_RX_BW__ADC_TRIM, SX125x_RX_ADC_TRIM, rf_chain);
-        lgw_sx125x_reg_w(SX125x_REG_RX_BW__ADC_BW, SX125x_RX_ADC_BW, rf_chain);
-
-        lgw_sx125x_reg_w(SX125x_REG_RX_PLL_BW__ADC_TEMP_EN, SX125x_ADC_TEMP, rf_chain);
-        lgw_sx125x_reg_w(SX125x_REG_RX_PLL_BW__PLL_BW, SX125x_RX_PLL_BW, rf_chain);
+        lgw_sx125x_reg_w_seq(setup_regs, ARRAY_SIZE(setup_regs), rf_chain);
 
         /* set RX PLL frequency */
         switch (rf_radio_type) {
@@ -381,4 +450,28 @@ int sx125x_setup(uint8_t rf_chain, uint8_t rf_clkout, bool rf_enable, uint8_t rf
     return 0;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx125x_wait_ready(uint8_t rf_chain, uint32_t timeout_ms) {
+    uint32_t elapsed_ms;
+    uint8_t val = 0;
+
+    if (rf_chain >= LGW_RF_CHAIN_NB) {
+        DEBUG_MSG("ERROR: INVALID RF_CHAIN\n");
+        return -1;
+    }
+
+    /* The version register reads as 0x00 or 0xFF until the radio answers on SPI */
+    wait_ms(POR_DELAY_MS);
+    for (elapsed_ms = POR_DELAY_MS; elapsed_ms <= timeout_ms; elapsed_ms++) {
+        if ((lgw_sx125x_reg_r(SX125x_REG_VERSION, &val, rf_chain) == LGW_REG_SUCCESS) && (val != 0x00) && (val != 0xFF)) {
+            DEBUG_PRINTF("Note: SX125x #%d ready after %u ms (version 0x%02x)\n", rf_chain, elapsed_ms, val);
+            return 0;
+        }
+        wait_ms(1);
+    }
+
+    return -1;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -16,6 +16,13 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
 #include <stdint.h>     /* C99 types */
 #include <stdio.h>      /* printf fprintf */
 #include <stdlib.h>     /* malloc free */
@@ -24,18 +31,21 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <string.h>     /* memset */
 #include <math.h>       /* pow, cell */
 #include <inttypes.h>
-#include <time.h>
+#include <time.h>       /* clock_gettime */
 
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
 
 #include "loragw_reg.h"
+#include "loragw_spi.h"
+#include "loragw_com.h"
 #include "loragw_aux.h"
 #include "loragw_hal.h"
 #include "loragw_sx1302.h"
 #include "loragw_sx1302_timestamp.h"
 #include "loragw_sx1302_rx.h"
 #include "loragw_sx1250.h"
+#include "loragw_sx125x.h"
 #include "loragw_agc_params.h"
 #include "loragw_cal.h"
 #include "loragw_debug.h"
@@ -75,6 +85,13 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #define MCU_FW_SIZE             8192 /* size of the firmware IN BYTES (= twice the number of 14b words) */
 
+#define TIMESTAMP_REFRESH_MS    1000 /* counter read at most once per interval, extrapolated in between */
+#define ARB_STATS_REFRESH_MS    500  /* ARB debug counters read at most once per interval, they are 8-bit wide */
+
+#define RADIO_RESET_PULSE_MS        500 /* reset pulse applied to radios */
+#define RADIO_RESET_PULSE_FAST_MS   1   /* reset pulse applied to radios in fast start mode (datasheets: 100us min) */
+#define RADIO_READY_TIMEOUT_MS      10  /* worst case delay for a radio to be ready after reset */
+
 #define FW_VERSION_CAL          1 /* Expected version of calibration firmware */
 
 #define RSSI_FSK_POLY_0         86 /* polynomiam coefficients to linearize FSK RSSI */
@@ -106,17 +123,67 @@ const uint8_t ifmod_config[LGW_IF_CHAIN_NB] = LGW_IFMODEM_CONFIG;
 #define MIN_FSK_PREAMBLE    3
 #define STD_FSK_PREAMBLE    5
 
+/* LoRa payload CRC16 lookup table (CCITT polynomial 0x1021, MSB first).
+   One step of the bitwise LoRa payload CRC is:
+   crc' = (crc << 8) ^ data ^ lora_crc16_table[crc >> 8] */
+static const uint16_t lora_crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
 /* Radio calibration firmware */
 #include "cal_fw.var" /* text_cal_sx1257_16_Nov_1 */
 
-/* Buffer to hold RX data */
-rx_buffer_t rx_buffer;
+/* Buffer to hold RX data of each board */
+static rx_buffer_t rx_buffer[LGW_BOARD_NB] = { [0 ... LGW_BOARD_NB-1] = { .buffer_capacity = RX_BUFFER_SIZE } };
+
+/* RX buffer fill level and near-full counters, see sx1302_get_rx_stats() */
+static struct lgw_rx_stats_s rx_stats[LGW_BOARD_NB];
+
+/* Detections and demodulator allocations of the multi-SF channels, see sx1302_arb_get_stats() */
+static struct lgw_arb_stats_s arb_stats[LGW_BOARD_NB];
+static uint8_t          arb_sts[LGW_BOARD_NB][2 * LGW_MULTI_NB]; /* last values read from the ARB debug counters */
+static bool             arb_sts_valid[LGW_BOARD_NB];
+static struct timespec  arb_sts_time[LGW_BOARD_NB];
 
-/* Internal timestamp counter */
-timestamp_counter_t counter_us;
+/* Internal timestamp counter of each board */
+static timestamp_counter_t counter_us[LGW_BOARD_NB];
+
+/* Poll the radios after reset instead of waiting for the worst case delays */
+static bool radio_fast_start[LGW_BOARD_NB];
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
@@ -136,11 +203,16 @@ extern int32_t lgw_sf_getval(int x);
 extern int32_t lgw_bw_getval(int x);
 
 /**
-@brief TODO
-@param TODO
-@return TODO
+@brief Time on air of a LoRa packet, see lgw_time_on_air()
+@return duration in microseconds, 0 if the modulation parameters are not supported
 */
-void lora_crc16(const char data, int *crc);
+extern uint32_t lgw_lora_toa_us(uint8_t bandwidth, uint32_t datarate, uint8_t coderate, uint16_t preamble, bool no_header, bool crc_en, uint16_t size);
+
+/**
+@brief Time on air of a FSK packet, see lgw_time_on_air()
+@return duration in microseconds, 0 if the datarate is null
+*/
+extern uint32_t lgw_fsk_toa_us(uint32_t datarate, uint16_t preamble, uint8_t sync_word_size, bool crc_en, uint16_t size);
 
 /* -------------------------------------------------------------------------- */
 /* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
@@ -148,6 +220,12 @@ void lora_crc16(const char data, int *crc);
 /* Log file */
 extern FILE * log_file;
 
+/* Concentrator board accessed by the calling thread, see lgw_board_select() */
+extern __thread lgw_handle_t lgw_board;
+
+/* SPI transfer counter, see sx1302_radio_calibrate() */
+extern uint32_t lgw_com_nb_transfers[LGW_BOARD_NB];
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
@@ -178,41 +256,318 @@ int calculate_freq_to_time_drift(uint32_t freq_hz, uint8_t bw, uint16_t * mant,
     return LGW_REG_SUCCESS;
 }
 
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Queue the TX configuration and payload of a packet, in a register batch started by the caller */
+static int tx_program(lgw_radio_type_t radio_type, struct lgw_tx_gain_lut_s * tx_lut, bool lwan_public, struct lgw_conf_rxif_s * context_fsk, struct lgw_pkt_tx_s * pkt_data, uint16_t * tx_start_delay) {
+    uint32_t freq_reg, fdev_reg;
+    uint32_t freq_dev;
+    uint32_t fsk_br_reg;
+    uint64_t fsk_sync_word_reg;
+    uint16_t mem_addr;
+    uint8_t power;
+    uint8_t pow_index;
+    uint8_t mod_bw;
+    uint8_t pa_en;
+
+    /* Select the proper modem */
+    switch (pkt_data->modulation) {
+        case MOD_CW:
+            lgw_reg_wf(SX1302_REGF_TX_TOP_GEN_CFG_0_MODULATION_TYPE(pkt_data->rf_chain), 0x00);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_CTRL_TX_IF_SRC(pkt_data->rf_chain), 0x00);
+            break;
+        case MOD_LORA:
+            lgw_reg_wf(SX1302_REGF_TX_TOP_GEN_CFG_0_MODULATION_TYPE(pkt_data->rf_chain), 0x00);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_CTRL_TX_IF_SRC(pkt_data->rf_chain), 0x01);
+            break;
+        case MOD_FSK:
+            lgw_reg_wf(SX1302_REGF_TX_TOP_GEN_CFG_0_MODULATION_TYPE(pkt_data->rf_chain), 0x01);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_CTRL_TX_IF_SRC(pkt_data->rf_chain), 0x02);
+            break;
+        default:
+            DEBUG_MSG("ERROR: modulation type not supported\n");
+            return LGW_REG_ERROR;
+    }
+
+    /* Find the proper index in the TX gain LUT according to requested rf_power */
+    for (pow_index = tx_lut->size-1; pow_index > 0; pow_index--) {
+        if (tx_lut->lut[pow_index].rf_power <= pkt_data->rf_power) {
+            break;
+        }
+    }
+    DEBUG_PRINTF("INFO: selecting TX Gain LUT index %u\n", pow_index);
+
+    /* loading calibrated Tx DC offsets */
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_I_OFFSET_I_OFFSET(pkt_data->rf_chain), tx_lut->lut[pow_index].offset_i);
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_Q_OFFSET_Q_OFFSET(pkt_data->rf_chain), tx_lut->lut[pow_index].offset_q);
+
+    DEBUG_PRINTF("INFO: Applying IQ offset (i:%d, q:%d)\n", tx_lut->lut[pow_index].offset_i, tx_lut->lut[pow_index].offset_q);
+
+    /* Set the power parameters to be used for TX */
+    switch (radio_type) {
+        case LGW_RADIO_TYPE_SX1250:
+            pa_en = (tx_lut->lut[pow_index].pa_gain > 0) ? 1 : 0; /* only 1 bit used to control the external PA */
+            power = (pa_en << 6) | tx_lut->lut[pow_index].pwr_idx;
+            break;
+        case LGW_RADIO_TYPE_SX1257:
+            power = (tx_lut->lut[pow_index].pa_gain << 6) | (tx_lut->lut[pow_index].dac_gain << 4) | tx_lut->lut[pow_index].mix_gain;
+            break;
+        default:
+            DEBUG_MSG("ERROR: radio type not supported\n");
+            return LGW_HAL_ERROR;
+    }
+    lgw_reg_wf(SX1302_REGF_TX_TOP_AGC_TX_PWR_AGC_TX_PWR(pkt_data->rf_chain), power);
+
+    /* Set digital gain */
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_IQ_GAIN_IQ_GAIN(pkt_data->rf_chain), tx_lut->lut[pow_index].dig_gain);
+
+    /* Set Tx frequency */
+    freq_reg = SX1302_FREQ_TO_REG(pkt_data->freq_hz); /* TODO: AGC fw to be updated for sx1255 */
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_RF_H_FREQ_RF(pkt_data->rf_chain), (freq_reg >> 16) & 0xFF);
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_RF_M_FREQ_RF(pkt_data->rf_chain), (freq_reg >> 8) & 0xFF);
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_RF_L_FREQ_RF(pkt_data->rf_chain), (freq_reg >> 0) & 0xFF);
+
+    /* Set AGC bandwidth and modulation type*/
+    switch (pkt_data->modulation) {
+        case MOD_LORA:
+            mod_bw = pkt_data->bandwidth;
+            break;
+        case MOD_CW:
+        case MOD_FSK:
+            mod_bw = (0x01 << 7) | pkt_data->bandwidth;
+            break;
+        default:
+            printf("ERROR: Modulation not supported\n");
+            return LGW_REG_ERROR;
+    }
+    lgw_reg_wf(SX1302_REGF_TX_TOP_AGC_TX_BW_AGC_TX_BW(pkt_data->rf_chain), mod_bw);
+
+    /* Configure modem */
+    switch (pkt_data->modulation) {
+        case MOD_CW:
+            /* Set frequency deviation */
+            freq_dev = ceil(fabs((float)pkt_data->freq_offset/10))*10e3;
+            printf("CW: f_dev %d Hz\n", (int)(freq_dev));
+            fdev_reg = SX1302_FREQ_TO_REG(freq_dev);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  8) & 0xFF);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  0) & 0xFF);
+
+            /* Send frequency deviation to AGC fw for radio config */
+            fdev_reg = SX1250_FREQ_TO_REG(freq_dev);
+            lgw_reg_wf(SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE2_MCU_MAIL_BOX_WR_DATA, (fdev_reg >> 16) & 0xFF); /* Needed by AGC to configure the sx1250 */
+            lgw_reg_wf(SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE1_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  8) & 0xFF); /* Needed by AGC to configure the sx1250 */
+            lgw_reg_wf(SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE0_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  0) & 0xFF); /* Needed by AGC to configure the sx1250 */
+
+            /* Set the frequency offset (ratio of the frequency deviation)*/
+            printf("CW: IF test mod freq %d\n", (int)(((float)pkt_data->freq_offset*1e3*64/(float)freq_dev)));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_TEST_MOD_FREQ(pkt_data->rf_chain), (int)(((float)pkt_data->freq_offset*1e3*64/(float)freq_dev)));
+            break;
+        case MOD_LORA:
+            /* Set bandwidth */
+            freq_dev = lgw_bw_getval(pkt_data->bandwidth) / 2;
+            fdev_reg = SX1302_FREQ_TO_REG(freq_dev);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  8) & 0xFF);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  0) & 0xFF);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_0_MODEM_BW(pkt_data->rf_chain), pkt_data->bandwidth);
+
+            /* Preamble length */
+            if (pkt_data->preamble == 0) { /* if not explicit, use recommended LoRa preamble size */
+                pkt_data->preamble = STD_LORA_PREAMBLE;
+            } else if (pkt_data->preamble < MIN_LORA_PREAMBLE) { /* enforce minimum preamble size */
+                pkt_data->preamble = MIN_LORA_PREAMBLE;
+                DEBUG_MSG("Note: preamble length adjusted to respect minimum LoRa preamble size\n");
+            }
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG1_3_PREAMBLE_SYMB_NB(pkt_data->rf_chain), (pkt_data->preamble >> 8) & 0xFF); /* MSB */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG1_2_PREAMBLE_SYMB_NB(pkt_data->rf_chain), (pkt_data->preamble >> 0) & 0xFF); /* LSB */
+
+            /* LoRa datarate */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_0_MODEM_SF(pkt_data->rf_chain), pkt_data->datarate);
+            if (pkt_data->datarate < 10) {
+                lgw_reg_wf(SX1302_REGF_TX_TOP_TX_CFG0_0_CHIRP_LOWPASS(pkt_data->rf_chain), 6); /* less filtering for low SF : TBC */
+            } else {
+                lgw_reg_wf(SX1302_REGF_TX_TOP_TX_CFG0_0_CHIRP_LOWPASS(pkt_data->rf_chain), 7);
+            }
+
+            /* Coding Rate */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_1_CODING_RATE(pkt_data->rf_chain), pkt_data->coderate);
+
+            /* Start LoRa modem */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_2_MODEM_EN(pkt_data->rf_chain), 1);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_2_CADRXTX(pkt_data->rf_chain), 2);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG1_1_MODEM_START(pkt_data->rf_chain), 1);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_CFG0_0_CONTINUOUS(pkt_data->rf_chain), 0);
+
+            /* Modulation options */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_CFG0_0_CHIRP_INVERT(pkt_data->rf_chain), (pkt_data->invert_pol) ? 1 : 0);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_2_IMPLICIT_HEADER(pkt_data->rf_chain), (pkt_data->no_header) ? 1 : 0);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_2_CRC_EN(pkt_data->rf_chain), (pkt_data->no_crc) ? 0 : 1);
+
+            /* Syncword */
+            if ((lwan_public == false) || (pkt_data->datarate == DR_LORA_SF5) || (pkt_data->datarate == DR_LORA_SF6)) {
+                DEBUG_MSG("Setting LoRa syncword 0x12\n");
+                lgw_reg_wf(SX1302_REGF_TX_TOP_FRAME_SYNCH_0_PEAK1_POS(pkt_data->rf_chain), 2);
+                lgw_reg_wf(SX1302_REGF_TX_TOP_FRAME_SYNCH_1_PEAK2_POS(pkt_data->rf_chain), 4);
+            } else {
+                DEBUG_MSG("Setting LoRa syncword 0x34\n");
+                lgw_reg_wf(SX1302_REGF_TX_TOP_FRAME_SYNCH_0_PEAK1_POS(pkt_data->rf_chain), 6);
+                lgw_reg_wf(SX1302_REGF_TX_TOP_FRAME_SYNCH_1_PEAK2_POS(pkt_data->rf_chain), 8);
+            }
+
+            /* Set Fine Sync for SF5/SF6 */
+            if ((pkt_data->datarate == DR_LORA_SF5) || (pkt_data->datarate == DR_LORA_SF6)) {
+                DEBUG_MSG("Enable Fine Sync\n");
+                lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_2_FINE_SYNCH_EN(pkt_data->rf_chain), 1);
+            } else {
+                DEBUG_MSG("Disable Fine Sync\n");
+                lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_2_FINE_SYNCH_EN(pkt_data->rf_chain), 0);
+            }
+
+            /* Set Payload length */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_3_PAYLOAD_LENGTH(pkt_data->rf_chain), pkt_data->size);
+
+            /* Set PPM offset (low datarate optimization) */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_1_PPM_OFFSET_HDR_CTRL(pkt_data->rf_chain), 0);
+            if (SET_PPM_ON(pkt_data->bandwidth, pkt_data->datarate)) {
+                DEBUG_MSG("Low datarate optimization ENABLED\n");
+                lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_1_PPM_OFFSET(pkt_data->rf_chain), 1);
+            } else {
+                DEBUG_MSG("Low datarate optimization DISABLED\n");
+                lgw_reg_wf(SX1302_REGF_TX_TOP_TXRX_CFG0_1_PPM_OFFSET(pkt_data->rf_chain), 0);
+            }
+            break;
+        case MOD_FSK:
+            CHECK_NULL(context_fsk);
+
+            /* Set frequency deviation */
+            freq_dev = pkt_data->f_dev * 1e3;
+            fdev_reg = SX1302_FREQ_TO_REG(freq_dev);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  8) & 0xFF);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  0) & 0xFF);
+
+            /* Send frequency deviation to AGC fw for radio config */
+            fdev_reg = SX1250_FREQ_TO_REG(freq_dev);
+            lgw_reg_wf(SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE2_MCU_MAIL_BOX_WR_DATA, (fdev_reg >> 16) & 0xFF); /* Needed by AGC to configure the sx1250 */
+            lgw_reg_wf(SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE1_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  8) & 0xFF); /* Needed by AGC to configure the sx1250 */
+            lgw_reg_wf(SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE0_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  0) & 0xFF); /* Needed by AGC to configure the sx1250 */
+
+            /* Modulation parameters */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_CFG_0_PKT_MODE(pkt_data->rf_chain), 1); /* Variable length */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_CFG_0_CRC_EN(pkt_data->rf_chain), (pkt_data->no_crc) ? 0 : 1);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_CFG_0_CRC_IBM(pkt_data->rf_chain), 0); /* CCITT CRC */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_CFG_0_DCFREE_ENC(pkt_data->rf_chain), 2); /* Whitening Encoding */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_MOD_FSK_GAUSSIAN_EN(pkt_data->rf_chain), 1);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_MOD_FSK_GAUSSIAN_SELECT_BT(pkt_data->rf_chain), 2);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_MOD_FSK_REF_PATTERN_EN(pkt_data->rf_chain), 1);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_MOD_FSK_REF_PATTERN_SIZE(pkt_data->rf_chain), context_fsk->sync_word_size - 1);
+
+            /* Syncword */
+            fsk_sync_word_reg = context_fsk->sync_word << (8 * (8 - context_fsk->sync_word_size));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE0_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 0));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE1_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 8));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE2_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 16));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE3_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 24));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE4_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 32));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE5_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 40));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE6_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 48));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_REF_PATTERN_BYTE7_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 56));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_MOD_FSK_PREAMBLE_SEQ(pkt_data->rf_chain), 0);
+
+            /* Set datarate */
+            fsk_br_reg = 32000000 / pkt_data->datarate;
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_BIT_RATE_MSB_BIT_RATE(pkt_data->rf_chain), fsk_br_reg >> 8);
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_BIT_RATE_LSB_BIT_RATE(pkt_data->rf_chain), fsk_br_reg >> 0);
+
+            /* Preamble length */
+            if (pkt_data->preamble == 0) { /* if not explicit, use LoRaWAN preamble size */
+                pkt_data->preamble = STD_FSK_PREAMBLE;
+            } else if (pkt_data->preamble < MIN_FSK_PREAMBLE) { /* enforce minimum preamble size */
+                pkt_data->preamble = MIN_FSK_PREAMBLE;
+                DEBUG_MSG("Note: preamble length adjusted to respect minimum FSK preamble size\n");
+            }
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_PREAMBLE_SIZE_MSB_PREAMBLE_SIZE(pkt_data->rf_chain), (pkt_data->preamble >> 8) & 0xFF); /* MSB */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_PREAMBLE_SIZE_LSB_PREAMBLE_SIZE(pkt_data->rf_chain), (pkt_data->preamble >> 0) & 0xFF); /* LSB */
+
+            /* Set Payload length */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_FSK_PKT_LEN_PKT_LENGTH(pkt_data->rf_chain), pkt_data->size);
+            break;
+        default:
+            printf("ERROR: Modulation not supported\n");
+            return LGW_REG_ERROR;
+    }
+
+    /* Set TX start delay */
+    sx1302_tx_set_start_delay(pkt_data->rf_chain, radio_type, pkt_data->modulation, pkt_data->bandwidth, tx_start_delay);
+
+    /* Write payload in transmit buffer */
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_CTRL_WRITE_BUFFER(pkt_data->rf_chain), 0x01);
+    mem_addr = REG_SELECT(pkt_data->rf_chain, 0x5300, 0x5500);
+    if (pkt_data->modulation == MOD_FSK) {
+        lgw_mem_wb(mem_addr, (uint8_t *)(&(pkt_data->size)), 1); /* insert payload size in the packet for FSK variable mode (1 byte) */
+        lgw_mem_wb(mem_addr+1, &(pkt_data->payload[0]), pkt_data->size);
+    } else {
+        lgw_mem_wb(mem_addr, &(pkt_data->payload[0]), pkt_data->size);
+    }
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_CTRL_WRITE_BUFFER(pkt_data->rf_chain), 0x00);
+
+    return LGW_REG_SUCCESS;
+}
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-void lora_crc16(const char data, int *crc) {
-    int next = 0;
-    next  =  (((data>>0)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1)                 )      ;
-    next += ((((data>>1)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1)                 )<<1 ) ;
-    next += ((((data>>2)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1)                 )<<2 ) ;
-    next += ((((data>>3)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<3 ) ;
-    next += ((((data>>4)&1) ^ ((*crc>>12)&1)                                  )<<4 ) ;
-    next += ((((data>>5)&1) ^ ((*crc>>13)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1))<<5 ) ;
-    next += ((((data>>6)&1) ^ ((*crc>>14)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1))<<6 ) ;
-    next += ((((data>>7)&1) ^ ((*crc>>15)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1))<<7 ) ;
-    next += ((((*crc>>0)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<8 ) ;
-    next += ((((*crc>>1)&1) ^ ((*crc>>12)&1)                                  )<<9 ) ;
-    next += ((((*crc>>2)&1) ^ ((*crc>>13)&1)                                  )<<10) ;
-    next += ((((*crc>>3)&1) ^ ((*crc>>14)&1)                                  )<<11) ;
-    next += ((((*crc>>4)&1) ^ ((*crc>>15)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1))<<12) ;
-    next += ((((*crc>>5)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1)                 )<<13) ;
-    next += ((((*crc>>6)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1)                 )<<14) ;
-    next += ((((*crc>>7)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<15) ;
-    (*crc) = next;
+/* Queue the trigger of a programmed packet, in a register batch started by the caller */
+static int tx_trigger(uint8_t rf_chain, uint8_t tx_mode, uint32_t trig_count_us, uint16_t tx_start_delay) {
+    uint32_t count_us;
+
+    switch (tx_mode) {
+        case IMMEDIATE:
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_IMMEDIATE(rf_chain), 0x00); /* reset state machine */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_IMMEDIATE(rf_chain), 0x01);
+            break;
+        case TIMESTAMPED:
+            count_us = trig_count_us * 32 - tx_start_delay;
+            DEBUG_PRINTF("--> programming trig delay at %u (%u)\n", trig_count_us - (tx_start_delay / 32), count_us);
+
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE0_TIMER_DELAYED_TRIG(rf_chain), (uint8_t)((count_us >>  0) & 0x000000FF));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE1_TIMER_DELAYED_TRIG(rf_chain), (uint8_t)((count_us >>  8) & 0x000000FF));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE2_TIMER_DELAYED_TRIG(rf_chain), (uint8_t)((count_us >> 16) & 0x000000FF));
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TIMER_TRIG_BYTE3_TIMER_DELAYED_TRIG(rf_chain), (uint8_t)((count_us >> 24) & 0x000000FF));
+
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_DELAYED(rf_chain), 0x00); /* reset state machine */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_DELAYED(rf_chain), 0x01);
+            break;
+        case ON_GPS:
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_GPS(rf_chain), 0x00); /* reset state machine */
+            lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_GPS(rf_chain), 0x01);
+            break;
+        default:
+            printf("ERROR: TX mode not supported\n");
+            return LGW_REG_ERROR;
+    }
+
+    return LGW_REG_SUCCESS;
 }
 
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
 void sx1302_init(struct lgw_conf_timestamp_s *conf_ts) {
-    timestamp_counter_new(&counter_us);
+    timestamp_counter_new(&counter_us[lgw_board]);
 
     if (conf_ts != NULL) {
         timestamp_counter_mode(conf_ts->enable_precision_ts, conf_ts->max_ts_metrics, conf_ts->nb_symbols);
     }
 
     /* Initialize RX buffer */
-    rx_buffer_new(&rx_buffer);
+    rx_buffer_new(&rx_buffer[lgw_board]);
+    memset(&rx_stats[lgw_board], 0, sizeof rx_stats[lgw_board]);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1302_rx_buffer_setconf(uint16_t size) {
+    return rx_buffer_set_capacity(&rx_buffer[lgw_board], size);
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -244,20 +599,22 @@ int sx1302_update(void) {
     int32_t val;
 
     /* Check MCUs parity errors */
-    lgw_reg_r(SX1302_REG_AGC_MCU_CTRL_PARITY_ERROR, &val);
+    lgw_reg_rf(SX1302_REGF_AGC_MCU_CTRL_PARITY_ERROR, &val);
     if (val != 0) {
         printf("ERROR: Parity error check failed on AGC firmware\n");
         return LGW_REG_ERROR;
     }
-    lgw_reg_r(SX1302_REG_ARB_MCU_CTRL_PARITY_ERROR, &val);
+    lgw_reg_rf(SX1302_REGF_ARB_MCU_CTRL_PARITY_ERROR, &val);
     if (val != 0) {
         printf("ERROR: Parity error check failed on ARB firmware\n");
         return LGW_REG_ERROR;
     }
 
-    /* Update internal timestamp counter wrapping status */
-    timestamp_counter_get(&counter_us, false); /* maintain inst counter */
-    timestamp_counter_get(&counter_us, true); /* maintain pps counter */
+    /* Update internal timestamp counter wrapping status, shared with the TX path */
+    lgw_reg_lock();
+    timestamp_counter_refresh(&counter_us[lgw_board], false, TIMESTAMP_REFRESH_MS); /* maintain inst counter */
+    timestamp_counter_refresh(&counter_us[lgw_board], true, TIMESTAMP_REFRESH_MS); /* maintain pps counter */
+    lgw_reg_unlock();
 
     return LGW_REG_SUCCESS;
 }
@@ -299,6 +656,13 @@ int sx1302_radio_clock_select(uint8_t rf_chain) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+void sx1302_radio_fast_start(bool enable) {
+    radio_fast_start[lgw_board] = enable;
+    sx1250_set_fast_start(enable);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int sx1302_radio_reset(uint8_t rf_chain, lgw_radio_type_t type) {
     uint16_t reg_radio_en;
     uint16_t reg_radio_rst;
@@ -317,6 +681,9 @@ int sx1302_radio_reset(uint8_t rf_chain, lgw_radio_type_t type) {
     /* Switch to SPI clock before reseting the radio */
     lgw_reg_w(SX1302_REG_COMMON_CTRL0_CLK32_RIF_CTRL, 0x00);
 
+    /* registers back to their reset value */
+    lgw_sx125x_shadow_reset(rf_chain);
+
     /* Enable the radio */
     reg_radio_en = REG_SELECT(rf_chain, SX1302_REG_AGC_MCU_RF_EN_A_RADIO_EN, SX1302_REG_AGC_MCU_RF_EN_B_RADIO_EN);
     lgw_reg_w(reg_radio_en, 0x01);
@@ -324,18 +691,27 @@ int sx1302_radio_reset(uint8_t rf_chain, lgw_radio_type_t type) {
     /* Select the proper reset sequence depending on the radio type */
     reg_radio_rst = REG_SELECT(rf_chain, SX1302_REG_AGC_MCU_RF_EN_A_RADIO_RST, SX1302_REG_AGC_MCU_RF_EN_B_RADIO_RST);
     lgw_reg_w(reg_radio_rst, 0x01);
-    wait_ms(500);
+    wait_ms((radio_fast_start[lgw_board] == true) ? RADIO_RESET_PULSE_FAST_MS : RADIO_RESET_PULSE_MS);
     lgw_reg_w(reg_radio_rst, 0x00);
-    wait_ms(10);
     switch (type) {
         case LGW_RADIO_TYPE_SX1255:
         case LGW_RADIO_TYPE_SX1257:
-            /* Do nothing */
+            if (radio_fast_start[lgw_board] == false) {
+                wait_ms(RADIO_READY_TIMEOUT_MS);
+            } else if (sx125x_wait_ready(rf_chain, RADIO_READY_TIMEOUT_MS) != 0) {
+                printf("WARNING: sx125x (RADIO_%s) not answering after reset\n", REG_SELECT(rf_chain, "A", "B"));
+            }
             DEBUG_PRINTF("INFO: reset sx125x (RADIO_%s) done\n", REG_SELECT(rf_chain, "A", "B"));
             break;
         case LGW_RADIO_TYPE_SX1250:
+            wait_ms((radio_fast_start[lgw_board] == true) ? RADIO_RESET_PULSE_FAST_MS : RADIO_READY_TIMEOUT_MS);
             lgw_reg_w(reg_radio_rst, 0x01);
-            wait_ms(10); /* wait for auto calibration to complete */
+            /* wait for auto calibration to complete */
+            if (radio_fast_start[lgw_board] == false) {
+                wait_ms(RADIO_READY_TIMEOUT_MS);
+            } else if (sx1250_wait_mode(rf_chain, SX1250_MODE_STDBY_RC, RADIO_READY_TIMEOUT_MS) != 0) {
+                printf("WARNING: sx1250 (RADIO_%s) not in standby after reset\n", REG_SELECT(rf_chain, "A", "B"));
+            }
             DEBUG_PRINTF("INFO: reset sx1250 (RADIO_%s) done\n", REG_SELECT(rf_chain, "A", "B"));
             break;
         default:
@@ -387,8 +763,11 @@ int sx1302_radio_host_ctrl(bool host_ctrl) {
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int sx1302_radio_calibrate(struct lgw_conf_rxrf_s * context_rf_chain, uint8_t clksrc, struct lgw_tx_gain_lut_s * txgain_lut) {
+int sx1302_radio_calibrate(struct lgw_conf_rxrf_s * context_rf_chain, uint8_t clksrc, struct lgw_tx_gain_lut_s * txgain_lut, const char * cal_cache_path, float temperature, struct lgw_start_phase_s * cal_fw) {
     int i;
+    uint64_t eui;
+    struct timespec start, end;
+    uint32_t spi_start;
 
     /* -- Reset radios */
     for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
@@ -407,16 +786,34 @@ int sx1302_radio_calibrate(struct lgw_conf_rxrf_s * context_rf_chain, uint8_t cl
     /* -- Start calibration */
     if ((context_rf_chain[clksrc].type == LGW_RADIO_TYPE_SX1257) ||
         (context_rf_chain[clksrc].type == LGW_RADIO_TYPE_SX1255)) {
-        DEBUG_MSG("Loading CAL fw for sx125x\n");
-        if (sx1302_agc_load_firmware(cal_firmware_sx125x) != LGW_HAL_SUCCESS) {
-            printf("ERROR: Failed to load calibration fw\n");
-            return LGW_REG_ERROR;
+        /* The calibration cache is keyed by the concentrator EUI */
+        if ((cal_cache_path != NULL) && (sx1302_get_eui(&eui) != LGW_REG_SUCCESS)) {
+            cal_cache_path = NULL;
         }
-        if (sx1302_cal_start(FW_VERSION_CAL, context_rf_chain, txgain_lut) != LGW_HAL_SUCCESS) {
-            printf("ERROR: radio calibration failed\n");
-            sx1302_radio_reset(0, context_rf_chain[0].type);
-            sx1302_radio_reset(1, context_rf_chain[1].type);
-            return LGW_REG_ERROR;
+        if ((cal_cache_path != NULL) && (sx1302_cal_cache_load(cal_cache_path, eui, temperature, context_rf_chain, txgain_lut) == LGW_HAL_SUCCESS)) {
+            DEBUG_MSG("Skipping sx125x calibration, results restored from cache\n");
+        } else {
+            DEBUG_MSG("Loading CAL fw for sx125x\n");
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            spi_start = lgw_com_nb_transfers[lgw_board];
+            if (sx1302_agc_load_firmware(cal_firmware_sx125x) != LGW_HAL_SUCCESS) {
+                printf("ERROR: Failed to load calibration fw\n");
+                return LGW_REG_ERROR;
+            }
+            if (sx1302_cal_start(FW_VERSION_CAL, context_rf_chain, txgain_lut) != LGW_HAL_SUCCESS) {
+                printf("ERROR: radio calibration failed\n");
+                sx1302_radio_reset(0, context_rf_chain[0].type);
+                sx1302_radio_reset(1, context_rf_chain[1].type);
+                return LGW_REG_ERROR;
+            }
+            if (cal_fw != NULL) {
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                cal_fw->duration_us = (uint32_t)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+                cal_fw->spi_transfers = lgw_com_nb_transfers[lgw_board] - spi_start;
+            }
+            if (cal_cache_path != NULL) {
+                sx1302_cal_cache_save(cal_cache_path, eui, temperature, context_rf_chain, txgain_lut); /* not fatal, calibrated again on next start */
+            }
         }
     } else {
         DEBUG_MSG("Calibrating sx1250 radios\n");
@@ -486,6 +883,8 @@ int sx1302_channelizer_configure(struct lgw_conf_rxif_s * if_cfg, bool fix_gain)
         return LGW_REG_ERROR;
     }
 
+    lgw_reg_batch_start();
+
     /* Select which radio is connected to each multi-SF channel */
     for (i = 0; i < LGW_MULTI_NB; i++) {
         channels_mask |= (if_cfg[i].rf_chain << i);
@@ -564,7 +963,7 @@ int sx1302_channelizer_configure(struct lgw_conf_rxif_s * if_cfg, bool fix_gain)
         lgw_reg_w(SX1302_REG_RX_TOP_CHANN_DAGC_CFG3_CHAN_DAGC_MIN_ATTEN, 0 );
     }
 
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -575,6 +974,8 @@ int sx1302_fsk_configure(struct lgw_conf_rxif_s * cfg) {
 
     DEBUG_PRINTF("FSK: syncword:0x%" PRIx64 ", syncword_size:%u\n", cfg->sync_word, cfg->sync_word_size);
 
+    lgw_reg_batch_start();
+
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_FSK_CFG_1_PSIZE, cfg->sync_word_size - 1);
     fsk_sync_word_reg = cfg->sync_word << (8 * (8 - cfg->sync_word_size));
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_FSK_REF_PATTERN_BYTE0_FSK_REF_PATTERN, (uint8_t)(fsk_sync_word_reg >> 0));
@@ -607,12 +1008,14 @@ int sx1302_fsk_configure(struct lgw_conf_rxif_s * cfg) {
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_FSK_TIMEOUT_MSB_TIMEOUT, 0);
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_FSK_TIMEOUT_LSB_TIMEOUT, 128);
 
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int sx1302_lora_correlator_configure() {
+    lgw_reg_batch_start();
+
     lgw_reg_w(SX1302_REG_RX_TOP_SF5_CFG2_ACC_PNR, 52);
     lgw_reg_w(SX1302_REG_RX_TOP_SF5_CFG4_MSP_PNR, 24);
     lgw_reg_w(SX1302_REG_RX_TOP_SF5_CFG6_MSP_PEAK_NB, 7);
@@ -666,13 +1069,15 @@ int sx1302_lora_correlator_configure() {
     lgw_reg_w(SX1302_REG_RX_TOP_RX_BUFFER_STORE_HEADER_ERR_META, 0x01);
 #endif
 
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int sx1302_lora_service_correlator_configure(struct lgw_conf_rxif_s * cfg) {
 
+    lgw_reg_batch_start();
+
     /* Common config for all SF */
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_DETECT_MSP2_MSP_PEAK_NB, 7);
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_DETECT_MSP2_MSP2_PEAK_NB, 5);
@@ -713,10 +1118,11 @@ int sx1302_lora_service_correlator_configure(struct lgw_conf_rxif_s * cfg) {
             break;
         default:
             printf("ERROR: Failed to configure LoRa service modem correlators\n");
+            lgw_reg_batch_end();
             return LGW_REG_ERROR;
     }
 
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -727,6 +1133,8 @@ int sx1302_lora_modem_configure(uint32_t radio_freq_hz) {
 
     /* TODO: test if channel is enabled */
 
+    lgw_reg_batch_start();
+
     lgw_reg_w(SX1302_REG_RX_TOP_DC_NOTCH_CFG1_ENABLE, 0x00);
     lgw_reg_w(SX1302_REG_RX_TOP_RX_DFE_AGC1_FORCE_DEFAULT_FIR, 0x01);
     lgw_reg_w(SX1302_REG_RX_TOP_DAGC_CFG_GAIN_DROP_COMP, 0x01);
@@ -777,6 +1185,7 @@ int sx1302_lora_modem_configure(uint32_t radio_freq_hz) {
     /* Freq2TimeDrift computation */
     if (calculate_freq_to_time_drift(radio_freq_hz, BW_125KHZ, &mantissa, &exponent) != 0) {
         printf("ERROR: failed to calculate frequency to time drift for LoRa modem\n");
+        lgw_reg_batch_end();
         return LGW_REG_ERROR;
     }
     DEBUG_PRINTF("Freq2TimeDrift MultiSF: Mantissa = %d (0x%02X, 0x%02X), Exponent = %d (0x%02X)\n", mantissa, (mantissa >> 8) & 0x00FF, (mantissa) & 0x00FF, exponent, exponent);
@@ -787,8 +1196,7 @@ int sx1302_lora_modem_configure(uint32_t radio_freq_hz) {
     /* Time drift compensation */
     lgw_reg_w(SX1302_REG_RX_TOP_FREQ_TO_TIME3_FREQ_TO_TIME_INVERT_TIME_SYMB, 1);
 
-
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -797,6 +1205,8 @@ int sx1302_lora_service_modem_configure(struct lgw_conf_rxif_s * cfg, uint32_t r
     uint16_t mantissa = 0;
     uint8_t exponent = 0;
 
+    lgw_reg_batch_start();
+
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_DC_NOTCH_CFG1_ENABLE, 0x00);
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_RX_DFE_AGC1_FORCE_DEFAULT_FIR, 0x01);
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_DAGC_CFG_GAIN_DROP_COMP, 0x01);
@@ -856,6 +1266,7 @@ int sx1302_lora_service_modem_configure(struct lgw_conf_rxif_s * cfg, uint32_t r
     /* Freq2TimeDrift computation */
     if (calculate_freq_to_time_drift(radio_freq_hz, cfg->bandwidth, &mantissa, &exponent) != 0) {
         printf("ERROR: failed to calculate frequency to time drift for LoRa service modem\n");
+        lgw_reg_batch_end();
         return LGW_REG_ERROR;
     }
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_FREQ_TO_TIME0_FREQ_TO_TIME_DRIFT_MANT, (mantissa >> 8) & 0x00FF);
@@ -873,7 +1284,7 @@ int sx1302_lora_service_modem_configure(struct lgw_conf_rxif_s * cfg, uint32_t r
 
     lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_TXRX_CFG2_MODEM_START, 1);
 
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -897,6 +1308,8 @@ int sx1302_modem_enable(void) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int sx1302_lora_syncword(bool public, uint8_t lora_service_sf) {
+    lgw_reg_batch_start();
+
     /* Multi-SF modem configuration */
     DEBUG_MSG("INFO: configuring LoRa (Multi-SF) SF5->SF6 with syncword PRIVATE (0x12)\n");
     lgw_reg_w(SX1302_REG_RX_TOP_FRAME_SYNCH0_SF5_PEAK1_POS_SF5, 2);
@@ -924,21 +1337,40 @@ int sx1302_lora_syncword(bool public, uint8_t lora_service_sf) {
         lgw_reg_w(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_FRAME_SYNCH1_PEAK2_POS, 8);
     }
 
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 uint32_t sx1302_timestamp_counter(bool pps) {
-    return timestamp_counter_get(&counter_us, pps);
+    uint32_t cnt;
+
+    /* the counter wrapping status is also updated by the RX path */
+    lgw_reg_lock();
+    cnt = timestamp_counter_get(&counter_us[lgw_board], pps);
+    lgw_reg_unlock();
+
+    return cnt;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int sx1302_gps_enable(bool enable) {
-    if (enable == true) {
-        lgw_reg_w(SX1302_REG_TIMESTAMP_GPS_CTRL_GPS_EN, 1);
-        lgw_reg_w(SX1302_REG_TIMESTAMP_GPS_CTRL_GPS_POL, 1); /* invert polarity for PPS */
+uint64_t sx1302_timestamp_counter64(bool pps) {
+    uint64_t cnt;
+
+    lgw_reg_lock();
+    cnt = timestamp_counter_get64(&counter_us[lgw_board], pps);
+    lgw_reg_unlock();
+
+    return cnt;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1302_gps_enable(bool enable) {
+    if (enable == true) {
+        lgw_reg_w(SX1302_REG_TIMESTAMP_GPS_CTRL_GPS_EN, 1);
+        lgw_reg_w(SX1302_REG_TIMESTAMP_GPS_CTRL_GPS_POL, 1); /* invert polarity for PPS */
     } else {
         lgw_reg_w(SX1302_REG_TIMESTAMP_GPS_CTRL_GPS_EN, 0);
     }
@@ -952,6 +1384,12 @@ int sx1302_agc_load_firmware(const uint8_t *firmware) {
     int32_t val;
     uint8_t fw_check[MCU_FW_SIZE];
     int32_t gpio_sel = MCU_AGC;
+    int i;
+
+    /* the firmware may program the radios */
+    for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
+        lgw_sx125x_shadow_reset(i);
+    }
 
     /* Configure GPIO to let AGC MCU access board LEDs */
     lgw_reg_w(SX1302_REG_GPIO_GPIO_SEL_0_SELECTION, gpio_sel);
@@ -1474,7 +1912,71 @@ void sx1302_arb_set_debug_stats(bool enable, uint8_t sf) {
         lgw_reg_w(SX1302_REG_ARB_MCU_ARB_DEBUG_CFG_0_ARB_DEBUG_CFG_0, sf);
     } else {
         DEBUG_MSG("ARB: Debug stats disabled\n");
+        sf = 0;
+    }
+
+    /* counting restarts, the next sample only takes the current counter values */
+    memset(&arb_stats[lgw_board], 0, sizeof arb_stats[lgw_board]);
+    arb_stats[lgw_board].sf = sf;
+    arb_sts_valid[lgw_board] = false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1302_arb_update_debug_stats(bool refresh) {
+    struct timespec now;
+    int64_t age_ms;
+    uint8_t sts[2 * LGW_MULTI_NB];
+    int i;
+
+    if (arb_stats[lgw_board].sf == 0) {
+        return LGW_REG_SUCCESS;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((refresh == false) && (arb_sts_valid[lgw_board] == true)) {
+        age_ms = ((int64_t)(now.tv_sec - arb_sts_time[lgw_board].tv_sec) * 1000) + ((now.tv_nsec - arb_sts_time[lgw_board].tv_nsec) / 1000000);
+        if (age_ms < ARB_STATS_REFRESH_MS) {
+            return LGW_REG_SUCCESS;
+        }
+    }
+
+    /* detect counters STS_0..7 and allocation counters STS_8..15 are contiguous: one burst read */
+    if (lgw_reg_rbf(SX1302_REGF_ARB_MCU_ARB_DEBUG_STS_0_ARB_DEBUG_STS_0, sts, sizeof sts) != LGW_REG_SUCCESS) {
+        printf("ERROR: failed to read ARB debug counters\n");
+        return LGW_REG_ERROR;
+    }
+
+    /* the differences modulo 256 are exact as long as a counter wraps at most once between two samples */
+    if (arb_sts_valid[lgw_board] == true) {
+        for (i = 0; i < LGW_MULTI_NB; i++) {
+            arb_stats[lgw_board].nb_detect[i] += (uint8_t)(sts[i] - arb_sts[lgw_board][i]);
+            arb_stats[lgw_board].nb_alloc[i] += (uint8_t)(sts[LGW_MULTI_NB + i] - arb_sts[lgw_board][LGW_MULTI_NB + i]);
+        }
+    }
+    memcpy(arb_sts[lgw_board], sts, sizeof sts);
+    arb_sts_time[lgw_board] = now;
+    arb_sts_valid[lgw_board] = true;
+
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1302_arb_get_stats(struct lgw_arb_stats_s * stats, bool reset) {
+    uint8_t sf;
+
+    /* Check input params */
+    CHECK_NULL(stats);
+
+    *stats = arb_stats[lgw_board];
+    if (reset == true) {
+        sf = arb_stats[lgw_board].sf;
+        memset(&arb_stats[lgw_board], 0, sizeof arb_stats[lgw_board]);
+        arb_stats[lgw_board].sf = sf;
     }
+
+    return LGW_REG_SUCCESS;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -1576,27 +2078,80 @@ int sx1302_arb_start(uint8_t version) {
 int sx1302_fetch(uint8_t * nb_pkt) {
     int err;
 
+    /* Check input params */
+    CHECK_NULL(nb_pkt);
+
     /* Fetch packets from sx1302 if no more left in RX buffer */
-    if (rx_buffer.buffer_pkt_nb == 0) {
-        /* Initialize RX buffer */
-        err = rx_buffer_new(&rx_buffer);
+    if (rx_buffer[lgw_board].buffer_pkt_nb == 0) {
+        /* Fetch RX buffer if any data available, completing the packet partially read last time */
+        err = rx_buffer_fetch(&rx_buffer[lgw_board]);
         if (err != LGW_REG_SUCCESS) {
-            printf("ERROR: Failed to initialize RX buffer\n");
+            printf("ERROR: Failed to fetch RX buffer\n");
             return LGW_REG_ERROR;
         }
 
-        /* Fetch RX buffer if any data available */
-        err = rx_buffer_fetch(&rx_buffer);
-        if (err != LGW_REG_SUCCESS) {
-            printf("ERROR: Failed to fetch RX buffer\n");
-            return LGW_REG_ERROR;
+        /* Update fill level telemetry */
+        if (rx_buffer[lgw_board].fifo_read > 0) {
+            rx_stats[lgw_board].nb_fetch += 1;
+            rx_stats[lgw_board].nb_bytes += rx_buffer[lgw_board].fifo_read;
+            if (rx_buffer[lgw_board].fifo_level > rx_stats[lgw_board].level_max) {
+                rx_stats[lgw_board].level_max = rx_buffer[lgw_board].fifo_level;
+            }
+            /* high-water heuristic: the chip does not report dropped packets, but
+               with no room left for a largest packet the next one may be lost */
+            if (rx_buffer[lgw_board].fifo_level > (RX_BUFFER_SIZE - RX_BUFFER_PKT_MAX)) {
+                rx_stats[lgw_board].nb_near_full += 1;
+                DEBUG_PRINTF("WARNING: SX1302 RX buffer nearly full (%u bytes), packets may have been dropped\n", rx_buffer[lgw_board].fifo_level);
+            }
+            if (rx_buffer[lgw_board].fifo_read < rx_buffer[lgw_board].fifo_level) {
+                rx_stats[lgw_board].nb_partial += 1;
+            }
         }
-    } else {
-        printf("Note: remaining %u packets in RX buffer, do not fetch sx1302 yet...\n", rx_buffer.buffer_pkt_nb);
     }
 
     /* Return the number of packet fetched */
-    *nb_pkt = rx_buffer.buffer_pkt_nb;
+    *nb_pkt = rx_buffer[lgw_board].buffer_pkt_nb;
+
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1302_get_rx_stats(struct lgw_rx_stats_s * stats, bool reset) {
+    /* Check input params */
+    CHECK_NULL(stats);
+
+    *stats = rx_stats[lgw_board];
+    if (reset == true) {
+        memset(&rx_stats[lgw_board], 0, sizeof rx_stats[lgw_board]);
+    }
+
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int sx1302_rx_pending(bool * pending) {
+    int err;
+    uint8_t buff[2];
+
+    /* Check input params */
+    CHECK_NULL(pending);
+
+    /* Packets already fetched but not parsed yet */
+    if (rx_buffer[lgw_board].buffer_pkt_nb > 0) {
+        *pending = true;
+        return LGW_REG_SUCCESS;
+    }
+
+    /* Check if there is data in the FIFO (a non-null MSB or LSB is enough, no need for the MSB workaround here) */
+    err = lgw_reg_rbf(SX1302_REGF_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, buff, sizeof buff);
+    if (err != LGW_REG_SUCCESS) {
+        printf("ERROR: Failed to get RX buffer status\n");
+        return LGW_REG_ERROR;
+    }
+
+    *pending = ((buff[0] | buff[1]) != 0);
 
     return LGW_REG_SUCCESS;
 }
@@ -1604,7 +2159,7 @@ int sx1302_fetch(uint8_t * nb_pkt) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
-    int i, err;
+    int err;
     int ifmod; /* type of if_chain/modem a packet was received by */
     uint16_t payload_crc16_calc;
     uint8_t cr;
@@ -1615,17 +2170,14 @@ int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
     CHECK_NULL(context);
     CHECK_NULL(p);
 
-    /* FOR DEBUG: Print statistics of number of detects and modem allocations from ARB for configured SF (see sx1302_arb_start()) */
-    sx1302_arb_print_debug_stats();
-
     /* get packet from RX buffer */
-    err = rx_buffer_pop(&rx_buffer, &pkt);
+    err = rx_buffer_pop(&rx_buffer[lgw_board], &pkt);
     if (err != LGW_REG_SUCCESS) {
         return LGW_REG_ERROR;
     }
 
     /* copy payload to result struct */
-    memcpy((void *)p->payload, (void *)(&(pkt.payload)), pkt.rxbytenb_modem);
+    memcpy((void *)p->payload, (const void *)pkt.payload, pkt.rxbytenb_modem);
     p->size = pkt.rxbytenb_modem;
 
     /* process metadata */
@@ -1667,7 +2219,7 @@ int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
                         printf("ERROR: Payload CRC16 check failed (got:0x%04X calc:0x%04X)\n", pkt.rx_crc16_value, payload_crc16_calc);
                         if (log_file != NULL) {
                             fprintf(log_file, "ERROR: Payload CRC16 check failed (got:0x%04X calc:0x%04X)\n", pkt.rx_crc16_value, payload_crc16_calc);
-                            dbg_log_buffer_to_file(log_file, rx_buffer.buffer, rx_buffer.buffer_size);
+                            dbg_log_buffer_to_file(log_file, rx_buffer[lgw_board].buffer, rx_buffer[lgw_board].buffer_size);
                         }
                         return LGW_REG_ERROR;
                     } else {
@@ -1680,33 +2232,16 @@ int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
             p->status = STAT_NO_CRC;
         }
 
-#if 1
         /* FOR DEBUG: Check data integrity for known devices (debug context) */
-        if (p->status == STAT_CRC_OK || p->status == STAT_NO_CRC) {
+        if ((context->debug_cfg.nb_ref_payload > 0) && (p->status == STAT_CRC_OK || p->status == STAT_NO_CRC)) {
             /*  We compare the received payload with predefined ones to ensure that the payload content is what we expect.
                 4 bytes: ID to identify the payload
                 4 bytes: packet counter used to initialize the seed for pseudo-random generation
                 x bytes: pseudo-random payload
+                The comparison and its logging are done by the debug thread, not to slow down the RX path.
             */
-            int res;
-            for (i = 0; i < context->debug_cfg.nb_ref_payload; i++) {
-                res = dbg_check_payload(&(context->debug_cfg), log_file, p->payload, p->size, i, pkt.rx_rate_sf);
-                if (res == -1) {
-                    printf("ERROR: 0x%08X payload error\n", context->debug_cfg.ref_payload[i].id);
-                    if (log_file != NULL) {
-                        fprintf(log_file, "ERROR: 0x%08X payload error\n", context->debug_cfg.ref_payload[i].id);
-                        dbg_log_buffer_to_file(log_file, rx_buffer.buffer, rx_buffer.buffer_size);
-                        dbg_log_payload_diff_to_file(log_file, p->payload, context->debug_cfg.ref_payload[i].payload, p->size);
-                    }
-                    return LGW_REG_ERROR;
-                } else if (res == 1) {
-                    DEBUG_PRINTF("0x%08X payload matches\n", context->debug_cfg.ref_payload[i].id);
-                } else {
-                    /* Do nothing */
-                }
-            }
+            dbg_payload_check_queue(p->payload, p->size, pkt.rx_rate_sf);
         }
-#endif
 
         /* Get SNR - converted from 0.25dB step to dB */
         p->snr = (float)(pkt.snr_average) / 4;
@@ -1764,6 +2299,11 @@ int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
 
         /* Get timestamp correction to be applied */
         timestamp_correction = timestamp_counter_correction(ifmod, p->bandwidth, p->datarate, p->coderate, pkt.crc_en, pkt.rxbytenb_modem);
+
+        /* Get time on air, uplinks are expected to use the standard preamble */
+        p->airtime_us = lgw_lora_toa_us(p->bandwidth, p->datarate, p->coderate, STD_LORA_PREAMBLE,
+                                        (ifmod == IF_LORA_STD) && (context->lora_service_cfg.implicit_hdr == true),
+                                        pkt.crc_en || (context->lora_service_cfg.implicit_crc_en == true), p->size);
     } else if (ifmod == IF_FSK_STD) {
         DEBUG_PRINTF("Note: FSK packet (modem %u chan %u)\n", pkt.modem_id, p->if_chain);
         p->modulation = MOD_FSK;
@@ -1790,6 +2330,9 @@ int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
         /* Compute timestamp correction to be applied */
         timestamp_correction = ((uint32_t)680000 / context->fsk_cfg.datarate) - 20;
 
+        /* Get time on air */
+        p->airtime_us = lgw_fsk_toa_us(context->fsk_cfg.datarate, STD_FSK_PREAMBLE, context->fsk_cfg.sync_word_size, pkt.crc_en, p->size);
+
         /* RSSI correction */
         p->rssic = RSSI_FSK_POLY_0 + RSSI_FSK_POLY_1 * p->rssic + RSSI_FSK_POLY_2 * pow(p->rssic, 2);
 
@@ -1809,20 +2352,19 @@ int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
         p->bandwidth = BW_UNDEFINED;
         p->datarate = DR_UNDEFINED;
         p->coderate = CR_UNDEFINED;
+        p->airtime_us = 0;
         timestamp_correction = 0;
     }
 
-    /* Update counter reference / wrap status before expanding */
-    timestamp_counter_get(&counter_us, false);
+    /* Scale 32 MHz packet timestamp to 1 MHz (microseconds) and expand it, based on the
+       counter value extrapolated since the last sx1302_update() */
+    lgw_reg_lock();
+    p->count_us_64 = timestamp_pkt_expand64(&counter_us[lgw_board], pkt.timestamp_cnt / 32);
+    lgw_reg_unlock();
 
-    /* Scale 32 MHz packet timestamp to 1 MHz (microseconds) */
-    p->count_us = pkt.timestamp_cnt / 32;
-
-    /* Expand 27-bits counter to 32-bits counter, based on current wrapping status */
-    p->count_us = timestamp_pkt_expand(&counter_us, p->count_us);
-
-    /* Packet timestamp corrected */
-    p->count_us = p->count_us - timestamp_correction;
+    /* Packet timestamp corrected, the 32-bits counter is the lower part of the 64-bits one */
+    p->count_us_64 = p->count_us_64 - timestamp_correction;
+    p->count_us = (uint32_t)p->count_us_64;
 
     /* Packet CRC status */
     p->crc = pkt.rx_crc16_value;
@@ -1834,10 +2376,10 @@ int sx1302_parse(lgw_context_t * context, struct lgw_pkt_rx_s * p) {
 
 uint16_t sx1302_lora_payload_crc(const uint8_t * data, uint8_t size) {
     int i;
-    int crc = 0;
+    uint16_t crc = 0;
 
     for (i = 0; i < size; i++) {
-        lora_crc16(data[i], &crc);
+        crc = (uint16_t)(crc << 8) ^ data[i] ^ lora_crc16_table[crc >> 8];
     }
 
     //printf("CRC16: 0x%02X 0x%02X (%X)\n", (uint8_t)(crc >> 8), (uint8_t)crc, crc);
@@ -1892,7 +2434,7 @@ int sx1302_tx_set_start_delay(uint8_t rf_chain, lgw_radio_type_t radio_type, uin
 
     /* Adjust with modulation */
     if (modulation == MOD_LORA) {
-        lgw_reg_r(SX1302_REG_TX_TOP_TX_CFG0_0_CHIRP_LOWPASS(0), &val);
+        lgw_reg_rf(SX1302_REGF_TX_TOP_TX_CFG0_0_CHIRP_LOWPASS(0), &val);
         chirp_low_pass = (uint8_t)val;
         filter_delay = ((1 << chirp_low_pass) - 1) * 1e6 / bw_hz;
         modem_delay = 8 * (32e6 / (32 * bw_hz)); /* if bw=125k then modem freq=4MHz */
@@ -1908,8 +2450,8 @@ int sx1302_tx_set_start_delay(uint8_t rf_chain, lgw_radio_type_t radio_type, uin
     DEBUG_PRINTF("INFO: tx_start_delay=%u (%u, radio_bw_delay=%u, filter_delay=%u, modem_delay=%u)\n", (uint16_t)tx_start_delay, TX_START_DELAY_DEFAULT*32, radio_bw_delay, filter_delay, modem_delay);
 
     /* Configure the SX1302 with the calculated delay */
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_START_DELAY_MSB_TX_START_DELAY(rf_chain), (uint8_t)(tx_start_delay >> 8));
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_START_DELAY_LSB_TX_START_DELAY(rf_chain), (uint8_t)(tx_start_delay >> 0));
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_START_DELAY_MSB_TX_START_DELAY(rf_chain), (uint8_t)(tx_start_delay >> 8));
+    lgw_reg_wf(SX1302_REGF_TX_TOP_TX_START_DELAY_LSB_TX_START_DELAY(rf_chain), (uint8_t)(tx_start_delay >> 0));
 
     /* return tx_start_delay */
     *delay = tx_start_delay;
@@ -1943,7 +2485,7 @@ uint8_t sx1302_tx_status(uint8_t rf_chain) {
     int err;
     int32_t read_value;
 
-    err = lgw_reg_r(SX1302_REG_TX_TOP_TX_FSM_STATUS_TX_STATUS(rf_chain), &read_value);
+    err = lgw_reg_rf(SX1302_REGF_TX_TOP_TX_FSM_STATUS_TX_STATUS(rf_chain), &read_value);
     if (err != LGW_REG_SUCCESS) {
         printf("ERROR: Failed to read TX STATUS\n");
         return TX_STATUS_UNKNOWN;
@@ -1975,9 +2517,9 @@ int sx1302_tx_abort(uint8_t rf_chain) {
     int err;
     uint8_t tx_status;
 
-    err  = lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_IMMEDIATE(rf_chain), 0x00);
-    err |= lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_DELAYED(rf_chain), 0x00);
-    err |= lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_GPS(rf_chain), 0x00);
+    err  = lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_IMMEDIATE(rf_chain), 0x00);
+    err |= lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_DELAYED(rf_chain), 0x00);
+    err |= lgw_reg_wf(SX1302_REGF_TX_TOP_TX_TRIG_TX_TRIG_GPS(rf_chain), 0x00);
     if (err != LGW_REG_SUCCESS) {
         printf("ERROR: Failed to stop TX trigger\n");
         return err;
@@ -2028,290 +2570,64 @@ int sx1302_tx_configure(lgw_radio_type_t radio_type) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 int sx1302_send(lgw_radio_type_t radio_type, struct lgw_tx_gain_lut_s * tx_lut, bool lwan_public, struct lgw_conf_rxif_s * context_fsk, struct lgw_pkt_tx_s * pkt_data) {
-    uint32_t freq_reg, fdev_reg;
-    uint32_t freq_dev;
-    uint32_t fsk_br_reg;
-    uint64_t fsk_sync_word_reg;
-    uint16_t mem_addr;
-    uint32_t count_us;
-    uint8_t power;
-    uint8_t pow_index;
-    uint8_t mod_bw;
-    uint8_t pa_en;
+    int err;
     uint16_t tx_start_delay;
 
     /* CHeck input parameters */
     CHECK_NULL(tx_lut);
     CHECK_NULL(pkt_data);
 
-    /* Select the proper modem */
-    switch (pkt_data->modulation) {
-        case MOD_CW:
-            lgw_reg_w(SX1302_REG_TX_TOP_GEN_CFG_0_MODULATION_TYPE(pkt_data->rf_chain), 0x00);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_CTRL_TX_IF_SRC(pkt_data->rf_chain), 0x00);
-            break;
-        case MOD_LORA:
-            lgw_reg_w(SX1302_REG_TX_TOP_GEN_CFG_0_MODULATION_TYPE(pkt_data->rf_chain), 0x00);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_CTRL_TX_IF_SRC(pkt_data->rf_chain), 0x01);
-            break;
-        case MOD_FSK:
-            lgw_reg_w(SX1302_REG_TX_TOP_GEN_CFG_0_MODULATION_TYPE(pkt_data->rf_chain), 0x01);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_CTRL_TX_IF_SRC(pkt_data->rf_chain), 0x02);
-            break;
-        default:
-            DEBUG_MSG("ERROR: modulation type not supported\n");
-            return LGW_REG_ERROR;
-    }
-
-    /* Find the proper index in the TX gain LUT according to requested rf_power */
-    for (pow_index = tx_lut->size-1; pow_index > 0; pow_index--) {
-        if (tx_lut->lut[pow_index].rf_power <= pkt_data->rf_power) {
-            break;
-        }
+    /* Queue TX configuration and trigger, to program the modem with as few SPI transactions as possible */
+    lgw_reg_batch_start();
+    err = tx_program(radio_type, tx_lut, lwan_public, context_fsk, pkt_data, &tx_start_delay);
+    if (err == LGW_REG_SUCCESS) {
+        DEBUG_PRINTF("Start Tx: Freq:%u %s%u size:%u preamb:%u\n", pkt_data->freq_hz, (pkt_data->modulation == MOD_LORA) ? "SF" : "DR:", pkt_data->datarate, pkt_data->size, pkt_data->preamble);
+        err = tx_trigger(pkt_data->rf_chain, pkt_data->tx_mode, pkt_data->count_us, tx_start_delay);
     }
-    DEBUG_PRINTF("INFO: selecting TX Gain LUT index %u\n", pow_index);
-
-    /* loading calibrated Tx DC offsets */
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_I_OFFSET_I_OFFSET(pkt_data->rf_chain), tx_lut->lut[pow_index].offset_i);
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_Q_OFFSET_Q_OFFSET(pkt_data->rf_chain), tx_lut->lut[pow_index].offset_q);
-
-    DEBUG_PRINTF("INFO: Applying IQ offset (i:%d, q:%d)\n", tx_lut->lut[pow_index].offset_i, tx_lut->lut[pow_index].offset_q);
-
-    /* Set the power parameters to be used for TX */
-    switch (radio_type) {
-        case LGW_RADIO_TYPE_SX1250:
-            pa_en = (tx_lut->lut[pow_index].pa_gain > 0) ? 1 : 0; /* only 1 bit used to control the external PA */
-            power = (pa_en << 6) | tx_lut->lut[pow_index].pwr_idx;
-            break;
-        case LGW_RADIO_TYPE_SX1257:
-            power = (tx_lut->lut[pow_index].pa_gain << 6) | (tx_lut->lut[pow_index].dac_gain << 4) | tx_lut->lut[pow_index].mix_gain;
-            break;
-        default:
-            DEBUG_MSG("ERROR: radio type not supported\n");
-            return LGW_HAL_ERROR;
-    }
-    lgw_reg_w(SX1302_REG_TX_TOP_AGC_TX_PWR_AGC_TX_PWR(pkt_data->rf_chain), power);
-
-    /* Set digital gain */
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_IQ_GAIN_IQ_GAIN(pkt_data->rf_chain), tx_lut->lut[pow_index].dig_gain);
-
-    /* Set Tx frequency */
-    freq_reg = SX1302_FREQ_TO_REG(pkt_data->freq_hz); /* TODO: AGC fw to be updated for sx1255 */
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_RF_H_FREQ_RF(pkt_data->rf_chain), (freq_reg >> 16) & 0xFF);
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_RF_M_FREQ_RF(pkt_data->rf_chain), (freq_reg >> 8) & 0xFF);
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_RF_L_FREQ_RF(pkt_data->rf_chain), (freq_reg >> 0) & 0xFF);
-
-    /* Set AGC bandwidth and modulation type*/
-    switch (pkt_data->modulation) {
-        case MOD_LORA:
-            mod_bw = pkt_data->bandwidth;
-            break;
-        case MOD_CW:
-        case MOD_FSK:
-            mod_bw = (0x01 << 7) | pkt_data->bandwidth;
-            break;
-        default:
-            printf("ERROR: Modulation not supported\n");
-            return LGW_REG_ERROR;
+    if (err != LGW_REG_SUCCESS) {
+        lgw_reg_batch_end();
+        return err;
     }
-    lgw_reg_w(SX1302_REG_TX_TOP_AGC_TX_BW_AGC_TX_BW(pkt_data->rf_chain), mod_bw);
-
-    /* Configure modem */
-    switch (pkt_data->modulation) {
-        case MOD_CW:
-            /* Set frequency deviation */
-            freq_dev = ceil(fabs((float)pkt_data->freq_offset/10))*10e3;
-            printf("CW: f_dev %d Hz\n", (int)(freq_dev));
-            fdev_reg = SX1302_FREQ_TO_REG(freq_dev);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  8) & 0xFF);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  0) & 0xFF);
-
-            /* Send frequency deviation to AGC fw for radio config */
-            fdev_reg = SX1250_FREQ_TO_REG(freq_dev);
-            lgw_reg_w(SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE2_MCU_MAIL_BOX_WR_DATA, (fdev_reg >> 16) & 0xFF); /* Needed by AGC to configure the sx1250 */
-            lgw_reg_w(SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE1_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  8) & 0xFF); /* Needed by AGC to configure the sx1250 */
-            lgw_reg_w(SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE0_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  0) & 0xFF); /* Needed by AGC to configure the sx1250 */
-
-            /* Set the frequency offset (ratio of the frequency deviation)*/
-            printf("CW: IF test mod freq %d\n", (int)(((float)pkt_data->freq_offset*1e3*64/(float)freq_dev)));
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_TEST_MOD_FREQ(pkt_data->rf_chain), (int)(((float)pkt_data->freq_offset*1e3*64/(float)freq_dev)));
-            break;
-        case MOD_LORA:
-            /* Set bandwidth */
-            freq_dev = lgw_bw_getval(pkt_data->bandwidth) / 2;
-            fdev_reg = SX1302_FREQ_TO_REG(freq_dev);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  8) & 0xFF);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  0) & 0xFF);
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_0_MODEM_BW(pkt_data->rf_chain), pkt_data->bandwidth);
-
-            /* Preamble length */
-            if (pkt_data->preamble == 0) { /* if not explicit, use recommended LoRa preamble size */
-                pkt_data->preamble = STD_LORA_PREAMBLE;
-            } else if (pkt_data->preamble < MIN_LORA_PREAMBLE) { /* enforce minimum preamble size */
-                pkt_data->preamble = MIN_LORA_PREAMBLE;
-                DEBUG_MSG("Note: preamble length adjusted to respect minimum LoRa preamble size\n");
-            }
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG1_3_PREAMBLE_SYMB_NB(pkt_data->rf_chain), (pkt_data->preamble >> 8) & 0xFF); /* MSB */
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG1_2_PREAMBLE_SYMB_NB(pkt_data->rf_chain), (pkt_data->preamble >> 0) & 0xFF); /* LSB */
-
-            /* LoRa datarate */
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_0_MODEM_SF(pkt_data->rf_chain), pkt_data->datarate);
-            if (pkt_data->datarate < 10) {
-                lgw_reg_w(SX1302_REG_TX_TOP_TX_CFG0_0_CHIRP_LOWPASS(pkt_data->rf_chain), 6); /* less filtering for low SF : TBC */
-            } else {
-                lgw_reg_w(SX1302_REG_TX_TOP_TX_CFG0_0_CHIRP_LOWPASS(pkt_data->rf_chain), 7);
-            }
-
-            /* Coding Rate */
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_1_CODING_RATE(pkt_data->rf_chain), pkt_data->coderate);
-
-            /* Start LoRa modem */
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_2_MODEM_EN(pkt_data->rf_chain), 1);
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_2_CADRXTX(pkt_data->rf_chain), 2);
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG1_1_MODEM_START(pkt_data->rf_chain), 1);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_CFG0_0_CONTINUOUS(pkt_data->rf_chain), 0);
-
-            /* Modulation options */
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_CFG0_0_CHIRP_INVERT(pkt_data->rf_chain), (pkt_data->invert_pol) ? 1 : 0);
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_2_IMPLICIT_HEADER(pkt_data->rf_chain), (pkt_data->no_header) ? 1 : 0);
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_2_CRC_EN(pkt_data->rf_chain), (pkt_data->no_crc) ? 0 : 1);
-
-            /* Syncword */
-            if ((lwan_public == false) || (pkt_data->datarate == DR_LORA_SF5) || (pkt_data->datarate == DR_LORA_SF6)) {
-                DEBUG_MSG("Setting LoRa syncword 0x12\n");
-                lgw_reg_w(SX1302_REG_TX_TOP_FRAME_SYNCH_0_PEAK1_POS(pkt_data->rf_chain), 2);
-                lgw_reg_w(SX1302_REG_TX_TOP_FRAME_SYNCH_1_PEAK2_POS(pkt_data->rf_chain), 4);
-            } else {
-                DEBUG_MSG("Setting LoRa syncword 0x34\n");
-                lgw_reg_w(SX1302_REG_TX_TOP_FRAME_SYNCH_0_PEAK1_POS(pkt_data->rf_chain), 6);
-                lgw_reg_w(SX1302_REG_TX_TOP_FRAME_SYNCH_1_PEAK2_POS(pkt_data->rf_chain), 8);
-            }
-
-            /* Set Fine Sync for SF5/SF6 */
-            if ((pkt_data->datarate == DR_LORA_SF5) || (pkt_data->datarate == DR_LORA_SF6)) {
-                DEBUG_MSG("Enable Fine Sync\n");
-                lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_2_FINE_SYNCH_EN(pkt_data->rf_chain), 1);
-            } else {
-                DEBUG_MSG("Disable Fine Sync\n");
-                lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_2_FINE_SYNCH_EN(pkt_data->rf_chain), 0);
-            }
 
-            /* Set Payload length */
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_3_PAYLOAD_LENGTH(pkt_data->rf_chain), pkt_data->size);
-
-            /* Set PPM offset (low datarate optimization) */
-            lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_1_PPM_OFFSET_HDR_CTRL(pkt_data->rf_chain), 0);
-            if (SET_PPM_ON(pkt_data->bandwidth, pkt_data->datarate)) {
-                DEBUG_MSG("Low datarate optimization ENABLED\n");
-                lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_1_PPM_OFFSET(pkt_data->rf_chain), 1);
-            } else {
-                DEBUG_MSG("Low datarate optimization DISABLED\n");
-                lgw_reg_w(SX1302_REG_TX_TOP_TXRX_CFG0_1_PPM_OFFSET(pkt_data->rf_chain), 0);
-            }
-            break;
-        case MOD_FSK:
-            CHECK_NULL(context_fsk);
-
-            /* Set frequency deviation */
-            freq_dev = pkt_data->f_dev * 1e3;
-            fdev_reg = SX1302_FREQ_TO_REG(freq_dev);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  8) & 0xFF);
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV(pkt_data->rf_chain), (fdev_reg >>  0) & 0xFF);
-
-            /* Send frequency deviation to AGC fw for radio config */
-            fdev_reg = SX1250_FREQ_TO_REG(freq_dev);
-            lgw_reg_w(SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE2_MCU_MAIL_BOX_WR_DATA, (fdev_reg >> 16) & 0xFF); /* Needed by AGC to configure the sx1250 */
-            lgw_reg_w(SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE1_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  8) & 0xFF); /* Needed by AGC to configure the sx1250 */
-            lgw_reg_w(SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE0_MCU_MAIL_BOX_WR_DATA, (fdev_reg >>  0) & 0xFF); /* Needed by AGC to configure the sx1250 */
-
-            /* Modulation parameters */
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_CFG_0_PKT_MODE(pkt_data->rf_chain), 1); /* Variable length */
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_CFG_0_CRC_EN(pkt_data->rf_chain), (pkt_data->no_crc) ? 0 : 1);
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_CFG_0_CRC_IBM(pkt_data->rf_chain), 0); /* CCITT CRC */
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_CFG_0_DCFREE_ENC(pkt_data->rf_chain), 2); /* Whitening Encoding */
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_MOD_FSK_GAUSSIAN_EN(pkt_data->rf_chain), 1);
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_MOD_FSK_GAUSSIAN_SELECT_BT(pkt_data->rf_chain), 2);
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_MOD_FSK_REF_PATTERN_EN(pkt_data->rf_chain), 1);
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_MOD_FSK_REF_PATTERN_SIZE(pkt_data->rf_chain), context_fsk->sync_word_size - 1);
+    /* Submit TX configuration and trigger */
+    return lgw_reg_batch_end();
+}
 
-            /* Syncword */
-            fsk_sync_word_reg = context_fsk->sync_word << (8 * (8 - context_fsk->sync_word_size));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE0_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 0));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE1_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 8));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE2_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 16));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE3_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 24));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE4_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 32));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE5_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 40));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE6_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 48));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_REF_PATTERN_BYTE7_FSK_REF_PATTERN(pkt_data->rf_chain), (uint8_t)(fsk_sync_word_reg >> 56));
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_MOD_FSK_PREAMBLE_SEQ(pkt_data->rf_chain), 0);
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-            /* Set datarate */
-            fsk_br_reg = 32000000 / pkt_data->datarate;
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_BIT_RATE_MSB_BIT_RATE(pkt_data->rf_chain), fsk_br_reg >> 8);
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_BIT_RATE_LSB_BIT_RATE(pkt_data->rf_chain), fsk_br_reg >> 0);
+int sx1302_tx_stage(lgw_radio_type_t radio_type, struct lgw_tx_gain_lut_s * tx_lut, bool lwan_public, struct lgw_conf_rxif_s * context_fsk, struct lgw_pkt_tx_s * pkt_data, uint16_t * tx_start_delay) {
+    int err;
 
-            /* Preamble length */
-            if (pkt_data->preamble == 0) { /* if not explicit, use LoRaWAN preamble size */
-                pkt_data->preamble = STD_FSK_PREAMBLE;
-            } else if (pkt_data->preamble < MIN_FSK_PREAMBLE) { /* enforce minimum preamble size */
-                pkt_data->preamble = MIN_FSK_PREAMBLE;
-                DEBUG_MSG("Note: preamble length adjusted to respect minimum FSK preamble size\n");
-            }
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_PREAMBLE_SIZE_MSB_PREAMBLE_SIZE(pkt_data->rf_chain), (pkt_data->preamble >> 8) & 0xFF); /* MSB */
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_PREAMBLE_SIZE_LSB_PREAMBLE_SIZE(pkt_data->rf_chain), (pkt_data->preamble >> 0) & 0xFF); /* LSB */
+    /* CHeck input parameters */
+    CHECK_NULL(tx_lut);
+    CHECK_NULL(pkt_data);
+    CHECK_NULL(tx_start_delay);
 
-            /* Set Payload length */
-            lgw_reg_w(SX1302_REG_TX_TOP_FSK_PKT_LEN_PKT_LENGTH(pkt_data->rf_chain), pkt_data->size);
-            break;
-        default:
-            printf("ERROR: Modulation not supported\n");
-            return LGW_REG_ERROR;
+    /* TX configuration and payload only, the modem waits for its trigger */
+    lgw_reg_batch_start();
+    err = tx_program(radio_type, tx_lut, lwan_public, context_fsk, pkt_data, tx_start_delay);
+    if (err != LGW_REG_SUCCESS) {
+        lgw_reg_batch_end();
+        return err;
     }
 
-    /* Set TX start delay */
-    sx1302_tx_set_start_delay(pkt_data->rf_chain, radio_type, pkt_data->modulation, pkt_data->bandwidth, &tx_start_delay);
-
-    /* Write payload in transmit buffer */
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_CTRL_WRITE_BUFFER(pkt_data->rf_chain), 0x01);
-    mem_addr = REG_SELECT(pkt_data->rf_chain, 0x5300, 0x5500);
-    if (pkt_data->modulation == MOD_FSK) {
-        lgw_mem_wb(mem_addr, (uint8_t *)(&(pkt_data->size)), 1); /* insert payload size in the packet for FSK variable mode (1 byte) */
-        lgw_mem_wb(mem_addr+1, &(pkt_data->payload[0]), pkt_data->size);
-    } else {
-        lgw_mem_wb(mem_addr, &(pkt_data->payload[0]), pkt_data->size);
-    }
-    lgw_reg_w(SX1302_REG_TX_TOP_TX_CTRL_WRITE_BUFFER(pkt_data->rf_chain), 0x00);
+    return lgw_reg_batch_end();
+}
 
-    /* Trigger transmit */
-    DEBUG_PRINTF("Start Tx: Freq:%u %s%u size:%u preamb:%u\n", pkt_data->freq_hz, (pkt_data->modulation == MOD_LORA) ? "SF" : "DR:", pkt_data->datarate, pkt_data->size, pkt_data->preamble);
-    switch (pkt_data->tx_mode) {
-        case IMMEDIATE:
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_IMMEDIATE(pkt_data->rf_chain), 0x00); /* reset state machine */
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_IMMEDIATE(pkt_data->rf_chain), 0x01);
-            break;
-        case TIMESTAMPED:
-            count_us = pkt_data->count_us * 32 - tx_start_delay;
-            DEBUG_PRINTF("--> programming trig delay at %u (%u)\n", pkt_data->count_us - (tx_start_delay / 32), count_us);
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-            lgw_reg_w(SX1302_REG_TX_TOP_TIMER_TRIG_BYTE0_TIMER_DELAYED_TRIG(pkt_data->rf_chain), (uint8_t)((count_us >>  0) & 0x000000FF));
-            lgw_reg_w(SX1302_REG_TX_TOP_TIMER_TRIG_BYTE1_TIMER_DELAYED_TRIG(pkt_data->rf_chain), (uint8_t)((count_us >>  8) & 0x000000FF));
-            lgw_reg_w(SX1302_REG_TX_TOP_TIMER_TRIG_BYTE2_TIMER_DELAYED_TRIG(pkt_data->rf_chain), (uint8_t)((count_us >> 16) & 0x000000FF));
-            lgw_reg_w(SX1302_REG_TX_TOP_TIMER_TRIG_BYTE3_TIMER_DELAYED_TRIG(pkt_data->rf_chain), (uint8_t)((count_us >> 24) & 0x000000FF));
+int sx1302_tx_arm(uint8_t rf_chain, uint8_t tx_mode, uint32_t count_us, uint16_t tx_start_delay) {
+    int err;
 
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_DELAYED(pkt_data->rf_chain), 0x00); /* reset state machine */
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_DELAYED(pkt_data->rf_chain), 0x01);
-            break;
-        case ON_GPS:
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_GPS(pkt_data->rf_chain), 0x00); /* reset state machine */
-            lgw_reg_w(SX1302_REG_TX_TOP_TX_TRIG_TX_TRIG_GPS(pkt_data->rf_chain), 0x01);
-            break;
-        default:
-            printf("ERROR: TX mode not supported\n");
-            return LGW_REG_ERROR;
+    /* trigger registers only, submitted in a single SPI transaction */
+    lgw_reg_batch_start();
+    err = tx_trigger(rf_chain, tx_mode, count_us, tx_start_delay);
+    if (err != LGW_REG_SUCCESS) {
+        lgw_reg_batch_end();
+        return err;
     }
 
-    return LGW_REG_SUCCESS;
+    return lgw_reg_batch_end();
 }
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -18,11 +18,12 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #include <stdint.h>     /* C99 types */
 #include <stdio.h>      /* printf fprintf */
-#include <string.h>     /* memset */
+#include <string.h>     /* memset memmove */
 #include <assert.h>     /* assert */
 
 #include "loragw_aux.h"
 #include "loragw_reg.h"
+#include "loragw_capture.h"
 #include "loragw_sx1302_rx.h"
 #include "loragw_sx1302_timestamp.h"
 
@@ -104,11 +105,28 @@ int rx_buffer_new(rx_buffer_t * self) {
     /* Check input params */
     CHECK_NULL(self);
 
-    /* Initialize members */
-    memset(self->buffer, 0, sizeof self->buffer);
+    /* Initialize members, buffer content is meaningless beyond buffer_size */
     self->buffer_size = 0;
     self->buffer_index = 0;
     self->buffer_pkt_nb = 0;
+    self->buffer_capacity = sizeof self->buffer;
+    self->fifo_level = 0;
+    self->fifo_read = 0;
+
+    return LGW_REG_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int rx_buffer_set_capacity(rx_buffer_t * self, uint16_t capacity) {
+    /* Check input params */
+    CHECK_NULL(self);
+    if ((capacity < RX_BUFFER_PKT_MAX) || (capacity > sizeof self->buffer)) {
+        printf("ERROR: RX buffer capacity out of range (%u, [%u..%u])\n", capacity, RX_BUFFER_PKT_MAX, (unsigned)sizeof self->buffer);
+        return LGW_REG_ERROR;
+    }
+
+    self->buffer_capacity = capacity;
 
     return LGW_REG_SUCCESS;
 }
@@ -133,35 +151,61 @@ int rx_buffer_fetch(rx_buffer_t * self) {
     int i, res;
     uint8_t buff[2];
     int32_t msb;
+    uint16_t nb_carry = 0;
 
     /* Check input params */
     CHECK_NULL(self);
 
+    /* Keep the beginning of a packet which did not fit in the previous fetch, all complete packets have been popped */
+    if ((self->buffer_pkt_nb == 0) && (self->buffer_index >= 0) && (self->buffer_index < self->buffer_size)) {
+        nb_carry = self->buffer_size - (uint16_t)self->buffer_index;
+        if ((nb_carry >= self->buffer_capacity) || (self->buffer[self->buffer_index] != SX1302_PKT_SYNCWORD_BYTE_0)) {
+            printf("WARNING: discarding %u bytes left in rx_buffer\n", nb_carry);
+            nb_carry = 0;
+        } else {
+            memmove(self->buffer, &self->buffer[self->buffer_index], nb_carry);
+        }
+    }
+    self->buffer_size = nb_carry;
+    self->buffer_index = 0;
+    self->buffer_pkt_nb = 0;
+    self->fifo_read = 0;
+
     /* Check if there is data in the FIFO */
-    lgw_reg_rb(SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, buff, sizeof buff);
+    lgw_reg_rbf(SX1302_REGF_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, buff, sizeof buff);
     /* Workaround concentrator chip issue:
         - read MSB again
         - if MSB changed, read the full size gain
      */
-    lgw_reg_r(SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, &msb);
+    lgw_reg_rf(SX1302_REGF_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, &msb);
     if (buff[0] != (uint8_t)msb) {
         lgw_reg_rb(SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, buff, sizeof buff);
     }
 
-    self->buffer_size  = (buff[0] << 8) | (buff[1] << 0);
+    self->fifo_level = (buff[0] << 8) | (buff[1] << 0);
+
+    /* Read what fits in the buffer, the remaining bytes stay in the FIFO for the next fetch */
+    self->fifo_read = self->buffer_capacity - nb_carry;
+    if (self->fifo_read > self->fifo_level) {
+        self->fifo_read = self->fifo_level;
+    }
 
     /* Fetch bytes from fifo if any */
-    if (self->buffer_size > 0) {
+    if (self->fifo_read > 0) {
         DEBUG_MSG   ("-----------------\n");
-        DEBUG_PRINTF("%s: nb_bytes to be fetched: %u (%u %u)\n", __FUNCTION__, self->buffer_size, buff[1], buff[0]);
+        DEBUG_PRINTF("%s: nb_bytes to be fetched: %u/%u (%u %u)\n", __FUNCTION__, self->fifo_read, self->fifo_level, buff[1], buff[0]);
 
-        memset(self->buffer, 0, sizeof self->buffer);
-        res = lgw_mem_rb(0x4000, self->buffer, self->buffer_size, true);
+        res = lgw_mem_rb(0x4000, &self->buffer[nb_carry], self->fifo_read, true);
         if (res != LGW_REG_SUCCESS) {
             printf("ERROR: Failed to read RX buffer, SPI error\n");
             return LGW_REG_ERROR;
         }
 
+        /* log raw content for later replay, if capture is enabled */
+        lgw_capture_write(&self->buffer[nb_carry], self->fifo_read);
+
+        self->buffer_size += self->fifo_read;
+
         /* print debug info : TODO to be removed */
         DEBUG_MSG("RX_BUFFER: ");
         for (i = 0; i < self->buffer_size; i++) {
@@ -171,32 +215,43 @@ int rx_buffer_fetch(rx_buffer_t * self) {
 
     }
 
-    /* Parse buffer to get number of packet fetched */
+    /* Parse buffer to get number of complete packets fetched */
     uint8_t payload_len;
     uint16_t next_pkt_idx;
     int idx = 0;
     while (idx < self->buffer_size) {
+        /* The buffer is not cleared between fetches, only look at the bytes fetched */
+        if ((idx + SX1302_PKT_HEAD_METADATA) > self->buffer_size) {
+            /* header not entirely read yet */
+            break;
+        }
         if ((self->buffer[idx] != SX1302_PKT_SYNCWORD_BYTE_0) || (self->buffer[idx + 1] != SX1302_PKT_SYNCWORD_BYTE_1)) {
             printf("ERROR: syncword not found in rx_buffer\n");
             return LGW_REG_ERROR;
         }
-        /* One packet found in the buffer */
-        self->buffer_pkt_nb += 1;
 
         /* Compute the number of bytes for thsi packet */
         payload_len = SX1302_PKT_PAYLOAD_LENGTH(self->buffer, idx);
+        if ((idx + SX1302_PKT_HEAD_METADATA + payload_len + SX1302_PKT_TAIL_METADATA) > self->buffer_size) {
+            /* packet not entirely read yet, completed by the next fetch */
+            break;
+        }
         next_pkt_idx =  SX1302_PKT_HEAD_METADATA +
                         payload_len +
                         SX1302_PKT_TAIL_METADATA +
                         (2 * SX1302_PKT_NUM_TS_METRICS(self->buffer, idx + payload_len));
+        if ((idx + next_pkt_idx) > self->buffer_size) {
+            /* timestamp metrics not entirely read yet */
+            break;
+        }
+
+        /* One packet found in the buffer */
+        self->buffer_pkt_nb += 1;
 
         /* Move to next packet */
         idx += (int)next_pkt_idx;
     }
 
-    /* Initialize the current buffer index to iterate on */
-    self->buffer_index = 0;
-
     return LGW_REG_SUCCESS;
 }
 
@@ -319,8 +374,8 @@ int rx_buffer_pop(rx_buffer_t * self, rx_packet_t * pkt) {
         }
     }
 
-    /* Parse & copy payload in packet struct */
-    memcpy((void *)pkt->payload, (void *)(&(self->buffer[self->buffer_index + SX1302_PKT_HEAD_METADATA])), pkt->rxbytenb_modem);
+    /* Point to the payload in the RX buffer, no copy */
+    pkt->payload = &(self->buffer[self->buffer_index + SX1302_PKT_HEAD_METADATA]);
 
     /* Move buffer index toward next message */
     self->buffer_index += (SX1302_PKT_HEAD_METADATA + pkt->rxbytenb_modem + SX1302_PKT_TAIL_METADATA + (2 * pkt->num_ts_metrics_stored));
@@ -21,9 +21,17 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
 #include <stdint.h>     /* C99 types */
 #include <stdio.h>      /* printf fprintf */
 #include <memory.h>     /* memset */
+#include <time.h>       /* clock_gettime */
 
 #include "loragw_sx1302_timestamp.h"
 #include "loragw_reg.h"
@@ -50,81 +58,77 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE CONSTANTS ---------------------------------------------------- */
 
+#define COUNTER_27BITS_MASK     0x07FFFFFF
+#define COUNTER_27BITS_HALF     0x04000000  /* max distance to the reference for a non ambiguous expansion (~67s) */
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
+/* DFT peak enable status of the LoRa modems of each board, read once per start (see timestamp_counter_correction) */
+static bool dft_peak_cached[LGW_BOARD_NB];
+static int32_t dft_peak_en_multi[LGW_BOARD_NB];
+static int32_t dft_peak_en_std[LGW_BOARD_NB];
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
 /* -------------------------------------------------------------------------- */
 /* --- INTERNAL SHARED VARIABLES -------------------------------------------- */
 
+extern __thread lgw_handle_t lgw_board;
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
-/* -------------------------------------------------------------------------- */
-/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+static uint64_t host_time_us(void) {
+    struct timespec t;
 
-void timestamp_counter_new(timestamp_counter_t * self) {
-    memset(self, 0, sizeof(*self));
-}
+    clock_gettime(CLOCK_MONOTONIC, &t);
 
-/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-
-void timestamp_counter_delete(timestamp_counter_t * self) {
-    memset(self, 0, sizeof(*self));
+    return ((uint64_t)t.tv_sec * 1000000) + (t.tv_nsec / 1000);
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-void timestamp_counter_update(timestamp_counter_t * self, bool pps, uint32_t cnt) {
-    struct timestamp_info_s* tinfo = (pps == true) ? &self->pps : &self->inst;
+/* Signed distance from ref to cnt on the 27-bits counter circle */
+static int32_t counter_27bits_diff(uint32_t cnt, uint32_t ref) {
+    int32_t diff = (int32_t)((cnt - ref) & COUNTER_27BITS_MASK);
 
-    /* Check if counter has wrapped, and update wrap status if necessary */
-    if (cnt < tinfo->counter_us_27bits_ref) {
-        tinfo->counter_us_27bits_wrap += 1;
-        tinfo->counter_us_27bits_wrap %= 32;
-    }
-
-    /* Update counter reference */
-    tinfo->counter_us_27bits_ref = cnt;
+    return (diff >= COUNTER_27BITS_HALF) ? (diff - (COUNTER_27BITS_MASK + 1)) : diff;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-uint32_t timestamp_counter_get(timestamp_counter_t * self, bool pps) {
+static int counter_read(timestamp_counter_t * self, bool pps) {
     int x;
     uint8_t buff[4];
     uint32_t counter_us_raw_27bits_now;
     int32_t msb;
 
     /* Get the 32MHz timestamp counter - 4 bytes */
-    x = lgw_reg_rb((pps == true) ? SX1302_REG_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS :
-                                   SX1302_REG_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP,
-                                   &buff[0], 4);
+    x = (pps == true) ? lgw_reg_rbf(SX1302_REGF_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS, &buff[0], 4) :
+                        lgw_reg_rbf(SX1302_REGF_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP, &buff[0], 4);
     if (x != LGW_REG_SUCCESS) {
         printf("ERROR: Failed to get timestamp counter value\n");
-        return 0;
+        return LGW_REG_ERROR;
     }
 
     /* Workaround concentrator chip issue:
         - read MSB again
         - if MSB changed, read the full counter gain
      */
-    x = lgw_reg_r((pps == true) ? SX1302_REG_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS :
-                                  SX1302_REG_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP,
-                                  &msb);
+    x = (pps == true) ? lgw_reg_rf(SX1302_REGF_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS, &msb) :
+                        lgw_reg_rf(SX1302_REGF_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP, &msb);
     if (x != LGW_REG_SUCCESS) {
         printf("ERROR: Failed to get timestamp counter MSB value\n");
-        return 0;
+        return LGW_REG_ERROR;
     }
     if (buff[0] != (uint8_t)msb) {
-        x = lgw_reg_rb((pps == true) ? SX1302_REG_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS :
-                                       SX1302_REG_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP,
-                                       &buff[0], 4);
+        x = (pps == true) ? lgw_reg_rbf(SX1302_REGF_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS, &buff[0], 4) :
+                            lgw_reg_rbf(SX1302_REGF_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP, &buff[0], 4);
         if (x != LGW_REG_SUCCESS) {
             printf("ERROR: Failed to get timestamp counter value\n");
-            return 0;
+            return LGW_REG_ERROR;
         }
     }
 
@@ -136,8 +140,94 @@ uint32_t timestamp_counter_get(timestamp_counter_t * self, bool pps) {
     /* Update counter wrapping status */
     timestamp_counter_update(self, pps, counter_us_raw_27bits_now);
 
+    return LGW_REG_SUCCESS;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void timestamp_counter_new(timestamp_counter_t * self) {
+    memset(self, 0, sizeof(*self));
+    dft_peak_cached[lgw_board] = false; /* modems are configured again on each start */
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void timestamp_counter_delete(timestamp_counter_t * self) {
+    memset(self, 0, sizeof(*self));
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void timestamp_counter_update(timestamp_counter_t * self, bool pps, uint32_t cnt) {
+    struct timestamp_info_s* tinfo = (pps == true) ? &self->pps : &self->inst;
+    uint64_t now_us = host_time_us();
+    uint64_t estimate;
+
+    if (tinfo->host_ref_valid == false) {
+        tinfo->counter_us_64bits_ref = cnt;
+        tinfo->host_ref_valid = true;
+    } else if (pps == true) {
+        /* Latched on PPS, does not move without GPS: a counter lower than the reference has wrapped */
+        tinfo->counter_us_64bits_ref += (cnt - tinfo->counter_us_27bits_ref) & COUNTER_27BITS_MASK;
+    } else {
+        /* The host clock tells how many wraps occurred since the last read, even after a long time without update */
+        estimate = tinfo->counter_us_64bits_ref + (now_us - tinfo->host_ref_us);
+        tinfo->counter_us_64bits_ref = estimate + counter_27bits_diff(cnt, (uint32_t)estimate);
+    }
+
+    /* Update wrap status and counter reference */
+    tinfo->counter_us_27bits_wrap = (uint8_t)((tinfo->counter_us_64bits_ref >> 27) & 0x1F);
+    tinfo->counter_us_27bits_ref = cnt;
+    tinfo->host_ref_us = now_us;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void timestamp_counter_refresh(timestamp_counter_t * self, bool pps, uint32_t max_age_ms) {
+    struct timestamp_info_s* tinfo = (pps == true) ? &self->pps : &self->inst;
+
+    if ((tinfo->host_ref_valid == true) && ((host_time_us() - tinfo->host_ref_us) < ((uint64_t)max_age_ms * 1000))) {
+        return; /* reference still fresh enough to be extrapolated */
+    }
+    counter_read(self, pps);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint64_t timestamp_counter_extrapolate(timestamp_counter_t * self) {
+    struct timestamp_info_s* tinfo = &self->inst;
+
+    if (tinfo->host_ref_valid == false) {
+        return 0;
+    }
+
+    return tinfo->counter_us_64bits_ref + (host_time_us() - tinfo->host_ref_us);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint32_t timestamp_counter_get(timestamp_counter_t * self, bool pps) {
+    struct timestamp_info_s* tinfo = (pps == true) ? &self->pps : &self->inst;
+
+    if (counter_read(self, pps) != LGW_REG_SUCCESS) {
+        return 0;
+    }
+
     /* Convert 27-bits counter to 32-bits counter */
-    return timestamp_counter_expand(self, pps, counter_us_raw_27bits_now);
+    return timestamp_counter_expand(self, pps, tinfo->counter_us_27bits_ref);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint64_t timestamp_counter_get64(timestamp_counter_t * self, bool pps) {
+    struct timestamp_info_s* tinfo = (pps == true) ? &self->pps : &self->inst;
+
+    if (counter_read(self, pps) != LGW_REG_SUCCESS) {
+        return 0;
+    }
+
+    return tinfo->counter_us_64bits_ref;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -164,29 +254,23 @@ uint32_t timestamp_counter_expand(timestamp_counter_t * self, bool pps, uint32_t
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 uint32_t timestamp_pkt_expand(timestamp_counter_t * self, uint32_t pkt_cnt_us) {
-    struct timestamp_info_s* tinfo = &self->inst;
-    uint32_t counter_us_32bits;
-    uint8_t wrap_status;
-
-    /* Check if counter has wrapped since the packet has been received in the sx1302 internal FIFO */
-    /* If the sx1302 counter was greater than the pkt timestamp, it means that the internal counter
-        hasn't rolled over since the packet has been received by the sx1302
-        case 1: --|-P--|----|--R-|----|--||-|----|-- : use current wrap status counter
-        case 2: --|-P-||-|-R--|-- : use previous wrap status counter
-        P : packet received in sx1302 internal FIFO
-        R : read packet from sx1302 internal FIFO
-        | : last update internal counter ref value.
-        ||: sx1302 internal counter rollover (wrap)
-    */
+    /* The 32-bits counter is the lower part of the 64-bits one */
+    return (uint32_t)timestamp_pkt_expand64(self, pkt_cnt_us);
+}
 
-    /* Use current wrap counter or previous ? */
-    wrap_status = tinfo->counter_us_27bits_wrap - ((tinfo->counter_us_27bits_ref >= pkt_cnt_us) ? 0 : 1);
-    wrap_status &= 0x1F; /* [0..31] */
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-    /* Expand packet counter */
-    counter_us_32bits = (wrap_status << 27) | pkt_cnt_us;
+uint64_t timestamp_pkt_expand64(timestamp_counter_t * self, uint32_t pkt_cnt_us) {
+    uint64_t now_us;
 
-    return counter_us_32bits;
+    /* The packet has been received in the sx1302 internal FIFO before the current counter value,
+        which is extrapolated from the last read instead of being read again for each packet.
+        The packet is placed at its signed distance from the current counter, so the estimate
+        can be slightly late on the packet timestamp without being mistaken for a wrap.
+    */
+    now_us = timestamp_counter_extrapolate(self);
+
+    return now_us + counter_27bits_diff(pkt_cnt_us, (uint32_t)now_us);
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -260,11 +344,12 @@ uint32_t timestamp_counter_correction(int ifmod, uint8_t bandwidth, uint8_t data
     nb_iter = ((sf + 1) >> 1);
 
     /* timestamp correction code, variable delay */
-    if (ifmod == IF_LORA_STD) {
-        lgw_reg_r(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_RX_CFG0_DFT_PEAK_EN, &val);
-    } else {
-        lgw_reg_r(SX1302_REG_RX_TOP_RX_CFG0_DFT_PEAK_EN, &val);
+    if (dft_peak_cached[lgw_board] == false) {
+        lgw_reg_r(SX1302_REG_RX_TOP_LORA_SERVICE_FSK_RX_CFG0_DFT_PEAK_EN, &dft_peak_en_std[lgw_board]);
+        lgw_reg_r(SX1302_REG_RX_TOP_RX_CFG0_DFT_PEAK_EN, &dft_peak_en_multi[lgw_board]);
+        dft_peak_cached[lgw_board] = true;
     }
+    val = (ifmod == IF_LORA_STD) ? dft_peak_en_std[lgw_board] : dft_peak_en_multi[lgw_board];
     if (val != 0) {
         /* TODO: should we differentiate the mode (FULL/TRACK) ? */
         dft_peak_en = 1;
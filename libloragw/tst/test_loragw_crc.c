@@ -0,0 +1,144 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check that the table-driven LoRa payload CRC is bit-exact with the
+    bitwise reference implementation (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "loragw_hal.h"
+#include "loragw_sx1302.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define NB_RANDOM_PAYLOADS  1000
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+/* Bitwise reference, as originally implemented in loragw_sx1302.c */
+static void lora_crc16_ref(const char data, int *crc) {
+    int next = 0;
+    next  =  (((data>>0)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1)                 )      ;
+    next += ((((data>>1)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1)                 )<<1 ) ;
+    next += ((((data>>2)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1)                 )<<2 ) ;
+    next += ((((data>>3)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<3 ) ;
+    next += ((((data>>4)&1) ^ ((*crc>>12)&1)                                  )<<4 ) ;
+    next += ((((data>>5)&1) ^ ((*crc>>13)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1))<<5 ) ;
+    next += ((((data>>6)&1) ^ ((*crc>>14)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1))<<6 ) ;
+    next += ((((data>>7)&1) ^ ((*crc>>15)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1))<<7 ) ;
+    next += ((((*crc>>0)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<8 ) ;
+    next += ((((*crc>>1)&1) ^ ((*crc>>12)&1)                                  )<<9 ) ;
+    next += ((((*crc>>2)&1) ^ ((*crc>>13)&1)                                  )<<10) ;
+    next += ((((*crc>>3)&1) ^ ((*crc>>14)&1)                                  )<<11) ;
+    next += ((((*crc>>4)&1) ^ ((*crc>>15)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1))<<12) ;
+    next += ((((*crc>>5)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1)                 )<<13) ;
+    next += ((((*crc>>6)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1)                 )<<14) ;
+    next += ((((*crc>>7)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<15) ;
+    (*crc) = next;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint16_t payload_crc_ref(const uint8_t * data, uint8_t size) {
+    int i;
+    int crc = 0;
+
+    for (i = 0; i < size; i++) {
+        lora_crc16_ref(data[i], &crc);
+    }
+
+    return (uint16_t)crc;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool check_payload(const uint8_t * data, uint8_t size) {
+    uint16_t crc_ref, crc;
+
+    crc_ref = payload_crc_ref(data, size);
+    crc = sx1302_lora_payload_crc(data, size);
+    if (crc != crc_ref) {
+        printf("ERROR: CRC mismatch for size %u (got:0x%04X ref:0x%04X)\n", size, crc, crc_ref);
+        return false;
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    int i, j;
+    int nb_err = 0;
+    uint8_t payload[255];
+
+    /* Every single-byte payload */
+    for (i = 0; i < 256; i++) {
+        payload[0] = (uint8_t)i;
+        if (check_payload(payload, 1) == false) {
+            nb_err += 1;
+        }
+    }
+
+    /* Every 2-byte payload, covers all CRC states reachable after 1 byte */
+    for (i = 0; i < 65536; i++) {
+        payload[0] = (uint8_t)(i >> 8);
+        payload[1] = (uint8_t)i;
+        if (check_payload(payload, 2) == false) {
+            nb_err += 1;
+        }
+    }
+
+    /* Constant payloads of every size */
+    for (i = 0; i < 256; i += 0x55) {
+        for (j = 0; j < 255; j++) {
+            payload[j] = (uint8_t)i;
+        }
+        for (j = 0; j <= 255; j++) {
+            if (check_payload(payload, (uint8_t)j) == false) {
+                nb_err += 1;
+            }
+        }
+    }
+
+    /* Random payloads of random sizes */
+    srand(0x1302);
+    for (i = 0; i < NB_RANDOM_PAYLOADS; i++) {
+        for (j = 0; j < 255; j++) {
+            payload[j] = (uint8_t)rand();
+        }
+        if (check_payload(payload, (uint8_t)(rand() % 256)) == false) {
+            nb_err += 1;
+        }
+    }
+
+    if (nb_err != 0) {
+        printf("FAILED: %d CRC mismatches\n", nb_err);
+        return EXIT_FAILURE;
+    }
+
+    printf("SUCCESS: table-driven CRC matches bitwise reference\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
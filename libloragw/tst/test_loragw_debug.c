@@ -0,0 +1,106 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check the deferred payload checks of the debug context: errors, flipped
+    bits and missed packets are aggregated by the check thread (no hardware
+    required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loragw_hal.h"
+#include "loragw_debug.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define REF_ID              0xCAFE1234
+#define PAYLOAD_SIZE        32
+#define NB_PACKETS          100
+#define MISSED_CNT          50      /* not received */
+#define ERROR_CNT           70      /* received with 3 bits flipped */
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    static struct lgw_conf_debug_s context;
+    static uint8_t payloads[NB_PACKETS + 1][PAYLOAD_SIZE];
+    uint32_t cnt;
+    unsigned id, nb_ok, nb_error, nb_bits, nb_missed;
+    char line[256];
+    bool found = false;
+    FILE * log;
+
+    log = tmpfile();
+    if (log == NULL) {
+        printf("FAILED: no temporary file\n");
+        return EXIT_FAILURE;
+    }
+
+    memset(&context, 0, sizeof context);
+    context.nb_ref_payload = 1;
+    context.ref_payload[0].id = REF_ID;
+    context.ref_payload[0].payload[0] = (uint8_t)(REF_ID >> 24);
+    context.ref_payload[0].payload[1] = (uint8_t)(REF_ID >> 16);
+    context.ref_payload[0].payload[2] = (uint8_t)(REF_ID >> 8);
+    context.ref_payload[0].payload[3] = (uint8_t)(REF_ID >> 0);
+
+    /* Build the received payloads first, the check thread uses the same generator */
+    dbg_init_random();
+    for (cnt = 1; cnt <= NB_PACKETS; cnt++) {
+        memcpy(payloads[cnt], context.ref_payload[0].payload, 4);
+        dbg_generate_random_payload(cnt, payloads[cnt], PAYLOAD_SIZE);
+    }
+    payloads[ERROR_CNT][10] ^= 0x81;
+    payloads[ERROR_CNT][PAYLOAD_SIZE - 1] ^= 0x10;
+
+    if (dbg_payload_check_start(&context, log) != 0) {
+        printf("FAILED: check thread not started\n");
+        return EXIT_FAILURE;
+    }
+    for (cnt = 1; cnt <= NB_PACKETS; cnt++) {
+        if (cnt != MISSED_CNT) {
+            dbg_payload_check_queue(payloads[cnt], PAYLOAD_SIZE, 7);
+        }
+    }
+    dbg_payload_check_stop();
+
+    /* Get the summary back from the log */
+    rewind(log);
+    nb_ok = nb_error = nb_bits = nb_missed = 0;
+    while (fgets(line, sizeof line, log) != NULL) {
+        if (sscanf(line, "INFO: 0x%08X payload check: %u ok, %u error (%u bits flipped), %u missed", &id, &nb_ok, &nb_error, &nb_bits, &nb_missed) == 5) {
+            found = (id == REF_ID);
+        }
+    }
+    fclose(log);
+
+    printf("ok:%u error:%u bits:%u missed:%u\n", nb_ok, nb_error, nb_bits, nb_missed);
+    if ((found == false) || (nb_ok != (NB_PACKETS - 2)) || (nb_error != 1) || (nb_bits != 3) || (nb_missed != 1)) {
+        printf("FAILED: wrong payload check results\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("SUCCESS: payload checks are aggregated as expected\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
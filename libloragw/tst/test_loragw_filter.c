@@ -0,0 +1,186 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check the RX filter: CRC policy, DevAddr allow/deny list and duplicates
+    suppression (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loragw_hal.h"
+#include "loragw_filter.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static unsigned long nb_errors = 0;
+
+static struct lgw_conf_rxfilter_s conf;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+static void check(bool ok, const char * what, unsigned got, unsigned expected) {
+    if (!ok) {
+        printf("ERROR: %s (got:%u expected:%u)\n", what, got, expected);
+        nb_errors++;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* LoRaWAN unconfirmed data up frame */
+static void make_pkt(struct lgw_pkt_rx_s * p, uint8_t status, uint32_t devaddr, uint8_t fcnt, uint32_t count_us) {
+    int i;
+
+    memset(p, 0, sizeof *p);
+    p->status = status;
+    p->count_us = count_us;
+    p->size = 20;
+    p->payload[0] = 0x40;
+    p->payload[1] = (uint8_t)(devaddr >> 0);
+    p->payload[2] = (uint8_t)(devaddr >> 8);
+    p->payload[3] = (uint8_t)(devaddr >> 16);
+    p->payload[4] = (uint8_t)(devaddr >> 24);
+    p->payload[6] = fcnt;
+    for (i = 8; i < p->size; i++) {
+        p->payload[i] = (uint8_t)(i * 7);
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void check_pkt(const char * what, uint8_t status, uint32_t devaddr, uint8_t fcnt, uint32_t count_us, int expected) {
+    struct lgw_pkt_rx_s p;
+    int x;
+
+    make_pkt(&p, status, devaddr, fcnt, count_us);
+    x = lgw_filter_check(&p);
+    check(x == expected, what, x, expected);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    struct lgw_rx_stats_s stats;
+    struct lgw_pkt_rx_s p;
+    int i, x;
+
+    printf("Beginning of test for loragw_filter.c\n");
+
+    /* Not configured: everything is returned */
+    check_pkt("default, CRC error", STAT_CRC_BAD, 0x26011234, 0, 0, LGW_FILTER_PASS);
+    check_pkt("default, no CRC", STAT_NO_CRC, 0x26011234, 0, 0, LGW_FILTER_PASS);
+
+    /* CRC policy of the packet forwarder */
+    conf.crc_ok = true;
+    conf.crc_bad = false;
+    conf.no_crc = false;
+    x = lgw_filter_setconf(&conf);
+    check(x == LGW_FILTER_SUCCESS, "CRC policy", x, LGW_FILTER_SUCCESS);
+    check_pkt("CRC ok", STAT_CRC_OK, 0x26011234, 0, 0, LGW_FILTER_PASS);
+    check_pkt("CRC error", STAT_CRC_BAD, 0x26011234, 0, 0, LGW_FILTER_DROP_CRC);
+    check_pkt("no CRC", STAT_NO_CRC, 0x26011234, 0, 0, LGW_FILTER_DROP_CRC);
+
+    /* Allow list, large enough to get collisions in the hash set */
+    conf.devaddr_mode = LGW_FILTER_DEVADDR_ALLOW;
+    conf.devaddr_nb = LGW_FILTER_DEVADDR_MAX;
+    for (i = 0; i < LGW_FILTER_DEVADDR_MAX; i++) {
+        conf.devaddr[i] = 0x26010000 + (uint32_t)i * 0x100;
+    }
+    conf.devaddr[0] = 0; /* empty slot marker */
+    x = lgw_filter_setconf(&conf);
+    check(x == LGW_FILTER_SUCCESS, "allow list", x, LGW_FILTER_SUCCESS);
+    for (i = 0; i < LGW_FILTER_DEVADDR_MAX; i++) {
+        check_pkt("allowed DevAddr", STAT_CRC_OK, conf.devaddr[i], 0, 0, LGW_FILTER_PASS);
+        check_pkt("other DevAddr", STAT_CRC_OK, 0x26010000 + (uint32_t)i * 0x100 + 1, 0, 0, LGW_FILTER_DROP_DEVADDR);
+    }
+    check_pkt("DevAddr 0x26010000 not listed", STAT_CRC_OK, 0x26010000, 0, 0, LGW_FILTER_DROP_DEVADDR);
+    make_pkt(&p, STAT_CRC_OK, 0x12345678, 0, 0);
+    p.payload[0] = 0x00; /* join request */
+    x = lgw_filter_check(&p);
+    check(x == LGW_FILTER_PASS, "join request", x, LGW_FILTER_PASS);
+
+    /* Deny list */
+    conf.devaddr_mode = LGW_FILTER_DEVADDR_DENY;
+    conf.devaddr_nb = 2;
+    conf.devaddr[0] = 0x00ABCDEF;
+    conf.devaddr[1] = 0xFC00AC01;
+    x = lgw_filter_setconf(&conf);
+    check(x == LGW_FILTER_SUCCESS, "deny list", x, LGW_FILTER_SUCCESS);
+    check_pkt("denied DevAddr", STAT_CRC_OK, 0xFC00AC01, 0, 0, LGW_FILTER_DROP_DEVADDR);
+    check_pkt("other DevAddr", STAT_CRC_OK, 0x26010000, 0, 0, LGW_FILTER_PASS);
+
+    /* Duplicates received on 2 IF chains, 100 ms window */
+    conf.devaddr_mode = LGW_FILTER_DEVADDR_OFF;
+    conf.dedup_window_us = 100000;
+    x = lgw_filter_setconf(&conf);
+    check(x == LGW_FILTER_SUCCESS, "duplicates window", x, LGW_FILTER_SUCCESS);
+    lgw_filter_get_stats(&stats, true);
+    check_pkt("first copy", STAT_CRC_OK, 0x26011234, 1, 0xFFFFFF00, LGW_FILTER_PASS);
+    check_pkt("second copy, counter wrapped", STAT_CRC_OK, 0x26011234, 1, 0x00000100, LGW_FILTER_DROP_DUP);
+    check_pkt("other frame count", STAT_CRC_OK, 0x26011234, 2, 0x00000200, LGW_FILTER_PASS);
+    check_pkt("retransmission after the window", STAT_CRC_OK, 0x26011234, 1, 0x00030000, LGW_FILTER_PASS);
+    check_pkt("CRC error", STAT_CRC_BAD, 0x26011234, 2, 0x00000300, LGW_FILTER_DROP_CRC);
+    lgw_filter_reset();
+    check_pkt("copy after reset", STAT_CRC_OK, 0x26011234, 2, 0x00000400, LGW_FILTER_PASS);
+
+    memset(&stats, 0, sizeof stats);
+    lgw_filter_get_stats(&stats, true);
+    check(stats.nb_drop_dup == 1, "duplicates dropped", stats.nb_drop_dup, 1);
+    check(stats.nb_drop_crc_bad == 1, "CRC errors dropped", stats.nb_drop_crc_bad, 1);
+    check(stats.nb_drop_devaddr == 0, "DevAddr dropped", stats.nb_drop_devaddr, 0);
+    lgw_filter_get_stats(&stats, false);
+    check(stats.nb_drop_dup == 0, "counters reset", stats.nb_drop_dup, 0);
+
+    /* Invalid configuration */
+    conf.devaddr_mode = 3;
+    x = lgw_filter_setconf(&conf);
+    check(x == LGW_FILTER_ERROR, "invalid mode", x, LGW_FILTER_ERROR);
+    conf.devaddr_mode = LGW_FILTER_DEVADDR_DENY;
+    conf.devaddr_nb = LGW_FILTER_DEVADDR_MAX + 1;
+    x = lgw_filter_setconf(&conf);
+    check(x == LGW_FILTER_ERROR, "list too long", x, LGW_FILTER_ERROR);
+
+    /* Each board has its own filter */
+    x = lgw_board_select(1);
+    check(x == LGW_HAL_SUCCESS, "select board 1", x, LGW_HAL_SUCCESS);
+    check_pkt("board 1 not configured, CRC error", STAT_CRC_BAD, 0x26011234, 0, 0, LGW_FILTER_PASS);
+    memset(&stats, 0, sizeof stats);
+    lgw_filter_get_stats(&stats, false);
+    check(stats.nb_drop_crc_bad == 0, "board 1 CRC errors dropped", stats.nb_drop_crc_bad, 0);
+    x = lgw_board_select(0);
+    check(x == LGW_HAL_SUCCESS, "select board 0", x, LGW_HAL_SUCCESS);
+    check_pkt("board 0 configured, CRC error", STAT_CRC_BAD, 0x26011234, 0, 0, LGW_FILTER_DROP_CRC);
+    x = lgw_board_select(LGW_BOARD_NB);
+    check(x == LGW_HAL_ERROR, "invalid board", x, LGW_HAL_ERROR);
+    check(lgw_board_selected() == 0, "board kept", lgw_board_selected(), 0);
+
+    if (nb_errors != 0) {
+        printf("End of test for loragw_filter.c: %lu errors, FAILED\n", nb_errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("End of test for loragw_filter.c: OK\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
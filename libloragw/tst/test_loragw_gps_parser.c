@@ -0,0 +1,444 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check the UBX/NMEA stream parser against the frame parsers: frames split
+    across reads, garbage between frames, bad checksums (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>       /* tzset */
+
+#include "loragw_gps.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define FRAME_SIZE_MAX      512
+#define STREAM_SIZE_MAX     8192
+#define RESULTS_MAX         64
+#define NB_STREAMS          2000
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct frame_s {
+    bool    ubx;
+    char    data[FRAME_SIZE_MAX];
+    size_t  size;
+};
+
+/* what the application can see of the decoded frames */
+struct gps_state_s {
+    enum gps_msg    type;
+    int             utc_ok;
+    struct timespec utc;
+    int             gps_time_ok;
+    struct timespec gps_time;
+    int             loc_ok;
+    struct coord_s  loc;
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static unsigned long nb_errors = 0;
+
+/* last field (diffStation, posMode) empty or not, always ending at the '*' */
+static const char * const nmea_bodies[] = {
+    "GPRMC,083559.34,A,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,A",
+    "GNRMC,235959.00,D,4717.11437,S,00833.91522,W,0.004,77.52,311219,,,D",
+    "GPRMC,083559.34,V,,,,,,,091202,,,N",
+    "GPRMC,083559.34,A,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,",
+    "GPGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,",
+    "GNGGA,092725.00,4717.11399,S,00833.91590,W,2,12,0.80,-12.0,M,48.0,M,1.5,0136",
+    "GPGGA,,,,,,0,00,99.99,,,,,,",
+    "GPGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0",
+    "GPZDA,082710.00,16,09,2002,00,00",
+    "GPTXT,01,01,02,u-blox ag - www.u-blox.com"
+};
+
+/* sentences making the decoded state invalid, see reset_state() */
+static const char * const nmea_reset_bodies[] = {
+    "GPRMC,,V,,,,,,,,,,N",
+    "GPGGA,,,,,,0,00,99.99,,,,,,"
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+static void make_nmea(struct frame_s *f, const char *body) {
+    uint8_t ck = 0;
+    size_t i;
+
+    for (i = 0; body[i] != '\0'; i++) {
+        ck ^= (uint8_t)body[i];
+    }
+    f->ubx = false;
+    f->size = (size_t)snprintf(f->data, sizeof f->data, "$%s*%02X\r\n", body, ck);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void make_ubx(struct frame_s *f, uint8_t class, uint8_t id, const uint8_t *payload, uint16_t length) {
+    uint8_t ck_a = 0, ck_b = 0;
+    size_t i;
+
+    f->ubx = true;
+    f->data[0] = (char)LGW_GPS_UBX_SYNC_CHAR;
+    f->data[1] = 0x62;
+    f->data[2] = (char)class;
+    f->data[3] = (char)id;
+    f->data[4] = (char)(length & 0xFF);
+    f->data[5] = (char)(length >> 8);
+    memcpy(&f->data[6], payload, length);
+    for (i = 2; i < (6 + (size_t)length); i++) {
+        ck_a += (uint8_t)f->data[i];
+        ck_b += ck_a;
+    }
+    f->data[6 + length] = (char)ck_a;
+    f->data[7 + length] = (char)ck_b;
+    f->size = 8 + (size_t)length;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* NAV-TIMEGPS: iTOW (ms), fTOW (ns), week, leapS, valid */
+static void make_timegps(struct frame_s *f, uint32_t itow, int32_t ftow, uint16_t week, uint8_t valid) {
+    uint8_t p[16] = { 0 };
+
+    p[0] = (uint8_t)itow; p[1] = (uint8_t)(itow >> 8); p[2] = (uint8_t)(itow >> 16); p[3] = (uint8_t)(itow >> 24);
+    p[4] = (uint8_t)ftow; p[5] = (uint8_t)(ftow >> 8); p[6] = (uint8_t)(ftow >> 16); p[7] = (uint8_t)(ftow >> 24);
+    p[8] = (uint8_t)week; p[9] = (uint8_t)(week >> 8);
+    p[10] = 18;
+    p[11] = valid;
+    make_ubx(f, 0x01, 0x20, p, sizeof p);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int build_frames(struct frame_s *frames) {
+    static const uint8_t ack[2] = { 0x06, 0x01 };
+    uint8_t big[300];
+    int nb = 0;
+    size_t i;
+
+    for (i = 0; i < (sizeof nmea_bodies / sizeof nmea_bodies[0]); i++) {
+        make_nmea(&frames[nb++], nmea_bodies[i]);
+    }
+    make_timegps(&frames[nb++], 302400000, -123456, 2087, 0x07);
+    make_timegps(&frames[nb++], 0xFFFFFFFF, 499999, 0xFFFF, 0x03);
+    make_timegps(&frames[nb++], 302400000, 0, 2087, 0x00); /* time not valid */
+    make_ubx(&frames[nb++], 0x05, 0x01, ack, sizeof ack); /* ACK-ACK */
+    make_ubx(&frames[nb++], 0x05, 0x00, ack, sizeof ack); /* ACK-NAK */
+    make_ubx(&frames[nb++], 0x0A, 0x04, ack, 0); /* empty payload */
+
+    /* longer than what the stream parser keeps, must still be skipped as a whole */
+    for (i = 0; i < sizeof big; i++) {
+        big[i] = (uint8_t)(i * 7);
+    }
+    make_ubx(&frames[nb], 0x0A, 0x09, big, sizeof big);
+    nb++;
+
+    return nb;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void get_state(struct gps_state_s *s, enum gps_msg type) {
+    memset(s, 0, sizeof *s);
+    s->type = type;
+    s->utc_ok = lgw_gps_get(&s->utc, NULL, NULL, NULL);
+    s->gps_time_ok = lgw_gps_get(NULL, &s->gps_time, NULL, NULL);
+    s->loc_ok = lgw_gps_get(NULL, NULL, &s->loc, NULL);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool same_state(const struct gps_state_s *a, const struct gps_state_s *b) {
+    if ((a->type != b->type) || (a->utc_ok != b->utc_ok) || (a->gps_time_ok != b->gps_time_ok) || (a->loc_ok != b->loc_ok)) {
+        return false;
+    }
+    if ((a->utc_ok == LGW_GPS_SUCCESS) && ((a->utc.tv_sec != b->utc.tv_sec) || (a->utc.tv_nsec != b->utc.tv_nsec))) {
+        return false;
+    }
+    if ((a->gps_time_ok == LGW_GPS_SUCCESS) && ((a->gps_time.tv_sec != b->gps_time.tv_sec) || (a->gps_time.tv_nsec != b->gps_time.tv_nsec))) {
+        return false;
+    }
+    if ((a->loc_ok == LGW_GPS_SUCCESS) && ((a->loc.lat != b->loc.lat) || (a->loc.lon != b->loc.lon) || (a->loc.alt != b->loc.alt))) {
+        return false;
+    }
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* invalidate time and position, so that a frame not decoded cannot go unnoticed */
+static void reset_state(void) {
+    struct frame_s f;
+    size_t i;
+
+    for (i = 0; i < (sizeof nmea_reset_bodies / sizeof nmea_reset_bodies[0]); i++) {
+        make_nmea(&f, nmea_reset_bodies[i]);
+        lgw_parse_nmea(f.data, (int)f.size);
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* decode a single frame with the frame parsers */
+static void parse_ref(const struct frame_s *f, struct gps_state_s *s) {
+    enum gps_msg type;
+    size_t msg_size;
+
+    reset_state();
+    if (f->ubx == true) {
+        type = lgw_parse_ubx(f->data, f->size, &msg_size);
+    } else {
+        type = lgw_parse_nmea(f->data, (int)f->size);
+    }
+    get_state(s, type);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* feed bytes to the stream parser, recording the type of each completed frame */
+static void feed(struct lgw_gps_parser_s *parser, const char *data, size_t size, enum gps_msg *results, int *nb_results) {
+    enum gps_msg type;
+    size_t consumed;
+
+    while (size > 0) {
+        type = lgw_gps_parse_stream(parser, data, size, &consumed);
+        if ((consumed == 0) || (consumed > size)) {
+            printf("ERROR: stream parser consumed %zu bytes out of %zu\n", consumed, size);
+            nb_errors++;
+            return;
+        }
+        if (type != UNKNOWN) {
+            if (*nb_results < RESULTS_MAX) {
+                results[*nb_results] = type;
+            }
+            *nb_results += 1;
+        }
+        data += consumed;
+        size -= consumed;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* every frame, cut in two reads at every offset, must decode as with the frame parsers */
+static void test_split(const struct frame_s *frames, int nb_frames) {
+    struct lgw_gps_parser_s parser;
+    struct gps_state_s ref, got;
+    enum gps_msg results[RESULTS_MAX];
+    int nb_results;
+    size_t cut;
+    int i;
+
+    for (i = 0; i < nb_frames; i++) {
+        parse_ref(&frames[i], &ref);
+        if ((ref.type == UNKNOWN) || (ref.type == INVALID) || (ref.type == INCOMPLETE)) {
+            printf("ERROR: frame %d rejected by the frame parser (%d)\n", i, ref.type);
+            nb_errors++;
+        }
+        for (cut = 0; cut <= frames[i].size; cut++) {
+            reset_state();
+            lgw_gps_parser_init(&parser);
+            nb_results = 0;
+            feed(&parser, frames[i].data, cut, results, &nb_results);
+            feed(&parser, frames[i].data + cut, frames[i].size - cut, results, &nb_results);
+            get_state(&got, (nb_results == 1) ? results[0] : UNKNOWN);
+            if ((nb_results != 1) || (same_state(&got, &ref) == false)) {
+                printf("ERROR: frame %d cut at %zu: %d frames, type %d (expected 1 frame, type %d)\n", i, cut, nb_results, got.type, ref.type);
+                nb_errors++;
+            }
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* corrupted checksums are rejected by both parsers, the next frame is still decoded */
+static void test_bad_checksum(const struct frame_s *frames, int nb_frames) {
+    struct lgw_gps_parser_s parser;
+    struct frame_s bad;
+    struct gps_state_s ref;
+    enum gps_msg results[RESULTS_MAX];
+    int nb_results;
+    size_t pos;
+    int i, j;
+
+    for (i = 0; i < nb_frames; i++) {
+        for (j = 0; j < 3; j++) {
+            bad = frames[i];
+            if (bad.ubx == true) {
+                /* CK_A, CK_B, or a payload byte */
+                pos = (j < 2) ? (bad.size - 2 + j) : 6;
+                bad.data[pos] ^= 0x01;
+            } else {
+                /* first or second checksum character, or a character of the sentence */
+                pos = (j < 2) ? (bad.size - 4 + j) : 3;
+                bad.data[pos] = (bad.data[pos] == 'A') ? 'B' : 'A';
+            }
+            if (pos >= bad.size) {
+                continue; /* empty UBX payload */
+            }
+
+            parse_ref(&bad, &ref);
+            if (ref.type != INVALID) {
+                printf("ERROR: frame %d corrupted at %zu accepted by the frame parser (%d)\n", i, pos, ref.type);
+                nb_errors++;
+            }
+
+            lgw_gps_parser_init(&parser);
+            nb_results = 0;
+            results[0] = UNKNOWN;
+            results[1] = UNKNOWN;
+            feed(&parser, bad.data, bad.size, results, &nb_results);
+            feed(&parser, frames[i].data, frames[i].size, results, &nb_results);
+            if ((nb_results != 2) || (results[0] != INVALID) || (results[1] == INVALID)) {
+                printf("ERROR: frame %d corrupted at %zu: %d frames, types %d %d (expected %d then a valid frame)\n", i, pos, nb_results, results[0], results[1], INVALID);
+                nb_errors++;
+            }
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* bytes that do not make a frame: noise, lone sync chars, truncated sentences */
+static size_t add_garbage(char *s) {
+    static const char * const truncated[] = { "$GPRMC,0835", "$", "$GPGGA,\x01", "$GPZ\xB5", "\r\n" };
+    size_t n = 0;
+    size_t i, size;
+    char c;
+
+    switch (rand() % 4) {
+        case 0:
+            break;
+        case 1:
+            size = (size_t)(rand() % 40);
+            for (i = 0; i < size; i++) {
+                do {
+                    c = (char)rand();
+                } while ((c == (char)LGW_GPS_UBX_SYNC_CHAR) || (c == (char)LGW_GPS_NMEA_SYNC_CHAR));
+                s[n++] = c;
+            }
+            break;
+        case 2:
+            s[n++] = (char)LGW_GPS_UBX_SYNC_CHAR;
+            if ((rand() % 2) == 0) {
+                s[n++] = (char)LGW_GPS_UBX_SYNC_CHAR;
+            }
+            break;
+        default:
+            i = (size_t)(rand() % (sizeof truncated / sizeof truncated[0]));
+            memcpy(&s[n], truncated[i], strlen(truncated[i]));
+            n += strlen(truncated[i]);
+            break;
+    }
+
+    return n;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* streams of frames and garbage, read in chunks of random sizes */
+static void test_stream(const struct frame_s *frames, int nb_frames) {
+    struct lgw_gps_parser_s parser;
+    struct gps_state_s ref;
+    static char stream[STREAM_SIZE_MAX];
+    enum gps_msg types[RESULTS_MAX];
+    enum gps_msg expected[RESULTS_MAX];
+    enum gps_msg results[RESULTS_MAX];
+    int nb_expected, nb_results;
+    size_t size, pos, chunk;
+    int n, i, k;
+
+    for (k = 0; k < nb_frames; k++) {
+        parse_ref(&frames[k], &ref);
+        types[k] = ref.type;
+    }
+
+    for (n = 0; n < NB_STREAMS; n++) {
+        size = 0;
+        nb_expected = 0;
+        for (i = 0; i < 20; i++) {
+            size += add_garbage(&stream[size]);
+            k = rand() % nb_frames;
+            memcpy(&stream[size], frames[k].data, frames[k].size);
+            size += frames[k].size;
+            expected[nb_expected++] = types[k];
+        }
+        size += add_garbage(&stream[size]);
+
+        lgw_gps_parser_init(&parser);
+        nb_results = 0;
+        for (pos = 0; pos < size; pos += chunk) {
+            chunk = 1 + (size_t)(rand() % 64);
+            if (chunk > (size - pos)) {
+                chunk = size - pos;
+            }
+            feed(&parser, &stream[pos], chunk, results, &nb_results);
+        }
+
+        if ((nb_results != nb_expected) || (memcmp(results, expected, nb_expected * sizeof expected[0]) != 0)) {
+            printf("ERROR: stream %d: %d frames decoded (expected %d)\n", n, nb_results, nb_expected);
+            for (i = 0; (i < nb_results) && (i < RESULTS_MAX); i++) {
+                printf("  %d: type %d (expected %d)\n", i, results[i], (i < nb_expected) ? (int)expected[i] : -1);
+            }
+            nb_errors++;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    static struct frame_s frames[32];
+    int nb_frames;
+
+    tzset();
+    srand(0xB562); /* reproducible streams */
+
+    nb_frames = build_frames(frames);
+
+    test_split(frames, nb_frames);
+    test_bad_checksum(frames, nb_frames);
+    test_stream(frames, nb_frames);
+
+    if (nb_errors != 0) {
+        printf("FAILED: %lu errors in the GPS stream parser\n", nb_errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("SUCCESS: GPS stream parser decodes %d frames as the frame parsers\n", nb_frames);
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
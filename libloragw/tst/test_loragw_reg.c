@@ -98,6 +98,9 @@ int main(int argc, char ** argv)
         return -1;
     }
 
+    /* Read back values from the chip, not from the register shadow copy */
+    lgw_reg_shadow_enable(false);
+
     /* The following registers cannot be tested this way */
     memset(reg_ignored, 0, sizeof reg_ignored);
     reg_ignored[SX1302_REG_COMMON_CTRL0_CLK32_RIF_CTRL] = true; /* all test fails if we set this one to 1 */
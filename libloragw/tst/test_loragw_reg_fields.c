@@ -0,0 +1,156 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check that the field descriptors used by the inline register accessors
+    match the register table (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "loragw_reg.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+extern const struct lgw_reg_s loregs[LGW_TOTALREGS+1];
+
+/* Field descriptors of loragw_reg.h, with the register they are copied from */
+#define HOT_REG_AB(name) \
+    { SX1302_REG_TX_TOP_A_##name, SX1302_REGF_TX_TOP_##name(0) }, \
+    { SX1302_REG_TX_TOP_B_##name, SX1302_REGF_TX_TOP_##name(1) }
+
+static const struct {
+    uint16_t id;
+    uint16_t addr;
+    uint8_t  offs;
+    uint8_t  leng;
+    bool     sign;
+} fields[] = {
+    { SX1302_REG_AGC_MCU_CTRL_PARITY_ERROR, SX1302_REGF_AGC_MCU_CTRL_PARITY_ERROR },
+    { SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE0_MCU_MAIL_BOX_WR_DATA, SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE0_MCU_MAIL_BOX_WR_DATA },
+    { SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE1_MCU_MAIL_BOX_WR_DATA, SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE1_MCU_MAIL_BOX_WR_DATA },
+    { SX1302_REG_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE2_MCU_MAIL_BOX_WR_DATA, SX1302_REGF_AGC_MCU_MCU_MAIL_BOX_WR_DATA_BYTE2_MCU_MAIL_BOX_WR_DATA },
+    { SX1302_REG_ARB_MCU_ARB_DEBUG_STS_0_ARB_DEBUG_STS_0, SX1302_REGF_ARB_MCU_ARB_DEBUG_STS_0_ARB_DEBUG_STS_0 },
+    { SX1302_REG_ARB_MCU_CTRL_PARITY_ERROR, SX1302_REGF_ARB_MCU_CTRL_PARITY_ERROR },
+    { SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, SX1302_REGF_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES },
+    { SX1302_REG_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP, SX1302_REGF_TIMESTAMP_TIMESTAMP_MSB2_TIMESTAMP },
+    { SX1302_REG_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS, SX1302_REGF_TIMESTAMP_TIMESTAMP_PPS_MSB2_TIMESTAMP_PPS },
+    HOT_REG_AB(AGC_TX_BW_AGC_TX_BW),
+    HOT_REG_AB(AGC_TX_PWR_AGC_TX_PWR),
+    HOT_REG_AB(FRAME_SYNCH_0_PEAK1_POS),
+    HOT_REG_AB(FRAME_SYNCH_1_PEAK2_POS),
+    HOT_REG_AB(FSK_BIT_RATE_LSB_BIT_RATE),
+    HOT_REG_AB(FSK_BIT_RATE_MSB_BIT_RATE),
+    HOT_REG_AB(FSK_CFG_0_CRC_EN),
+    HOT_REG_AB(FSK_CFG_0_CRC_IBM),
+    HOT_REG_AB(FSK_CFG_0_DCFREE_ENC),
+    HOT_REG_AB(FSK_CFG_0_PKT_MODE),
+    HOT_REG_AB(FSK_MOD_FSK_GAUSSIAN_EN),
+    HOT_REG_AB(FSK_MOD_FSK_GAUSSIAN_SELECT_BT),
+    HOT_REG_AB(FSK_MOD_FSK_PREAMBLE_SEQ),
+    HOT_REG_AB(FSK_MOD_FSK_REF_PATTERN_EN),
+    HOT_REG_AB(FSK_MOD_FSK_REF_PATTERN_SIZE),
+    HOT_REG_AB(FSK_PKT_LEN_PKT_LENGTH),
+    HOT_REG_AB(FSK_PREAMBLE_SIZE_LSB_PREAMBLE_SIZE),
+    HOT_REG_AB(FSK_PREAMBLE_SIZE_MSB_PREAMBLE_SIZE),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE0_FSK_REF_PATTERN),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE1_FSK_REF_PATTERN),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE2_FSK_REF_PATTERN),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE3_FSK_REF_PATTERN),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE4_FSK_REF_PATTERN),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE5_FSK_REF_PATTERN),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE6_FSK_REF_PATTERN),
+    HOT_REG_AB(FSK_REF_PATTERN_BYTE7_FSK_REF_PATTERN),
+    HOT_REG_AB(GEN_CFG_0_MODULATION_TYPE),
+    HOT_REG_AB(TIMER_TRIG_BYTE0_TIMER_DELAYED_TRIG),
+    HOT_REG_AB(TIMER_TRIG_BYTE1_TIMER_DELAYED_TRIG),
+    HOT_REG_AB(TIMER_TRIG_BYTE2_TIMER_DELAYED_TRIG),
+    HOT_REG_AB(TIMER_TRIG_BYTE3_TIMER_DELAYED_TRIG),
+    HOT_REG_AB(TXRX_CFG0_0_MODEM_BW),
+    HOT_REG_AB(TXRX_CFG0_0_MODEM_SF),
+    HOT_REG_AB(TXRX_CFG0_1_CODING_RATE),
+    HOT_REG_AB(TXRX_CFG0_1_PPM_OFFSET),
+    HOT_REG_AB(TXRX_CFG0_1_PPM_OFFSET_HDR_CTRL),
+    HOT_REG_AB(TXRX_CFG0_2_CADRXTX),
+    HOT_REG_AB(TXRX_CFG0_2_CRC_EN),
+    HOT_REG_AB(TXRX_CFG0_2_FINE_SYNCH_EN),
+    HOT_REG_AB(TXRX_CFG0_2_IMPLICIT_HEADER),
+    HOT_REG_AB(TXRX_CFG0_2_MODEM_EN),
+    HOT_REG_AB(TXRX_CFG0_3_PAYLOAD_LENGTH),
+    HOT_REG_AB(TXRX_CFG1_1_MODEM_START),
+    HOT_REG_AB(TXRX_CFG1_2_PREAMBLE_SYMB_NB),
+    HOT_REG_AB(TXRX_CFG1_3_PREAMBLE_SYMB_NB),
+    HOT_REG_AB(TX_CFG0_0_CHIRP_INVERT),
+    HOT_REG_AB(TX_CFG0_0_CHIRP_LOWPASS),
+    HOT_REG_AB(TX_CFG0_0_CONTINUOUS),
+    HOT_REG_AB(TX_CTRL_WRITE_BUFFER),
+    HOT_REG_AB(TX_FSM_STATUS_TX_STATUS),
+    HOT_REG_AB(TX_RFFE_IF_CTRL_TX_IF_SRC),
+    HOT_REG_AB(TX_RFFE_IF_FREQ_DEV_H_FREQ_DEV),
+    HOT_REG_AB(TX_RFFE_IF_FREQ_DEV_L_FREQ_DEV),
+    HOT_REG_AB(TX_RFFE_IF_FREQ_RF_H_FREQ_RF),
+    HOT_REG_AB(TX_RFFE_IF_FREQ_RF_L_FREQ_RF),
+    HOT_REG_AB(TX_RFFE_IF_FREQ_RF_M_FREQ_RF),
+    HOT_REG_AB(TX_RFFE_IF_IQ_GAIN_IQ_GAIN),
+    HOT_REG_AB(TX_RFFE_IF_I_OFFSET_I_OFFSET),
+    HOT_REG_AB(TX_RFFE_IF_Q_OFFSET_Q_OFFSET),
+    HOT_REG_AB(TX_RFFE_IF_TEST_MOD_FREQ),
+    HOT_REG_AB(TX_START_DELAY_LSB_TX_START_DELAY),
+    HOT_REG_AB(TX_START_DELAY_MSB_TX_START_DELAY),
+    HOT_REG_AB(TX_TRIG_TX_TRIG_DELAYED),
+    HOT_REG_AB(TX_TRIG_TX_TRIG_GPS),
+    HOT_REG_AB(TX_TRIG_TX_TRIG_IMMEDIATE),
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    unsigned i;
+    unsigned nb_errors = 0;
+    const struct lgw_reg_s *r;
+
+    for (i = 0; i < ARRAY_SIZE(fields); i++) {
+        r = &loregs[fields[i].id];
+        if ((r->addr != fields[i].addr) || (r->offs != fields[i].offs) || (r->leng != fields[i].leng) || (r->sign != fields[i].sign)) {
+            printf("ERROR: field descriptor of register %u is 0x%04X,%u,%u,%d, register table has 0x%04X,%u,%u,%d\n", fields[i].id,
+                                                                    fields[i].addr, fields[i].offs, fields[i].leng, fields[i].sign,
+                                                                    r->addr, r->offs, r->leng, r->sign);
+            nb_errors++;
+        } else if ((r->offs + r->leng) > 8) {
+            printf("ERROR: register %u is not a single-byte field\n", fields[i].id);
+            nb_errors++;
+        }
+    }
+
+    if (nb_errors != 0) {
+        printf("FAILED: %u field descriptors out of %u do not match the register table\n", nb_errors, (unsigned)ARRAY_SIZE(fields));
+        return EXIT_FAILURE;
+    }
+
+    printf("SUCCESS: %u field descriptors match the register table\n", (unsigned)ARRAY_SIZE(fields));
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
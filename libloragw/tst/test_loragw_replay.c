@@ -0,0 +1,152 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check that RX buffer captures are replayed byte for byte, and paced as they
+    were recorded, through the "replay" transport (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loragw_aux.h"
+#include "loragw_reg.h"
+#include "loragw_capture.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define CAPTURE_PATH        "/tmp/test_loragw_replay.cap"
+#define RECORD_DELAY_MS     200     /* delay between the 2 captured records */
+#define NB_RECORDS          3
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static unsigned long nb_errors = 0;
+
+static uint8_t records[NB_RECORDS][LGW_CAPTURE_RECORD_MAX];
+static const uint16_t records_size[NB_RECORDS] = { 17, LGW_CAPTURE_RECORD_MAX, 301 };
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+static void check(bool ok, const char * what, unsigned got, unsigned expected) {
+    if (!ok) {
+        printf("ERROR: %s (got:%u expected:%u)\n", what, got, expected);
+        nb_errors++;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint16_t rx_level(void) {
+    uint8_t buff[2];
+
+    if (lgw_reg_rb(SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES, buff, sizeof buff) != LGW_REG_SUCCESS) {
+        return 0;
+    }
+    return (buff[0] << 8) | (buff[1] << 0);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void check_record(int i) {
+    static uint8_t data[LGW_CAPTURE_RECORD_MAX];
+    uint16_t level;
+    int x;
+
+    level = rx_level();
+    check(level == records_size[i], "RX buffer level", level, records_size[i]);
+    if (level != records_size[i]) {
+        return;
+    }
+    x = lgw_mem_rb(0x4000, data, level, true);
+    check(x == LGW_REG_SUCCESS, "RX buffer read", x, LGW_REG_SUCCESS);
+    check(memcmp(data, records[i], level) == 0, "RX buffer content", i, i);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    FILE * f;
+    int i, j, x;
+
+    printf("Beginning of test for loragw_capture.c\n");
+
+    /* Capture: 2 records back to back, the last one later */
+    for (i = 0; i < NB_RECORDS; i++) {
+        for (j = 0; j < records_size[i]; j++) {
+            records[i][j] = (uint8_t)(rand() & 0xFF);
+        }
+    }
+    x = lgw_capture_start(CAPTURE_PATH);
+    check(x == LGW_CAPTURE_SUCCESS, "capture start", x, LGW_CAPTURE_SUCCESS);
+    lgw_capture_write(records[0], records_size[0]);
+    lgw_capture_write(records[1], records_size[1]);
+    wait_ms(RECORD_DELAY_MS);
+    lgw_capture_write(records[2], records_size[2]);
+    lgw_capture_stop();
+
+    /* Replay as fast as fetched */
+    x = lgw_connect("replay:" CAPTURE_PATH "@0");
+    check(x == LGW_REG_SUCCESS, "replay connect", x, LGW_REG_SUCCESS);
+    for (i = 0; i < NB_RECORDS; i++) {
+        check_record(i);
+    }
+    check(rx_level() == 0, "RX buffer level at end of replay", rx_level(), 0);
+    lgw_disconnect();
+
+    /* Replay at the recorded rate: the last record is held back */
+    x = lgw_connect("replay:" CAPTURE_PATH);
+    check(x == LGW_REG_SUCCESS, "replay connect", x, LGW_REG_SUCCESS);
+    check_record(0);
+    check_record(1);
+    check(rx_level() == 0, "RX buffer level before the record is due", rx_level(), 0);
+    wait_ms(RECORD_DELAY_MS + 50);
+    check_record(2);
+    lgw_disconnect();
+
+    /* Not a capture */
+    f = fopen(CAPTURE_PATH, "wb");
+    if (f != NULL) {
+        fputs("not a capture", f);
+        fclose(f);
+    }
+    x = lgw_connect("replay:" CAPTURE_PATH);
+    check(x == LGW_REG_ERROR, "replay of an invalid file", x, LGW_REG_ERROR);
+    remove(CAPTURE_PATH);
+
+    if (nb_errors != 0) {
+        printf("End of test for loragw_capture.c: %lu errors, FAILED\n", nb_errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("End of test for loragw_capture.c: OK\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
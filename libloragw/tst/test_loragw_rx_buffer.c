@@ -0,0 +1,172 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check that a RX buffer holding more bytes than the host buffer capacity is
+    drained over several fetches, without losing the packets split between two
+    fetches (replayed capture, no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loragw_reg.h"
+#include "loragw_capture.h"
+#include "loragw_sx1302_rx.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define CAPTURE_PATH        "/tmp/test_loragw_rx_buffer.cap"
+#define PKT_HEAD_METADATA   9
+#define PKT_TAIL_METADATA   14
+#define NB_PKT              24      /* 2.9 kB of packets in the RX buffer */
+#define CAPACITY            1000    /* host buffer, not a multiple of the packets size */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static unsigned long nb_errors = 0;
+
+static uint8_t record[LGW_CAPTURE_RECORD_MAX];
+static uint16_t record_size = 0;
+static uint8_t pkt_size[NB_PKT];
+
+static rx_buffer_t rx_buf;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+static void check(bool ok, const char * what, unsigned got, unsigned expected) {
+    if (!ok) {
+        printf("ERROR: %s (got:%u expected:%u)\n", what, got, expected);
+        nb_errors++;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* LoRa packets of various sizes, as stored by the SX1302 */
+static void build_record(void) {
+    uint8_t *p;
+    uint8_t sum;
+    int i, j;
+
+    for (i = 0; i < NB_PKT; i++) {
+        p = &record[record_size];
+        pkt_size[i] = (uint8_t)(20 + 7 * i);
+
+        memset(p, 0, PKT_HEAD_METADATA + pkt_size[i] + PKT_TAIL_METADATA);
+        p[0] = 0xA5; /* syncword */
+        p[1] = 0xC0;
+        p[2] = pkt_size[i];
+        p[3] = (uint8_t)(i % 8); /* channel */
+        p[4] = (uint8_t)(((7 + (i % 6)) << 4) | (1 << 1) | 1); /* SF, CR 4/5, CRC on */
+        p[5] = (uint8_t)(i % 8); /* modem */
+        for (j = 0; j < pkt_size[i]; j++) {
+            p[PKT_HEAD_METADATA + j] = (uint8_t)(i + j);
+        }
+        sum = 0;
+        for (j = 0; j < (PKT_HEAD_METADATA + pkt_size[i] + PKT_TAIL_METADATA - 1); j++) {
+            sum += p[j];
+        }
+        p[PKT_HEAD_METADATA + pkt_size[i] + PKT_TAIL_METADATA - 1] = sum;
+
+        record_size += PKT_HEAD_METADATA + pkt_size[i] + PKT_TAIL_METADATA;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    rx_packet_t pkt;
+    int nb_pkt = 0;
+    int nb_fetch = 0;
+    int nb_partial = 0;
+    int x;
+
+    printf("Beginning of test for loragw_sx1302_rx.c\n");
+
+    build_record();
+    x = lgw_capture_start(CAPTURE_PATH);
+    check(x == LGW_CAPTURE_SUCCESS, "capture start", x, LGW_CAPTURE_SUCCESS);
+    lgw_capture_write(record, record_size);
+    lgw_capture_stop();
+
+    x = lgw_connect("replay:" CAPTURE_PATH "@0");
+    check(x == LGW_REG_SUCCESS, "replay connect", x, LGW_REG_SUCCESS);
+
+    rx_buffer_new(&rx_buf);
+    x = rx_buffer_set_capacity(&rx_buf, RX_BUFFER_PKT_MAX - 1);
+    check(x == LGW_REG_ERROR, "capacity below the largest packet", x, LGW_REG_ERROR);
+    x = rx_buffer_set_capacity(&rx_buf, RX_BUFFER_SIZE + 1);
+    check(x == LGW_REG_ERROR, "capacity above the SX1302 RX buffer", x, LGW_REG_ERROR);
+    x = rx_buffer_set_capacity(&rx_buf, CAPACITY);
+    check(x == LGW_REG_SUCCESS, "capacity", x, LGW_REG_SUCCESS);
+
+    /* Fetch and pop until the RX buffer is empty */
+    do {
+        x = rx_buffer_fetch(&rx_buf);
+        check(x == LGW_REG_SUCCESS, "fetch", x, LGW_REG_SUCCESS);
+        if (x != LGW_REG_SUCCESS) {
+            break;
+        }
+        nb_fetch += 1;
+        check(rx_buf.buffer_size <= CAPACITY, "buffer size", rx_buf.buffer_size, CAPACITY);
+        if (rx_buf.fifo_read < rx_buf.fifo_level) {
+            nb_partial += 1;
+        }
+        while (rx_buf.buffer_pkt_nb > 0) {
+            x = rx_buffer_pop(&rx_buf, &pkt);
+            check(x == LGW_REG_SUCCESS, "pop", x, LGW_REG_SUCCESS);
+            if (x != LGW_REG_SUCCESS) {
+                break;
+            }
+            if (nb_pkt < NB_PKT) {
+                check(pkt.rxbytenb_modem == pkt_size[nb_pkt], "packet size", pkt.rxbytenb_modem, pkt_size[nb_pkt]);
+                check(pkt.payload[0] == (uint8_t)nb_pkt, "packet content", pkt.payload[0], nb_pkt);
+            }
+            nb_pkt += 1;
+        }
+    } while ((rx_buf.fifo_read > 0) && (nb_fetch < NB_PKT));
+
+    check(nb_pkt == NB_PKT, "packets popped", nb_pkt, NB_PKT);
+    check(nb_partial >= (record_size / CAPACITY), "partial fetches", nb_partial, record_size / CAPACITY);
+    check(rx_buf.buffer_index == rx_buf.buffer_size, "bytes left in buffer", rx_buf.buffer_size - rx_buf.buffer_index, 0);
+
+    lgw_disconnect();
+    remove(CAPTURE_PATH);
+
+    if (nb_errors != 0) {
+        printf("End of test for loragw_sx1302_rx.c: %lu errors, FAILED\n", nb_errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("End of test for loragw_sx1302_rx.c: OK\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,113 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check the expansion of the 27-bits SX1302 counter to 32 and 64 bits, across
+    counter wraps (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "loragw_sx1302_timestamp.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define CNT_27BITS_MASK     0x07FFFFFF
+#define CNT_STEP            0x00FFFFF1  /* counter progress between two updates (~16.7s) */
+#define NB_UPDATES          400         /* enough to wrap the 32-bits counter several times */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static unsigned long nb_errors = 0;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+static void check(bool ok, const char * what, uint64_t got, uint64_t expected) {
+    if (!ok) {
+        printf("ERROR: %s (got:0x%" PRIX64 " expected:0x%" PRIX64 ")\n", what, got, expected);
+        nb_errors++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    timestamp_counter_t cnt;
+    uint64_t ref, pkt64;
+    uint32_t pkt;
+    int i;
+
+    printf("Beginning of test for loragw_sx1302_timestamp.c\n");
+
+    /* Packets received around a wrap of the 27-bits counter */
+    timestamp_counter_new(&cnt);
+    timestamp_counter_update(&cnt, false, 0x07FFFF00);
+    pkt64 = timestamp_pkt_expand64(&cnt, 0x07FFFE00);
+    check(pkt64 == 0x07FFFE00, "packet received before the reference", pkt64, 0x07FFFE00);
+    pkt64 = timestamp_pkt_expand64(&cnt, 0x00000010);
+    check(pkt64 == 0x08000010, "packet received after an unseen wrap", pkt64, 0x08000010);
+
+    timestamp_counter_update(&cnt, false, 0x00000100);
+    check(cnt.inst.counter_us_64bits_ref == 0x08000100, "reference after wrap", cnt.inst.counter_us_64bits_ref, 0x08000100);
+    check(timestamp_counter_expand(&cnt, false, 0x100) == 0x08000100, "32-bits expansion after wrap", timestamp_counter_expand(&cnt, false, 0x100), 0x08000100);
+    pkt = timestamp_pkt_expand(&cnt, 0x07FFFF80);
+    check(pkt == 0x07FFFF80, "packet received before the wrap", pkt, 0x07FFFF80);
+
+    /* Long run: 64-bits counter never wraps, 32-bits counter is its lower part */
+    timestamp_counter_new(&cnt);
+    ref = 0x05000000;
+    timestamp_counter_update(&cnt, false, (uint32_t)ref & CNT_27BITS_MASK);
+    for (i = 0; i < NB_UPDATES; i++) {
+        ref += CNT_STEP;
+        timestamp_counter_update(&cnt, false, (uint32_t)ref & CNT_27BITS_MASK);
+        check(cnt.inst.counter_us_64bits_ref == ref, "64-bits reference", cnt.inst.counter_us_64bits_ref, ref);
+
+        pkt64 = timestamp_pkt_expand64(&cnt, (uint32_t)(ref - 1000000) & CNT_27BITS_MASK);
+        check(pkt64 == (ref - 1000000), "64-bits packet timestamp", pkt64, ref - 1000000);
+        pkt = timestamp_pkt_expand(&cnt, (uint32_t)(ref - 1000000) & CNT_27BITS_MASK);
+        check(pkt == (uint32_t)(ref - 1000000), "32-bits packet timestamp", pkt, (uint32_t)(ref - 1000000));
+        check(timestamp_counter_expand(&cnt, false, (uint32_t)ref & CNT_27BITS_MASK) == (uint32_t)ref, "32-bits counter", timestamp_counter_expand(&cnt, false, (uint32_t)ref & CNT_27BITS_MASK), (uint32_t)ref);
+    }
+    check(ref > 0xFFFFFFFF, "test did not wrap the 32-bits counter", ref, 0x100000000);
+
+    /* PPS counter does not move without GPS, and wraps when it goes backward */
+    timestamp_counter_new(&cnt);
+    for (i = 0; i < 3; i++) {
+        timestamp_counter_update(&cnt, true, 0);
+    }
+    check(cnt.pps.counter_us_64bits_ref == 0, "static PPS counter", cnt.pps.counter_us_64bits_ref, 0);
+    timestamp_counter_update(&cnt, true, 0x07000000);
+    timestamp_counter_update(&cnt, true, 0x00100000);
+    check(cnt.pps.counter_us_64bits_ref == 0x08100000, "PPS counter wrap", cnt.pps.counter_us_64bits_ref, 0x08100000);
+    check(timestamp_counter_expand(&cnt, true, 0x00100000) == 0x08100000, "PPS 32-bits expansion", timestamp_counter_expand(&cnt, true, 0x00100000), 0x08100000);
+
+    if (nb_errors != 0) {
+        printf("End of test for loragw_sx1302_timestamp.c: %lu errors, FAILED\n", nb_errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("End of test for loragw_sx1302_timestamp.c: OK\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
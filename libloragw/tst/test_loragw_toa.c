@@ -0,0 +1,180 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check that the integer time on air computation gives the same results as
+    the floating point reference implementation (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define FSK_SYNC_WORD_SIZE  3   /* HAL default, lgw_txgain_setconf is not called */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+extern int32_t lgw_sf_getval(int x);
+extern int32_t lgw_bw_getval(int x);
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+/* Floating point reference, as originally implemented in loragw_hal.c */
+static uint32_t time_on_air_ref(const struct lgw_pkt_tx_s * packet) {
+    uint8_t SF, H, DE;
+    uint16_t BW;
+    uint32_t payloadSymbNb, Tpacket;
+    double Tsym, Tpreamble, Tpayload, Tfsk;
+
+    if (packet->modulation == MOD_LORA) {
+        BW = (uint16_t)(lgw_bw_getval(packet->bandwidth) / 1E3);
+        SF = (uint8_t)lgw_sf_getval(packet->datarate);
+        if (SF < 7) {
+            SF = 7;
+        }
+        Tsym = pow(2, SF) / BW;
+        Tpreamble = ((double)(packet->preamble) + 4.25) * Tsym;
+        H = (packet->no_header==false) ? 0 : 1;
+        DE = (SF >= 11) ? 1 : 0;
+        payloadSymbNb = 8 + (ceil((double)(8*packet->size - 4*SF + 28 + 16 - 20*H) / (double)(4*(SF - 2*DE))) * (packet->coderate + 4));
+        Tpayload = payloadSymbNb * Tsym;
+        Tpacket = Tpreamble + Tpayload;
+    } else {
+        Tfsk = (8 * (double)(packet->preamble + FSK_SYNC_WORD_SIZE + 1 + packet->size + ((packet->no_crc == true) ? 0 : 2)) / (double)packet->datarate) * 1E3;
+        Tpacket = (uint32_t)Tfsk + 1;
+    }
+
+    return Tpacket;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* The reference can lose one ms when the exact FSK time on air is a whole number of ms (e.g. 0.999.. instead of 1) */
+static bool fsk_is_exact(const struct lgw_pkt_tx_s * packet) {
+    uint64_t bits = 8 * (uint64_t)(packet->preamble + FSK_SYNC_WORD_SIZE + 1 + packet->size + ((packet->no_crc == true) ? 0 : 2));
+
+    return ((bits * 1000) % packet->datarate) == 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    static const uint8_t bw_list[] = { BW_125KHZ, BW_250KHZ, BW_500KHZ };
+    static const uint16_t preamble_big[] = { 1000, 4096, 10000, 32768, 65535 };
+    struct lgw_pkt_tx_s pkt;
+    unsigned long nb_tests = 0, nb_errors = 0, nb_rounding = 0;
+    uint32_t toa, ref;
+    unsigned b, sf, cr, h, size, pre, i;
+    uint32_t dr;
+
+    printf("Beginning of test for loragw_hal.c time on air\n");
+
+    /* LoRa: every SF/BW/CR/header/size, and a range of preamble lengths */
+    memset(&pkt, 0, sizeof pkt);
+    pkt.modulation = MOD_LORA;
+    for (sf = DR_LORA_SF5; sf <= DR_LORA_SF12; sf++) {
+        pkt.datarate = sf;
+        for (b = 0; b < sizeof bw_list; b++) {
+            pkt.bandwidth = bw_list[b];
+            for (cr = CR_LORA_4_5; cr <= CR_LORA_4_8; cr++) {
+                pkt.coderate = cr;
+                for (h = 0; h < 2; h++) {
+                    pkt.no_header = (h == 1);
+                    for (size = 0; size < 256; size++) {
+                        pkt.size = size;
+                        for (pre = 0; pre < (100 + sizeof preamble_big / sizeof preamble_big[0]); pre++) {
+                            pkt.preamble = (pre < 100) ? pre : preamble_big[pre - 100];
+                            toa = lgw_time_on_air(&pkt);
+                            ref = time_on_air_ref(&pkt);
+                            nb_tests++;
+                            if (toa != ref) {
+                                if (nb_errors < 10) {
+                                    printf("ERROR: LoRa SF%u BW:0x%02X CR:%u H:%u size:%u preamble:%u => toa:%u ref:%u\n", sf, pkt.bandwidth, cr, h, size, pkt.preamble, toa, ref);
+                                }
+                                nb_errors++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /* FSK: datarates from 500bps to 250kbps */
+    memset(&pkt, 0, sizeof pkt);
+    pkt.modulation = MOD_FSK;
+    for (dr = 500; dr <= 250000; dr += 100) {
+        pkt.datarate = dr;
+        for (i = 0; i < 2; i++) {
+            pkt.no_crc = (i == 1);
+            for (size = 0; size < 256; size++) {
+                pkt.size = size;
+                for (pre = 0; pre <= 16; pre += 4) {
+                    pkt.preamble = pre;
+                    toa = lgw_time_on_air(&pkt);
+                    ref = time_on_air_ref(&pkt);
+                    nb_tests++;
+                    if (toa == ref) {
+                        continue;
+                    }
+                    if ((toa == (ref + 1)) && fsk_is_exact(&pkt)) {
+                        nb_rounding++;
+                        continue;
+                    }
+                    if (nb_errors < 10) {
+                        printf("ERROR: FSK %ubps CRC:%u size:%u preamble:%u => toa:%u ref:%u\n", dr, !pkt.no_crc, size, pre, toa, ref);
+                    }
+                    nb_errors++;
+                }
+            }
+        }
+    }
+
+    /* Invalid parameters */
+    memset(&pkt, 0, sizeof pkt);
+    pkt.modulation = MOD_FSK;
+    nb_tests++;
+    if (lgw_time_on_air(&pkt) != 0) {
+        printf("ERROR: null FSK datarate not rejected\n");
+        nb_errors++;
+    }
+    nb_tests++;
+    if (lgw_time_on_air(NULL) != 0) {
+        printf("ERROR: NULL packet not rejected\n");
+        nb_errors++;
+    }
+
+    printf("%lu tests, %lu errors (%lu FSK reference rounding errors ignored)\n", nb_tests, nb_errors, nb_rounding);
+    if (nb_errors != 0) {
+        printf("End of test for loragw_hal.c time on air: FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("End of test for loragw_hal.c time on air: OK\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -44,6 +44,15 @@ int bin_to_b64_nopad(const uint8_t * in, int size, char * out, int max_len);
 */
 int b64_to_bin_nopad(const char * in, int size, uint8_t * out, int max_len);
 
+/**
+@brief Select the vectorized implementation (SSSE3 on x86, NEON on ARMv8) when the CPU supports it
+@param enable 0 to force the portable implementation, any other value to use the vectorized one if available
+@return 1 if the vectorized implementation is used after the call, 0 otherwise
+
+The vectorized implementation is selected by default. Define BASE64_NO_SIMD at build time to remove it.
+*/
+int b64_set_simd(int enable);
+
 /* === derivative functions === */
 
 /**
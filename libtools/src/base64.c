@@ -19,9 +19,19 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "base64.h"
 
+/* vectorized paths, BASE64_NO_SIMD forces the portable code */
+#if !defined(BASE64_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define BASE64_SSSE3    /* selected at runtime, not required by the build flags */
+    #include <tmmintrin.h>
+#elif !defined(BASE64_NO_SIMD) && defined(__aarch64__)
+    #define BASE64_NEON     /* always available on ARMv8-A */
+    #include <arm_neon.h>
+#endif
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
 
@@ -34,6 +44,36 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE CONSTANTS ---------------------------------------------------- */
 
+#define B64_INVALID     0xFF
+
+/* RFC 1421 alphabet, for code_62 = '+' and code_63 = '/' */
+static const char b64_enc[64] = {
+    'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P',
+    'Q','R','S','T','U','V','W','X','Y','Z','a','b','c','d','e','f',
+    'g','h','i','j','k','l','m','n','o','p','q','r','s','t','u','v',
+    'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/'
+};
+
+/* reverse of b64_enc, B64_INVALID for characters out of the alphabet */
+static const uint8_t b64_dec[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MODULE-WIDE VARIABLES ---------------------------------------- */
 
@@ -41,6 +81,8 @@ static char code_62 = '+';    /* RFC 1421 standard character for code 62 */
 static char code_63 = '/';    /* RFC 1421 standard character for code 63 */
 static char code_pad = '=';    /* RFC 1421 padding character if padding */
 
+static int simd_mode = -1;    /* -1: not probed yet, 0: portable code, 1: vectorized code */
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
@@ -54,6 +96,25 @@ char code_to_char(uint8_t x);
 */
 uint8_t char_to_code(char x);
 
+/**
+@brief Tell if the vectorized code can be used, probing the CPU on first call
+*/
+static bool simd_enabled(void);
+
+/**
+@brief Encode as many groups of 3 bytes as possible with vector instructions
+@return number of groups encoded, reading and writing only within the given groups
+*/
+static int encode_blocks_simd(const uint8_t * in, int blocks, char * out);
+
+/**
+@brief Decode as many groups of 4 characters as possible with vector instructions
+@return number of groups decoded, stops before a group containing an invalid character
+
+Like the encoder, nothing is written beyond the bytes of the decoded groups.
+*/
+static int decode_blocks_simd(const char * in, int blocks, uint8_t * out);
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
@@ -91,9 +152,189 @@ uint8_t char_to_code(char x) {
     } //TODO: improve error management
 }
 
+static inline uint8_t decode_char(char x) {
+    uint8_t c = b64_dec[(uint8_t)x];
+    return (c != B64_INVALID) ? c : char_to_code(x); /* keep legacy error handling */
+}
+
+static bool simd_enabled(void) {
+    /* probing is idempotent, concurrent first calls are harmless */
+    if (simd_mode < 0) {
+#if defined(BASE64_SSSE3)
+        __builtin_cpu_init();
+        simd_mode = __builtin_cpu_supports("ssse3") ? 1 : 0;
+#elif defined(BASE64_NEON)
+        simd_mode = 1;
+#else
+        simd_mode = 0;
+#endif
+    }
+    return (simd_mode == 1);
+}
+
+#if defined(BASE64_SSSE3)
+
+/* 12 bytes -> 16 characters per iteration, one more 32-bit word of input is loaded */
+__attribute__((target("ssse3")))
+static int encode_blocks_simd(const uint8_t * in, int blocks, char * out) {
+    const __m128i shuf = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m128i v, t0, t1, idx, res;
+    int n = 0;
+
+    while ((3*n + 16) <= (3*blocks)) { /* 16 bytes loaded, only 12 consumed */
+        v = _mm_loadu_si128((const __m128i *)(in + 3*n));
+        v = _mm_shuffle_epi8(v, shuf);
+
+        /* split each group of 3 bytes in 4 indexes of 6 bits */
+        t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        idx = _mm_or_si128(t0, t1);
+
+        /* index -> ASCII: select the offset of the index range, then add it */
+        res = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+        res = _mm_or_si128(res, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+        res = _mm_add_epi8(_mm_shuffle_epi8(offsets, res), idx);
+
+        _mm_storeu_si128((__m128i *)(out + 4*n), res);
+        n += 4;
+    }
+
+    return n;
+}
+
+/* 16 characters -> 12 bytes per iteration, 16 bytes are stored */
+__attribute__((target("ssse3")))
+static int decode_blocks_simd(const char * in, int blocks, uint8_t * out) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+    __m128i v, hi_nib, lo_nib, lo, hi, roll;
+    int n = 0;
+
+    while ((3*n + 16) <= (3*blocks)) { /* 16 bytes stored, only 12 produced */
+        v = _mm_loadu_si128((const __m128i *)(in + 4*n));
+
+        /* validate: each character must hit a class accepted for its high nibble */
+        hi_nib = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0F));
+        lo_nib = _mm_and_si128(v, _mm_set1_epi8(0x0F));
+        lo = _mm_shuffle_epi8(lut_lo, lo_nib);
+        hi = _mm_shuffle_epi8(lut_hi, hi_nib);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+            break; /* left to the portable code */
+        }
+
+        /* ASCII -> 6-bit index, '/' shares its high nibble with '+' */
+        roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(v, mask_2f), hi_nib));
+        v = _mm_add_epi8(v, roll);
+
+        /* merge 4 indexes in 3 bytes, then compact the 12 bytes */
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, pack);
+
+        _mm_storeu_si128((__m128i *)(out + 3*n), v);
+        n += 4;
+    }
+
+    return n;
+}
+
+#elif defined(BASE64_NEON)
+
+/* 48 bytes -> 64 characters per iteration */
+static int encode_blocks_simd(const uint8_t * in, int blocks, char * out) {
+    const uint8x16x4_t lut = vld1q_u8_x4((const uint8_t *)b64_enc);
+    uint8x16x3_t v;
+    uint8x16x4_t idx;
+    int n = 0;
+
+    while ((n + 16) <= blocks) {
+        v = vld3q_u8(in + 3*n);
+
+        idx.val[0] = vshrq_n_u8(v.val[0], 2);
+        idx.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(v.val[0], 4), vshrq_n_u8(v.val[1], 4)), vdupq_n_u8(0x3F));
+        idx.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(v.val[1], 2), vshrq_n_u8(v.val[2], 6)), vdupq_n_u8(0x3F));
+        idx.val[3] = vandq_u8(v.val[2], vdupq_n_u8(0x3F));
+
+        idx.val[0] = vqtbl4q_u8(lut, idx.val[0]);
+        idx.val[1] = vqtbl4q_u8(lut, idx.val[1]);
+        idx.val[2] = vqtbl4q_u8(lut, idx.val[2]);
+        idx.val[3] = vqtbl4q_u8(lut, idx.val[3]);
+
+        vst4q_u8((uint8_t *)(out + 4*n), idx);
+        n += 16;
+    }
+
+    return n;
+}
+
+/* 64 characters -> 48 bytes per iteration */
+static int decode_blocks_simd(const char * in, int blocks, uint8_t * out) {
+    const uint8x16x4_t lut0 = vld1q_u8_x4(b64_dec);
+    const uint8x16x4_t lut1 = vld1q_u8_x4(b64_dec + 64);
+    uint8x16x4_t v;
+    uint8x16x3_t res;
+    uint8x16_t err;
+    int i;
+    int n = 0;
+
+    while ((n + 16) <= blocks) {
+        v = vld4q_u8((const uint8_t *)(in + 4*n));
+
+        /* ASCII -> 6-bit index over the 128 first entries, anything else is invalid */
+        err = vdupq_n_u8(0);
+        for (i = 0; i < 4; i++) {
+            err = vorrq_u8(err, vcgeq_u8(v.val[i], vdupq_n_u8(0x80)));
+            v.val[i] = vqtbx4q_u8(vqtbl4q_u8(lut0, v.val[i]), lut1, vsubq_u8(v.val[i], vdupq_n_u8(64)));
+            err = vorrq_u8(err, v.val[i]);
+        }
+        if ((vmaxvq_u8(err) & 0xC0) != 0) {
+            break; /* left to the portable code */
+        }
+
+        res.val[0] = vorrq_u8(vshlq_n_u8(v.val[0], 2), vshrq_n_u8(v.val[1], 4));
+        res.val[1] = vorrq_u8(vshlq_n_u8(v.val[1], 4), vshrq_n_u8(v.val[2], 2));
+        res.val[2] = vorrq_u8(vshlq_n_u8(v.val[2], 6), v.val[3]);
+
+        vst3q_u8(out + 3*n, res);
+        n += 16;
+    }
+
+    return n;
+}
+
+#else
+
+static int encode_blocks_simd(const uint8_t * in, int blocks, char * out) {
+    (void)in; (void)blocks; (void)out;
+    return 0;
+}
+
+static int decode_blocks_simd(const char * in, int blocks, uint8_t * out) {
+    (void)in; (void)blocks; (void)out;
+    return 0;
+}
+
+#endif
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
+int b64_set_simd(int enable) {
+    if (enable == 0) {
+        simd_mode = 0;
+    } else {
+        simd_mode = -1; /* probe again */
+    }
+    return (simd_enabled() ? 1 : 0);
+}
+
 int bin_to_b64_nopad(const uint8_t * in, int size, char * out, int max_len) {
     int i;
     int result_len; /* size of the result */
@@ -136,15 +377,16 @@ int bin_to_b64_nopad(const uint8_t * in, int size, char * out, int max_len) {
         return -1;
     }
 
-    /* process all the full blocks */
-    for (i=0; i < full_blocks; ++i) {
+    /* process all the full blocks, vectorized first */
+    i = (simd_enabled() ? encode_blocks_simd(in, full_blocks, out) : 0);
+    for (; i < full_blocks; ++i) {
         b  = (0xFF & in[3*i]    ) << 16;
         b |= (0xFF & in[3*i + 1]) << 8;
         b |=  0xFF & in[3*i + 2];
-        out[4*i + 0] = code_to_char((b >> 18) & 0x3F);
-        out[4*i + 1] = code_to_char((b >> 12) & 0x3F);
-        out[4*i + 2] = code_to_char((b >> 6 ) & 0x3F);
-        out[4*i + 3] = code_to_char( b        & 0x3F);
+        out[4*i + 0] = b64_enc[(b >> 18) & 0x3F];
+        out[4*i + 1] = b64_enc[(b >> 12) & 0x3F];
+        out[4*i + 2] = b64_enc[(b >> 6 ) & 0x3F];
+        out[4*i + 3] = b64_enc[ b        & 0x3F];
     }
 
     /* process the last 'partial' block and terminate string */
@@ -213,12 +455,13 @@ int b64_to_bin_nopad(const char * in, int size, uint8_t * out, int max_len) {
         return -1;
     }
 
-    /* process all the full blocks */
-    for (i=0; i < full_blocks; ++i) {
-        b  = (0x3F & char_to_code(in[4*i]    )) << 18;
-        b |= (0x3F & char_to_code(in[4*i + 1])) << 12;
-        b |= (0x3F & char_to_code(in[4*i + 2])) << 6;
-        b |=  0x3F & char_to_code(in[4*i + 3]);
+    /* process all the full blocks, vectorized first */
+    i = (simd_enabled() ? decode_blocks_simd(in, full_blocks, out) : 0);
+    for (; i < full_blocks; ++i) {
+        b  = (0x3F & decode_char(in[4*i]    )) << 18;
+        b |= (0x3F & decode_char(in[4*i + 1])) << 12;
+        b |= (0x3F & decode_char(in[4*i + 2])) << 6;
+        b |=  0x3F & decode_char(in[4*i + 3]);
         out[3*i + 0] = (b >> 16) & 0xFF;
         out[3*i + 1] = (b >> 8 ) & 0xFF;
         out[3*i + 2] =  b        & 0xFF;
@@ -0,0 +1,87 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : class B beacon frames, prepared ahead of their period
+    from a template holding the gateway specific part
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_BEACON_H
+#define _LORA_PKTFWD_BEACON_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define BEACON_CACHE_NB     4   /* beacon periods prepared ahead, at least the beacons kept in the JiT queue */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct beacon_frame_s
+@brief Fields of a beacon depending on its period
+*/
+struct beacon_frame_s {
+    uint32_t    gps_sec;    /* GPS time of the beacon, 0 if not prepared */
+    uint32_t    freq_hz;
+    uint8_t     field[6];   /* time and CRC of the network common part (little endian) */
+};
+
+/**
+@struct beacon_cache_s
+@brief Beacon template and frames of the next periods
+*/
+struct beacon_cache_s {
+    struct lgw_pkt_tx_s     tmpl;       /* modulation, size and gateway specific part */
+    uint8_t                 time_idx;   /* offset of the time field, after the RFU bytes */
+    uint16_t                crc_rfu;    /* network common part CRC over the RFU bytes */
+    uint32_t                period;
+    uint32_t                freq_hz;
+    uint32_t                freq_step;
+    uint8_t                 freq_nb;
+    struct beacon_frame_s   frame[BEACON_CACHE_NB]; /* indexed by period number */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Update a beacon CRC (CCITT polynomial 0x1021, initial value 0)
+@param crc[in] CRC of the previous bytes, 0 for the first ones
+@return CRC of the previous bytes followed by data
+*/
+uint16_t beacon_crc16(uint16_t crc, const uint8_t *data, unsigned size);
+
+/**
+@brief Initialize the cache from a beacon template
+@param tmpl[in] Beacon packet with all fields set but its time, CRC of the network common part, frequency and count_us
+@param rfu1_size[in] Number of RFU bytes before the time field
+@param period[in] Beacon period in seconds, not null
+@param freq_nb[in] Number of beacon channels, freq_step apart from freq_hz
+*/
+void beacon_cache_init(struct beacon_cache_s *c, const struct lgw_pkt_tx_s *tmpl, uint8_t rfu1_size, uint32_t period, uint32_t freq_hz, uint32_t freq_step, uint8_t freq_nb);
+
+/**
+@brief Get the beacon of a period, and prepare the beacons of the next ones
+@param gps_sec[in] GPS time of the beacon
+@param pkt[out] Beacon packet, count_us to be set by the caller
+*/
+void beacon_cache_get(struct beacon_cache_s *c, uint32_t gps_sec, struct lgw_pkt_tx_s *pkt);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,115 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : compact binary encoding of the UDP protocol payloads
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_BINPROTO_H
+#define _LORA_PKTFWD_BINPROTO_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <time.h>       /* timespec */
+
+#include "loragw_hal.h"
+#include "jitqueue.h"
+#include "txpk.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define PROTOCOL_VERSION_BIN    3   /* protocol version byte announcing binary payloads, see PROTOCOL.md */
+
+#define BIN_TAG_RXPK            0x01
+#define BIN_TAG_STAT            0x02
+#define BIN_TAG_TXPK            0x03
+#define BIN_TAG_TXPK_ACK        0x04
+
+#define BIN_RECORD_HDR_SIZE     3   /* tag + 16-bit length */
+#define BIN_RXPK_META_SIZE      49  /* rxpk record value, without payload */
+#define BIN_STAT_SIZE           45  /* stat record value */
+#define BIN_TXPK_META_SIZE      33  /* txpk record value, without payload */
+#define BIN_TXPK_ACK_SIZE       5   /* txpk_ack record value */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct bin_stat_s
+@brief Gateway status, as carried by the stat record
+*/
+struct bin_stat_s {
+    bool        coord_ok;       /* coordinates are valid */
+    time_t      time;           /* UTC 'system' time of the gateway */
+    double      lati;           /* GPS latitude of the gateway in degree */
+    double      lon;            /* GPS longitude of the gateway in degree */
+    int32_t     alti;           /* GPS altitude of the gateway in meter */
+    uint32_t    rxnb;           /* number of radio packets received */
+    uint32_t    rxok;           /* number of radio packets received with a valid PHY CRC */
+    uint32_t    rxfw;           /* number of radio packets forwarded */
+    float       ackr;           /* percentage of upstream datagrams that were acknowledged */
+    uint32_t    dwnb;           /* number of downlink datagrams received */
+    uint32_t    txnb;           /* number of packets emitted */
+    float       temp;           /* concentrator temperature in degree celcius */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Encode a received packet as a binary rxpk record
+
+@param p[in] Received packet, with its metadata
+@param utc[in] Packet RX time in UTC, NULL if not available
+@param gps_ms[in] Packet RX time in milliseconds since GPS epoch, NULL if not available
+@param dest[out] Buffer where the record is written
+@param size[in] Space available in dest
+@return number of bytes written, -1 if the packet metadata is invalid or if dest is too small
+*/
+int bin_rxpk_write(const struct lgw_pkt_rx_s *p, const struct timespec *utc, const uint64_t *gps_ms, uint8_t *dest, int size);
+
+/**
+@brief Encode the gateway status as a binary stat record
+
+@param stat[in] Gateway status
+@param dest[out] Buffer where the record is written
+@param size[in] Space available in dest
+@return number of bytes written, -1 if dest is too small
+*/
+int bin_stat_write(const struct bin_stat_s *stat, uint8_t *dest, int size);
+
+/**
+@brief Encode a downlink feedback as a binary txpk_ack record
+
+@param error[in] Error or warning raised for the downlink request, must not be JIT_ERROR_OK
+@param value[in] Details about the error or warning (actual TX power for JIT_ERROR_TX_POWER, lead time left in us for JIT_ERROR_TOO_LATE)
+@param dest[out] Buffer where the record is written
+@param size[in] Space available in dest
+@return number of bytes written, -1 if dest is too small
+*/
+int bin_txpk_ack_write(enum jit_error_e error, int32_t value, uint8_t *dest, int size);
+
+/**
+@brief Decode the binary payload of a PULL_RESP datagram
+
+@param src[in] Datagram payload, after the 4-byte header
+@param size[in] Size of the payload
+@param txpk[out] Decoded downlink request
+@return 0 if a complete downlink request was found, -1 otherwise (reason printed on console)
+*/
+int bin_txpk_parse(const uint8_t *src, int size, struct txpk_s *txpk);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
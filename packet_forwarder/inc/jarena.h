@@ -0,0 +1,99 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : bump allocator serving the JSON parser allocations,
+    reset after each configuration file or downlink datagram parsed
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_JARENA_H
+#define _LORA_PKTFWD_JARENA_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stddef.h>     /* size_t */
+
+#include "config.h"     /* library configuration options (dynamically generated) */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#if LOW_MEMORY == 1
+#define JARENA_CONF_SIZE    49152   /* parse tree of the configuration file, single board */
+#define JARENA_DOWN_SIZE    8192    /* parse tree of a PULL_RESP datagram */
+#else
+#define JARENA_CONF_SIZE    131072  /* parse tree of the configuration file */
+#define JARENA_DOWN_SIZE    16384   /* parse tree of a PULL_RESP datagram */
+#endif
+
+#define JARENA_ALIGN        8       /* alignment of every allocation */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct jarena_s
+@brief Memory block allocated once, handed out by increasing addresses
+*/
+struct jarena_s {
+    uint8_t *   buff;       /* memory block */
+    size_t      size;       /* size of the memory block */
+    size_t      used;       /* bytes handed out since the last reset */
+    size_t      last;       /* offset of the latest allocation, can be given back */
+    size_t      peak;       /* max bytes used at once since the arena creation */
+    uint32_t    nb_heap;    /* allocations served by the heap because the arena was full */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Route the parson allocations to the arena of the calling thread
+Must be called once, before any other parson function. Threads without an
+arena in use keep allocating from the heap.
+*/
+void jarena_setup(void);
+
+/**
+@brief Allocate the memory block of an arena
+@param a[out] Arena to initialize
+@param size[in] Size of the memory block
+@return 0 on success, -1 on error
+*/
+int jarena_init(struct jarena_s *a, size_t size);
+
+/**
+@brief Free the memory block of an arena, which must not be in use
+*/
+void jarena_free(struct jarena_s *a);
+
+/**
+@brief Serve the parson allocations of the calling thread from an arena
+*/
+void jarena_begin(struct jarena_s *a);
+
+/**
+@brief Stop using an arena and reset it
+All the JSON values parsed since jarena_begin must have been freed.
+*/
+void jarena_end(struct jarena_s *a);
+
+/**
+@brief Get the usage counters of an arena, can be called from any thread
+@param peak[out] Max bytes used at once (NULL to ignore)
+@param nb_heap[out] Allocations that did not fit in the arena (NULL to ignore)
+*/
+void jarena_stats(const struct jarena_s *a, size_t *peak, uint32_t *nb_heap);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -28,9 +28,22 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC CONSTANTS ----------------------------------------------------- */
 
-#define JIT_QUEUE_MAX           32  /* Maximum number of packets to be stored in JiT queue */
+#ifndef JIT_QUEUE_MAX
+#if LOW_MEMORY == 1
+#define JIT_QUEUE_MAX           64  /* Maximum number of packets to be stored in JiT queue (class B/C multicast bursts) */
+#else
+#define JIT_QUEUE_MAX           512 /* Maximum number of packets to be stored in JiT queue (class B/C multicast bursts) */
+#endif
+#endif
 #define JIT_NUM_BEACON_IN_QUEUE 3   /* Number of beacons to be loaded in JiT queue at any time */
 
+#define TX_START_DELAY          1500    /* microseconds */
+                                        /* TODO: get this value from HAL? */
+#define TX_MARGIN_DELAY         1000    /* Packet overlap margin in microseconds */
+                                        /* TODO: How much margin should we take? */
+#define TX_JIT_DELAY            30000   /* Pre-delay to program packet for TX in microseconds */
+#define JIT_MIN_LEAD_TIME       (TX_START_DELAY + TX_MARGIN_DELAY + TX_JIT_DELAY) /* a packet due sooner is TOO_LATE to be queued */
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC TYPES --------------------------------------------------------- */
 
@@ -66,9 +79,12 @@ struct jit_node_s {
 };
 
 struct jit_queue_s {
-    uint8_t num_pkt;                /* Total number of packets in the queue (downlinks, beacons...) */
-    uint8_t num_beacon;             /* Number of beacons in the queue */
-    struct jit_node_s nodes[JIT_QUEUE_MAX]; /* Nodes/packets array in the queue */
+    uint16_t num_pkt;               /* Total number of packets in the queue (downlinks, beacons...) */
+    uint16_t num_beacon;            /* Number of beacons in the queue */
+    uint32_t max_pre_delay;         /* Upper bound of the pre_delay of queued nodes, limits the collision search */
+    uint32_t max_post_delay;        /* Upper bound of the post_delay of queued nodes, limits the collision search */
+    uint16_t order[JIT_QUEUE_MAX];  /* Node indexes: [0, num_pkt[ in ascending order of packet timestamp, then free nodes */
+    struct jit_node_s nodes[JIT_QUEUE_MAX]; /* Nodes/packets array in the queue, never moved once enqueued */
 };
 
 /* -------------------------------------------------------------------------- */
@@ -118,7 +134,7 @@ enum jit_error_e jit_enqueue(struct jit_queue_s *queue, uint32_t time_us, struct
 @brief Dequeue a packet from a Just-in-Time queue
 
 @param queue[in/out] Just in Time queue from which the packet should be removed
-@param index[in] in the queue where to get the packet to be removed
+@param index[in] in the queue where to get the packet to be removed (position in ascending order of timestamp)
 @param packet[out] that was at index
 @param pkt_type[out] Type of packet dequeued: Downlink, Beacon
 @return success if the function was able to dequeue the packet
@@ -142,6 +158,32 @@ enough the current concentrator time.
 */
 enum jit_error_e jit_peek(struct jit_queue_s *queue, uint32_t time_us, int *pkt_idx);
 
+/**
+@brief Get the time left before a packet of the JiT queue is due for peeking.
+
+@param queue[in] Just in Time queue to parse
+@param time_us[in] Current concentrator time
+@param delay_us[out] Number of microseconds before jit_peek will return a packet (0 if it already does)
+@return success if the function was able to parse the queue, JIT_ERROR_EMPTY if there is nothing queued.
+
+This function is typically used by the JiT thread to sleep until the next deadline instead of
+polling the queue at a fixed rate.
+*/
+enum jit_error_e jit_next_due(struct jit_queue_s *queue, uint32_t time_us, uint32_t *delay_us);
+
+/**
+@brief Get a copy of the packet at the head of the JiT queue, without dequeuing it.
+
+@param queue[in] Just in Time queue to parse
+@param packet[out] Packet to be sent first
+@param pkt_type[out] Type of that packet
+@return success if a packet was copied, JIT_ERROR_EMPTY if there is nothing queued.
+
+This function is typically used by the JiT thread to program a packet in the concentrator
+before it is due, the packet being dequeued later by jit_peek and jit_dequeue.
+*/
+enum jit_error_e jit_head(struct jit_queue_s *queue, struct lgw_pkt_tx_s *packet, enum jit_pkt_type_e *pkt_type);
+
 /**
 @brief Debug function to print the queue's content on console
 
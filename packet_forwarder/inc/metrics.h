@@ -0,0 +1,111 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : HTTP listener serving the forwarder counters in the
+    Prometheus text exposition format
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_METRICS_H
+#define _LORA_PKTFWD_METRICS_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <stddef.h>     /* size_t */
+
+#include "config.h"     /* LOW_MEMORY */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#if LOW_MEMORY == 1
+#define METRICS_BUFF_SIZE   32768   /* largest response, HTTP header included */
+#else
+#define METRICS_BUFF_SIZE   65536   /* largest response, HTTP header included */
+#endif
+#define METRICS_REQ_SIZE    1024    /* request line and headers, the rest is ignored */
+#define METRICS_TIMEOUT_MS  1000    /* to receive the request and send the response */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct metrics_s
+@brief Listening socket and response being rendered, owned by a single thread
+*/
+struct metrics_s {
+    int         sock;       /* listening TCP socket, -1 if closed */
+    char *      buff;       /* response */
+    size_t      len;        /* number of bytes rendered in buff */
+    bool        truncated;  /* some lines did not fit in buff */
+};
+
+/**
+@brief Render the metrics in m with the metrics_* functions below
+*/
+typedef void (*metrics_render_t)(struct metrics_s *m);
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Open the listening socket and allocate the response buffer
+@param address[in] Local address to listen on, host name or numeric
+@param port[in] TCP port to listen on
+@return 0 on success, -1 on error
+*/
+int metrics_init(struct metrics_s *m, const char *address, const char *port);
+
+/**
+@brief Close the listening socket and free the response buffer
+*/
+void metrics_free(struct metrics_s *m);
+
+/**
+@brief Wait for a connection and answer one request, rendering the metrics on GET /metrics
+@param timeout_ms[in] Maximum time waiting for a connection
+@param render[in] Called to fill the response
+@return 1 if a request was answered, 0 on timeout, -1 on error
+*/
+int metrics_serve(struct metrics_s *m, int timeout_ms, metrics_render_t render);
+
+/**
+@brief Start a metric family with its HELP and TYPE lines
+@param type[in] "counter", "gauge" or "histogram"
+*/
+void metrics_family(struct metrics_s *m, const char *name, const char *type, const char *help);
+
+/**
+@brief One sample of an integer metric
+@param labels[in] Labels without braces (eg. "board=\"0\""), NULL for none
+*/
+void metrics_uint(struct metrics_s *m, const char *name, const char *labels, uint64_t value);
+
+/**
+@brief One sample of a real metric
+@param labels[in] Labels without braces, NULL for none
+*/
+void metrics_real(struct metrics_s *m, const char *name, const char *labels, double value);
+
+/**
+@brief Cumulative buckets, sum and count of a histogram, bins of nb_bins-1 upper bounds and an open last bin
+@param labels[in] Labels without braces, NULL for none
+@param bins_us[in] Upper bound of each bin but the last one, in microseconds, exported in seconds
+@param hist[in] Number of samples in each bin
+@param sum_us[in] Sum of the samples, in microseconds, exported in seconds
+*/
+void metrics_hist(struct metrics_s *m, const char *name, const char *labels, const int32_t *bins_us, const uint32_t *hist, int nb_bins, int64_t sum_us);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,100 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : NetID/DevAddr prefix filter of the uplink packets, to
+    forward only the traffic of the wanted networks
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_NETFILT_H
+#define _LORA_PKTFWD_NETFILT_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define NETFILT_PREFIX_MAX  64      /* NetID and DevAddr prefixes in the list */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct netfilt_range_s
+@brief DevAddr range covered by a prefix, bounds included
+*/
+struct netfilt_range_s {
+    uint32_t    first;
+    uint32_t    last;
+};
+
+/**
+@struct netfilt_s
+@brief Prefixes to be forwarded (allow) or dropped (deny), as sorted disjoint
+DevAddr ranges behind a bitmap of the DevAddr MSB they cover
+*/
+struct netfilt_s {
+    bool        enabled;            /* a list was configured */
+    bool        allow;              /* forward only the listed prefixes, drop them otherwise */
+    uint32_t    msb[256 / 32];      /* DevAddr MSB covered, at least partly, by a range */
+    int         nb;                 /* number of ranges */
+    struct netfilt_range_s range[NETFILT_PREFIX_MAX];
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Empty the list, every packet is forwarded
+@param allow[in] Forward only the prefixes to be added, drop them otherwise
+*/
+void netfilt_init(struct netfilt_s *f, bool allow);
+
+/**
+@brief Add the DevAddr prefix of a LoRaWAN NetID (type and NwkID) to the list
+@param netid[in] 24-bit NetID
+@return 0 on success, -1 if the list is full or the NetID invalid
+*/
+int netfilt_add_netid(struct netfilt_s *f, uint32_t netid);
+
+/**
+@brief Add a DevAddr prefix to the list
+@param devaddr[in] DevAddr, only its len most significant bits are used
+@param len[in] Prefix length in bits, from 1 to 32
+@return 0 on success, -1 if the list is full or the length invalid
+*/
+int netfilt_add_prefix(struct netfilt_s *f, uint32_t devaddr, int len);
+
+/**
+@brief Sort and merge the prefixes added, to be called before netfilt_forward
+*/
+void netfilt_build(struct netfilt_s *f);
+
+/**
+@brief Check if a DevAddr is covered by one of the prefixes
+*/
+bool netfilt_match(const struct netfilt_s *f, uint32_t devaddr);
+
+/**
+@brief Check if a received packet has to be forwarded
+@param p[in] Received packet, only LoRaWAN data frames with a valid CRC are filtered
+@return true if the packet has to be forwarded
+*/
+bool netfilt_forward(const struct netfilt_s *f, const struct lgw_pkt_rx_s *p);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,155 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : queue of PUSH_DATA datagrams between the packet fetch
+    and the network send, and tracking of their acknowledges
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_PUSHQ_H
+#define _LORA_PKTFWD_PUSHQ_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <time.h>       /* timespec */
+#include <pthread.h>    /* mutex */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define PUSHQ_SIZE          4   /* datagrams waiting to be sent */
+#define PUSHQ_INFLIGHT_MAX  32  /* datagrams sent and waiting for their PUSH_ACK */
+#define PUSHQ_BATCH_MAX     8   /* max datagrams per sendmmsg/recvmmsg call */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct pushq_dgram_s
+@brief Serialized PUSH_DATA datagram
+*/
+struct pushq_dgram_s {
+    uint8_t *   buff;   /* datagram, header included */
+    int         size;   /* number of bytes in buff */
+};
+
+/**
+@struct pushq_s
+@brief Bounded queue of datagrams, one producer and one consumer
+*/
+struct pushq_s {
+    pthread_mutex_t         mx;         /* protects head and count */
+    int                     wake_fd;    /* eventfd, readable when datagrams have been committed */
+    unsigned                buff_size;  /* size of each datagram buffer */
+    unsigned                head;       /* oldest datagram */
+    unsigned                count;      /* number of committed datagrams */
+    struct pushq_dgram_s    dgram[PUSHQ_SIZE];
+};
+
+/**
+@struct pushq_track_s
+@brief PUSH_DATA tokens waiting for their PUSH_ACK, oldest first
+*/
+struct pushq_track_s {
+    unsigned    nb;
+    struct {
+        uint16_t        token;
+        struct timespec sent;
+    } entry[PUSHQ_INFLIGHT_MAX];
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Allocate the datagram buffers and the wake-up event of a queue
+@param q[out] Queue to initialize
+@param buff_size[in] Size of each datagram buffer
+@return 0 on success, -1 on error
+*/
+int pushq_init(struct pushq_s *q, unsigned buff_size);
+
+/**
+@brief Free the resources of a queue
+*/
+void pushq_free(struct pushq_s *q);
+
+/**
+@brief Get the buffer where the producer composes the next datagram
+@return pointer to a buffer of buff_size bytes, NULL if the queue is full
+*/
+uint8_t * pushq_reserve(struct pushq_s *q);
+
+/**
+@brief Publish the datagram composed in the reserved buffer and wake the consumer
+@param size[in] Number of bytes written in the buffer
+*/
+void pushq_commit(struct pushq_s *q, int size);
+
+/**
+@brief Get the datagrams ready to be sent, in order, and clear the wake-up event
+@param dgram[out] Pointers on the queued datagrams, valid until pushq_release
+@param max[in] Maximum number of datagrams returned
+@return number of datagrams returned
+*/
+int pushq_front(struct pushq_s *q, struct pushq_dgram_s **dgram, int max);
+
+/**
+@brief Give back to the producer the n oldest datagrams
+*/
+void pushq_release(struct pushq_s *q, int n);
+
+/**
+@brief Send several datagrams on a connected socket in as few system calls as possible
+@return number of datagrams sent, -1 on error (errno set)
+*/
+int pushq_send(int sock, struct pushq_dgram_s * const *dgram, int n);
+
+/**
+@brief Receive the datagrams waiting on a socket without blocking
+@param buff[out] n consecutive buffers of size bytes
+@param size[in] Size of each buffer, longer datagrams are truncated
+@param len[out] Length of each datagram received
+@param n[in] Maximum number of datagrams received
+@return number of datagrams received, 0 if none, -1 on error (errno set)
+*/
+int pushq_recv(int sock, uint8_t *buff, int size, int *len, int n);
+
+/**
+@brief Start tracking the acknowledge of a datagram
+@return true if the oldest pending datagram had to be forgotten to make room
+*/
+bool pushq_track_add(struct pushq_track_s *t, uint16_t token, const struct timespec *now);
+
+/**
+@brief Match an acknowledge token with a pending datagram and stop tracking it
+@param rtt_ms[out] Round-trip time of the acknowledged datagram
+@return true if the token was pending
+*/
+bool pushq_track_ack(struct pushq_track_s *t, uint16_t token, const struct timespec *now, int *rtt_ms);
+
+/**
+@brief Forget the datagrams sent more than timeout_ms ago
+@return number of datagrams forgotten
+*/
+unsigned pushq_track_expire(struct pushq_track_s *t, const struct timespec *now, unsigned timeout_ms);
+
+/**
+@brief Time left before the oldest pending datagram expires
+@return delay in ms, -1 if nothing is pending
+*/
+int pushq_track_next(const struct pushq_track_s *t, const struct timespec *now, unsigned timeout_ms);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,130 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : CPU affinity, real-time priority and memory locking of
+    the forwarder threads, and scheduling latency they observe
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_RTSCHED_H
+#define _LORA_PKTFWD_RTSCHED_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <time.h>       /* timespec */
+#include <pthread.h>    /* pthread_t */
+
+#include "config.h"     /* library configuration options (dynamically generated) */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define RTSCHED_CPU_MAX     32              /* CPUs that can be selected */
+#if LOW_MEMORY == 1
+#define RTSCHED_STACK_SIZE  (128 * 1024)    /* thread stack, always set instead of the 8 MB default */
+#define RTSCHED_PREFAULT    (32 * 1024)     /* stack touched when a thread starts, memory locked */
+#else
+#define RTSCHED_STACK_SIZE  (2 * 1024 * 1024) /* thread stack once memory is locked, instead of the 8 MB default */
+#define RTSCHED_PREFAULT    (256 * 1024)    /* stack touched when a thread starts, memory locked */
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@enum rtsched_thread_e
+@brief Forwarder threads, with their configuration name
+*/
+enum rtsched_thread_e {
+    RTSCHED_FETCH,      /* "fetch" */
+    RTSCHED_UP,         /* "up" */
+    RTSCHED_UP_NET,     /* "up_net" */
+    RTSCHED_DOWN,       /* "down" */
+    RTSCHED_JIT,        /* "jit" */
+    RTSCHED_GPS,        /* "gps" */
+    RTSCHED_VALID,      /* "valid" */
+    RTSCHED_METRICS,    /* "metrics" */
+    RTSCHED_THREAD_NB
+};
+
+/**
+@struct rtsched_conf_s
+@brief Scheduling of a thread, defaults to any CPU and SCHED_OTHER
+*/
+struct rtsched_conf_s {
+    uint32_t    cpus;       /* bit i set if the thread may run on CPU i, 0 for any CPU */
+    int         priority;   /* SCHED_FIFO priority, 0 for SCHED_OTHER */
+};
+
+/**
+@struct rtsched_stats_s
+@brief Delay between the expiry of the timed waits of a thread and its wake-up
+*/
+struct rtsched_stats_s {
+    uint32_t    nb;         /* timed waits that expired */
+    uint32_t    avg_us;
+    uint32_t    max_us;
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Get the configuration name of a thread
+*/
+const char * rtsched_name(enum rtsched_thread_e thread);
+
+/**
+@brief Set the scheduling of a thread, to be called before it is created
+@return 0 on success, -1 if the configuration is invalid
+*/
+int rtsched_setconf(enum rtsched_thread_e thread, const struct rtsched_conf_s *conf);
+
+/**
+@brief Lock the current and future memory of the process in RAM, to be called
+before the threads are created so their stack size is bounded
+@return 0 on success, -1 on error
+*/
+int rtsched_lock_memory(void);
+
+/**
+@brief Create a thread with its configured CPU affinity and priority
+A scheduling that cannot be applied (eg. priority without CAP_SYS_NICE) is
+reported, the thread then runs with the default scheduling.
+@param thrid[out] Thread created
+@param fn[in] Thread function
+@return pthread_create result
+*/
+int rtsched_create(pthread_t *thrid, enum rtsched_thread_e thread, void (*fn)(void));
+
+/**
+@brief Get the time before a timed wait, see rtsched_wait_end
+*/
+void rtsched_wait_begin(struct timespec *start);
+
+/**
+@brief Account the wake-up delay of a timed wait, if it expired
+@param start[in] Time before the wait, from rtsched_wait_begin
+@param timeout_us[in] Timeout of the wait
+*/
+void rtsched_wait_end(enum rtsched_thread_e thread, const struct timespec *start, uint32_t timeout_us);
+
+/**
+@brief Get the scheduling latency of a thread
+@param reset[in] Clear it once copied
+*/
+void rtsched_get_stats(enum rtsched_thread_e thread, struct rtsched_stats_s *stats, bool reset);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
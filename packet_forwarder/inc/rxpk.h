@@ -0,0 +1,54 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : uplink packets serialization
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_RXPK_H
+#define _LORA_PKTFWD_RXPK_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <time.h>       /* timespec */
+
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define PROTOCOL_JSON_RXPK_FRAME_FORMAT 1
+
+#define RXPK_JSON_META_MAX      392 /* Upper bound of a JSON rxpk object length, without base64 payload */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Serialize a received packet as a JSON rxpk object, without using the C library formatters.
+
+@param p[in] Received packet, with its metadata
+@param utc[in] Packet RX time in UTC ("time" field), NULL if not available
+@param gps_ms[in] Packet RX time in milliseconds since GPS epoch ("tmms" field), NULL if not available
+@param board[in] Concentrator board that received the packet ("brd" field), -1 for a single board gateway
+@param dest[out] Buffer where the object is written, not null-terminated
+@param size[in] Space available in dest
+@return number of chars written, -1 if the packet metadata is invalid or if dest is too small
+
+The output is identical to the printf-based formatting described in PROTOCOL.md, with integer
+fixed-point conversions for frequency, RSSI and SNR.
+*/
+int rxpk_json_write(const struct lgw_pkt_rx_s *p, const struct timespec *utc, const uint64_t *gps_ms, int board, char *dest, int size);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,105 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : lock-free ring of received packets between the fetch
+    thread (single producer) and the upstream thread (single consumer)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_RXRING_H
+#define _LORA_PKTFWD_RXRING_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#ifndef RXRING_SIZE
+#if LOW_MEMORY == 1
+#define RXRING_SIZE         64  /* must be a power of 2 */
+#else
+#define RXRING_SIZE         512 /* must be a power of 2 */
+#endif
+#endif
+
+#define RXRING_CACHE_LINE   64
+
+#define RXRING_WAIT_MAX     LGW_BOARD_NB /* rings waited for together */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct rxring_s
+@brief Free-running indexes, each written by one side only, on separate cache lines
+*/
+struct rxring_s {
+    unsigned    head __attribute__((aligned(RXRING_CACHE_LINE)));   /* next packet to consume, written by the consumer */
+    unsigned    tail __attribute__((aligned(RXRING_CACHE_LINE)));   /* next slot to fill, written by the producer */
+    int         wake_fd __attribute__((aligned(RXRING_CACHE_LINE))); /* eventfd, readable when packets were pushed */
+    struct lgw_pkt_rx_s pkt[RXRING_SIZE];
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Empty the ring and create its wake-up event
+@return 0 on success, -1 on error
+*/
+int rxring_init(struct rxring_s *r);
+
+/**
+@brief Producer: get the number of packets that can be pushed
+*/
+unsigned rxring_space(struct rxring_s *r);
+
+/**
+@brief Producer: copy n packets in the ring, and wake the consumer
+@param pkt[in] Packets as returned by lgw_receive
+@param n[in] Number of packets, must not exceed rxring_space
+*/
+void rxring_push(struct rxring_s *r, const struct lgw_pkt_rx_s *pkt, unsigned n);
+
+/**
+@brief Consumer: get the contiguous packets ready to be processed
+@param pkt[out] Oldest packet
+@return number of contiguous packets, 0 if the ring is empty
+*/
+unsigned rxring_peek(struct rxring_s *r, struct lgw_pkt_rx_s **pkt);
+
+/**
+@brief Consumer: give the n oldest slots back to the producer
+*/
+void rxring_pop(struct rxring_s *r, unsigned n);
+
+/**
+@brief Consumer: wait for the producer to push packets
+@param timeout_ms[in] Maximum time to wait
+@return 1 if packets may be available, 0 on timeout
+*/
+int rxring_wait(struct rxring_s *r, int timeout_ms);
+
+/**
+@brief Consumer: wait for the producer of any of several rings to push packets
+@param r[in] Array of nb rings, at most RXRING_WAIT_MAX
+@param timeout_ms[in] Maximum time to wait
+@return 1 if packets may be available in one of the rings, 0 on timeout
+*/
+int rxring_wait_any(struct rxring_s *r, unsigned nb, int timeout_ms);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,75 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : lock-free publication of the GPS time reference, from
+    the GPS thread (single writer) to the threads converting timestamps
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_TIMEREF_H
+#define _LORA_PKTFWD_TIMEREF_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdbool.h>    /* bool type */
+#include <time.h>       /* timespec */
+
+#include "loragw_gps.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define TIMEREF_CACHE_LINE  64
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct timeref_s
+@brief Sequence lock on the reference, odd while the writer updates it, and
+validity flag set by the thread monitoring the reference age
+*/
+struct timeref_s {
+    unsigned    seq __attribute__((aligned(TIMEREF_CACHE_LINE)));
+    struct tref ref;
+    bool        valid __attribute__((aligned(TIMEREF_CACHE_LINE)));
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Clear the reference, and mark it invalid
+*/
+void timeref_init(struct timeref_s *t);
+
+/**
+@brief Writer: publish a new reference, never blocks
+@param ref[in] Reference updated by lgw_gps_sync
+*/
+void timeref_publish(struct timeref_s *t, const struct tref *ref);
+
+/**
+@brief Mark the reference valid or not (eg. when too old)
+*/
+void timeref_set_valid(struct timeref_s *t, bool valid);
+
+/**
+@brief Reader: get a consistent copy of the reference, retrying while it is
+being published
+@param ref[out] Latest reference published
+@return true if the reference is valid
+*/
+bool timeref_get(const struct timeref_s *t, struct tref *ref);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
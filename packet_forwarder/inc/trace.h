@@ -22,6 +22,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define DEBUG_TIMERSYNC 0
 #define DEBUG_BEACON    0
 #define DEBUG_LOG       1
+#define DEBUG_UPTRACE   0
 
 #define MSG(args...) printf(args) /* message that is destined to the user */
 #define MSG_DEBUG(FLAG, fmt, ...)                                                                         \
@@ -0,0 +1,76 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : downlink requests parsing
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_TXPK_H
+#define _LORA_PKTFWD_TXPK_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct txpk_s
+@brief Downlink request as sent by the server, before it is adapted to the gateway
+*/
+struct txpk_s {
+    struct lgw_pkt_tx_s pkt;    /* decoded packet, count_us only set if tmst_ok, rf_power and preamble left to 0 */
+    bool        imme;           /* send immediately (class C) */
+    bool        tmst_ok;        /* pkt.count_us is valid (class A) */
+    bool        tmms_ok;        /* tmms is valid (class B) */
+    uint64_t    tmms;           /* GPS time of emission, in milliseconds since GPS epoch */
+    bool        powe_ok;        /* powe is valid */
+    int8_t      powe;           /* requested TX power in dBm, antenna gain not removed */
+    bool        prea_ok;        /* prea is valid */
+    int         prea;           /* requested preamble length, not checked against minimum */
+    uint8_t     brd;            /* concentrator board, 0 if not given, not checked against the boards configured */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Parse the JSON payload of a PULL_RESP datagram
+
+@param json[in] Null-terminated JSON string containing a "txpk" object
+@param txpk[out] Decoded downlink request
+@return 0 if a complete downlink request was found, -1 otherwise (reason printed on console)
+
+Documents made only of the fields listed in PROTOCOL.md, with simple values and
+unescaped strings, are decoded in a single pass without memory allocation. Any
+other document, or invalid request, is handed to parson.
+*/
+int txpk_json_parse(const char *json, struct txpk_s *txpk);
+
+/**
+@brief Parse the JSON payload of a PULL_RESP datagram with parson only
+
+@param json[in] Null-terminated JSON string containing a "txpk" object
+@param txpk[out] Decoded downlink request
+@return 0 if a complete downlink request was found, -1 otherwise (reason printed on console)
+
+Reference decoding of txpk_json_parse, used for the documents the single-pass
+decoder does not handle, and by tst/test_txpk to check that both agree.
+*/
+int txpk_json_parse_parson(const char *json, struct txpk_s *txpk);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,186 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : optional per-packet latency tracing of the uplink path,
+    from the packet timestamp to the PUSH_DATA datagram being sent
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_UPTRACE_H
+#define _LORA_PKTFWD_UPTRACE_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <stdio.h>      /* FILE */
+#include <time.h>       /* timespec */
+#include <pthread.h>    /* mutex */
+
+#include "loragw_hal.h"
+#include "rxring.h"
+#include "pushq.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#if LOW_MEMORY == 1
+#define UPTRACE_SIZE        256     /* samples kept for the report, must be a power of 2 */
+#define UPTRACE_DGRAM_MAX   64      /* samples per datagram, the next ones are not traced */
+#else
+#define UPTRACE_SIZE        2048    /* samples kept for the report, must be a power of 2 */
+#define UPTRACE_DGRAM_MAX   256     /* samples per datagram, the next ones are not traced */
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@enum uptrace_stage_e
+@brief Consecutive stages of the uplink path, their sum is the total latency
+*/
+enum uptrace_stage_e {
+    UPTRACE_FETCH,      /* packet timestamp to the end of lgw_receive, parse excluded */
+    UPTRACE_PARSE,      /* lgw_receive call that returned the packet */
+    UPTRACE_RING,       /* waiting in the RX ring for the upstream thread */
+    UPTRACE_SERIAL,     /* serialization of the datagram */
+    UPTRACE_SEND,       /* waiting in the upstream queue, then sent to every server */
+    UPTRACE_TOTAL,      /* packet timestamp to datagram sent */
+    UPTRACE_STAGE_NB
+};
+
+enum uptrace_pct_e {
+    UPTRACE_P50,
+    UPTRACE_P90,
+    UPTRACE_P99,
+    UPTRACE_MAX,
+    UPTRACE_PCT_NB
+};
+
+/**
+@struct uptrace_sample_s
+@brief Timing of one packet, in microseconds
+*/
+struct uptrace_sample_s {
+    uint32_t        count_us;                   /* packet timestamp */
+    uint32_t        stage_us[UPTRACE_STAGE_NB];
+    struct timespec mark;                       /* end of the last stage measured */
+};
+
+/**
+@struct uptrace_report_s
+@brief Latency percentiles of the packets sent since the previous report
+*/
+struct uptrace_report_s {
+    unsigned    nb;                                     /* samples in the percentiles */
+    unsigned    lost;                                   /* samples overwritten before the report */
+    uint32_t    pct_us[UPTRACE_STAGE_NB][UPTRACE_PCT_NB];
+};
+
+/**
+@struct uptrace_s
+@brief Samples follow the packets: fetch thread -> upstream thread -> network thread -> report
+*/
+struct uptrace_s {
+    bool                    enabled;
+    FILE *                  dump;                       /* CSV file receiving every sample, or NULL */
+
+    /* fetch -> upstream, in the order of the RX ring, published by rxring_push */
+    struct uptrace_sample_s fetch[RXRING_SIZE];
+    unsigned                fetch_wr;                   /* written by the fetch thread */
+    unsigned                fetch_rd;                   /* written by the upstream thread */
+    struct timespec         fetch_start;
+    struct timespec         up_start;
+
+    /* datagram being composed, owned by the upstream thread */
+    struct uptrace_sample_s staged[UPTRACE_DGRAM_MAX];
+    unsigned                staged_nb;
+
+    /* upstream -> network -> report */
+    pthread_mutex_t         mx;                         /* protects the fields below */
+    struct uptrace_sample_s sample[UPTRACE_SIZE];
+    unsigned                commit;                     /* samples of committed datagrams */
+    unsigned                sent;                       /* samples of sent datagrams */
+    unsigned                report;                     /* first sample not reported yet */
+    unsigned                group[PUSHQ_SIZE];          /* samples per committed datagram, oldest first */
+    unsigned                group_head;
+    unsigned                group_nb;
+
+    /* copy of the samples to report, owned by the reporting thread */
+    struct uptrace_sample_s out[UPTRACE_SIZE];
+    uint32_t                sorted[UPTRACE_SIZE];
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Initialize the tracing, every other function does nothing if it is disabled
+@param enable[in] Trace the uplink packets
+@param dump_path[in] CSV file where the samples are appended at each report, NULL for none
+@return 0 on success, -1 on error
+*/
+int uptrace_init(struct uptrace_s *t, bool enable, const char *dump_path);
+
+/**
+@brief Close the dump file
+*/
+void uptrace_free(struct uptrace_s *t);
+
+/**
+@brief Name of a stage, as used in the report and in the dump header
+*/
+const char * uptrace_stage_name(enum uptrace_stage_e stage);
+
+/**
+@brief Fetch thread: to be called just before lgw_receive
+*/
+void uptrace_fetch_begin(struct uptrace_s *t);
+
+/**
+@brief Fetch thread: start tracing the packets returned by lgw_receive, before pushing them in the RX ring
+*/
+void uptrace_fetch_end(struct uptrace_s *t, const struct lgw_pkt_rx_s *pkt, unsigned n);
+
+/**
+@brief Upstream thread: to be called when the packets are taken from the RX ring
+*/
+void uptrace_up_begin(struct uptrace_s *t);
+
+/**
+@brief Upstream thread: packet i of the batch is serialized in the datagram
+*/
+void uptrace_up_take(struct uptrace_s *t, unsigned i);
+
+/**
+@brief Upstream thread: the n oldest packets of the RX ring are done, to be called with rxring_pop
+*/
+void uptrace_up_pop(struct uptrace_s *t, unsigned n);
+
+/**
+@brief Upstream thread: the datagram is complete, to be called just before pushq_commit
+*/
+void uptrace_up_commit(struct uptrace_s *t);
+
+/**
+@brief Network thread: the n oldest datagrams have been sent, to be called before pushq_release
+*/
+void uptrace_sent(struct uptrace_s *t, unsigned n);
+
+/**
+@brief Compute the percentiles of the samples sent since the previous call, and dump them
+@param r[out] Report, nb is 0 if no packet was sent
+*/
+void uptrace_report(struct uptrace_s *t, struct uptrace_report_s *r);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,98 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : deduplication of the uplink packets received by
+    several concentrator boards, forwarding only the best copy
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _LORA_PKTFWD_XDEDUP_H
+#define _LORA_PKTFWD_XDEDUP_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+#include <time.h>       /* timespec */
+
+#include "loragw_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#if LOW_MEMORY == 1
+#define XDEDUP_PKT_NB       8       /* packets held at once */
+#else
+#define XDEDUP_PKT_NB       64      /* packets held at once */
+#endif
+#define XDEDUP_WINDOW_US    10000   /* max RX time difference between copies of a packet */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/**
+@struct xdedup_entry_s
+@brief Best copy received so far of a packet
+*/
+struct xdedup_entry_s {
+    struct lgw_pkt_rx_s pkt;
+    int                 board;      /* concentrator board of the copy kept */
+    uint32_t            hash;       /* payload hash */
+    uint32_t            time_us;    /* RX time in the time base common to all the boards */
+    struct timespec     held;       /* first copy received, monotonic clock */
+};
+
+/**
+@struct xdedup_s
+@brief Packets held while their copies may be received by the other boards, oldest first
+*/
+struct xdedup_s {
+    unsigned    hold_ms;    /* time a packet is held after its first copy */
+    unsigned    nb;         /* packets held */
+    struct xdedup_entry_s entry[XDEDUP_PKT_NB];
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Empty the table
+@param hold_ms[in] Time a packet is held after its first copy, waiting for the copies of the other boards
+*/
+void xdedup_init(struct xdedup_s *d, unsigned hold_ms);
+
+/**
+@brief Hold a packet, or keep the best of it and its copy already held
+@param p[in] Received packet
+@param board[in] Concentrator board that received it
+@param time_us[in] RX time, in a time base common to all the boards (GPS time or a board counter)
+@param now[in] Current time, monotonic clock
+@return 0 if the packet is held, 1 if it is a copy of a packet held, -1 if the table is full
+*/
+int xdedup_add(struct xdedup_s *d, const struct lgw_pkt_rx_s *p, int board, uint32_t time_us, const struct timespec *now);
+
+/**
+@brief Take the oldest packet once its hold time has elapsed
+@param p[out] Best copy of the packet, with the best RSSI then SNR
+@param board[out] Concentrator board that received the copy
+@return true if a packet was taken
+*/
+bool xdedup_take(struct xdedup_s *d, const struct timespec *now, struct lgw_pkt_rx_s *p, int *board);
+
+/**
+@brief Get the time left before the oldest packet can be taken
+@return number of milliseconds, -1 if no packet is held
+*/
+int xdedup_next(const struct xdedup_s *d, const struct timespec *now);
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,345 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : compact binary encoding of the UDP protocol payloads
+    All multi-byte fields are little-endian, see PROTOCOL.md section 7.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>      /* printf */
+#include <string.h>     /* memset, memcpy */
+#include <math.h>       /* lround */
+
+#include "trace.h"
+#include "binproto.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS & TYPES -------------------------------------------- */
+
+#define BIN_MODU_LORA           0
+#define BIN_MODU_FSK            1
+
+/* rxpk flags */
+#define BIN_RXPK_TIME           0x01
+#define BIN_RXPK_TMMS           0x02
+
+/* stat flags */
+#define BIN_STAT_COORD          0x01
+
+/* txpk flags */
+#define BIN_TXPK_IMME           0x01
+#define BIN_TXPK_TMST           0x02
+#define BIN_TXPK_TMMS           0x04
+#define BIN_TXPK_IPOL           0x08
+#define BIN_TXPK_NCRC           0x10
+#define BIN_TXPK_POWE           0x20
+#define BIN_TXPK_PREA           0x40
+
+/* txpk_ack codes */
+#define BIN_ACK_TOO_LATE        1
+#define BIN_ACK_TOO_EARLY       2
+#define BIN_ACK_COLLISION_PACKET 3
+#define BIN_ACK_COLLISION_BEACON 4
+#define BIN_ACK_TX_FREQ         5
+#define BIN_ACK_TX_POWER        6
+#define BIN_ACK_GPS_UNLOCKED    7
+#define BIN_ACK_UNKNOWN         0xFF
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static uint8_t * put_u16(uint8_t *d, uint16_t v) {
+    d[0] = (uint8_t)v;
+    d[1] = (uint8_t)(v >> 8);
+    return d + 2;
+}
+
+static uint8_t * put_u32(uint8_t *d, uint32_t v) {
+    d[0] = (uint8_t)v;
+    d[1] = (uint8_t)(v >> 8);
+    d[2] = (uint8_t)(v >> 16);
+    d[3] = (uint8_t)(v >> 24);
+    return d + 4;
+}
+
+static uint8_t * put_u64(uint8_t *d, uint64_t v) {
+    d = put_u32(d, (uint32_t)v);
+    return put_u32(d, (uint32_t)(v >> 32));
+}
+
+static uint8_t * put_header(uint8_t *d, uint8_t tag, uint16_t len) {
+    *d++ = tag;
+    return put_u16(d, len);
+}
+
+static uint16_t get_u16(const uint8_t *s) {
+    return (uint16_t)(s[0] | (s[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *s) {
+    return (uint32_t)s[0] | ((uint32_t)s[1] << 8) | ((uint32_t)s[2] << 16) | ((uint32_t)s[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t *s) {
+    return (uint64_t)get_u32(s) | ((uint64_t)get_u32(s + 4) << 32);
+}
+
+static uint16_t bw_khz(uint8_t bandwidth) {
+    switch (bandwidth) {
+        case BW_125KHZ: return 125;
+        case BW_250KHZ: return 250;
+        case BW_500KHZ: return 500;
+        default:        return 0;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+int bin_rxpk_write(const struct lgw_pkt_rx_s *p, const struct timespec *utc, const uint64_t *gps_ms, uint8_t *dest, int size) {
+    uint8_t *d = dest;
+    uint8_t flags = 0;
+    uint8_t codr;
+    int8_t stat;
+
+    if ((p == NULL) || (dest == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    if (size < (BIN_RECORD_HDR_SIZE + BIN_RXPK_META_SIZE + p->size)) {
+        MSG("ERROR: [up] not enough space to serialize packet (%d bytes left)\n", size);
+        return -1;
+    }
+
+    switch (p->status) {
+        case STAT_CRC_OK:   stat = 1;  break;
+        case STAT_CRC_BAD:  stat = -1; break;
+        case STAT_NO_CRC:   stat = 0;  break;
+        default:
+            MSG("ERROR: [up] received packet with unknown status 0x%02X\n", p->status);
+            return -1;
+    }
+
+    if (p->modulation == MOD_LORA) {
+        if ((p->datarate < DR_LORA_SF5) || (p->datarate > DR_LORA_SF12) || (bw_khz(p->bandwidth) == 0) || (p->coderate > CR_LORA_4_8)) {
+            MSG("ERROR: [up] lora packet with unknown datarate/bandwidth/coderate\n");
+            return -1;
+        }
+        codr = (p->coderate == 0) ? 0 : (4 + p->coderate); /* 4/x denominator, 0 for CR0 (mostly false sync) */
+    } else if (p->modulation == MOD_FSK) {
+        codr = 0;
+    } else {
+        MSG("ERROR: [up] received packet with unknown modulation 0x%02X\n", p->modulation);
+        return -1;
+    }
+
+    if (utc != NULL) {
+        flags |= BIN_RXPK_TIME;
+    }
+    if (gps_ms != NULL) {
+        flags |= BIN_RXPK_TMMS;
+    }
+
+    d = put_header(d, BIN_TAG_RXPK, BIN_RXPK_META_SIZE + p->size);
+    *d++ = flags;
+    d = put_u32(d, p->count_us);
+    d = put_u64(d, (utc != NULL) ? ((uint64_t)utc->tv_sec * 1000000 + utc->tv_nsec / 1000) : 0);
+    d = put_u64(d, (gps_ms != NULL) ? *gps_ms : 0);
+    d = put_u32(d, p->freq_hz);
+    *d++ = p->if_chain;
+    *d++ = p->rf_chain;
+    *d++ = p->modem_id;
+    *d++ = (uint8_t)stat;
+    *d++ = (p->modulation == MOD_LORA) ? BIN_MODU_LORA : BIN_MODU_FSK;
+    d = put_u32(d, p->datarate);
+    d = put_u16(d, (p->modulation == MOD_LORA) ? bw_khz(p->bandwidth) : 0);
+    *d++ = codr;
+    d = put_u16(d, (uint16_t)(int16_t)lroundf(p->rssic));
+    d = put_u16(d, (uint16_t)(int16_t)lroundf(p->rssis));
+    d = put_u16(d, (uint16_t)(int16_t)lroundf(p->snr * 100)); /* centi-dB, exact for the 0.25 dB steps of the SX1302 */
+    d = put_u32(d, (uint32_t)p->freq_offset);
+    d = put_u16(d, p->size);
+    memcpy(d, p->payload, p->size);
+    d += p->size;
+
+    return (int)(d - dest);
+}
+
+int bin_stat_write(const struct bin_stat_s *stat, uint8_t *dest, int size) {
+    uint8_t *d = dest;
+
+    if ((stat == NULL) || (dest == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    if (size < (BIN_RECORD_HDR_SIZE + BIN_STAT_SIZE)) {
+        return -1;
+    }
+
+    d = put_header(d, BIN_TAG_STAT, BIN_STAT_SIZE);
+    *d++ = (stat->coord_ok == true) ? BIN_STAT_COORD : 0;
+    d = put_u64(d, (uint64_t)stat->time);
+    d = put_u32(d, (stat->coord_ok == true) ? (uint32_t)(int32_t)lround(stat->lati * 1e7) : 0); /* 1e-7 degree */
+    d = put_u32(d, (stat->coord_ok == true) ? (uint32_t)(int32_t)lround(stat->lon * 1e7) : 0);
+    d = put_u32(d, (stat->coord_ok == true) ? (uint32_t)stat->alti : 0);
+    d = put_u32(d, stat->rxnb);
+    d = put_u32(d, stat->rxok);
+    d = put_u32(d, stat->rxfw);
+    d = put_u16(d, (uint16_t)lroundf(stat->ackr * 10)); /* 0.1 % */
+    d = put_u32(d, stat->dwnb);
+    d = put_u32(d, stat->txnb);
+    d = put_u16(d, (uint16_t)(int16_t)lroundf(stat->temp * 10)); /* 0.1 degree celcius */
+
+    return (int)(d - dest);
+}
+
+int bin_txpk_ack_write(enum jit_error_e error, int32_t value, uint8_t *dest, int size) {
+    uint8_t *d = dest;
+    uint8_t code;
+
+    if (dest == NULL) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    if (size < (BIN_RECORD_HDR_SIZE + BIN_TXPK_ACK_SIZE)) {
+        return -1;
+    }
+
+    /* same mapping as the "error"/"warn" strings of the JSON txpk_ack object */
+    switch (error) {
+        case JIT_ERROR_FULL:
+        case JIT_ERROR_COLLISION_PACKET:    code = BIN_ACK_COLLISION_PACKET; break;
+        case JIT_ERROR_TOO_LATE:            code = BIN_ACK_TOO_LATE; break;
+        case JIT_ERROR_TOO_EARLY:           code = BIN_ACK_TOO_EARLY; break;
+        case JIT_ERROR_COLLISION_BEACON:    code = BIN_ACK_COLLISION_BEACON; break;
+        case JIT_ERROR_TX_FREQ:             code = BIN_ACK_TX_FREQ; break;
+        case JIT_ERROR_TX_POWER:            code = BIN_ACK_TX_POWER; break;
+        case JIT_ERROR_GPS_UNLOCKED:        code = BIN_ACK_GPS_UNLOCKED; break;
+        default:                            code = BIN_ACK_UNKNOWN; break;
+    }
+
+    d = put_header(d, BIN_TAG_TXPK_ACK, BIN_TXPK_ACK_SIZE);
+    *d++ = code;
+    d = put_u32(d, ((error == JIT_ERROR_TX_POWER) || (error == JIT_ERROR_TOO_LATE)) ? (uint32_t)value : 0);
+
+    return (int)(d - dest);
+}
+
+int bin_txpk_parse(const uint8_t *src, int size, struct txpk_s *txpk) {
+    struct lgw_pkt_tx_s *txpkt;
+    const uint8_t *s = src;
+    uint16_t len;
+    uint8_t flags;
+    uint16_t bw;
+    uint8_t codr;
+
+    if ((src == NULL) || (txpk == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    memset(txpk, 0, sizeof *txpk);
+    txpkt = &(txpk->pkt);
+
+    /* look for the txpk record */
+    if ((size < (BIN_RECORD_HDR_SIZE + BIN_TXPK_META_SIZE)) || (s[0] != BIN_TAG_TXPK)) {
+        MSG("WARNING: [down] no txpk record in binary PULL_RESP, TX aborted\n");
+        return -1;
+    }
+    len = get_u16(s + 1);
+    s += BIN_RECORD_HDR_SIZE;
+    if ((len < BIN_TXPK_META_SIZE) || (len > (size - BIN_RECORD_HDR_SIZE))) {
+        MSG("WARNING: [down] invalid txpk record length %u, TX aborted\n", len);
+        return -1;
+    }
+
+    flags = s[0];
+    if (flags & BIN_TXPK_IMME) {
+        txpk->imme = true;
+    } else if (flags & BIN_TXPK_TMST) {
+        txpkt->count_us = get_u32(s + 1);
+        txpk->tmst_ok = true;
+    } else if (flags & BIN_TXPK_TMMS) {
+        txpk->tmms = get_u64(s + 5);
+        txpk->tmms_ok = true;
+    } else {
+        MSG("WARNING: [down] no mandatory txpk tmst or tmms in binary record, TX aborted\n");
+        return -1;
+    }
+    txpkt->invert_pol = (flags & BIN_TXPK_IPOL) ? true : false;
+    txpkt->no_crc = (flags & BIN_TXPK_NCRC) ? true : false;
+    txpkt->freq_hz = get_u32(s + 13);
+    txpkt->rf_chain = s[17];
+    if (flags & BIN_TXPK_POWE) {
+        txpk->powe = (int8_t)s[18];
+        txpk->powe_ok = true;
+    }
+    txpkt->datarate = get_u32(s + 20);
+    bw = get_u16(s + 24);
+    codr = s[26];
+    if (flags & BIN_TXPK_PREA) {
+        txpk->prea = get_u16(s + 29);
+        txpk->prea_ok = true;
+    }
+
+    switch (s[19]) {
+        case BIN_MODU_LORA:
+            txpkt->modulation = MOD_LORA;
+            if ((txpkt->datarate < DR_LORA_SF5) || (txpkt->datarate > DR_LORA_SF12)) {
+                MSG("WARNING: [down] invalid SF in binary txpk record, TX aborted\n");
+                return -1;
+            }
+            switch (bw) {
+                case 125: txpkt->bandwidth = BW_125KHZ; break;
+                case 250: txpkt->bandwidth = BW_250KHZ; break;
+                case 500: txpkt->bandwidth = BW_500KHZ; break;
+                default:
+                    MSG("WARNING: [down] invalid BW in binary txpk record, TX aborted\n");
+                    return -1;
+            }
+            if ((codr < 5) || (codr > 8)) {
+                MSG("WARNING: [down] invalid coding rate in binary txpk record, TX aborted\n");
+                return -1;
+            }
+            txpkt->coderate = codr - 4; /* CR_LORA_4_5 .. CR_LORA_4_8 */
+            break;
+        case BIN_MODU_FSK:
+            txpkt->modulation = MOD_FSK;
+            txpkt->f_dev = (uint8_t)get_u16(s + 27); /* kHz */
+            break;
+        default:
+            MSG("WARNING: [down] invalid modulation in binary txpk record, TX aborted\n");
+            return -1;
+    }
+
+    txpkt->size = get_u16(s + 31);
+    if ((txpkt->size > sizeof txpkt->payload) || (txpkt->size != (len - BIN_TXPK_META_SIZE))) {
+        MSG("WARNING: [down] mismatch between txpk size and binary record length, TX aborted\n");
+        return -1;
+    }
+    memcpy(txpkt->payload, s + BIN_TXPK_META_SIZE, txpkt->size);
+
+    return 0;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
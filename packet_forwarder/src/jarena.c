@@ -0,0 +1,131 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : bump allocator serving the JSON parser allocations,
+    reset after each configuration file or downlink datagram parsed
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* malloc, free */
+#include <string.h>     /* memset */
+
+#include "trace.h"
+#include "parson.h"
+#include "jarena.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static __thread struct jarena_s *jarena_cur = NULL; /* arena of the calling thread, NULL for the heap */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void * jarena_malloc(size_t size) {
+    struct jarena_s *a = jarena_cur;
+    size_t aligned = (size + (JARENA_ALIGN - 1)) & ~(size_t)(JARENA_ALIGN - 1);
+    void *p;
+
+    if (a == NULL) {
+        return malloc(size);
+    }
+    if (aligned > (a->size - a->used)) {
+        __atomic_store_n(&a->nb_heap, a->nb_heap + 1, __ATOMIC_RELAXED);
+        return malloc(size);
+    }
+
+    p = a->buff + a->used;
+    a->last = a->used;
+    a->used += aligned;
+    if (a->used > a->peak) {
+        __atomic_store_n(&a->peak, a->used, __ATOMIC_RELAXED);
+    }
+    return p;
+}
+
+static void jarena_release(void *p) {
+    struct jarena_s *a = jarena_cur;
+
+    if ((a == NULL) || ((uint8_t *)p < a->buff) || ((uint8_t *)p >= (a->buff + a->size))) {
+        free(p);
+        return;
+    }
+
+    /* only the latest allocation can be given back, the rest waits for the reset */
+    if ((uint8_t *)p == (a->buff + a->last)) {
+        a->used = a->last;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+void jarena_setup(void) {
+    json_set_allocation_functions(jarena_malloc, jarena_release);
+}
+
+int jarena_init(struct jarena_s *a, size_t size) {
+    if (a == NULL) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    memset(a, 0, sizeof *a);
+    a->buff = malloc(size);
+    if (a->buff == NULL) {
+        MSG("ERROR: failed to allocate a JSON arena of %zu bytes\n", size);
+        return -1;
+    }
+    a->size = size;
+
+    return 0;
+}
+
+void jarena_free(struct jarena_s *a) {
+    if (a == NULL) {
+        return;
+    }
+    free(a->buff);
+    a->buff = NULL;
+    a->size = 0;
+}
+
+void jarena_begin(struct jarena_s *a) {
+    if ((a != NULL) && (a->buff == NULL)) {
+        a = NULL; /* arena could not be allocated, use the heap */
+    }
+    jarena_cur = a;
+}
+
+void jarena_end(struct jarena_s *a) {
+    jarena_cur = NULL;
+    if (a != NULL) {
+        a->used = 0;
+        a->last = 0;
+    }
+}
+
+void jarena_stats(const struct jarena_s *a, size_t *peak, uint32_t *nb_heap) {
+    if (a == NULL) {
+        return;
+    }
+    if (peak != NULL) {
+        *peak = __atomic_load_n(&a->peak, __ATOMIC_RELAXED);
+    }
+    if (nb_heap != NULL) {
+        *nb_heap = __atomic_load_n(&a->nb_heap, __ATOMIC_RELAXED);
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
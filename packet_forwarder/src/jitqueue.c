@@ -15,10 +15,8 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDANCIES --------------------------------------------------------- */
 
-#define _GNU_SOURCE     /* needed for qsort_r to be defined */
-#include <stdlib.h>     /* qsort_r */
 #include <stdio.h>      /* printf, fprintf, snprintf, fopen, fputs */
-#include <string.h>     /* memset, memcpy */
+#include <string.h>     /* memset, memcpy, memmove */
 #include <pthread.h>
 #include <assert.h>
 #include <math.h>
@@ -29,13 +27,14 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
 
+/* Node at position pos, in ascending order of packet timestamp */
+#define JIT_NODE(queue, pos)    (&((queue)->nodes[(queue)->order[pos]]))
+
+/* Ordering of two timestamps, valid as long as the queue spans less than 2^31 us (TX_MAX_ADVANCE_DELAY) */
+#define JIT_TIME_BEFORE(a, b)   ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE CONSTANTS & TYPES -------------------------------------------- */
-#define TX_START_DELAY          1500    /* microseconds */
-                                        /* TODO: get this value from HAL? */
-#define TX_MARGIN_DELAY         1000    /* Packet overlap margin in microseconds */
-                                        /* TODO: How much margin should we take? */
-#define TX_JIT_DELAY            30000   /* Pre-delay to program packet for TX in microseconds */
 #define TX_MAX_ADVANCE_DELAY    ((JIT_NUM_BEACON_IN_QUEUE + 1) * 128 * 1E6) /* Maximum advance delay accepted for a TX packet, compared to current time */
 
 #define BEACON_GUARD            3000000 /* Interval where no ping slot can be placed,
@@ -49,6 +48,118 @@ static pthread_mutex_t mx_jit_queue = PTHREAD_MUTEX_INITIALIZER; /* control acce
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
+bool jit_collision_test(uint32_t p1_count_us, uint32_t p1_pre_delay, uint32_t p1_post_delay, uint32_t p2_count_us, uint32_t p2_pre_delay, uint32_t p2_post_delay) {
+    if (((p1_count_us - p2_count_us) <= (p1_pre_delay + p2_post_delay + TX_MARGIN_DELAY)) ||
+        ((p2_count_us - p1_count_us) <= (p2_pre_delay + p1_post_delay + TX_MARGIN_DELAY))) {
+        return true;
+    } else {
+        return false;
+    }
+}
+
+static int jit_search_pos(struct jit_queue_s *queue, uint32_t count_us) {
+    /* Return the position of the first node after count_us (binary search) */
+    int lo = 0;
+    int hi = queue->num_pkt;
+    int mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (JIT_TIME_BEFORE(count_us, JIT_NODE(queue, mid)->pkt.count_us)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
+static int jit_search_collision(struct jit_queue_s *queue, uint32_t count_us, uint32_t pre_delay, uint32_t post_delay, bool ignore_beacon_guard) {
+    /* Return the position of a node colliding with the given interval, -1 if none */
+    struct jit_node_s *node;
+    uint32_t target_pre_delay;
+    int pos;
+    int i;
+
+    pos = jit_search_pos(queue, count_us);
+
+    /* Earlier nodes: only the ones whose post_delay may reach the new packet pre_delay */
+    for (i = pos - 1; i >= 0; i--) {
+        node = JIT_NODE(queue, i);
+        if ((count_us - node->pkt.count_us) > (pre_delay + queue->max_post_delay + TX_MARGIN_DELAY)) {
+            break;
+        }
+        if (jit_collision_test(count_us, pre_delay, post_delay, node->pkt.count_us, node->pre_delay, node->post_delay) == true) {
+            return i;
+        }
+    }
+
+    /* Later nodes: only the ones whose pre_delay may reach the new packet post_delay */
+    for (i = pos; i < queue->num_pkt; i++) {
+        node = JIT_NODE(queue, i);
+        if ((node->pkt.count_us - count_us) > (post_delay + queue->max_pre_delay + TX_MARGIN_DELAY)) {
+            break;
+        }
+        /* We ignore Beacon Guard for Class A/C downlinks */
+        if ((ignore_beacon_guard == true) && (node->pkt_type == JIT_PKT_TYPE_BEACON)) {
+            target_pre_delay = TX_START_DELAY;
+        } else {
+            target_pre_delay = node->pre_delay;
+        }
+        if (jit_collision_test(count_us, pre_delay, post_delay, node->pkt.count_us, target_pre_delay, node->post_delay) == true) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void jit_insert_node(struct jit_queue_s *queue, struct lgw_pkt_tx_s *packet, enum jit_pkt_type_e pkt_type, uint32_t pre_delay, uint32_t post_delay) {
+    /* Take the first free node and link it at its position in timestamp order */
+    int pos = jit_search_pos(queue, packet->count_us);
+    uint16_t idx = queue->order[queue->num_pkt];
+
+    memcpy(&(queue->nodes[idx].pkt), packet, sizeof(struct lgw_pkt_tx_s));
+    queue->nodes[idx].pre_delay = pre_delay;
+    queue->nodes[idx].post_delay = post_delay;
+    queue->nodes[idx].pkt_type = pkt_type;
+
+    memmove(&(queue->order[pos + 1]), &(queue->order[pos]), (queue->num_pkt - pos) * sizeof(queue->order[0]));
+    queue->order[pos] = idx;
+
+    if (pre_delay > queue->max_pre_delay) {
+        queue->max_pre_delay = pre_delay;
+    }
+    if (post_delay > queue->max_post_delay) {
+        queue->max_post_delay = post_delay;
+    }
+    if (pkt_type == JIT_PKT_TYPE_BEACON) {
+        queue->num_beacon++;
+    }
+    queue->num_pkt++;
+}
+
+static void jit_remove_node(struct jit_queue_s *queue, int pos) {
+    /* Unlink node at given position and give it back to the free nodes */
+    uint16_t idx = queue->order[pos];
+
+    if (queue->nodes[idx].pkt_type == JIT_PKT_TYPE_BEACON) {
+        queue->num_beacon--;
+    }
+    queue->num_pkt--;
+
+    memmove(&(queue->order[pos]), &(queue->order[pos + 1]), (queue->num_pkt - pos) * sizeof(queue->order[0]));
+    queue->order[queue->num_pkt] = idx;
+    memset(&(queue->nodes[idx]), 0, sizeof(struct jit_node_s));
+
+    /* Bounds are only shrunk when the queue drains, they just need to stay above actual delays */
+    if (queue->num_pkt == 0) {
+        queue->max_pre_delay = 0;
+        queue->max_post_delay = 0;
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
 
@@ -83,55 +194,16 @@ void jit_queue_init(struct jit_queue_s *queue) {
 
     memset(queue, 0, sizeof(*queue));
     for (i=0; i<JIT_QUEUE_MAX; i++) {
-        queue->nodes[i].pre_delay = 0;
-        queue->nodes[i].post_delay = 0;
+        queue->order[i] = i;
     }
 
     pthread_mutex_unlock(&mx_jit_queue);
 }
 
-int compare(const void *a, const void *b, void *arg)
-{
-    struct jit_node_s *p = (struct jit_node_s *)a;
-    struct jit_node_s *q = (struct jit_node_s *)b;
-    int *counter = (int *)arg;
-    int p_count, q_count;
-
-    p_count = p->pkt.count_us;
-    q_count = q->pkt.count_us;
-
-    if (p_count > q_count)
-        *counter = *counter + 1;
-
-    return p_count - q_count;
-}
-
-void jit_sort_queue(struct jit_queue_s *queue) {
-    int counter = 0;
-
-    if (queue->num_pkt == 0) {
-        return;
-    }
-
-    MSG_DEBUG(DEBUG_JIT, "sorting queue in ascending order packet timestamp - queue size:%u\n", queue->num_pkt);
-    qsort_r(queue->nodes, queue->num_pkt, sizeof(queue->nodes[0]), compare, &counter);
-    MSG_DEBUG(DEBUG_JIT, "sorting queue done - swapped:%d\n", counter);
-}
-
-bool jit_collision_test(uint32_t p1_count_us, uint32_t p1_pre_delay, uint32_t p1_post_delay, uint32_t p2_count_us, uint32_t p2_pre_delay, uint32_t p2_post_delay) {
-    if (((p1_count_us - p2_count_us) <= (p1_pre_delay + p2_post_delay + TX_MARGIN_DELAY)) ||
-        ((p2_count_us - p1_count_us) <= (p2_pre_delay + p1_post_delay + TX_MARGIN_DELAY))) {
-        return true;
-    } else {
-        return false;
-    }
-}
-
 enum jit_error_e jit_enqueue(struct jit_queue_s *queue, uint32_t time_us, struct lgw_pkt_tx_s *packet, enum jit_pkt_type_e pkt_type) {
     int i = 0;
     uint32_t packet_post_delay = 0;
     uint32_t packet_pre_delay = 0;
-    uint32_t target_pre_delay = 0;
     enum jit_error_e err_collision;
     uint32_t asap_count_us;
 
@@ -185,26 +257,22 @@ enum jit_error_e jit_enqueue(struct jit_queue_s *queue, uint32_t time_us, struct
             */
 
             /* First, try if the ASAP time collides with an already enqueued downlink */
-            for (i=0; i<queue->num_pkt; i++) {
-                if (jit_collision_test(asap_count_us, packet_pre_delay, packet_post_delay, queue->nodes[i].pkt.count_us, queue->nodes[i].pre_delay, queue->nodes[i].post_delay) == true) {
-                    MSG_DEBUG(DEBUG_JIT, "DEBUG: cannot insert IMMEDIATE downlink at count_us=%u, collides with %u (index=%d)\n", asap_count_us, queue->nodes[i].pkt.count_us, i);
-                    break;
-                }
-            }
-            if (i == queue->num_pkt) {
+            i = jit_search_collision(queue, asap_count_us, packet_pre_delay, packet_post_delay, false);
+            if (i < 0) {
                 /* No collision with ASAP time, we can insert it */
                 MSG_DEBUG(DEBUG_JIT, "DEBUG: insert IMMEDIATE downlink ASAP at %u (no collision)\n", asap_count_us);
             } else {
-                /* Search for the best slot then */
-                for (i=0; i<queue->num_pkt; i++) {
-                    asap_count_us = queue->nodes[i].pkt.count_us + queue->nodes[i].post_delay + packet_pre_delay + TX_JIT_DELAY + TX_MARGIN_DELAY;
+                MSG_DEBUG(DEBUG_JIT, "DEBUG: cannot insert IMMEDIATE downlink at count_us=%u, collides with %u (index=%d)\n", asap_count_us, JIT_NODE(queue, i)->pkt.count_us, i);
+                /* Search for the best slot then, starting from the colliding packet (earlier ones end before ASAP time) */
+                for (; i<queue->num_pkt; i++) {
+                    asap_count_us = JIT_NODE(queue, i)->pkt.count_us + JIT_NODE(queue, i)->post_delay + packet_pre_delay + TX_JIT_DELAY + TX_MARGIN_DELAY;
                     if (i == (queue->num_pkt - 1)) {
                         /* Last packet index, we can insert after this one */
                         MSG_DEBUG(DEBUG_JIT, "DEBUG: insert IMMEDIATE downlink, last in JiT queue (count_us=%u)\n", asap_count_us);
                     } else {
                         /* Check if packet can be inserted between this index and the next one */
                         MSG_DEBUG(DEBUG_JIT, "DEBUG: try to insert IMMEDIATE downlink (count_us=%u) between index %d and index %d?\n", asap_count_us, i, i+1);
-                        if (jit_collision_test(asap_count_us, packet_pre_delay, packet_post_delay, queue->nodes[i+1].pkt.count_us, queue->nodes[i+1].pre_delay, queue->nodes[i+1].post_delay) == true) {
+                        if (jit_collision_test(asap_count_us, packet_pre_delay, packet_post_delay, JIT_NODE(queue, i+1)->pkt.count_us, JIT_NODE(queue, i+1)->pre_delay, JIT_NODE(queue, i+1)->post_delay) == true) {
                             MSG_DEBUG(DEBUG_JIT, "DEBUG: failed to insert IMMEDIATE downlink (count_us=%u), continue...\n", asap_count_us);
                             continue;
                         } else {
@@ -227,7 +295,7 @@ enum jit_error_e jit_enqueue(struct jit_queue_s *queue, uint32_t time_us, struct
      *  Warning: unsigned arithmetic (handle roll-over)
      *      t_packet < t_current + TX_START_DELAY + MARGIN
      */
-    if ((packet->count_us - time_us) <= (TX_START_DELAY + TX_MARGIN_DELAY + TX_JIT_DELAY)) {
+    if ((packet->count_us - time_us) <= JIT_MIN_LEAD_TIME) {
         MSG_DEBUG(DEBUG_JIT_ERROR, "ERROR: Packet REJECTED, already too late to send it (current=%u, packet=%u, type=%d)\n", time_us, packet->count_us, pkt_type);
         pthread_mutex_unlock(&mx_jit_queue);
         return JIT_ERROR_TOO_LATE;
@@ -257,56 +325,40 @@ enum jit_error_e jit_enqueue(struct jit_queue_s *queue, uint32_t time_us, struct
      *        - Valid for both Downlinks and beacon packets
      *        - Beacon guard can be ignored if we try to queue a Class A downlink
      */
-    for (i=0; i<queue->num_pkt; i++) {
-        /* We ignore Beacon Guard for Class A/C downlinks */
-        if (((pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_A) || (pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_C)) && (queue->nodes[i].pkt_type == JIT_PKT_TYPE_BEACON)) {
-            target_pre_delay = TX_START_DELAY;
-        } else {
-            target_pre_delay = queue->nodes[i].pre_delay;
-        }
-
-        /* Check if there is a collision
-         *  Warning: unsigned arithmetic (handle roll-over)
-         *      t_packet_new - pre_delay_packet_new < t_packet_prev + post_delay_packet_prev (OVERLAP on post delay)
-         *      t_packet_new + post_delay_packet_new > t_packet_prev - pre_delay_packet_prev (OVERLAP on pre delay)
-         */
-        if (jit_collision_test(packet->count_us, packet_pre_delay, packet_post_delay, queue->nodes[i].pkt.count_us, target_pre_delay, queue->nodes[i].post_delay) == true) {
-            switch (queue->nodes[i].pkt_type) {
-                case JIT_PKT_TYPE_DOWNLINK_CLASS_A:
-                case JIT_PKT_TYPE_DOWNLINK_CLASS_B:
-                case JIT_PKT_TYPE_DOWNLINK_CLASS_C:
-                    MSG_DEBUG(DEBUG_JIT_ERROR, "ERROR: Packet (type=%d) REJECTED, collision with packet already programmed at %u (%u)\n", pkt_type, queue->nodes[i].pkt.count_us, packet->count_us);
-                    err_collision = JIT_ERROR_COLLISION_PACKET;
-                    break;
-                case JIT_PKT_TYPE_BEACON:
-                    if (pkt_type != JIT_PKT_TYPE_BEACON) {
-                        /* do not overload logs for beacon/beacon collision, as it is expected to happen with beacon pre-scheduling algorith used */
-                        MSG_DEBUG(DEBUG_JIT_ERROR, "ERROR: Packet (type=%d) REJECTED, collision with beacon already programmed at %u (%u)\n", pkt_type, queue->nodes[i].pkt.count_us, packet->count_us);
-                    }
-                    err_collision = JIT_ERROR_COLLISION_BEACON;
-                    break;
-                default:
-                    MSG("ERROR: Unknown packet type, should not occur, BUG?\n");
-                    assert(0);
-                    break;
-            }
-            pthread_mutex_unlock(&mx_jit_queue);
-            return err_collision;
+    /* Only the nodes close enough to the new packet in the sorted queue are tested */
+    i = jit_search_collision(queue, packet->count_us, packet_pre_delay, packet_post_delay,
+                             (pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_A) || (pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_C));
+    /* Check if there is a collision
+     *  Warning: unsigned arithmetic (handle roll-over)
+     *      t_packet_new - pre_delay_packet_new < t_packet_prev + post_delay_packet_prev (OVERLAP on post delay)
+     *      t_packet_new + post_delay_packet_new > t_packet_prev - pre_delay_packet_prev (OVERLAP on pre delay)
+     */
+    if (i >= 0) {
+        switch (JIT_NODE(queue, i)->pkt_type) {
+            case JIT_PKT_TYPE_DOWNLINK_CLASS_A:
+            case JIT_PKT_TYPE_DOWNLINK_CLASS_B:
+            case JIT_PKT_TYPE_DOWNLINK_CLASS_C:
+                MSG_DEBUG(DEBUG_JIT_ERROR, "ERROR: Packet (type=%d) REJECTED, collision with packet already programmed at %u (%u)\n", pkt_type, JIT_NODE(queue, i)->pkt.count_us, packet->count_us);
+                err_collision = JIT_ERROR_COLLISION_PACKET;
+                break;
+            case JIT_PKT_TYPE_BEACON:
+                if (pkt_type != JIT_PKT_TYPE_BEACON) {
+                    /* do not overload logs for beacon/beacon collision, as it is expected to happen with beacon pre-scheduling algorith used */
+                    MSG_DEBUG(DEBUG_JIT_ERROR, "ERROR: Packet (type=%d) REJECTED, collision with beacon already programmed at %u (%u)\n", pkt_type, JIT_NODE(queue, i)->pkt.count_us, packet->count_us);
+                }
+                err_collision = JIT_ERROR_COLLISION_BEACON;
+                break;
+            default:
+                MSG("ERROR: Unknown packet type, should not occur, BUG?\n");
+                assert(0);
+                break;
         }
+        pthread_mutex_unlock(&mx_jit_queue);
+        return err_collision;
     }
 
-    /* Finally enqueue it */
-    /* Insert packet at the end of the queue */
-    memcpy(&(queue->nodes[queue->num_pkt].pkt), packet, sizeof(struct lgw_pkt_tx_s));
-    queue->nodes[queue->num_pkt].pre_delay = packet_pre_delay;
-    queue->nodes[queue->num_pkt].post_delay = packet_post_delay;
-    queue->nodes[queue->num_pkt].pkt_type = pkt_type;
-    if (pkt_type == JIT_PKT_TYPE_BEACON) {
-        queue->num_beacon++;
-    }
-    queue->num_pkt++;
-    /* Sort the queue in ascending order of packet timestamp */
-    jit_sort_queue(queue);
+    /* Finally enqueue it, at its position in ascending order of packet timestamp */
+    jit_insert_node(queue, packet, pkt_type, packet_pre_delay, packet_post_delay);
 
     /* Done */
     pthread_mutex_unlock(&mx_jit_queue);
@@ -324,7 +376,7 @@ enum jit_error_e jit_dequeue(struct jit_queue_s *queue, int index, struct lgw_pk
         return JIT_ERROR_INVALID;
     }
 
-    if ((index < 0) || (index >= JIT_QUEUE_MAX)) {
+    if ((index < 0) || (index >= queue->num_pkt)) {
         MSG("ERROR: invalid parameter\n");
         return JIT_ERROR_INVALID;
     }
@@ -337,20 +389,14 @@ enum jit_error_e jit_dequeue(struct jit_queue_s *queue, int index, struct lgw_pk
     pthread_mutex_lock(&mx_jit_queue);
 
     /* Dequeue requested packet */
-    memcpy(packet, &(queue->nodes[index].pkt), sizeof(struct lgw_pkt_tx_s));
-    queue->num_pkt--;
-    *pkt_type = queue->nodes[index].pkt_type;
+    memcpy(packet, &(JIT_NODE(queue, index)->pkt), sizeof(struct lgw_pkt_tx_s));
+    *pkt_type = JIT_NODE(queue, index)->pkt_type;
     if (*pkt_type == JIT_PKT_TYPE_BEACON) {
-        queue->num_beacon--;
         MSG_DEBUG(DEBUG_BEACON, "--- Beacon dequeued ---\n");
     }
 
-    /* Replace dequeued packet with last packet of the queue */
-    memcpy(&(queue->nodes[index]), &(queue->nodes[queue->num_pkt]), sizeof(struct jit_node_s));
-    memset(&(queue->nodes[queue->num_pkt]), 0, sizeof(struct jit_node_s));
-
-    /* Sort queue in ascending order of packet timestamp */
-    jit_sort_queue(queue);
+    /* Unlink it, remaining packets stay in timestamp order */
+    jit_remove_node(queue, index);
 
     /* Done */
     pthread_mutex_unlock(&mx_jit_queue);
@@ -364,8 +410,6 @@ enum jit_error_e jit_dequeue(struct jit_queue_s *queue, int index, struct lgw_pk
 
 enum jit_error_e jit_peek(struct jit_queue_s *queue, uint32_t time_us, int *pkt_idx) {
     /* Return index of node containing a packet inline with given time */
-    int i = 0;
-    int idx_highest_priority = -1;
     if (pkt_idx == NULL) {
         MSG("ERROR: invalid parameter\n");
         return JIT_ERROR_INVALID;
@@ -377,54 +421,31 @@ enum jit_error_e jit_peek(struct jit_queue_s *queue, uint32_t time_us, int *pkt_
 
     pthread_mutex_lock(&mx_jit_queue);
 
-    /* Search for highest priority packet to be sent */
-    for (i=0; i<queue->num_pkt; i++) {
-        /* First check if that packet is outdated:
-         *  If a packet seems too much in advance, and was not rejected at enqueue time,
-         *  it means that we missed it for peeking, we need to drop it
-         *
-         *  Warning: unsigned arithmetic
-         *      t_packet > t_current + TX_MAX_ADVANCE_DELAY
-         */
-        if ((queue->nodes[i].pkt.count_us - time_us) >= TX_MAX_ADVANCE_DELAY) {
-            /* We drop the packet to avoid lock-up */
-            queue->num_pkt--;
-            if (queue->nodes[i].pkt_type == JIT_PKT_TYPE_BEACON) {
-                queue->num_beacon--;
-                MSG("WARNING: --- Beacon dropped (current_time=%u, packet_time=%u) ---\n", time_us, queue->nodes[i].pkt.count_us);
-            } else {
-                MSG("WARNING: --- Packet dropped (current_time=%u, packet_time=%u) ---\n", time_us, queue->nodes[i].pkt.count_us);
-            }
-
-            /* Replace dropped packet with last packet of the queue */
-            memcpy(&(queue->nodes[i]), &(queue->nodes[queue->num_pkt]), sizeof(struct jit_node_s));
-            memset(&(queue->nodes[queue->num_pkt]), 0, sizeof(struct jit_node_s));
-
-            /* Sort queue in ascending order of packet timestamp */
-            jit_sort_queue(queue);
-
-            /* restart loop  after purge to find packet to be sent */
-            i = 0;
-            continue;
-        }
-
-        /* Then look for highest priority packet to be sent:
-         *  Warning: unsigned arithmetic (handle roll-over)
-         *      t_packet < t_highest
-         */
-        if ((idx_highest_priority == -1) || (((queue->nodes[i].pkt.count_us - time_us) < (queue->nodes[idx_highest_priority].pkt.count_us - time_us)))) {
-            idx_highest_priority = i;
+    /* Highest priority packet is the head of the queue, once outdated ones are purged:
+     *  If a packet seems too much in advance, and was not rejected at enqueue time,
+     *  it means that we missed it for peeking, we need to drop it
+     *
+     *  Warning: unsigned arithmetic
+     *      t_packet > t_current + TX_MAX_ADVANCE_DELAY
+     */
+    while ((queue->num_pkt > 0) && ((JIT_NODE(queue, 0)->pkt.count_us - time_us) >= TX_MAX_ADVANCE_DELAY)) {
+        /* We drop the packet to avoid lock-up */
+        if (JIT_NODE(queue, 0)->pkt_type == JIT_PKT_TYPE_BEACON) {
+            MSG("WARNING: --- Beacon dropped (current_time=%u, packet_time=%u) ---\n", time_us, JIT_NODE(queue, 0)->pkt.count_us);
+        } else {
+            MSG("WARNING: --- Packet dropped (current_time=%u, packet_time=%u) ---\n", time_us, JIT_NODE(queue, 0)->pkt.count_us);
         }
+        jit_remove_node(queue, 0);
     }
 
     /* Peek criteria 1: look for a packet to be sent in next TX_JIT_DELAY ms timeframe
      *  Warning: unsigned arithmetic (handle roll-over)
      *      t_packet < t_current + TX_JIT_DELAY
      */
-    if ((queue->nodes[idx_highest_priority].pkt.count_us - time_us) < TX_JIT_DELAY) {
-        *pkt_idx = idx_highest_priority;
+    if ((queue->num_pkt > 0) && ((JIT_NODE(queue, 0)->pkt.count_us - time_us) < TX_JIT_DELAY)) {
+        *pkt_idx = 0;
         MSG_DEBUG(DEBUG_JIT, "peek packet with count_us=%u at index %d\n",
-            queue->nodes[idx_highest_priority].pkt.count_us, idx_highest_priority);
+            JIT_NODE(queue, 0)->pkt.count_us, 0);
     } else {
         *pkt_idx = -1;
     }
@@ -434,6 +455,56 @@ enum jit_error_e jit_peek(struct jit_queue_s *queue, uint32_t time_us, int *pkt_
     return JIT_ERROR_OK;
 }
 
+enum jit_error_e jit_next_due(struct jit_queue_s *queue, uint32_t time_us, uint32_t *delay_us) {
+    /* Return the time left before the head packet enters the peek window */
+    uint32_t dt;
+
+    if (delay_us == NULL) {
+        MSG("ERROR: invalid parameter\n");
+        return JIT_ERROR_INVALID;
+    }
+
+    if (jit_queue_is_empty(queue)) {
+        return JIT_ERROR_EMPTY;
+    }
+
+    pthread_mutex_lock(&mx_jit_queue);
+
+    /* Warning: unsigned arithmetic (handle roll-over) */
+    dt = JIT_NODE(queue, 0)->pkt.count_us - time_us;
+    if (dt >= TX_MAX_ADVANCE_DELAY) {
+        /* outdated packet, let jit_peek purge it right away */
+        dt = 0;
+    }
+
+    pthread_mutex_unlock(&mx_jit_queue);
+
+    /* jit_peek returns a packet once it is less than TX_JIT_DELAY away */
+    *delay_us = (dt < TX_JIT_DELAY) ? 0 : (dt - TX_JIT_DELAY + 1);
+
+    return JIT_ERROR_OK;
+}
+
+enum jit_error_e jit_head(struct jit_queue_s *queue, struct lgw_pkt_tx_s *packet, enum jit_pkt_type_e *pkt_type) {
+    if ((packet == NULL) || (pkt_type == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return JIT_ERROR_INVALID;
+    }
+
+    pthread_mutex_lock(&mx_jit_queue);
+
+    if (queue->num_pkt == 0) {
+        pthread_mutex_unlock(&mx_jit_queue);
+        return JIT_ERROR_EMPTY;
+    }
+    *packet = JIT_NODE(queue, 0)->pkt;
+    *pkt_type = JIT_NODE(queue, 0)->pkt_type;
+
+    pthread_mutex_unlock(&mx_jit_queue);
+
+    return JIT_ERROR_OK;
+}
+
 void jit_print_queue(struct jit_queue_s *queue, bool show_all, int debug_level) {
     int i = 0;
     int loop_end;
@@ -448,9 +519,9 @@ void jit_print_queue(struct jit_queue_s *queue, bool show_all, int debug_level)
         loop_end = (show_all == true) ? JIT_QUEUE_MAX : queue->num_pkt;
         for (i=0; i<loop_end; i++) {
             MSG_DEBUG(debug_level, " - node[%d]: count_us=%u - type=%d\n",
-                        i,
-                        queue->nodes[i].pkt.count_us,
-                        queue->nodes[i].pkt_type);
+                        queue->order[i],
+                        queue->nodes[queue->order[i]].pkt.count_us,
+                        queue->nodes[queue->order[i]].pkt_type);
         }
 
         pthread_mutex_unlock(&mx_jit_queue);
@@ -43,11 +43,25 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <netinet/in.h>     /* INET constants and stuff */
 #include <arpa/inet.h>      /* IP address conversion stuff */
 #include <netdb.h>          /* gai_strerror */
+#include <poll.h>           /* poll */
 
 #include <pthread.h>
 
 #include "trace.h"
 #include "jitqueue.h"
+#include "rxpk.h"
+#include "txpk.h"
+#include "binproto.h"
+#include "pushq.h"
+#include "rxring.h"
+#include "uptrace.h"
+#include "netfilt.h"
+#include "xdedup.h"
+#include "rtsched.h"
+#include "timeref.h"
+#include "beacon.h"
+#include "jarena.h"
+#include "metrics.h"
 #include "parson.h"
 #include "base64.h"
 #include "loragw_hal.h"
@@ -76,14 +90,17 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define DEFAULT_PORT_DW     1782
 #define DEFAULT_KEEPALIVE   5           /* default time interval for downstream keep-alive packet */
 #define DEFAULT_STAT        30          /* default time interval for statistics */
-#define PUSH_TIMEOUT_MS     100
+#define PUSH_TIMEOUT_MS     100         /* default time after which a PUSH_DATA is considered not acknowledged */
 #define PULL_TIMEOUT_MS     200
 #define GPS_REF_MAX_AGE     30          /* maximum admitted delay in seconds of GPS loss before considering latest GPS sync unusable */
-#define FETCH_SLEEP_MS      10          /* nb of ms waited when a fetch return no packets */
+#define FETCH_WAIT_MS       100         /* max nb of ms waited for RX data when a fetch return no packets */
+#define XDEDUP_HOLD_MS      50          /* time a packet is held waiting for its copies from the other boards */
 #define BEACON_POLL_MS      50          /* time in ms between polling of beacon TX status */
+#define JIT_WAIT_MAX_MS     1000        /* max nb of ms the JIT thread sleeps before re-reading the concentrator counter */
+#define STAT_WAIT_SLICE_MS  100         /* time in ms between checks of the stop and reload signals while waiting for the statistics */
+#define GPS_READ_SIZE       256         /* max nb of bytes fetched from the GPS serial port per read */
 
 #define PROTOCOL_VERSION    2           /* v1.3 */
-#define PROTOCOL_JSON_RXPK_FRAME_FORMAT 1
 
 #define XERR_INIT_AVG       128         /* nb of measurements the XTAL correction is averaged on as initial value */
 #define XERR_FILT_COEF      256         /* coefficient for low-pass XTAL error tracking */
@@ -96,15 +113,32 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define PKT_TX_ACK      5
 
 #define NB_PKT_MAX      255 /* max number of packets per fetch/send cycle */
+#define PKT_PER_IF_MAX  8   /* packets per enabled IF chain and per fetch/send cycle, low memory profile */
+
+#define UP_SERVER_MAX   4   /* primary server + servers receiving a copy of the upstream traffic */
 
 #define MIN_LORA_PREAMB 6 /* minimum Lora preamble length for this application */
 #define STD_LORA_PREAMB 8
 #define MIN_FSK_PREAMB  3 /* minimum FSK preamble length for this application */
 #define STD_FSK_PREAMB  5
 
-#define STATUS_SIZE     200
-#define TX_BUFF_SIZE    ((540 * NB_PKT_MAX) + 30 + STATUS_SIZE)
-#define ACK_BUFF_SIZE   64
+#define STATUS_SIZE     4352 /* room for the per IF chain airtime of the 10 IF chains, the SPI traffic, the RX buffer level, the demodulator allocations, the uplink/downlink and scheduling latency */
+#define TX_BUFF_SIZE(n) ((540 * (n)) + 30 + STATUS_SIZE)
+#define ACK_BUFF_SIZE   96
+#define DW_DGRAM_SIZE   1000 /* largest PULL_RESP datagram, longer ones are ignored */
+#define DW_BATCH_MAX    PUSHQ_BATCH_MAX /* downstream datagrams received, and TX_ACK sent, per system call */
+
+#define STAT_SF_NB      8 /* airtime statistics kept for SF5 to SF12 */
+
+#define MEAS_CACHE_LINE 64 /* measurement blocks of different threads never share a cache line */
+
+/* single writer increment, the main thread may read the counter meanwhile */
+#define MEAS_ADD(x, v)  __atomic_store_n(&(x), __atomic_load_n(&(x), __ATOMIC_RELAXED) + (v), __ATOMIC_RELAXED)
+
+#define DW_DELAY_BIN_NB     8 /* histogram of downlink processing durations */
+#define DW_DELAY_BINS_US    { 50, 100, 200, 500, 1000, 2000, 5000 } /* upper bounds, last bin is open */
+#define DW_LEAD_BIN_NB      10 /* histogram of the time left before a downlink is due */
+#define DW_LEAD_BINS_US     { 0, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000 }
 
 #define UNIX_GPS_EPOCH_OFFSET 315964800 /* Number of seconds ellapsed between 01.Jan.1970 00:00:00
                                                                           and 06.Jan.1980 00:00:00 */
@@ -117,17 +151,42 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define DEFAULT_BEACON_POWER        14
 #define DEFAULT_BEACON_INFODESC     0
 
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* destination of the upstream traffic, the first one is also the downstream server */
+struct up_server_s {
+    char        addr[64];               /* host name or IPv4/IPv6 address */
+    char        port_up[8];             /* upstream port */
+    int         sock;                   /* connected upstream socket */
+    struct pushq_track_s track;         /* datagrams sent, waiting for their PUSH_ACK */
+};
+
+/* part of the path that ate the lead time of a downlink sent or rejected too late */
+enum dw_late_e {
+    DW_LATE_NET,    /* PULL_RESP received too late, the server or the network are to blame */
+    DW_LATE_GW,     /* PULL_RESP received in time, but queued too late */
+    DW_LATE_JIT,    /* queued in time, but handed to the concentrator after TX_START_DELAY */
+    DW_LATE_NB
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
 
 /* signal handling variables */
 volatile bool exit_sig = false; /* 1 -> application terminates cleanly (shut down hardware, close open files, etc) */
 volatile bool quit_sig = false; /* 1 -> application terminates without shutting down the hardware */
+volatile bool reload_sig = false; /* 1 -> channel plan to be reloaded from the configuration file */
 
 /* packets filtering configuration variables */
 static bool fwd_valid_pkt = true; /* packets with PAYLOAD CRC OK are forwarded */
 static bool fwd_error_pkt = false; /* packets with PAYLOAD CRC ERROR are NOT forwarded */
 static bool fwd_nocrc_pkt = false; /* packets with NO PAYLOAD CRC are NOT forwarded */
+static struct lgw_conf_rxfilter_s rxfilter = { .crc_ok = true, .crc_bad = false, .no_crc = false }; /* applied by the HAL, same CRC policy */
+static struct netfilt_s netfilt; /* NetID/DevAddr prefixes, applied by the upstream thread */
+
+/* threads scheduling configuration variables */
+static bool mem_lock = false; /* lock the process memory in RAM */
 
 /* network configuration variables */
 static uint64_t lgwm = 0; /* Lora gateway MAC address */
@@ -140,32 +199,65 @@ static int keepalive_time = DEFAULT_KEEPALIVE; /* send a PULL_DATA request every
 static unsigned stat_interval = DEFAULT_STAT; /* time interval (in sec) at which statistics are collected and displayed */
 
 /* gateway <-> MAC protocol variables */
+static uint8_t protocol_version = PROTOCOL_VERSION; /* PROTOCOL_VERSION_BIN for binary payloads */
 static uint32_t net_mac_h; /* Most Significant Nibble, network order */
 static uint32_t net_mac_l; /* Least Significant Nibble, network order */
 
 /* network sockets */
-static int sock_up; /* socket for upstream traffic */
+static struct up_server_s up_server[UP_SERVER_MAX]; /* sockets for upstream traffic, [0] is serv_addr */
+static int up_server_nb = 1; /* number of upstream servers */
+static struct pushq_s push_queue; /* datagrams composed by the upstream thread, waiting to be sent */
+
+/* concentrator boards, one per SX130x_conf object */
+static int board_nb = 1;
+static int fetch_board_next = 0; /* board of the next fetch thread started */
+
+/* packets fetched by the fetch thread of each board, waiting to be serialized by the upstream thread */
+static struct rxring_s rx_ring[LGW_BOARD_NB];
+
+/* copies of a packet received by several boards, only the best one is forwarded */
+static unsigned xdedup_hold_ms = XDEDUP_HOLD_MS; /* 0 to forward every copy */
+static struct xdedup_s xdedup; /* owned by the upstream thread */
+static uint32_t cnt_offset[LGW_BOARD_NB]; /* counter of each board minus the one of board 0, updated by the validation thread */
 static int sock_down; /* socket for downstream traffic */
 
 /* network protocol variables */
-static struct timeval push_timeout_half = {0, (PUSH_TIMEOUT_MS * 500)}; /* cut in half, critical for throughput */
-static struct timeval pull_timeout = {0, (PULL_TIMEOUT_MS * 1000)}; /* non critical for throughput */
-
-/* hardware access control and correction */
-pthread_mutex_t mx_concent = PTHREAD_MUTEX_INITIALIZER; /* control access to the concentrator */
+static unsigned push_timeout_ms = PUSH_TIMEOUT_MS; /* only used for statistics, datagrams are not re-sent */
+
+/* uplink latency tracing */
+static bool uptrace_enable = false; /* trace the latency of each uplink packet */
+static char uptrace_path[128] = "\0"; /* CSV file receiving the samples, empty for none */
+static struct uptrace_s up_trace;
+
+/* metrics exporter */
+static char metrics_address[64] = "127.0.0.1"; /* local address of the metrics listener */
+static char metrics_port[8] = "\0"; /* TCP port of the metrics listener, empty if disabled */
+static struct metrics_s metrics; /* owned by the metrics thread */
+
+/* downlink latency histograms */
+static const int32_t dw_delay_bins_us[DW_DELAY_BIN_NB - 1] = DW_DELAY_BINS_US;
+static const int32_t dw_lead_bins_us[DW_LEAD_BIN_NB - 1] = DW_LEAD_BINS_US;
+static const char * dw_late_name[DW_LATE_NB] = {"net", "gw", "jit"};
+
+/* TX_ACK composed while a batch of PULL_RESP is processed, sent together once it is done */
+/* Note: owned by the downstream thread, at most one TX_ACK per datagram of the batch */
+static uint8_t tx_ack_buff[DW_BATCH_MAX][ACK_BUFF_SIZE];
+static struct pushq_dgram_s tx_ack_dgram[DW_BATCH_MAX];
+static int tx_ack_nb = 0;
+
+/* hardware correction, concentrator access is serialized by the HAL itself */
 static pthread_mutex_t mx_xcorr = PTHREAD_MUTEX_INITIALIZER; /* control access to the XTAL correction */
 static bool xtal_correct_ok = false; /* set true when XTAL correction is stable enough */
-static double xtal_correct = 1.0;
+static double xtal_correct = 1.0; /* of board 0, sending the beacons */
 
 /* GPS configuration and synchronization */
 static char gps_tty_path[64] = "\0"; /* path of the TTY port GPS is connected on */
 static int gps_tty_fd = -1; /* file descriptor of the GPS TTY port */
 static bool gps_enabled = false; /* is GPS enabled on that gateway ? */
 
-/* GPS time reference */
-static pthread_mutex_t mx_timeref = PTHREAD_MUTEX_INITIALIZER; /* control access to GPS time reference */
-static bool gps_ref_valid; /* is GPS reference acceptable (ie. not too old) */
-static struct tref time_reference_gps; /* time reference used for GPS <-> timestamp conversion */
+/* GPS time reference of each board counter, published by the GPS thread without blocking the readers */
+static struct timeref_s time_reference_gps[LGW_BOARD_NB]; /* time reference used for GPS <-> timestamp conversion, valid if not too old */
+static struct tref gps_sync_ref[LGW_BOARD_NB]; /* reference being updated, owned by the GPS thread */
 
 /* Reference coordinates, for broadcasting (beacon) */
 static struct coord_s reference_coord;
@@ -174,33 +266,87 @@ static struct coord_s reference_coord;
 static bool gps_fake_enable; /* enable the feature */
 
 /* measurements to establish statistics */
-static pthread_mutex_t mx_meas_up = PTHREAD_MUTEX_INITIALIZER; /* control access to the upstream measurements */
-static uint32_t meas_nb_rx_rcv = 0; /* count packets received */
-static uint32_t meas_nb_rx_ok = 0; /* count packets received with PAYLOAD CRC OK */
-static uint32_t meas_nb_rx_bad = 0; /* count packets received with PAYLOAD CRC ERROR */
-static uint32_t meas_nb_rx_nocrc = 0; /* count packets received with NO PAYLOAD CRC */
-static uint32_t meas_up_pkt_fwd = 0; /* number of radio packet forwarded to the server */
-static uint32_t meas_up_network_byte = 0; /* sum of UDP bytes sent for upstream traffic */
-static uint32_t meas_up_payload_byte = 0; /* sum of radio payload bytes sent for upstream traffic */
-static uint32_t meas_up_dgram_sent = 0; /* number of datagrams sent for upstream traffic */
-static uint32_t meas_up_ack_rcv = 0; /* number of datagrams acknowledged for upstream traffic */
-
-static pthread_mutex_t mx_meas_dw = PTHREAD_MUTEX_INITIALIZER; /* control access to the downstream measurements */
-static uint32_t meas_dw_pull_sent = 0; /* number of PULL requests sent for downstream traffic */
-static uint32_t meas_dw_ack_rcv = 0; /* number of PULL requests acknowledged for downstream traffic */
-static uint32_t meas_dw_dgram_rcv = 0; /* count PULL response packets received for downstream traffic */
-static uint32_t meas_dw_network_byte = 0; /* sum of UDP bytes sent for upstream traffic */
-static uint32_t meas_dw_payload_byte = 0; /* sum of radio payload bytes sent for upstream traffic */
-static uint32_t meas_nb_tx_ok = 0; /* count packets emitted successfully */
-static uint32_t meas_nb_tx_fail = 0; /* count packets were TX failed for other reasons */
-static uint32_t meas_nb_tx_requested = 0; /* count TX request from server (downlinks) */
-static uint32_t meas_nb_tx_rejected_collision_packet = 0; /* count packets were TX request were rejected due to collision with another packet already programmed */
-static uint32_t meas_nb_tx_rejected_collision_beacon = 0; /* count packets were TX request were rejected due to collision with a beacon already programmed */
-static uint32_t meas_nb_tx_rejected_too_late = 0; /* count packets were TX request were rejected because it is too late to program it */
-static uint32_t meas_nb_tx_rejected_too_early = 0; /* count packets were TX request were rejected because timestamp is too much in advance */
-static uint32_t meas_nb_beacon_queued = 0; /* count beacon inserted in jit queue */
-static uint32_t meas_nb_beacon_sent = 0; /* count beacon actually sent to concentrator */
-static uint32_t meas_nb_beacon_rejected = 0; /* count beacon rejected for queuing */
+/* Note: each block is written by a single thread, its counters only increase, and the main thread
+   reads the difference with its previous values at each statistics interval: no lock, no atomic
+   read-modify-write on the hot paths, and a cache line per writer */
+struct meas_up_s { /* written by thread_up */
+    uint32_t nb_rx_rcv; /* count packets received */
+    uint32_t nb_rx_ok; /* count packets received with PAYLOAD CRC OK */
+    uint32_t nb_rx_bad; /* count packets received with PAYLOAD CRC ERROR */
+    uint32_t nb_rx_nocrc; /* count packets received with NO PAYLOAD CRC */
+    uint32_t up_pkt_fwd; /* number of radio packet forwarded to the server */
+    uint32_t up_pkt_netfilt; /* number of radio packet dropped by the NetID/DevAddr prefix filter */
+    uint32_t up_pkt_xdedup; /* number of radio packet dropped as a copy of a packet held by the cross-board deduplication */
+    uint32_t up_payload_byte; /* sum of radio payload bytes sent for upstream traffic */
+    uint32_t if_rx_rcv[LGW_IF_CHAIN_NB]; /* count packets received on each IF chain */
+    uint64_t if_airtime_us[LGW_IF_CHAIN_NB]; /* sum of time on air of the packets received on each IF chain */
+    uint64_t if_sf_airtime_us[LGW_IF_CHAIN_NB][STAT_SF_NB]; /* same, for each LoRa spreading factor */
+} __attribute__((aligned(MEAS_CACHE_LINE)));
+
+struct meas_up_net_s { /* written by thread_up_net */
+    uint32_t up_network_byte; /* sum of UDP bytes sent for upstream traffic */
+    uint32_t srv_dgram_sent[UP_SERVER_MAX]; /* number of datagrams sent to each server */
+    uint32_t srv_ack_rcv[UP_SERVER_MAX]; /* number of datagrams acknowledged by each server */
+} __attribute__((aligned(MEAS_CACHE_LINE)));
+
+struct meas_dw_s { /* written by thread_down */
+    uint32_t dw_pull_sent; /* number of PULL requests sent for downstream traffic */
+    uint32_t dw_ack_rcv; /* number of PULL requests acknowledged for downstream traffic */
+    uint32_t dw_dgram_rcv; /* count PULL response packets received for downstream traffic */
+    uint32_t dw_network_byte; /* sum of UDP bytes sent for upstream traffic */
+    uint32_t dw_payload_byte; /* sum of radio payload bytes sent for upstream traffic */
+    uint32_t nb_tx_requested; /* count TX request from server (downlinks) */
+    uint32_t nb_tx_rejected_collision_packet; /* count packets were TX request were rejected due to collision with another packet already programmed */
+    uint32_t nb_tx_rejected_collision_beacon; /* count packets were TX request were rejected due to collision with a beacon already programmed */
+    uint32_t nb_tx_rejected_too_late; /* count packets were TX request were rejected because it is too late to program it */
+    uint32_t nb_tx_rejected_too_early; /* count packets were TX request were rejected because timestamp is too much in advance */
+    uint32_t nb_beacon_queued; /* count beacon inserted in jit queue */
+    uint32_t nb_beacon_rejected; /* count beacon rejected for queuing */
+    uint32_t dw_late[DW_LATE_NB]; /* count downlinks too late, per part of the path to blame */
+    uint32_t dw_proc_hist[DW_DELAY_BIN_NB]; /* PULL_RESP reception to JIT enqueue */
+    int64_t dw_proc_sum_us; /* sum of the samples of dw_proc_hist */
+    uint32_t dw_lead_rx_hist[DW_LEAD_BIN_NB]; /* time left before TX when the PULL_RESP was received */
+    int64_t dw_lead_rx_sum_us; /* sum of the samples of dw_lead_rx_hist */
+} __attribute__((aligned(MEAS_CACHE_LINE)));
+
+struct meas_jit_s { /* written by thread_jit */
+    uint32_t nb_tx_ok; /* count packets emitted successfully */
+    uint32_t nb_tx_fail; /* count packets were TX failed for other reasons */
+    uint32_t nb_tx_staged; /* count packets programmed in the concentrator before being due, only triggered then */
+    uint32_t nb_beacon_sent; /* count beacon actually sent to concentrator */
+    uint32_t dw_late_jit; /* count downlinks sent too late because of the JIT thread */
+    uint32_t dw_lead_tx_hist[DW_LEAD_BIN_NB]; /* time left before TX when the packet was handed to lgw_send */
+    int64_t dw_lead_tx_sum_us; /* sum of the samples of dw_lead_tx_hist */
+    uint32_t dw_send_hist[DW_DELAY_BIN_NB]; /* duration of lgw_send, or lgw_tx_arm for staged packets */
+    int64_t dw_send_sum_us; /* sum of the samples of dw_send_hist */
+} __attribute__((aligned(MEAS_CACHE_LINE)));
+
+static struct meas_up_s meas_up;
+static struct meas_up_net_s meas_up_net;
+static struct meas_dw_s meas_dw;
+static struct meas_jit_s meas_jit;
+
+/* buffers sized once the channel plan is known */
+static int if_chain_nb = 0; /* IF chains enabled on all the boards */
+static int pkt_batch_max = NB_PKT_MAX; /* max number of packets per fetch and per datagram */
+static unsigned up_buff_size = TX_BUFF_SIZE(NB_PKT_MAX); /* size of a PUSH_DATA datagram buffer */
+
+/* JSON parse trees, allocated from arenas reset after each file or datagram */
+static struct jarena_s jarena_conf; /* owned by the main thread */
+static struct jarena_s jarena_down; /* owned by the downstream thread */
+
+/* totals of the statistics read from the HAL and the threads at each report, for the metrics thread */
+/* Note: the HAL counters are reset by each report, the metrics thread never reads them itself */
+static pthread_mutex_t mx_metrics = PTHREAD_MUTEX_INITIALIZER; /* never locked by the RX/TX threads */
+static struct metrics_acc_s {
+    unsigned                    nb_report;                      /* reports accumulated */
+    struct lgw_spi_op_stats_s   spi_op[LGW_SPI_OP_NB];          /* SPI traffic per type of access, all boards */
+    struct lgw_rx_stats_s       rx;                             /* RX buffer and RX filter, all boards, level_max of the last interval */
+    struct lgw_arb_stats_s      arb[LGW_BOARD_NB];              /* demodulator allocations of each board */
+    uint32_t                    sched_nb[RTSCHED_THREAD_NB];    /* timed waits that expired */
+    struct rtsched_stats_s      sched[RTSCHED_THREAD_NB];       /* wake-up latency of the last interval */
+    struct uptrace_report_s     up_lat;                         /* uplink latency of the last interval */
+} metrics_acc;
 
 static pthread_mutex_t mx_meas_gps = PTHREAD_MUTEX_INITIALIZER; /* control access to the GPS statistics */
 static bool gps_coord_valid; /* could we get valid GPS coordinates ? */
@@ -209,7 +355,8 @@ static struct coord_s meas_gps_err; /* GPS position of the gateway */
 
 static pthread_mutex_t mx_stat_rep = PTHREAD_MUTEX_INITIALIZER; /* control access to the status report */
 static bool report_ready = false; /* true when there is a new report to send to the server */
-static char status_report[STATUS_SIZE]; /* status report as a JSON object */
+static char status_report[STATUS_SIZE]; /* status report as a JSON object, or a binary stat record */
+static int status_report_size = 0; /* size of the status report */
 
 /* beacon parameters */
 static uint32_t beacon_period = 0; /* set beaconing period, must be a sub-multiple of 86400, the nb of sec in a day */
@@ -225,15 +372,18 @@ static uint8_t beacon_infodesc = DEFAULT_BEACON_INFODESC; /* set beacon informat
 static uint32_t autoquit_threshold = 0; /* enable auto-quit after a number of non-acknowledged PULL_DATA (0 = disabled)*/
 
 /* Just In Time TX scheduling */
-static struct jit_queue_s jit_queue[LGW_RF_CHAIN_NB];
+static struct jit_queue_s jit_queue[LGW_BOARD_NB][LGW_RF_CHAIN_NB];
+static pthread_mutex_t mx_jit_wake = PTHREAD_MUTEX_INITIALIZER; /* control access to the JIT thread wake-up flag */
+static pthread_cond_t cond_jit_wake; /* signaled when a packet is enqueued, uses CLOCK_MONOTONIC */
+static bool jit_wake_pending = false; /* true when the JIT thread must re-evaluate its next deadline */
 
 /* Gateway specificities */
-static int8_t antenna_gain = 0;
+static int8_t antenna_gain[LGW_BOARD_NB];
 
 /* TX capabilities */
-static struct lgw_tx_gain_lut_s txlut[LGW_RF_CHAIN_NB]; /* TX gain table */
-static uint32_t tx_freq_min[LGW_RF_CHAIN_NB]; /* lowest frequency supported by TX chain */
-static uint32_t tx_freq_max[LGW_RF_CHAIN_NB]; /* highest frequency supported by TX chain */
+static struct lgw_tx_gain_lut_s txlut[LGW_BOARD_NB][LGW_RF_CHAIN_NB]; /* TX gain table */
+static uint32_t tx_freq_min[LGW_BOARD_NB][LGW_RF_CHAIN_NB]; /* lowest frequency supported by TX chain */
+static uint32_t tx_freq_max[LGW_BOARD_NB][LGW_RF_CHAIN_NB]; /* highest frequency supported by TX chain */
 
 static uint32_t nb_pkt_log[LGW_IF_CHAIN_NB][8]; /* [CH][SF] */
 static uint32_t nb_pkt_received_lora = 0;
@@ -249,28 +399,60 @@ static void usage(void);
 
 static void sig_handler(int sigio);
 
+static int parse_rxif_configuration(JSON_Object * conf_obj, struct lgw_conf_rxif_s * ifconf_list);
+
+static int parse_SX130x_board(JSON_Object * conf_obj, const char * conf_file, lgw_handle_t board);
+
+static int get_SX130x_objects(JSON_Value * root_val, JSON_Object ** conf_obj);
+
 static int parse_SX130x_configuration(const char * conf_file);
 
+static int reload_rxif_configuration(const char * conf_file);
+
 static int parse_gateway_configuration(const char * conf_file);
 
 static int parse_debug_configuration(const char * conf_file);
 
-static uint16_t crc16(const uint8_t * data, unsigned size);
+static int open_socket_up(const char * addr, const char * port);
 
 static double difftimespec(struct timespec end, struct timespec beginning);
 
+static void log_start_phase(const char * name, const struct lgw_start_phase_s * phase);
+
+static void hist_add(uint32_t * hist, int64_t * sum, const int32_t * bins, int nb_bins, int32_t value);
+
+static uint32_t meas_delta(const uint32_t * meas, uint32_t * last);
+
+static uint64_t meas_delta64(const uint64_t * meas, uint64_t * last);
+
+static long resident_kb(void);
+
+static int json_hist(char * dest, int size, const char * name, const uint32_t * hist, int nb_bins);
+
+static void metrics_add_report(const struct lgw_spi_op_stats_s * spi_op, const struct lgw_rx_stats_s * rx, const struct lgw_arb_stats_s * arb, const bool * arb_ok,
+                               const struct rtsched_stats_s * sched, const struct uptrace_report_s * up_lat);
+
+static void metrics_render(struct metrics_s * m);
+
+static void jit_wake(void);
+
+static void jit_sleep(uint32_t delay_us);
+
 static void gps_process_sync(void);
 
 static void gps_process_coords(void);
 
-static int get_tx_gain_lut_index(uint8_t rf_chain, int8_t rf_power, uint8_t * lut_index);
+static int get_tx_gain_lut_index(int board, uint8_t rf_chain, int8_t rf_power, uint8_t * lut_index);
 
 /* threads */
+void thread_fetch(void);
 void thread_up(void);
+void thread_up_net(void);
 void thread_down(void);
 void thread_jit(void);
 void thread_gps(void);
 void thread_valid(void);
+void thread_metrics(void);
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
@@ -290,43 +472,184 @@ static void sig_handler(int sigio) {
         quit_sig = true;
     } else if ((sigio == SIGINT) || (sigio == SIGTERM)) {
         exit_sig = true;
+    } else if (sigio == SIGHUP) {
+        reload_sig = true;
     }
     return;
 }
 
-static int parse_SX130x_configuration(const char * conf_file) {
+static int parse_rxif_configuration(JSON_Object * conf_obj, struct lgw_conf_rxif_s * ifconf_list) {
+    int i;
+    char param_name[32]; /* used to generate variable parameter names */
+    JSON_Value *val = NULL;
+    struct lgw_conf_rxif_s ifconf;
+    uint32_t sf, bw, fdev;
+
+    /* Lora multi-SF channels (bandwidth cannot be set) */
+    for (i = 0; i < LGW_MULTI_NB; ++i) {
+        memset(&ifconf, 0, sizeof ifconf); /* initialize configuration structure */
+        snprintf(param_name, sizeof param_name, "chan_multiSF_%i", i); /* compose parameter path inside JSON structure */
+        val = json_object_get_value(conf_obj, param_name); /* fetch value (if possible) */
+        if (json_value_get_type(val) != JSONObject) {
+            MSG("INFO: no configuration for Lora multi-SF channel %i\n", i);
+            ifconf_list[i] = ifconf;
+            continue;
+        }
+        /* there is an object to configure that Lora multi-SF channel, let's parse it */
+        snprintf(param_name, sizeof param_name, "chan_multiSF_%i.enable", i);
+        val = json_object_dotget_value(conf_obj, param_name);
+        if (json_value_get_type(val) == JSONBoolean) {
+            ifconf.enable = (bool)json_value_get_boolean(val);
+        } else {
+            ifconf.enable = false;
+        }
+        if (ifconf.enable == false) { /* Lora multi-SF channel disabled, nothing else to parse */
+            MSG("INFO: Lora multi-SF channel %i disabled\n", i);
+        } else  { /* Lora multi-SF channel enabled, will parse the other parameters */
+            snprintf(param_name, sizeof param_name, "chan_multiSF_%i.radio", i);
+            ifconf.rf_chain = (uint32_t)json_object_dotget_number(conf_obj, param_name);
+            snprintf(param_name, sizeof param_name, "chan_multiSF_%i.if", i);
+            ifconf.freq_hz = (int32_t)json_object_dotget_number(conf_obj, param_name);
+            // TODO: handle individual SF enabling and disabling (spread_factor)
+            MSG("INFO: Lora multi-SF channel %i>  radio %i, IF %i Hz, 125 kHz bw, SF 5 to 12\n", i, ifconf.rf_chain, ifconf.freq_hz);
+        }
+        ifconf_list[i] = ifconf;
+    }
+
+    /* Lora standard channel */
+    memset(&ifconf, 0, sizeof ifconf); /* initialize configuration structure */
+    val = json_object_get_value(conf_obj, "chan_Lora_std"); /* fetch value (if possible) */
+    if (json_value_get_type(val) != JSONObject) {
+        MSG("INFO: no configuration for Lora standard channel\n");
+    } else {
+        val = json_object_dotget_value(conf_obj, "chan_Lora_std.enable");
+        if (json_value_get_type(val) == JSONBoolean) {
+            ifconf.enable = (bool)json_value_get_boolean(val);
+        } else {
+            ifconf.enable = false;
+        }
+        if (ifconf.enable == false) {
+            MSG("INFO: Lora standard channel %i disabled\n", i);
+        } else  {
+            ifconf.rf_chain = (uint32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.radio");
+            ifconf.freq_hz = (int32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.if");
+            bw = (uint32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.bandwidth");
+            switch(bw) {
+                case 500000: ifconf.bandwidth = BW_500KHZ; break;
+                case 250000: ifconf.bandwidth = BW_250KHZ; break;
+                case 125000: ifconf.bandwidth = BW_125KHZ; break;
+                default: ifconf.bandwidth = BW_UNDEFINED;
+            }
+            sf = (uint32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.spread_factor");
+            switch(sf) {
+                case  5: ifconf.datarate = DR_LORA_SF5;  break;
+                case  6: ifconf.datarate = DR_LORA_SF6;  break;
+                case  7: ifconf.datarate = DR_LORA_SF7;  break;
+                case  8: ifconf.datarate = DR_LORA_SF8;  break;
+                case  9: ifconf.datarate = DR_LORA_SF9;  break;
+                case 10: ifconf.datarate = DR_LORA_SF10; break;
+                case 11: ifconf.datarate = DR_LORA_SF11; break;
+                case 12: ifconf.datarate = DR_LORA_SF12; break;
+                default: ifconf.datarate = DR_UNDEFINED;
+            }
+            val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_hdr");
+            if (json_value_get_type(val) == JSONBoolean) {
+                ifconf.implicit_hdr = (bool)json_value_get_boolean(val);
+            } else {
+                ifconf.implicit_hdr = false;
+            }
+            if (ifconf.implicit_hdr == true) {
+                val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_payload_length");
+                if (json_value_get_type(val) == JSONNumber) {
+                    ifconf.implicit_payload_length = (uint8_t)json_value_get_number(val);
+                } else {
+                    MSG("ERROR: payload length setting is mandatory for implicit header mode\n");
+                    return -1;
+                }
+                val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_crc_en");
+                if (json_value_get_type(val) == JSONBoolean) {
+                    ifconf.implicit_crc_en = (bool)json_value_get_boolean(val);
+                } else {
+                    MSG("ERROR: CRC enable setting is mandatory for implicit header mode\n");
+                    return -1;
+                }
+                val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_coderate");
+                if (json_value_get_type(val) == JSONNumber) {
+                    ifconf.implicit_coderate = (uint8_t)json_value_get_number(val);
+                } else {
+                    MSG("ERROR: coding rate setting is mandatory for implicit header mode\n");
+                    return -1;
+                }
+            }
+
+            MSG("INFO: Lora std channel> radio %i, IF %i Hz, %u Hz bw, SF %u, %s\n", ifconf.rf_chain, ifconf.freq_hz, bw, sf, (ifconf.implicit_hdr == true) ? "Implicit header" : "Explicit header");
+        }
+        ifconf_list[8] = ifconf;
+    }
+
+    /* FSK channel */
+    memset(&ifconf, 0, sizeof ifconf); /* initialize configuration structure */
+    val = json_object_get_value(conf_obj, "chan_FSK"); /* fetch value (if possible) */
+    if (json_value_get_type(val) != JSONObject) {
+        MSG("INFO: no configuration for FSK channel\n");
+    } else {
+        val = json_object_dotget_value(conf_obj, "chan_FSK.enable");
+        if (json_value_get_type(val) == JSONBoolean) {
+            ifconf.enable = (bool)json_value_get_boolean(val);
+        } else {
+            ifconf.enable = false;
+        }
+        if (ifconf.enable == false) {
+            MSG("INFO: FSK channel %i disabled\n", i);
+        } else  {
+            ifconf.rf_chain = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.radio");
+            ifconf.freq_hz = (int32_t)json_object_dotget_number(conf_obj, "chan_FSK.if");
+            bw = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.bandwidth");
+            fdev = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.freq_deviation");
+            ifconf.datarate = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.datarate");
+
+            /* if chan_FSK.bandwidth is set, it has priority over chan_FSK.freq_deviation */
+            if ((bw == 0) && (fdev != 0)) {
+                bw = 2 * fdev + ifconf.datarate;
+            }
+            if      (bw == 0)      ifconf.bandwidth = BW_UNDEFINED;
+#if 0 /* TODO */
+            else if (bw <= 7800)   ifconf.bandwidth = BW_7K8HZ;
+            else if (bw <= 15600)  ifconf.bandwidth = BW_15K6HZ;
+            else if (bw <= 31200)  ifconf.bandwidth = BW_31K2HZ;
+            else if (bw <= 62500)  ifconf.bandwidth = BW_62K5HZ;
+#endif
+            else if (bw <= 125000) ifconf.bandwidth = BW_125KHZ;
+            else if (bw <= 250000) ifconf.bandwidth = BW_250KHZ;
+            else if (bw <= 500000) ifconf.bandwidth = BW_500KHZ;
+            else ifconf.bandwidth = BW_UNDEFINED;
+
+            MSG("INFO: FSK channel> radio %i, IF %i Hz, %u Hz bw, %u bps datarate\n", ifconf.rf_chain, ifconf.freq_hz, bw, ifconf.datarate);
+        }
+        ifconf_list[9] = ifconf;
+    }
+    return 0;
+}
+
+static int parse_SX130x_board(JSON_Object * conf_obj, const char * conf_file, lgw_handle_t board) {
     int i, j;
     char param_name[32]; /* used to generate variable parameter names */
     const char *str; /* used to store string value from JSON object */
-    const char conf_obj_name[] = "SX130x_conf";
-    JSON_Value *root_val = NULL;
     JSON_Value *val = NULL;
-    JSON_Object *conf_obj = NULL;
     JSON_Object *conf_txgain_obj;
     JSON_Object *conf_ts_obj;
     JSON_Array *conf_txlut_array;
 
     struct lgw_conf_board_s boardconf;
     struct lgw_conf_rxrf_s rfconf;
-    struct lgw_conf_rxif_s ifconf;
+    struct lgw_conf_rxif_s ifconf_list[LGW_IF_CHAIN_NB];
     struct lgw_conf_timestamp_s tsconf;
-    uint32_t sf, bw, fdev;
     bool sx1250_tx_lut;
 
-    /* try to parse JSON */
-    root_val = json_parse_file_with_comments(conf_file);
-    if (root_val == NULL) {
-        MSG("ERROR: %s is not a valid JSON file\n", conf_file);
-        exit(EXIT_FAILURE);
-    }
-
-    /* point to the gateway configuration object */
-    conf_obj = json_object_get_object(json_value_get_object(root_val), conf_obj_name);
-    if (conf_obj == NULL) {
-        MSG("INFO: %s does not contain a JSON object named %s\n", conf_file, conf_obj_name);
+    /* all the HAL configuration functions below apply to that board */
+    if (lgw_board_select(board) != LGW_HAL_SUCCESS) {
+        MSG("ERROR: %u concentrator boards at most\n", LGW_BOARD_NB);
         return -1;
-    } else {
-        MSG("INFO: %s does contain a JSON object named %s, parsing SX1302 parameters\n", conf_file, conf_obj_name);
     }
 
     /* set board configuration */
@@ -361,7 +684,54 @@ static int parse_SX130x_configuration(const char * conf_file) {
         MSG("WARNING: Data type for full_duplex seems wrong, please check\n");
         boardconf.full_duplex = false;
     }
+    val = json_object_get_value(conf_obj, "spi_speed"); /* fetch value (if possible), optional */
+    if (json_value_get_type(val) == JSONNumber) {
+        boardconf.spi_speed = (uint32_t)json_value_get_number(val);
+    } else {
+        boardconf.spi_speed = 0; /* HAL default */
+    }
+    val = json_object_get_value(conf_obj, "spi_chunk_size"); /* fetch value (if possible), optional */
+    if (json_value_get_type(val) == JSONNumber) {
+        boardconf.spi_chunk_size = (uint16_t)json_value_get_number(val);
+    } else {
+        boardconf.spi_chunk_size = 0; /* HAL default */
+    }
+    val = json_object_get_value(conf_obj, "rx_buffer_size"); /* fetch value (if possible), optional */
+    if (json_value_get_type(val) == JSONNumber) {
+        boardconf.rx_buffer_size = (uint16_t)json_value_get_number(val);
+        MSG("INFO: rx_buffer_size %u bytes\n", boardconf.rx_buffer_size);
+    } else {
+        boardconf.rx_buffer_size = 0; /* HAL default */
+    }
+    val = json_object_get_value(conf_obj, "temperature_refresh_ms"); /* fetch value (if possible), optional */
+    if (json_value_get_type(val) == JSONNumber) {
+        boardconf.temperature_refresh_ms = (uint32_t)json_value_get_number(val);
+    } else {
+        boardconf.temperature_refresh_ms = 0; /* HAL default */
+    }
+    str = json_object_get_string(conf_obj, "cal_cache_path"); /* optional */
+    if (str != NULL) {
+        strncpy(boardconf.cal_cache_path, str, sizeof boardconf.cal_cache_path);
+        boardconf.cal_cache_path[sizeof boardconf.cal_cache_path - 1] = '\0'; /* ensure string termination */
+        MSG("INFO: radio calibration cache %s\n", boardconf.cal_cache_path);
+    }
+    val = json_object_get_value(conf_obj, "fast_start"); /* fetch value (if possible), optional */
+    if (json_value_get_type(val) == JSONBoolean) {
+        boardconf.fast_start = (bool)json_value_get_boolean(val);
+        MSG("INFO: fast start %s\n", (boardconf.fast_start == true) ? "enabled" : "disabled");
+    } else {
+        boardconf.fast_start = false;
+    }
+    str = json_object_get_string(conf_obj, "rx_capture_path"); /* optional */
+    if (str != NULL) {
+        strncpy(boardconf.rx_capture_path, str, sizeof boardconf.rx_capture_path);
+        boardconf.rx_capture_path[sizeof boardconf.rx_capture_path - 1] = '\0'; /* ensure string termination */
+        MSG("INFO: RX buffer capture %s\n", boardconf.rx_capture_path);
+    }
     MSG("INFO: spidev_path %s, lorawan_public %d, clksrc %d, full_duplex %d\n", boardconf.spidev_path, boardconf.lorawan_public, boardconf.clksrc, boardconf.full_duplex);
+    if ((boardconf.spi_speed != 0) || (boardconf.spi_chunk_size != 0)) {
+        MSG("INFO: spi_speed %u, spi_chunk_size %u (0: HAL default)\n", boardconf.spi_speed, boardconf.spi_chunk_size);
+    }
     /* all parameters parsed, submitting configuration to the HAL */
     if (lgw_board_setconf(&boardconf) != LGW_HAL_SUCCESS) {
         MSG("ERROR: Failed to configure board\n");
@@ -372,13 +742,13 @@ static int parse_SX130x_configuration(const char * conf_file) {
     val = json_object_get_value(conf_obj, "antenna_gain"); /* fetch value (if possible) */
     if (val != NULL) {
         if (json_value_get_type(val) == JSONNumber) {
-            antenna_gain = (int8_t)json_value_get_number(val);
+            antenna_gain[board] = (int8_t)json_value_get_number(val);
         } else {
-            MSG("WARNING: Data type for antenna_gain seems wrong, please check\n");
-            antenna_gain = 0;
+            MSG("WARNING: Data type for antenna_gain[board] seems wrong, please check\n");
+            antenna_gain[board] = 0;
         }
     }
-    MSG("INFO: antenna_gain %d dBi\n", antenna_gain);
+    MSG("INFO: antenna_gain %d dBi\n", antenna_gain[board]);
 
     /* set timestamp configuration */
     conf_ts_obj = json_object_get_object(conf_obj, "precision_timestamp");
@@ -479,31 +849,31 @@ static int parse_SX130x_configuration(const char * conf_file) {
                 if (rfconf.tx_enable == true) {
                     /* tx is enabled on this rf chain, we need its frequency range */
                     snprintf(param_name, sizeof param_name, "radio_%i.tx_freq_min", i);
-                    tx_freq_min[i] = (uint32_t)json_object_dotget_number(conf_obj, param_name);
+                    tx_freq_min[board][i] = (uint32_t)json_object_dotget_number(conf_obj, param_name);
                     snprintf(param_name, sizeof param_name, "radio_%i.tx_freq_max", i);
-                    tx_freq_max[i] = (uint32_t)json_object_dotget_number(conf_obj, param_name);
-                    if ((tx_freq_min[i] == 0) || (tx_freq_max[i] == 0)) {
+                    tx_freq_max[board][i] = (uint32_t)json_object_dotget_number(conf_obj, param_name);
+                    if ((tx_freq_min[board][i] == 0) || (tx_freq_max[board][i] == 0)) {
                         MSG("WARNING: no frequency range specified for TX rf chain %d\n", i);
                     }
 
                     /* set configuration for tx gains */
-                    memset(&txlut[i], 0, sizeof txlut[i]); /* initialize configuration structure */
+                    memset(&txlut[board][i], 0, sizeof txlut[board][i]); /* initialize configuration structure */
                     snprintf(param_name, sizeof param_name, "radio_%i.tx_gain_lut", i);
                     conf_txlut_array = json_object_dotget_array(conf_obj, param_name);
                     if (conf_txlut_array != NULL) {
-                        txlut[i].size = json_array_get_count(conf_txlut_array);
+                        txlut[board][i].size = json_array_get_count(conf_txlut_array);
                         /* Detect if we have a sx125x or sx1250 configuration */
                         conf_txgain_obj = json_array_get_object(conf_txlut_array, 0);
                         val = json_object_dotget_value(conf_txgain_obj, "pwr_idx");
                         if (val != NULL) {
-                            printf("INFO: Configuring Tx Gain LUT for rf_chain %u with %u indexes for sx1250\n", i, txlut[i].size);
+                            printf("INFO: Configuring Tx Gain LUT for rf_chain %u with %u indexes for sx1250\n", i, txlut[board][i].size);
                             sx1250_tx_lut = true;
                         } else {
-                            printf("INFO: Configuring Tx Gain LUT for rf_chain %u with %u indexes for sx125x\n", i, txlut[i].size);
+                            printf("INFO: Configuring Tx Gain LUT for rf_chain %u with %u indexes for sx125x\n", i, txlut[board][i].size);
                             sx1250_tx_lut = false;
                         }
                         /* Parse the table */
-                        for (j = 0; j < (int)txlut[i].size; j++) {
+                        for (j = 0; j < (int)txlut[board][i].size; j++) {
                              /* Sanity check */
                             if (j >= TX_GAIN_LUT_SIZE_MAX) {
                                 printf("ERROR: TX Gain LUT [%u] index %d not supported, skip it\n", i, j);
@@ -514,61 +884,61 @@ static int parse_SX130x_configuration(const char * conf_file) {
                             /* rf power */
                             val = json_object_dotget_value(conf_txgain_obj, "rf_power");
                             if (json_value_get_type(val) == JSONNumber) {
-                                txlut[i].lut[j].rf_power = (int8_t)json_value_get_number(val);
+                                txlut[board][i].lut[j].rf_power = (int8_t)json_value_get_number(val);
                             } else {
                                 printf("WARNING: Data type for %s[%d] seems wrong, please check\n", "rf_power", j);
-                                txlut[i].lut[j].rf_power = 0;
+                                txlut[board][i].lut[j].rf_power = 0;
                             }
                             /* PA gain */
                             val = json_object_dotget_value(conf_txgain_obj, "pa_gain");
                             if (json_value_get_type(val) == JSONNumber) {
-                                txlut[i].lut[j].pa_gain = (uint8_t)json_value_get_number(val);
+                                txlut[board][i].lut[j].pa_gain = (uint8_t)json_value_get_number(val);
                             } else {
                                 printf("WARNING: Data type for %s[%d] seems wrong, please check\n", "pa_gain", j);
-                                txlut[i].lut[j].pa_gain = 0;
+                                txlut[board][i].lut[j].pa_gain = 0;
                             }
                             if (sx1250_tx_lut == false) {
                                 /* DIG gain */
                                 val = json_object_dotget_value(conf_txgain_obj, "dig_gain");
                                 if (json_value_get_type(val) == JSONNumber) {
-                                    txlut[i].lut[j].dig_gain = (uint8_t)json_value_get_number(val);
+                                    txlut[board][i].lut[j].dig_gain = (uint8_t)json_value_get_number(val);
                                 } else {
                                     printf("WARNING: Data type for %s[%d] seems wrong, please check\n", "dig_gain", j);
-                                    txlut[i].lut[j].dig_gain = 0;
+                                    txlut[board][i].lut[j].dig_gain = 0;
                                 }
                                 /* DAC gain */
                                 val = json_object_dotget_value(conf_txgain_obj, "dac_gain");
                                 if (json_value_get_type(val) == JSONNumber) {
-                                    txlut[i].lut[j].dac_gain = (uint8_t)json_value_get_number(val);
+                                    txlut[board][i].lut[j].dac_gain = (uint8_t)json_value_get_number(val);
                                 } else {
                                     printf("WARNING: Data type for %s[%d] seems wrong, please check\n", "dac_gain", j);
-                                    txlut[i].lut[j].dac_gain = 3; /* This is the only dac_gain supported for now */
+                                    txlut[board][i].lut[j].dac_gain = 3; /* This is the only dac_gain supported for now */
                                 }
                                 /* MIX gain */
                                 val = json_object_dotget_value(conf_txgain_obj, "mix_gain");
                                 if (json_value_get_type(val) == JSONNumber) {
-                                    txlut[i].lut[j].mix_gain = (uint8_t)json_value_get_number(val);
+                                    txlut[board][i].lut[j].mix_gain = (uint8_t)json_value_get_number(val);
                                 } else {
                                     printf("WARNING: Data type for %s[%d] seems wrong, please check\n", "mix_gain", j);
-                                    txlut[i].lut[j].mix_gain = 0;
+                                    txlut[board][i].lut[j].mix_gain = 0;
                                 }
                             } else {
                                 /* TODO: rework this, should not be needed for sx1250 */
-                                txlut[i].lut[j].mix_gain = 5;
+                                txlut[board][i].lut[j].mix_gain = 5;
 
                                 /* power index */
                                 val = json_object_dotget_value(conf_txgain_obj, "pwr_idx");
                                 if (json_value_get_type(val) == JSONNumber) {
-                                    txlut[i].lut[j].pwr_idx = (uint8_t)json_value_get_number(val);
+                                    txlut[board][i].lut[j].pwr_idx = (uint8_t)json_value_get_number(val);
                                 } else {
                                     printf("WARNING: Data type for %s[%d] seems wrong, please check\n", "pwr_idx", j);
-                                    txlut[i].lut[j].pwr_idx = 0;
+                                    txlut[board][i].lut[j].pwr_idx = 0;
                                 }
                             }
                         }
                         /* all parameters parsed, submitting configuration to the HAL */
-                        if (txlut[i].size > 0) {
-                            if (lgw_txgain_setconf(i, &txlut[i]) != LGW_HAL_SUCCESS) {
+                        if (txlut[board][i].size > 0) {
+                            if (lgw_txgain_setconf(i, &txlut[board][i]) != LGW_HAL_SUCCESS) {
                                 MSG("ERROR: Failed to configure concentrator TX Gain LUT for rf_chain %u\n", i);
                                 return -1;
                             }
@@ -591,160 +961,142 @@ static int parse_SX130x_configuration(const char * conf_file) {
         }
     }
 
-    /* set configuration for Lora multi-SF channels (bandwidth cannot be set) */
-    for (i = 0; i < LGW_MULTI_NB; ++i) {
-        memset(&ifconf, 0, sizeof ifconf); /* initialize configuration structure */
-        snprintf(param_name, sizeof param_name, "chan_multiSF_%i", i); /* compose parameter path inside JSON structure */
-        val = json_object_get_value(conf_obj, param_name); /* fetch value (if possible) */
-        if (json_value_get_type(val) != JSONObject) {
-            MSG("INFO: no configuration for Lora multi-SF channel %i\n", i);
-            continue;
-        }
-        /* there is an object to configure that Lora multi-SF channel, let's parse it */
-        snprintf(param_name, sizeof param_name, "chan_multiSF_%i.enable", i);
-        val = json_object_dotget_value(conf_obj, param_name);
-        if (json_value_get_type(val) == JSONBoolean) {
-            ifconf.enable = (bool)json_value_get_boolean(val);
-        } else {
-            ifconf.enable = false;
+    /* set configuration for the IF+modem channels */
+    if (parse_rxif_configuration(conf_obj, ifconf_list) != 0) {
+        return -1;
+    }
+    for (i = 0; i < LGW_IF_CHAIN_NB; ++i) {
+        if (ifconf_list[i].enable == true) {
+            if_chain_nb += 1;
         }
-        if (ifconf.enable == false) { /* Lora multi-SF channel disabled, nothing else to parse */
-            MSG("INFO: Lora multi-SF channel %i disabled\n", i);
-        } else  { /* Lora multi-SF channel enabled, will parse the other parameters */
-            snprintf(param_name, sizeof param_name, "chan_multiSF_%i.radio", i);
-            ifconf.rf_chain = (uint32_t)json_object_dotget_number(conf_obj, param_name);
-            snprintf(param_name, sizeof param_name, "chan_multiSF_%i.if", i);
-            ifconf.freq_hz = (int32_t)json_object_dotget_number(conf_obj, param_name);
-            // TODO: handle individual SF enabling and disabling (spread_factor)
-            MSG("INFO: Lora multi-SF channel %i>  radio %i, IF %i Hz, 125 kHz bw, SF 5 to 12\n", i, ifconf.rf_chain, ifconf.freq_hz);
+        if (lgw_rxif_setconf(i, &ifconf_list[i]) != LGW_HAL_SUCCESS) {
+            if (i < LGW_MULTI_NB) {
+                MSG("ERROR: invalid configuration for Lora multi-SF channel %i\n", i);
+            } else if (i == 8) {
+                MSG("ERROR: invalid configuration for Lora standard channel\n");
+            } else {
+                MSG("ERROR: invalid configuration for FSK channel\n");
+            }
+            return -1;
         }
-        /* all parameters parsed, submitting configuration to the HAL */
-        if (lgw_rxif_setconf(i, &ifconf) != LGW_HAL_SUCCESS) {
-            MSG("ERROR: invalid configuration for Lora multi-SF channel %i\n", i);
+    }
+
+    return 0;
+}
+
+static int get_SX130x_objects(JSON_Value * root_val, JSON_Object ** conf_obj) {
+    const char conf_obj_name[] = "SX130x_conf";
+    JSON_Value *val;
+    JSON_Array *conf_array;
+    int i, nb;
+
+    /* a single object for one board, or an array with one object per board */
+    val = json_object_get_value(json_value_get_object(root_val), conf_obj_name);
+    if (json_value_get_type(val) == JSONObject) {
+        conf_obj[0] = json_value_get_object(val);
+        return 1;
+    }
+    if (json_value_get_type(val) != JSONArray) {
+        return 0;
+    }
+    conf_array = json_value_get_array(val);
+    nb = (int)json_array_get_count(conf_array);
+    if ((nb == 0) || (nb > LGW_BOARD_NB)) {
+        MSG("ERROR: %s array must hold from 1 to %u concentrator boards\n", conf_obj_name, LGW_BOARD_NB);
+        return -1;
+    }
+    for (i = 0; i < nb; i++) {
+        conf_obj[i] = json_array_get_object(conf_array, i);
+        if (conf_obj[i] == NULL) {
+            MSG("ERROR: %s[%d] is not a JSON object\n", conf_obj_name, i);
             return -1;
         }
     }
+    return nb;
+}
 
-    /* set configuration for Lora standard channel */
-    memset(&ifconf, 0, sizeof ifconf); /* initialize configuration structure */
-    val = json_object_get_value(conf_obj, "chan_Lora_std"); /* fetch value (if possible) */
-    if (json_value_get_type(val) != JSONObject) {
-        MSG("INFO: no configuration for Lora standard channel\n");
-    } else {
-        val = json_object_dotget_value(conf_obj, "chan_Lora_std.enable");
-        if (json_value_get_type(val) == JSONBoolean) {
-            ifconf.enable = (bool)json_value_get_boolean(val);
-        } else {
-            ifconf.enable = false;
-        }
-        if (ifconf.enable == false) {
-            MSG("INFO: Lora standard channel %i disabled\n", i);
-        } else  {
-            ifconf.rf_chain = (uint32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.radio");
-            ifconf.freq_hz = (int32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.if");
-            bw = (uint32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.bandwidth");
-            switch(bw) {
-                case 500000: ifconf.bandwidth = BW_500KHZ; break;
-                case 250000: ifconf.bandwidth = BW_250KHZ; break;
-                case 125000: ifconf.bandwidth = BW_125KHZ; break;
-                default: ifconf.bandwidth = BW_UNDEFINED;
-            }
-            sf = (uint32_t)json_object_dotget_number(conf_obj, "chan_Lora_std.spread_factor");
-            switch(sf) {
-                case  5: ifconf.datarate = DR_LORA_SF5;  break;
-                case  6: ifconf.datarate = DR_LORA_SF6;  break;
-                case  7: ifconf.datarate = DR_LORA_SF7;  break;
-                case  8: ifconf.datarate = DR_LORA_SF8;  break;
-                case  9: ifconf.datarate = DR_LORA_SF9;  break;
-                case 10: ifconf.datarate = DR_LORA_SF10; break;
-                case 11: ifconf.datarate = DR_LORA_SF11; break;
-                case 12: ifconf.datarate = DR_LORA_SF12; break;
-                default: ifconf.datarate = DR_UNDEFINED;
-            }
-            val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_hdr");
-            if (json_value_get_type(val) == JSONBoolean) {
-                ifconf.implicit_hdr = (bool)json_value_get_boolean(val);
-            } else {
-                ifconf.implicit_hdr = false;
-            }
-            if (ifconf.implicit_hdr == true) {
-                val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_payload_length");
-                if (json_value_get_type(val) == JSONNumber) {
-                    ifconf.implicit_payload_length = (uint8_t)json_value_get_number(val);
-                } else {
-                    MSG("ERROR: payload length setting is mandatory for implicit header mode\n");
-                    return -1;
-                }
-                val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_crc_en");
-                if (json_value_get_type(val) == JSONBoolean) {
-                    ifconf.implicit_crc_en = (bool)json_value_get_boolean(val);
-                } else {
-                    MSG("ERROR: CRC enable setting is mandatory for implicit header mode\n");
-                    return -1;
-                }
-                val = json_object_dotget_value(conf_obj, "chan_Lora_std.implicit_coderate");
-                if (json_value_get_type(val) == JSONNumber) {
-                    ifconf.implicit_coderate = (uint8_t)json_value_get_number(val);
-                } else {
-                    MSG("ERROR: coding rate setting is mandatory for implicit header mode\n");
-                    return -1;
-                }
-            }
+static int parse_SX130x_configuration(const char * conf_file) {
+    JSON_Value *root_val = NULL;
+    JSON_Object *conf_obj[LGW_BOARD_NB];
+    int i, x;
 
-            MSG("INFO: Lora std channel> radio %i, IF %i Hz, %u Hz bw, SF %u, %s\n", ifconf.rf_chain, ifconf.freq_hz, bw, sf, (ifconf.implicit_hdr == true) ? "Implicit header" : "Explicit header");
-        }
-        if (lgw_rxif_setconf(8, &ifconf) != LGW_HAL_SUCCESS) {
-            MSG("ERROR: invalid configuration for Lora standard channel\n");
-            return -1;
-        }
+    /* try to parse JSON */
+    root_val = json_parse_file_with_comments(conf_file);
+    if (root_val == NULL) {
+        MSG("ERROR: %s is not a valid JSON file\n", conf_file);
+        exit(EXIT_FAILURE);
     }
 
-    /* set configuration for FSK channel */
-    memset(&ifconf, 0, sizeof ifconf); /* initialize configuration structure */
-    val = json_object_get_value(conf_obj, "chan_FSK"); /* fetch value (if possible) */
-    if (json_value_get_type(val) != JSONObject) {
-        MSG("INFO: no configuration for FSK channel\n");
+    /* point to the gateway configuration objects */
+    x = get_SX130x_objects(root_val, conf_obj);
+    if (x <= 0) {
+        MSG("INFO: %s does not contain a valid JSON object named SX130x_conf\n", conf_file);
+        json_value_free(root_val);
+        return -1;
     } else {
-        val = json_object_dotget_value(conf_obj, "chan_FSK.enable");
-        if (json_value_get_type(val) == JSONBoolean) {
-            ifconf.enable = (bool)json_value_get_boolean(val);
-        } else {
-            ifconf.enable = false;
+        MSG("INFO: %s does contain a JSON object named SX130x_conf, parsing SX1302 parameters of %d board(s)\n", conf_file, x);
+    }
+    board_nb = x;
+
+    for (i = 0; i < board_nb; i++) {
+        if (board_nb > 1) {
+            MSG("INFO: board %d configuration\n", i);
         }
-        if (ifconf.enable == false) {
-            MSG("INFO: FSK channel %i disabled\n", i);
-        } else  {
-            ifconf.rf_chain = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.radio");
-            ifconf.freq_hz = (int32_t)json_object_dotget_number(conf_obj, "chan_FSK.if");
-            bw = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.bandwidth");
-            fdev = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.freq_deviation");
-            ifconf.datarate = (uint32_t)json_object_dotget_number(conf_obj, "chan_FSK.datarate");
+        x = parse_SX130x_board(conf_obj[i], conf_file, (lgw_handle_t)i);
+        if (x != 0) {
+            MSG("ERROR: invalid configuration for board %d\n", i);
+            break;
+        }
+    }
+    lgw_board_select(0);
+    json_value_free(root_val);
 
-            /* if chan_FSK.bandwidth is set, it has priority over chan_FSK.freq_deviation */
-            if ((bw == 0) && (fdev != 0)) {
-                bw = 2 * fdev + ifconf.datarate;
-            }
-            if      (bw == 0)      ifconf.bandwidth = BW_UNDEFINED;
-#if 0 /* TODO */
-            else if (bw <= 7800)   ifconf.bandwidth = BW_7K8HZ;
-            else if (bw <= 15600)  ifconf.bandwidth = BW_15K6HZ;
-            else if (bw <= 31200)  ifconf.bandwidth = BW_31K2HZ;
-            else if (bw <= 62500)  ifconf.bandwidth = BW_62K5HZ;
-#endif
-            else if (bw <= 125000) ifconf.bandwidth = BW_125KHZ;
-            else if (bw <= 250000) ifconf.bandwidth = BW_250KHZ;
-            else if (bw <= 500000) ifconf.bandwidth = BW_500KHZ;
-            else ifconf.bandwidth = BW_UNDEFINED;
+    return x;
+}
 
-            MSG("INFO: FSK channel> radio %i, IF %i Hz, %u Hz bw, %u bps datarate\n", ifconf.rf_chain, ifconf.freq_hz, bw, ifconf.datarate);
-        }
-        if (lgw_rxif_setconf(9, &ifconf) != LGW_HAL_SUCCESS) {
-            MSG("ERROR: invalid configuration for FSK channel\n");
+static int reload_rxif_configuration(const char * conf_file) {
+    JSON_Value *root_val;
+    JSON_Object *conf_obj[LGW_BOARD_NB];
+    struct lgw_conf_rxif_s ifconf_list[LGW_BOARD_NB][LGW_IF_CHAIN_NB];
+    int i, x;
+
+    /* the running configuration is kept on any error */
+    root_val = json_parse_file_with_comments(conf_file);
+    if (root_val == NULL) {
+        MSG("ERROR: [main] %s is not a valid JSON file, channel plan not reloaded\n", conf_file);
+        return -1;
+    }
+    x = get_SX130x_objects(root_val, conf_obj);
+    if (x != board_nb) {
+        MSG("ERROR: [main] %s does not contain a JSON object named SX130x_conf for each of the %d board(s), channel plan not reloaded\n", conf_file, board_nb);
+        json_value_free(root_val);
+        return -1;
+    }
+    for (i = 0; i < board_nb; i++) {
+        x = parse_rxif_configuration(conf_obj[i], ifconf_list[i]);
+        if (x != 0) {
+            MSG("ERROR: [main] invalid channel for board %d in %s, channel plan not reloaded\n", i, conf_file);
+            json_value_free(root_val);
             return -1;
         }
     }
     json_value_free(root_val);
 
+    /* radios and board settings are only applied by a restart */
+    x = 0;
+    for (i = 0; i < board_nb; i++) {
+        lgw_board_select((lgw_handle_t)i);
+        if (lgw_rxif_reconf(ifconf_list[i]) != LGW_HAL_SUCCESS) {
+            MSG("ERROR: [main] channel plan of board %d in %s rejected by the HAL, previous one kept\n", i, conf_file);
+            x = -1;
+        }
+    }
+    lgw_board_select(0);
+    if (x != 0) {
+        return -1;
+    }
+    MSG("INFO: [main] channel plan reloaded from %s\n", conf_file);
+
     return 0;
 }
 
@@ -753,8 +1105,17 @@ static int parse_gateway_configuration(const char * conf_file) {
     JSON_Value *root_val;
     JSON_Object *conf_obj = NULL;
     JSON_Value *val = NULL; /* needed to detect the absence of some fields */
+    JSON_Array *conf_array = NULL;
+    JSON_Object *conf_srv = NULL;
     const char *str; /* pointer to sub-strings in the JSON data */
     unsigned long long ull = 0;
+    int prefix_len = 0;
+    JSON_Object *conf_thr = NULL;
+    JSON_Object *conf_sched = NULL;
+    struct rtsched_conf_s schedconf;
+    int cpu;
+    size_t i;
+    int j;
 
     /* try to parse JSON */
     root_val = json_parse_file_with_comments(conf_file);
@@ -800,6 +1161,43 @@ static int parse_gateway_configuration(const char * conf_file) {
         MSG("INFO: downstream port is configured to \"%s\"\n", serv_port_down);
     }
 
+    /* servers receiving a copy of the upstream traffic, no downstream (optional) */
+    conf_array = json_object_get_array(conf_obj, "uplink_servers");
+    if (conf_array != NULL) {
+        for (i = 0; i < json_array_get_count(conf_array); i++) {
+            if (up_server_nb == UP_SERVER_MAX) {
+                MSG("WARNING: too many uplink servers, only %d used\n", UP_SERVER_MAX - 1);
+                break;
+            }
+            conf_srv = json_array_get_object(conf_array, i);
+            str = json_object_get_string(conf_srv, "server_address");
+            val = json_object_get_value(conf_srv, "serv_port_up");
+            if ((str == NULL) || (val == NULL)) {
+                MSG("WARNING: uplink server %u needs \"server_address\" and \"serv_port_up\", ignored\n", (unsigned)i);
+                continue;
+            }
+            strncpy(up_server[up_server_nb].addr, str, sizeof up_server[up_server_nb].addr);
+            up_server[up_server_nb].addr[sizeof up_server[up_server_nb].addr - 1] = '\0'; /* ensure string termination */
+            snprintf(up_server[up_server_nb].port_up, sizeof up_server[up_server_nb].port_up, "%u", (uint16_t)json_value_get_number(val));
+            MSG("INFO: upstream traffic also sent to \"%s\" (port %s)\n", up_server[up_server_nb].addr, up_server[up_server_nb].port_up);
+            up_server_nb += 1;
+        }
+    }
+
+    /* get payload format of the UDP protocol (optional) */
+    str = json_object_get_string(conf_obj, "protocol_format");
+    if (str != NULL) {
+        if (strcmp(str, "binary") == 0) {
+            protocol_version = PROTOCOL_VERSION_BIN;
+        } else if (strcmp(str, "json") == 0) {
+            protocol_version = PROTOCOL_VERSION;
+        } else {
+            MSG("WARNING: invalid protocol_format \"%s\", using JSON\n", str);
+            protocol_version = PROTOCOL_VERSION;
+        }
+        MSG("INFO: protocol payloads are configured to %s (protocol version %u)\n", (protocol_version == PROTOCOL_VERSION_BIN) ? "binary" : "JSON", protocol_version);
+    }
+
     /* get keep-alive interval (in seconds) for downstream (optional) */
     val = json_object_get_value(conf_obj, "keepalive_interval");
     if (val != NULL) {
@@ -817,8 +1215,68 @@ static int parse_gateway_configuration(const char * conf_file) {
     /* get time-out value (in ms) for upstream datagrams (optional) */
     val = json_object_get_value(conf_obj, "push_timeout_ms");
     if (val != NULL) {
-        push_timeout_half.tv_usec = 500 * (long int)json_value_get_number(val);
-        MSG("INFO: upstream PUSH_DATA time-out is configured to %u ms\n", (unsigned)(push_timeout_half.tv_usec / 500));
+        push_timeout_ms = (unsigned)json_value_get_number(val);
+        MSG("INFO: upstream PUSH_DATA time-out is configured to %u ms\n", push_timeout_ms);
+    }
+
+    /* uplink latency tracing (optional) */
+    val = json_object_get_value(conf_obj, "uplink_trace");
+    if (json_value_get_type(val) == JSONBoolean) {
+        uptrace_enable = (bool)json_value_get_boolean(val);
+    }
+    str = json_object_get_string(conf_obj, "uplink_trace_file");
+    if (str != NULL) {
+        strncpy(uptrace_path, str, sizeof uptrace_path);
+        uptrace_path[sizeof uptrace_path - 1] = '\0'; /* ensure string termination */
+    }
+    if (uptrace_enable == true) {
+        MSG("INFO: uplink latency tracing is enabled%s%s\n", (uptrace_path[0] != '\0') ? ", samples dumped to " : "", uptrace_path);
+    }
+
+    /* metrics exporter (optional) */
+    val = json_object_get_value(conf_obj, "metrics_port");
+    if ((json_value_get_type(val) == JSONNumber) && (json_value_get_number(val) > 0)) {
+        snprintf(metrics_port, sizeof metrics_port, "%u", (uint16_t)json_value_get_number(val));
+    }
+    str = json_object_get_string(conf_obj, "metrics_address");
+    if (str != NULL) {
+        strncpy(metrics_address, str, sizeof metrics_address);
+        metrics_address[sizeof metrics_address - 1] = '\0'; /* ensure string termination */
+    }
+    if (metrics_port[0] != '\0') {
+        MSG("INFO: metrics are served on %s port %s\n", metrics_address, metrics_port);
+    }
+
+    /* threads scheduling (optional) */
+    val = json_object_get_value(conf_obj, "mlockall");
+    if (json_value_get_type(val) == JSONBoolean) {
+        mem_lock = (bool)json_value_get_boolean(val);
+    }
+    MSG("INFO: process memory will%s be locked in RAM\n", (mem_lock ? "" : " NOT"));
+    conf_thr = json_object_get_object(conf_obj, "threads");
+    for (j = 0; (conf_thr != NULL) && (j < RTSCHED_THREAD_NB); j++) {
+        conf_sched = json_object_get_object(conf_thr, rtsched_name(j));
+        if (conf_sched == NULL) {
+            continue;
+        }
+        memset(&schedconf, 0, sizeof schedconf);
+        conf_array = json_object_get_array(conf_sched, "cpus");
+        for (i = 0; (conf_array != NULL) && (i < json_array_get_count(conf_array)); i++) {
+            cpu = (int)json_array_get_number(conf_array, i);
+            if ((json_value_get_type(json_array_get_value(conf_array, i)) != JSONNumber) || (cpu < 0) || (cpu >= RTSCHED_CPU_MAX)) {
+                MSG("ERROR: invalid CPU in %s thread configuration, 0 to %d expected\n", rtsched_name(j), RTSCHED_CPU_MAX - 1);
+                return -1;
+            }
+            schedconf.cpus |= 1u << cpu;
+        }
+        val = json_object_get_value(conf_sched, "priority");
+        if (json_value_get_type(val) == JSONNumber) {
+            schedconf.priority = (int)json_value_get_number(val);
+        }
+        if (rtsched_setconf(j, &schedconf) != 0) {
+            return -1;
+        }
+        MSG("INFO: %s thread CPU mask 0x%X, SCHED_FIFO priority %d\n", rtsched_name(j), schedconf.cpus, schedconf.priority);
     }
 
     /* packet filtering parameters */
@@ -838,6 +1296,72 @@ static int parse_gateway_configuration(const char * conf_file) {
     }
     MSG("INFO: packets received with no CRC will%s be forwarded\n", (fwd_nocrc_pkt ? "" : " NOT"));
 
+    /* the packets not forwarded are dropped by the HAL, as soon as they are parsed */
+    rxfilter.crc_ok = fwd_valid_pkt;
+    rxfilter.crc_bad = fwd_error_pkt;
+    rxfilter.no_crc = fwd_nocrc_pkt;
+    val = json_object_get_value(conf_obj, "dedup_window_ms"); /* optional */
+    if (json_value_get_type(val) == JSONNumber) {
+        rxfilter.dedup_window_us = (uint32_t)json_value_get_number(val) * 1000;
+        MSG("INFO: packets with the same payload as a packet received less than %u ms before are dropped\n", rxfilter.dedup_window_us / 1000);
+    }
+    val = json_object_get_value(conf_obj, "board_dedup_ms"); /* optional, for several boards */
+    if (json_value_get_type(val) == JSONNumber) {
+        xdedup_hold_ms = (unsigned)json_value_get_number(val);
+    }
+    rxfilter.devaddr_mode = LGW_FILTER_DEVADDR_OFF;
+    conf_array = json_object_get_array(conf_obj, "devaddr_allow");
+    if (conf_array != NULL) {
+        rxfilter.devaddr_mode = LGW_FILTER_DEVADDR_ALLOW;
+    } else {
+        conf_array = json_object_get_array(conf_obj, "devaddr_deny");
+        if (conf_array != NULL) {
+            rxfilter.devaddr_mode = LGW_FILTER_DEVADDR_DENY;
+        }
+    }
+    if (conf_array != NULL) {
+        rxfilter.devaddr_nb = 0;
+        for (i = 0; i < json_array_get_count(conf_array); i++) {
+            str = json_array_get_string(conf_array, i);
+            if ((str == NULL) || (sscanf(str, "%llx", &ull) != 1) || (ull > 0xFFFFFFFF)) {
+                MSG("ERROR: invalid DevAddr %s in %s, 8 hexadecimal digits expected\n", (str != NULL) ? str : "?", (rxfilter.devaddr_mode == LGW_FILTER_DEVADDR_ALLOW) ? "devaddr_allow" : "devaddr_deny");
+                return -1;
+            }
+            if (rxfilter.devaddr_nb >= LGW_FILTER_DEVADDR_MAX) {
+                MSG("WARNING: only the first %u DevAddr are filtered\n", LGW_FILTER_DEVADDR_MAX);
+                break;
+            }
+            rxfilter.devaddr[rxfilter.devaddr_nb++] = (uint32_t)ull;
+        }
+        MSG("INFO: data frames %s %u DevAddr are dropped\n", (rxfilter.devaddr_mode == LGW_FILTER_DEVADDR_ALLOW) ? "not from the" : "from the", rxfilter.devaddr_nb);
+    }
+
+    /* NetID (6 hex digits) or DevAddr prefix ("26000000/7") filter (optional) */
+    conf_array = json_object_get_array(conf_obj, "prefix_allow");
+    netfilt_init(&netfilt, true);
+    if (conf_array == NULL) {
+        conf_array = json_object_get_array(conf_obj, "prefix_deny");
+        netfilt_init(&netfilt, false);
+    }
+    if (conf_array != NULL) {
+        for (i = 0; i < json_array_get_count(conf_array); i++) {
+            str = json_array_get_string(conf_array, i);
+            if ((str != NULL) && (sscanf(str, "%llx/%d", &ull, &prefix_len) == 2) && (ull <= 0xFFFFFFFF)) {
+                j = netfilt_add_prefix(&netfilt, (uint32_t)ull, prefix_len);
+            } else if ((str != NULL) && (strlen(str) == 6) && (sscanf(str, "%llx", &ull) == 1)) {
+                j = netfilt_add_netid(&netfilt, (uint32_t)ull);
+            } else {
+                j = -1;
+            }
+            if (j != 0) {
+                MSG("ERROR: invalid prefix %s in %s, NetID (6 hexadecimal digits) or DevAddr/length expected\n", (str != NULL) ? str : "?", netfilt.allow ? "prefix_allow" : "prefix_deny");
+                return -1;
+            }
+        }
+        netfilt_build(&netfilt);
+        MSG("INFO: data frames %s %d DevAddr ranges are not forwarded\n", netfilt.allow ? "out of the" : "in the", netfilt.nb);
+    }
+
     /* GPS module TTY path (optional) */
     str = json_object_get_string(conf_obj, "gps_tty_path");
     if (str != NULL) {
@@ -1016,65 +1540,522 @@ static int parse_debug_configuration(const char * conf_file) {
     return 0;
 }
 
-static uint16_t crc16(const uint8_t * data, unsigned size) {
-    const uint16_t crc_poly = 0x1021;
-    const uint16_t init_val = 0x0000;
-    uint16_t x = init_val;
-    unsigned i, j;
+static double difftimespec(struct timespec end, struct timespec beginning) {
+    double x;
 
-    if (data == NULL)  {
-        return 0;
+    x = 1E-9 * (double)(end.tv_nsec - beginning.tv_nsec);
+    x += (double)(end.tv_sec - beginning.tv_sec);
+
+    return x;
+}
+
+static void log_start_phase(const char * name, const struct lgw_start_phase_s * phase) {
+    MSG("INFO: [main]   %-14s %6u ms %7u SPI transfers\n", name, phase->duration_us / 1000, phase->spi_transfers);
+}
+
+static bool get_rx_stats_boards(struct lgw_rx_stats_s * stats) {
+    struct lgw_rx_stats_s st;
+    int i;
+
+    /* counters of all the boards, high-water mark of the fullest RX buffer */
+    memset(stats, 0, sizeof *stats);
+    for (i = 0; i < board_nb; i++) {
+        lgw_board_select((lgw_handle_t)i);
+        if (lgw_get_rx_stats(&st, true) != LGW_HAL_SUCCESS) {
+            lgw_board_select(0);
+            return false;
+        }
+        stats->nb_fetch += st.nb_fetch;
+        stats->nb_bytes += st.nb_bytes;
+        if (st.level_max > stats->level_max) {
+            stats->level_max = st.level_max;
+        }
+        stats->nb_near_full += st.nb_near_full;
+        stats->nb_partial += st.nb_partial;
+        stats->nb_pkt_left += st.nb_pkt_left;
+        stats->nb_drop_crc_ok += st.nb_drop_crc_ok;
+        stats->nb_drop_crc_bad += st.nb_drop_crc_bad;
+        stats->nb_drop_no_crc += st.nb_drop_no_crc;
+        stats->nb_drop_devaddr += st.nb_drop_devaddr;
+        stats->nb_drop_dup += st.nb_drop_dup;
     }
+    lgw_board_select(0);
+    return true;
+}
 
-    for (i=0; i<size; ++i) {
-        x ^= (uint16_t)data[i] << 8;
-        for (j=0; j<8; ++j) {
-            x = (x & 0x8000) ? (x<<1) ^ crc_poly : (x<<1);
+static bool get_spi_stats_boards(struct lgw_spi_stats_s * stats) {
+    struct lgw_spi_stats_s st;
+    struct lgw_spi_op_stats_s *a, *b;
+    int i, j, k, l;
+
+    /* the SPI links of the boards are merged per mux target and type of access */
+    memset(stats, 0, sizeof *stats);
+    for (i = 0; i < board_nb; i++) {
+        lgw_board_select((lgw_handle_t)i);
+        if (lgw_get_spi_stats(&st, true) != LGW_HAL_SUCCESS) {
+            lgw_board_select(0);
+            return false;
+        }
+        for (j = 0; j < LGW_SPI_MUX_TARGET_NB; j++) {
+            for (k = 0; k < LGW_SPI_OP_NB; k++) {
+                a = &stats->target[j][k];
+                b = &st.target[j][k];
+                a->transfers += b->transfers;
+                a->errors += b->errors;
+                a->bytes += b->bytes;
+                a->latency_sum_us += b->latency_sum_us;
+                if (b->latency_max_us > a->latency_max_us) {
+                    a->latency_max_us = b->latency_max_us;
+                }
+                for (l = 0; l < LGW_SPI_LAT_BIN_NB; l++) {
+                    a->latency_hist[l] += b->latency_hist[l];
+                }
+            }
         }
     }
+    lgw_board_select(0);
+    return true;
+}
 
-    return x;
+static void update_cnt_offsets(void) {
+    uint32_t cnt_ref, cnt;
+    int i;
+
+    /* counters read back-to-back, the offsets are accurate to a few SPI transfers */
+    for (i = 1; i < board_nb; i++) {
+        lgw_board_select(0);
+        if (lgw_get_instcnt(&cnt_ref) != LGW_HAL_SUCCESS) {
+            continue;
+        }
+        lgw_board_select((lgw_handle_t)i);
+        if (lgw_get_instcnt(&cnt) == LGW_HAL_SUCCESS) {
+            __atomic_store_n(&cnt_offset[i], cnt - cnt_ref, __ATOMIC_RELAXED);
+        }
+    }
+    lgw_board_select(0);
 }
 
-static double difftimespec(struct timespec end, struct timespec beginning) {
-    double x;
+static void hist_add(uint32_t * hist, int64_t * sum, const int32_t * bins, int nb_bins, int32_t value) {
+    int i;
 
-    x = 1E-9 * (double)(end.tv_nsec - beginning.tv_nsec);
-    x += (double)(end.tv_sec - beginning.tv_sec);
+    for (i = 0; i < (nb_bins - 1); i++) {
+        if (value < bins[i]) {
+            break;
+        }
+    }
+    MEAS_ADD(hist[i], 1);
+    MEAS_ADD(*sum, value);
+}
 
-    return x;
+static uint32_t meas_delta(const uint32_t * meas, uint32_t * last) {
+    uint32_t v = __atomic_load_n(meas, __ATOMIC_RELAXED);
+    uint32_t d = v - *last; /* modulo 2^32, the counters may wrap around */
+
+    *last = v;
+    return d;
 }
 
-static int send_tx_ack(uint8_t token_h, uint8_t token_l, enum jit_error_e error, int32_t error_value) {
-    uint8_t buff_ack[ACK_BUFF_SIZE]; /* buffer to give feedback to server */
-    int buff_index;
-    int j;
+static uint64_t meas_delta64(const uint64_t * meas, uint64_t * last) {
+    uint64_t v = __atomic_load_n(meas, __ATOMIC_RELAXED);
+    uint64_t d = v - *last;
 
-    /* reset buffer */
-    memset(&buff_ack, 0, sizeof buff_ack);
+    *last = v;
+    return d;
+}
 
-    /* Prepare downlink feedback to be sent to server */
-    buff_ack[0] = PROTOCOL_VERSION;
-    buff_ack[1] = token_h;
-    buff_ack[2] = token_l;
-    buff_ack[3] = PKT_TX_ACK;
-    *(uint32_t *)(buff_ack + 4) = net_mac_h;
-    *(uint32_t *)(buff_ack + 8) = net_mac_l;
-    buff_index = 12; /* 12-byte header */
+static long resident_kb(void) {
+    FILE *f;
+    long size, resident;
 
-    /* Put no JSON string if there is nothing to report */
-    if (error != JIT_ERROR_OK) {
-        /* start of JSON structure */
-        memcpy((void *)(buff_ack + buff_index), (void *)"{\"txpk_ack\":{", 13);
-        buff_index += 13;
-        /* set downlink error/warning status in JSON structure */
-        switch( error ) {
-            case JIT_ERROR_TX_POWER:
-                memcpy((void *)(buff_ack + buff_index), (void *)"\"warn\":", 7);
-                buff_index += 7;
-                break;
-            default:
-                memcpy((void *)(buff_ack + buff_index), (void *)"\"error\":", 8);
+    /* second field of statm, in pages */
+    f = fopen("/proc/self/statm", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    if (fscanf(f, "%ld %ld", &size, &resident) != 2) {
+        resident = -1;
+    }
+    fclose(f);
+
+    return (resident < 0) ? -1 : (resident * (sysconf(_SC_PAGESIZE) / 1024));
+}
+
+static int json_hist(char * dest, int size, const char * name, const uint32_t * hist, int nb_bins) {
+    int i;
+    int len;
+
+    len = snprintf(dest, size, ",\"%s\":[", name);
+    for (i = 0; i < nb_bins; i++) {
+        len += snprintf(dest + len, size - len, "%s%u", (i == 0) ? "" : ",", hist[i]);
+    }
+    len += snprintf(dest + len, size - len, "]");
+
+    return len;
+}
+
+static void metrics_add_report(const struct lgw_spi_op_stats_s * spi_op, const struct lgw_rx_stats_s * rx, const struct lgw_arb_stats_s * arb, const bool * arb_ok,
+                               const struct rtsched_stats_s * sched, const struct uptrace_report_s * up_lat) {
+    struct metrics_acc_s *a = &metrics_acc;
+    int i, j;
+
+    pthread_mutex_lock(&mx_metrics);
+    a->nb_report += 1;
+    for (i = 0; (spi_op != NULL) && (i < LGW_SPI_OP_NB); i++) {
+        a->spi_op[i].transfers += spi_op[i].transfers;
+        a->spi_op[i].errors += spi_op[i].errors;
+        a->spi_op[i].bytes += spi_op[i].bytes;
+        a->spi_op[i].latency_sum_us += spi_op[i].latency_sum_us;
+        a->spi_op[i].latency_max_us = spi_op[i].latency_max_us;
+        for (j = 0; j < LGW_SPI_LAT_BIN_NB; j++) {
+            a->spi_op[i].latency_hist[j] += spi_op[i].latency_hist[j];
+        }
+    }
+    if (rx != NULL) {
+        a->rx.nb_fetch += rx->nb_fetch;
+        a->rx.nb_bytes += rx->nb_bytes;
+        a->rx.level_max = rx->level_max;
+        a->rx.nb_near_full += rx->nb_near_full;
+        a->rx.nb_partial += rx->nb_partial;
+        a->rx.nb_pkt_left += rx->nb_pkt_left;
+        a->rx.nb_drop_crc_ok += rx->nb_drop_crc_ok;
+        a->rx.nb_drop_crc_bad += rx->nb_drop_crc_bad;
+        a->rx.nb_drop_no_crc += rx->nb_drop_no_crc;
+        a->rx.nb_drop_devaddr += rx->nb_drop_devaddr;
+        a->rx.nb_drop_dup += rx->nb_drop_dup;
+    }
+    for (i = 0; i < board_nb; i++) {
+        if (arb_ok[i] == false) {
+            continue;
+        }
+        a->arb[i].sf = arb[i].sf;
+        for (j = 0; j < LGW_MULTI_NB; j++) {
+            a->arb[i].nb_detect[j] += arb[i].nb_detect[j];
+            a->arb[i].nb_alloc[j] += arb[i].nb_alloc[j];
+        }
+    }
+    for (i = 0; i < RTSCHED_THREAD_NB; i++) {
+        a->sched_nb[i] += sched[i].nb;
+        a->sched[i] = sched[i];
+    }
+    a->up_lat = *up_lat;
+    pthread_mutex_unlock(&mx_metrics);
+}
+
+static void metrics_render(struct metrics_s * m) {
+    static const int32_t spi_lat_bins_us[LGW_SPI_LAT_BIN_NB - 1] = LGW_SPI_LAT_BINS_US;
+    static const char * spi_op_name[LGW_SPI_OP_NB] = {"w", "r", "wb", "rb"};
+    static const char * pct_name[UPTRACE_PCT_NB] = {"0.5", "0.9", "0.99", "1"};
+    static struct metrics_acc_s acc; /* only used by the metrics thread */
+    uint32_t hist[DW_LEAD_BIN_NB];
+    char lbl[64];
+    int i, j, k;
+
+    /* counters of the threads, read as they are incremented: no lock */
+    #define LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+    metrics_family(m, "lora_pkt_fwd_rx_packets_total", "counter", "Radio packets received by the concentrators and returned by the HAL, per CRC status");
+    metrics_uint(m, "lora_pkt_fwd_rx_packets_total", "crc=\"ok\"", LOAD(meas_up.nb_rx_ok));
+    metrics_uint(m, "lora_pkt_fwd_rx_packets_total", "crc=\"bad\"", LOAD(meas_up.nb_rx_bad));
+    metrics_uint(m, "lora_pkt_fwd_rx_packets_total", "crc=\"none\"", LOAD(meas_up.nb_rx_nocrc));
+    metrics_family(m, "lora_pkt_fwd_rx_if_packets_total", "counter", "Radio packets received per IF chain");
+    metrics_family(m, "lora_pkt_fwd_rx_if_airtime_seconds_total", "counter", "Time on air of the radio packets received per IF chain");
+    for (i = 0; i < LGW_IF_CHAIN_NB; i++) {
+        snprintf(lbl, sizeof lbl, "if_chain=\"%d\"", i);
+        metrics_uint(m, "lora_pkt_fwd_rx_if_packets_total", lbl, LOAD(meas_up.if_rx_rcv[i]));
+        metrics_real(m, "lora_pkt_fwd_rx_if_airtime_seconds_total", lbl, LOAD(meas_up.if_airtime_us[i]) / 1E6);
+    }
+    metrics_family(m, "lora_pkt_fwd_up_packets_forwarded_total", "counter", "Radio packets forwarded to the servers");
+    metrics_uint(m, "lora_pkt_fwd_up_packets_forwarded_total", NULL, LOAD(meas_up.up_pkt_fwd));
+    metrics_family(m, "lora_pkt_fwd_up_packets_dropped_total", "counter", "Radio packets not forwarded, per filter of the forwarder");
+    metrics_uint(m, "lora_pkt_fwd_up_packets_dropped_total", "filter=\"prefix\"", LOAD(meas_up.up_pkt_netfilt));
+    metrics_uint(m, "lora_pkt_fwd_up_packets_dropped_total", "filter=\"board_copy\"", LOAD(meas_up.up_pkt_xdedup));
+    metrics_family(m, "lora_pkt_fwd_up_payload_bytes_total", "counter", "Radio payload bytes forwarded");
+    metrics_uint(m, "lora_pkt_fwd_up_payload_bytes_total", NULL, LOAD(meas_up.up_payload_byte));
+    metrics_family(m, "lora_pkt_fwd_up_network_bytes_total", "counter", "Bytes of the PUSH_DATA datagrams, serialized once for all the servers");
+    metrics_uint(m, "lora_pkt_fwd_up_network_bytes_total", NULL, LOAD(meas_up_net.up_network_byte));
+    metrics_family(m, "lora_pkt_fwd_up_datagrams_sent_total", "counter", "PUSH_DATA datagrams sent per server");
+    metrics_family(m, "lora_pkt_fwd_up_datagrams_acked_total", "counter", "PUSH_DATA datagrams acknowledged per server");
+    for (i = 0; i < up_server_nb; i++) {
+        snprintf(lbl, sizeof lbl, "server=\"%d\"", i);
+        metrics_uint(m, "lora_pkt_fwd_up_datagrams_sent_total", lbl, LOAD(meas_up_net.srv_dgram_sent[i]));
+        metrics_uint(m, "lora_pkt_fwd_up_datagrams_acked_total", lbl, LOAD(meas_up_net.srv_ack_rcv[i]));
+    }
+
+    metrics_family(m, "lora_pkt_fwd_dw_pull_sent_total", "counter", "PULL_DATA requests sent");
+    metrics_uint(m, "lora_pkt_fwd_dw_pull_sent_total", NULL, LOAD(meas_dw.dw_pull_sent));
+    metrics_family(m, "lora_pkt_fwd_dw_pull_acked_total", "counter", "PULL_DATA requests acknowledged");
+    metrics_uint(m, "lora_pkt_fwd_dw_pull_acked_total", NULL, LOAD(meas_dw.dw_ack_rcv));
+    metrics_family(m, "lora_pkt_fwd_dw_datagrams_total", "counter", "PULL_RESP datagrams received without JSON error");
+    metrics_uint(m, "lora_pkt_fwd_dw_datagrams_total", NULL, LOAD(meas_dw.dw_dgram_rcv));
+    metrics_family(m, "lora_pkt_fwd_dw_network_bytes_total", "counter", "Bytes of the PULL_RESP datagrams received");
+    metrics_uint(m, "lora_pkt_fwd_dw_network_bytes_total", NULL, LOAD(meas_dw.dw_network_byte));
+    metrics_family(m, "lora_pkt_fwd_tx_requested_total", "counter", "Downlinks requested by the server");
+    metrics_uint(m, "lora_pkt_fwd_tx_requested_total", NULL, LOAD(meas_dw.nb_tx_requested));
+    metrics_family(m, "lora_pkt_fwd_tx_rejected_total", "counter", "Downlinks rejected by the JIT queue, per reason");
+    metrics_uint(m, "lora_pkt_fwd_tx_rejected_total", "reason=\"collision_packet\"", LOAD(meas_dw.nb_tx_rejected_collision_packet));
+    metrics_uint(m, "lora_pkt_fwd_tx_rejected_total", "reason=\"collision_beacon\"", LOAD(meas_dw.nb_tx_rejected_collision_beacon));
+    metrics_uint(m, "lora_pkt_fwd_tx_rejected_total", "reason=\"too_late\"", LOAD(meas_dw.nb_tx_rejected_too_late));
+    metrics_uint(m, "lora_pkt_fwd_tx_rejected_total", "reason=\"too_early\"", LOAD(meas_dw.nb_tx_rejected_too_early));
+    metrics_family(m, "lora_pkt_fwd_tx_late_total", "counter", "Downlinks rejected or sent too late, per part of the path to blame");
+    for (i = 0; i < DW_LATE_NB; i++) {
+        snprintf(lbl, sizeof lbl, "cause=\"%s\"", dw_late_name[i]);
+        metrics_uint(m, "lora_pkt_fwd_tx_late_total", lbl, LOAD(meas_dw.dw_late[i]) + ((i == DW_LATE_JIT) ? LOAD(meas_jit.dw_late_jit) : 0));
+    }
+    metrics_family(m, "lora_pkt_fwd_tx_sent_total", "counter", "Downlinks handed to the concentrator, per result");
+    metrics_uint(m, "lora_pkt_fwd_tx_sent_total", "result=\"ok\"", LOAD(meas_jit.nb_tx_ok));
+    metrics_uint(m, "lora_pkt_fwd_tx_sent_total", "result=\"fail\"", LOAD(meas_jit.nb_tx_fail));
+    metrics_family(m, "lora_pkt_fwd_tx_staged_total", "counter", "Downlinks programmed in the concentrator before being due");
+    metrics_uint(m, "lora_pkt_fwd_tx_staged_total", NULL, LOAD(meas_jit.nb_tx_staged));
+    metrics_family(m, "lora_pkt_fwd_beacons_total", "counter", "Beacons, per stage");
+    metrics_uint(m, "lora_pkt_fwd_beacons_total", "stage=\"queued\"", LOAD(meas_dw.nb_beacon_queued));
+    metrics_uint(m, "lora_pkt_fwd_beacons_total", "stage=\"rejected\"", LOAD(meas_dw.nb_beacon_rejected));
+    metrics_uint(m, "lora_pkt_fwd_beacons_total", "stage=\"sent\"", LOAD(meas_jit.nb_beacon_sent));
+
+    metrics_family(m, "lora_pkt_fwd_dw_proc_seconds", "histogram", "PULL_RESP reception to JIT enqueue");
+    for (i = 0; i < DW_DELAY_BIN_NB; i++) {
+        hist[i] = LOAD(meas_dw.dw_proc_hist[i]);
+    }
+    metrics_hist(m, "lora_pkt_fwd_dw_proc_seconds", NULL, dw_delay_bins_us, hist, DW_DELAY_BIN_NB, LOAD(meas_dw.dw_proc_sum_us));
+    metrics_family(m, "lora_pkt_fwd_dw_send_seconds", "histogram", "Duration of lgw_send, or lgw_tx_arm for staged downlinks");
+    for (i = 0; i < DW_DELAY_BIN_NB; i++) {
+        hist[i] = LOAD(meas_jit.dw_send_hist[i]);
+    }
+    metrics_hist(m, "lora_pkt_fwd_dw_send_seconds", NULL, dw_delay_bins_us, hist, DW_DELAY_BIN_NB, LOAD(meas_jit.dw_send_sum_us));
+    metrics_family(m, "lora_pkt_fwd_dw_lead_seconds", "histogram", "Time left before a downlink is due, when its PULL_RESP is received and when it is handed to the concentrator");
+    for (i = 0; i < DW_LEAD_BIN_NB; i++) {
+        hist[i] = LOAD(meas_dw.dw_lead_rx_hist[i]);
+    }
+    metrics_hist(m, "lora_pkt_fwd_dw_lead_seconds", "stage=\"rx\"", dw_lead_bins_us, hist, DW_LEAD_BIN_NB, LOAD(meas_dw.dw_lead_rx_sum_us));
+    for (i = 0; i < DW_LEAD_BIN_NB; i++) {
+        hist[i] = LOAD(meas_jit.dw_lead_tx_hist[i]);
+    }
+    metrics_hist(m, "lora_pkt_fwd_dw_lead_seconds", "stage=\"tx\"", dw_lead_bins_us, hist, DW_LEAD_BIN_NB, LOAD(meas_jit.dw_lead_tx_sum_us));
+
+    metrics_family(m, "lora_pkt_fwd_jit_queue_packets", "gauge", "Packets waiting in the JIT queue of each RF chain");
+    for (i = 0; i < board_nb; i++) {
+        for (j = 0; j < LGW_RF_CHAIN_NB; j++) {
+            snprintf(lbl, sizeof lbl, "board=\"%d\",rf_chain=\"%d\"", i, j);
+            metrics_uint(m, "lora_pkt_fwd_jit_queue_packets", lbl, LOAD(jit_queue[i][j].num_pkt));
+        }
+    }
+
+    #undef LOAD
+
+    /* statistics of the HAL and of the threads scheduling, updated at each report */
+    pthread_mutex_lock(&mx_metrics);
+    acc = metrics_acc;
+    pthread_mutex_unlock(&mx_metrics);
+    if (acc.nb_report == 0) {
+        return;
+    }
+
+    metrics_family(m, "lora_pkt_fwd_spi_messages_total", "counter", "SPI messages sent to the concentrators, per type of access");
+    metrics_family(m, "lora_pkt_fwd_spi_errors_total", "counter", "SPI messages that failed, per type of access");
+    metrics_family(m, "lora_pkt_fwd_spi_bytes_total", "counter", "Bytes clocked on the SPI bus, per type of access");
+    for (i = 0; i < LGW_SPI_OP_NB; i++) {
+        snprintf(lbl, sizeof lbl, "op=\"%s\"", spi_op_name[i]);
+        metrics_uint(m, "lora_pkt_fwd_spi_messages_total", lbl, acc.spi_op[i].transfers);
+        metrics_uint(m, "lora_pkt_fwd_spi_errors_total", lbl, acc.spi_op[i].errors);
+        metrics_uint(m, "lora_pkt_fwd_spi_bytes_total", lbl, acc.spi_op[i].bytes);
+    }
+    metrics_family(m, "lora_pkt_fwd_spi_latency_seconds", "histogram", "SPI message latency, per type of access");
+    for (i = 0; i < LGW_SPI_OP_NB; i++) {
+        snprintf(lbl, sizeof lbl, "op=\"%s\"", spi_op_name[i]);
+        metrics_hist(m, "lora_pkt_fwd_spi_latency_seconds", lbl, spi_lat_bins_us, acc.spi_op[i].latency_hist, LGW_SPI_LAT_BIN_NB, (int64_t)acc.spi_op[i].latency_sum_us);
+    }
+
+    metrics_family(m, "lora_pkt_fwd_rx_buffer_fetches_total", "counter", "Reads of the SX1302 RX buffers");
+    metrics_uint(m, "lora_pkt_fwd_rx_buffer_fetches_total", NULL, acc.rx.nb_fetch);
+    metrics_family(m, "lora_pkt_fwd_rx_buffer_bytes_total", "counter", "Bytes read from the SX1302 RX buffers");
+    metrics_uint(m, "lora_pkt_fwd_rx_buffer_bytes_total", NULL, acc.rx.nb_bytes);
+    metrics_family(m, "lora_pkt_fwd_rx_buffer_near_full_total", "counter", "Fetches finding an SX1302 RX buffer without room for a largest packet");
+    metrics_uint(m, "lora_pkt_fwd_rx_buffer_near_full_total", NULL, acc.rx.nb_near_full);
+    metrics_family(m, "lora_pkt_fwd_rx_buffer_level_max_bytes", "gauge", "Highest fill level of the SX1302 RX buffers during the last statistics interval");
+    metrics_uint(m, "lora_pkt_fwd_rx_buffer_level_max_bytes", NULL, acc.rx.level_max);
+    metrics_family(m, "lora_pkt_fwd_rx_filtered_total", "counter", "Radio packets dropped by the RX filter of the HAL, per reason");
+    metrics_uint(m, "lora_pkt_fwd_rx_filtered_total", "reason=\"crc_ok\"", acc.rx.nb_drop_crc_ok);
+    metrics_uint(m, "lora_pkt_fwd_rx_filtered_total", "reason=\"crc_bad\"", acc.rx.nb_drop_crc_bad);
+    metrics_uint(m, "lora_pkt_fwd_rx_filtered_total", "reason=\"no_crc\"", acc.rx.nb_drop_no_crc);
+    metrics_uint(m, "lora_pkt_fwd_rx_filtered_total", "reason=\"devaddr\"", acc.rx.nb_drop_devaddr);
+    metrics_uint(m, "lora_pkt_fwd_rx_filtered_total", "reason=\"duplicate\"", acc.rx.nb_drop_dup);
+
+    metrics_family(m, "lora_pkt_fwd_demod_detected_total", "counter", "Preambles detected per multi-SF channel, for the spreading factor counted by the SX1302");
+    metrics_family(m, "lora_pkt_fwd_demod_allocated_total", "counter", "Preamble detections given a demodulator, per multi-SF channel");
+    for (i = 0; i < board_nb; i++) {
+        if (acc.arb[i].sf == 0) {
+            continue;
+        }
+        for (j = 0; j < LGW_MULTI_NB; j++) {
+            snprintf(lbl, sizeof lbl, "board=\"%d\",channel=\"%d\",sf=\"%u\"", i, j, acc.arb[i].sf);
+            metrics_uint(m, "lora_pkt_fwd_demod_detected_total", lbl, acc.arb[i].nb_detect[j]);
+            metrics_uint(m, "lora_pkt_fwd_demod_allocated_total", lbl, acc.arb[i].nb_alloc[j]);
+        }
+    }
+
+    metrics_family(m, "lora_pkt_fwd_thread_timeouts_total", "counter", "Timed waits of each thread that expired");
+    for (i = 0; i < RTSCHED_THREAD_NB; i++) {
+        snprintf(lbl, sizeof lbl, "thread=\"%s\"", rtsched_name(i));
+        metrics_uint(m, "lora_pkt_fwd_thread_timeouts_total", lbl, acc.sched_nb[i]);
+    }
+    metrics_family(m, "lora_pkt_fwd_thread_wakeup_latency_seconds", "gauge", "Wake-up latency of each thread during the last statistics interval");
+    for (i = 0; i < RTSCHED_THREAD_NB; i++) {
+        if (acc.sched[i].nb == 0) {
+            continue;
+        }
+        snprintf(lbl, sizeof lbl, "thread=\"%s\",stat=\"avg\"", rtsched_name(i));
+        metrics_real(m, "lora_pkt_fwd_thread_wakeup_latency_seconds", lbl, acc.sched[i].avg_us / 1E6);
+        snprintf(lbl, sizeof lbl, "thread=\"%s\",stat=\"max\"", rtsched_name(i));
+        metrics_real(m, "lora_pkt_fwd_thread_wakeup_latency_seconds", lbl, acc.sched[i].max_us / 1E6);
+    }
+
+    if (acc.up_lat.nb > 0) {
+        metrics_family(m, "lora_pkt_fwd_up_latency_seconds", "gauge", "Uplink latency percentiles of each stage during the last statistics interval");
+        for (j = 0; j < UPTRACE_STAGE_NB; j++) {
+            for (k = 0; k < UPTRACE_PCT_NB; k++) {
+                snprintf(lbl, sizeof lbl, "stage=\"%s\",quantile=\"%s\"", uptrace_stage_name(j), pct_name[k]);
+                metrics_real(m, "lora_pkt_fwd_up_latency_seconds", lbl, acc.up_lat.pct_us[j][k] / 1E6);
+            }
+        }
+    }
+}
+
+static int open_socket_up(const char * addr, const char * port) {
+    int i;
+    int sock = -1;
+    struct addrinfo hints;
+    struct addrinfo *result; /* store result of getaddrinfo */
+    struct addrinfo *q; /* pointer to move into *result data */
+    char host_name[64];
+    char port_name[64];
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET; /* WA: Forcing IPv4 as AF_UNSPEC makes connection on localhost to fail */
+    hints.ai_socktype = SOCK_DGRAM;
+
+    /* look for server address w/ upstream port */
+    i = getaddrinfo(addr, port, &hints, &result);
+    if (i != 0) {
+        MSG("ERROR: [up] getaddrinfo on address %s (PORT %s) returned %s\n", addr, port, gai_strerror(i));
+        exit(EXIT_FAILURE);
+    }
+
+    /* try to open socket for upstream traffic */
+    for (q=result; q!=NULL; q=q->ai_next) {
+        sock = socket(q->ai_family, q->ai_socktype,q->ai_protocol);
+        if (sock == -1) continue; /* try next field */
+        else break; /* success, get out of loop */
+    }
+    if (q == NULL) {
+        MSG("ERROR: [up] failed to open socket to any of server %s addresses (port %s)\n", addr, port);
+        i = 1;
+        for (q=result; q!=NULL; q=q->ai_next) {
+            getnameinfo(q->ai_addr, q->ai_addrlen, host_name, sizeof host_name, port_name, sizeof port_name, NI_NUMERICHOST);
+            MSG("INFO: [up] result %i host:%s service:%s\n", i, host_name, port_name);
+            ++i;
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    /* connect so we can send/receive packet with the server only */
+    i = connect(sock, q->ai_addr, q->ai_addrlen);
+    if (i != 0) {
+        MSG("ERROR: [up] connect returned %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    freeaddrinfo(result);
+
+    return sock;
+}
+
+static int flush_tx_ack(void) {
+    struct pushq_dgram_s *dgram[DW_BATCH_MAX];
+    int i, n;
+    int sent = 0;
+
+    for (i = 0; i < tx_ack_nb; i++) {
+        dgram[i] = &tx_ack_dgram[i];
+    }
+
+    /* one sendmmsg for the whole batch, a failed datagram is dropped like a failed send */
+    while (sent < tx_ack_nb) {
+        n = pushq_send(sock_down, dgram + sent, tx_ack_nb - sent);
+        if (n <= 0) {
+            MSG("WARNING: [down] failed to send %d TX_ACK (%s)\n", tx_ack_nb - sent, strerror(errno));
+            break;
+        }
+        sent += n;
+    }
+    tx_ack_nb = 0;
+
+    return sent;
+}
+
+static int send_tx_ack(uint8_t token_h, uint8_t token_l, enum jit_error_e error, int32_t error_value, enum dw_late_e late) {
+    uint8_t *buff_ack; /* buffer to give feedback to server */
+    int buff_index;
+    int j;
+
+    /* the batch is normally sent once all its datagrams are processed */
+    if (tx_ack_nb == DW_BATCH_MAX) {
+        flush_tx_ack();
+    }
+    buff_ack = tx_ack_buff[tx_ack_nb];
+
+    /* reset buffer */
+    memset(buff_ack, 0, ACK_BUFF_SIZE);
+
+    /* Prepare downlink feedback to be sent to server */
+    buff_ack[0] = protocol_version;
+    buff_ack[1] = token_h;
+    buff_ack[2] = token_l;
+    buff_ack[3] = PKT_TX_ACK;
+    *(uint32_t *)(buff_ack + 4) = net_mac_h;
+    *(uint32_t *)(buff_ack + 8) = net_mac_l;
+    buff_index = 12; /* 12-byte header */
+
+    /* update stats, only called by thread_down */
+    switch (error) {
+        case JIT_ERROR_FULL:
+        case JIT_ERROR_COLLISION_PACKET:
+            MEAS_ADD(meas_dw.nb_tx_rejected_collision_packet, 1);
+            break;
+        case JIT_ERROR_TOO_LATE:
+            MEAS_ADD(meas_dw.nb_tx_rejected_too_late, 1);
+            if (late < DW_LATE_NB) {
+                MEAS_ADD(meas_dw.dw_late[late], 1);
+            }
+            break;
+        case JIT_ERROR_TOO_EARLY:
+            MEAS_ADD(meas_dw.nb_tx_rejected_too_early, 1);
+            break;
+        case JIT_ERROR_COLLISION_BEACON:
+            MEAS_ADD(meas_dw.nb_tx_rejected_collision_beacon, 1);
+            break;
+        default:
+            break;
+    }
+
+    /* Put no payload if there is nothing to report */
+    if ((error != JIT_ERROR_OK) && (protocol_version == PROTOCOL_VERSION_BIN)) {
+        j = bin_txpk_ack_write(error, error_value, buff_ack + buff_index, ACK_BUFF_SIZE - buff_index);
+        if (j > 0) {
+            buff_index += j;
+        } else {
+            MSG("ERROR: [up] bin_txpk_ack_write failed line %u\n", (__LINE__ - 4));
+            exit(EXIT_FAILURE);
+        }
+    } else if (error != JIT_ERROR_OK) {
+        /* start of JSON structure */
+        memcpy((void *)(buff_ack + buff_index), (void *)"{\"txpk_ack\":{", 13);
+        buff_index += 13;
+        /* set downlink error/warning status in JSON structure */
+        switch( error ) {
+            case JIT_ERROR_TX_POWER:
+                memcpy((void *)(buff_ack + buff_index), (void *)"\"warn\":", 7);
+                buff_index += 7;
+                break;
+            default:
+                memcpy((void *)(buff_ack + buff_index), (void *)"\"error\":", 8);
                 buff_index += 8;
                 break;
         }
@@ -1084,34 +2065,18 @@ static int send_tx_ack(uint8_t token_h, uint8_t token_l, enum jit_error_e error,
             case JIT_ERROR_COLLISION_PACKET:
                 memcpy((void *)(buff_ack + buff_index), (void *)"\"COLLISION_PACKET\"", 18);
                 buff_index += 18;
-                /* update stats */
-                pthread_mutex_lock(&mx_meas_dw);
-                meas_nb_tx_rejected_collision_packet += 1;
-                pthread_mutex_unlock(&mx_meas_dw);
                 break;
             case JIT_ERROR_TOO_LATE:
                 memcpy((void *)(buff_ack + buff_index), (void *)"\"TOO_LATE\"", 10);
                 buff_index += 10;
-                /* update stats */
-                pthread_mutex_lock(&mx_meas_dw);
-                meas_nb_tx_rejected_too_late += 1;
-                pthread_mutex_unlock(&mx_meas_dw);
                 break;
             case JIT_ERROR_TOO_EARLY:
                 memcpy((void *)(buff_ack + buff_index), (void *)"\"TOO_EARLY\"", 11);
                 buff_index += 11;
-                /* update stats */
-                pthread_mutex_lock(&mx_meas_dw);
-                meas_nb_tx_rejected_too_early += 1;
-                pthread_mutex_unlock(&mx_meas_dw);
                 break;
             case JIT_ERROR_COLLISION_BEACON:
                 memcpy((void *)(buff_ack + buff_index), (void *)"\"COLLISION_BEACON\"", 18);
                 buff_index += 18;
-                /* update stats */
-                pthread_mutex_lock(&mx_meas_dw);
-                meas_nb_tx_rejected_collision_beacon += 1;
-                pthread_mutex_unlock(&mx_meas_dw);
                 break;
             case JIT_ERROR_TX_FREQ:
                 memcpy((void *)(buff_ack + buff_index), (void *)"\"TX_FREQ\"", 9);
@@ -1141,6 +2106,15 @@ static int send_tx_ack(uint8_t token_h, uint8_t token_l, enum jit_error_e error,
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case JIT_ERROR_TOO_LATE:
+                j = snprintf((char *)(buff_ack + buff_index), ACK_BUFF_SIZE-buff_index, ",\"value\":%d,\"cause\":\"%s\"", error_value, (late < DW_LATE_NB) ? dw_late_name[late] : "");
+                if (j > 0) {
+                    buff_index += j;
+                } else {
+                    MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
+                    exit(EXIT_FAILURE);
+                }
+                break;
             default:
                 /* Do nothing */
                 break;
@@ -1152,8 +2126,12 @@ static int send_tx_ack(uint8_t token_h, uint8_t token_l, enum jit_error_e error,
 
     buff_ack[buff_index] = 0; /* add string terminator, for safety */
 
-    /* send datagram to server */
-    return send(sock_down, (void *)buff_ack, buff_index, 0);
+    /* queue datagram, sent to the server with the rest of the batch */
+    tx_ack_dgram[tx_ack_nb].buff = buff_ack;
+    tx_ack_dgram[tx_ack_nb].size = buff_index;
+    tx_ack_nb += 1;
+
+    return buff_index;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1161,7 +2139,7 @@ static int send_tx_ack(uint8_t token_h, uint8_t token_l, enum jit_error_e error,
 
 int main(int argc, char ** argv)
 {
-    struct sigaction sigact; /* SIGQUIT&SIGINT&SIGTERM signal handling */
+    struct sigaction sigact; /* SIGQUIT&SIGINT&SIGTERM&SIGHUP signal handling */
     int i; /* loop variable and temporary variable for return value */
     int x;
     int l, m;
@@ -1171,11 +2149,14 @@ int main(int argc, char ** argv)
     const char * conf_fname = defaut_conf_fname; /* pointer to a string we won't touch */
 
     /* threads */
+    pthread_t thrid_fetch[LGW_BOARD_NB];
     pthread_t thrid_up;
+    pthread_t thrid_up_net;
     pthread_t thrid_down;
     pthread_t thrid_gps;
     pthread_t thrid_valid;
     pthread_t thrid_jit;
+    pthread_t thrid_metrics;
 
     /* network socket creation */
     struct addrinfo hints;
@@ -1184,16 +2165,31 @@ int main(int argc, char ** argv)
     char host_name[64];
     char port_name[64];
 
+    /* JSON arena usage */
+    size_t arena_peak = 0;
+    uint32_t arena_heap = 0;
+
     /* variables to get local copies of measurements */
     uint32_t cp_nb_rx_rcv;
     uint32_t cp_nb_rx_ok;
     uint32_t cp_nb_rx_bad;
     uint32_t cp_nb_rx_nocrc;
     uint32_t cp_up_pkt_fwd;
+    uint32_t cp_up_pkt_netfilt;
+    uint32_t cp_up_pkt_xdedup;
     uint32_t cp_up_network_byte;
     uint32_t cp_up_payload_byte;
     uint32_t cp_up_dgram_sent;
     uint32_t cp_up_ack_rcv;
+    uint32_t cp_srv_dgram_sent[UP_SERVER_MAX];
+    uint32_t cp_srv_ack_rcv[UP_SERVER_MAX];
+    uint32_t cp_if_rx_rcv[LGW_IF_CHAIN_NB];
+    uint64_t cp_if_airtime_us[LGW_IF_CHAIN_NB];
+    uint64_t cp_if_sf_airtime_us[LGW_IF_CHAIN_NB][STAT_SF_NB];
+    static struct meas_up_s last_up; /* measurements at the end of the previous interval */
+    static struct meas_up_net_s last_up_net;
+    static struct meas_dw_s last_dw;
+    static struct meas_jit_s last_jit;
     uint32_t cp_dw_pull_sent;
     uint32_t cp_dw_ack_rcv;
     uint32_t cp_dw_dgram_rcv;
@@ -1201,6 +2197,7 @@ int main(int argc, char ** argv)
     uint32_t cp_dw_payload_byte;
     uint32_t cp_nb_tx_ok;
     uint32_t cp_nb_tx_fail;
+    uint32_t cp_nb_tx_staged;
     uint32_t cp_nb_tx_requested = 0;
     uint32_t cp_nb_tx_rejected_collision_packet = 0;
     uint32_t cp_nb_tx_rejected_collision_beacon = 0;
@@ -1209,16 +2206,54 @@ int main(int argc, char ** argv)
     uint32_t cp_nb_beacon_queued = 0;
     uint32_t cp_nb_beacon_sent = 0;
     uint32_t cp_nb_beacon_rejected = 0;
+    uint32_t cp_dw_late[DW_LATE_NB];
+    uint32_t cp_dw_proc_hist[DW_DELAY_BIN_NB];
+    uint32_t cp_dw_lead_rx_hist[DW_LEAD_BIN_NB];
+    uint32_t cp_dw_lead_tx_hist[DW_LEAD_BIN_NB];
+    uint32_t cp_dw_send_hist[DW_DELAY_BIN_NB];
+    unsigned cp_dw_traced;
 
     /* GPS coordinates variables */
     bool coord_ok = false;
     struct coord_s cp_gps_coord = {0.0, 0.0, 0};
 
+    /* binary status report */
+    struct bin_stat_s bin_stat;
+
+    /* channel occupancy */
+    struct timespec stat_start, stat_end;
+    int64_t stat_elapsed_us;
+    char stat_chan[STATUS_SIZE];
+    int stat_chan_size;
+    int j, k;
+
     /* SX1302 data variables */
     uint32_t trig_tstamp;
     uint32_t inst_tstamp;
     uint64_t eui;
     float temperature;
+    struct lgw_start_stats_s start_stats;
+
+    /* SPI traffic */
+    struct lgw_spi_stats_s spi_stats;
+    struct lgw_spi_op_stats_s spi_op[LGW_SPI_OP_NB];
+    struct rtsched_stats_s sched_stats[RTSCHED_THREAD_NB];
+    struct tref report_ref; /* GPS time reference, for its age */
+    uint32_t spi_target_nb[LGW_SPI_MUX_TARGET_NB];
+    bool spi_stats_ok;
+    static const char * spi_op_name[LGW_SPI_OP_NB] = {"w", "r", "wb", "rb"};
+
+    /* RX buffer fill level */
+    struct lgw_rx_stats_s rx_stats;
+    bool rx_stats_ok;
+
+    /* demodulator allocations of the multi-SF channels */
+    struct lgw_arb_stats_s arb_stats[LGW_BOARD_NB];
+    bool arb_stats_ok[LGW_BOARD_NB];
+    uint32_t arb_detect, arb_alloc;
+
+    /* uplink latency */
+    struct uptrace_report_s up_lat;
 
     /* statistics variable */
     time_t t;
@@ -1263,37 +2298,73 @@ int main(int argc, char ** argv)
         MSG("INFO: Host endianness unknown\n");
     #endif
 
+    /* JSON parsing allocates from arenas, the heap is only used when they are full */
+    jarena_setup();
+    if (jarena_init(&jarena_conf, JARENA_CONF_SIZE) != 0) {
+        MSG("WARNING: [main] configuration will be parsed on the heap\n");
+    }
+    if (jarena_init(&jarena_down, JARENA_DOWN_SIZE) != 0) {
+        MSG("WARNING: [main] downlinks will be parsed on the heap\n");
+    }
+
     /* load configuration files */
     if (access(conf_fname, R_OK) == 0) { /* if there is a global conf, parse it  */
         MSG("INFO: found configuration file %s, parsing it\n", conf_fname);
+        jarena_begin(&jarena_conf);
         x = parse_SX130x_configuration(conf_fname);
+        jarena_end(&jarena_conf);
         if (x != 0) {
             exit(EXIT_FAILURE);
         }
+        jarena_begin(&jarena_conf);
         x = parse_gateway_configuration(conf_fname);
+        jarena_end(&jarena_conf);
         if (x != 0) {
             exit(EXIT_FAILURE);
         }
+        jarena_begin(&jarena_conf);
         x = parse_debug_configuration(conf_fname);
+        jarena_end(&jarena_conf);
         if (x != 0) {
             MSG("INFO: no debug configuration\n");
         }
+        jarena_stats(&jarena_conf, &arena_peak, &arena_heap);
+        MSG("INFO: [main] configuration parsed using %zu bytes of JSON arena (%u heap allocations)\n", arena_peak, arena_heap);
     } else {
         MSG("ERROR: [main] failed to find any configuration file named %s\n", conf_fname);
         exit(EXIT_FAILURE);
     }
 
+#if LOW_MEMORY == 1
+    /* packets per fetch and datagram buffers sized to the channel plan */
+    pkt_batch_max = if_chain_nb * PKT_PER_IF_MAX;
+    if (pkt_batch_max > RXRING_SIZE) {
+        pkt_batch_max = RXRING_SIZE;
+    }
+    if (pkt_batch_max > NB_PKT_MAX) {
+        pkt_batch_max = NB_PKT_MAX;
+    }
+    if (pkt_batch_max < 1) {
+        pkt_batch_max = 1;
+    }
+    up_buff_size = TX_BUFF_SIZE(pkt_batch_max);
+#endif
+    MSG("INFO: [main] %d IF chains enabled, up to %d packets per fetch and per datagram (%u bytes buffers), RX ring of %u packets per board\n", if_chain_nb, pkt_batch_max, up_buff_size, RXRING_SIZE);
+
+    /* no GPS time reference until the first synchronization */
+    for (i = 0; i < LGW_BOARD_NB; i++) {
+        timeref_init(&time_reference_gps[i]);
+    }
+
     /* Start GPS a.s.a.p., to allow it to lock */
     if (gps_tty_path[0] != '\0') { /* do not try to open GPS device if no path set */
         i = lgw_gps_enable(gps_tty_path, "ubx7", 0, &gps_tty_fd); /* HAL only supports u-blox 7 for now */
         if (i != LGW_GPS_SUCCESS) {
             printf("WARNING: [main] impossible to open %s for GPS sync (check permissions)\n", gps_tty_path);
             gps_enabled = false;
-            gps_ref_valid = false;
         } else {
             printf("INFO: [main] TTY port %s open for GPS synchronization\n", gps_tty_path);
             gps_enabled = true;
-            gps_ref_valid = false;
         }
     }
 
@@ -1312,38 +2383,13 @@ int main(int argc, char ** argv)
     hints.ai_family = AF_INET; /* WA: Forcing IPv4 as AF_UNSPEC makes connection on localhost to fail */
     hints.ai_socktype = SOCK_DGRAM;
 
-    /* look for server address w/ upstream port */
-    i = getaddrinfo(serv_addr, serv_port_up, &hints, &result);
-    if (i != 0) {
-        MSG("ERROR: [up] getaddrinfo on address %s (PORT %s) returned %s\n", serv_addr, serv_port_up, gai_strerror(i));
-        exit(EXIT_FAILURE);
-    }
-
-    /* try to open socket for upstream traffic */
-    for (q=result; q!=NULL; q=q->ai_next) {
-        sock_up = socket(q->ai_family, q->ai_socktype,q->ai_protocol);
-        if (sock_up == -1) continue; /* try next field */
-        else break; /* success, get out of loop */
-    }
-    if (q == NULL) {
-        MSG("ERROR: [up] failed to open socket to any of server %s addresses (port %s)\n", serv_addr, serv_port_up);
-        i = 1;
-        for (q=result; q!=NULL; q=q->ai_next) {
-            getnameinfo(q->ai_addr, q->ai_addrlen, host_name, sizeof host_name, port_name, sizeof port_name, NI_NUMERICHOST);
-            MSG("INFO: [up] result %i host:%s service:%s\n", i, host_name, port_name);
-            ++i;
-        }
-        exit(EXIT_FAILURE);
+    /* open one socket per upstream server, the primary one comes from serv_addr */
+    strncpy(up_server[0].addr, serv_addr, sizeof up_server[0].addr);
+    strncpy(up_server[0].port_up, serv_port_up, sizeof up_server[0].port_up);
+    for (i = 0; i < up_server_nb; i++) {
+        up_server[i].sock = open_socket_up(up_server[i].addr, up_server[i].port_up);
     }
 
-    /* connect so we can send/receive packet with the server only */
-    i = connect(sock_up, q->ai_addr, q->ai_addrlen);
-    if (i != 0) {
-        MSG("ERROR: [up] connect returned %s\n", strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    freeaddrinfo(result);
-
     /* look for server address w/ downstream port */
     i = getaddrinfo(serv_addr, serv_port_down, &hints, &result);
     if (i != 0) {
@@ -1388,35 +2434,118 @@ int main(int argc, char ** argv)
         }
     }
 
-    /* starting the concentrator */
-    i = lgw_start();
-    if (i == LGW_HAL_SUCCESS) {
-        MSG("INFO: [main] concentrator started, packet can now be received\n");
-    } else {
-        MSG("ERROR: [main] failed to start the concentrator\n");
+    /* starting the concentrators, each board is configured and started on its own SPI link */
+    for (x = 0; x < board_nb; x++) {
+        lgw_board_select((lgw_handle_t)x);
+        i = lgw_start();
+        if (i == LGW_HAL_SUCCESS) {
+            MSG("INFO: [main] concentrator %d started, packet can now be received\n", x);
+        } else {
+            MSG("ERROR: [main] failed to start the concentrator %d\n", x);
+            exit(EXIT_FAILURE);
+        }
+
+        /* drop the packets not forwarded as soon as they are received */
+        if (lgw_rxfilter_setconf(&rxfilter) != LGW_HAL_SUCCESS) {
+            MSG("ERROR: [main] failed to configure the RX filter\n");
+            exit(EXIT_FAILURE);
+        }
+
+        /* log where the concentrator start spent its time */
+        if (lgw_get_start_stats(&start_stats) == LGW_HAL_SUCCESS) {
+            MSG("INFO: [main] concentrator %d start: %u ms, %u SPI transfers\n", x, start_stats.total.duration_us / 1000, start_stats.total.spi_transfers);
+            log_start_phase("connect", &start_stats.connect);
+            log_start_phase("calibration", &start_stats.calibration);
+            log_start_phase("  cal fw", &start_stats.cal_fw);
+            log_start_phase("radio setup", &start_stats.radio_setup);
+            log_start_phase("sx1302 config", &start_stats.sx1302_config);
+            log_start_phase("AGC fw", &start_stats.agc_fw);
+            log_start_phase("ARB fw", &start_stats.arb_fw);
+        }
+
+        /* get the concentrator EUI */
+        i = lgw_get_eui(&eui);
+        if (i != LGW_HAL_SUCCESS) {
+            printf("ERROR: failed to get concentrator %d EUI\n", x);
+        } else {
+            printf("INFO: concentrator %d EUI: 0x%016" PRIx64 "\n", x, eui);
+        }
+    }
+    lgw_board_select(0);
+
+    /* the JIT thread sleeps against the monotonic clock, immune to NTP/GPS time steps */
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond_jit_wake, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    /* datagrams are composed by the upstream thread and sent by the network thread */
+    if (pushq_init(&push_queue, up_buff_size) != 0) {
+        MSG("ERROR: [main] impossible to allocate upstream queue\n");
         exit(EXIT_FAILURE);
     }
 
-    /* get the concentrator EUI */
-    i = lgw_get_eui(&eui);
-    if (i != LGW_HAL_SUCCESS) {
-        printf("ERROR: failed to get concentrator EUI\n");
-    } else {
-        printf("INFO: concentrator EUI: 0x%016" PRIx64 "\n", eui);
+    /* packets are fetched by the fetch thread of each board and serialized by the upstream thread */
+    for (i = 0; i < board_nb; i++) {
+        if (rxring_init(&rx_ring[i]) != 0) {
+            MSG("ERROR: [main] impossible to create RX ring\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* copies of a packet received by several boards are forwarded once by the upstream thread */
+    if (board_nb == 1) {
+        xdedup_hold_ms = 0;
+    } else if (xdedup_hold_ms > 0) {
+        MSG("INFO: [main] packets received by several boards are held %u ms and forwarded once\n", xdedup_hold_ms);
+    }
+    xdedup_init(&xdedup, xdedup_hold_ms);
+    update_cnt_offsets();
+
+    if ((uptrace_enable == true) && (board_nb > 1)) {
+        MSG("WARNING: [main] uplink latency tracing only supports a single board, disabled\n");
+        uptrace_enable = false;
+    }
+    if (uptrace_init(&up_trace, uptrace_enable, (uptrace_path[0] != '\0') ? uptrace_path : NULL) != 0) {
+        MSG("ERROR: [main] impossible to start uplink tracing\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((metrics_port[0] != '\0') && (metrics_init(&metrics, metrics_address, metrics_port) != 0)) {
+        MSG("ERROR: [main] impossible to start the metrics listener\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* lock the memory allocated so far, and the stacks of the threads */
+    if ((mem_lock == true) && (rtsched_lock_memory() != 0)) {
+        MSG("ERROR: [main] impossible to lock memory\n");
+        exit(EXIT_FAILURE);
     }
 
     /* spawn threads to manage upstream and downstream */
-    i = pthread_create( &thrid_up, NULL, (void * (*)(void *))thread_up, NULL);
+    for (x = 0; x < board_nb; x++) {
+        i = rtsched_create(&thrid_fetch[x], RTSCHED_FETCH, thread_fetch);
+        if (i != 0) {
+            MSG("ERROR: [main] impossible to create fetch thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    i = rtsched_create(&thrid_up, RTSCHED_UP, thread_up);
     if (i != 0) {
         MSG("ERROR: [main] impossible to create upstream thread\n");
         exit(EXIT_FAILURE);
     }
-    i = pthread_create( &thrid_down, NULL, (void * (*)(void *))thread_down, NULL);
+    i = rtsched_create(&thrid_up_net, RTSCHED_UP_NET, thread_up_net);
+    if (i != 0) {
+        MSG("ERROR: [main] impossible to create upstream network thread\n");
+        exit(EXIT_FAILURE);
+    }
+    i = rtsched_create(&thrid_down, RTSCHED_DOWN, thread_down);
     if (i != 0) {
         MSG("ERROR: [main] impossible to create downstream thread\n");
         exit(EXIT_FAILURE);
     }
-    i = pthread_create( &thrid_jit, NULL, (void * (*)(void *))thread_jit, NULL);
+    i = rtsched_create(&thrid_jit, RTSCHED_JIT, thread_jit);
     if (i != 0) {
         MSG("ERROR: [main] impossible to create JIT thread\n");
         exit(EXIT_FAILURE);
@@ -1424,18 +2553,27 @@ int main(int argc, char ** argv)
 
     /* spawn thread to manage GPS */
     if (gps_enabled == true) {
-        i = pthread_create( &thrid_gps, NULL, (void * (*)(void *))thread_gps, NULL);
+        i = rtsched_create(&thrid_gps, RTSCHED_GPS, thread_gps);
         if (i != 0) {
             MSG("ERROR: [main] impossible to create GPS thread\n");
             exit(EXIT_FAILURE);
         }
-        i = pthread_create( &thrid_valid, NULL, (void * (*)(void *))thread_valid, NULL);
+        i = rtsched_create(&thrid_valid, RTSCHED_VALID, thread_valid);
         if (i != 0) {
             MSG("ERROR: [main] impossible to create validation thread\n");
             exit(EXIT_FAILURE);
         }
     }
 
+    /* spawn thread to serve the metrics */
+    if (metrics_port[0] != '\0') {
+        i = rtsched_create(&thrid_metrics, RTSCHED_METRICS, thread_metrics);
+        if (i != 0) {
+            MSG("ERROR: [main] impossible to create metrics thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
     /* configure signal handling */
     sigemptyset(&sigact.sa_mask);
     sigact.sa_flags = 0;
@@ -1443,37 +2581,64 @@ int main(int argc, char ** argv)
     sigaction(SIGQUIT, &sigact, NULL); /* Ctrl-\ */
     sigaction(SIGINT, &sigact, NULL); /* Ctrl-C */
     sigaction(SIGTERM, &sigact, NULL); /* default "kill" command */
+    sigaction(SIGHUP, &sigact, NULL); /* channel plan reload */
 
     /* main loop task : statistics collection */
+    clock_gettime(CLOCK_MONOTONIC, &stat_start);
     while (!exit_sig && !quit_sig) {
-        /* wait for next reporting interval */
-        wait_ms(1000 * stat_interval);
+        /* wait for next reporting interval, reloading the channel plan on request */
+        for (i = 0; (i < (int)(1000 * stat_interval / STAT_WAIT_SLICE_MS)) && !exit_sig && !quit_sig; i++) {
+            wait_ms(STAT_WAIT_SLICE_MS);
+            if (reload_sig == true) {
+                reload_sig = false;
+                jarena_begin(&jarena_conf);
+                reload_rxif_configuration(conf_fname);
+                jarena_end(&jarena_conf);
+            }
+        }
 
         /* get timestamp for statistics */
         t = time(NULL);
         strftime(stat_timestamp, sizeof stat_timestamp, "%F %T %Z", gmtime(&t));
 
-        /* access upstream statistics, copy and reset them */
-        pthread_mutex_lock(&mx_meas_up);
-        cp_nb_rx_rcv       = meas_nb_rx_rcv;
-        cp_nb_rx_ok        = meas_nb_rx_ok;
-        cp_nb_rx_bad       = meas_nb_rx_bad;
-        cp_nb_rx_nocrc     = meas_nb_rx_nocrc;
-        cp_up_pkt_fwd      = meas_up_pkt_fwd;
-        cp_up_network_byte = meas_up_network_byte;
-        cp_up_payload_byte = meas_up_payload_byte;
-        cp_up_dgram_sent   = meas_up_dgram_sent;
-        cp_up_ack_rcv      = meas_up_ack_rcv;
-        meas_nb_rx_rcv = 0;
-        meas_nb_rx_ok = 0;
-        meas_nb_rx_bad = 0;
-        meas_nb_rx_nocrc = 0;
-        meas_up_pkt_fwd = 0;
-        meas_up_network_byte = 0;
-        meas_up_payload_byte = 0;
-        meas_up_dgram_sent = 0;
-        meas_up_ack_rcv = 0;
-        pthread_mutex_unlock(&mx_meas_up);
+        /* packets dropped by the RX filter of the HAL are counted as received */
+        rx_stats_ok = get_rx_stats_boards(&rx_stats);
+
+        /* access upstream statistics, counted since the previous interval */
+        cp_nb_rx_rcv       = meas_delta(&meas_up.nb_rx_rcv, &last_up.nb_rx_rcv);
+        cp_nb_rx_ok        = meas_delta(&meas_up.nb_rx_ok, &last_up.nb_rx_ok);
+        cp_nb_rx_bad       = meas_delta(&meas_up.nb_rx_bad, &last_up.nb_rx_bad);
+        cp_nb_rx_nocrc     = meas_delta(&meas_up.nb_rx_nocrc, &last_up.nb_rx_nocrc);
+        cp_up_pkt_fwd      = meas_delta(&meas_up.up_pkt_fwd, &last_up.up_pkt_fwd);
+        cp_up_pkt_netfilt  = meas_delta(&meas_up.up_pkt_netfilt, &last_up.up_pkt_netfilt);
+        cp_up_pkt_xdedup   = meas_delta(&meas_up.up_pkt_xdedup, &last_up.up_pkt_xdedup);
+        cp_up_payload_byte = meas_delta(&meas_up.up_payload_byte, &last_up.up_payload_byte);
+        cp_up_network_byte = meas_delta(&meas_up_net.up_network_byte, &last_up_net.up_network_byte);
+        for (i = 0; i < up_server_nb; i++) {
+            cp_srv_dgram_sent[i] = meas_delta(&meas_up_net.srv_dgram_sent[i], &last_up_net.srv_dgram_sent[i]);
+            cp_srv_ack_rcv[i]    = meas_delta(&meas_up_net.srv_ack_rcv[i], &last_up_net.srv_ack_rcv[i]);
+        }
+        cp_up_dgram_sent   = cp_srv_dgram_sent[0]; /* the status report is for the primary server */
+        cp_up_ack_rcv      = cp_srv_ack_rcv[0];
+        for (i = 0; i < LGW_IF_CHAIN_NB; i++) {
+            cp_if_rx_rcv[i] = meas_delta(&meas_up.if_rx_rcv[i], &last_up.if_rx_rcv[i]);
+            cp_if_airtime_us[i] = meas_delta64(&meas_up.if_airtime_us[i], &last_up.if_airtime_us[i]);
+            for (j = 0; j < STAT_SF_NB; j++) {
+                cp_if_sf_airtime_us[i][j] = meas_delta64(&meas_up.if_sf_airtime_us[i][j], &last_up.if_sf_airtime_us[i][j]);
+            }
+        }
+        if (rx_stats_ok == true) {
+            cp_nb_rx_ok    += rx_stats.nb_drop_crc_ok + rx_stats.nb_drop_devaddr + rx_stats.nb_drop_dup;
+            cp_nb_rx_bad   += rx_stats.nb_drop_crc_bad;
+            cp_nb_rx_nocrc += rx_stats.nb_drop_no_crc;
+            cp_nb_rx_rcv   += rx_stats.nb_drop_crc_ok + rx_stats.nb_drop_devaddr + rx_stats.nb_drop_dup + rx_stats.nb_drop_crc_bad + rx_stats.nb_drop_no_crc;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stat_end);
+        stat_elapsed_us = (int64_t)(stat_end.tv_sec - stat_start.tv_sec) * 1000000 + (stat_end.tv_nsec - stat_start.tv_nsec) / 1000;
+        stat_start = stat_end;
+        if (stat_elapsed_us <= 0) {
+            stat_elapsed_us = 1;
+        }
         if (cp_nb_rx_rcv > 0) {
             rx_ok_ratio = (float)cp_nb_rx_ok / (float)cp_nb_rx_rcv;
             rx_bad_ratio = (float)cp_nb_rx_bad / (float)cp_nb_rx_rcv;
@@ -1489,39 +2654,39 @@ int main(int argc, char ** argv)
             up_ack_ratio = 0.0;
         }
 
-        /* access downstream statistics, copy and reset them */
-        pthread_mutex_lock(&mx_meas_dw);
-        cp_dw_pull_sent    =  meas_dw_pull_sent;
-        cp_dw_ack_rcv      =  meas_dw_ack_rcv;
-        cp_dw_dgram_rcv    =  meas_dw_dgram_rcv;
-        cp_dw_network_byte =  meas_dw_network_byte;
-        cp_dw_payload_byte =  meas_dw_payload_byte;
-        cp_nb_tx_ok        =  meas_nb_tx_ok;
-        cp_nb_tx_fail      =  meas_nb_tx_fail;
-        cp_nb_tx_requested                 +=  meas_nb_tx_requested;
-        cp_nb_tx_rejected_collision_packet +=  meas_nb_tx_rejected_collision_packet;
-        cp_nb_tx_rejected_collision_beacon +=  meas_nb_tx_rejected_collision_beacon;
-        cp_nb_tx_rejected_too_late         +=  meas_nb_tx_rejected_too_late;
-        cp_nb_tx_rejected_too_early        +=  meas_nb_tx_rejected_too_early;
-        cp_nb_beacon_queued   +=  meas_nb_beacon_queued;
-        cp_nb_beacon_sent     +=  meas_nb_beacon_sent;
-        cp_nb_beacon_rejected +=  meas_nb_beacon_rejected;
-        meas_dw_pull_sent = 0;
-        meas_dw_ack_rcv = 0;
-        meas_dw_dgram_rcv = 0;
-        meas_dw_network_byte = 0;
-        meas_dw_payload_byte = 0;
-        meas_nb_tx_ok = 0;
-        meas_nb_tx_fail = 0;
-        meas_nb_tx_requested = 0;
-        meas_nb_tx_rejected_collision_packet = 0;
-        meas_nb_tx_rejected_collision_beacon = 0;
-        meas_nb_tx_rejected_too_late = 0;
-        meas_nb_tx_rejected_too_early = 0;
-        meas_nb_beacon_queued = 0;
-        meas_nb_beacon_sent = 0;
-        meas_nb_beacon_rejected = 0;
-        pthread_mutex_unlock(&mx_meas_dw);
+        /* access downstream statistics, counted since the previous interval */
+        cp_dw_pull_sent    =  meas_delta(&meas_dw.dw_pull_sent, &last_dw.dw_pull_sent);
+        cp_dw_ack_rcv      =  meas_delta(&meas_dw.dw_ack_rcv, &last_dw.dw_ack_rcv);
+        cp_dw_dgram_rcv    =  meas_delta(&meas_dw.dw_dgram_rcv, &last_dw.dw_dgram_rcv);
+        cp_dw_network_byte =  meas_delta(&meas_dw.dw_network_byte, &last_dw.dw_network_byte);
+        cp_dw_payload_byte =  meas_delta(&meas_dw.dw_payload_byte, &last_dw.dw_payload_byte);
+        cp_nb_tx_ok        =  meas_delta(&meas_jit.nb_tx_ok, &last_jit.nb_tx_ok);
+        cp_nb_tx_fail      =  meas_delta(&meas_jit.nb_tx_fail, &last_jit.nb_tx_fail);
+        cp_nb_tx_staged    =  meas_delta(&meas_jit.nb_tx_staged, &last_jit.nb_tx_staged);
+        cp_nb_tx_requested                 +=  meas_delta(&meas_dw.nb_tx_requested, &last_dw.nb_tx_requested);
+        cp_nb_tx_rejected_collision_packet +=  meas_delta(&meas_dw.nb_tx_rejected_collision_packet, &last_dw.nb_tx_rejected_collision_packet);
+        cp_nb_tx_rejected_collision_beacon +=  meas_delta(&meas_dw.nb_tx_rejected_collision_beacon, &last_dw.nb_tx_rejected_collision_beacon);
+        cp_nb_tx_rejected_too_late         +=  meas_delta(&meas_dw.nb_tx_rejected_too_late, &last_dw.nb_tx_rejected_too_late);
+        cp_nb_tx_rejected_too_early        +=  meas_delta(&meas_dw.nb_tx_rejected_too_early, &last_dw.nb_tx_rejected_too_early);
+        cp_nb_beacon_queued   +=  meas_delta(&meas_dw.nb_beacon_queued, &last_dw.nb_beacon_queued);
+        cp_nb_beacon_sent     +=  meas_delta(&meas_jit.nb_beacon_sent, &last_jit.nb_beacon_sent);
+        cp_nb_beacon_rejected +=  meas_delta(&meas_dw.nb_beacon_rejected, &last_dw.nb_beacon_rejected);
+        for (i = 0; i < DW_LATE_NB; i++) {
+            cp_dw_late[i] = meas_delta(&meas_dw.dw_late[i], &last_dw.dw_late[i]);
+        }
+        cp_dw_late[DW_LATE_JIT] += meas_delta(&meas_jit.dw_late_jit, &last_jit.dw_late_jit);
+        for (i = 0; i < DW_DELAY_BIN_NB; i++) {
+            cp_dw_proc_hist[i] = meas_delta(&meas_dw.dw_proc_hist[i], &last_dw.dw_proc_hist[i]);
+            cp_dw_send_hist[i] = meas_delta(&meas_jit.dw_send_hist[i], &last_jit.dw_send_hist[i]);
+        }
+        for (i = 0; i < DW_LEAD_BIN_NB; i++) {
+            cp_dw_lead_rx_hist[i] = meas_delta(&meas_dw.dw_lead_rx_hist[i], &last_dw.dw_lead_rx_hist[i]);
+            cp_dw_lead_tx_hist[i] = meas_delta(&meas_jit.dw_lead_tx_hist[i], &last_jit.dw_lead_tx_hist[i]);
+        }
+        cp_dw_traced = 0; /* downlinks received or sent during the interval */
+        for (i = 0; i < DW_LEAD_BIN_NB; i++) {
+            cp_dw_traced += cp_dw_lead_rx_hist[i] + cp_dw_lead_tx_hist[i];
+        }
         if (cp_dw_pull_sent > 0) {
             dw_ack_ratio = (float)cp_dw_ack_rcv / (float)cp_dw_pull_sent;
         } else {
@@ -1547,45 +2712,160 @@ int main(int argc, char ** argv)
         printf("# RF packets received by concentrator: %u\n", cp_nb_rx_rcv);
         printf("# CRC_OK: %.2f%%, CRC_FAIL: %.2f%%, NO_CRC: %.2f%%\n", 100.0 * rx_ok_ratio, 100.0 * rx_bad_ratio, 100.0 * rx_nocrc_ratio);
         printf("# RF packets forwarded: %u (%u bytes)\n", cp_up_pkt_fwd, cp_up_payload_byte);
+        if (rx_stats_ok == true) {
+            printf("# RF packets dropped on reception: %u (CRC), %u (DevAddr), %u (duplicates)\n", rx_stats.nb_drop_crc_ok + rx_stats.nb_drop_crc_bad + rx_stats.nb_drop_no_crc,
+                   rx_stats.nb_drop_devaddr, rx_stats.nb_drop_dup);
+        }
+        if (netfilt.enabled == true) {
+            printf("# RF packets dropped by the NetID/DevAddr prefix filter: %u\n", cp_up_pkt_netfilt);
+        }
+        if (xdedup_hold_ms > 0) {
+            printf("# RF packets dropped as copies of an uplink held for deduplication: %u\n", cp_up_pkt_xdedup);
+        }
         printf("# PUSH_DATA datagrams sent: %u (%u bytes)\n", cp_up_dgram_sent, cp_up_network_byte);
         printf("# PUSH_DATA acknowledged: %.2f%%\n", 100.0 * up_ack_ratio);
+        for (i = 0; i < LGW_IF_CHAIN_NB; i++) {
+            if (cp_if_rx_rcv[i] > 0) {
+                printf("# IF chain %d: %u packets, %.1f ms on air (%.2f%% occupancy)\n", i, cp_if_rx_rcv[i], cp_if_airtime_us[i] / 1E3, 100.0 * cp_if_airtime_us[i] / stat_elapsed_us);
+            }
+        }
+        uptrace_report(&up_trace, &up_lat);
+        if (up_lat.nb > 0) {
+            printf("# Uplink latency of %u packets (p50/p90/p99/max, us):", up_lat.nb);
+            for (j = 0; j < UPTRACE_STAGE_NB; j++) {
+                printf(" %s %u/%u/%u/%u", uptrace_stage_name(j), up_lat.pct_us[j][UPTRACE_P50], up_lat.pct_us[j][UPTRACE_P90], up_lat.pct_us[j][UPTRACE_P99], up_lat.pct_us[j][UPTRACE_MAX]);
+            }
+            printf("\n");
+            if (up_lat.lost > 0) {
+                printf("# Uplink latency samples overwritten before the report: %u\n", up_lat.lost);
+            }
+        }
+        for (i = 1; i < up_server_nb; i++) {
+            printf("# PUSH_DATA acknowledged by %s:%s: %.2f%% (%u sent)\n", up_server[i].addr, up_server[i].port_up,
+                   (cp_srv_dgram_sent[i] > 0) ? (100.0 * cp_srv_ack_rcv[i] / cp_srv_dgram_sent[i]) : 0.0, cp_srv_dgram_sent[i]);
+        }
         printf("### [DOWNSTREAM] ###\n");
         printf("# PULL_DATA sent: %u (%.2f%% acknowledged)\n", cp_dw_pull_sent, 100.0 * dw_ack_ratio);
         printf("# PULL_RESP(onse) datagrams received: %u (%u bytes)\n", cp_dw_dgram_rcv, cp_dw_network_byte);
+        jarena_stats(&jarena_down, &arena_peak, &arena_heap);
+        printf("# JSON arena: peak %zu of %u bytes, %u heap allocations\n", arena_peak, JARENA_DOWN_SIZE, arena_heap);
         printf("# RF packets sent to concentrator: %u (%u bytes)\n", (cp_nb_tx_ok+cp_nb_tx_fail), cp_dw_payload_byte);
         printf("# TX errors: %u\n", cp_nb_tx_fail);
+        printf("# TX staged before due (only triggered then): %u\n", cp_nb_tx_staged);
         if (cp_nb_tx_requested != 0 ) {
             printf("# TX rejected (collision packet): %.2f%% (req:%u, rej:%u)\n", 100.0 * cp_nb_tx_rejected_collision_packet / cp_nb_tx_requested, cp_nb_tx_requested, cp_nb_tx_rejected_collision_packet);
             printf("# TX rejected (collision beacon): %.2f%% (req:%u, rej:%u)\n", 100.0 * cp_nb_tx_rejected_collision_beacon / cp_nb_tx_requested, cp_nb_tx_requested, cp_nb_tx_rejected_collision_beacon);
             printf("# TX rejected (too late): %.2f%% (req:%u, rej:%u)\n", 100.0 * cp_nb_tx_rejected_too_late / cp_nb_tx_requested, cp_nb_tx_requested, cp_nb_tx_rejected_too_late);
             printf("# TX rejected (too early): %.2f%% (req:%u, rej:%u)\n", 100.0 * cp_nb_tx_rejected_too_early / cp_nb_tx_requested, cp_nb_tx_requested, cp_nb_tx_rejected_too_early);
         }
+        if (cp_dw_traced > 0) {
+            printf("# TX too late: %u (server/network), %u (gateway), %u (JIT)\n", cp_dw_late[DW_LATE_NET], cp_dw_late[DW_LATE_GW], cp_dw_late[DW_LATE_JIT]);
+            printf("# Time left before TX at PULL_RESP reception (<0,<2,<5,<10,<20,<50,<100,<200,<500,>=500 ms):");
+            for (i = 0; i < DW_LEAD_BIN_NB; i++) {
+                printf(" %u", cp_dw_lead_rx_hist[i]);
+            }
+            printf("\n# Time left before TX at lgw_send (same bins):");
+            for (i = 0; i < DW_LEAD_BIN_NB; i++) {
+                printf(" %u", cp_dw_lead_tx_hist[i]);
+            }
+            printf("\n");
+        }
         printf("### SX1302 Status ###\n");
-        pthread_mutex_lock(&mx_concent);
-        i  = lgw_get_instcnt(&inst_tstamp);
-        i |= lgw_get_trigcnt(&trig_tstamp);
-        pthread_mutex_unlock(&mx_concent);
-        if (i != LGW_HAL_SUCCESS) {
-            printf("# SX1302 counter unknown\n");
-        } else {
-            printf("# SX1302 counter (INST): %u\n", inst_tstamp);
-            printf("# SX1302 counter (PPS):  %u\n", trig_tstamp);
+        for (x = 0; x < board_nb; x++) {
+            lgw_board_select((lgw_handle_t)x);
+            i  = lgw_get_instcnt(&inst_tstamp);
+            i |= lgw_get_trigcnt(&trig_tstamp);
+            if (board_nb > 1) {
+                printf("# Board %d\n", x);
+            }
+            if (i != LGW_HAL_SUCCESS) {
+                printf("# SX1302 counter unknown\n");
+            } else {
+                printf("# SX1302 counter (INST): %u\n", inst_tstamp);
+                printf("# SX1302 counter (PPS):  %u\n", trig_tstamp);
+            }
+            arb_stats_ok[x] = (lgw_get_arb_stats(&arb_stats[x], true) == LGW_HAL_SUCCESS) && (arb_stats[x].sf != 0);
+            if (arb_stats_ok[x] == true) {
+                arb_detect = 0;
+                arb_alloc = 0;
+                printf("# SF%u demodulators allocated/detected per channel:", arb_stats[x].sf);
+                for (j = 0; j < LGW_MULTI_NB; j++) {
+                    printf(" %u/%u", arb_stats[x].nb_alloc[j], arb_stats[x].nb_detect[j]);
+                    arb_detect += arb_stats[x].nb_detect[j];
+                    arb_alloc += arb_stats[x].nb_alloc[j];
+                }
+                if (arb_detect > 0) {
+                    printf(" (%.1f%% allocated)\n", 100.0 * arb_alloc / arb_detect);
+                } else {
+                    printf("\n");
+                }
+            }
+        }
+        lgw_board_select(0);
+        spi_stats_ok = get_spi_stats_boards(&spi_stats);
+        if (spi_stats_ok == true) {
+            /* merge the mux targets per type of access */
+            memset(spi_op, 0, sizeof spi_op);
+            memset(spi_target_nb, 0, sizeof spi_target_nb);
+            for (i = 0; i < LGW_SPI_MUX_TARGET_NB; i++) {
+                for (j = 0; j < LGW_SPI_OP_NB; j++) {
+                    spi_op[j].transfers += spi_stats.target[i][j].transfers;
+                    spi_op[j].errors += spi_stats.target[i][j].errors;
+                    spi_op[j].bytes += spi_stats.target[i][j].bytes;
+                    spi_op[j].latency_sum_us += spi_stats.target[i][j].latency_sum_us;
+                    if (spi_stats.target[i][j].latency_max_us > spi_op[j].latency_max_us) {
+                        spi_op[j].latency_max_us = spi_stats.target[i][j].latency_max_us;
+                    }
+                    for (k = 0; k < LGW_SPI_LAT_BIN_NB; k++) {
+                        spi_op[j].latency_hist[k] += spi_stats.target[i][j].latency_hist[k];
+                    }
+                    spi_target_nb[i] += spi_stats.target[i][j].transfers;
+                }
+            }
+            for (j = 0; j < LGW_SPI_OP_NB; j++) {
+                if (spi_op[j].transfers > 0) {
+                    printf("# SPI %-2s: %u messages, %llu bytes, %u errors, latency avg %llu us, max %u us\n", spi_op_name[j], spi_op[j].transfers,
+                           (unsigned long long)spi_op[j].bytes, spi_op[j].errors, (unsigned long long)(spi_op[j].latency_sum_us / spi_op[j].transfers), spi_op[j].latency_max_us);
+                }
+            }
+            printf("# SPI messages per target: SX1302 %u, radio A %u, radio B %u\n", spi_target_nb[0], spi_target_nb[1], spi_target_nb[2]);
+        }
+        if (rx_stats_ok == true) {
+            printf("# RX buffer: %u fetches, %llu bytes, max fill level %u bytes, %u nearly full, %u partial fetches, %u receives with packets left\n", rx_stats.nb_fetch,
+                   (unsigned long long)rx_stats.nb_bytes, rx_stats.level_max, rx_stats.nb_near_full, rx_stats.nb_partial, rx_stats.nb_pkt_left);
         }
         printf("# BEACON queued: %u\n", cp_nb_beacon_queued);
         printf("# BEACON sent so far: %u\n", cp_nb_beacon_sent);
         printf("# BEACON rejected: %u\n", cp_nb_beacon_rejected);
         printf("### [JIT] ###\n");
         /* get timestamp captured on PPM pulse  */
-        jit_print_queue (&jit_queue[0], false, DEBUG_LOG);
-        printf("#--------\n");
-        jit_print_queue (&jit_queue[1], false, DEBUG_LOG);
+        for (x = 0; x < board_nb; x++) {
+            if (x > 0) {
+                printf("#--------\n");
+            }
+            jit_print_queue (&jit_queue[x][0], false, DEBUG_LOG);
+            printf("#--------\n");
+            jit_print_queue (&jit_queue[x][1], false, DEBUG_LOG);
+        }
+        printf("### [SCHEDULING] ###\n");
+        for (i = 0; i < RTSCHED_THREAD_NB; i++) {
+            rtsched_get_stats(i, &sched_stats[i], true);
+            if (sched_stats[i].nb > 0) {
+                printf("# %-6s thread: %u timeouts, wake-up latency avg %u us, max %u us\n", rtsched_name(i), sched_stats[i].nb, sched_stats[i].avg_us, sched_stats[i].max_us);
+            }
+        }
+        i = (int)resident_kb();
+        if (i >= 0) {
+            printf("# Resident memory: %d kB\n", i);
+        }
         printf("### [GPS] ###\n");
         if (gps_enabled == true) {
-            /* no need for mutex, display is not critical */
-            if (gps_ref_valid == true) {
-                printf("# Valid time reference (age: %li sec)\n", (long)difftime(time(NULL), time_reference_gps.systime));
-            } else {
-                printf("# Invalid time reference (age: %li sec)\n", (long)difftime(time(NULL), time_reference_gps.systime));
+            for (x = 0; x < board_nb; x++) {
+                if (timeref_get(&time_reference_gps[x], &report_ref) == true) {
+                    printf("# Valid time reference (age: %li sec)\n", (long)difftime(time(NULL), report_ref.systime));
+                } else {
+                    printf("# Invalid time reference (age: %li sec)\n", (long)difftime(time(NULL), report_ref.systime));
+                }
             }
             if (coord_ok == true) {
                 printf("# GPS coordinates: latitude %.5f, longitude %.5f, altitude %i m\n", cp_gps_coord.lat, cp_gps_coord.lon, cp_gps_coord.alt);
@@ -1605,19 +2885,178 @@ int main(int argc, char ** argv)
         }
         printf("##### END #####\n");
 
+        /* per IF chain channel occupancy, only for the chains that received packets */
+        /* Note: at most ~170 characters per IF chain, stat_chan can't be truncated */
+        stat_chan_size = 0;
+        for (i = 0; i < LGW_IF_CHAIN_NB; i++) {
+            if (cp_if_rx_rcv[i] == 0) {
+                continue;
+            }
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s{\"chan\":%d,\"rxnb\":%u,\"airt\":%u,\"occu\":%.2f,\"sfat\":[",
+                                       (stat_chan_size == 0) ? ",\"ifch\":[" : ",", i, cp_if_rx_rcv[i], (uint32_t)(cp_if_airtime_us[i] / 1000), 100.0 * cp_if_airtime_us[i] / stat_elapsed_us);
+            for (j = 0; j < STAT_SF_NB; j++) {
+                stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s%u", (j == 0) ? "" : ",", (uint32_t)(cp_if_sf_airtime_us[i][j] / 1000));
+            }
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "]}");
+        }
+        if (stat_chan_size > 0) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "]");
+        }
+
+        /* SPI traffic per type of access, only for the types that were used */
+        /* Note: at most ~130 characters per type of access */
+        if (spi_stats_ok == true) {
+            i = 0;
+            for (j = 0; j < LGW_SPI_OP_NB; j++) {
+                if (spi_op[j].transfers == 0) {
+                    continue;
+                }
+                stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s{\"op\":\"%s\",\"nb\":%u,\"err\":%u,\"byte\":%llu,\"lavg\":%llu,\"lmax\":%u,\"lhst\":[",
+                                           (i == 0) ? ",\"spi\":[" : ",", spi_op_name[j], spi_op[j].transfers, spi_op[j].errors, (unsigned long long)spi_op[j].bytes,
+                                           (unsigned long long)(spi_op[j].latency_sum_us / spi_op[j].transfers), spi_op[j].latency_max_us);
+                for (k = 0; k < LGW_SPI_LAT_BIN_NB; k++) {
+                    stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s%u", (k == 0) ? "" : ",", spi_op[j].latency_hist[k]);
+                }
+                stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "]}");
+                i += 1;
+            }
+            if (i > 0) {
+                stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "],\"spit\":[%u,%u,%u]", spi_target_nb[0], spi_target_nb[1], spi_target_nb[2]);
+            }
+        }
+
+        /* RX buffer fill level, only when it was fetched */
+        if ((rx_stats_ok == true) && (rx_stats.nb_fetch > 0)) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, ",\"rxbf\":[%u,%u,%u,%u,%u]",
+                                       rx_stats.nb_fetch, rx_stats.level_max, rx_stats.nb_near_full, rx_stats.nb_partial, rx_stats.nb_pkt_left);
+        }
+
+        /* demodulator allocations, only for the boards where preambles were detected */
+        /* Note: at most ~140 characters per board */
+        j = 0;
+        for (x = 0; x < board_nb; x++) {
+            arb_detect = 0;
+            if (arb_stats_ok[x] == true) {
+                for (i = 0; i < LGW_MULTI_NB; i++) {
+                    arb_detect += arb_stats[x].nb_detect[i];
+                }
+            }
+            if (arb_detect == 0) {
+                continue;
+            }
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s{\"brd\":%d,\"sf\":%u,\"det\":[", (j == 0) ? ",\"demd\":[" : ",", x, arb_stats[x].sf);
+            for (i = 0; i < LGW_MULTI_NB; i++) {
+                stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s%u", (i == 0) ? "" : ",", arb_stats[x].nb_detect[i]);
+            }
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "],\"alc\":[");
+            for (i = 0; i < LGW_MULTI_NB; i++) {
+                stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s%u", (i == 0) ? "" : ",", arb_stats[x].nb_alloc[i]);
+            }
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "]}");
+            j += 1;
+        }
+        if (j > 0) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "]");
+        }
+
+        /* scheduling latency, only for the threads whose timed waits expired */
+        /* Note: at most ~50 characters per thread */
+        j = 0;
+        for (i = 0; i < RTSCHED_THREAD_NB; i++) {
+            if (sched_stats[i].nb == 0) {
+                continue;
+            }
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "%s{\"thrd\":\"%s\",\"nb\":%u,\"lavg\":%u,\"lmax\":%u}",
+                                       (j == 0) ? ",\"schd\":[" : ",", rtsched_name(i), sched_stats[i].nb, sched_stats[i].avg_us, sched_stats[i].max_us);
+            j += 1;
+        }
+        if (j > 0) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "]");
+        }
+
+        /* packets of foreign networks, only when the prefix filter is configured */
+        if (netfilt.enabled == true) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, ",\"rxpf\":%u", cp_up_pkt_netfilt);
+        }
+
+        /* copies of packets received by several boards, only when they are deduplicated */
+        if (xdedup_hold_ms > 0) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, ",\"rxbd\":%u", cp_up_pkt_xdedup);
+        }
+
+        /* downlink latency histograms, only when downlinks were received or sent */
+        /* Note: at most ~250 characters */
+        if (cp_dw_traced > 0) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, ",\"dwtr\":{\"late\":{\"net\":%u,\"gw\":%u,\"jit\":%u}",
+                                       cp_dw_late[DW_LATE_NET], cp_dw_late[DW_LATE_GW], cp_dw_late[DW_LATE_JIT]);
+            stat_chan_size += json_hist(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "proc", cp_dw_proc_hist, DW_DELAY_BIN_NB);
+            stat_chan_size += json_hist(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "lrx", cp_dw_lead_rx_hist, DW_LEAD_BIN_NB);
+            stat_chan_size += json_hist(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "ltx", cp_dw_lead_tx_hist, DW_LEAD_BIN_NB);
+            stat_chan_size += json_hist(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "send", cp_dw_send_hist, DW_DELAY_BIN_NB);
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "}");
+        }
+
+        /* uplink latency percentiles, only when tracing and packets were sent */
+        /* Note: at most ~300 characters */
+        if (up_lat.nb > 0) {
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, ",\"uptr\":{\"nb\":%u,\"lost\":%u", up_lat.nb, up_lat.lost);
+            for (j = 0; j < UPTRACE_STAGE_NB; j++) {
+                stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, ",\"%s\":[%u,%u,%u,%u]", uptrace_stage_name(j),
+                                           up_lat.pct_us[j][UPTRACE_P50], up_lat.pct_us[j][UPTRACE_P90], up_lat.pct_us[j][UPTRACE_P99], up_lat.pct_us[j][UPTRACE_MAX]);
+            }
+            stat_chan_size += snprintf(stat_chan + stat_chan_size, sizeof stat_chan - stat_chan_size, "}");
+        }
+
+        /* totals for the metrics thread */
+        if (metrics_port[0] != '\0') {
+            metrics_add_report((spi_stats_ok == true) ? spi_op : NULL, (rx_stats_ok == true) ? &rx_stats : NULL, arb_stats, arb_stats_ok, sched_stats, &up_lat);
+        }
+
         /* generate a JSON report (will be sent to server by upstream thread) */
         pthread_mutex_lock(&mx_stat_rep);
-        if (((gps_enabled == true) && (coord_ok == true)) || (gps_fake_enable == true)) {
-            snprintf(status_report, STATUS_SIZE, "\"stat\":{\"time\":\"%s\",\"lati\":%.5f,\"long\":%.5f,\"alti\":%i,\"rxnb\":%u,\"rxok\":%u,\"rxfw\":%u,\"ackr\":%.1f,\"dwnb\":%u,\"txnb\":%u,\"temp\":%.1f}", stat_timestamp, cp_gps_coord.lat, cp_gps_coord.lon, cp_gps_coord.alt, cp_nb_rx_rcv, cp_nb_rx_ok, cp_up_pkt_fwd, 100.0 * up_ack_ratio, cp_dw_dgram_rcv, cp_nb_tx_ok, temperature);
+        if (protocol_version == PROTOCOL_VERSION_BIN) {
+            bin_stat.coord_ok = ((gps_enabled == true) && (coord_ok == true)) || (gps_fake_enable == true);
+            bin_stat.time = t;
+            bin_stat.lati = cp_gps_coord.lat;
+            bin_stat.lon = cp_gps_coord.lon;
+            bin_stat.alti = cp_gps_coord.alt;
+            bin_stat.rxnb = cp_nb_rx_rcv;
+            bin_stat.rxok = cp_nb_rx_ok;
+            bin_stat.rxfw = cp_up_pkt_fwd;
+            bin_stat.ackr = 100.0 * up_ack_ratio;
+            bin_stat.dwnb = cp_dw_dgram_rcv;
+            bin_stat.txnb = cp_nb_tx_ok;
+            bin_stat.temp = temperature;
+            status_report_size = bin_stat_write(&bin_stat, (uint8_t *)status_report, STATUS_SIZE);
+        } else if (((gps_enabled == true) && (coord_ok == true)) || (gps_fake_enable == true)) {
+            snprintf(status_report, STATUS_SIZE, "\"stat\":{\"time\":\"%s\",\"lati\":%.5f,\"long\":%.5f,\"alti\":%i,\"rxnb\":%u,\"rxok\":%u,\"rxfw\":%u,\"ackr\":%.1f,\"dwnb\":%u,\"txnb\":%u,\"temp\":%.1f", stat_timestamp, cp_gps_coord.lat, cp_gps_coord.lon, cp_gps_coord.alt, cp_nb_rx_rcv, cp_nb_rx_ok, cp_up_pkt_fwd, 100.0 * up_ack_ratio, cp_dw_dgram_rcv, cp_nb_tx_ok, temperature);
         } else {
-            snprintf(status_report, STATUS_SIZE, "\"stat\":{\"time\":\"%s\",\"rxnb\":%u,\"rxok\":%u,\"rxfw\":%u,\"ackr\":%.1f,\"dwnb\":%u,\"txnb\":%u,\"temp\":%.1f}", stat_timestamp, cp_nb_rx_rcv, cp_nb_rx_ok, cp_up_pkt_fwd, 100.0 * up_ack_ratio, cp_dw_dgram_rcv, cp_nb_tx_ok, temperature);
+            snprintf(status_report, STATUS_SIZE, "\"stat\":{\"time\":\"%s\",\"rxnb\":%u,\"rxok\":%u,\"rxfw\":%u,\"ackr\":%.1f,\"dwnb\":%u,\"txnb\":%u,\"temp\":%.1f", stat_timestamp, cp_nb_rx_rcv, cp_nb_rx_ok, cp_up_pkt_fwd, 100.0 * up_ack_ratio, cp_dw_dgram_rcv, cp_nb_tx_ok, temperature);
+        }
+        if (protocol_version != PROTOCOL_VERSION_BIN) {
+            status_report_size = strlen(status_report);
+            if ((status_report_size + stat_chan_size + 2) <= STATUS_SIZE) {
+                memcpy(status_report + status_report_size, stat_chan, stat_chan_size);
+                status_report_size += stat_chan_size;
+            }
+            status_report[status_report_size++] = '}';
+            status_report[status_report_size] = '\0';
         }
-        report_ready = true;
+        report_ready = (status_report_size > 0);
         pthread_mutex_unlock(&mx_stat_rep);
     }
 
-    /* wait for upstream thread to finish (1 fetch cycle max) */
+    /* wait for upstream threads to finish (1 fetch cycle max) */
+    for (i = 0; i < board_nb; i++) {
+        pthread_join(thrid_fetch[i], NULL);
+    }
     pthread_join(thrid_up, NULL);
+    pthread_join(thrid_up_net, NULL); /* 1 poll cycle max */
+    uptrace_free(&up_trace);
+    if (metrics_port[0] != '\0') {
+        pthread_join(thrid_metrics, NULL); /* 1 poll cycle max */
+        metrics_free(&metrics);
+    }
     pthread_cancel(thrid_down); /* don't wait for downstream thread */
     pthread_cancel(thrid_jit); /* don't wait for jit thread */
     if (gps_enabled == true) {
@@ -1635,14 +3074,19 @@ int main(int argc, char ** argv)
     /* if an exit signal was received, try to quit properly */
     if (exit_sig) {
         /* shut down network sockets */
-        shutdown(sock_up, SHUT_RDWR);
+        for (i = 0; i < up_server_nb; i++) {
+            shutdown(up_server[i].sock, SHUT_RDWR);
+        }
         shutdown(sock_down, SHUT_RDWR);
         /* stop the hardware */
-        i = lgw_stop();
-        if (i == LGW_HAL_SUCCESS) {
-            MSG("INFO: concentrator stopped successfully\n");
-        } else {
-            MSG("WARNING: failed to stop concentrator successfully\n");
+        for (x = 0; x < board_nb; x++) {
+            lgw_board_select((lgw_handle_t)x);
+            i = lgw_stop();
+            if (i == LGW_HAL_SUCCESS) {
+                MSG("INFO: concentrator %d stopped successfully\n", x);
+            } else {
+                MSG("WARNING: failed to stop concentrator %d successfully\n", x);
+            }
         }
     }
 
@@ -1659,89 +3103,184 @@ int main(int argc, char ** argv)
 /* -------------------------------------------------------------------------- */
 /* --- THREAD 1: RECEIVING PACKETS AND FORWARDING THEM ---------------------- */
 
+static bool up_filter(const struct lgw_pkt_rx_s *p) {
+    /* basic packet filtering */
+    MEAS_ADD(meas_up.nb_rx_rcv, 1);
+    if (p->if_chain < LGW_IF_CHAIN_NB) { /* channel occupancy, whatever the packet status */
+        MEAS_ADD(meas_up.if_rx_rcv[p->if_chain], 1);
+        MEAS_ADD(meas_up.if_airtime_us[p->if_chain], p->airtime_us);
+        if ((p->modulation == MOD_LORA) && (p->datarate >= DR_LORA_SF5) && (p->datarate <= DR_LORA_SF12)) {
+            MEAS_ADD(meas_up.if_sf_airtime_us[p->if_chain][p->datarate - DR_LORA_SF5], p->airtime_us);
+        }
+    }
+    switch(p->status) {
+        case STAT_CRC_OK:
+            MEAS_ADD(meas_up.nb_rx_ok, 1);
+            if (!fwd_valid_pkt) {
+                return false; /* skip that packet */
+            }
+            break;
+        case STAT_CRC_BAD:
+            MEAS_ADD(meas_up.nb_rx_bad, 1);
+            if (!fwd_error_pkt) {
+                return false; /* skip that packet */
+            }
+            break;
+        case STAT_NO_CRC:
+            MEAS_ADD(meas_up.nb_rx_nocrc, 1);
+            if (!fwd_nocrc_pkt) {
+                return false; /* skip that packet */
+            }
+            break;
+        default:
+            MSG("WARNING: [up] received packet with unknown status %u (size %u, modulation %u, BW %u, DR %u, RSSI %.1f)\n", p->status, p->size, p->modulation, p->bandwidth, p->datarate, p->rssic);
+            return false; /* skip that packet */
+            // exit(EXIT_FAILURE);
+    }
+    if (netfilt_forward(&netfilt, p) == false) {
+        MEAS_ADD(meas_up.up_pkt_netfilt, 1);
+        return false; /* foreign network */
+    }
+    return true;
+}
+
+static uint32_t up_common_time(const struct lgw_pkt_rx_s *p, int board, bool gps_ok, const struct tref *ref) {
+    struct timespec gps_time;
+
+    /* GPS time when every board is synchronized, the counter of board 0 otherwise */
+    if ((gps_ok == true) && (lgw_cnt2gps(ref[board], p->count_us, &gps_time) == LGW_GPS_SUCCESS)) {
+        return (uint32_t)((uint64_t)gps_time.tv_sec * 1000000 + (uint64_t)(gps_time.tv_nsec / 1000));
+    }
+    return p->count_us - __atomic_load_n(&cnt_offset[board], __ATOMIC_RELAXED);
+}
+
 void thread_up(void) {
     int i, j, k; /* loop variables */
     unsigned pkt_in_dgram; /* nb on Lora packet in the current datagram */
     char stat_timestamp[24];
     time_t t;
 
-    /* allocate memory for packet fetching and processing */
-    struct lgw_pkt_rx_s rxpkt[NB_PKT_MAX]; /* array containing inbound packets + metadata */
+    /* packets are processed in place, in the RX ring, or copied from the cross-board deduplication */
+    struct lgw_pkt_rx_s *rxpkt; /* array containing inbound packets + metadata */
     struct lgw_pkt_rx_s *p; /* pointer on a RX packet */
     int nb_pkt;
-
-    /* local copy of GPS time reference */
-    bool ref_ok = false; /* determine if GPS time reference must be used or not */
-    struct tref local_ref; /* time reference used for UTC <-> timestamp conversion */
+    struct lgw_pkt_rx_s *fwd_pkt[NB_PKT_MAX]; /* packets to be serialized in the datagram */
+    int fwd_board[NB_PKT_MAX]; /* their concentrator board */
+    int fwd_idx[NB_PKT_MAX]; /* their position in the RX ring, for the uplink trace */
+    int nb_fwd;
+    struct lgw_pkt_rx_s *held_pkt; /* packets taken from the deduplication */
+    struct timespec now;
+    int wait_ms;
+
+    /* local copy of GPS time references */
+    bool ref_ok[LGW_BOARD_NB] = {false}; /* determine if GPS time reference must be used or not */
+    struct tref local_ref[LGW_BOARD_NB]; /* time reference used for UTC <-> timestamp conversion */
+    bool ref_all_ok;
 
     /* data buffers */
-    uint8_t buff_up[TX_BUFF_SIZE]; /* buffer to compose the upstream packet */
+    uint8_t *buff_up; /* buffer to compose the upstream packet, owned by the network queue */
     int buff_index;
-    uint8_t buff_ack[32]; /* buffer to receive acknowledges */
-
-    /* protocol variables */
-    uint8_t token_h; /* random token for acknowledgement matching */
-    uint8_t token_l; /* random token for acknowledgement matching */
-
-    /* ping measurement variables */
-    struct timespec send_time;
-    struct timespec recv_time;
 
     /* GPS synchronization variables */
     struct timespec pkt_utc_time;
-    struct tm * x; /* broken-up UTC time */
     struct timespec pkt_gps_time;
     uint64_t pkt_gps_time_ms;
+    bool pkt_utc_ok; /* pkt_utc_time is valid for current packet */
+    bool pkt_gps_ok; /* pkt_gps_time_ms is valid for current packet */
 
     /* report management variable */
     bool send_report = false;
+    struct timespec wait_start;
 
     /* mote info variables */
     uint32_t mote_addr = 0;
     uint16_t mote_fcnt = 0;
 
-    /* set upstream socket RX timeout */
-    i = setsockopt(sock_up, SOL_SOCKET, SO_RCVTIMEO, (void *)&push_timeout_half, sizeof push_timeout_half);
-    if (i != 0) {
-        MSG("ERROR: [up] setsockopt returned %s\n", strerror(errno));
+    /* boards served in turn, one per datagram */
+    int board = 0;
+
+    held_pkt = malloc(pkt_batch_max * sizeof *held_pkt);
+    if (held_pkt == NULL) {
+        MSG("ERROR: [up] failed to allocate the deduplication buffer, exiting\n");
         exit(EXIT_FAILURE);
     }
 
-    /* pre-fill the data buffer with fixed fields */
-    buff_up[0] = PROTOCOL_VERSION;
-    buff_up[3] = PKT_PUSH_DATA;
-    *(uint32_t *)(buff_up + 4) = net_mac_h;
-    *(uint32_t *)(buff_up + 8) = net_mac_l;
-
     while (!exit_sig && !quit_sig) {
 
-        /* fetch packets */
-        pthread_mutex_lock(&mx_concent);
-        nb_pkt = lgw_receive(NB_PKT_MAX, rxpkt);
-        pthread_mutex_unlock(&mx_concent);
-        if (nb_pkt == LGW_HAL_ERROR) {
-            MSG("ERROR: [up] failed packet fetch, exiting\n");
-            exit(EXIT_FAILURE);
+        /* get a copy of GPS time references (avoid 1 mutex per packet) */
+        ref_all_ok = gps_enabled;
+        for (i = 0; i < board_nb; i++) {
+            ref_ok[i] = (gps_enabled == true) && (timeref_get(&time_reference_gps[i], &local_ref[i]) == true);
+            ref_all_ok &= ref_ok[i];
+        }
+
+        nb_pkt = 0;
+        nb_fwd = 0;
+        wait_ms = FETCH_WAIT_MS;
+        if (xdedup_hold_ms > 0) {
+            /* hold the packets of every board while their copies may be received by the others */
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            for (board = 0; board < board_nb; board++) {
+                j = (int)rxring_peek(&rx_ring[board], &rxpkt);
+                for (i = 0; (i < j) && (xdedup.nb < XDEDUP_PKT_NB); i++) {
+                    if ((up_filter(&rxpkt[i]) == true) && (xdedup_add(&xdedup, &rxpkt[i], board, up_common_time(&rxpkt[i], board, ref_all_ok, local_ref), &now) == 1)) {
+                        MEAS_ADD(meas_up.up_pkt_xdedup, 1);
+                    }
+                }
+                rxring_pop(&rx_ring[board], i);
+                nb_pkt += i;
+            }
+            while ((nb_fwd < pkt_batch_max) && (xdedup_take(&xdedup, &now, &held_pkt[nb_fwd], &fwd_board[nb_fwd]) == true)) {
+                fwd_pkt[nb_fwd] = &held_pkt[nb_fwd];
+                fwd_idx[nb_fwd] = 0;
+                ++nb_fwd;
+            }
+            i = xdedup_next(&xdedup, &now);
+            if ((i >= 0) && (i < wait_ms)) {
+                wait_ms = i;
+            }
+        } else {
+            /* get the packets drained from a concentrator by its fetch thread */
+            for (i = 0; (i < board_nb) && (nb_pkt == 0); i++) {
+                board = (board + 1) % board_nb;
+                nb_pkt = (int)rxring_peek(&rx_ring[board], &rxpkt);
+            }
+            if (nb_pkt > pkt_batch_max) {
+                nb_pkt = pkt_batch_max; /* the rest goes in the next datagram */
+            }
         }
 
         /* check if there are status report to send */
         send_report = report_ready; /* copy the variable so it doesn't change mid-function */
         /* no mutex, we're only reading */
 
-        /* wait a short time if no packets, nor status report */
-        if ((nb_pkt == 0) && (send_report == false)) {
-            wait_ms(FETCH_SLEEP_MS);
+        /* wait for the fetch threads if no packets, nor status report */
+        if ((nb_pkt == 0) && (nb_fwd == 0) && (send_report == false)) {
+            rtsched_wait_begin(&wait_start);
+            if (rxring_wait_any(rx_ring, board_nb, wait_ms) == 0) {
+                rtsched_wait_end(RTSCHED_UP, &wait_start, wait_ms * 1000);
+            }
             continue;
         }
+        if (xdedup_hold_ms == 0) {
+            uptrace_up_begin(&up_trace);
+            for (i = 0; i < nb_pkt; ++i) {
+                if (up_filter(&rxpkt[i]) == true) {
+                    fwd_pkt[nb_fwd] = &rxpkt[i];
+                    fwd_board[nb_fwd] = board;
+                    fwd_idx[nb_fwd] = i;
+                    ++nb_fwd;
+                }
+            }
+        }
 
-        /* get a copy of GPS time reference (avoid 1 mutex per packet) */
-        if ((nb_pkt > 0) && (gps_enabled == true)) {
-            pthread_mutex_lock(&mx_timeref);
-            ref_ok = gps_ref_valid;
-            local_ref = time_reference_gps;
-            pthread_mutex_unlock(&mx_timeref);
-        } else {
-            ref_ok = false;
+        /* packets only held for deduplication, nothing to send yet */
+        if ((nb_fwd == 0) && (send_report == false)) {
+            if (xdedup_hold_ms == 0) {
+                uptrace_up_pop(&up_trace, nb_pkt);
+                rxring_pop(&rx_ring[board], nb_pkt);
+            }
+            continue;
         }
 
         /* get timestamp for statistics */
@@ -1749,21 +3288,36 @@ void thread_up(void) {
         strftime(stat_timestamp, sizeof stat_timestamp, "%F %T %Z", gmtime(&t));
         MSG_DEBUG(DEBUG_PKT_FWD, "\nCurrent time: %s \n", stat_timestamp);
 
+        /* get a buffer from the network queue, never wait for the network thread */
+        buff_up = pushq_reserve(&push_queue);
+        if (buff_up == NULL) {
+            MSG("WARNING: [up] upstream queue full, %d packets dropped\n", nb_fwd);
+            if (xdedup_hold_ms == 0) {
+                uptrace_up_pop(&up_trace, nb_pkt);
+                rxring_pop(&rx_ring[board], nb_pkt);
+            }
+            continue;
+        }
+
         /* start composing datagram with the header */
-        token_h = (uint8_t)rand(); /* random token */
-        token_l = (uint8_t)rand(); /* random token */
-        buff_up[1] = token_h;
-        buff_up[2] = token_l;
+        buff_up[0] = protocol_version;
+        buff_up[1] = (uint8_t)rand(); /* random token */
+        buff_up[2] = (uint8_t)rand(); /* random token */
+        buff_up[3] = PKT_PUSH_DATA;
+        *(uint32_t *)(buff_up + 4) = net_mac_h;
+        *(uint32_t *)(buff_up + 8) = net_mac_l;
         buff_index = 12; /* 12-byte header */
 
-        /* start of JSON structure */
-        memcpy((void *)(buff_up + buff_index), (void *)"{\"rxpk\":[", 9);
-        buff_index += 9;
+        /* start of JSON structure, binary records are simply concatenated */
+        if (protocol_version != PROTOCOL_VERSION_BIN) {
+            memcpy((void *)(buff_up + buff_index), (void *)"{\"rxpk\":[", 9);
+            buff_index += 9;
+        }
 
         /* serialize Lora packets metadata and payload */
         pkt_in_dgram = 0;
-        for (i = 0; i < nb_pkt; ++i) {
-            p = &rxpkt[i];
+        for (i = 0; i < nb_fwd; ++i) {
+            p = fwd_pkt[i];
 
             /* Get mote information from current packet (addr, fcnt) */
             /* FHDR - DevAddr */
@@ -1780,292 +3334,47 @@ void thread_up(void) {
                 mote_fcnt = 0;
             }
 
-            /* basic packet filtering */
-            pthread_mutex_lock(&mx_meas_up);
-            meas_nb_rx_rcv += 1;
-            switch(p->status) {
-                case STAT_CRC_OK:
-                    meas_nb_rx_ok += 1;
-                    if (!fwd_valid_pkt) {
-                        pthread_mutex_unlock(&mx_meas_up);
-                        continue; /* skip that packet */
-                    }
-                    break;
-                case STAT_CRC_BAD:
-                    meas_nb_rx_bad += 1;
-                    if (!fwd_error_pkt) {
-                        pthread_mutex_unlock(&mx_meas_up);
-                        continue; /* skip that packet */
-                    }
-                    break;
-                case STAT_NO_CRC:
-                    meas_nb_rx_nocrc += 1;
-                    if (!fwd_nocrc_pkt) {
-                        pthread_mutex_unlock(&mx_meas_up);
-                        continue; /* skip that packet */
-                    }
-                    break;
-                default:
-                    MSG("WARNING: [up] received packet with unknown status %u (size %u, modulation %u, BW %u, DR %u, RSSI %.1f)\n", p->status, p->size, p->modulation, p->bandwidth, p->datarate, p->rssic);
-                    pthread_mutex_unlock(&mx_meas_up);
-                    continue; /* skip that packet */
-                    // exit(EXIT_FAILURE);
-            }
-            meas_up_pkt_fwd += 1;
-            meas_up_payload_byte += p->size;
-            pthread_mutex_unlock(&mx_meas_up);
+            MEAS_ADD(meas_up.up_pkt_fwd, 1);
+            MEAS_ADD(meas_up.up_payload_byte, p->size);
             printf( "\nINFO: Received pkt from mote: %08X (fcnt=%u)\n", mote_addr, mote_fcnt );
 
             /* Start of packet, add inter-packet separator if necessary */
-            if (pkt_in_dgram == 0) {
-                buff_up[buff_index] = '{';
-                ++buff_index;
-            } else {
-                buff_up[buff_index] = ',';
-                buff_up[buff_index+1] = '{';
-                buff_index += 2;
-            }
-
-            /* JSON rxpk frame format version, 8 useful chars */
-            j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, "\"jver\":%d", PROTOCOL_JSON_RXPK_FRAME_FORMAT );
-            if (j > 0) {
-                buff_index += j;
-            } else {
-                MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                exit(EXIT_FAILURE);
-            }
-
-            /* RAW timestamp, 8-17 useful chars */
-            j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"tmst\":%u", p->count_us);
-            if (j > 0) {
-                buff_index += j;
-            } else {
-                MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                exit(EXIT_FAILURE);
-            }
-
-            /* Packet RX time (GPS based), 37 useful chars */
-            if (ref_ok == true) {
-                /* convert packet timestamp to UTC absolute time */
-                j = lgw_cnt2utc(local_ref, p->count_us, &pkt_utc_time);
-                if (j == LGW_GPS_SUCCESS) {
-                    /* split the UNIX timestamp to its calendar components */
-                    x = gmtime(&(pkt_utc_time.tv_sec));
-                    j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"time\":\"%04i-%02i-%02iT%02i:%02i:%02i.%06liZ\"", (x->tm_year)+1900, (x->tm_mon)+1, x->tm_mday, x->tm_hour, x->tm_min, x->tm_sec, (pkt_utc_time.tv_nsec)/1000); /* ISO 8601 format */
-                    if (j > 0) {
-                        buff_index += j;
-                    } else {
-                        MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                        exit(EXIT_FAILURE);
-                    }
-                }
-                /* convert packet timestamp to GPS absolute time */
-                j = lgw_cnt2gps(local_ref, p->count_us, &pkt_gps_time);
-                if (j == LGW_GPS_SUCCESS) {
-                    pkt_gps_time_ms = pkt_gps_time.tv_sec * 1E3 + pkt_gps_time.tv_nsec / 1E6;
-                    j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"tmms\":%" PRIu64 "", pkt_gps_time_ms); /* GPS time in milliseconds since 06.Jan.1980 */
-                    if (j > 0) {
-                        buff_index += j;
-                    } else {
-                        MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                        exit(EXIT_FAILURE);
-                    }
-                }
-            }
-
-            /* Packet concentrator channel, RF chain & RX frequency, 34-36 useful chars */
-            j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"chan\":%1u,\"rfch\":%1u,\"freq\":%.6lf,\"mid\":%2u", p->if_chain, p->rf_chain, ((double)p->freq_hz / 1e6), p->modem_id);
-            if (j > 0) {
-                buff_index += j;
-            } else {
-                MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                exit(EXIT_FAILURE);
-            }
-
-            /* Packet status, 9-10 useful chars */
-            switch (p->status) {
-                case STAT_CRC_OK:
-                    memcpy((void *)(buff_up + buff_index), (void *)",\"stat\":1", 9);
-                    buff_index += 9;
-                    break;
-                case STAT_CRC_BAD:
-                    memcpy((void *)(buff_up + buff_index), (void *)",\"stat\":-1", 10);
-                    buff_index += 10;
-                    break;
-                case STAT_NO_CRC:
-                    memcpy((void *)(buff_up + buff_index), (void *)",\"stat\":0", 9);
-                    buff_index += 9;
-                    break;
-                default:
-                    MSG("ERROR: [up] received packet with unknown status 0x%02X\n", p->status);
-                    memcpy((void *)(buff_up + buff_index), (void *)",\"stat\":?", 9);
-                    buff_index += 9;
-                    exit(EXIT_FAILURE);
-            }
-
-            /* Packet modulation, 13-14 useful chars */
-            if (p->modulation == MOD_LORA) {
-                memcpy((void *)(buff_up + buff_index), (void *)",\"modu\":\"LORA\"", 14);
-                buff_index += 14;
-
-                /* Lora datarate & bandwidth, 16-19 useful chars */
-                switch (p->datarate) {
-                    case DR_LORA_SF5:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF5", 12);
-                        buff_index += 12;
-                        break;
-                    case DR_LORA_SF6:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF6", 12);
-                        buff_index += 12;
-                        break;
-                    case DR_LORA_SF7:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF7", 12);
-                        buff_index += 12;
-                        break;
-                    case DR_LORA_SF8:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF8", 12);
-                        buff_index += 12;
-                        break;
-                    case DR_LORA_SF9:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF9", 12);
-                        buff_index += 12;
-                        break;
-                    case DR_LORA_SF10:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF10", 13);
-                        buff_index += 13;
-                        break;
-                    case DR_LORA_SF11:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF11", 13);
-                        buff_index += 13;
-                        break;
-                    case DR_LORA_SF12:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF12", 13);
-                        buff_index += 13;
-                        break;
-                    default:
-                        MSG("ERROR: [up] lora packet with unknown datarate 0x%02X\n", p->datarate);
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"datr\":\"SF?", 12);
-                        buff_index += 12;
-                        exit(EXIT_FAILURE);
-                }
-                switch (p->bandwidth) {
-                    case BW_125KHZ:
-                        memcpy((void *)(buff_up + buff_index), (void *)"BW125\"", 6);
-                        buff_index += 6;
-                        break;
-                    case BW_250KHZ:
-                        memcpy((void *)(buff_up + buff_index), (void *)"BW250\"", 6);
-                        buff_index += 6;
-                        break;
-                    case BW_500KHZ:
-                        memcpy((void *)(buff_up + buff_index), (void *)"BW500\"", 6);
-                        buff_index += 6;
-                        break;
-                    default:
-                        MSG("ERROR: [up] lora packet with unknown bandwidth 0x%02X\n", p->bandwidth);
-                        memcpy((void *)(buff_up + buff_index), (void *)"BW?\"", 4);
-                        buff_index += 4;
-                        exit(EXIT_FAILURE);
-                }
-
-                /* Packet ECC coding rate, 11-13 useful chars */
-                switch (p->coderate) {
-                    case CR_LORA_4_5:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"codr\":\"4/5\"", 13);
-                        buff_index += 13;
-                        break;
-                    case CR_LORA_4_6:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"codr\":\"4/6\"", 13);
-                        buff_index += 13;
-                        break;
-                    case CR_LORA_4_7:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"codr\":\"4/7\"", 13);
-                        buff_index += 13;
-                        break;
-                    case CR_LORA_4_8:
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"codr\":\"4/8\"", 13);
-                        buff_index += 13;
-                        break;
-                    case 0: /* treat the CR0 case (mostly false sync) */
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"codr\":\"OFF\"", 13);
-                        buff_index += 13;
-                        break;
-                    default:
-                        MSG("ERROR: [up] lora packet with unknown coderate 0x%02X\n", p->coderate);
-                        memcpy((void *)(buff_up + buff_index), (void *)",\"codr\":\"?\"", 11);
-                        buff_index += 11;
-                        exit(EXIT_FAILURE);
-                }
-
-                /* Signal RSSI, payload size */
-                j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"rssis\":%.0f", roundf(p->rssis));
-                if (j > 0) {
-                    buff_index += j;
-                } else {
-                    MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                    exit(EXIT_FAILURE);
-                }
-
-                /* Lora SNR */
-                j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"lsnr\":%.1f", p->snr);
-                if (j > 0) {
-                    buff_index += j;
-                } else {
-                    MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                    exit(EXIT_FAILURE);
-                }
-
-                /* Lora frequency offset */
-                j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"foff\":%d", p->freq_offset);
-                if (j > 0) {
-                    buff_index += j;
-                } else {
-                    MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                    exit(EXIT_FAILURE);
-                }
-            } else if (p->modulation == MOD_FSK) {
-                memcpy((void *)(buff_up + buff_index), (void *)",\"modu\":\"FSK\"", 13);
-                buff_index += 13;
+            if ((pkt_in_dgram > 0) && (protocol_version != PROTOCOL_VERSION_BIN)) {
+                buff_up[buff_index] = ',';
+                ++buff_index;
+            }
 
-                /* FSK datarate, 11-14 useful chars */
-                j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"datr\":%u", p->datarate);
-                if (j > 0) {
-                    buff_index += j;
-                } else {
-                    MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                    exit(EXIT_FAILURE);
+            /* Packet RX time (GPS based) */
+            pkt_utc_ok = false;
+            pkt_gps_ok = false;
+            if (ref_ok[fwd_board[i]] == true) {
+                /* convert packet timestamp to UTC absolute time */
+                j = lgw_cnt2utc(local_ref[fwd_board[i]], p->count_us, &pkt_utc_time);
+                if (j == LGW_GPS_SUCCESS) {
+                    pkt_utc_ok = true;
+                }
+                /* convert packet timestamp to GPS absolute time */
+                j = lgw_cnt2gps(local_ref[fwd_board[i]], p->count_us, &pkt_gps_time);
+                if (j == LGW_GPS_SUCCESS) {
+                    pkt_gps_time_ms = pkt_gps_time.tv_sec * 1E3 + pkt_gps_time.tv_nsec / 1E6;
+                    pkt_gps_ok = true;
                 }
-            } else {
-                MSG("ERROR: [up] received packet with unknown modulation 0x%02X\n", p->modulation);
-                exit(EXIT_FAILURE);
             }
 
-            /* Channel RSSI, payload size, 18-23 useful chars */
-            j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, ",\"rssi\":%.0f,\"size\":%u", roundf(p->rssic), p->size);
-            if (j > 0) {
-                buff_index += j;
+            /* Packet metadata and payload, as a JSON object (base64-encoded payload) or a binary record */
+            if (protocol_version == PROTOCOL_VERSION_BIN) {
+                j = bin_rxpk_write(p, (pkt_utc_ok == true) ? &pkt_utc_time : NULL, (pkt_gps_ok == true) ? &pkt_gps_time_ms : NULL, buff_up + buff_index, up_buff_size - buff_index);
             } else {
-                MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 4));
-                exit(EXIT_FAILURE);
+                j = rxpk_json_write(p, (pkt_utc_ok == true) ? &pkt_utc_time : NULL, (pkt_gps_ok == true) ? &pkt_gps_time_ms : NULL, (board_nb > 1) ? fwd_board[i] : -1, (char *)(buff_up + buff_index), up_buff_size - buff_index);
             }
-
-            /* Packet base64-encoded payload, 14-350 useful chars */
-            memcpy((void *)(buff_up + buff_index), (void *)",\"data\":\"", 9);
-            buff_index += 9;
-            j = bin_to_b64(p->payload, p->size, (char *)(buff_up + buff_index), 341); /* 255 bytes = 340 chars in b64 + null char */
-            if (j>=0) {
+            if (j > 0) {
                 buff_index += j;
             } else {
-                MSG("ERROR: [up] bin_to_b64 failed line %u\n", (__LINE__ - 5));
+                MSG("ERROR: [up] failed to serialize packet line %u\n", (__LINE__ - 7));
                 exit(EXIT_FAILURE);
             }
-            buff_up[buff_index] = '"';
-            ++buff_index;
-
-            /* End of packet serialization */
-            buff_up[buff_index] = '}';
-            ++buff_index;
             ++pkt_in_dgram;
+            uptrace_up_take(&up_trace, fwd_idx[i]);
 
             if (p->modulation == MOD_LORA) {
                 /* Log nb of packets per channel, per SF */
@@ -2087,6 +3396,12 @@ void thread_up(void) {
             }
         }
 
+        /* packets serialized, give their slots back to the fetch thread */
+        if (xdedup_hold_ms == 0) {
+            uptrace_up_pop(&up_trace, nb_pkt);
+            rxring_pop(&rx_ring[board], nb_pkt);
+        }
+
 
         /* DEBUG: print the number of packets received per channel and per SF */
         {
@@ -2109,7 +3424,12 @@ void thread_up(void) {
         }
 
         /* restart fetch sequence without sending empty JSON if all packets have been filtered out */
-        if (pkt_in_dgram == 0) {
+        if ((pkt_in_dgram == 0) && (send_report == false)) {
+            /* all packet have been filtered out and no report, restart loop */
+            continue;
+        } else if (protocol_version == PROTOCOL_VERSION_BIN) {
+            /* no array to close */
+        } else if (pkt_in_dgram == 0) {
             if (send_report == true) {
                 /* need to clean up the beginning of the payload */
                 buff_index -= 8; /* removes "rxpk":[ */
@@ -2132,61 +3452,38 @@ void thread_up(void) {
         if (send_report == true) {
             pthread_mutex_lock(&mx_stat_rep);
             report_ready = false;
-            j = snprintf((char *)(buff_up + buff_index), TX_BUFF_SIZE-buff_index, "%s", status_report);
-            pthread_mutex_unlock(&mx_stat_rep);
-            if (j > 0) {
-                buff_index += j;
+            if (status_report_size <= (int)(up_buff_size - buff_index - 2)) {
+                memcpy((void *)(buff_up + buff_index), (void *)status_report, status_report_size);
+                buff_index += status_report_size;
             } else {
-                MSG("ERROR: [up] snprintf failed line %u\n", (__LINE__ - 5));
-                exit(EXIT_FAILURE);
+                MSG("WARNING: [up] no room left for status report, dropped\n");
             }
+            pthread_mutex_unlock(&mx_stat_rep);
         }
 
-        /* end of JSON datagram payload */
-        buff_up[buff_index] = '}';
-        ++buff_index;
-        buff_up[buff_index] = 0; /* add string terminator, for safety */
-
-        printf("\nJSON up: %s\n", (char *)(buff_up + 12)); /* DEBUG: display JSON payload */
+        if (protocol_version == PROTOCOL_VERSION_BIN) {
+            printf("\nBinary up: %d bytes\n", buff_index - 12);
+        } else {
+            /* end of JSON datagram payload */
+            buff_up[buff_index] = '}';
+            ++buff_index;
+            buff_up[buff_index] = 0; /* add string terminator, for safety */
 
-        /* send datagram to server */
-        send(sock_up, (void *)buff_up, buff_index, 0);
-        clock_gettime(CLOCK_MONOTONIC, &send_time);
-        pthread_mutex_lock(&mx_meas_up);
-        meas_up_dgram_sent += 1;
-        meas_up_network_byte += buff_index;
-
-        /* wait for acknowledge (in 2 times, to catch extra packets) */
-        for (i=0; i<2; ++i) {
-            j = recv(sock_up, (void *)buff_ack, sizeof buff_ack, 0);
-            clock_gettime(CLOCK_MONOTONIC, &recv_time);
-            if (j == -1) {
-                if (errno == EAGAIN) { /* timeout */
-                    continue;
-                } else { /* server connection error */
-                    break;
-                }
-            } else if ((j < 4) || (buff_ack[0] != PROTOCOL_VERSION) || (buff_ack[3] != PKT_PUSH_ACK)) {
-                //MSG("WARNING: [up] ignored invalid non-ACL packet\n");
-                continue;
-            } else if ((buff_ack[1] != token_h) || (buff_ack[2] != token_l)) {
-                //MSG("WARNING: [up] ignored out-of sync ACK packet\n");
-                continue;
-            } else {
-                MSG("INFO: [up] PUSH_ACK received in %i ms\n", (int)(1000 * difftimespec(recv_time, send_time)));
-                meas_up_ack_rcv += 1;
-                break;
-            }
+            printf("\nJSON up: %s\n", (char *)(buff_up + 12)); /* DEBUG: display JSON payload */
         }
-        pthread_mutex_unlock(&mx_meas_up);
+
+        /* hand the datagram over to the network thread */
+        uptrace_up_commit(&up_trace);
+        pushq_commit(&push_queue, buff_index);
     }
+    free(held_pkt);
     MSG("\nINFO: End of upstream thread\n");
 }
 
 /* -------------------------------------------------------------------------- */
 /* --- THREAD 2: POLLING SERVER AND ENQUEUING PACKETS IN JIT QUEUE ---------- */
 
-static int get_tx_gain_lut_index(uint8_t rf_chain, int8_t rf_power, uint8_t * lut_index) {
+static int get_tx_gain_lut_index(int board, uint8_t rf_chain, int8_t rf_power, uint8_t * lut_index) {
     uint8_t pow_index;
     int current_best_index = -1;
     uint8_t current_best_match = 0xFF;
@@ -2199,8 +3496,8 @@ static int get_tx_gain_lut_index(uint8_t rf_chain, int8_t rf_power, uint8_t * lu
     }
 
     /* Search requested power in TX gain LUT */
-    for (pow_index = 0; pow_index < txlut[rf_chain].size; pow_index++) {
-        diff = rf_power - txlut[rf_chain].lut[pow_index].rf_power;
+    for (pow_index = 0; pow_index < txlut[board][rf_chain].size; pow_index++) {
+        diff = rf_power - txlut[board][rf_chain].lut[pow_index].rf_power;
         if (diff < 0) {
             /* The selected power must be lower or equal to requested one */
             continue;
@@ -2235,9 +3532,15 @@ void thread_down(void) {
     /* local timekeeping variables */
     struct timespec send_time; /* time of the pull request */
     struct timespec recv_time; /* time of return from recv socket call */
+    struct timespec wait_start; /* time of the recv socket call */
 
     /* data buffers */
-    uint8_t buff_down[1000]; /* buffer to receive downstream packets */
+    uint8_t dgram_buff[DW_BATCH_MAX][DW_DGRAM_SIZE]; /* batch of downstream datagrams */
+    int dgram_len[DW_BATCH_MAX];
+    int dgram_nb = 0; /* datagrams in the batch */
+    int dgram_next = 0; /* next datagram of the batch to be processed */
+    struct pollfd pfd;
+    uint8_t *buff_down; /* datagram being processed */
     uint8_t buff_req[12]; /* buffer to compose pull requests */
     int msg_len;
 
@@ -2246,13 +3549,8 @@ void thread_down(void) {
     uint8_t token_l; /* random token for acknowledgement matching */
     bool req_ack = false; /* keep track of whether PULL_DATA was acknowledged or not */
 
-    /* JSON parsing variables */
-    JSON_Value *root_val = NULL;
-    JSON_Object *txpk_obj = NULL;
-    JSON_Value *val = NULL; /* needed to detect the absence of some fields */
-    const char *str; /* pointer to sub-strings in the JSON data */
-    short x0, x1;
-    uint64_t x2;
+    /* downlink request, as decoded from JSON or binary payload */
+    struct txpk_s txpk;
     double x3, x4;
 
     /* variables to send on GPS timestamp */
@@ -2261,7 +3559,7 @@ void thread_down(void) {
 
     /* beacon variables */
     struct lgw_pkt_tx_s beacon_pkt;
-    uint8_t beacon_chan;
+    static struct beacon_cache_s beacon_cache; /* frames of the next beacon periods */
     uint8_t beacon_loop;
     size_t beacon_RFU1_size = 0;
     size_t beacon_RFU2_size = 0;
@@ -2274,7 +3572,7 @@ void thread_down(void) {
     /* beacon data fields, byte 0 is Least Significant Byte */
     int32_t field_latitude; /* 3 bytes, derived from reference latitude */
     int32_t field_longitude; /* 3 bytes, derived from reference longitude */
-    uint16_t field_crc1, field_crc2;
+    uint16_t field_crc2;
 
     /* auto-quit variable */
     uint32_t autoquit_cnt = 0; /* count the number of PULL_DATA sent since the latest PULL_ACK */
@@ -2286,16 +3584,20 @@ void thread_down(void) {
     enum jit_error_e warning_result = JIT_ERROR_OK;
     int32_t warning_value = 0;
     uint8_t tx_lut_idx = 0;
+    int brd = 0; /* concentrator board of the downlink */
 
-    /* set downstream socket RX timeout */
-    i = setsockopt(sock_down, SOL_SOCKET, SO_RCVTIMEO, (void *)&pull_timeout, sizeof pull_timeout);
-    if (i != 0) {
-        MSG("ERROR: [down] setsockopt returned %s\n", strerror(errno));
-        exit(EXIT_FAILURE);
-    }
+    /* downlink latency */
+    struct timespec enqueue_time;
+    int32_t proc_us; /* PULL_RESP reception to JIT enqueue */
+    int32_t lead_us; /* time left before TX when queued */
+    enum dw_late_e late_cause;
+
+    /* datagrams are waited for with a timeout, then drained without blocking */
+    pfd.fd = sock_down;
+    pfd.events = POLLIN;
 
     /* pre-fill the pull request buffer with fixed fields */
-    buff_req[0] = PROTOCOL_VERSION;
+    buff_req[0] = protocol_version;
     buff_req[3] = PKT_PULL_DATA;
     *(uint32_t *)(buff_req + 4) = net_mac_h;
     *(uint32_t *)(buff_req + 8) = net_mac_l;
@@ -2392,13 +3694,20 @@ void thread_down(void) {
     }
 
     /* CRC of the beacon gateway specific part fields */
-    field_crc2 = crc16((beacon_pkt.payload + 6 + beacon_RFU1_size), 7 + beacon_RFU2_size);
+    field_crc2 = beacon_crc16(0, (beacon_pkt.payload + 6 + beacon_RFU1_size), 7 + beacon_RFU2_size);
     beacon_pkt.payload[beacon_pyld_idx++] = 0xFF &  field_crc2;
     beacon_pkt.payload[beacon_pyld_idx++] = 0xFF & (field_crc2 >> 8);
 
-    /* JIT queue initialization */
-    jit_queue_init(&jit_queue[0]);
-    jit_queue_init(&jit_queue[1]);
+    /* only the time, its CRC and the channel change from a period to the next */
+    if (beacon_period != 0) {
+        beacon_cache_init(&beacon_cache, &beacon_pkt, beacon_RFU1_size, beacon_period, beacon_freq_hz, beacon_freq_step, beacon_freq_nb);
+    }
+
+    /* JIT queues initialization */
+    for (i = 0; i < board_nb; i++) {
+        jit_queue_init(&jit_queue[i][0]);
+        jit_queue_init(&jit_queue[i][1]);
+    }
 
     while (!exit_sig && !quit_sig) {
 
@@ -2418,9 +3727,7 @@ void thread_down(void) {
         /* send PULL request and record time */
         send(sock_down, (void *)buff_req, sizeof buff_req, 0);
         clock_gettime(CLOCK_MONOTONIC, &send_time);
-        pthread_mutex_lock(&mx_meas_dw);
-        meas_dw_pull_sent += 1;
-        pthread_mutex_unlock(&mx_meas_dw);
+        MEAS_ADD(meas_dw.dw_pull_sent, 1);
         req_ack = false;
         autoquit_cnt++;
 
@@ -2428,25 +3735,42 @@ void thread_down(void) {
         recv_time = send_time;
         while ((int)difftimespec(recv_time, send_time) < keepalive_time) {
 
-            /* try to receive a datagram */
-            msg_len = recv(sock_down, (void *)buff_down, (sizeof buff_down)-1, 0);
-            clock_gettime(CLOCK_MONOTONIC, &recv_time);
+            /* once the previous batch is processed, send its TX_ACK and receive the datagrams waiting */
+            if (dgram_next == dgram_nb) {
+                flush_tx_ack();
+                dgram_nb = 0;
+                dgram_next = 0;
+                rtsched_wait_begin(&wait_start);
+                i = poll(&pfd, 1, PULL_TIMEOUT_MS);
+                if (i > 0) {
+                    dgram_nb = pushq_recv(sock_down, dgram_buff[0], DW_DGRAM_SIZE, dgram_len, DW_BATCH_MAX);
+                    if (dgram_nb < 0) {
+                        MSG("WARNING: [down] recvmmsg returned %s\n", strerror(errno));
+                        dgram_nb = 0;
+                    }
+                }
+                clock_gettime(CLOCK_MONOTONIC, &recv_time);
+                if (i == 0) {
+                    rtsched_wait_end(RTSCHED_DOWN, &wait_start, PULL_TIMEOUT_MS * 1000);
+                }
+            }
 
             /* Pre-allocate beacon slots in JiT queue, to check downlink collisions */
-            beacon_loop = JIT_NUM_BEACON_IN_QUEUE - jit_queue[0].num_beacon;
+            /* beacons are sent by the first board, on its first RF chain */
+            lgw_board_select(0);
+            beacon_loop = JIT_NUM_BEACON_IN_QUEUE - jit_queue[0][0].num_beacon;
             retry = 0;
             while (beacon_loop && (beacon_period != 0)) {
-                pthread_mutex_lock(&mx_timeref);
                 /* Wait for GPS to be ready before inserting beacons in JiT queue */
-                if ((gps_ref_valid == true) && (xtal_correct_ok == true)) {
+                if ((timeref_get(&time_reference_gps[0], &local_ref) == true) && (xtal_correct_ok == true)) {
 
                     /* compute GPS time for next beacon to come      */
                     /*   LoRaWAN: T = k*beacon_period + TBeaconDelay */
                     /*            with TBeaconDelay = [1.5ms +/- 1µs]*/
                     if (last_beacon_gps_time.tv_sec == 0) {
                         /* if no beacon has been queued, get next slot from current GPS time */
-                        diff_beacon_time = time_reference_gps.gps.tv_sec % ((time_t)beacon_period);
-                        next_beacon_gps_time.tv_sec = time_reference_gps.gps.tv_sec +
+                        diff_beacon_time = local_ref.gps.tv_sec % ((time_t)beacon_period);
+                        next_beacon_gps_time.tv_sec = local_ref.gps.tv_sec +
                                                         ((time_t)beacon_period - diff_beacon_time);
                     } else {
                         /* if there is already a beacon, take it as reference */
@@ -2460,7 +3784,7 @@ void thread_down(void) {
                     {
                     time_t time_unix;
 
-                    time_unix = time_reference_gps.gps.tv_sec + UNIX_GPS_EPOCH_OFFSET;
+                    time_unix = local_ref.gps.tv_sec + UNIX_GPS_EPOCH_OFFSET;
                     MSG_DEBUG(DEBUG_BEACON, "GPS-now : %s", ctime(&time_unix));
                     time_unix = last_beacon_gps_time.tv_sec + UNIX_GPS_EPOCH_OFFSET;
                     MSG_DEBUG(DEBUG_BEACON, "GPS-last: %s", ctime(&time_unix));
@@ -2469,41 +3793,20 @@ void thread_down(void) {
                     }
 #endif
 
-                    /* convert GPS time to concentrator time, and set packet counter for JiT trigger */
-                    lgw_gps2cnt(time_reference_gps, next_beacon_gps_time, &(beacon_pkt.count_us));
-                    pthread_mutex_unlock(&mx_timeref);
-
-                    /* apply frequency correction to beacon TX frequency */
-                    if (beacon_freq_nb > 1) {
-                        beacon_chan = (next_beacon_gps_time.tv_sec / beacon_period) % beacon_freq_nb; /* floor rounding */
-                    } else {
-                        beacon_chan = 0;
-                    }
-                    /* Compute beacon frequency */
-                    beacon_pkt.freq_hz = beacon_freq_hz + (beacon_chan * beacon_freq_step);
+                    /* beacon frame (channel, time and CRC) prepared with the previous one */
+                    beacon_cache_get(&beacon_cache, (uint32_t)next_beacon_gps_time.tv_sec, &beacon_pkt);
 
-                    /* load time in beacon payload */
-                    beacon_pyld_idx = beacon_RFU1_size;
-                    beacon_pkt.payload[beacon_pyld_idx++] = 0xFF &  next_beacon_gps_time.tv_sec;
-                    beacon_pkt.payload[beacon_pyld_idx++] = 0xFF & (next_beacon_gps_time.tv_sec >>  8);
-                    beacon_pkt.payload[beacon_pyld_idx++] = 0xFF & (next_beacon_gps_time.tv_sec >> 16);
-                    beacon_pkt.payload[beacon_pyld_idx++] = 0xFF & (next_beacon_gps_time.tv_sec >> 24);
-
-                    /* calculate CRC */
-                    field_crc1 = crc16(beacon_pkt.payload, 4 + beacon_RFU1_size); /* CRC for the network common part */
-                    beacon_pkt.payload[beacon_pyld_idx++] = 0xFF & field_crc1;
-                    beacon_pkt.payload[beacon_pyld_idx++] = 0xFF & (field_crc1 >> 8);
+                    /* convert GPS time to concentrator time, and set packet counter for JiT trigger */
+                    lgw_gps2cnt(local_ref, next_beacon_gps_time, &(beacon_pkt.count_us));
 
                     /* Insert beacon packet in JiT queue */
-                    pthread_mutex_lock(&mx_concent);
                     lgw_get_instcnt(&current_concentrator_time);
-                    pthread_mutex_unlock(&mx_concent);
-                    jit_result = jit_enqueue(&jit_queue[0], current_concentrator_time, &beacon_pkt, JIT_PKT_TYPE_BEACON);
+                    jit_result = jit_enqueue(&jit_queue[0][0], current_concentrator_time, &beacon_pkt, JIT_PKT_TYPE_BEACON);
                     if (jit_result == JIT_ERROR_OK) {
+                        jit_wake();
+
                         /* update stats */
-                        pthread_mutex_lock(&mx_meas_dw);
-                        meas_nb_beacon_queued += 1;
-                        pthread_mutex_unlock(&mx_meas_dw);
+                        MEAS_ADD(meas_dw.nb_beacon_queued, 1);
 
                         /* One more beacon in the queue */
                         beacon_loop--;
@@ -2520,11 +3823,9 @@ void thread_down(void) {
                     } else {
                         MSG_DEBUG(DEBUG_BEACON, "--> beacon queuing failed with %d\n", jit_result);
                         /* update stats */
-                        pthread_mutex_lock(&mx_meas_dw);
                         if (jit_result != JIT_ERROR_COLLISION_BEACON) {
-                            meas_nb_beacon_rejected += 1;
+                            MEAS_ADD(meas_dw.nb_beacon_rejected, 1);
                         }
-                        pthread_mutex_unlock(&mx_meas_dw);
                         /* In case previous enqueue failed, we retry one period later until it succeeds */
                         /* Note: In case the GPS has been unlocked for a while, there can be lots of retries */
                         /*       to be done from last beacon time to a new valid one */
@@ -2532,19 +3833,27 @@ void thread_down(void) {
                         MSG_DEBUG(DEBUG_BEACON, "--> beacon queuing retry=%d\n", retry);
                     }
                 } else {
-                    pthread_mutex_unlock(&mx_timeref);
                     break;
                 }
             }
 
             /* if no network message was received, got back to listening sock_down socket */
-            if (msg_len == -1) {
-                //MSG("WARNING: [down] recv returned %s\n", strerror(errno)); /* too verbose */
+            if (dgram_next == dgram_nb) {
+                continue;
+            }
+            buff_down = dgram_buff[dgram_next];
+            msg_len = dgram_len[dgram_next];
+            dgram_next += 1;
+
+            /* keep room for a string terminator, a datagram filling the buffer may have been truncated */
+            if (msg_len >= DW_DGRAM_SIZE) {
+                MSG("WARNING: [down] ignoring datagram of %d bytes or more\n", msg_len);
                 continue;
             }
 
             /* if the datagram does not respect protocol, just ignore it */
-            if ((msg_len < 4) || (buff_down[0] != PROTOCOL_VERSION) || ((buff_down[3] != PKT_PULL_RESP) && (buff_down[3] != PKT_PULL_ACK))) {
+            /* the server may answer with JSON or binary payloads, whatever the configured format */
+            if ((msg_len < 4) || ((buff_down[0] != PROTOCOL_VERSION) && (buff_down[0] != PROTOCOL_VERSION_BIN)) || ((buff_down[3] != PKT_PULL_RESP) && (buff_down[3] != PKT_PULL_ACK))) {
                 MSG("WARNING: [down] ignoring invalid packet len=%d, protocol_version=%d, id=%d\n",
                         msg_len, buff_down[0], buff_down[3]);
                 continue;
@@ -2558,9 +3867,7 @@ void thread_down(void) {
                     } else { /* if that packet was not already acknowledged */
                         req_ack = true;
                         autoquit_cnt = 0;
-                        pthread_mutex_lock(&mx_meas_dw);
-                        meas_dw_ack_rcv += 1;
-                        pthread_mutex_unlock(&mx_meas_dw);
+                        MEAS_ADD(meas_dw.dw_ack_rcv, 1);
                         MSG("INFO: [down] PULL_ACK received in %i ms\n", (int)(1000 * difftimespec(recv_time, send_time)));
                     }
                 } else { /* out-of-sync token */
@@ -2570,78 +3877,65 @@ void thread_down(void) {
             }
 
             /* the datagram is a PULL_RESP */
-            buff_down[msg_len] = 0; /* add string terminator, just to be safe */
             MSG("INFO: [down] PULL_RESP received  - token[%d:%d] :)\n", buff_down[1], buff_down[2]); /* very verbose */
-            printf("\nJSON down: %s\n", (char *)(buff_down + 4)); /* DEBUG: display JSON payload */
-
-            /* initialize TX struct and try to parse JSON */
-            memset(&txpkt, 0, sizeof txpkt);
-            root_val = json_parse_string_with_comments((const char *)(buff_down + 4)); /* JSON offset */
-            if (root_val == NULL) {
-                MSG("WARNING: [down] invalid JSON, TX aborted\n");
+            if (buff_down[0] == PROTOCOL_VERSION_BIN) {
+                printf("\nBinary down: %d bytes\n", msg_len - 4);
+                i = bin_txpk_parse(buff_down + 4, msg_len - 4, &txpk);
+            } else {
+                buff_down[msg_len] = 0; /* add string terminator, just to be safe */
+                printf("\nJSON down: %s\n", (char *)(buff_down + 4)); /* DEBUG: display JSON payload */
+                jarena_begin(&jarena_down);
+                i = txpk_json_parse((const char *)(buff_down + 4), &txpk); /* JSON offset */
+                jarena_end(&jarena_down);
+            }
+            if (i != 0) {
                 continue;
             }
+            txpkt = txpk.pkt;
+
+            /* concentrator board, the first one if not given */
+            if (txpk.brd >= board_nb) {
+                MSG("WARNING: [down] no concentrator board %u, TX aborted\n", txpk.brd);
 
-            /* look for JSON sub-object 'txpk' */
-            txpk_obj = json_object_get_object(json_value_get_object(root_val), "txpk");
-            if (txpk_obj == NULL) {
-                MSG("WARNING: [down] no \"txpk\" object in JSON, TX aborted\n");
-                json_value_free(root_val);
+                /* send acknoledge datagram to server */
+                send_tx_ack(buff_down[1], buff_down[2], JIT_ERROR_INVALID, 0, DW_LATE_NB);
                 continue;
             }
+            brd = txpk.brd;
+            lgw_board_select(brd);
 
-            /* Parse "immediate" tag, or target timestamp, or UTC time to be converted by GPS (mandatory) */
-            i = json_object_get_boolean(txpk_obj,"imme"); /* can be 1 if true, 0 if false, or -1 if not a JSON boolean */
-            if (i == 1) {
+            /* "immediate" tag, or target timestamp, or UTC time to be converted by GPS */
+            if (txpk.imme == true) {
                 /* TX procedure: send immediately */
                 sent_immediate = true;
                 downlink_type = JIT_PKT_TYPE_DOWNLINK_CLASS_C;
                 MSG("INFO: [down] a packet will be sent in \"immediate\" mode\n");
             } else {
                 sent_immediate = false;
-                val = json_object_get_value(txpk_obj,"tmst");
-                if (val != NULL) {
+                if (txpk.tmst_ok == true) {
                     /* TX procedure: send on timestamp value */
-                    txpkt.count_us = (uint32_t)json_value_get_number(val);
-
                     /* Concentrator timestamp is given, we consider it is a Class A downlink */
                     downlink_type = JIT_PKT_TYPE_DOWNLINK_CLASS_A;
                 } else {
                     /* TX procedure: send on GPS time (converted to timestamp value) */
-                    val = json_object_get_value(txpk_obj, "tmms");
-                    if (val == NULL) {
-                        MSG("WARNING: [down] no mandatory \"txpk.tmst\" or \"txpk.tmms\" objects in JSON, TX aborted\n");
-                        json_value_free(root_val);
-                        continue;
-                    }
                     if (gps_enabled == true) {
-                        pthread_mutex_lock(&mx_timeref);
-                        if (gps_ref_valid == true) {
-                            local_ref = time_reference_gps;
-                            pthread_mutex_unlock(&mx_timeref);
-                        } else {
-                            pthread_mutex_unlock(&mx_timeref);
+                        if (timeref_get(&time_reference_gps[brd], &local_ref) == false) {
                             MSG("WARNING: [down] no valid GPS time reference yet, impossible to send packet on specific GPS time, TX aborted\n");
-                            json_value_free(root_val);
 
                             /* send acknoledge datagram to server */
-                            send_tx_ack(buff_down[1], buff_down[2], JIT_ERROR_GPS_UNLOCKED, 0);
+                            send_tx_ack(buff_down[1], buff_down[2], JIT_ERROR_GPS_UNLOCKED, 0, DW_LATE_NB);
                             continue;
                         }
                     } else {
                         MSG("WARNING: [down] GPS disabled, impossible to send packet on specific GPS time, TX aborted\n");
-                        json_value_free(root_val);
 
                         /* send acknoledge datagram to server */
-                        send_tx_ack(buff_down[1], buff_down[2], JIT_ERROR_GPS_UNLOCKED, 0);
+                        send_tx_ack(buff_down[1], buff_down[2], JIT_ERROR_GPS_UNLOCKED, 0, DW_LATE_NB);
                         continue;
                     }
 
-                    /* Get GPS time from JSON */
-                    x2 = (uint64_t)json_value_get_number(val);
-
                     /* Convert GPS time from milliseconds to timespec */
-                    x3 = modf((double)x2/1E3, &x4);
+                    x3 = modf((double)txpk.tmms/1E3, &x4);
                     gps_tx.tv_sec = (time_t)x4; /* get seconds from integer part */
                     gps_tx.tv_nsec = (long)(x3 * 1E9); /* get nanoseconds from fractional part */
 
@@ -2649,7 +3943,6 @@ void thread_down(void) {
                     i = lgw_gps2cnt(local_ref, gps_tx, &(txpkt.count_us));
                     if (i != LGW_GPS_SUCCESS) {
                         MSG("WARNING: [down] could not convert GPS time to timestamp, TX aborted\n");
-                        json_value_free(root_val);
                         continue;
                     } else {
                         MSG("INFO: [down] a packet will be sent on timestamp value %u (calculated from GPS time)\n", txpkt.count_us);
@@ -2660,187 +3953,26 @@ void thread_down(void) {
                 }
             }
 
-            /* Parse "No CRC" flag (optional field) */
-            val = json_object_get_value(txpk_obj,"ncrc");
-            if (val != NULL) {
-                txpkt.no_crc = (bool)json_value_get_boolean(val);
-            }
-
-            /* parse target frequency (mandatory) */
-            val = json_object_get_value(txpk_obj,"freq");
-            if (val == NULL) {
-                MSG("WARNING: [down] no mandatory \"txpk.freq\" object in JSON, TX aborted\n");
-                json_value_free(root_val);
-                continue;
-            }
-            txpkt.freq_hz = (uint32_t)((double)(1.0e6) * json_value_get_number(val));
-
-            /* parse RF chain used for TX (mandatory) */
-            val = json_object_get_value(txpk_obj,"rfch");
-            if (val == NULL) {
-                MSG("WARNING: [down] no mandatory \"txpk.rfch\" object in JSON, TX aborted\n");
-                json_value_free(root_val);
-                continue;
-            }
-            txpkt.rf_chain = (uint8_t)json_value_get_number(val);
-
-            /* parse TX power (optional field) */
-            val = json_object_get_value(txpk_obj,"powe");
-            if (val != NULL) {
-                txpkt.rf_power = (int8_t)json_value_get_number(val) - antenna_gain;
-            }
-
-            /* Parse modulation (mandatory) */
-            str = json_object_get_string(txpk_obj, "modu");
-            if (str == NULL) {
-                MSG("WARNING: [down] no mandatory \"txpk.modu\" object in JSON, TX aborted\n");
-                json_value_free(root_val);
-                continue;
+            /* TX power (optional field) */
+            if (txpk.powe_ok == true) {
+                txpkt.rf_power = txpk.powe - antenna_gain[brd];
             }
-            if (strcmp(str, "LORA") == 0) {
-                /* Lora modulation */
-                txpkt.modulation = MOD_LORA;
-
-                /* Parse Lora spreading-factor and modulation bandwidth (mandatory) */
-                str = json_object_get_string(txpk_obj, "datr");
-                if (str == NULL) {
-                    MSG("WARNING: [down] no mandatory \"txpk.datr\" object in JSON, TX aborted\n");
-                    json_value_free(root_val);
-                    continue;
-                }
-                i = sscanf(str, "SF%2hdBW%3hd", &x0, &x1);
-                if (i != 2) {
-                    MSG("WARNING: [down] format error in \"txpk.datr\", TX aborted\n");
-                    json_value_free(root_val);
-                    continue;
-                }
-                switch (x0) {
-                    case  5: txpkt.datarate = DR_LORA_SF5;  break;
-                    case  6: txpkt.datarate = DR_LORA_SF6;  break;
-                    case  7: txpkt.datarate = DR_LORA_SF7;  break;
-                    case  8: txpkt.datarate = DR_LORA_SF8;  break;
-                    case  9: txpkt.datarate = DR_LORA_SF9;  break;
-                    case 10: txpkt.datarate = DR_LORA_SF10; break;
-                    case 11: txpkt.datarate = DR_LORA_SF11; break;
-                    case 12: txpkt.datarate = DR_LORA_SF12; break;
-                    default:
-                        MSG("WARNING: [down] format error in \"txpk.datr\", invalid SF, TX aborted\n");
-                        json_value_free(root_val);
-                        continue;
-                }
-                switch (x1) {
-                    case 125: txpkt.bandwidth = BW_125KHZ; break;
-                    case 250: txpkt.bandwidth = BW_250KHZ; break;
-                    case 500: txpkt.bandwidth = BW_500KHZ; break;
-                    default:
-                        MSG("WARNING: [down] format error in \"txpk.datr\", invalid BW, TX aborted\n");
-                        json_value_free(root_val);
-                        continue;
-                }
-
-                /* Parse ECC coding rate (optional field) */
-                str = json_object_get_string(txpk_obj, "codr");
-                if (str == NULL) {
-                    MSG("WARNING: [down] no mandatory \"txpk.codr\" object in json, TX aborted\n");
-                    json_value_free(root_val);
-                    continue;
-                }
-                if      (strcmp(str, "4/5") == 0) txpkt.coderate = CR_LORA_4_5;
-                else if (strcmp(str, "4/6") == 0) txpkt.coderate = CR_LORA_4_6;
-                else if (strcmp(str, "2/3") == 0) txpkt.coderate = CR_LORA_4_6;
-                else if (strcmp(str, "4/7") == 0) txpkt.coderate = CR_LORA_4_7;
-                else if (strcmp(str, "4/8") == 0) txpkt.coderate = CR_LORA_4_8;
-                else if (strcmp(str, "1/2") == 0) txpkt.coderate = CR_LORA_4_8;
-                else {
-                    MSG("WARNING: [down] format error in \"txpk.codr\", TX aborted\n");
-                    json_value_free(root_val);
-                    continue;
-                }
-
-                /* Parse signal polarity switch (optional field) */
-                val = json_object_get_value(txpk_obj,"ipol");
-                if (val != NULL) {
-                    txpkt.invert_pol = (bool)json_value_get_boolean(val);
-                }
 
-                /* parse Lora preamble length (optional field, optimum min value enforced) */
-                val = json_object_get_value(txpk_obj,"prea");
-                if (val != NULL) {
-                    i = (int)json_value_get_number(val);
-                    if (i >= MIN_LORA_PREAMB) {
-                        txpkt.preamble = (uint16_t)i;
-                    } else {
-                        txpkt.preamble = (uint16_t)MIN_LORA_PREAMB;
-                    }
+            /* preamble length (optional field, optimum min value enforced) */
+            if (txpkt.modulation == MOD_LORA) {
+                if (txpk.prea_ok == true) {
+                    txpkt.preamble = (uint16_t)((txpk.prea >= MIN_LORA_PREAMB) ? txpk.prea : MIN_LORA_PREAMB);
                 } else {
                     txpkt.preamble = (uint16_t)STD_LORA_PREAMB;
                 }
-
-            } else if (strcmp(str, "FSK") == 0) {
-                /* FSK modulation */
-                txpkt.modulation = MOD_FSK;
-
-                /* parse FSK bitrate (mandatory) */
-                val = json_object_get_value(txpk_obj,"datr");
-                if (val == NULL) {
-                    MSG("WARNING: [down] no mandatory \"txpk.datr\" object in JSON, TX aborted\n");
-                    json_value_free(root_val);
-                    continue;
-                }
-                txpkt.datarate = (uint32_t)(json_value_get_number(val));
-
-                /* parse frequency deviation (mandatory) */
-                val = json_object_get_value(txpk_obj,"fdev");
-                if (val == NULL) {
-                    MSG("WARNING: [down] no mandatory \"txpk.fdev\" object in JSON, TX aborted\n");
-                    json_value_free(root_val);
-                    continue;
-                }
-                txpkt.f_dev = (uint8_t)(json_value_get_number(val) / 1000.0); /* JSON value in Hz, txpkt.f_dev in kHz */
-
-                /* parse FSK preamble length (optional field, optimum min value enforced) */
-                val = json_object_get_value(txpk_obj,"prea");
-                if (val != NULL) {
-                    i = (int)json_value_get_number(val);
-                    if (i >= MIN_FSK_PREAMB) {
-                        txpkt.preamble = (uint16_t)i;
-                    } else {
-                        txpkt.preamble = (uint16_t)MIN_FSK_PREAMB;
-                    }
+            } else {
+                if (txpk.prea_ok == true) {
+                    txpkt.preamble = (uint16_t)((txpk.prea >= MIN_FSK_PREAMB) ? txpk.prea : MIN_FSK_PREAMB);
                 } else {
                     txpkt.preamble = (uint16_t)STD_FSK_PREAMB;
                 }
-
-            } else {
-                MSG("WARNING: [down] invalid modulation in \"txpk.modu\", TX aborted\n");
-                json_value_free(root_val);
-                continue;
-            }
-
-            /* Parse payload length (mandatory) */
-            val = json_object_get_value(txpk_obj,"size");
-            if (val == NULL) {
-                MSG("WARNING: [down] no mandatory \"txpk.size\" object in JSON, TX aborted\n");
-                json_value_free(root_val);
-                continue;
-            }
-            txpkt.size = (uint16_t)json_value_get_number(val);
-
-            /* Parse payload data (mandatory) */
-            str = json_object_get_string(txpk_obj, "data");
-            if (str == NULL) {
-                MSG("WARNING: [down] no mandatory \"txpk.data\" object in JSON, TX aborted\n");
-                json_value_free(root_val);
-                continue;
-            }
-            i = b64_to_bin(str, strlen(str), txpkt.payload, sizeof txpkt.payload);
-            if (i != txpkt.size) {
-                MSG("WARNING: [down] mismatch between .size and .data size once converter to binary\n");
             }
 
-            /* free the JSON parse tree from memory */
-            json_value_free(root_val);
-
             /* select TX mode */
             if (sent_immediate) {
                 txpkt.tx_mode = IMMEDIATE;
@@ -2849,53 +3981,64 @@ void thread_down(void) {
             }
 
             /* record measurement data */
-            pthread_mutex_lock(&mx_meas_dw);
-            meas_dw_dgram_rcv += 1; /* count only datagrams with no JSON errors */
-            meas_dw_network_byte += msg_len; /* meas_dw_network_byte */
-            meas_dw_payload_byte += txpkt.size;
-            pthread_mutex_unlock(&mx_meas_dw);
+            MEAS_ADD(meas_dw.dw_dgram_rcv, 1); /* count only datagrams with no JSON errors */
+            MEAS_ADD(meas_dw.dw_network_byte, msg_len);
+            MEAS_ADD(meas_dw.dw_payload_byte, txpkt.size);
 
             /* reset error/warning results */
             jit_result = warning_result = JIT_ERROR_OK;
             warning_value = 0;
 
             /* check TX frequency before trying to queue packet */
-            if ((txpkt.freq_hz < tx_freq_min[txpkt.rf_chain]) || (txpkt.freq_hz > tx_freq_max[txpkt.rf_chain])) {
+            if ((txpkt.freq_hz < tx_freq_min[brd][txpkt.rf_chain]) || (txpkt.freq_hz > tx_freq_max[brd][txpkt.rf_chain])) {
                 jit_result = JIT_ERROR_TX_FREQ;
-                MSG("ERROR: Packet REJECTED, unsupported frequency - %u (min:%u,max:%u)\n", txpkt.freq_hz, tx_freq_min[txpkt.rf_chain], tx_freq_max[txpkt.rf_chain]);
+                MSG("ERROR: Packet REJECTED, unsupported frequency - %u (min:%u,max:%u)\n", txpkt.freq_hz, tx_freq_min[brd][txpkt.rf_chain], tx_freq_max[brd][txpkt.rf_chain]);
             }
 
             /* check TX power before trying to queue packet, send a warning if not supported */
             if (jit_result == JIT_ERROR_OK) {
-                i = get_tx_gain_lut_index(txpkt.rf_chain, txpkt.rf_power, &tx_lut_idx);
-                if ((i < 0) || (txlut[txpkt.rf_chain].lut[tx_lut_idx].rf_power != txpkt.rf_power)) {
+                i = get_tx_gain_lut_index(brd, txpkt.rf_chain, txpkt.rf_power, &tx_lut_idx);
+                if ((i < 0) || (txlut[brd][txpkt.rf_chain].lut[tx_lut_idx].rf_power != txpkt.rf_power)) {
                     /* this RF power is not supported, throw a warning, and use the closest lower power supported */
                     warning_result = JIT_ERROR_TX_POWER;
-                    warning_value = (int32_t)txlut[txpkt.rf_chain].lut[tx_lut_idx].rf_power;
+                    warning_value = (int32_t)txlut[brd][txpkt.rf_chain].lut[tx_lut_idx].rf_power;
                     printf("WARNING: Requested TX power is not supported (%ddBm), actual power used: %ddBm\n", txpkt.rf_power, warning_value);
-                    txpkt.rf_power = txlut[txpkt.rf_chain].lut[tx_lut_idx].rf_power;
+                    txpkt.rf_power = txlut[brd][txpkt.rf_chain].lut[tx_lut_idx].rf_power;
                 }
             }
 
             /* insert packet to be sent into JIT queue */
+            late_cause = DW_LATE_NB;
             if (jit_result == JIT_ERROR_OK) {
-                pthread_mutex_lock(&mx_concent);
                 lgw_get_instcnt(&current_concentrator_time);
-                pthread_mutex_unlock(&mx_concent);
-                jit_result = jit_enqueue(&jit_queue[txpkt.rf_chain], current_concentrator_time, &txpkt, downlink_type);
+                clock_gettime(CLOCK_MONOTONIC, &enqueue_time);
+                jit_result = jit_enqueue(&jit_queue[brd][txpkt.rf_chain], current_concentrator_time, &txpkt, downlink_type);
+
+                /* time left before TX when the PULL_RESP was received, to blame the server/network or the gateway */
+                if (sent_immediate == false) {
+                    proc_us = (int32_t)(1E6 * difftimespec(enqueue_time, recv_time));
+                    lead_us = (int32_t)(txpkt.count_us - current_concentrator_time);
+                    hist_add(meas_dw.dw_proc_hist, &meas_dw.dw_proc_sum_us, dw_delay_bins_us, DW_DELAY_BIN_NB, proc_us);
+                    hist_add(meas_dw.dw_lead_rx_hist, &meas_dw.dw_lead_rx_sum_us, dw_lead_bins_us, DW_LEAD_BIN_NB, lead_us + proc_us);
+                    if (jit_result == JIT_ERROR_TOO_LATE) {
+                        late_cause = ((lead_us + proc_us) <= JIT_MIN_LEAD_TIME) ? DW_LATE_NET : DW_LATE_GW;
+                        warning_value = lead_us;
+                        MSG("WARNING: [down] packet due in %d us when received, %d us when queued (%s)\n", lead_us + proc_us, lead_us, dw_late_name[late_cause]);
+                    }
+                }
                 if (jit_result != JIT_ERROR_OK) {
                     printf("ERROR: Packet REJECTED (jit error=%d)\n", jit_result);
                 } else {
+                    /* the new packet may be due before the JIT thread deadline */
+                    jit_wake();
                     /* In case of a warning having been raised before, we notify it */
                     jit_result = warning_result;
                 }
-                pthread_mutex_lock(&mx_meas_dw);
-                meas_nb_tx_requested += 1;
-                pthread_mutex_unlock(&mx_meas_dw);
+                MEAS_ADD(meas_dw.nb_tx_requested, 1);
             }
 
             /* Send acknoledge datagram to server */
-            send_tx_ack(buff_down[1], buff_down[2], jit_result, warning_value);
+            send_tx_ack(buff_down[1], buff_down[2], jit_result, warning_value, late_cause);
         }
     }
     MSG("\nINFO: End of downstream thread\n");
@@ -2925,6 +4068,46 @@ void print_tx_status(uint8_t tx_status) {
 /* -------------------------------------------------------------------------- */
 /* --- THREAD 3: CHECKING PACKETS TO BE SENT FROM JIT QUEUE AND SEND THEM --- */
 
+static void jit_wake(void) {
+    pthread_mutex_lock(&mx_jit_wake);
+    jit_wake_pending = true;
+    pthread_cond_signal(&cond_jit_wake);
+    pthread_mutex_unlock(&mx_jit_wake);
+}
+
+static void jit_sleep_cleanup(void *mutex) {
+    pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+static void jit_sleep(uint32_t delay_us) {
+    struct timespec wait_start, deadline;
+
+    if (delay_us > (JIT_WAIT_MAX_MS * 1000)) {
+        delay_us = JIT_WAIT_MAX_MS * 1000;
+    }
+
+    /* map the concentrator delay onto the host monotonic clock */
+    rtsched_wait_begin(&wait_start);
+    deadline = wait_start;
+    deadline.tv_sec += delay_us / 1000000;
+    deadline.tv_nsec += (long)(delay_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&mx_jit_wake);
+    pthread_cleanup_push(jit_sleep_cleanup, &mx_jit_wake); /* thread_jit is cancelled on exit */
+    while (!jit_wake_pending) {
+        if (pthread_cond_timedwait(&cond_jit_wake, &mx_jit_wake, &deadline) == ETIMEDOUT) {
+            rtsched_wait_end(RTSCHED_JIT, &wait_start, delay_us);
+            break;
+        }
+    }
+    jit_wake_pending = false;
+    pthread_cleanup_pop(1);
+}
+
 void thread_jit(void) {
     int result = LGW_HAL_SUCCESS;
     struct lgw_pkt_tx_s pkt;
@@ -2933,20 +4116,31 @@ void thread_jit(void) {
     enum jit_error_e jit_result;
     enum jit_pkt_type_e pkt_type;
     uint8_t tx_status;
-    int i;
+    uint32_t delay_us;
+    uint32_t next_delay_us;
+    struct timespec peek_time, send_start, send_end;
+    int32_t lead_us;
+    struct lgw_pkt_tx_s head_pkt;
+    enum jit_pkt_type_e head_type;
+    bool staged[LGW_BOARD_NB][LGW_RF_CHAIN_NB] = {{false}}; /* head packet of the queue programmed in the concentrator */
+    uint32_t staged_id[LGW_BOARD_NB][LGW_RF_CHAIN_NB];
+    uint32_t staged_count_us[LGW_BOARD_NB][LGW_RF_CHAIN_NB];
+    int b, i, k;
 
     while (!exit_sig && !quit_sig) {
-        wait_ms(10);
+        for (k = 0; k < (board_nb * LGW_RF_CHAIN_NB); k++) {
+            /* queues of each TX chain of each board */
+            b = k / LGW_RF_CHAIN_NB;
+            i = k % LGW_RF_CHAIN_NB;
+            lgw_board_select(b);
 
-        for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
             /* transfer data and metadata to the concentrator, and schedule TX */
-            pthread_mutex_lock(&mx_concent);
             lgw_get_instcnt(&current_concentrator_time);
-            pthread_mutex_unlock(&mx_concent);
-            jit_result = jit_peek(&jit_queue[i], current_concentrator_time, &pkt_index);
+            clock_gettime(CLOCK_MONOTONIC, &peek_time);
+            jit_result = jit_peek(&jit_queue[b][i], current_concentrator_time, &pkt_index);
             if (jit_result == JIT_ERROR_OK) {
                 if (pkt_index > -1) {
-                    jit_result = jit_dequeue(&jit_queue[i], pkt_index, &pkt, &pkt_type);
+                    jit_result = jit_dequeue(&jit_queue[b][i], pkt_index, &pkt, &pkt_type);
                     if (jit_result == JIT_ERROR_OK) {
                         /* update beacon stats */
                         if (pkt_type == JIT_PKT_TYPE_BEACON) {
@@ -2957,16 +4151,12 @@ void thread_jit(void) {
                             pthread_mutex_unlock(&mx_xcorr);
 
                             /* Update statistics */
-                            pthread_mutex_lock(&mx_meas_dw);
-                            meas_nb_beacon_sent += 1;
-                            pthread_mutex_unlock(&mx_meas_dw);
+                            MEAS_ADD(meas_jit.nb_beacon_sent, 1);
                             MSG("INFO: Beacon dequeued (count_us=%u)\n", pkt.count_us);
                         }
 
                         /* check if concentrator is free for sending new packet */
-                        pthread_mutex_lock(&mx_concent); /* may have to wait for a fetch to finish */
                         result = lgw_status(pkt.rf_chain, TX_STATUS, &tx_status);
-                        pthread_mutex_unlock(&mx_concent); /* free concentrator ASAP */
                         if (result == LGW_HAL_ERROR) {
                             MSG("WARNING: [jit%d] lgw_status failed\n", i);
                         } else {
@@ -2982,25 +4172,43 @@ void thread_jit(void) {
                             }
                         }
 
-                        /* send packet to concentrator */
-                        pthread_mutex_lock(&mx_concent); /* may have to wait for a fetch to finish */
-                        result = lgw_send(&pkt);
-                        pthread_mutex_unlock(&mx_concent); /* free concentrator ASAP */
+                        /* send packet to concentrator, time left before TX estimated from the peek counter */
+                        clock_gettime(CLOCK_MONOTONIC, &send_start);
+                        lead_us = (int32_t)(pkt.count_us - current_concentrator_time) - (int32_t)(1E6 * difftimespec(send_start, peek_time));
+                        if ((staged[b][i] == true) && (staged_count_us[b][i] == pkt.count_us) && (lgw_tx_arm(pkt.rf_chain, staged_id[b][i]) == LGW_HAL_SUCCESS)) {
+                            MEAS_ADD(meas_jit.nb_tx_staged, 1);
+                            result = LGW_HAL_SUCCESS;
+                        } else {
+                            result = lgw_send(&pkt); /* not staged, or overwritten since */
+                        }
+                        staged[b][i] = false;
+                        clock_gettime(CLOCK_MONOTONIC, &send_end);
+                        hist_add(meas_jit.dw_lead_tx_hist, &meas_jit.dw_lead_tx_sum_us, dw_lead_bins_us, DW_LEAD_BIN_NB, lead_us);
+                        hist_add(meas_jit.dw_send_hist, &meas_jit.dw_send_sum_us, dw_delay_bins_us, DW_DELAY_BIN_NB, (int32_t)(1E6 * difftimespec(send_end, send_start)));
+                        if (lead_us < TX_START_DELAY) {
+                            MEAS_ADD(meas_jit.dw_late_jit, 1);
+                            MSG("WARNING: [jit%d] packet handed to the concentrator %d us before TX\n", i, lead_us);
+                        }
                         if (result == LGW_HAL_ERROR) {
-                            pthread_mutex_lock(&mx_meas_dw);
-                            meas_nb_tx_fail += 1;
-                            pthread_mutex_unlock(&mx_meas_dw);
+                            MEAS_ADD(meas_jit.nb_tx_fail, 1);
                             MSG("WARNING: [jit] lgw_send failed on rf_chain %d\n", i);
                             continue;
                         } else {
-                            pthread_mutex_lock(&mx_meas_dw);
-                            meas_nb_tx_ok += 1;
-                            pthread_mutex_unlock(&mx_meas_dw);
+                            MEAS_ADD(meas_jit.nb_tx_ok, 1);
                             MSG_DEBUG(DEBUG_PKT_FWD, "lgw_send done on rf_chain %d: count_us=%u\n", i, pkt.count_us);
                         }
                     } else {
                         MSG("ERROR: jit_dequeue failed on rf_chain %d with %d\n", i, jit_result);
                     }
+                } else if (jit_head(&jit_queue[b][i], &head_pkt, &head_type) == JIT_ERROR_OK) {
+                    /* program the next timestamped downlink while the TX chain is free, it will only be triggered once due */
+                    if ((head_type != JIT_PKT_TYPE_BEACON) && (head_pkt.tx_mode == TIMESTAMPED) && ((staged[b][i] == false) || (staged_count_us[b][i] != head_pkt.count_us))) {
+                        staged[b][i] = (lgw_tx_stage(&head_pkt, &staged_id[b][i]) == LGW_HAL_SUCCESS);
+                        staged_count_us[b][i] = head_pkt.count_us;
+                        if (staged[b][i] == true) {
+                            MSG_DEBUG(DEBUG_JIT, "staged packet with count_us=%u on rf_chain %d\n", head_pkt.count_us, i);
+                        }
+                    }
                 }
             } else if (jit_result == JIT_ERROR_EMPTY) {
                 /* Do nothing, it can happen */
@@ -3008,6 +4216,23 @@ void thread_jit(void) {
                 MSG("ERROR: jit_peek failed on rf_chain %d with %d\n", i, jit_result);
             }
         }
+
+        /* sleep until the earliest packet enters its peek window, or until woken up by an enqueue */
+        next_delay_us = UINT32_MAX;
+        for (b = 0; b < board_nb; b++) {
+            lgw_board_select(b);
+            lgw_get_instcnt(&current_concentrator_time);
+            for (i = 0; i < LGW_RF_CHAIN_NB; i++) {
+                if (jit_next_due(&jit_queue[b][i], current_concentrator_time, &delay_us) == JIT_ERROR_OK) {
+                    if (delay_us < next_delay_us) {
+                        next_delay_us = delay_us;
+                    }
+                }
+            }
+        }
+        if (next_delay_us > 0) {
+            jit_sleep(next_delay_us);
+        }
     }
 }
 
@@ -3018,6 +4243,7 @@ static void gps_process_sync(void) {
     struct timespec gps_time;
     struct timespec utc;
     uint32_t trig_tstamp; /* concentrator timestamp associated with PPM pulse */
+    int b;
     int i = lgw_gps_get(&utc, &gps_time, NULL, NULL);
 
     /* get GPS time for synchronization */
@@ -3026,21 +4252,24 @@ static void gps_process_sync(void) {
         return;
     }
 
-    /* get timestamp captured on PPM pulse  */
-    pthread_mutex_lock(&mx_concent);
-    i = lgw_get_trigcnt(&trig_tstamp);
-    pthread_mutex_unlock(&mx_concent);
-    if (i != LGW_HAL_SUCCESS) {
-        MSG("WARNING: [gps] failed to read concentrator timestamp\n");
-        return;
-    }
+    /* the PPS is wired to every board, each one has its own time reference */
+    for (b = 0; b < board_nb; b++) {
+        lgw_board_select(b);
 
-    /* try to update time reference with the new GPS time & timestamp */
-    pthread_mutex_lock(&mx_timeref);
-    i = lgw_gps_sync(&time_reference_gps, trig_tstamp, utc, gps_time);
-    pthread_mutex_unlock(&mx_timeref);
-    if (i != LGW_GPS_SUCCESS) {
-        MSG("WARNING: [gps] GPS out of sync, keeping previous time reference\n");
+        /* get timestamp captured on PPM pulse  */
+        i = lgw_get_trigcnt(&trig_tstamp);
+        if (i != LGW_HAL_SUCCESS) {
+            MSG("WARNING: [gps] failed to read concentrator timestamp of board %d\n", b);
+            continue;
+        }
+
+        /* try to update time reference with the new GPS time & timestamp */
+        i = lgw_gps_sync(&gps_sync_ref[b], trig_tstamp, utc, gps_time);
+        if (i != LGW_GPS_SUCCESS) {
+            MSG("WARNING: [gps] GPS out of sync, keeping previous time reference of board %d\n", b);
+            continue;
+        }
+        timeref_publish(&time_reference_gps[b], &gps_sync_ref[b]);
     }
 }
 
@@ -3065,95 +4294,54 @@ static void gps_process_coords(void) {
 
 void thread_gps(void) {
     /* serial variables */
-    char serial_buff[128]; /* buffer to receive GPS data */
-    size_t wr_idx = 0;     /* pointer to end of chars in buffer */
+    char serial_buff[GPS_READ_SIZE]; /* buffer to receive GPS data */
+    struct lgw_gps_parser_s parser; /* keeps partial frames between reads */
+    uint32_t wait_us;
+    struct timespec delay;
 
     /* variables for PPM pulse GPS synchronization */
     enum gps_msg latest_msg; /* keep track of latest NMEA message parsed */
 
     /* initialize some variables before loop */
-    memset(serial_buff, 0, sizeof serial_buff);
+    lgw_gps_parser_init(&parser);
 
     while (!exit_sig && !quit_sig) {
         size_t rd_idx = 0;
-        size_t frame_end_idx = 0;
 
-        /* blocking non-canonical read on serial port */
-        ssize_t nb_char = read(gps_tty_fd, serial_buff + wr_idx, LGW_GPS_MIN_MSG_SIZE);
+        /* blocking non-canonical read on serial port, returns all the chars available */
+        ssize_t nb_char = read(gps_tty_fd, serial_buff, sizeof serial_buff);
         if (nb_char <= 0) {
             MSG("WARNING: [gps] read() returned value %zd\n", nb_char);
             continue;
         }
-        wr_idx += (size_t)nb_char;
-
-        /*******************************************
-         * Scan buffer for UBX/NMEA sync chars and *
-         * attempt to decode frame if one is found *
-         *******************************************/
-        while (rd_idx < wr_idx) {
-            size_t frame_size = 0;
-
-            /* Scan buffer for UBX sync char */
-            if (serial_buff[rd_idx] == (char)LGW_GPS_UBX_SYNC_CHAR) {
-
-                /***********************
-                 * Found UBX sync char *
-                 ***********************/
-                latest_msg = lgw_parse_ubx(&serial_buff[rd_idx], (wr_idx - rd_idx), &frame_size);
-
-                if (frame_size > 0) {
-                    if (latest_msg == INCOMPLETE) {
-                        /* UBX header found but frame appears to be missing bytes */
-                        frame_size = 0;
-                    } else if (latest_msg == INVALID) {
-                        /* message header received but message appears to be corrupted */
-                        MSG("WARNING: [gps] could not get a valid message from GPS (no time)\n");
-                        frame_size = 0;
-                    } else if (latest_msg == UBX_NAV_TIMEGPS) {
-                        gps_process_sync();
-                    }
-                }
-            } else if (serial_buff[rd_idx] == (char)LGW_GPS_NMEA_SYNC_CHAR) {
-                /************************
-                 * Found NMEA sync char *
-                 ************************/
-                /* scan for NMEA end marker (LF = 0x0a) */
-                char* nmea_end_ptr = memchr(&serial_buff[rd_idx],(int)0x0a, (wr_idx - rd_idx));
-
-                if(nmea_end_ptr) {
-                    /* found end marker */
-                    frame_size = nmea_end_ptr - &serial_buff[rd_idx] + 1;
-                    latest_msg = lgw_parse_nmea(&serial_buff[rd_idx], frame_size);
-
-                    if(latest_msg == INVALID || latest_msg == UNKNOWN) {
-                        /* checksum failed */
-                        frame_size = 0;
-                    } else if (latest_msg == NMEA_RMC) { /* Get location from RMC frames */
-                        gps_process_coords();
-                    }
-                }
-            }
 
-            if (frame_size > 0) {
-                /* At this point message is a checksum verified frame
-                   we're processed or ignored. Remove frame from buffer */
-                rd_idx += frame_size;
-                frame_end_idx = rd_idx;
-            } else {
-                rd_idx++;
+        /*********************************************
+         * Feed the stream parser, each byte once,   *
+         * and handle the frames as they complete    *
+         *********************************************/
+        while (rd_idx < (size_t)nb_char) {
+            size_t consumed = 0;
+
+            latest_msg = lgw_gps_parse_stream(&parser, &serial_buff[rd_idx], (size_t)nb_char - rd_idx, &consumed);
+            rd_idx += consumed;
+
+            if (latest_msg == INVALID) {
+                /* message received but appears to be corrupted */
+                MSG("WARNING: [gps] could not get a valid message from GPS (no time)\n");
+            } else if (latest_msg == UBX_NAV_TIMEGPS) {
+                /* sample the PPS counter right away, before the remaining bytes are parsed */
+                gps_process_sync();
+            } else if (latest_msg == NMEA_RMC) { /* Get location from RMC frames */
+                gps_process_coords();
             }
-        } /* ...for(rd_idx = 0... */
-
-        if (frame_end_idx) {
-          /* Frames have been processed. Remove bytes to end of last processed frame */
-          memcpy(serial_buff, &serial_buff[frame_end_idx], wr_idx - frame_end_idx);
-          wr_idx -= frame_end_idx;
-        } /* ...for(rd_idx = 0... */
+        }
 
-        /* Prevent buffer overflow */
-        if ((sizeof(serial_buff) - wr_idx) < LGW_GPS_MIN_MSG_SIZE) {
-            memcpy(serial_buff, &serial_buff[LGW_GPS_MIN_MSG_SIZE], wr_idx - LGW_GPS_MIN_MSG_SIZE);
-            wr_idx -= LGW_GPS_MIN_MSG_SIZE;
+        /* let the rest of the frame being received pile up, to get it in one read */
+        wait_us = lgw_gps_parser_wait_us(&parser);
+        if (wait_us > 0) {
+            delay.tv_sec = wait_us / 1000000;
+            delay.tv_nsec = (wait_us % 1000000) * 1000;
+            clock_nanosleep(CLOCK_MONOTONIC, 0, &delay, NULL);
         }
     }
     MSG("\nINFO: End of GPS thread\n");
@@ -3168,11 +4356,14 @@ void thread_valid(void) {
     long gps_ref_age = 0;
     bool ref_valid_local = false;
     double xtal_err_cpy;
+    struct tref local_ref; /* copy of the GPS time reference, to check its age */
+    int b;
 
     /* variables for XTAL correction averaging */
     unsigned init_cpt = 0;
     double init_acc = 0.0;
     double x;
+    struct timespec wait_start;
 
     /* correction debug */
     // FILE * log_file = NULL;
@@ -3188,23 +4379,29 @@ void thread_valid(void) {
 
     /* main loop task */
     while (!exit_sig && !quit_sig) {
+        rtsched_wait_begin(&wait_start);
         wait_ms(1000);
-
-        /* calculate when the time reference was last updated */
-        pthread_mutex_lock(&mx_timeref);
-        gps_ref_age = (long)difftime(time(NULL), time_reference_gps.systime);
-        if ((gps_ref_age >= 0) && (gps_ref_age <= GPS_REF_MAX_AGE)) {
-            /* time ref is ok, validate and  */
-            gps_ref_valid = true;
-            ref_valid_local = true;
-            xtal_err_cpy = time_reference_gps.xtal_err;
-            //printf("XTAL err: %.15lf (1/XTAL_err:%.15lf)\n", xtal_err_cpy, 1/xtal_err_cpy); // DEBUG
-        } else {
-            /* time ref is too old, invalidate */
-            gps_ref_valid = false;
-            ref_valid_local = false;
+        rtsched_wait_end(RTSCHED_VALID, &wait_start, 1000000);
+
+        /* follow the drift between the board counters, for the deduplication without GPS */
+        update_cnt_offsets();
+
+        /* calculate when the time references were last updated, the first board's one giving the XTAL correction */
+        for (b = board_nb - 1; b >= 0; b--) {
+            timeref_get(&time_reference_gps[b], &local_ref);
+            gps_ref_age = (long)difftime(time(NULL), local_ref.systime);
+            if ((gps_ref_age >= 0) && (gps_ref_age <= GPS_REF_MAX_AGE)) {
+                /* time ref is ok, validate and  */
+                timeref_set_valid(&time_reference_gps[b], true);
+                ref_valid_local = true;
+                xtal_err_cpy = local_ref.xtal_err;
+                //printf("XTAL err: %.15lf (1/XTAL_err:%.15lf)\n", xtal_err_cpy, 1/xtal_err_cpy); // DEBUG
+            } else {
+                /* time ref is too old, invalidate */
+                timeref_set_valid(&time_reference_gps[b], false);
+                ref_valid_local = false;
+            }
         }
-        pthread_mutex_unlock(&mx_timeref);
 
         /* manage XTAL correction */
         if (ref_valid_local == false) {
@@ -3243,4 +4440,196 @@ void thread_valid(void) {
     MSG("\nINFO: End of validation thread\n");
 }
 
+/* -------------------------------------------------------------------------- */
+/* --- THREAD 6: SENDING UPSTREAM DATAGRAMS AND COLLECTING THEIR ACKNOWLEDGES */
+
+void thread_up_net(void) {
+    int i, j, k; /* loop variables */
+    int nb_dgram, nb_sent, nb_ack;
+    int timeout_ms;
+    int rtt_ms;
+    uint16_t token;
+    struct timespec now, wait_start;
+    struct pollfd fds[1 + UP_SERVER_MAX];
+    struct up_server_s *srv;
+
+    /* data buffers */
+    struct pushq_dgram_s *dgram[PUSHQ_BATCH_MAX]; /* datagrams composed by the upstream thread */
+    uint8_t buff_ack[PUSHQ_BATCH_MAX * ACK_BUFF_SIZE]; /* buffers to receive acknowledges */
+    int ack_len[PUSHQ_BATCH_MAX];
+
+    /* wait for new datagrams to send, or for acknowledges from any server */
+    fds[0].fd = push_queue.wake_fd;
+    fds[0].events = POLLIN;
+    for (k = 0; k < up_server_nb; k++) {
+        fds[1 + k].fd = up_server[k].sock;
+        fds[1 + k].events = POLLIN;
+    }
+
+    while (!exit_sig && !quit_sig) {
+        /* sleep until the oldest pending datagram expires, exit flags are checked regularly */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timeout_ms = FETCH_WAIT_MS;
+        for (k = 0; k < up_server_nb; k++) {
+            i = pushq_track_next(&(up_server[k].track), &now, push_timeout_ms);
+            if ((i >= 0) && (i < timeout_ms)) {
+                timeout_ms = i;
+            }
+        }
+        rtsched_wait_begin(&wait_start);
+        i = poll(fds, 1 + up_server_nb, timeout_ms);
+        if ((i < 0) && (errno != EINTR)) {
+            MSG("ERROR: [up] poll returned %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if (i == 0) {
+            rtsched_wait_end(RTSCHED_UP_NET, &wait_start, (uint32_t)timeout_ms * 1000);
+        }
+
+        /* send all the datagrams ready to every server, several per system call, without waiting for acknowledges */
+        while ((nb_dgram = pushq_front(&push_queue, dgram, PUSHQ_BATCH_MAX)) > 0) {
+            for (k = 0; k < up_server_nb; k++) {
+                srv = &up_server[k];
+                for (j = 0; j < nb_dgram; j += nb_sent) {
+                    nb_sent = pushq_send(srv->sock, dgram + j, nb_dgram - j);
+                    if (nb_sent <= 0) {
+                        MSG("WARNING: [up] failed to send %d datagrams to %s (%s)\n", nb_dgram - j, srv->addr, strerror(errno));
+                        break; /* dropped for that server, never acknowledged */
+                    }
+                    clock_gettime(CLOCK_MONOTONIC, &now);
+                    for (i = j; i < (j + nb_sent); i++) {
+                        token = (uint16_t)((dgram[i]->buff[1] << 8) | dgram[i]->buff[2]);
+                        pushq_track_add(&(srv->track), token, &now);
+                    }
+                }
+                MEAS_ADD(meas_up_net.srv_dgram_sent[k], j); /* datagrams actually sent to that server */
+            }
+            for (i = 0; i < nb_dgram; i++) {
+                MEAS_ADD(meas_up_net.up_network_byte, dgram[i]->size); /* serialized once, whatever the number of servers */
+            }
+            uptrace_sent(&up_trace, nb_dgram);
+            if (nb_dgram > 1) {
+                MSG_DEBUG(DEBUG_PKT_FWD, "INFO: [up] %d datagrams sent in one call\n", nb_dgram);
+            }
+            pushq_release(&push_queue, nb_dgram);
+        }
+
+        /* match the acknowledges received with the datagrams in flight, server by server */
+        for (k = 0; k < up_server_nb; k++) {
+            srv = &up_server[k];
+            while ((nb_ack = pushq_recv(srv->sock, buff_ack, ACK_BUFF_SIZE, ack_len, PUSHQ_BATCH_MAX)) > 0) {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                for (i = 0; i < nb_ack; i++) {
+                    j = i * ACK_BUFF_SIZE;
+                    if ((ack_len[i] < 4) || (buff_ack[j] != protocol_version) || (buff_ack[j+3] != PKT_PUSH_ACK)) {
+                        //MSG("WARNING: [up] ignored invalid non-ACL packet\n");
+                        continue;
+                    }
+                    token = (uint16_t)((buff_ack[j+1] << 8) | buff_ack[j+2]);
+                    if (pushq_track_ack(&(srv->track), token, &now, &rtt_ms) == false) {
+                        //MSG("WARNING: [up] ignored out-of sync ACK packet\n");
+                        continue;
+                    }
+                    if (k == 0) {
+                        MSG("INFO: [up] PUSH_ACK received in %i ms\n", rtt_ms);
+                    } else {
+                        MSG("INFO: [up] PUSH_ACK received from %s in %i ms\n", srv->addr, rtt_ms);
+                    }
+                    MEAS_ADD(meas_up_net.srv_ack_rcv[k], 1);
+                }
+            }
+        }
+
+        /* forget the datagrams not acknowledged in time */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (k = 0; k < up_server_nb; k++) {
+            pushq_track_expire(&(up_server[k].track), &now, push_timeout_ms);
+        }
+    }
+    MSG("\nINFO: End of upstream network thread\n");
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- THREAD 7: DRAINING THE CONCENTRATOR RX BUFFER ------------------------ */
+
+void thread_fetch(void) {
+    int i;
+    int nb_pkt;
+    unsigned space;
+    bool ring_full = false;
+    struct timespec wait_start;
+    int board;
+
+    /* staging buffer, lgw_receive needs contiguous memory */
+    struct lgw_pkt_rx_s *rxpkt;
+
+    /* one fetch thread per board, in their creation order */
+    board = __atomic_fetch_add(&fetch_board_next, 1, __ATOMIC_RELAXED);
+    lgw_board_select((lgw_handle_t)board);
+
+    rxpkt = malloc(pkt_batch_max * sizeof *rxpkt);
+    if (rxpkt == NULL) {
+        MSG("ERROR: [fetch] failed to allocate the staging buffer, exiting\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (!exit_sig && !quit_sig) {
+        /* leave packets in the concentrator while the upstream thread catches up */
+        space = rxring_space(&rx_ring[board]);
+        if (space == 0) {
+            if (ring_full == false) {
+                MSG("WARNING: [fetch] RX ring of board %d full, upstream thread is late\n", board);
+                ring_full = true;
+            }
+            rtsched_wait_begin(&wait_start);
+            wait_ms(1);
+            rtsched_wait_end(RTSCHED_FETCH, &wait_start, 1000);
+            continue;
+        }
+        ring_full = false;
+
+        /* fetch packets */
+        uptrace_fetch_begin(&up_trace);
+        nb_pkt = lgw_receive((space < (unsigned)pkt_batch_max) ? space : (unsigned)pkt_batch_max, rxpkt);
+        if (nb_pkt == LGW_HAL_ERROR) {
+            MSG("ERROR: [fetch] failed packet fetch, exiting\n");
+            exit(EXIT_FAILURE);
+        }
+        if (nb_pkt > 0) {
+            uptrace_fetch_end(&up_trace, rxpkt, nb_pkt);
+            rxring_push(&rx_ring[board], rxpkt, nb_pkt);
+            continue;
+        }
+
+        /* wait for the RX buffer to be filled, the HAL only holds its locks while polling, not while sleeping */
+        rtsched_wait_begin(&wait_start);
+        i = lgw_receive_wait(FETCH_WAIT_MS);
+        if (i == LGW_HAL_ERROR) {
+            MSG("ERROR: [fetch] failed to wait for packets, exiting\n");
+            exit(EXIT_FAILURE);
+        }
+        if (i == 0) {
+            rtsched_wait_end(RTSCHED_FETCH, &wait_start, FETCH_WAIT_MS * 1000);
+        }
+    }
+    free(rxpkt);
+    MSG("\nINFO: End of fetch thread\n");
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- THREAD 8: SERVING THE METRICS ---------------------------------------- */
+
+void thread_metrics(void) {
+    MSG("INFO: [metrics] listening on %s port %s\n", metrics_address, metrics_port);
+
+    /* one request at a time, the counters are read without blocking the other threads */
+    while (!exit_sig && !quit_sig) {
+        if (metrics_serve(&metrics, 1000, metrics_render) < 0) {
+            MSG("WARNING: [metrics] failed to accept a connection (%s)\n", strerror(errno));
+            wait_ms(1000);
+        }
+    }
+    MSG("\nINFO: End of metrics thread\n");
+}
+
 /* --- EOF ------------------------------------------------------------------ */
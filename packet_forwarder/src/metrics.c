@@ -0,0 +1,240 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : HTTP listener serving the forwarder counters in the
+    Prometheus text exposition format
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#define _GNU_SOURCE     /* MSG_NOSIGNAL, getaddrinfo */
+
+#include <stdio.h>      /* printf, vsnprintf */
+#include <stdlib.h>     /* malloc, free */
+#include <string.h>     /* memset, strstr, strncmp */
+#include <stdarg.h>     /* va_list */
+#include <unistd.h>     /* close */
+#include <errno.h>      /* errno */
+#include <poll.h>       /* poll */
+#include <netdb.h>      /* getaddrinfo */
+#include <sys/socket.h> /* socket, bind, listen, accept */
+#include <sys/time.h>   /* timeval */
+
+#include "trace.h"
+#include "metrics.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define HEADER_SIZE     128 /* room left for the HTTP header, before the body */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void append(struct metrics_s *m, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (m->truncated == true) {
+        return;
+    }
+    va_start(ap, fmt);
+    n = vsnprintf(m->buff + m->len, METRICS_BUFF_SIZE - m->len, fmt, ap);
+    va_end(ap);
+    if ((n < 0) || ((size_t)n >= METRICS_BUFF_SIZE - m->len)) {
+        m->truncated = true;
+        m->buff[m->len] = '\0'; /* drop the partial line */
+        return;
+    }
+    m->len += n;
+}
+
+static int send_all(int sock, const char *buff, size_t size) {
+    ssize_t n;
+
+    while (size > 0) {
+        n = send(sock, buff, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return -1;
+        }
+        buff += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+int metrics_init(struct metrics_s *m, const char *address, const char *port) {
+    struct addrinfo hints;
+    struct addrinfo *result;
+    struct addrinfo *q;
+    int opt = 1;
+    int i;
+
+    if ((m == NULL) || (address == NULL) || (port == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+    memset(m, 0, sizeof *m);
+    m->sock = -1;
+
+    m->buff = malloc(METRICS_BUFF_SIZE);
+    if (m->buff == NULL) {
+        MSG("ERROR: failed to allocate metrics buffer\n");
+        return -1;
+    }
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    i = getaddrinfo(address, port, &hints, &result);
+    if (i != 0) {
+        MSG("ERROR: [metrics] getaddrinfo on address %s (port %s) returned %s\n", address, port, gai_strerror(i));
+        metrics_free(m);
+        return -1;
+    }
+    for (q = result; q != NULL; q = q->ai_next) {
+        m->sock = socket(q->ai_family, q->ai_socktype, q->ai_protocol);
+        if (m->sock == -1) {
+            continue;
+        }
+        setsockopt(m->sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof opt);
+        if ((bind(m->sock, q->ai_addr, q->ai_addrlen) == 0) && (listen(m->sock, 4) == 0)) {
+            break;
+        }
+        close(m->sock);
+        m->sock = -1;
+    }
+    freeaddrinfo(result);
+    if (m->sock == -1) {
+        MSG("ERROR: [metrics] failed to listen on %s (port %s)\n", address, port);
+        metrics_free(m);
+        return -1;
+    }
+
+    return 0;
+}
+
+void metrics_free(struct metrics_s *m) {
+    if (m->sock != -1) {
+        close(m->sock);
+        m->sock = -1;
+    }
+    free(m->buff);
+    m->buff = NULL;
+}
+
+int metrics_serve(struct metrics_s *m, int timeout_ms, metrics_render_t render) {
+    struct pollfd pfd = { .fd = m->sock, .events = POLLIN };
+    struct timeval tv = { METRICS_TIMEOUT_MS / 1000, (METRICS_TIMEOUT_MS % 1000) * 1000 };
+    char req[METRICS_REQ_SIZE];
+    char header[HEADER_SIZE];
+    size_t req_len = 0;
+    ssize_t n;
+    int sock;
+    int size;
+
+    n = poll(&pfd, 1, timeout_ms);
+    if (n <= 0) {
+        return ((n == 0) || (errno == EINTR)) ? 0 : -1;
+    }
+    sock = accept(m->sock, NULL, NULL);
+    if (sock == -1) {
+        return ((errno == EINTR) || (errno == ECONNABORTED)) ? 0 : -1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+
+    /* only the request line matters, read until the end of the headers */
+    while (req_len < sizeof req - 1) {
+        n = recv(sock, req + req_len, sizeof req - 1 - req_len, 0);
+        if (n <= 0) {
+            break;
+        }
+        req_len += n;
+        req[req_len] = '\0';
+        if (strstr(req, "\r\n\r\n") != NULL) {
+            break;
+        }
+    }
+    req[req_len] = '\0';
+
+    m->len = 0;
+    m->truncated = false;
+    m->buff[0] = '\0';
+    if ((strncmp(req, "GET /metrics ", 13) == 0) || (strncmp(req, "GET / ", 6) == 0)) {
+        render(m);
+        if (m->truncated == true) {
+            MSG("WARNING: [metrics] response truncated to %zu bytes\n", m->len);
+        }
+        size = snprintf(header, sizeof header, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", m->len);
+    } else {
+        size = snprintf(header, sizeof header, "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        m->len = 0;
+    }
+    if ((send_all(sock, header, size) == 0) && (m->len > 0)) {
+        send_all(sock, m->buff, m->len);
+    }
+    close(sock);
+
+    return 1;
+}
+
+void metrics_family(struct metrics_s *m, const char *name, const char *type, const char *help) {
+    append(m, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_uint(struct metrics_s *m, const char *name, const char *labels, uint64_t value) {
+    if (labels == NULL) {
+        append(m, "%s %llu\n", name, (unsigned long long)value);
+    } else {
+        append(m, "%s{%s} %llu\n", name, labels, (unsigned long long)value);
+    }
+}
+
+void metrics_real(struct metrics_s *m, const char *name, const char *labels, double value) {
+    if (labels == NULL) {
+        append(m, "%s %.6g\n", name, value);
+    } else {
+        append(m, "%s{%s} %.6g\n", name, labels, value);
+    }
+}
+
+void metrics_hist(struct metrics_s *m, const char *name, const char *labels, const int32_t *bins_us, const uint32_t *hist, int nb_bins, int64_t sum_us) {
+    const char *sep = (labels == NULL) ? "" : ",";
+    uint64_t cumul = 0;
+    int i;
+
+    if (labels == NULL) {
+        labels = "";
+    }
+    for (i = 0; i < nb_bins; i++) {
+        cumul += hist[i];
+        if (i < (nb_bins - 1)) {
+            append(m, "%s_bucket{%s%sle=\"%.6g\"} %llu\n", name, labels, sep, bins_us[i] / 1E6, (unsigned long long)cumul);
+        } else {
+            append(m, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep, (unsigned long long)cumul);
+        }
+    }
+    if (labels[0] == '\0') {
+        append(m, "%s_sum %.6f\n", name, sum_us / 1E6);
+        append(m, "%s_count %llu\n", name, (unsigned long long)cumul);
+    } else {
+        append(m, "%s_sum{%s} %.6f\n", name, labels, sum_us / 1E6);
+        append(m, "%s_count{%s} %llu\n", name, labels, (unsigned long long)cumul);
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,171 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : NetID/DevAddr prefix filter of the uplink packets, to
+    forward only the traffic of the wanted networks
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* qsort */
+#include <string.h>     /* memset */
+
+#include "trace.h"
+#include "netfilt.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEVADDR_MIN_SIZE    8       /* MHDR, DevAddr, FCtrl, FCnt */
+
+/* LoRaWAN MHDR message types carrying a DevAddr: (un)confirmed data up/down */
+#define MTYPE_DATA_FIRST    2
+#define MTYPE_DATA_LAST     5
+
+/* NwkID length for each NetID type (LoRaWAN Backend Interfaces), the DevAddr
+   prefix being the type (as many 1 as the type value, then a 0) and the NwkID */
+static const int nwkid_bits[8] = {6, 6, 9, 11, 12, 13, 15, 17};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static int compare_range(const void *a, const void *b) {
+    uint32_t x = ((const struct netfilt_range_s *)a)->first;
+    uint32_t y = ((const struct netfilt_range_s *)b)->first;
+
+    return (x > y) - (x < y);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+void netfilt_init(struct netfilt_s *f, bool allow) {
+    memset(f, 0, sizeof *f);
+    f->allow = allow;
+}
+
+int netfilt_add_netid(struct netfilt_s *f, uint32_t netid) {
+    uint32_t type;
+    uint32_t prefix;
+    int len;
+
+    if (netid > 0xFFFFFF) {
+        MSG("ERROR: invalid NetID %X\n", netid);
+        return -1;
+    }
+    type = netid >> 21;
+    len = (int)type + 1 + nwkid_bits[type];
+    prefix = ((0xFF << (8 - type)) & 0xFF) << 24; /* type MSB set, then a 0 */
+    prefix |= (netid & ((1u << nwkid_bits[type]) - 1)) << (32 - len);
+
+    return netfilt_add_prefix(f, prefix, len);
+}
+
+int netfilt_add_prefix(struct netfilt_s *f, uint32_t devaddr, int len) {
+    uint32_t mask;
+
+    if ((len < 1) || (len > 32)) {
+        MSG("ERROR: invalid DevAddr prefix length %d\n", len);
+        return -1;
+    }
+    if (f->nb >= NETFILT_PREFIX_MAX) {
+        MSG("ERROR: too many prefixes in the filter list (max %d)\n", NETFILT_PREFIX_MAX);
+        return -1;
+    }
+
+    mask = (len == 32) ? 0xFFFFFFFF : ~(0xFFFFFFFF >> len);
+    f->range[f->nb].first = devaddr & mask;
+    f->range[f->nb].last = devaddr | ~mask;
+    f->nb += 1;
+    f->enabled = true;
+
+    return 0;
+}
+
+void netfilt_build(struct netfilt_s *f) {
+    uint32_t m;
+    int i, n;
+
+    if (f->nb == 0) {
+        return;
+    }
+
+    /* sort, then merge the ranges included in or adjacent to the previous one */
+    qsort(f->range, f->nb, sizeof f->range[0], compare_range);
+    n = 0;
+    for (i = 1; i < f->nb; i++) {
+        if ((f->range[n].last == 0xFFFFFFFF) || (f->range[i].first <= f->range[n].last + 1)) {
+            if (f->range[i].last > f->range[n].last) {
+                f->range[n].last = f->range[i].last;
+            }
+        } else {
+            n += 1;
+            f->range[n] = f->range[i];
+        }
+    }
+    f->nb = n + 1;
+
+    /* most packets of foreign networks are rejected by this bitmap lookup */
+    memset(f->msb, 0, sizeof f->msb);
+    for (i = 0; i < f->nb; i++) {
+        for (m = f->range[i].first >> 24; m <= (f->range[i].last >> 24); m++) {
+            f->msb[m / 32] |= 1u << (m % 32);
+        }
+    }
+}
+
+bool netfilt_match(const struct netfilt_s *f, uint32_t devaddr) {
+    uint32_t m = devaddr >> 24;
+    int lo, hi, mid;
+
+    if ((f->msb[m / 32] & (1u << (m % 32))) == 0) {
+        return false;
+    }
+
+    /* last range starting before the DevAddr */
+    lo = 0;
+    hi = f->nb - 1;
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if (f->range[mid].first <= devaddr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return (devaddr >= f->range[lo].first) && (devaddr <= f->range[lo].last);
+}
+
+bool netfilt_forward(const struct netfilt_s *f, const struct lgw_pkt_rx_s *p) {
+    uint32_t devaddr;
+    uint8_t mtype;
+
+    if ((f->enabled == false) || (p->status != STAT_CRC_OK) || (p->size < DEVADDR_MIN_SIZE)) {
+        return true;
+    }
+
+    /* join requests and proprietary frames do not carry a DevAddr */
+    mtype = p->payload[0] >> 5;
+    if ((mtype < MTYPE_DATA_FIRST) || (mtype > MTYPE_DATA_LAST)) {
+        return true;
+    }
+
+    devaddr  = (uint32_t)p->payload[1];
+    devaddr |= (uint32_t)p->payload[2] << 8;
+    devaddr |= (uint32_t)p->payload[3] << 16;
+    devaddr |= (uint32_t)p->payload[4] << 24;
+
+    return netfilt_match(f, devaddr) == f->allow;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
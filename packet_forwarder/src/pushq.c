@@ -0,0 +1,245 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : queue of PUSH_DATA datagrams between the packet fetch
+    and the network send, and tracking of their acknowledges
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#define _GNU_SOURCE     /* sendmmsg, recvmmsg */
+
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* malloc, free */
+#include <string.h>     /* memset, memmove */
+#include <unistd.h>     /* read, write, close */
+#include <errno.h>      /* errno */
+#include <sys/socket.h> /* sendmmsg, recvmmsg */
+#include <sys/eventfd.h>
+
+#include "trace.h"
+#include "pushq.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static int elapsed_ms(const struct timespec *end, const struct timespec *beginning) {
+    return (int)((end->tv_sec - beginning->tv_sec) * 1000 + (end->tv_nsec - beginning->tv_nsec) / 1000000);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+int pushq_init(struct pushq_s *q, unsigned buff_size) {
+    int i;
+
+    if (q == NULL) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    memset(q, 0, sizeof *q);
+    pthread_mutex_init(&(q->mx), NULL);
+    q->buff_size = buff_size;
+    q->wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (q->wake_fd == -1) {
+        MSG("ERROR: failed to create upstream queue event (%s)\n", strerror(errno));
+        return -1;
+    }
+    for (i = 0; i < PUSHQ_SIZE; i++) {
+        q->dgram[i].buff = malloc(buff_size);
+        if (q->dgram[i].buff == NULL) {
+            MSG("ERROR: failed to allocate upstream queue buffers\n");
+            pushq_free(q);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void pushq_free(struct pushq_s *q) {
+    int i;
+
+    for (i = 0; i < PUSHQ_SIZE; i++) {
+        free(q->dgram[i].buff);
+        q->dgram[i].buff = NULL;
+    }
+    if (q->wake_fd != -1) {
+        close(q->wake_fd);
+        q->wake_fd = -1;
+    }
+    pthread_mutex_destroy(&(q->mx));
+}
+
+uint8_t * pushq_reserve(struct pushq_s *q) {
+    uint8_t *buff = NULL;
+
+    pthread_mutex_lock(&(q->mx));
+    if (q->count < PUSHQ_SIZE) {
+        buff = q->dgram[(q->head + q->count) % PUSHQ_SIZE].buff;
+    }
+    pthread_mutex_unlock(&(q->mx));
+
+    return buff;
+}
+
+void pushq_commit(struct pushq_s *q, int size) {
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&(q->mx));
+    q->dgram[(q->head + q->count) % PUSHQ_SIZE].size = size;
+    q->count += 1;
+    pthread_mutex_unlock(&(q->mx));
+
+    if (write(q->wake_fd, &one, sizeof one) != sizeof one) {
+        MSG("WARNING: [up] failed to wake network thread\n");
+    }
+}
+
+int pushq_front(struct pushq_s *q, struct pushq_dgram_s **dgram, int max) {
+    uint64_t events;
+    int i, n;
+
+    /* clear the event first, a commit racing with this call will set it again */
+    if (read(q->wake_fd, &events, sizeof events) < 0) {
+        /* EAGAIN: no new commit since last call */
+    }
+
+    pthread_mutex_lock(&(q->mx));
+    n = ((int)q->count < max) ? (int)q->count : max;
+    for (i = 0; i < n; i++) {
+        dgram[i] = &(q->dgram[(q->head + i) % PUSHQ_SIZE]);
+    }
+    pthread_mutex_unlock(&(q->mx));
+
+    return n;
+}
+
+void pushq_release(struct pushq_s *q, int n) {
+    pthread_mutex_lock(&(q->mx));
+    q->head = (q->head + n) % PUSHQ_SIZE;
+    q->count -= n;
+    pthread_mutex_unlock(&(q->mx));
+}
+
+int pushq_send(int sock, struct pushq_dgram_s * const *dgram, int n) {
+    struct mmsghdr msg[PUSHQ_BATCH_MAX];
+    struct iovec iov[PUSHQ_BATCH_MAX];
+    int i;
+
+    if (n > PUSHQ_BATCH_MAX) {
+        n = PUSHQ_BATCH_MAX;
+    }
+    if (n == 1) {
+        return (send(sock, dgram[0]->buff, dgram[0]->size, 0) < 0) ? -1 : 1;
+    }
+
+    memset(msg, 0, n * sizeof msg[0]);
+    for (i = 0; i < n; i++) {
+        iov[i].iov_base = dgram[i]->buff;
+        iov[i].iov_len = dgram[i]->size;
+        msg[i].msg_hdr.msg_iov = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    return sendmmsg(sock, msg, n, 0);
+}
+
+int pushq_recv(int sock, uint8_t *buff, int size, int *len, int n) {
+    struct mmsghdr msg[PUSHQ_BATCH_MAX];
+    struct iovec iov[PUSHQ_BATCH_MAX];
+    int i, r;
+
+    if (n > PUSHQ_BATCH_MAX) {
+        n = PUSHQ_BATCH_MAX;
+    }
+
+    memset(msg, 0, n * sizeof msg[0]);
+    for (i = 0; i < n; i++) {
+        iov[i].iov_base = buff + (i * size);
+        iov[i].iov_len = size;
+        msg[i].msg_hdr.msg_iov = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    r = recvmmsg(sock, msg, n, MSG_DONTWAIT, NULL);
+    if (r < 0) {
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    }
+    for (i = 0; i < r; i++) {
+        len[i] = (int)msg[i].msg_len;
+    }
+
+    return r;
+}
+
+bool pushq_track_add(struct pushq_track_s *t, uint16_t token, const struct timespec *now) {
+    bool evicted = false;
+
+    if (t->nb == PUSHQ_INFLIGHT_MAX) {
+        /* oldest datagram considered lost */
+        memmove(&(t->entry[0]), &(t->entry[1]), (PUSHQ_INFLIGHT_MAX - 1) * sizeof t->entry[0]);
+        t->nb -= 1;
+        evicted = true;
+    }
+    t->entry[t->nb].token = token;
+    t->entry[t->nb].sent = *now;
+    t->nb += 1;
+
+    return evicted;
+}
+
+bool pushq_track_ack(struct pushq_track_s *t, uint16_t token, const struct timespec *now, int *rtt_ms) {
+    unsigned i;
+
+    for (i = 0; i < t->nb; i++) {
+        if (t->entry[i].token == token) {
+            if (rtt_ms != NULL) {
+                *rtt_ms = elapsed_ms(now, &(t->entry[i].sent));
+            }
+            memmove(&(t->entry[i]), &(t->entry[i + 1]), (t->nb - i - 1) * sizeof t->entry[0]);
+            t->nb -= 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+unsigned pushq_track_expire(struct pushq_track_s *t, const struct timespec *now, unsigned timeout_ms) {
+    unsigned n = 0;
+
+    /* entries are sorted by send time */
+    while ((n < t->nb) && (elapsed_ms(now, &(t->entry[n].sent)) >= (int)timeout_ms)) {
+        n++;
+    }
+    if (n > 0) {
+        memmove(&(t->entry[0]), &(t->entry[n]), (t->nb - n) * sizeof t->entry[0]);
+        t->nb -= n;
+    }
+
+    return n;
+}
+
+int pushq_track_next(const struct pushq_track_s *t, const struct timespec *now, unsigned timeout_ms) {
+    int left;
+
+    if (t->nb == 0) {
+        return -1;
+    }
+    left = (int)timeout_ms - elapsed_ms(now, &(t->entry[0].sent));
+
+    return (left > 0) ? left : 0;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
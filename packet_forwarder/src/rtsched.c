@@ -0,0 +1,190 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : CPU affinity, real-time priority and memory locking of
+    the forwarder threads, and scheduling latency they observe
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#define _GNU_SOURCE     /* pthread_setaffinity_np, CPU_SET */
+
+#include <stdio.h>      /* printf */
+#include <string.h>     /* memset, strerror */
+#include <errno.h>      /* errno */
+#include <sched.h>      /* SCHED_FIFO, cpu_set_t */
+#include <sys/mman.h>   /* mlockall */
+
+#include "trace.h"
+#include "rtsched.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct rtsched_thread_s {
+    struct rtsched_conf_s conf;
+    void (*fn)(void);       /* thread function, called once scheduled */
+    uint32_t nb;            /* timed waits that expired */
+    uint64_t sum_us;        /* sum of their wake-up delay */
+    uint32_t max_us;
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static const char * thread_name[RTSCHED_THREAD_NB] = {"fetch", "up", "up_net", "down", "jit", "gps", "valid", "metrics"};
+
+static struct rtsched_thread_s threads[RTSCHED_THREAD_NB];
+static pthread_mutex_t mx_stats = PTHREAD_MUTEX_INITIALIZER; /* latency of all threads, locked on timeouts only */
+static bool memory_locked = false;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void prefault_stack(void) {
+    volatile uint8_t stack[RTSCHED_PREFAULT];
+
+    memset((uint8_t *)stack, 0, sizeof stack);
+}
+
+static void *thread_start(void *arg) {
+    struct rtsched_thread_s *t = (struct rtsched_thread_s *)arg;
+    const char *name = thread_name[t - threads];
+    struct sched_param param;
+    cpu_set_t cpus;
+    int i;
+
+    /* applied by the thread itself, so that a missing privilege is not fatal */
+    if (t->conf.cpus != 0) {
+        CPU_ZERO(&cpus);
+        for (i = 0; i < RTSCHED_CPU_MAX; i++) {
+            if ((t->conf.cpus & (1u << i)) != 0) {
+                CPU_SET(i, &cpus);
+            }
+        }
+        i = pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus);
+        if (i != 0) {
+            MSG("WARNING: [%s] failed to set CPU affinity 0x%X (%s)\n", name, t->conf.cpus, strerror(i));
+        }
+    }
+    if (t->conf.priority > 0) {
+        memset(&param, 0, sizeof param);
+        param.sched_priority = t->conf.priority;
+        i = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (i != 0) {
+            MSG("WARNING: [%s] failed to set SCHED_FIFO priority %d (%s)\n", name, t->conf.priority, strerror(i));
+        }
+    }
+    if (memory_locked == true) {
+        prefault_stack();
+    }
+
+    t->fn();
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+const char * rtsched_name(enum rtsched_thread_e thread) {
+    return (thread < RTSCHED_THREAD_NB) ? thread_name[thread] : "?";
+}
+
+int rtsched_setconf(enum rtsched_thread_e thread, const struct rtsched_conf_s *conf) {
+    if ((thread >= RTSCHED_THREAD_NB) || (conf == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+    if ((conf->priority < 0) || ((conf->priority > 0) && ((conf->priority < sched_get_priority_min(SCHED_FIFO)) || (conf->priority > sched_get_priority_max(SCHED_FIFO))))) {
+        MSG("ERROR: invalid SCHED_FIFO priority %d for %s thread, %d to %d expected\n", conf->priority, thread_name[thread], sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+        return -1;
+    }
+
+    threads[thread].conf = *conf;
+    return 0;
+}
+
+int rtsched_lock_memory(void) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        MSG("ERROR: failed to lock memory (%s)\n", strerror(errno));
+        return -1;
+    }
+    memory_locked = true;
+    return 0;
+}
+
+int rtsched_create(pthread_t *thrid, enum rtsched_thread_e thread, void (*fn)(void)) {
+    pthread_attr_t attr;
+    int i;
+
+    if (thread >= RTSCHED_THREAD_NB) {
+        return EINVAL;
+    }
+    threads[thread].fn = fn;
+
+    /* locked stacks are committed as a whole */
+    pthread_attr_init(&attr);
+    if ((memory_locked == true) || (LOW_MEMORY == 1)) {
+        pthread_attr_setstacksize(&attr, RTSCHED_STACK_SIZE);
+    }
+    i = pthread_create(thrid, &attr, thread_start, &threads[thread]);
+    pthread_attr_destroy(&attr);
+
+    return i;
+}
+
+void rtsched_wait_begin(struct timespec *start) {
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+void rtsched_wait_end(enum rtsched_thread_e thread, const struct timespec *start, uint32_t timeout_us) {
+    struct timespec now;
+    int64_t late_us;
+    struct rtsched_thread_s *t;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    late_us = (int64_t)(now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000 - timeout_us;
+    if ((late_us < 0) || (thread >= RTSCHED_THREAD_NB)) {
+        return; /* woken up before the timeout */
+    }
+
+    t = &threads[thread];
+    pthread_mutex_lock(&mx_stats);
+    t->nb += 1;
+    t->sum_us += (uint64_t)late_us;
+    if (late_us > t->max_us) {
+        t->max_us = (uint32_t)late_us;
+    }
+    pthread_mutex_unlock(&mx_stats);
+}
+
+void rtsched_get_stats(enum rtsched_thread_e thread, struct rtsched_stats_s *stats, bool reset) {
+    struct rtsched_thread_s *t;
+
+    if ((thread >= RTSCHED_THREAD_NB) || (stats == NULL)) {
+        return;
+    }
+
+    t = &threads[thread];
+    pthread_mutex_lock(&mx_stats);
+    stats->nb = t->nb;
+    stats->avg_us = (t->nb > 0) ? (uint32_t)(t->sum_us / t->nb) : 0;
+    stats->max_us = t->max_us;
+    if (reset == true) {
+        t->nb = 0;
+        t->sum_us = 0;
+        t->max_us = 0;
+    }
+    pthread_mutex_unlock(&mx_stats);
+}
+
+/* --- EOF ------------------------------------------------------------------ */
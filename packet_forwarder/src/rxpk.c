@@ -0,0 +1,279 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : uplink packets serialization
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>      /* printf */
+#include <string.h>     /* memcpy */
+#include <math.h>       /* roundf, rint, signbit */
+
+#include "trace.h"
+#include "rxpk.h"
+#include "base64.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define PUT_STR(d, s)   do { memcpy((d), (s), sizeof(s) - 1); (d) += sizeof(s) - 1; } while (0)
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS & TYPES -------------------------------------------- */
+
+struct str_s {
+    const char *str;
+    int len;
+};
+
+#define STR(s)  { s, sizeof(s) - 1 }
+
+/* LoRa spreading factor, indexed by DR_LORA_SFx */
+static const struct str_s lora_sf_str[DR_LORA_SF12 + 1] = {
+    [DR_LORA_SF5]  = STR(",\"datr\":\"SF5"),
+    [DR_LORA_SF6]  = STR(",\"datr\":\"SF6"),
+    [DR_LORA_SF7]  = STR(",\"datr\":\"SF7"),
+    [DR_LORA_SF8]  = STR(",\"datr\":\"SF8"),
+    [DR_LORA_SF9]  = STR(",\"datr\":\"SF9"),
+    [DR_LORA_SF10] = STR(",\"datr\":\"SF10"),
+    [DR_LORA_SF11] = STR(",\"datr\":\"SF11"),
+    [DR_LORA_SF12] = STR(",\"datr\":\"SF12")
+};
+
+/* LoRa bandwidth, indexed by BW_xxxKHZ */
+static const struct str_s lora_bw_str[BW_500KHZ + 1] = {
+    [BW_125KHZ] = STR("BW125\""),
+    [BW_250KHZ] = STR("BW250\""),
+    [BW_500KHZ] = STR("BW500\"")
+};
+
+/* LoRa coding rate, indexed by CR_LORA_4_x, 0 is the CR0 case (mostly false sync) */
+static const struct str_s lora_cr_str[CR_LORA_4_8 + 1] = {
+    [0]           = STR(",\"codr\":\"OFF\""),
+    [CR_LORA_4_5] = STR(",\"codr\":\"4/5\""),
+    [CR_LORA_4_6] = STR(",\"codr\":\"4/6\""),
+    [CR_LORA_4_7] = STR(",\"codr\":\"4/7\""),
+    [CR_LORA_4_8] = STR(",\"codr\":\"4/8\"")
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static char * put_uint(char *dest, uint64_t val, int min_digits, char pad) {
+    /* decimal representation of val, left-padded on min_digits chars */
+    char tmp[20];
+    int n = 0;
+
+    do {
+        tmp[n++] = '0' + (char)(val % 10);
+        val /= 10;
+    } while (val != 0);
+    while (n < min_digits) {
+        tmp[n++] = pad;
+    }
+    while (n > 0) {
+        *dest++ = tmp[--n];
+    }
+
+    return dest;
+}
+
+static char * put_int(char *dest, int64_t val) {
+    if (val < 0) {
+        *dest++ = '-';
+        return put_uint(dest, (uint64_t)(-(val + 1)) + 1, 1, '0');
+    }
+    return put_uint(dest, (uint64_t)val, 1, '0');
+}
+
+static char * put_float(char *dest, float val, int decimals) {
+    /* same output as printf("%.0f") or printf("%.1f"), val being exact in a double once scaled by 10:
+       rint() rounds half to even, like the C library does on exact binary values */
+    double scale = (decimals == 0) ? 1.0 : 10.0;
+    uint64_t mag;
+
+    if (signbit(val)) {
+        *dest++ = '-';
+    }
+    mag = (uint64_t)rint(fabs((double)val) * scale);
+    if (decimals == 0) {
+        return put_uint(dest, mag, 1, '0');
+    }
+    dest = put_uint(dest, mag / 10, 1, '0');
+    *dest++ = '.';
+    *dest++ = '0' + (char)(mag % 10);
+
+    return dest;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+int rxpk_json_write(const struct lgw_pkt_rx_s *p, const struct timespec *utc, const uint64_t *gps_ms, int board, char *dest, int size) {
+    char *d = dest;
+    struct tm x;
+    int j;
+
+    if ((p == NULL) || (dest == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    /* every field but the payload has a bounded length */
+    if (size < (RXPK_JSON_META_MAX + (4 * ((p->size + 2) / 3)))) {
+        MSG("ERROR: [up] not enough space to serialize packet (%d bytes left)\n", size);
+        return -1;
+    }
+
+    /* JSON rxpk frame format version, 8 useful chars */
+    PUT_STR(d, "{\"jver\":");
+    d = put_uint(d, PROTOCOL_JSON_RXPK_FRAME_FORMAT, 1, '0');
+
+    /* RAW timestamp, 8-17 useful chars */
+    PUT_STR(d, ",\"tmst\":");
+    d = put_uint(d, p->count_us, 1, '0');
+
+    /* Packet RX time (GPS based), 37 useful chars */
+    if ((utc != NULL) && (gmtime_r(&(utc->tv_sec), &x) != NULL)) {
+        /* ISO 8601 format */
+        PUT_STR(d, ",\"time\":\"");
+        d = put_uint(d, x.tm_year + 1900, 4, '0');
+        *d++ = '-';
+        d = put_uint(d, x.tm_mon + 1, 2, '0');
+        *d++ = '-';
+        d = put_uint(d, x.tm_mday, 2, '0');
+        *d++ = 'T';
+        d = put_uint(d, x.tm_hour, 2, '0');
+        *d++ = ':';
+        d = put_uint(d, x.tm_min, 2, '0');
+        *d++ = ':';
+        d = put_uint(d, x.tm_sec, 2, '0');
+        *d++ = '.';
+        d = put_uint(d, utc->tv_nsec / 1000, 6, '0');
+        PUT_STR(d, "Z\"");
+    }
+    if (gps_ms != NULL) {
+        /* GPS time in milliseconds since 06.Jan.1980 */
+        PUT_STR(d, ",\"tmms\":");
+        d = put_uint(d, *gps_ms, 1, '0');
+    }
+
+    /* Concentrator board, only with several boards, 8 useful chars */
+    if (board >= 0) {
+        PUT_STR(d, ",\"brd\":");
+        d = put_uint(d, (unsigned)board, 1, '0');
+    }
+
+    /* Packet concentrator channel, RF chain & RX frequency, 34-36 useful chars */
+    PUT_STR(d, ",\"chan\":");
+    d = put_uint(d, p->if_chain, 1, '0');
+    PUT_STR(d, ",\"rfch\":");
+    d = put_uint(d, p->rf_chain, 1, '0');
+    PUT_STR(d, ",\"freq\":");
+    d = put_uint(d, p->freq_hz / 1000000, 1, '0');
+    *d++ = '.';
+    d = put_uint(d, p->freq_hz % 1000000, 6, '0');
+    PUT_STR(d, ",\"mid\":");
+    d = put_uint(d, p->modem_id, 2, ' ');
+
+    /* Packet status, 9-10 useful chars */
+    switch (p->status) {
+        case STAT_CRC_OK:
+            PUT_STR(d, ",\"stat\":1");
+            break;
+        case STAT_CRC_BAD:
+            PUT_STR(d, ",\"stat\":-1");
+            break;
+        case STAT_NO_CRC:
+            PUT_STR(d, ",\"stat\":0");
+            break;
+        default:
+            MSG("ERROR: [up] received packet with unknown status 0x%02X\n", p->status);
+            return -1;
+    }
+
+    /* Packet modulation, 13-14 useful chars */
+    if (p->modulation == MOD_LORA) {
+        PUT_STR(d, ",\"modu\":\"LORA\"");
+
+        /* Lora datarate & bandwidth, 16-19 useful chars */
+        if ((p->datarate > DR_LORA_SF12) || (lora_sf_str[p->datarate].str == NULL)) {
+            MSG("ERROR: [up] lora packet with unknown datarate 0x%02X\n", p->datarate);
+            return -1;
+        }
+        memcpy(d, lora_sf_str[p->datarate].str, lora_sf_str[p->datarate].len);
+        d += lora_sf_str[p->datarate].len;
+        if ((p->bandwidth > BW_500KHZ) || (lora_bw_str[p->bandwidth].str == NULL)) {
+            MSG("ERROR: [up] lora packet with unknown bandwidth 0x%02X\n", p->bandwidth);
+            return -1;
+        }
+        memcpy(d, lora_bw_str[p->bandwidth].str, lora_bw_str[p->bandwidth].len);
+        d += lora_bw_str[p->bandwidth].len;
+
+        /* Packet ECC coding rate, 11-13 useful chars */
+        if (p->coderate > CR_LORA_4_8) {
+            MSG("ERROR: [up] lora packet with unknown coderate 0x%02X\n", p->coderate);
+            return -1;
+        }
+        memcpy(d, lora_cr_str[p->coderate].str, lora_cr_str[p->coderate].len);
+        d += lora_cr_str[p->coderate].len;
+
+        /* Signal RSSI */
+        PUT_STR(d, ",\"rssis\":");
+        d = put_float(d, roundf(p->rssis), 0);
+
+        /* Lora SNR */
+        PUT_STR(d, ",\"lsnr\":");
+        d = put_float(d, p->snr, 1);
+
+        /* Lora frequency offset */
+        PUT_STR(d, ",\"foff\":");
+        d = put_int(d, p->freq_offset);
+    } else if (p->modulation == MOD_FSK) {
+        PUT_STR(d, ",\"modu\":\"FSK\"");
+
+        /* FSK datarate, 11-14 useful chars */
+        PUT_STR(d, ",\"datr\":");
+        d = put_uint(d, p->datarate, 1, '0');
+    } else {
+        MSG("ERROR: [up] received packet with unknown modulation 0x%02X\n", p->modulation);
+        return -1;
+    }
+
+    /* Channel RSSI, payload size, 18-23 useful chars */
+    PUT_STR(d, ",\"rssi\":");
+    d = put_float(d, roundf(p->rssic), 0);
+    PUT_STR(d, ",\"size\":");
+    d = put_uint(d, p->size, 1, '0');
+
+    /* Packet base64-encoded payload, 14-350 useful chars */
+    PUT_STR(d, ",\"data\":\"");
+    j = bin_to_b64(p->payload, p->size, d, size - (int)(d - dest));
+    if (j < 0) {
+        MSG("ERROR: [up] bin_to_b64 failed\n");
+        return -1;
+    }
+    d += j;
+    PUT_STR(d, "\"}");
+
+    return (int)(d - dest);
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,150 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : lock-free ring of received packets between the fetch
+    thread (single producer) and the upstream thread (single consumer)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>      /* printf */
+#include <string.h>     /* memcpy, strerror */
+#include <unistd.h>     /* read, write */
+#include <errno.h>      /* errno */
+#include <poll.h>       /* poll */
+#include <sys/eventfd.h>
+
+#include "trace.h"
+#include "rxring.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define RXRING_INDEX(i)     ((i) & (RXRING_SIZE - 1))
+
+/* each index is only written by its owner, the other side reads it with acquire semantics */
+#define LOAD_ACQUIRE(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+#if (RXRING_SIZE & (RXRING_SIZE - 1)) != 0
+    #error "RXRING_SIZE must be a power of 2"
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+int rxring_init(struct rxring_s *r) {
+    if (r == NULL) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    r->head = 0;
+    r->tail = 0;
+    r->wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (r->wake_fd == -1) {
+        MSG("ERROR: failed to create RX ring event (%s)\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+unsigned rxring_space(struct rxring_s *r) {
+    return RXRING_SIZE - (r->tail - LOAD_ACQUIRE(r->head));
+}
+
+void rxring_push(struct rxring_s *r, const struct lgw_pkt_rx_s *pkt, unsigned n) {
+    unsigned tail = r->tail; /* only written by this thread */
+    unsigned first = RXRING_SIZE - RXRING_INDEX(tail);
+    uint64_t one = 1;
+
+    /* copy in up to 2 parts if the ring wraps, then publish */
+    if (first > n) {
+        first = n;
+    }
+    memcpy(&(r->pkt[RXRING_INDEX(tail)]), pkt, first * sizeof *pkt);
+    memcpy(&(r->pkt[0]), pkt + first, (n - first) * sizeof *pkt);
+    STORE_RELEASE(r->tail, tail + n);
+
+    if (write(r->wake_fd, &one, sizeof one) != sizeof one) {
+        MSG("WARNING: [fetch] failed to wake upstream thread\n");
+    }
+}
+
+unsigned rxring_peek(struct rxring_s *r, struct lgw_pkt_rx_s **pkt) {
+    unsigned head = r->head; /* only written by this thread */
+    unsigned count = LOAD_ACQUIRE(r->tail) - head;
+    unsigned contiguous = RXRING_SIZE - RXRING_INDEX(head);
+
+    *pkt = &(r->pkt[RXRING_INDEX(head)]);
+    return (count < contiguous) ? count : contiguous;
+}
+
+void rxring_pop(struct rxring_s *r, unsigned n) {
+    STORE_RELEASE(r->head, r->head + n);
+}
+
+int rxring_wait(struct rxring_s *r, int timeout_ms) {
+    struct pollfd fd;
+    uint64_t events;
+    int i;
+
+    fd.fd = r->wake_fd;
+    fd.events = POLLIN;
+    i = poll(&fd, 1, timeout_ms);
+    if (i <= 0) {
+        return 0; /* timeout, or interrupted by a signal */
+    }
+    if (read(r->wake_fd, &events, sizeof events) < 0) {
+        /* EAGAIN: nothing pushed since the last read */
+    }
+
+    return 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int rxring_wait_any(struct rxring_s *r, unsigned nb, int timeout_ms) {
+    struct pollfd fd[RXRING_WAIT_MAX];
+    uint64_t events;
+    unsigned n;
+    int i;
+
+    if ((nb == 0) || (nb > RXRING_WAIT_MAX)) {
+        return 0;
+    }
+    for (n = 0; n < nb; n++) {
+        fd[n].fd = r[n].wake_fd;
+        fd[n].events = POLLIN;
+    }
+    i = poll(fd, nb, timeout_ms);
+    if (i <= 0) {
+        return 0; /* timeout, or interrupted by a signal */
+    }
+    for (n = 0; n < nb; n++) {
+        if ((fd[n].revents & POLLIN) && (read(r[n].wake_fd, &events, sizeof events) < 0)) {
+            /* EAGAIN: nothing pushed since the last read */
+        }
+    }
+
+    return 1;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
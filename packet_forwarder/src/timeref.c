@@ -0,0 +1,71 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : lock-free publication of the GPS time reference, from
+    the GPS thread (single writer) to the threads converting timestamps
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <string.h>     /* memset, memcpy */
+
+#include "timeref.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+/* the sequence is only written by the GPS thread, readers retry when it moved */
+#define LOAD_ACQUIRE(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STORE_RELAXED(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define STORE_RELEASE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+void timeref_init(struct timeref_s *t) {
+    memset(t, 0, sizeof *t);
+}
+
+void timeref_publish(struct timeref_s *t, const struct tref *ref) {
+    unsigned seq = LOAD_RELAXED(t->seq);
+
+    STORE_RELAXED(t->seq, seq + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE); /* odd sequence visible before the update */
+    memcpy(&t->ref, ref, sizeof t->ref);
+    STORE_RELEASE(t->seq, seq + 2);
+}
+
+void timeref_set_valid(struct timeref_s *t, bool valid) {
+    STORE_RELAXED(t->valid, valid);
+}
+
+bool timeref_get(const struct timeref_s *t, struct tref *ref) {
+    unsigned seq;
+
+    do {
+        seq = LOAD_ACQUIRE(t->seq);
+        memcpy(ref, &t->ref, sizeof *ref);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); /* copy done before the sequence check */
+    } while (((seq & 1) != 0) || (LOAD_RELAXED(t->seq) != seq));
+
+    return LOAD_RELAXED(t->valid);
+}
+
+/* --- EOF ------------------------------------------------------------------ */
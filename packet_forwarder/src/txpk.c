@@ -0,0 +1,601 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : downlink requests parsing
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>      /* printf, sscanf */
+#include <stdlib.h>     /* strtod */
+#include <string.h>     /* memset, memcpy, strcmp, strncmp, strlen */
+
+#include "trace.h"
+#include "txpk.h"
+#include "parson.h"
+#include "base64.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS & TYPES -------------------------------------------- */
+
+#define TXPK_STR_MAX            16  /* longest modu/datr/codr string handled by the fast parser */
+
+/* tokens recognized by the fast parser */
+enum txpk_tok_e {
+    TXPK_TOK_ABSENT = 0,
+    TXPK_TOK_NUMBER,
+    TXPK_TOK_STRING,
+    TXPK_TOK_TRUE,
+    TXPK_TOK_FALSE
+};
+
+/* fields of the "txpk" object, any other field is left to parson */
+enum txpk_field_e {
+    TXPK_IMME = 0,
+    TXPK_TMST,
+    TXPK_TMMS,
+    TXPK_NCRC,
+    TXPK_FREQ,
+    TXPK_RFCH,
+    TXPK_POWE,
+    TXPK_MODU,
+    TXPK_DATR,
+    TXPK_CODR,
+    TXPK_IPOL,
+    TXPK_FDEV,
+    TXPK_PREA,
+    TXPK_SIZE,
+    TXPK_DATA,
+    TXPK_BRD,
+    TXPK_FIELD_NB
+};
+
+static const char * const txpk_field_name[TXPK_FIELD_NB] = {
+    "imme", "tmst", "tmms", "ncrc", "freq", "rfch", "powe", "modu",
+    "datr", "codr", "ipol", "fdev", "prea", "size", "data", "brd"
+};
+
+/* raw value of a field, pointing into the JSON string */
+struct txpk_tok_s {
+    enum txpk_tok_e type;
+    const char *    str;    /* first char of the number, or of the string content */
+    int             len;    /* number of chars, quotes excluded */
+    double          num;    /* value of a number */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static const char * skip_ws(const char *s) {
+    while ((*s == ' ') || (*s == '\t') || (*s == '\n') || (*s == '\r')) {
+        s++;
+    }
+    return s;
+}
+
+/* string without escape sequence, returns a pointer after the closing quote or NULL */
+static const char * scan_string(const char *s, const char **str, int *len) {
+    const char *p;
+
+    if (*s != '"') {
+        return NULL;
+    }
+    for (p = s + 1; *p != '"'; p++) {
+        if ((*p == '\\') || ((unsigned char)*p < 0x20)) {
+            return NULL; /* escapes and control chars (or end of string) */
+        }
+    }
+    *str = s + 1;
+    *len = (int)(p - (s + 1));
+    return p + 1;
+}
+
+/* strict JSON number grammar, returns a pointer after the number or NULL */
+static const char * scan_number(const char *s, double *num) {
+    const char *p = s;
+
+    if (*p == '-') {
+        p++;
+    }
+    if (*p == '0') {
+        p++;
+    } else if ((*p >= '1') && (*p <= '9')) {
+        while ((*p >= '0') && (*p <= '9')) p++;
+    } else {
+        return NULL;
+    }
+    if (*p == '.') {
+        p++;
+        if ((*p < '0') || (*p > '9')) {
+            return NULL;
+        }
+        while ((*p >= '0') && (*p <= '9')) p++;
+    }
+    if ((*p == 'e') || (*p == 'E')) {
+        p++;
+        if ((*p == '+') || (*p == '-')) p++;
+        if ((*p < '0') || (*p > '9')) {
+            return NULL;
+        }
+        while ((*p >= '0') && (*p <= '9')) p++;
+    }
+    *num = strtod(s, NULL); /* same conversion as parson */
+    return p;
+}
+
+static bool tok_is(const struct txpk_tok_s *tok, const char *str) {
+    return (tok->type == TXPK_TOK_STRING) && ((int)strlen(str) == tok->len) && (strncmp(tok->str, str, tok->len) == 0);
+}
+
+/* Tokenize a '{"txpk":{...}}' document, -1 if anything outside the known fields and simple values is found */
+static int fast_scan(const char *json, struct txpk_tok_s tok[TXPK_FIELD_NB]) {
+    const char *s;
+    const char *key;
+    int key_len;
+    int i;
+
+    memset(tok, 0, TXPK_FIELD_NB * sizeof *tok);
+
+    s = skip_ws(json);
+    if (*s != '{') {
+        return -1;
+    }
+    s = scan_string(skip_ws(s + 1), &key, &key_len);
+    if ((s == NULL) || (key_len != 4) || (strncmp(key, "txpk", 4) != 0)) {
+        return -1;
+    }
+    s = skip_ws(s);
+    if (*s != ':') {
+        return -1;
+    }
+    s = skip_ws(s + 1);
+    if (*s != '{') {
+        return -1;
+    }
+    s = skip_ws(s + 1);
+
+    if (*s != '}') {
+        while (true) {
+            s = scan_string(s, &key, &key_len);
+            if (s == NULL) {
+                return -1;
+            }
+            for (i = 0; i < TXPK_FIELD_NB; i++) {
+                if ((key_len == (int)strlen(txpk_field_name[i])) && (strncmp(key, txpk_field_name[i], key_len) == 0)) {
+                    break;
+                }
+            }
+            if ((i == TXPK_FIELD_NB) || (tok[i].type != TXPK_TOK_ABSENT)) {
+                return -1; /* unknown or duplicated field */
+            }
+            s = skip_ws(s);
+            if (*s != ':') {
+                return -1;
+            }
+            s = skip_ws(s + 1);
+            if (*s == '"') {
+                tok[i].type = TXPK_TOK_STRING;
+                s = scan_string(s, &(tok[i].str), &(tok[i].len));
+            } else if (strncmp(s, "true", 4) == 0) {
+                tok[i].type = TXPK_TOK_TRUE;
+                s += 4;
+            } else if (strncmp(s, "false", 5) == 0) {
+                tok[i].type = TXPK_TOK_FALSE;
+                s += 5;
+            } else {
+                tok[i].type = TXPK_TOK_NUMBER;
+                tok[i].str = s;
+                s = scan_number(s, &(tok[i].num));
+            }
+            if (s == NULL) {
+                return -1;
+            }
+            s = skip_ws(s);
+            if (*s == ',') {
+                s = skip_ws(s + 1);
+            } else if (*s == '}') {
+                break;
+            } else {
+                return -1;
+            }
+        }
+    }
+
+    /* close "txpk" and root objects, nothing may follow */
+    s = skip_ws(s + 1);
+    if (*s != '}') {
+        return -1;
+    }
+    s = skip_ws(s + 1);
+    return (*s == '\0') ? 0 : -1;
+}
+
+/* Same decoding as parse_txpk_obj, -1 on any error or unexpected value type so parson reports it */
+static int fast_parse(const char *json, struct txpk_s *txpk) {
+    struct lgw_pkt_tx_s *txpkt = &(txpk->pkt);
+    struct txpk_tok_s tok[TXPK_FIELD_NB];
+    const struct txpk_tok_s *t;
+    char str[TXPK_STR_MAX + 1];
+    short x0, x1;
+    int i;
+
+    if (fast_scan(json, tok) != 0) {
+        return -1;
+    }
+
+    /* values with an unexpected type are interpreted by parson */
+    for (i = 0; i < TXPK_FIELD_NB; i++) {
+        t = &tok[i];
+        if (t->type == TXPK_TOK_ABSENT) {
+            continue;
+        }
+        switch (i) {
+            case TXPK_IMME:
+            case TXPK_NCRC:
+            case TXPK_IPOL:
+                if ((t->type != TXPK_TOK_TRUE) && (t->type != TXPK_TOK_FALSE)) return -1;
+                break;
+            case TXPK_MODU:
+            case TXPK_CODR:
+            case TXPK_DATA:
+                if (t->type != TXPK_TOK_STRING) return -1;
+                break;
+            case TXPK_DATR:
+                if ((t->type != TXPK_TOK_STRING) && (t->type != TXPK_TOK_NUMBER)) return -1;
+                break;
+            default:
+                if (t->type != TXPK_TOK_NUMBER) return -1;
+                break;
+        }
+    }
+
+    /* "immediate" tag, or target timestamp, or UTC time to be converted by GPS (mandatory) */
+    if (tok[TXPK_IMME].type == TXPK_TOK_TRUE) {
+        txpk->imme = true;
+    } else if (tok[TXPK_TMST].type != TXPK_TOK_ABSENT) {
+        txpkt->count_us = (uint32_t)tok[TXPK_TMST].num;
+        txpk->tmst_ok = true;
+    } else if (tok[TXPK_TMMS].type != TXPK_TOK_ABSENT) {
+        txpk->tmms = (uint64_t)tok[TXPK_TMMS].num;
+        txpk->tmms_ok = true;
+    } else {
+        return -1;
+    }
+
+    if (tok[TXPK_NCRC].type != TXPK_TOK_ABSENT) {
+        txpkt->no_crc = (tok[TXPK_NCRC].type == TXPK_TOK_TRUE);
+    }
+
+    if ((tok[TXPK_FREQ].type == TXPK_TOK_ABSENT) || (tok[TXPK_RFCH].type == TXPK_TOK_ABSENT)) {
+        return -1;
+    }
+    txpkt->freq_hz = (uint32_t)((double)(1.0e6) * tok[TXPK_FREQ].num);
+    txpkt->rf_chain = (uint8_t)tok[TXPK_RFCH].num;
+
+    if (tok[TXPK_BRD].type != TXPK_TOK_ABSENT) {
+        txpk->brd = (uint8_t)tok[TXPK_BRD].num;
+    }
+
+    if (tok[TXPK_POWE].type != TXPK_TOK_ABSENT) {
+        txpk->powe = (int8_t)tok[TXPK_POWE].num;
+        txpk->powe_ok = true;
+    }
+
+    t = &tok[TXPK_DATR];
+    if (tok_is(&tok[TXPK_MODU], "LORA")) {
+        txpkt->modulation = MOD_LORA;
+
+        if ((t->type != TXPK_TOK_STRING) || (t->len > TXPK_STR_MAX)) {
+            return -1;
+        }
+        memcpy(str, t->str, t->len);
+        str[t->len] = '\0';
+        if (sscanf(str, "SF%2hdBW%3hd", &x0, &x1) != 2) {
+            return -1;
+        }
+        if ((x0 < 5) || (x0 > 12)) {
+            return -1;
+        }
+        txpkt->datarate = (uint32_t)x0; /* DR_LORA_SF5 .. DR_LORA_SF12 */
+        switch (x1) {
+            case 125: txpkt->bandwidth = BW_125KHZ; break;
+            case 250: txpkt->bandwidth = BW_250KHZ; break;
+            case 500: txpkt->bandwidth = BW_500KHZ; break;
+            default: return -1;
+        }
+
+        t = &tok[TXPK_CODR];
+        if      (tok_is(t, "4/5")) txpkt->coderate = CR_LORA_4_5;
+        else if (tok_is(t, "4/6")) txpkt->coderate = CR_LORA_4_6;
+        else if (tok_is(t, "2/3")) txpkt->coderate = CR_LORA_4_6;
+        else if (tok_is(t, "4/7")) txpkt->coderate = CR_LORA_4_7;
+        else if (tok_is(t, "4/8")) txpkt->coderate = CR_LORA_4_8;
+        else if (tok_is(t, "1/2")) txpkt->coderate = CR_LORA_4_8;
+        else return -1;
+
+        if (tok[TXPK_IPOL].type != TXPK_TOK_ABSENT) {
+            txpkt->invert_pol = (tok[TXPK_IPOL].type == TXPK_TOK_TRUE);
+        }
+    } else if (tok_is(&tok[TXPK_MODU], "FSK")) {
+        txpkt->modulation = MOD_FSK;
+
+        if ((t->type != TXPK_TOK_NUMBER) || (tok[TXPK_FDEV].type == TXPK_TOK_ABSENT)) {
+            return -1;
+        }
+        txpkt->datarate = (uint32_t)(t->num);
+        txpkt->f_dev = (uint8_t)(tok[TXPK_FDEV].num / 1000.0); /* JSON value in Hz, txpkt.f_dev in kHz */
+    } else {
+        return -1;
+    }
+
+    if (tok[TXPK_PREA].type != TXPK_TOK_ABSENT) {
+        txpk->prea = (int)tok[TXPK_PREA].num;
+        txpk->prea_ok = true;
+    }
+
+    if ((tok[TXPK_SIZE].type == TXPK_TOK_ABSENT) || (tok[TXPK_DATA].type == TXPK_TOK_ABSENT)) {
+        return -1;
+    }
+    txpkt->size = (uint16_t)tok[TXPK_SIZE].num;
+
+    /* base64 payload decoded in place from the datagram */
+    i = b64_to_bin(tok[TXPK_DATA].str, tok[TXPK_DATA].len, txpkt->payload, sizeof txpkt->payload);
+    if (i != txpkt->size) {
+        MSG("WARNING: [down] mismatch between .size and .data size once converter to binary\n");
+    }
+
+    return 0;
+}
+
+
+static int parse_txpk_obj(JSON_Object *txpk_obj, struct txpk_s *txpk) {
+    struct lgw_pkt_tx_s *txpkt = &(txpk->pkt);
+    JSON_Value *val = NULL;
+    const char *str;
+    short x0, x1;
+    int i;
+
+    /* Parse "immediate" tag, or target timestamp, or UTC time to be converted by GPS (mandatory) */
+    i = json_object_get_boolean(txpk_obj,"imme"); /* can be 1 if true, 0 if false, or -1 if not a JSON boolean */
+    if (i == 1) {
+        txpk->imme = true;
+    } else {
+        val = json_object_get_value(txpk_obj,"tmst");
+        if (val != NULL) {
+            txpkt->count_us = (uint32_t)json_value_get_number(val);
+            txpk->tmst_ok = true;
+        } else {
+            val = json_object_get_value(txpk_obj, "tmms");
+            if (val == NULL) {
+                MSG("WARNING: [down] no mandatory \"txpk.tmst\" or \"txpk.tmms\" objects in JSON, TX aborted\n");
+                return -1;
+            }
+            txpk->tmms = (uint64_t)json_value_get_number(val);
+            txpk->tmms_ok = true;
+        }
+    }
+
+    /* Parse "No CRC" flag (optional field) */
+    val = json_object_get_value(txpk_obj,"ncrc");
+    if (val != NULL) {
+        txpkt->no_crc = (bool)json_value_get_boolean(val);
+    }
+
+    /* parse target frequency (mandatory) */
+    val = json_object_get_value(txpk_obj,"freq");
+    if (val == NULL) {
+        MSG("WARNING: [down] no mandatory \"txpk.freq\" object in JSON, TX aborted\n");
+        return -1;
+    }
+    txpkt->freq_hz = (uint32_t)((double)(1.0e6) * json_value_get_number(val));
+
+    /* parse RF chain used for TX (mandatory) */
+    val = json_object_get_value(txpk_obj,"rfch");
+    if (val == NULL) {
+        MSG("WARNING: [down] no mandatory \"txpk.rfch\" object in JSON, TX aborted\n");
+        return -1;
+    }
+    txpkt->rf_chain = (uint8_t)json_value_get_number(val);
+
+    /* parse concentrator board used for TX (optional field) */
+    val = json_object_get_value(txpk_obj,"brd");
+    if (val != NULL) {
+        txpk->brd = (uint8_t)json_value_get_number(val);
+    }
+
+    /* parse TX power (optional field) */
+    val = json_object_get_value(txpk_obj,"powe");
+    if (val != NULL) {
+        txpk->powe = (int8_t)json_value_get_number(val);
+        txpk->powe_ok = true;
+    }
+
+    /* Parse modulation (mandatory) */
+    str = json_object_get_string(txpk_obj, "modu");
+    if (str == NULL) {
+        MSG("WARNING: [down] no mandatory \"txpk.modu\" object in JSON, TX aborted\n");
+        return -1;
+    }
+    if (strcmp(str, "LORA") == 0) {
+        /* Lora modulation */
+        txpkt->modulation = MOD_LORA;
+
+        /* Parse Lora spreading-factor and modulation bandwidth (mandatory) */
+        str = json_object_get_string(txpk_obj, "datr");
+        if (str == NULL) {
+            MSG("WARNING: [down] no mandatory \"txpk.datr\" object in JSON, TX aborted\n");
+            return -1;
+        }
+        i = sscanf(str, "SF%2hdBW%3hd", &x0, &x1);
+        if (i != 2) {
+            MSG("WARNING: [down] format error in \"txpk.datr\", TX aborted\n");
+            return -1;
+        }
+        switch (x0) {
+            case  5: txpkt->datarate = DR_LORA_SF5;  break;
+            case  6: txpkt->datarate = DR_LORA_SF6;  break;
+            case  7: txpkt->datarate = DR_LORA_SF7;  break;
+            case  8: txpkt->datarate = DR_LORA_SF8;  break;
+            case  9: txpkt->datarate = DR_LORA_SF9;  break;
+            case 10: txpkt->datarate = DR_LORA_SF10; break;
+            case 11: txpkt->datarate = DR_LORA_SF11; break;
+            case 12: txpkt->datarate = DR_LORA_SF12; break;
+            default:
+                MSG("WARNING: [down] format error in \"txpk.datr\", invalid SF, TX aborted\n");
+                return -1;
+        }
+        switch (x1) {
+            case 125: txpkt->bandwidth = BW_125KHZ; break;
+            case 250: txpkt->bandwidth = BW_250KHZ; break;
+            case 500: txpkt->bandwidth = BW_500KHZ; break;
+            default:
+                MSG("WARNING: [down] format error in \"txpk.datr\", invalid BW, TX aborted\n");
+                return -1;
+        }
+
+        /* Parse ECC coding rate (optional field) */
+        str = json_object_get_string(txpk_obj, "codr");
+        if (str == NULL) {
+            MSG("WARNING: [down] no mandatory \"txpk.codr\" object in json, TX aborted\n");
+            return -1;
+        }
+        if      (strcmp(str, "4/5") == 0) txpkt->coderate = CR_LORA_4_5;
+        else if (strcmp(str, "4/6") == 0) txpkt->coderate = CR_LORA_4_6;
+        else if (strcmp(str, "2/3") == 0) txpkt->coderate = CR_LORA_4_6;
+        else if (strcmp(str, "4/7") == 0) txpkt->coderate = CR_LORA_4_7;
+        else if (strcmp(str, "4/8") == 0) txpkt->coderate = CR_LORA_4_8;
+        else if (strcmp(str, "1/2") == 0) txpkt->coderate = CR_LORA_4_8;
+        else {
+            MSG("WARNING: [down] format error in \"txpk.codr\", TX aborted\n");
+            return -1;
+        }
+
+        /* Parse signal polarity switch (optional field) */
+        val = json_object_get_value(txpk_obj,"ipol");
+        if (val != NULL) {
+            txpkt->invert_pol = (bool)json_value_get_boolean(val);
+        }
+    } else if (strcmp(str, "FSK") == 0) {
+        /* FSK modulation */
+        txpkt->modulation = MOD_FSK;
+
+        /* parse FSK bitrate (mandatory) */
+        val = json_object_get_value(txpk_obj,"datr");
+        if (val == NULL) {
+            MSG("WARNING: [down] no mandatory \"txpk.datr\" object in JSON, TX aborted\n");
+            return -1;
+        }
+        txpkt->datarate = (uint32_t)(json_value_get_number(val));
+
+        /* parse frequency deviation (mandatory) */
+        val = json_object_get_value(txpk_obj,"fdev");
+        if (val == NULL) {
+            MSG("WARNING: [down] no mandatory \"txpk.fdev\" object in JSON, TX aborted\n");
+            return -1;
+        }
+        txpkt->f_dev = (uint8_t)(json_value_get_number(val) / 1000.0); /* JSON value in Hz, txpkt.f_dev in kHz */
+    } else {
+        MSG("WARNING: [down] invalid modulation in \"txpk.modu\", TX aborted\n");
+        return -1;
+    }
+
+    /* parse preamble length (optional field) */
+    val = json_object_get_value(txpk_obj,"prea");
+    if (val != NULL) {
+        txpk->prea = (int)json_value_get_number(val);
+        txpk->prea_ok = true;
+    }
+
+    /* Parse payload length (mandatory) */
+    val = json_object_get_value(txpk_obj,"size");
+    if (val == NULL) {
+        MSG("WARNING: [down] no mandatory \"txpk.size\" object in JSON, TX aborted\n");
+        return -1;
+    }
+    txpkt->size = (uint16_t)json_value_get_number(val);
+
+    /* Parse payload data (mandatory) */
+    str = json_object_get_string(txpk_obj, "data");
+    if (str == NULL) {
+        MSG("WARNING: [down] no mandatory \"txpk.data\" object in JSON, TX aborted\n");
+        return -1;
+    }
+    i = b64_to_bin(str, strlen(str), txpkt->payload, sizeof txpkt->payload);
+    if (i != txpkt->size) {
+        MSG("WARNING: [down] mismatch between .size and .data size once converter to binary\n");
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+int txpk_json_parse(const char *json, struct txpk_s *txpk) {
+    if ((json == NULL) || (txpk == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    /* single pass, allocation-free, for the usual field set */
+    memset(txpk, 0, sizeof *txpk);
+    if (fast_parse(json, txpk) == 0) {
+        return 0;
+    }
+
+    /* anything else, including all error reporting, goes through parson */
+    return txpk_json_parse_parson(json, txpk);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int txpk_json_parse_parson(const char *json, struct txpk_s *txpk) {
+    JSON_Value *root_val = NULL;
+    JSON_Object *txpk_obj = NULL;
+    int i;
+
+    if ((json == NULL) || (txpk == NULL)) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    memset(txpk, 0, sizeof *txpk);
+    root_val = json_parse_string_with_comments(json);
+    if (root_val == NULL) {
+        MSG("WARNING: [down] invalid JSON, TX aborted\n");
+        return -1;
+    }
+
+    /* look for JSON sub-object 'txpk' */
+    txpk_obj = json_object_get_object(json_value_get_object(root_val), "txpk");
+    if (txpk_obj == NULL) {
+        MSG("WARNING: [down] no \"txpk\" object in JSON, TX aborted\n");
+        json_value_free(root_val);
+        return -1;
+    }
+
+    i = parse_txpk_obj(txpk_obj, txpk);
+
+    /* free the JSON parse tree from memory */
+    json_value_free(root_val);
+
+    return i;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
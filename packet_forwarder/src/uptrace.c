@@ -0,0 +1,280 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : optional per-packet latency tracing of the uplink path,
+    from the packet timestamp to the PUSH_DATA datagram being sent
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>      /* fopen, fprintf */
+#include <stdlib.h>     /* qsort */
+#include <string.h>     /* memset, memcpy, strerror */
+#include <errno.h>      /* errno */
+
+#include "trace.h"
+#include "uptrace.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define FETCH_INDEX(i)      ((i) & (RXRING_SIZE - 1))
+#define SAMPLE_INDEX(i)     ((i) & (UPTRACE_SIZE - 1))
+
+#if (UPTRACE_SIZE & (UPTRACE_SIZE - 1)) != 0
+    #error "UPTRACE_SIZE must be a power of 2"
+#endif
+
+#if (PUSHQ_SIZE * UPTRACE_DGRAM_MAX) > UPTRACE_SIZE
+    #error "UPTRACE_SIZE must hold the samples of a full upstream queue"
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static const char * stage_name[UPTRACE_STAGE_NB] = {"fetch", "parse", "ring", "ser", "send", "tot"};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static uint32_t elapsed_us(const struct timespec *end, const struct timespec *beginning) {
+    int64_t us;
+
+    us = (int64_t)(end->tv_sec - beginning->tv_sec) * 1000000 + (end->tv_nsec - beginning->tv_nsec) / 1000;
+    return (us > 0) ? (uint32_t)us : 0;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+int uptrace_init(struct uptrace_s *t, bool enable, const char *dump_path) {
+    if (t == NULL) {
+        MSG("ERROR: invalid parameter\n");
+        return -1;
+    }
+
+    memset(t, 0, sizeof *t);
+    pthread_mutex_init(&(t->mx), NULL);
+    t->enabled = enable;
+    if ((enable == false) || (dump_path == NULL)) {
+        return 0;
+    }
+
+    t->dump = fopen(dump_path, "a");
+    if (t->dump == NULL) {
+        MSG("ERROR: failed to open uplink trace file %s (%s)\n", dump_path, strerror(errno));
+        return -1;
+    }
+    fprintf(t->dump, "count_us,fetch_us,parse_us,ring_us,ser_us,send_us,tot_us\n");
+
+    return 0;
+}
+
+void uptrace_free(struct uptrace_s *t) {
+    if (t->dump != NULL) {
+        fclose(t->dump);
+        t->dump = NULL;
+    }
+}
+
+const char * uptrace_stage_name(enum uptrace_stage_e stage) {
+    return (stage < UPTRACE_STAGE_NB) ? stage_name[stage] : "";
+}
+
+void uptrace_fetch_begin(struct uptrace_s *t) {
+    if (t->enabled == false) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &(t->fetch_start));
+}
+
+void uptrace_fetch_end(struct uptrace_s *t, const struct lgw_pkt_rx_s *pkt, unsigned n) {
+    struct uptrace_sample_s *s;
+    struct timespec now;
+    uint32_t inst_cnt = 0;
+    uint32_t parse_us;
+    int32_t age_us;
+    unsigned i;
+
+    if ((t->enabled == false) || (n == 0)) {
+        return;
+    }
+
+    /* one counter read per batch, only when tracing */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    lgw_get_instcnt(&inst_cnt);
+    parse_us = elapsed_us(&now, &(t->fetch_start));
+
+    /* the ring indexes are mirrored, the RX ring publishes the samples with the packets */
+    for (i = 0; i < n; i++) {
+        s = &(t->fetch[FETCH_INDEX(t->fetch_wr + i)]);
+        memset(s, 0, sizeof *s);
+        s->count_us = pkt[i].count_us;
+        age_us = (int32_t)(inst_cnt - pkt[i].count_us); /* wraps every 71 minutes */
+        s->stage_us[UPTRACE_FETCH] = (age_us > (int32_t)parse_us) ? ((uint32_t)age_us - parse_us) : 0;
+        s->stage_us[UPTRACE_PARSE] = parse_us;
+        s->mark = now;
+    }
+    t->fetch_wr += n;
+}
+
+void uptrace_up_begin(struct uptrace_s *t) {
+    if (t->enabled == false) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &(t->up_start));
+    t->staged_nb = 0;
+}
+
+void uptrace_up_take(struct uptrace_s *t, unsigned i) {
+    struct uptrace_sample_s *s;
+
+    if ((t->enabled == false) || (t->staged_nb >= UPTRACE_DGRAM_MAX)) {
+        return;
+    }
+
+    s = &(t->staged[t->staged_nb]);
+    *s = t->fetch[FETCH_INDEX(t->fetch_rd + i)];
+    s->stage_us[UPTRACE_RING] = elapsed_us(&(t->up_start), &(s->mark));
+    s->mark = t->up_start;
+    t->staged_nb += 1;
+}
+
+void uptrace_up_pop(struct uptrace_s *t, unsigned n) {
+    if (t->enabled == false) {
+        return;
+    }
+    t->fetch_rd += n;
+}
+
+void uptrace_up_commit(struct uptrace_s *t) {
+    struct uptrace_sample_s *s;
+    struct timespec now;
+    unsigned i;
+
+    if (t->enabled == false) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&(t->mx));
+    if (t->group_nb >= PUSHQ_SIZE) {
+        /* can't happen, the upstream queue has no room for more datagrams */
+        pthread_mutex_unlock(&(t->mx));
+        return;
+    }
+    for (i = 0; i < t->staged_nb; i++) {
+        s = &(t->sample[SAMPLE_INDEX(t->commit + i)]);
+        *s = t->staged[i];
+        s->stage_us[UPTRACE_SERIAL] = elapsed_us(&now, &(s->mark));
+        s->mark = now;
+    }
+    t->commit += t->staged_nb;
+    t->group[(t->group_head + t->group_nb) % PUSHQ_SIZE] = t->staged_nb;
+    t->group_nb += 1;
+    pthread_mutex_unlock(&(t->mx));
+    t->staged_nb = 0;
+}
+
+void uptrace_sent(struct uptrace_s *t, unsigned n) {
+    struct uptrace_sample_s *s;
+    struct timespec now;
+    unsigned nb, i, j;
+
+    if (t->enabled == false) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&(t->mx));
+    for (i = 0; (i < n) && (t->group_nb > 0); i++) {
+        nb = t->group[t->group_head];
+        t->group_head = (t->group_head + 1) % PUSHQ_SIZE;
+        t->group_nb -= 1;
+        for (j = 0; j < nb; j++) {
+            s = &(t->sample[SAMPLE_INDEX(t->sent + j)]);
+            s->stage_us[UPTRACE_SEND] = elapsed_us(&now, &(s->mark));
+            s->stage_us[UPTRACE_TOTAL] = s->stage_us[UPTRACE_FETCH] + s->stage_us[UPTRACE_PARSE] + s->stage_us[UPTRACE_RING] +
+                                         s->stage_us[UPTRACE_SERIAL] + s->stage_us[UPTRACE_SEND];
+            MSG_DEBUG(DEBUG_UPTRACE, "INFO: [up] packet %u sent %u us after its timestamp\n", s->count_us, s->stage_us[UPTRACE_TOTAL]);
+        }
+        t->sent += nb;
+    }
+    pthread_mutex_unlock(&(t->mx));
+}
+
+void uptrace_report(struct uptrace_s *t, struct uptrace_report_s *r) {
+    unsigned first, nb, i, j;
+    struct uptrace_sample_s *s;
+
+    memset(r, 0, sizeof *r);
+    if (t->enabled == false) {
+        return;
+    }
+
+    /* copy the samples sent since the previous report, committed ones may have overwritten the oldest */
+    pthread_mutex_lock(&(t->mx));
+    first = t->report;
+    if ((t->commit - first) > UPTRACE_SIZE) {
+        first = t->commit - UPTRACE_SIZE;
+        r->lost = first - t->report;
+    }
+    nb = t->sent - first;
+    for (i = 0; i < nb; i++) {
+        t->out[i] = t->sample[SAMPLE_INDEX(first + i)];
+    }
+    t->report = t->sent;
+    pthread_mutex_unlock(&(t->mx));
+
+    r->nb = nb;
+    if (nb == 0) {
+        return;
+    }
+
+    /* nearest-rank percentiles of each stage */
+    for (j = 0; j < UPTRACE_STAGE_NB; j++) {
+        for (i = 0; i < nb; i++) {
+            t->sorted[i] = t->out[i].stage_us[j];
+        }
+        qsort(t->sorted, nb, sizeof t->sorted[0], compare_u32);
+        r->pct_us[j][UPTRACE_P50] = t->sorted[(nb * 50 + 99) / 100 - 1];
+        r->pct_us[j][UPTRACE_P90] = t->sorted[(nb * 90 + 99) / 100 - 1];
+        r->pct_us[j][UPTRACE_P99] = t->sorted[(nb * 99 + 99) / 100 - 1];
+        r->pct_us[j][UPTRACE_MAX] = t->sorted[nb - 1];
+    }
+
+    /* dump outside of the hot path, once per report */
+    if (t->dump != NULL) {
+        for (i = 0; i < nb; i++) {
+            s = &(t->out[i]);
+            fprintf(t->dump, "%u,%u,%u,%u,%u,%u,%u\n", s->count_us, s->stage_us[UPTRACE_FETCH], s->stage_us[UPTRACE_PARSE], s->stage_us[UPTRACE_RING],
+                    s->stage_us[UPTRACE_SERIAL], s->stage_us[UPTRACE_SEND], s->stage_us[UPTRACE_TOTAL]);
+        }
+        fflush(t->dump);
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,123 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    LoRa concentrator : deduplication of the uplink packets received by
+    several concentrator boards, forwarding only the best copy
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <string.h>     /* memset, memcpy, memcmp, memmove */
+
+#include "xdedup.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static int elapsed_ms(const struct timespec *end, const struct timespec *beginning) {
+    return (int)((end->tv_sec - beginning->tv_sec) * 1000 + (end->tv_nsec - beginning->tv_nsec) / 1000000);
+}
+
+static uint32_t payload_hash(const uint8_t *data, uint16_t size) {
+    uint32_t h = 2166136261u; /* FNV-1a */
+    uint16_t i;
+
+    for (i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* the copy received with the strongest signal, the clearest one if equal */
+static bool better_copy(const struct lgw_pkt_rx_s *p, const struct lgw_pkt_rx_s *q) {
+    if (p->rssis != q->rssis) {
+        return p->rssis > q->rssis;
+    }
+    return p->snr > q->snr;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
+
+void xdedup_init(struct xdedup_s *d, unsigned hold_ms) {
+    memset(d, 0, sizeof *d);
+    d->hold_ms = hold_ms;
+}
+
+int xdedup_add(struct xdedup_s *d, const struct lgw_pkt_rx_s *p, int board, uint32_t time_us, const struct timespec *now) {
+    struct xdedup_entry_s *e;
+    uint32_t hash = payload_hash(p->payload, p->size);
+    int32_t diff;
+    unsigned i;
+
+    for (i = 0; i < d->nb; i++) {
+        e = &(d->entry[i]);
+        if ((e->hash != hash) || (e->pkt.size != p->size) || (memcmp(e->pkt.payload, p->payload, p->size) != 0)) {
+            continue;
+        }
+        diff = (int32_t)(time_us - e->time_us); /* both time bases wrap on 32 bits */
+        if ((diff > XDEDUP_WINDOW_US) || (diff < -XDEDUP_WINDOW_US)) {
+            continue; /* retransmission of the same frame */
+        }
+        if (better_copy(p, &(e->pkt)) == true) {
+            memcpy(&(e->pkt), p, sizeof *p);
+            e->board = board;
+        }
+        return 1;
+    }
+
+    if (d->nb == XDEDUP_PKT_NB) {
+        return -1;
+    }
+    e = &(d->entry[d->nb++]);
+    memcpy(&(e->pkt), p, sizeof *p);
+    e->board = board;
+    e->hash = hash;
+    e->time_us = time_us;
+    e->held = *now;
+
+    return 0;
+}
+
+bool xdedup_take(struct xdedup_s *d, const struct timespec *now, struct lgw_pkt_rx_s *p, int *board) {
+    /* entries are sorted by hold time */
+    if ((d->nb == 0) || (elapsed_ms(now, &(d->entry[0].held)) < (int)d->hold_ms)) {
+        return false;
+    }
+    memcpy(p, &(d->entry[0].pkt), sizeof *p);
+    *board = d->entry[0].board;
+    d->nb -= 1;
+    memmove(&(d->entry[0]), &(d->entry[1]), d->nb * sizeof d->entry[0]);
+
+    return true;
+}
+
+int xdedup_next(const struct xdedup_s *d, const struct timespec *now) {
+    int left;
+
+    if (d->nb == 0) {
+        return -1;
+    }
+    left = (int)d->hold_ms - elapsed_ms(now, &(d->entry[0].held));
+
+    return (left > 0) ? left : 0;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
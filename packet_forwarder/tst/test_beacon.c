@@ -0,0 +1,217 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check the class B beacon frames built from the cache: reference beacon of
+    the LoRaWAN class B specification, CRC fields of every beacon layout used
+    by the forwarder (no hardware required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "beacon.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define BEACON_PERIOD       128
+#define BEACON_FREQ_HZ      869525000
+#define BEACON_FREQ_STEP    600000
+#define BEACON_FREQ_NB      8
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* beacon layout per datarate, as selected by the forwarder */
+struct layout_s {
+    uint8_t     datarate;
+    uint8_t     rfu1_size;  /* RFU bytes before the time field */
+    uint8_t     rfu2_size;  /* RFU bytes after the gateway coordinates */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static unsigned long nb_errors = 0;
+
+static const struct layout_s layouts[] = {
+    { DR_LORA_SF8,  1, 3 },
+    { DR_LORA_SF9,  2, 0 },
+    { DR_LORA_SF10, 3, 1 },
+    { DR_LORA_SF12, 5, 3 }
+};
+
+/* SF9 beacon example of the LoRaWAN class B specification: time 0xCC020000,
+   InfoDesc 0, latitude 0x002001, longitude 0x038100 */
+static const uint8_t spec_beacon[17] = {
+    0x00, 0x00,                 /* RFU */
+    0x00, 0x00, 0x02, 0xCC,     /* time */
+    0xA2, 0x7E,                 /* CRC of the network common part */
+    0x00,                       /* InfoDesc */
+    0x01, 0x20, 0x00,           /* latitude */
+    0x00, 0x81, 0x03,           /* longitude */
+    0xDE, 0x55                  /* CRC of the gateway specific part */
+};
+
+/* InfoDesc, latitude and longitude, including the clamped extremes */
+static const int32_t gw_fields[][3] = {
+    { 0, 0x002001, 0x038100 },
+    { 0, 0x007FFFFF, 0x007FFFFF },
+    { 0, (int32_t)0xFF800000, (int32_t)0xFF800000 },
+    { 1, 0x003E5D1A, (int32_t)0xFFF6B2C4 },
+    { 2, (int32_t)0xFFC0FFEE, 0x00012345 }
+};
+
+static const uint32_t beacon_times[] = {
+    BEACON_PERIOD, 0xCC020000, 1261440000, 1261440000 + 7 * BEACON_PERIOD, 0xFFFFF000
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+/* CCITT CRC, one bit at a time, to check the table-driven one against */
+static uint16_t crc16_bitwise(const uint8_t *data, unsigned size) {
+    uint16_t crc = 0;
+    unsigned i, j;
+
+    for (i = 0; i < size; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* CRC field, stored little endian at offset idx, of the size bytes before it */
+static void check_crc_field(const char *what, const uint8_t *payload, unsigned idx, unsigned size) {
+    uint16_t crc_fld = (uint16_t)(payload[idx] | (payload[idx + 1] << 8));
+    uint16_t crc_tbl = beacon_crc16(0, payload + idx - size, size);
+    uint16_t crc_bit = crc16_bitwise(payload + idx - size, size);
+
+    if ((crc_fld != crc_bit) || (crc_tbl != crc_bit)) {
+        printf("ERROR: %s CRC at offset %u over %u bytes: field 0x%04X, table 0x%04X, bitwise 0x%04X\n", what, idx, size, crc_fld, crc_tbl, crc_bit);
+        nb_errors++;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Beacon template filled as in the forwarder, time and its CRC left to the cache */
+static void make_template(struct lgw_pkt_tx_s *pkt, const struct layout_s *l, uint8_t infodesc, int32_t lat, int32_t lon) {
+    uint16_t crc;
+    int idx = 0;
+    int i;
+
+    memset(pkt, 0, sizeof *pkt);
+    pkt->datarate = l->datarate;
+    pkt->size = l->rfu1_size + 4 + 2 + 7 + l->rfu2_size + 2;
+
+    for (i = 0; i < l->rfu1_size; i++) {
+        pkt->payload[idx++] = 0x00;
+    }
+    idx += 4 + 2;
+    pkt->payload[idx++] = infodesc;
+    pkt->payload[idx++] = 0xFF &  lat;
+    pkt->payload[idx++] = 0xFF & (lat >>  8);
+    pkt->payload[idx++] = 0xFF & (lat >> 16);
+    pkt->payload[idx++] = 0xFF &  lon;
+    pkt->payload[idx++] = 0xFF & (lon >>  8);
+    pkt->payload[idx++] = 0xFF & (lon >> 16);
+    for (i = 0; i < l->rfu2_size; i++) {
+        pkt->payload[idx++] = 0x00;
+    }
+    crc = beacon_crc16(0, pkt->payload + 6 + l->rfu1_size, 7 + l->rfu2_size);
+    pkt->payload[idx++] = 0xFF &  crc;
+    pkt->payload[idx++] = 0xFF & (crc >> 8);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Fields of every layout, for beacons prepared ahead by the cache or computed on a cache miss */
+static void check_layout(const struct layout_s *l) {
+    static struct beacon_cache_s cache, cache_miss;
+    struct lgw_pkt_tx_s tmpl, pkt, pkt_miss;
+    uint32_t t, gps_sec;
+    unsigned g, i, k;
+
+    for (g = 0; g < (sizeof gw_fields / sizeof gw_fields[0]); g++) {
+        make_template(&tmpl, l, (uint8_t)gw_fields[g][0], gw_fields[g][1], gw_fields[g][2]);
+        for (i = 0; i < (sizeof beacon_times / sizeof beacon_times[0]); i++) {
+            beacon_cache_init(&cache, &tmpl, l->rfu1_size, BEACON_PERIOD, BEACON_FREQ_HZ, BEACON_FREQ_STEP, BEACON_FREQ_NB);
+            for (k = 0; k < 2 * BEACON_CACHE_NB; k++) {
+                gps_sec = beacon_times[i] + k * BEACON_PERIOD;
+                beacon_cache_get(&cache, gps_sec, &pkt);
+                beacon_cache_init(&cache_miss, &tmpl, l->rfu1_size, BEACON_PERIOD, BEACON_FREQ_HZ, BEACON_FREQ_STEP, BEACON_FREQ_NB);
+                beacon_cache_get(&cache_miss, gps_sec, &pkt_miss);
+
+                if (pkt.size != (l->rfu1_size + 15 + l->rfu2_size)) {
+                    printf("ERROR: SF%u beacon of %u bytes\n", l->datarate, pkt.size);
+                    nb_errors++;
+                }
+                t = pkt.payload[l->rfu1_size] | (pkt.payload[l->rfu1_size + 1] << 8) | (pkt.payload[l->rfu1_size + 2] << 16) | ((uint32_t)pkt.payload[l->rfu1_size + 3] << 24);
+                if (t != gps_sec) {
+                    printf("ERROR: SF%u beacon time 0x%08X instead of 0x%08X\n", l->datarate, t, gps_sec);
+                    nb_errors++;
+                }
+                check_crc_field("network common part", pkt.payload, l->rfu1_size + 4, l->rfu1_size + 4);
+                check_crc_field("gateway specific part", pkt.payload, pkt.size - 2, 7 + l->rfu2_size);
+                if (pkt.freq_hz != (BEACON_FREQ_HZ + ((gps_sec / BEACON_PERIOD) % BEACON_FREQ_NB) * BEACON_FREQ_STEP)) {
+                    printf("ERROR: SF%u beacon at %u Hz for period %u\n", l->datarate, pkt.freq_hz, gps_sec / BEACON_PERIOD);
+                    nb_errors++;
+                }
+                if ((pkt.freq_hz != pkt_miss.freq_hz) || (memcmp(pkt.payload, pkt_miss.payload, pkt.size) != 0)) {
+                    printf("ERROR: SF%u beacon 0x%08X prepared ahead differs from the one computed on a cache miss\n", l->datarate, gps_sec);
+                    nb_errors++;
+                }
+                if ((l->datarate == DR_LORA_SF9) && (g == 0) && (gps_sec == 0xCC020000) && (memcmp(pkt.payload, spec_beacon, sizeof spec_beacon) != 0)) {
+                    printf("ERROR: SF9 beacon differs from the specification example\n");
+                    nb_errors++;
+                }
+            }
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    unsigned i;
+
+    /* the reference beacon, field by field */
+    check_crc_field("specification network common part", spec_beacon, 6, 6);
+    check_crc_field("specification gateway specific part", spec_beacon, 15, 7);
+
+    for (i = 0; i < (sizeof layouts / sizeof layouts[0]); i++) {
+        check_layout(&layouts[i]);
+    }
+
+    if (nb_errors != 0) {
+        printf("FAILED: %lu errors in beacon frames\n", nb_errors);
+        return EXIT_FAILURE;
+    }
+
+    printf("SUCCESS: beacon frames of %u layouts match the class B specification\n", (unsigned)(sizeof layouts / sizeof layouts[0]));
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
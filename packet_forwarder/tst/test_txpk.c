@@ -0,0 +1,273 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Check that the single-pass txpk decoder gives the same results as the
+    parson decoding, on randomly generated PULL_RESP documents (no hardware
+    required)
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>     /* dup, dup2 */
+#include <fcntl.h>      /* open */
+
+#include "txpk.h"
+#include "base64.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define NB_DOCUMENTS    200000
+#define DOC_SIZE        2048
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static char doc[DOC_SIZE];
+static int doc_len;
+static int nb_fields;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+static int pick(int n) {
+    return rand() % n;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Optional whitespace, as servers format their documents differently */
+static void add_ws(void) {
+    static const char * const ws[] = { "", "", " ", "\n  ", "\t" };
+
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "%s", ws[pick(5)]);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Start a "name": pair, value formatted by the caller */
+static void add_name(const char *name) {
+    if (nb_fields > 0) {
+        doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, ",");
+    }
+    add_ws();
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "\"%s\"", name);
+    add_ws();
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, ":");
+    add_ws();
+    nb_fields += 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void add_string(const char *name, const char *value) {
+    add_name(name);
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "\"%s\"", value);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void add_raw(const char *name, const char *value) {
+    add_name(name);
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "%s", value);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Mostly valid values, sometimes out of range or of an unexpected type */
+static void add_number(const char *name, double value) {
+    char num[64];
+
+    switch (pick(40)) {
+        case 0:
+            add_raw(name, "\"12\"");
+            break;
+        case 1:
+            add_raw(name, "null");
+            break;
+        case 2:
+            add_raw(name, "-1");
+            break;
+        default:
+            snprintf(num, sizeof num, (pick(2) == 0) ? "%.0f" : "%.6g", value);
+            add_raw(name, num);
+            break;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void add_bool(const char *name) {
+    add_raw(name, (pick(2) == 0) ? "true" : "false");
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Random txpk object, each field present with a high probability */
+static void gen_document(void) {
+    static const char * const sf[] = { "SF5", "SF7", "SF9", "SF12", "SF13", "SF" };
+    static const char * const bw[] = { "BW125", "BW250", "BW500", "BW62", "" };
+    static const char * const cr[] = { "4/5", "4/6", "2/3", "4/7", "4/8", "1/2", "5/4" };
+    static const char * const modu[] = { "LORA", "LORA", "LORA", "FSK", "CW" };
+    uint8_t payload[256];
+    char data[400];
+    char datr[32];
+    int size, i;
+    int m;
+
+    doc_len = 0;
+    nb_fields = 0;
+    doc_len += snprintf(doc, DOC_SIZE, "{");
+    add_ws();
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "\"txpk\":");
+    add_ws();
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "{");
+
+    if (pick(4) == 0) {
+        add_bool("imme");
+    }
+    if (pick(10) != 0) {
+        add_number("tmst", (double)(uint32_t)rand());
+    }
+    if (pick(8) == 0) {
+        add_number("tmms", 1e12 + pick(1000000));
+    }
+    if (pick(20) != 0) {
+        add_number("freq", 863.0 + pick(70000) / 1000.0);
+    }
+    if (pick(20) != 0) {
+        add_number("rfch", pick(3));
+    }
+    if (pick(3) != 0) {
+        add_number("powe", pick(30));
+    }
+    if (pick(10) == 0) {
+        add_number("brd", pick(3));
+    }
+    m = pick(5);
+    if (pick(30) != 0) {
+        add_string("modu", modu[m]);
+    }
+    if ((m == 3) || (pick(20) == 0)) {
+        add_number("datr", 50000);
+        add_number("fdev", 25000);
+    } else {
+        snprintf(datr, sizeof datr, "%s%s", sf[pick(6)], bw[pick(5)]);
+        add_string("datr", datr);
+    }
+    if (pick(20) != 0) {
+        add_string("codr", cr[pick(7)]);
+    }
+    if (pick(2) == 0) {
+        add_bool("ipol");
+    }
+    if (pick(4) == 0) {
+        add_number("prea", pick(70000));
+    }
+    if (pick(4) == 0) {
+        add_bool("ncrc");
+    }
+    if (pick(30) == 0) {
+        add_string("unknown", "field"); /* left to parson */
+    }
+    if (pick(30) == 0) {
+        add_string("codr", "4\\/5"); /* escaped string, duplicated field */
+    }
+
+    size = pick(257);
+    for (i = 0; i < size; i++) {
+        payload[i] = (uint8_t)rand();
+    }
+    if (bin_to_b64(payload, (size < 256) ? size : 255, data, sizeof data) < 0) {
+        data[0] = '\0';
+    }
+    if (pick(20) != 0) {
+        add_number("size", (pick(20) == 0) ? size + 1 : size);
+    }
+    if (pick(20) != 0) {
+        add_string("data", data);
+    }
+
+    add_ws();
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "}");
+    add_ws();
+    doc_len += snprintf(doc + doc_len, DOC_SIZE - doc_len, "}");
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(void)
+{
+    int i;
+    int nb_err = 0;
+    int nb_ok = 0;
+    int res, res_ref;
+    int out_fd, null_fd;
+    static struct txpk_s txpk, txpk_ref;
+
+    /* both decoders print the reason of each rejected request, keep the console readable */
+    fflush(stdout);
+    out_fd = dup(STDOUT_FILENO);
+    null_fd = open("/dev/null", O_WRONLY);
+    if ((out_fd < 0) || (null_fd < 0)) {
+        printf("ERROR: failed to redirect the console\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(0x1302);
+    for (i = 0; i < NB_DOCUMENTS; i++) {
+        gen_document();
+
+        fflush(stdout);
+        dup2(null_fd, STDOUT_FILENO);
+        res = txpk_json_parse(doc, &txpk);
+        res_ref = txpk_json_parse_parson(doc, &txpk_ref);
+        fflush(stdout);
+        dup2(out_fd, STDOUT_FILENO);
+
+        if ((res != res_ref) || ((res == 0) && (memcmp(&txpk, &txpk_ref, sizeof txpk) != 0))) {
+            if (nb_err < 10) {
+                printf("ERROR: results differ (%d, parson %d) for %s\n", res, res_ref, doc);
+            }
+            nb_err += 1;
+        }
+        if (res_ref == 0) {
+            nb_ok += 1;
+        }
+    }
+    close(null_fd);
+    close(out_fd);
+
+    if (nb_err != 0) {
+        printf("FAILED: %d documents decoded differently out of %d\n", nb_err, NB_DOCUMENTS);
+        return EXIT_FAILURE;
+    }
+
+    printf("SUCCESS: %d documents decoded identically (%d valid requests)\n", NB_DOCUMENTS, nb_ok);
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,145 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Benchmark of the Base64 library, portable versus vectorized implementation
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "base64.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEFAULT_LOOPS   200000
+#define PAYLOAD_MAX     255 /* largest LoRa payload */
+
+static const int sizes[] = { 16, 51, 128, 222, 255 };
+
+/* -------------------------------------------------------------------------- */
+/* --- SUBFUNCTIONS DECLARATION --------------------------------------------- */
+
+static void usage(void);
+static double now_us(void);
+static double bench_encode(const uint8_t *in, int size, char *out, int loops);
+static double bench_decode(const char *in, int len, uint8_t *out, int loops);
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(int argc, char ** argv)
+{
+    unsigned int i;
+    int j, len;
+    int loops = DEFAULT_LOOPS;
+    uint8_t payload[PAYLOAD_MAX];
+    uint8_t bin_ref[PAYLOAD_MAX], bin_simd[PAYLOAD_MAX];
+    char b64_ref[2 * PAYLOAD_MAX], b64_simd[2 * PAYLOAD_MAX];
+    double t_enc_ref, t_dec_ref, t_enc_simd, t_dec_simd;
+
+    if (argc > 2) {
+        usage();
+        return -1;
+    } else if (argc == 2) {
+        loops = atoi(argv[1]);
+        if (loops <= 0) {
+            usage();
+            return -1;
+        }
+    }
+
+    srand(0x1302);
+    for (j = 0; j < PAYLOAD_MAX; j++) {
+        payload[j] = (uint8_t)rand();
+    }
+
+    if (b64_set_simd(1) == 0) {
+        printf("WARNING: no vectorized implementation for this CPU, both columns use the portable code\n");
+    }
+
+    printf("%7s | %12s %12s | %12s %12s\n", "size", "enc portable", "enc simd", "dec portable", "dec simd");
+    for (i = 0; i < (sizeof sizes / sizeof sizes[0]); i++) {
+        /* portable implementation */
+        b64_set_simd(0);
+        t_enc_ref = bench_encode(payload, sizes[i], b64_ref, loops);
+        len = (int)strlen(b64_ref);
+        t_dec_ref = bench_decode(b64_ref, len, bin_ref, loops);
+
+        /* vectorized implementation */
+        b64_set_simd(1);
+        t_enc_simd = bench_encode(payload, sizes[i], b64_simd, loops);
+        t_dec_simd = bench_decode(b64_simd, len, bin_simd, loops);
+
+        /* both must give the same result */
+        if ((strcmp(b64_ref, b64_simd) != 0) || (memcmp(bin_ref, payload, sizes[i]) != 0) || (memcmp(bin_simd, payload, sizes[i]) != 0)) {
+            printf("ERROR: implementations mismatch for %d bytes\n", sizes[i]);
+            return -1;
+        }
+
+        printf("%7d | %9.1f ns %9.1f ns | %9.1f ns %9.1f ns\n", sizes[i], t_enc_ref, t_enc_simd, t_dec_ref, t_dec_simd);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- SUBFUNCTIONS DEFINITION ---------------------------------------------- */
+
+static void usage(void) {
+    printf("Usage: base64_bench [loops]\n");
+    printf("  loops: number of conversions per payload size (default %d)\n", DEFAULT_LOOPS);
+}
+
+static double now_us(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec * 1e6) + (t.tv_nsec / 1e3);
+}
+
+/* average time of one conversion, in ns */
+static double bench_encode(const uint8_t *in, int size, char *out, int loops) {
+    double t;
+    int i;
+
+    t = now_us();
+    for (i = 0; i < loops; i++) {
+        bin_to_b64(in, size, out, 2 * PAYLOAD_MAX);
+    }
+    return (now_us() - t) * 1e3 / loops;
+}
+
+static double bench_decode(const char *in, int len, uint8_t *out, int loops) {
+    double t;
+    int i;
+
+    t = now_us();
+    for (i = 0; i < loops; i++) {
+        b64_to_bin(in, len, out, PAYLOAD_MAX);
+    }
+    return (now_us() - t) * 1e3 / loops;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -1,14 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
+#include "loragw_hal.h"
+#include "loragw_sx1302.h"
+
 /* -------------------------------------------------------------------------- */
 /* --- SUBFUNCTIONS DECLARATION --------------------------------------------- */
 
 static void usage(void);
-uint16_t sx1302_lora_payload_crc(const uint8_t * data, uint8_t size);
 void remove_spaces(char *str);
+static int batch_crc(const char * path);
 
 /* -------------------------------------------------------------------------- */
 /* --- MAIN FUNCTION -------------------------------------------------------- */
@@ -26,6 +30,10 @@ int main(int argc, char ** argv)
         return -1;
     }
 
+    if ((strcmp(argv[1], "-f") == 0) && (argc >= 3)) {
+        return batch_crc(argv[2]);
+    }
+
     /* Get payload hex string from command line */
     memcpy(hexstr, argv[1], strlen(argv[1]));
     hexstr[strlen(argv[1])] = '\0';
@@ -53,6 +61,8 @@ int main(int argc, char ** argv)
 
 void usage(void) {
     printf("Missing payload hex string\n");
+    printf("Batch mode: ./payload_crc -f <file|->\n");
+    printf("       one payload hex string per line, - for stdin, one CRC per line (empty if not a payload)\n");
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -74,37 +84,39 @@ void remove_spaces(char *str)
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-void lora_crc16(const char data, int *crc) {
-    int next = 0;
-    next  =  (((data>>0)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1)                 )      ;
-    next += ((((data>>1)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1)                 )<<1 ) ;
-    next += ((((data>>2)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1)                 )<<2 ) ;
-    next += ((((data>>3)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<3 ) ;
-    next += ((((data>>4)&1) ^ ((*crc>>12)&1)                                  )<<4 ) ;
-    next += ((((data>>5)&1) ^ ((*crc>>13)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1))<<5 ) ;
-    next += ((((data>>6)&1) ^ ((*crc>>14)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1))<<6 ) ;
-    next += ((((data>>7)&1) ^ ((*crc>>15)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1))<<7 ) ;
-    next += ((((*crc>>0)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<8 ) ;
-    next += ((((*crc>>1)&1) ^ ((*crc>>12)&1)                                  )<<9 ) ;
-    next += ((((*crc>>2)&1) ^ ((*crc>>13)&1)                                  )<<10) ;
-    next += ((((*crc>>3)&1) ^ ((*crc>>14)&1)                                  )<<11) ;
-    next += ((((*crc>>4)&1) ^ ((*crc>>15)&1) ^ ((*crc>>12)&1) ^ ((*crc>> 8)&1))<<12) ;
-    next += ((((*crc>>5)&1) ^ ((*crc>>13)&1) ^ ((*crc>> 9)&1)                 )<<13) ;
-    next += ((((*crc>>6)&1) ^ ((*crc>>14)&1) ^ ((*crc>>10)&1)                 )<<14) ;
-    next += ((((*crc>>7)&1) ^ ((*crc>>15)&1) ^ ((*crc>>11)&1)                 )<<15) ;
-    (*crc) = next;
-}
-
-/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-
-uint16_t sx1302_lora_payload_crc(const uint8_t * data, uint8_t size) {
-    int i;
-    int crc = 0;
+static int batch_crc(const char * path) {
+    FILE * f;
+    char line[1024];
+    uint8_t payload[255];
+    int i, len;
+    int size;
+    unsigned v;
 
-    for (i = 0; i < size; i++) {
-        lora_crc16(data[i], &crc);
+    f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (f == NULL) {
+        printf("ERROR: failed to open %s\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof line, f) != NULL) {
+        remove_spaces(line);
+        len = strcspn(line, "\r\n");
+        size = ((len % 2) == 0) ? (len / 2) : -1;
+        for (i = 0; (i < size) && (i < (int)sizeof payload); i++) {
+            if (sscanf(line + 2*i, "%2x", &v) != 1) {
+                size = -1;
+                break;
+            }
+            payload[i] = (uint8_t)v;
+        }
+        if ((size > 0) && (size <= (int)sizeof payload)) {
+            printf("%04X\n", sx1302_lora_payload_crc(payload, (uint8_t)size));
+        } else {
+            printf("\n");
+        }
+    }
+    if (f != stdin) {
+        fclose(f);
     }
 
-    //printf("CRC16: 0x%02X 0x%02X (%X)\n", (uint8_t)(crc >> 8), (uint8_t)crc, crc);
-    return (uint16_t)crc;
+    return 0;
 }
@@ -1,18 +1,62 @@
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
+#include <unistd.h>     /* getopt, sysconf */
+#include <pthread.h>
+
+#include "tinymt32.h"
+#include "loragw_hal.h"
+#include "loragw_sx1302.h"
 
 /* -------------------------------------------------------------------------- */
 /* --- MACROS --------------------------------------------------------------- */
 
 #define TAKE_N_BITS_FROM(b, p, n) (((b) >> (p)) & ((1 << (n)) - 1))
 
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define PAYLOAD_SIZE_MAX        255
+#define PAYLOAD_HEADER_SIZE     8       /* dev_id + packet counter, as built by payload_gen */
+#define UNMATCHED_BER_PERCENT   25      /* above, the packet counter itself is assumed wrong, or the packet is foreign */
+#define THREADS_MAX             64
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* Statistics of a part of the input, merged once all parts are processed */
+typedef struct {
+    const char * start;         /* lines to be processed */
+    const char * end;
+    const uint8_t * dev_id;     /* expected dev_id, NULL to take the one of each packet */
+    bool verbose;
+    uint32_t nb_lines;
+    uint32_t nb_skipped;        /* not a payload, or too short */
+    uint32_t nb_unmatched;
+    uint32_t nb_undetected;     /* bit errors not detected by the payload CRC */
+    uint64_t nb_bits;           /* bits of the matched packets */
+    uint64_t nb_bit_errors;
+    uint32_t bit_errors[PAYLOAD_SIZE_MAX * 8]; /* per bit position, MSB first */
+    uint64_t * keys;            /* (counter << 1) | error, one per matched packet */
+    uint32_t nb_keys;
+    uint32_t size_keys;
+} batch_part_t;
+
 /* -------------------------------------------------------------------------- */
 /* --- SUBFUNCTIONS DECLARATION --------------------------------------------- */
 
 static void usage(void);
 void remove_spaces(char *str);
+static int batch_main(int argc, char ** argv);
 
 /* -------------------------------------------------------------------------- */
 /* --- MAIN FUNCTION -------------------------------------------------------- */
@@ -27,6 +71,10 @@ int main(int argc, char ** argv)
     char hexstr[1024];
     uint16_t nb_bits_diff = 0;
 
+    if ((argc >= 2) && (argv[1][0] == '-')) {
+        return batch_main(argc, argv);
+    }
+
     if (argc < 3) {
         usage();
         return -1;
@@ -95,6 +143,12 @@ int main(int argc, char ** argv)
 
 void usage(void) {
     printf("Missing payload hex strings for a & b\n");
+    printf("Batch mode: ./payload_diff -f <file|-> [-d dev_id] [-j threads] [-v]\n");
+    printf("       -f: one payload per line, hex string or last field of a CSV line (net_downlink log), - for stdin\n");
+    printf("       -d: hex string of the expected 4-bytes dev_id, else taken from each payload\n");
+    printf("       -j: number of threads, default to the number of CPUs\n");
+    printf("       -v: display the result of each payload (single thread)\n");
+    printf("       Every payload is compared to the one payload_gen builds from its packet counter.\n");
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -114,3 +168,336 @@ void remove_spaces(char *str)
     str[count] = '\0';
 }
 
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int hex_to_bin(const char * str, int len, uint8_t * out) {
+    int i, v;
+    int n = 0;
+    int nibble = -1;
+
+    for (i = 0; i < len; i++) {
+        if ((str[i] == ' ') || (str[i] == '\r')) {
+            continue;
+        }
+        if ((str[i] >= '0') && (str[i] <= '9')) {
+            v = str[i] - '0';
+        } else if ((str[i] >= 'a') && (str[i] <= 'f')) {
+            v = str[i] - 'a' + 10;
+        } else if ((str[i] >= 'A') && (str[i] <= 'F')) {
+            v = str[i] - 'A' + 10;
+        } else {
+            return -1;
+        }
+        if (nibble < 0) {
+            nibble = v;
+        } else {
+            if (n >= PAYLOAD_SIZE_MAX) {
+                return -1;
+            }
+            out[n++] = (uint8_t)((nibble << 4) | v);
+            nibble = -1;
+        }
+    }
+    return (nibble < 0) ? n : -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Same construction as payload_gen */
+static void expected_payload(const uint8_t * dev_id, uint32_t packet_cnt, uint8_t * payload, int size) {
+    int j;
+    tinymt32_t tinymt;
+
+    tinymt.mat1 = 0x8f7011ee;
+    tinymt.mat2 = 0xfc78ff1f;
+    tinymt.tmat = 0x3793fdff;
+    tinymt32_init(&tinymt, packet_cnt);
+
+    memcpy(payload, dev_id, 4);
+    payload[4] = (uint8_t)(packet_cnt >> 24);
+    payload[5] = (uint8_t)(packet_cnt >> 16);
+    payload[6] = (uint8_t)(packet_cnt >> 8);
+    payload[7] = (uint8_t)(packet_cnt >> 0);
+    for (j = PAYLOAD_HEADER_SIZE; j < size; j++) {
+        payload[j] = (uint8_t)tinymt32_generate_uint32(&tinymt);
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void * batch_process(void * arg) {
+    batch_part_t * part = (batch_part_t *)arg;
+    const char * line = part->start;
+    const char * eol;
+    const char * field;
+    uint8_t payload[PAYLOAD_SIZE_MAX];
+    uint8_t expected[PAYLOAD_SIZE_MAX];
+    uint8_t diff[PAYLOAD_SIZE_MAX + 8];
+    uint64_t word;
+    uint32_t packet_cnt;
+    int size, nb_errors, i, j;
+
+    while (line < part->end) {
+        eol = memchr(line, '\n', part->end - line);
+        if (eol == NULL) {
+            eol = part->end;
+        }
+        part->nb_lines += 1;
+
+        /* The payload is the whole line, or the last field of a CSV line */
+        for (field = eol; (field > line) && (field[-1] != ','); field--);
+        size = hex_to_bin(field, (int)(eol - field), payload);
+        if (size < PAYLOAD_HEADER_SIZE) {
+            part->nb_skipped += 1;
+            line = eol + 1;
+            continue;
+        }
+
+        /* Count the flipped bits 64 at a time, positions are only looked for in the bytes that differ */
+        packet_cnt = ((uint32_t)payload[4] << 24) | ((uint32_t)payload[5] << 16) | ((uint32_t)payload[6] << 8) | payload[7];
+        expected_payload((part->dev_id != NULL) ? part->dev_id : payload, packet_cnt, expected, size);
+        for (j = 0; j < size; j++) {
+            diff[j] = payload[j] ^ expected[j];
+        }
+        memset(diff + size, 0, 8);
+        nb_errors = 0;
+        for (j = 0; j < size; j += 8) {
+            memcpy(&word, diff + j, 8);
+            nb_errors += __builtin_popcountll(word);
+        }
+        if ((nb_errors * 100) > (size * 8 * UNMATCHED_BER_PERCENT)) {
+            part->nb_unmatched += 1;
+            if (part->verbose) {
+                printf("%u: %d bytes, unmatched\n", packet_cnt, size);
+            }
+            line = eol + 1;
+            continue;
+        }
+        if (nb_errors > 0) {
+            for (j = 0; j < size; j++) {
+                for (i = 7; (diff[j] != 0) && (i >= 0); i--) {
+                    if (TAKE_N_BITS_FROM(diff[j], i, 1) == 1) {
+                        part->bit_errors[(j * 8) + (7 - i)] += 1;
+                    }
+                }
+            }
+            if (sx1302_lora_payload_crc(payload, size) == sx1302_lora_payload_crc(expected, size)) {
+                part->nb_undetected += 1;
+            }
+        }
+        part->nb_bits += size * 8;
+        part->nb_bit_errors += nb_errors;
+        if (part->verbose) {
+            printf("%u: %d bytes, CRC %04X, %d bits flipped\n", packet_cnt, size, sx1302_lora_payload_crc(payload, size), nb_errors);
+        }
+
+        /* Keep the counter for PER, once all parts are merged */
+        if (part->nb_keys == part->size_keys) {
+            part->size_keys = (part->size_keys == 0) ? 4096 : (part->size_keys * 2);
+            part->keys = realloc(part->keys, part->size_keys * sizeof(uint64_t));
+            if (part->keys == NULL) {
+                printf("ERROR: out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        part->keys[part->nb_keys++] = ((uint64_t)packet_cnt << 1) | ((nb_errors > 0) ? 1 : 0);
+
+        line = eol + 1;
+    }
+
+    return NULL;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int compare_keys(const void * a, const void * b) {
+    uint64_t ka = *(const uint64_t *)a;
+    uint64_t kb = *(const uint64_t *)b;
+
+    return (ka > kb) - (ka < kb);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static char * read_input(const char * path, size_t * size) {
+    FILE * f;
+    char * buf = NULL;
+    char * tmp;
+    size_t len = 0;
+    size_t max = 0;
+    size_t n;
+
+    f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (f == NULL) {
+        printf("ERROR: failed to open %s\n", path);
+        return NULL;
+    }
+    do {
+        if (len == max) {
+            max = (max == 0) ? (1 << 20) : (max * 2);
+            tmp = realloc(buf, max);
+            if (tmp == NULL) {
+                printf("ERROR: out of memory\n");
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = tmp;
+        }
+        n = fread(buf + len, 1, max - len, f);
+        len += n;
+    } while (n > 0);
+    if (f != stdin) {
+        fclose(f);
+    }
+    *size = len;
+    return buf;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int batch_main(int argc, char ** argv) {
+    int i, j, x;
+    const char * path = NULL;
+    uint8_t dev_id[4];
+    bool dev_id_set = false;
+    bool verbose = false;
+    long nb_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char * buf;
+    size_t buf_size;
+    const char * start;
+    const char * cut;
+    static batch_part_t parts[THREADS_MAX];
+    pthread_t threads[THREADS_MAX];
+    batch_part_t * total = &parts[0];
+    uint64_t * keys;
+    uint32_t nb_unique = 0;
+    uint32_t nb_ok = 0;
+    uint32_t first, last;
+    uint64_t nb_expected;
+
+    while ((i = getopt(argc, argv, "f:d:j:vh")) != -1) {
+        switch (i) {
+            case 'f':
+                path = optarg;
+                break;
+            case 'd':
+                if (hex_to_bin(optarg, strlen(optarg), dev_id) != 4) {
+                    printf("ERROR: dev_id must be a 4-bytes hex string\n");
+                    return -1;
+                }
+                dev_id_set = true;
+                break;
+            case 'j':
+                nb_threads = atoi(optarg);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                usage();
+                return -1;
+        }
+    }
+    if (path == NULL) {
+        usage();
+        return -1;
+    }
+    if (verbose || (nb_threads < 1)) {
+        nb_threads = 1; /* keep the output in input order */
+    } else if (nb_threads > THREADS_MAX) {
+        nb_threads = THREADS_MAX;
+    }
+
+    buf = read_input(path, &buf_size);
+    if (buf == NULL) {
+        return -1;
+    }
+
+    /* Split the input in line aligned parts, one per thread */
+    start = buf;
+    for (i = 0; i < nb_threads; i++) {
+        cut = (i == (nb_threads - 1)) ? (buf + buf_size) : (buf + ((buf_size * (i + 1)) / nb_threads));
+        while ((cut < (buf + buf_size)) && (cut > start) && (cut[-1] != '\n')) {
+            cut++;
+        }
+        if (cut < start) {
+            cut = start;
+        }
+        parts[i].start = start;
+        parts[i].end = cut;
+        parts[i].dev_id = dev_id_set ? dev_id : NULL;
+        parts[i].verbose = verbose;
+        start = cut;
+        x = pthread_create(&threads[i], NULL, batch_process, &parts[i]);
+        if (x != 0) {
+            printf("ERROR: failed to create thread %d\n", i);
+            return -1;
+        }
+    }
+
+    /* Merge in the first part */
+    pthread_join(threads[0], NULL);
+    for (i = 1; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        total->nb_lines += parts[i].nb_lines;
+        total->nb_skipped += parts[i].nb_skipped;
+        total->nb_unmatched += parts[i].nb_unmatched;
+        total->nb_undetected += parts[i].nb_undetected;
+        total->nb_bits += parts[i].nb_bits;
+        total->nb_bit_errors += parts[i].nb_bit_errors;
+        for (j = 0; j < (PAYLOAD_SIZE_MAX * 8); j++) {
+            total->bit_errors[j] += parts[i].bit_errors[j];
+        }
+        if (parts[i].nb_keys > 0) {
+            keys = realloc(total->keys, (total->nb_keys + parts[i].nb_keys) * sizeof(uint64_t));
+            if (keys == NULL) {
+                printf("ERROR: out of memory\n");
+                return -1;
+            }
+            memcpy(keys + total->nb_keys, parts[i].keys, parts[i].nb_keys * sizeof(uint64_t));
+            total->keys = keys;
+            total->nb_keys += parts[i].nb_keys;
+            free(parts[i].keys);
+        }
+    }
+    free(buf);
+
+    /* A counter is received if any of its copies is, error free if any of its copies is (sorted first) */
+    qsort(total->keys, total->nb_keys, sizeof(uint64_t), compare_keys);
+    for (i = 0; i < (int)total->nb_keys; i++) {
+        if ((i == 0) || ((total->keys[i] >> 1) != (total->keys[i - 1] >> 1))) {
+            nb_unique += 1;
+            if ((total->keys[i] & 1) == 0) {
+                nb_ok += 1;
+            }
+        }
+    }
+
+    printf("Lines:             %u (skipped: %u, unmatched: %u)\n", total->nb_lines, total->nb_skipped, total->nb_unmatched);
+    if (total->nb_keys == 0) {
+        printf("No payload matching the payload_gen pattern\n");
+        free(total->keys);
+        return 0;
+    }
+    first = (uint32_t)(total->keys[0] >> 1);
+    last = (uint32_t)(total->keys[total->nb_keys - 1] >> 1);
+    nb_expected = (uint64_t)last - first + 1;
+    printf("Packet counters:   %u..%u, %llu expected\n", first, last, (unsigned long long)nb_expected);
+    printf("Received:          %u (duplicates: %u), %u error free\n", nb_unique, total->nb_keys - nb_unique, nb_ok);
+    printf("PER:               %.3f%%\n", 100.0 * (double)(nb_expected - nb_ok) / (double)nb_expected);
+    printf("BER:               %.3e (%llu bits flipped, %u packets with errors not detected by the CRC)\n",
+            (double)total->nb_bit_errors / (double)total->nb_bits, (unsigned long long)total->nb_bit_errors, total->nb_undetected);
+    if (total->nb_bit_errors > 0) {
+        printf("Flipped bits per position (byte.bit, bit 0 is the MSB):\n");
+        for (j = 0; j < (PAYLOAD_SIZE_MAX * 8); j++) {
+            if (total->bit_errors[j] > 0) {
+                printf("  %3d.%d: %u\n", j / 8, j % 8, total->bit_errors[j]);
+            }
+        }
+    }
+    free(total->keys);
+
+    return 0;
+}
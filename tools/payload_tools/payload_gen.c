@@ -21,6 +21,8 @@ int main(int argc, char ** argv)
     uint8_t payload[255];
     uint8_t payload_size;
     unsigned int packet_cnt;
+    unsigned int nb_packets = 1;
+    unsigned int n;
     tinymt32_t tinymt;
     char hexstr[32];
 
@@ -50,28 +52,35 @@ int main(int argc, char ** argv)
     /* Get packet payload size */
     payload_size = (uint8_t)atoi(argv[3]);
 
-    /* Initialize the pseudo-random generator */
-    tinymt.mat1 = 0x8f7011ee;
-    tinymt.mat2 = 0xfc78ff1f;
-    tinymt.tmat = 0x3793fdff;
-    tinymt32_init(&tinymt, packet_cnt);
-
-    /* Construct packet */
-    payload[0] = dev_id[0];
-    payload[1] = dev_id[1];
-    payload[2] = dev_id[2];
-    payload[3] = dev_id[3];
-    payload[4] = (uint8_t)(packet_cnt >> 24);
-    payload[5] = (uint8_t)(packet_cnt >> 16);
-    payload[6] = (uint8_t)(packet_cnt >> 8);
-    payload[7] = (uint8_t)(packet_cnt >> 0);
-    for (j = 8; j < payload_size; j++) {
-        payload[j] = (uint8_t)tinymt32_generate_uint32(&tinymt);
+    /* Get the number of consecutive packets to be generated, if batch */
+    if (argc > 4) {
+        nb_packets = (unsigned int)atoi(argv[4]);
     }
-    for (j = 0; j < payload_size; j++) {
-        printf("%02X ", payload[j]);
+
+    for (n = 0; n < nb_packets; n++, packet_cnt++) {
+        /* Initialize the pseudo-random generator */
+        tinymt.mat1 = 0x8f7011ee;
+        tinymt.mat2 = 0xfc78ff1f;
+        tinymt.tmat = 0x3793fdff;
+        tinymt32_init(&tinymt, packet_cnt);
+
+        /* Construct packet */
+        payload[0] = dev_id[0];
+        payload[1] = dev_id[1];
+        payload[2] = dev_id[2];
+        payload[3] = dev_id[3];
+        payload[4] = (uint8_t)(packet_cnt >> 24);
+        payload[5] = (uint8_t)(packet_cnt >> 16);
+        payload[6] = (uint8_t)(packet_cnt >> 8);
+        payload[7] = (uint8_t)(packet_cnt >> 0);
+        for (j = 8; j < payload_size; j++) {
+            payload[j] = (uint8_t)tinymt32_generate_uint32(&tinymt);
+        }
+        for (j = 0; j < payload_size; j++) {
+            printf("%02X ", payload[j]);
+        }
+        printf("\n");
     }
-    printf("\n");
 
 #if 0
     for (packet_cnt = 0; packet_cnt < 10; packet_cnt++) {
@@ -100,10 +109,11 @@ int main(int argc, char ** argv)
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 void usage(void) {
-    printf("Missing parameters: ./payload_gen dev_id pkt_cnt pkt_size\n");
+    printf("Missing parameters: ./payload_gen dev_id pkt_cnt pkt_size [nb_pkt]\n");
     printf("       dev_id: hex string for 4-bytes dev_id\n");
     printf("       pkt_cnt: unsigned int used to initialize the pseudo-random generator\n");
     printf("       pkt_size: paylaod size in bytes [0..255]\n");
+    printf("       nb_pkt: number of payloads to generate, for consecutive counters from pkt_cnt (optional)\n");
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -0,0 +1,66 @@
+/*
+  ______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Host-side transport for libloragw, modelling the concentrator registers
+    and memories in RAM and streaming recorded data through the SX1302 RX
+    buffer FIFO.
+    Registered with lgw_com_register, selected by the "mock:" connection path.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+#ifndef _MOCK_SPI_H
+#define _MOCK_SPI_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdbool.h>    /* bool type */
+
+#include "loragw_spi.h"
+#include "loragw_com.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define MOCK_SPI_PATH           "mock:rx_buffer"    /* any path after the prefix is accepted */
+#define MOCK_SPI_RX_FIFO_SIZE   4096                /* size of the SX1302 RX buffer */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC VARIABLES ----------------------------------------------------- */
+
+extern const struct lgw_com_s mock_spi_com; /* to be registered before lgw_connect */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Clear the register and memory model, the RX FIFO and the SPI statistics
+*/
+void mock_spi_reset(void);
+
+/**
+@brief Append bytes to the SX1302 RX buffer FIFO, as if the packet engine had received them
+@param data bytes in the RX buffer format (syncword, metadata, payload, checksum)
+@param size number of bytes
+@return LGW_SPI_SUCCESS, LGW_SPI_ERROR if the FIFO has not enough room left
+*/
+int mock_spi_rx_push(const uint8_t *data, uint16_t size);
+
+/**
+@brief Get the number of bytes waiting in the SX1302 RX buffer FIFO
+*/
+uint16_t mock_spi_rx_level(void);
+
+#endif
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,473 @@
+/*
+  ______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Host-side benchmark of the uplink and downlink hot paths (RX buffer,
+    packet parsing, CRC, time on air, JiT queue, base64 and serializers),
+    run against a recorded RX buffer dump through the mock transport.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+/* fix an issue between POSIX and C99 */
+#if __STDC_VERSION__ >= 199901L
+    #define _XOPEN_SOURCE 600
+#else
+    #define _XOPEN_SOURCE 500
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>       /* clock_gettime */
+#include <unistd.h>     /* getopt */
+
+#include "loragw_hal.h"
+#include "loragw_reg.h"
+#include "loragw_sx1302.h"
+#include "loragw_sx1302_rx.h"
+
+#include "jitqueue.h"
+#include "rxpk.h"
+#include "binproto.h"
+#include "base64.h"
+
+#include "mock_spi.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define MAX(a, b)           ((a) > (b) ? (a) : (b))
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEFAULT_NB_ITER     1000
+
+#define SYNTH_PKT_NB        16      /* packets of the synthesized RX buffer */
+
+/* RX buffer packet structure, see loragw_sx1302_rx.c */
+#define PKT_HEAD_METADATA   9
+#define PKT_TAIL_METADATA   14
+
+#define JIT_DEPTH           16      /* downlinks kept in the JiT queue */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct bench_s {
+    const char *    name;
+    unsigned        ops;        /* packets, or downlinks for the JiT queue */
+    double          ns;         /* total time spent */
+    uint32_t        spi;        /* SPI messages sent */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static uint8_t dump[MOCK_SPI_RX_FIFO_SIZE];
+static uint16_t dump_size = 0;
+static unsigned dump_pkt_nb = 0;
+
+static rx_buffer_t rx_buf;
+static lgw_context_t ctx;
+static struct lgw_pkt_rx_s rxpkt[256];              /* parsed packets of the dump */
+static struct lgw_pkt_tx_s txpkt[256];              /* downlinks with the same modulation */
+static struct jit_queue_s jit_queue;
+
+static volatile uint32_t sink;                      /* keeps the results alive */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS ---------------------------------------------------- */
+
+/* describe command line options */
+void usage(void) {
+    printf("Library version information: %s\n", lgw_version_info());
+    printf("Available options:\n");
+    printf(" -h print this help\n");
+    printf(" -n <uint> Number of iterations over the RX buffer content, default %u\n", DEFAULT_NB_ITER);
+    printf(" -f <path> RX buffer dump, space separated hex bytes as written by rx_buffer_dump\n");
+    printf("           (default: %u synthesized LoRa packets)\n", SYNTH_PKT_NB);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1E9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t spi_messages(void) {
+    struct lgw_spi_stats_s st;
+    uint32_t nb = 0;
+    int i, j;
+
+    lgw_get_spi_stats(&st, true);
+    for (i = 0; i < LGW_SPI_MUX_TARGET_NB; i++) {
+        for (j = 0; j < LGW_SPI_OP_NB; j++) {
+            nb += st.target[i][j].transfers;
+        }
+    }
+    return nb;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void bench_start(struct bench_s *b, const char *name, struct timespec *start) {
+    memset(b, 0, sizeof *b);
+    b->name = name;
+    spi_messages(); /* reset */
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static void bench_stop(struct bench_s *b, unsigned ops, const struct timespec *start) {
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    b->ns = elapsed_ns(start, &end);
+    b->spi = spi_messages();
+    b->ops = ops;
+    printf("%-22s %10u %12.1f %8.2f\n", b->name, b->ops, (b->ops > 0) ? (b->ns / b->ops) : 0.0, (b->ops > 0) ? ((double)b->spi / b->ops) : 0.0);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int load_dump(const char *path) {
+    FILE *f;
+    unsigned int u;
+    int n;
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        printf("ERROR: failed to open %s\n", path);
+        return -1;
+    }
+    while ((n = fscanf(f, "%x", &u)) == 1) {
+        if ((u > 0xFF) || (dump_size >= sizeof dump)) {
+            printf("ERROR: %s is not a RX buffer dump (byte %u)\n", path, dump_size);
+            fclose(f);
+            return -1;
+        }
+        dump[dump_size++] = (uint8_t)u;
+    }
+    fclose(f);
+    if ((n != EOF) || (dump_size == 0)) {
+        printf("ERROR: %s is not a RX buffer dump (byte %u)\n", path, dump_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Build a RX buffer content with LoRa packets of various sizes and datarates on the multi-SF channels */
+static void synth_dump(void) {
+    uint32_t seed = 0x1302;
+    uint32_t ts;
+    uint16_t crc;
+    uint8_t size, sum;
+    uint8_t *p;
+    int i, j;
+
+    for (i = 0; i < SYNTH_PKT_NB; i++) {
+        p = &dump[dump_size];
+        size = (uint8_t)(10 + 15 * i);
+        ts = 32 * (1000000 + 50000 * i); /* 32 MHz counter */
+
+        memset(p, 0, PKT_HEAD_METADATA + size + PKT_TAIL_METADATA);
+        p[0] = 0xA5; /* syncword */
+        p[1] = 0xC0;
+        p[2] = size;
+        p[3] = (uint8_t)(i % 8); /* channel */
+        p[4] = (uint8_t)(((7 + (i % 6)) << 4) | (1 << 1) | 1); /* SF, CR 4/5, CRC on */
+        p[5] = (uint8_t)(i % 8); /* modem */
+        for (j = 0; j < size; j++) {
+            seed = seed * 1103515245 + 12345;
+            p[PKT_HEAD_METADATA + j] = (uint8_t)(seed >> 16);
+        }
+        crc = sx1302_lora_payload_crc(&p[PKT_HEAD_METADATA], size);
+        p[size + 10] = 28;  /* SNR 7 dB */
+        p[size + 11] = 80;  /* RSSI channel */
+        p[size + 12] = 72;  /* RSSI signal */
+        p[size + 15] = (uint8_t)(ts >> 0);
+        p[size + 16] = (uint8_t)(ts >> 8);
+        p[size + 17] = (uint8_t)(ts >> 16);
+        p[size + 18] = (uint8_t)(ts >> 24);
+        p[size + 19] = (uint8_t)(crc >> 0);
+        p[size + 20] = (uint8_t)(crc >> 8);
+        p[size + 21] = 0;   /* no fine timestamp metrics */
+        sum = 0;
+        for (j = 0; j < (PKT_HEAD_METADATA + size + PKT_TAIL_METADATA - 1); j++) {
+            sum += p[j];
+        }
+        p[PKT_HEAD_METADATA + size + PKT_TAIL_METADATA - 1] = sum;
+
+        dump_size += PKT_HEAD_METADATA + size + PKT_TAIL_METADATA;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Same configuration as the reference global_conf.json (EU868) */
+static void context_init(void) {
+    static const int32_t if_freq[8] = {-400000, -200000, 0, -400000, -200000, 0, 200000, 400000};
+    int i;
+
+    memset(&ctx, 0, sizeof ctx);
+    ctx.rf_chain_cfg[0].enable = true;
+    ctx.rf_chain_cfg[0].freq_hz = 867500000;
+    ctx.rf_chain_cfg[1].enable = true;
+    ctx.rf_chain_cfg[1].freq_hz = 868500000;
+    for (i = 0; i < 8; i++) {
+        ctx.if_chain_cfg[i].enable = true;
+        ctx.if_chain_cfg[i].rf_chain = (i < 3) ? 1 : 0;
+        ctx.if_chain_cfg[i].freq_hz = if_freq[i];
+    }
+    ctx.if_chain_cfg[8].rf_chain = 1;
+    ctx.if_chain_cfg[8].freq_hz = -200000;
+    ctx.lora_service_cfg.bandwidth = BW_250KHZ;
+    ctx.lora_service_cfg.datarate = DR_LORA_SF7;
+    ctx.if_chain_cfg[9].rf_chain = 1;
+    ctx.if_chain_cfg[9].freq_hz = 300000;
+    ctx.fsk_cfg.bandwidth = BW_125KHZ;
+    ctx.fsk_cfg.datarate = 50000;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Check that the dump can be parsed, and keep its packets for the other benchmarks */
+static int dump_check(void) {
+    uint8_t nb_pkt;
+    int i;
+
+    if (mock_spi_rx_push(dump, dump_size) != LGW_SPI_SUCCESS) {
+        return -1;
+    }
+    if ((sx1302_fetch(&nb_pkt) != LGW_REG_SUCCESS) || (nb_pkt == 0)) {
+        printf("ERROR: no packet found in the RX buffer content\n");
+        return -1;
+    }
+    for (i = 0; i < nb_pkt; i++) {
+        if (sx1302_parse(&ctx, &rxpkt[i]) != LGW_REG_SUCCESS) {
+            printf("ERROR: failed to parse packet %d of the RX buffer content\n", i);
+            return -1;
+        }
+
+        /* downlink with the same modulation, timestamps are set by the JiT benchmark */
+        memset(&txpkt[i], 0, sizeof txpkt[i]);
+        txpkt[i].freq_hz = rxpkt[i].freq_hz;
+        txpkt[i].tx_mode = TIMESTAMPED;
+        txpkt[i].rf_power = 14;
+        txpkt[i].modulation = rxpkt[i].modulation;
+        txpkt[i].bandwidth = rxpkt[i].bandwidth;
+        txpkt[i].datarate = rxpkt[i].datarate;
+        txpkt[i].coderate = rxpkt[i].coderate;
+        txpkt[i].invert_pol = true;
+        txpkt[i].preamble = 8;
+        txpkt[i].size = rxpkt[i].size;
+        memcpy(txpkt[i].payload, rxpkt[i].payload, rxpkt[i].size);
+    }
+    if (mock_spi_rx_level() != 0) {
+        printf("ERROR: %u bytes left in the RX buffer FIFO\n", mock_spi_rx_level());
+        return -1;
+    }
+    dump_pkt_nb = nb_pkt;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    int i, j, x;
+    unsigned int arg_u;
+    unsigned nb_iter = DEFAULT_NB_ITER;
+    const char *dump_path = NULL;
+
+    struct bench_s b;
+    struct timespec start;
+    struct lgw_pkt_tx_s tx;
+    enum jit_pkt_type_e pkt_type;
+    uint32_t time_us, next_us;
+    uint32_t spacing_us = 0;
+    uint8_t nb_pkt;
+    uint64_t gps_ms = 1234567890123;
+    struct timespec utc = {1571000000, 123456000};
+    char json[RXPK_JSON_META_MAX + 400];
+    uint8_t bin[BIN_RXPK_META_SIZE + 256];
+    char b64[400];
+    int idx;
+
+    /* parse command line options */
+    while ((i = getopt(argc, argv, "hn:f:")) != -1) {
+        switch (i) {
+            case 'h':
+                usage();
+                return EXIT_SUCCESS;
+            case 'n':
+                x = sscanf(optarg, "%u", &arg_u);
+                if ((x != 1) || (arg_u == 0)) {
+                    printf("ERROR: argument parsing of -n argument. Use -h to print help\n");
+                    return EXIT_FAILURE;
+                }
+                nb_iter = arg_u;
+                break;
+            case 'f':
+                dump_path = optarg;
+                break;
+            default:
+                printf("ERROR: argument parsing\n");
+                usage();
+                return EXIT_FAILURE;
+        }
+    }
+
+    /* RX buffer content */
+    if (dump_path != NULL) {
+        if (load_dump(dump_path) != 0) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        synth_dump();
+    }
+
+    /* connect the HAL to the mock transport, no need to start the concentrator */
+    if ((lgw_com_register(&mock_spi_com) != LGW_COM_SUCCESS) || (lgw_connect(MOCK_SPI_PATH) != LGW_REG_SUCCESS)) {
+        printf("ERROR: failed to connect to the mock concentrator\n");
+        return EXIT_FAILURE;
+    }
+    context_init();
+    if (dump_check() != 0) {
+        return EXIT_FAILURE;
+    }
+
+    printf("Benchmark: %u iterations over %u packets (%u bytes) from %s\n", nb_iter, dump_pkt_nb, dump_size, (dump_path != NULL) ? dump_path : "synthesized RX buffer");
+    printf("%-22s %10s %12s %8s\n", "name", "ops", "ns/op", "spi/op");
+
+    /* whole RX buffer read from the FIFO, cost shared by its packets */
+    bench_start(&b, "rx_buffer_fetch", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        mock_spi_rx_push(dump, dump_size);
+        rx_buffer_new(&rx_buf);
+        rx_buffer_fetch(&rx_buf);
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    /* packets extracted again from the same fetched content */
+    bench_start(&b, "rx_buffer_pop", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        rx_packet_t pkt;
+        rx_buf.buffer_index = 0;
+        rx_buf.buffer_pkt_nb = (uint8_t)dump_pkt_nb;
+        for (j = 0; j < (int)dump_pkt_nb; j++) {
+            rx_buffer_pop(&rx_buf, &pkt);
+            sink += pkt.rx_crc16_value;
+        }
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    /* lgw_receive path, HAL mutex and RSSI compensation excluded */
+    bench_start(&b, "sx1302_fetch_parse", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        mock_spi_rx_push(dump, dump_size);
+        sx1302_fetch(&nb_pkt);
+        for (j = 0; j < nb_pkt; j++) {
+            sx1302_parse(&ctx, &rxpkt[j]);
+        }
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    bench_start(&b, "lora_payload_crc", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        for (j = 0; j < (int)dump_pkt_nb; j++) {
+            sink += sx1302_lora_payload_crc(rxpkt[j].payload, (uint8_t)rxpkt[j].size);
+        }
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    bench_start(&b, "lgw_time_on_air", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        for (j = 0; j < (int)dump_pkt_nb; j++) {
+            sink += lgw_time_on_air(&txpkt[j]);
+        }
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    bench_start(&b, "bin_to_b64", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        for (j = 0; j < (int)dump_pkt_nb; j++) {
+            sink += bin_to_b64(rxpkt[j].payload, rxpkt[j].size, b64, sizeof b64);
+        }
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    bench_start(&b, "rxpk_json_write", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        for (j = 0; j < (int)dump_pkt_nb; j++) {
+            sink += rxpk_json_write(&rxpkt[j], &utc, &gps_ms, -1, json, sizeof json);
+        }
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    bench_start(&b, "bin_rxpk_write", &start);
+    for (i = 0; i < (int)nb_iter; i++) {
+        for (j = 0; j < (int)dump_pkt_nb; j++) {
+            sink += bin_rxpk_write(&rxpkt[j], &utc, &gps_ms, bin, sizeof bin);
+        }
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    /* steady JiT queue: the head downlink is peeked and dequeued, a new one is enqueued at the tail */
+    for (j = 0; j < (int)dump_pkt_nb; j++) {
+        /* downlinks spaced by more than the longest one, so that they never collide */
+        spacing_us = MAX(spacing_us, lgw_time_on_air(&txpkt[j]) * 1000 + JIT_MIN_LEAD_TIME + TX_MARGIN_DELAY);
+    }
+    jit_queue_init(&jit_queue);
+    time_us = 0;
+    next_us = 1000000;
+    for (j = 0; j < JIT_DEPTH; j++) {
+        txpkt[j % dump_pkt_nb].count_us = next_us;
+        if (jit_enqueue(&jit_queue, time_us, &txpkt[j % dump_pkt_nb], JIT_PKT_TYPE_DOWNLINK_CLASS_A) != JIT_ERROR_OK) {
+            printf("ERROR: failed to fill the JiT queue\n");
+            return EXIT_FAILURE;
+        }
+        next_us += spacing_us;
+    }
+    bench_start(&b, "jit_peek_dequeue_enq", &start);
+    for (i = 0; i < (int)(nb_iter * dump_pkt_nb); i++) {
+        time_us = next_us - (JIT_DEPTH * spacing_us) - (TX_JIT_DELAY / 2);
+        if ((jit_peek(&jit_queue, time_us, &idx) != JIT_ERROR_OK) || (idx < 0) ||
+            (jit_dequeue(&jit_queue, idx, &tx, &pkt_type) != JIT_ERROR_OK)) {
+            printf("ERROR: JiT queue head not due\n");
+            return EXIT_FAILURE;
+        }
+        txpkt[i % dump_pkt_nb].count_us = next_us;
+        if (jit_enqueue(&jit_queue, time_us, &txpkt[i % dump_pkt_nb], JIT_PKT_TYPE_DOWNLINK_CLASS_A) != JIT_ERROR_OK) {
+            printf("ERROR: failed to enqueue downlink %d\n", i);
+            return EXIT_FAILURE;
+        }
+        next_us += spacing_us;
+    }
+    bench_stop(&b, nb_iter * dump_pkt_nb, &start);
+
+    lgw_disconnect();
+
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,318 @@
+/*
+  ______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2019 Semtech
+
+Description:
+    Host-side transport for libloragw, modelling
+    the concentrator registers and memories in RAM and streaming recorded data
+    through the SX1302 RX buffer FIFO.
+    Registered as the "mock" transport of the register layer (loragw_com.h).
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDANCIES --------------------------------------------------------- */
+
+#include <stdint.h>     /* C99 types */
+#include <stdio.h>      /* printf */
+#include <string.h>     /* memset, memcpy */
+
+#include "loragw_spi.h"
+#include "loragw_com.h"
+#include "loragw_reg.h"
+#include "mock_spi.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define MOCK_MEM_SIZE           0x10000 /* address space of each SPI mux target */
+#define MOCK_RX_BUFFER_ADDR     0x4000  /* SX1302 RX buffer, read in FIFO mode */
+#define MOCK_MSG_SIZE_MAX       4096    /* spidev default buffer size */
+
+/* bytes clocked on top of the data, as sent by loragw_spi.c: mux target, address, read dummy byte */
+#define MOCK_CMD_SIZE_WRITE     3
+#define MOCK_CMD_SIZE_READ      4
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+extern const struct lgw_reg_s loregs[LGW_TOTALREGS+1];
+
+static int mock_device = -1; /* passed as the link target, only checked for NULL */
+
+static uint8_t mem[LGW_SPI_MUX_TARGET_NB][MOCK_MEM_SIZE];
+
+static uint8_t rx_fifo[MOCK_SPI_RX_FIFO_SIZE];
+static uint16_t rx_fifo_size = 0;   /* bytes pushed */
+static uint16_t rx_fifo_rd = 0;     /* bytes already read by the host */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void account(uint8_t spi_mux_target, lgw_spi_op_t op, uint32_t bytes) {
+    /* no bus, every message is accounted with a null latency */
+    lgw_com_account(spi_mux_target, op, bytes, 0, false);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint8_t mem_read(uint8_t spi_mux_target, uint16_t address) {
+    uint16_t level;
+
+    /* the RX buffer fill level is computed from the FIFO, it is read-only */
+    if (spi_mux_target == LGW_SPI_MUX_TARGET_SX1302) {
+        level = mock_spi_rx_level();
+        if (address == loregs[SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_MSB_RX_BUFFER_NB_BYTES].addr) {
+            return (uint8_t)(level >> 8);
+        }
+        if (address == loregs[SX1302_REG_RX_TOP_RX_BUFFER_NB_BYTES_LSB_RX_BUFFER_NB_BYTES].addr) {
+            return (uint8_t)(level >> 0);
+        }
+    }
+
+    return mem[spi_mux_target][address];
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void mem_burst_read(uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, bool fifo_mode) {
+    uint16_t nb;
+    int i;
+
+    /* host reading the packets: consume the FIFO, the SX1302 sends zeros once it is empty */
+    if ((spi_mux_target == LGW_SPI_MUX_TARGET_SX1302) && (address == MOCK_RX_BUFFER_ADDR) && (fifo_mode == true)) {
+        nb = mock_spi_rx_level();
+        nb = (size < nb) ? size : nb;
+        memcpy(data, &rx_fifo[rx_fifo_rd], nb);
+        memset(&data[nb], 0, size - nb);
+        rx_fifo_rd += nb;
+        if (rx_fifo_rd == rx_fifo_size) {
+            rx_fifo_rd = 0;
+            rx_fifo_size = 0;
+        }
+        return;
+    }
+
+    for (i = 0; i < size; i++) {
+        data[i] = mem_read(spi_mux_target, (uint16_t)(address + (fifo_mode ? 0 : i)));
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void mem_burst_write(uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size) {
+    int i;
+
+    for (i = 0; i < size; i++) {
+        mem[spi_mux_target][(uint16_t)(address + i)] = data[i];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void mock_spi_reset(void) {
+    memset(mem, 0, sizeof mem);
+    rx_fifo_size = 0;
+    rx_fifo_rd = 0;
+    lgw_com_get_stats(NULL, true);
+
+    /* expected by lgw_connect */
+    mem[LGW_SPI_MUX_TARGET_SX1302][loregs[SX1302_REG_COMMON_VERSION_VERSION].addr] = (uint8_t)loregs[SX1302_REG_COMMON_VERSION_VERSION].dflt;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int mock_spi_rx_push(const uint8_t *data, uint16_t size) {
+    if ((data == NULL) || (size > (MOCK_SPI_RX_FIFO_SIZE - rx_fifo_size))) {
+        return LGW_SPI_ERROR;
+    }
+
+    memcpy(&rx_fifo[rx_fifo_size], data, size);
+    rx_fifo_size += size;
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint16_t mock_spi_rx_level(void) {
+    return rx_fifo_size - rx_fifo_rd;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- TRANSPORT OPERATIONS ------------------------------------------------- */
+
+static int mock_open(const char * path, void **spi_target_ptr) {
+    if ((path == NULL) || (spi_target_ptr == NULL)) {
+        return LGW_SPI_ERROR;
+    }
+
+    mock_spi_reset();
+    *spi_target_ptr = (void *)&mock_device;
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_set_speed(void *spi_target, uint32_t speed_hz) {
+    (void)speed_hz;
+
+    return (spi_target == NULL) ? LGW_SPI_ERROR : LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t mock_get_msg_size_max(void) {
+    return MOCK_MSG_SIZE_MAX;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_close(void *spi_target) {
+    return (spi_target == NULL) ? LGW_SPI_ERROR : LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_w(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_t data) {
+    if ((spi_target == NULL) || (spi_mux_target >= LGW_SPI_MUX_TARGET_NB)) {
+        return LGW_SPI_ERROR;
+    }
+
+    mem_burst_write(spi_mux_target, address, &data, 1);
+    account(spi_mux_target, LGW_SPI_OP_WRITE, MOCK_CMD_SIZE_WRITE + 1);
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_r(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data) {
+    if ((spi_target == NULL) || (spi_mux_target >= LGW_SPI_MUX_TARGET_NB) || (data == NULL)) {
+        return LGW_SPI_ERROR;
+    }
+
+    *data = mem_read(spi_mux_target, address);
+    account(spi_mux_target, LGW_SPI_OP_READ, MOCK_CMD_SIZE_READ + 1);
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_wb(void *spi_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size) {
+    if ((spi_target == NULL) || (spi_mux_target >= LGW_SPI_MUX_TARGET_NB) || (data == NULL) || (size == 0)) {
+        return LGW_SPI_ERROR;
+    }
+
+    mem_burst_write(spi_mux_target, address, data, size);
+    account(spi_mux_target, LGW_SPI_OP_WRITE_BURST, MOCK_CMD_SIZE_WRITE + size);
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_rb(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size) {
+    if ((spi_target == NULL) || (spi_mux_target >= LGW_SPI_MUX_TARGET_NB) || (data == NULL) || (size == 0)) {
+        return LGW_SPI_ERROR;
+    }
+
+    mem_burst_read(spi_mux_target, address, data, size, false);
+    account(spi_mux_target, LGW_SPI_OP_READ_BURST, MOCK_CMD_SIZE_READ + size);
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_wb_chunks(void *spi_target, uint8_t spi_mux_target, uint16_t address, const uint8_t *data, uint16_t size, uint16_t chunk_size) {
+    (void)chunk_size; /* no spidev buffer limit, a single message */
+
+    return mock_wb(spi_target, spi_mux_target, address, data, size);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_rb_chunks(void *spi_target, uint8_t spi_mux_target, uint16_t address, uint8_t *data, uint16_t size, uint16_t chunk_size, bool fifo_mode) {
+    (void)chunk_size; /* no spidev buffer limit, a single message */
+
+    if ((spi_target == NULL) || (spi_mux_target >= LGW_SPI_MUX_TARGET_NB) || (data == NULL) || (size == 0)) {
+        return LGW_SPI_ERROR;
+    }
+
+    mem_burst_read(spi_mux_target, address, data, size, fifo_mode);
+    account(spi_mux_target, LGW_SPI_OP_READ_BURST, MOCK_CMD_SIZE_READ + size);
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_wb_multi(void *spi_target, uint8_t spi_mux_target, const struct lgw_spi_burst_s *bursts, uint16_t nb_bursts) {
+    uint32_t bytes = 0;
+    int i;
+
+    if ((spi_target == NULL) || (spi_mux_target >= LGW_SPI_MUX_TARGET_NB) || (bursts == NULL)) {
+        return LGW_SPI_ERROR;
+    }
+
+    /* one message per LGW_SPI_MSG_BURST_MAX bursts, as the spidev implementation */
+    for (i = 0; i < nb_bursts; i++) {
+        mem_burst_write(spi_mux_target, bursts[i].address, bursts[i].data, bursts[i].size);
+        bytes += MOCK_CMD_SIZE_WRITE + bursts[i].size;
+        if ((((i + 1) % LGW_SPI_MSG_BURST_MAX) == 0) || (i == (nb_bursts - 1))) {
+            account(spi_mux_target, LGW_SPI_OP_WRITE_BURST, bytes);
+            bytes = 0;
+        }
+    }
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int mock_xfer(void *spi_target, lgw_spi_op_t op, const uint8_t *tx_data, uint8_t *rx_data, uint16_t size) {
+    if ((spi_target == NULL) || (tx_data == NULL) || (size == 0)) {
+        return LGW_SPI_ERROR;
+    }
+
+    /* raw radio commands are not modelled, reads return zeros */
+    if (rx_data != NULL) {
+        memset(rx_data, 0, size);
+    }
+    account(tx_data[0], op, size);
+
+    return LGW_SPI_SUCCESS;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- TRANSPORT DEFINITION ------------------------------------------------- */
+
+const struct lgw_com_s mock_spi_com = {
+    .name = "mock",
+    .simulated = true,
+    .open = mock_open,
+    .close = mock_close,
+    .set_speed = mock_set_speed,
+    .get_msg_size_max = mock_get_msg_size_max,
+    .w = mock_w,
+    .r = mock_r,
+    .wb = mock_wb,
+    .rb = mock_rb,
+    .wb_chunks = mock_wb_chunks,
+    .rb_chunks = mock_rb_chunks,
+    .wb_multi = mock_wb_multi,
+    .xfer = mock_xfer
+};
+
+/* --- EOF ------------------------------------------------------------------ */
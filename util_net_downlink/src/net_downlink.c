@@ -10,6 +10,8 @@
  Description:
     Network packet sender, sends UDP packets to a running packet forwarder
     Network packet receiver, receives UDP packets from a running packet forwarder.
+    Load generator, sends downlinks at a target rate and collects TX_ACK statistics.
+    Uplink logger, streams the received rxpk to CSV or binary files.
 
  License: Revised BSD License, see LICENSE.TXT file include in the project
  */
@@ -35,6 +37,7 @@
 #include <stdlib.h>     /* EXIT_* */
 #include <unistd.h>     /* usleep */
 #include <stdbool.h>    /* bool type */
+#include <math.h>       /* log */
 
 #include <string.h>     /* memset */
 #include <time.h>       /* time, clock_gettime, strftime, gmtime, clock_nanosleep*/
@@ -82,6 +85,30 @@
 #define DEFAULT_LORA_PREAMBLE_SIZE  8       /* LoRa preamble size */
 #define DEFAULT_PAYLOAD_SIZE        4       /* payload size, bytes */
 #define PUSH_TIMEOUT_MS             100
+#define DEFAULT_RX1_DELAY_S         1       /* class A RX1 window delay, RX2 opens 1 second later */
+#define RX2_DELAY_US                1000000 /* delay between RX1 and RX2 windows */
+
+#define LOAD_TOKEN_NB               65536   /* a downlink is matched to its TX_ACK by the 16-bit token */
+#define LOAD_TEMPLATE_SIZE          512     /* pre-serialized txpk, without the per-packet fields */
+#define LOAD_REPORT_PERIOD_S        10      /* load generator statistics are displayed every period */
+#define LOAD_DRAIN_MS               2000    /* time given to the last TX_ACKs to arrive at the end of a run */
+
+#define DEFAULT_ACK_DELAY_MS        30      /* artificial latency of PUSH_ACK/PULL_ACK */
+#define LOG_BUFFER_SIZE             (1 << 20) /* uplink log file buffer, written to disk on flush or when full */
+#define LOG_FLUSH_PERIOD_S          1
+#define LOG_LINE_SIZE               1024    /* a CSV row or a binary record, 255 bytes payload included */
+
+/*
+Binary uplink log format, all fields little endian:
+    header:  "NDLOGBIN" (8 bytes), format version (1 byte)
+    records: record size without this field (2 bytes), gateway MAC (8 bytes),
+             tmst (4 bytes), freq in Hz (4 bytes), chan, rfch, mid, stat (1 byte each),
+             modu (1 byte, 0: LoRa, 1: FSK), datr (4 bytes, SF for LoRa, bitrate for FSK),
+             bw in kHz (2 bytes, 0 for FSK), codr (1 byte, 5..8 for 4/5..4/8, 0 otherwise),
+             rssic, rssis, lsnr (2 bytes each, signed, 0.1 dB), size (1 byte), payload
+*/
+#define LOG_BIN_MAGIC               "NDLOGBIN"
+#define LOG_BIN_VERSION             1
 
 /* -------------------------------------------------------------------------- */
 /* --- CUSTOM TYPES --------------------------------------------------------- */
@@ -96,6 +123,78 @@ typedef enum
     PKT_TX_ACK = 5
 } pkt_type_t;
 
+typedef enum
+{
+    ARRIVAL_PERIODIC = 0,
+    ARRIVAL_POISSON,
+    ARRIVAL_BURST
+} arrival_t;
+
+typedef enum
+{
+    WINDOW_IMME = 0,    /* class C, sent immediately */
+    WINDOW_RX1,         /* class A, RX1 window of a virtual uplink received when the downlink is sent */
+    WINDOW_RX2,         /* class A, RX2 window of the same virtual uplink */
+    WINDOW_NB
+} window_t;
+
+typedef enum
+{
+    ACK_NONE = 0,
+    ACK_COLLISION_PACKET,
+    ACK_TOO_LATE,
+    ACK_TOO_EARLY,
+    ACK_COLLISION_BEACON,
+    ACK_TX_FREQ,
+    ACK_TX_POWER,       /* warning only, the downlink is sent */
+    ACK_GPS_UNLOCKED,
+    ACK_UNKNOWN,
+    ACK_NB
+} ack_status_t;
+
+typedef struct
+{
+    uint32_t    nb_sent[WINDOW_NB];
+    uint32_t    nb_ack[ACK_NB];
+    uint32_t    nb_ack_unexpected; /* TX_ACK matching no pending downlink */
+    uint64_t    latency_sum_us; /* PULL_RESP sent to TX_ACK received */
+    uint32_t    latency_min_us;
+    uint32_t    latency_max_us;
+    uint32_t    lag_max_us; /* worst delay of a send on its schedule, the generator itself saturates */
+    uint64_t    last_sent_us;
+} load_stats_t;
+
+typedef enum
+{
+    LOG_CSV = 0,
+    LOG_BIN
+} log_format_t;
+
+typedef struct
+{
+    uint32_t    tmst;
+    uint8_t     chan;
+    uint8_t     rfch;
+    double      freq;
+    uint8_t     mid;
+    int8_t      stat;
+    bool        lora;
+    uint32_t    datr; /* LoRa: spreading factor, FSK: bitrate */
+    uint16_t    bw_khz;
+    char        codr[8];
+    double      rssic;
+    double      rssis;
+    double      lsnr;
+    uint8_t     size;
+    uint8_t     payload[255];
+} log_rxpk_t;
+
+typedef struct
+{
+    const char *    p;
+    const char *    end;
+} json_cursor_t;
+
 typedef struct
 {
     uint32_t    nb_loop[2]; /* number of downlinks to be sent on each RF chain */
@@ -116,6 +215,11 @@ typedef struct
     uint16_t    preamb_size[2];
     uint8_t     pl_size[2];
     bool        ipol;
+    double      load_rate; /* downlinks per second, 0 if the load generator is not used */
+    arrival_t   load_arrival;
+    uint16_t    load_burst; /* number of downlinks sent back to back in ARRIVAL_BURST */
+    uint8_t     load_window[WINDOW_NB]; /* share of the downlinks targeting each window, percent */
+    uint32_t    rx1_delay_us;
 } thread_params_t;
 
 /* -------------------------------------------------------------------------- */
@@ -132,6 +236,27 @@ static socklen_t addr_len_down = sizeof dist_addr_down;
 
 /* Thread variables */
 static pthread_mutex_t mx_sockaddr = PTHREAD_MUTEX_INITIALIZER; /* control access to the sockaddr info */
+static pthread_mutex_t mx_load = PTHREAD_MUTEX_INITIALIZER; /* control access to the load statistics and counter reference */
+
+/* Load generator variables */
+static const char * ack_status_name[ACK_NB] = {"NONE", "COLLISION_PACKET", "TOO_LATE", "TOO_EARLY", "COLLISION_BEACON", "TX_FREQ", "TX_POWER", "GPS_UNLOCKED", "UNKNOWN"};
+static const char * window_name[WINDOW_NB] = {"imme", "rx1", "rx2"};
+static load_stats_t load_stats;
+static uint64_t load_sent_us[LOAD_TOKEN_NB]; /* send time of the pending downlinks, 0 once acknowledged */
+static bool counter_ref_valid = false;
+static uint32_t counter_ref_tmst; /* concentrator counter of the latest uplink */
+static uint64_t counter_ref_us; /* host time at which that uplink was received */
+
+/* Uplink logging variables */
+static const char * log_fname = NULL; /* pointer to a string we won't touch */
+static FILE * log_file = NULL;
+static log_format_t log_format = LOG_CSV;
+static bool log_header_pending = false;
+static uint64_t log_size = 0; /* bytes written to the current file */
+static uint64_t log_rotate_size = 0; /* bytes, 0 to disable rotation on size */
+static uint32_t log_rotate_period = 0; /* seconds, 0 to disable rotation on time */
+static time_t log_open_time;
+static time_t log_flush_time;
 
 /* -------------------------------------------------------------------------- */
 /* --- SUBFUNCTIONS DECLARATION --------------------------------------------- */
@@ -140,7 +265,15 @@ static void sig_handler( int sigio );
 static void usage( void );
 static void * thread_down_rf0( const void * arg );
 static void * thread_down_rf1( const void * arg );
-static void log_csv(FILE * file, uint8_t * buf);
+static void * thread_load( const void * arg );
+static int log_open( void );
+static void log_close( void );
+static void log_tick( void );
+static int log_push_data( uint64_t gw_mac, const uint8_t * buf, int size );
+static uint64_t time_us( void );
+static void update_counter_ref( const uint8_t * buf );
+static void load_ack( uint8_t token_h, uint8_t token_l, const uint8_t * buf, int size );
+static void load_report( uint64_t start_us );
 
 /* -------------------------------------------------------------------------- */
 /* --- MAIN FUNCTION -------------------------------------------------------- */
@@ -151,6 +284,7 @@ int main( int argc, char **argv )
     static struct sigaction sigact; /* SIGQUIT&SIGINT&SIGTERM signal handling */
     unsigned arg_u = 0;
     unsigned arg_u2 = 0;
+    unsigned arg_u3 = 0;
     double arg_f = 0.0;
     double arg_f_step = 0.0;
     double arg_f2 = 0.0;
@@ -158,13 +292,9 @@ int main( int argc, char **argv )
     int arg_i2 = 0;
     char arg_s[8];
     char arg_s2[8];
+    char arg_law[16];
     bool parse_err = false;
 
-    /* Logging file variables */
-    const char * log_fname = NULL; /* pointer to a string we won't touch */
-    FILE * log_file = NULL;
-    bool is_first = true;
-
     /* Server socket creation */
     int sock; /* socket file descriptor */
     struct addrinfo hints;
@@ -182,11 +312,14 @@ int main( int argc, char **argv )
     char serv_addr[64] = "127.0.0.1";
     char serv_port_fwd[8] = "1700";
     struct timeval push_timeout_half = {0, (PUSH_TIMEOUT_MS * 500)};
+    struct timeval log_timeout = {LOG_FLUSH_PERIOD_S, 0};
+    unsigned ack_delay_ms = DEFAULT_ACK_DELAY_MS;
 
     /* Variables for receiving and sending packets */
     uint8_t databuf_up[32768];
     uint8_t databuf_ack[4];
     int byte_nb;
+    int up_nb;
 
     /* Variables for protocol management */
     uint32_t raw_mac_h; /* Most Significant Nibble, network order */
@@ -211,15 +344,21 @@ int main( int argc, char **argv )
         .pl_size = {DEFAULT_PAYLOAD_SIZE, DEFAULT_PAYLOAD_SIZE},
         .freq_step = 0.2,
         .freq_nb = 1,
-        .ipol = false
+        .ipol = false,
+        .load_rate = 0.0,
+        .load_arrival = ARRIVAL_PERIODIC,
+        .load_burst = 1,
+        .load_window = {100, 0, 0},
+        .rx1_delay_us = DEFAULT_RX1_DELAY_S * 1000000
     };
 
     /* Threads ID */
     pthread_t thrid_down_rf0;
     pthread_t thrid_down_rf1;
+    pthread_t thrid_load;
 
     /* Parse command line options */
-    while( ( i = getopt( argc, argv, "b:c:f:hij:l:p:r:s:t:x:z:A:F:P:m:d:q:" ) ) != -1 )
+    while( ( i = getopt( argc, argv, "a:b:c:f:hij:l:o:p:r:s:t:w:x:y:z:A:D:F:P:R:S:T:m:d:q:" ) ) != -1 )
     {
         switch( i )
         {
@@ -232,6 +371,65 @@ int main( int argc, char **argv )
                 log_fname = optarg;
                 break;
 
+            case 'o': /* -o <string>  uplink log format */
+                if( strcmp( optarg, "csv" ) == 0 )
+                {
+                    log_format = LOG_CSV;
+                }
+                else if( strcmp( optarg, "bin" ) == 0 )
+                {
+                    log_format = LOG_BIN;
+                }
+                else
+                {
+                    printf( "ERROR: argument parsing of -o argument\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'S': /* -S <uint>  uplink log rotation size, MB */
+                j = sscanf( optarg, "%u", &arg_u );
+                if( (j != 1) || (arg_u < 1) )
+                {
+                    printf( "ERROR: argument parsing of -S argument\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                else
+                {
+                    log_rotate_size = (uint64_t)arg_u << 20;
+                }
+                break;
+
+            case 'T': /* -T <uint>  uplink log rotation period, seconds */
+                j = sscanf( optarg, "%u", &arg_u );
+                if( (j != 1) || (arg_u < 1) )
+                {
+                    printf( "ERROR: argument parsing of -T argument\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                else
+                {
+                    log_rotate_period = arg_u;
+                }
+                break;
+
+            case 'y': /* -y <uint>  PUSH_ACK/PULL_ACK artificial latency, ms */
+                j = sscanf( optarg, "%u", &arg_u );
+                if( (j != 1) || (arg_u > 10000) )
+                {
+                    printf( "ERROR: argument parsing of -y argument\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                else
+                {
+                    ack_delay_ms = arg_u;
+                }
+                break;
+
             case 'P':
                 port_arg = optarg;
                 break;
@@ -577,6 +775,74 @@ int main( int argc, char **argv )
                 }
                 break;
 
+            case 'R': /* -R <float>  load generator rate, downlinks per second */
+                j = sscanf( optarg, "%lf", &arg_f );
+                if( (j != 1) || (arg_f <= 0.0) || (arg_f > 100000.0) )
+                {
+                    printf( "ERROR: argument parsing of -R argument\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                else
+                {
+                    thread_params.load_rate = arg_f;
+                }
+                break;
+
+            case 'a': /* -a <string>[:<uint>]  load generator arrival law */
+                arg_u = 1;
+                j = sscanf( optarg, "%15[^:]:%u", arg_law, &arg_u );
+                if( (j >= 1) && (strcmp( arg_law, "periodic" ) == 0) )
+                {
+                    thread_params.load_arrival = ARRIVAL_PERIODIC;
+                }
+                else if( (j >= 1) && (strcmp( arg_law, "poisson" ) == 0) )
+                {
+                    thread_params.load_arrival = ARRIVAL_POISSON;
+                }
+                else if( (j == 2) && (strcmp( arg_law, "burst" ) == 0) && (arg_u >= 1) && (arg_u <= 1000) )
+                {
+                    thread_params.load_arrival = ARRIVAL_BURST;
+                    thread_params.load_burst = (uint16_t)arg_u;
+                }
+                else
+                {
+                    printf( "ERROR: argument parsing of -a argument\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'w': /* -w <uint,uint,uint>  share of immediate, RX1 and RX2 downlinks, percent */
+                j = sscanf( optarg, "%u,%u,%u", &arg_u, &arg_u2, &arg_u3 );
+                if( (j != 3) || (arg_u > 100) || (arg_u2 > 100) || (arg_u3 > 100) || ((arg_u + arg_u2 + arg_u3) != 100) )
+                {
+                    printf( "ERROR: argument parsing of -w argument, shares must add up to 100\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                else
+                {
+                    thread_params.load_window[WINDOW_IMME] = (uint8_t)arg_u;
+                    thread_params.load_window[WINDOW_RX1] = (uint8_t)arg_u2;
+                    thread_params.load_window[WINDOW_RX2] = (uint8_t)arg_u3;
+                }
+                break;
+
+            case 'D': /* -D <uint>  RX1 delay in seconds */
+                j = sscanf( optarg, "%u", &arg_u );
+                if( (j != 1) || (arg_u < 1) || (arg_u > 15) )
+                {
+                    printf( "ERROR: argument parsing of -D argument\n" );
+                    usage( );
+                    return EXIT_FAILURE;
+                }
+                else
+                {
+                    thread_params.rx1_delay_us = arg_u * 1000000;
+                }
+                break;
+
             default:
                 printf( "ERROR: argument parsing options, use -h option for help\n" );
                 usage( );
@@ -593,7 +859,7 @@ int main( int argc, char **argv )
     }
 
     /* Start message */
-    printf( "+++ Start of network uplink logger (30ms delay) +++\n" );
+    printf( "+++ Start of network uplink logger (%ums delay) +++\n", ack_delay_ms );
 
     /* Configure socket for uplink forwarding if required */
     if( fwd_uplink == true )
@@ -706,10 +972,16 @@ int main( int argc, char **argv )
     /* Open log file */
     if( log_fname )
     {
-        log_file = fopen( log_fname, "w+" ); /* create log file, overwrite if file already exist */
-        if( log_file == NULL )
+        if( log_open( ) != 0 )
+        {
+            return EXIT_FAILURE;
+        }
+
+        /* Wake up periodically to flush the log even without traffic */
+        x = setsockopt( sock, SOL_SOCKET, SO_RCVTIMEO, (void *)&log_timeout, sizeof log_timeout );
+        if( x != 0 )
         {
-            printf( "ERROR: impossible to create log file %s\n", log_fname );
+            printf( "ERROR: setsockopt returned %s\n", strerror( errno ) );
             return EXIT_FAILURE;
         }
     }
@@ -722,29 +994,53 @@ int main( int argc, char **argv )
     sigaction( SIGINT, &sigact, NULL );
     sigaction( SIGTERM, &sigact, NULL );
 
-    i = pthread_create( &thrid_down_rf0, NULL, (void * (*)( void * ))thread_down_rf0, (void*)&thread_params );
-    if( i != 0 )
+    if( thread_params.load_rate > 0.0 )
     {
-        printf( "ERROR: [main] impossible to create downstream thread\n" );
-        return EXIT_FAILURE;
+        i = pthread_create( &thrid_load, NULL, (void * (*)( void * ))thread_load, (void*)&thread_params );
+        if( i != 0 )
+        {
+            printf( "ERROR: [main] impossible to create load generator thread\n" );
+            return EXIT_FAILURE;
+        }
     }
-
-    i = pthread_create( &thrid_down_rf1, NULL, (void * (*)( void * ))thread_down_rf1, (void*)&thread_params );
-    if( i != 0 )
+    else
     {
-        printf( "ERROR: [main] impossible to create downstream thread for RF1\n" );
-        return EXIT_FAILURE;
+        i = pthread_create( &thrid_down_rf0, NULL, (void * (*)( void * ))thread_down_rf0, (void*)&thread_params );
+        if( i != 0 )
+        {
+            printf( "ERROR: [main] impossible to create downstream thread\n" );
+            return EXIT_FAILURE;
+        }
+
+        i = pthread_create( &thrid_down_rf1, NULL, (void * (*)( void * ))thread_down_rf1, (void*)&thread_params );
+        if( i != 0 )
+        {
+            printf( "ERROR: [main] impossible to create downstream thread for RF1\n" );
+            return EXIT_FAILURE;
+        }
     }
 
     /* Loop until user quits */
     while( ( quit_sig != 1 ) && ( exit_sig != 1 ) )
     {
         /* Wait to receive a packet */
-        memset( databuf_up, 0, 4096 );
-        byte_nb = recvfrom( sock, databuf_up, sizeof databuf_up, 0, (struct sockaddr *)&dist_addr, &addr_len );
+        log_tick( );
+        byte_nb = recvfrom( sock, databuf_up, sizeof databuf_up - 1, 0, (struct sockaddr *)&dist_addr, &addr_len );
         if( byte_nb == -1 )
         {
-            printf( "ERROR: recvfrom returned %s \n", strerror( errno ) );
+            if( (errno != EAGAIN) && (errno != EWOULDBLOCK) )
+            {
+                printf( "ERROR: recvfrom returned %s \n", strerror( errno ) );
+            }
+            continue;
+        }
+        databuf_up[byte_nb] = 0; /* terminate the JSON string */
+        up_nb = byte_nb;
+
+        /* Account load generator TX_ACKs silently, not to slow down the reception */
+        if( (thread_params.load_rate > 0.0) && (byte_nb >= 12) && (databuf_up[0] == PROTOCOL_VERSION) && (databuf_up[3] == PKT_TX_ACK) )
+        {
+            load_ack( databuf_up[1], databuf_up[2], &databuf_up[12], byte_nb - 12 );
             continue;
         }
 
@@ -783,6 +1079,10 @@ int main( int argc, char **argv )
                 printf( ", PUSH_DATA from gateway 0x%08X%08X\n", (uint32_t)( gw_mac >> 32 ), (uint32_t)( gw_mac & 0xFFFFFFFF ) );
                 ack_command = PKT_PUSH_ACK;
                 no_ack = false;
+                if( thread_params.load_rate > 0.0 )
+                {
+                    update_counter_ref( &databuf_up[12] );
+                }
                 if( fwd_uplink == false )
                 {
                     printf( "<-  pkt out, PUSH_ACK for host %s (port %s)", host_name, port_name );
@@ -823,7 +1123,10 @@ int main( int argc, char **argv )
         }
 
         /* Add some artificial latency */
-        usleep( 30000 ); /* 30 ms */
+        if( ack_delay_ms > 0 )
+        {
+            usleep( ack_delay_ms * 1000 );
+        }
 
         /* Send acknowledge and check return value */
         if( no_ack == false )
@@ -845,271 +1148,571 @@ int main( int argc, char **argv )
         }
 
         /* Log uplinks to file */
-        if( databuf_up[3] == PKT_PUSH_DATA )
+        if( (databuf_up[3] == PKT_PUSH_DATA) && (log_fname != NULL) )
         {
-            if( log_fname != NULL )
-            {
-                if( is_first == true )
-                {
-                    fprintf(log_file, "tmst,chan,rfch,freq,mid,stat,modu,datr,bw,codr,rssic,rssis,lsnr,size,data\n");
-                    is_first = false;
-                }
-                log_csv( log_file, &databuf_up[12] );
-            }
+            log_push_data( gw_mac, &databuf_up[12], up_nb - 12 );
         }
     }
 
     /* Wait for downstream thread to finish */
-    pthread_join( thrid_down_rf0, NULL );
-    pthread_join( thrid_down_rf1, NULL );
+    if( thread_params.load_rate > 0.0 )
+    {
+        pthread_join( thrid_load, NULL );
+    }
+    else
+    {
+        pthread_join( thrid_down_rf0, NULL );
+        pthread_join( thrid_down_rf1, NULL );
+    }
 
     printf( "INFO: Exiting uplink logger\n" );
 
     /* Close log file */
-    if( (log_fname != NULL) && (log_file != NULL) )
-    {
-        fclose( log_file );
-        log_file = NULL;
-    }
+    log_close( );
 
     return 0;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-static void log_csv(FILE * file, uint8_t * buf)
+static void js_skip_ws( json_cursor_t * c )
 {
-    JSON_Object * rxpk = NULL;
-    JSON_Object * root = NULL;
-    JSON_Array * rxpk_array = NULL;
-    JSON_Value * root_val = NULL;
-    JSON_Value * val = NULL;
-    int i, j, rxpk_nb, x;
-    const char * str; /* pointer to sub-strings in the JSON data */
-    short x0, x1;
-    uint8_t payload[255];
-    uint8_t size;
-
-    if( file == NULL )
+    while( (c->p < c->end) && ((*c->p == ' ') || (*c->p == '\t') || (*c->p == '\n') || (*c->p == '\r')) )
     {
-        printf("ERROR: no file opened\n");
-        return;
+        c->p++;
     }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-    /* Parse JSON string */
-    root_val = json_parse_string( (const char *)buf ); /* JSON offset */
-    root = json_value_get_object( root_val );
-    if( root == NULL )
+static bool js_expect( json_cursor_t * c, char ch )
+{
+    js_skip_ws( c );
+    if( (c->p < c->end) && (*c->p == ch) )
     {
-        printf( "ERROR: not a valid JSON string\n" );
-        json_value_free( root_val );
-        return;
+        c->p++;
+        return true;
     }
+    return false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-    /* Get all packets from array */
-    rxpk_array = json_object_get_array( root, "rxpk" );
-    if( rxpk_array != NULL)
+static bool js_string( json_cursor_t * c, const char ** str, int * len )
+{
+    if( js_expect( c, '"' ) == false )
     {
-        rxpk_nb = (int)json_array_get_count( rxpk_array );
-        for( i = 0; i < rxpk_nb; i++ )
+        return false;
+    }
+    *str = c->p;
+    while( (c->p < c->end) && (*c->p != '"') )
+    {
+        if( *c->p == '\\' )
         {
-            rxpk = json_array_get_object( rxpk_array, i );
-            if( rxpk == NULL)
-            {
-                printf("ERROR: failed to get rxpk object\n");
-                json_value_free( root_val );
-                return;
-            }
-
-            /* Parse rxpk fields */
-            val = json_object_get_value( rxpk, "tmst" );
-            if( json_value_get_type( val ) != JSONNumber )
-            {
-                printf( "ERROR: wrong type for tmst\n" );
-                json_value_free( root_val );
-                return;
-            }
-            fprintf(file, "%u", (uint32_t)json_value_get_number( val ) );
-
-            val = json_object_get_value( rxpk, "chan" );
-            if( json_value_get_type( val ) != JSONNumber )
-            {
-                printf( "ERROR: wrong type for chan\n" );
-                json_value_free( root_val );
-                return;
-            }
-            fprintf(file, ",%u", (uint8_t)json_value_get_number( val ) );
-
-            val = json_object_get_value( rxpk, "rfch" );
-            if( json_value_get_type( val ) != JSONNumber )
-            {
-                printf( "ERROR: wrong type for rfch\n" );
-                json_value_free( root_val );
-                return;
-            }
-            fprintf(file, ",%u", (uint8_t)json_value_get_number( val ) );
-
-            val = json_object_get_value( rxpk, "freq" );
-            if( json_value_get_type( val ) != JSONNumber )
-            {
-                printf( "ERROR: wrong type for rfch\n" );
-                json_value_free( root_val );
-                return;
-            }
-            fprintf(file, ",%f", json_value_get_number( val ) );
-
-            val = json_object_get_value( rxpk, "mid" );
-            if( json_value_get_type( val ) != JSONNumber )
-            {
-                printf( "ERROR: wrong type for mid\n" );
-                json_value_free( root_val );
-                return;
-            }
-            fprintf(file, ",%u", (uint8_t)json_value_get_number( val ) );
-
-            val = json_object_get_value( rxpk, "stat" );
-            if( json_value_get_type( val ) != JSONNumber )
-            {
-                printf( "ERROR: wrong type for stat\n" );
-                json_value_free( root_val );
-                return;
-            }
-            fprintf(file, ",%d", (int8_t)json_value_get_number( val ) );
-
-            val = json_object_get_value( rxpk, "modu" );
-            if( json_value_get_type( val ) != JSONString )
-            {
-                printf( "ERROR: wrong type for stat\n" );
-                json_value_free( root_val );
-                return;
-            }
-            str = json_value_get_string( val );
-            fprintf(file, ",%s", str );
-            if( strcmp( str, "LORA" ) == 0 )
-            {
-                val = json_object_get_value( rxpk, "datr" );
-                if( json_value_get_type( val ) != JSONString )
-                {
-                    printf( "ERROR: wrong type for datr\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                str = json_value_get_string( val );
-                x = sscanf( str, "SF%2hdBW%3hd", &x0, &x1 );
-                if( x != 2 )
-                {
-                    printf( "ERROR: format error in \"rxpk.datr\"\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                fprintf(file, ",%d,%d", x0, x1 );
-
-                val = json_object_get_value( rxpk, "codr" );
-                if( json_value_get_type( val ) != JSONString )
-                {
-                    printf( "ERROR: wrong type for codr\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                fprintf(file, ",%s", json_value_get_string( val ) );
+            c->p++; /* escaped character */
+        }
+        c->p++;
+    }
+    if( c->p >= c->end )
+    {
+        return false;
+    }
+    *len = (int)(c->p - *str);
+    c->p++;
+    return true;
+}
 
-                val = json_object_get_value( rxpk, "rssi" );
-                if( json_value_get_type( val ) != JSONNumber )
-                {
-                    printf( "ERROR: wrong type for rssic\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                fprintf(file, ",%.1f", json_value_get_number( val ) );
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-                val = json_object_get_value( rxpk, "rssis" );
-                if( json_value_get_type( val ) != JSONNumber )
-                {
-                    printf( "ERROR: wrong type for rssis\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                fprintf(file, ",%.1f", json_value_get_number( val ) );
+static bool js_number( json_cursor_t * c, double * val )
+{
+    char * num_end;
 
-                val = json_object_get_value( rxpk, "lsnr" );
-                if( json_value_get_type( val ) != JSONNumber )
-                {
-                    printf( "ERROR: wrong type for lsnr\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                fprintf(file, ",%.1f", json_value_get_number( val ) );
-            }
-            else if( strcmp( str, "FSK" ) == 0 )
-            {
-                val = json_object_get_value( rxpk, "datr" );
-                if( json_value_get_type( val ) != JSONNumber )
-                {
-                    printf( "ERROR: wrong type for datr\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                fprintf(file, ",%d,,", (uint32_t)json_value_get_number( val ) ); /* bw,codr fields are left empty */
+    js_skip_ws( c );
+    *val = strtod( c->p, &num_end ); /* the datagram is null terminated */
+    if( (num_end == c->p) || (num_end > c->end) )
+    {
+        return false;
+    }
+    c->p = num_end;
+    return true;
+}
 
-                val = json_object_get_value( rxpk, "rssi" );
-                if( json_value_get_type( val ) != JSONNumber )
-                {
-                    printf( "ERROR: wrong type for rssic\n" );
-                    json_value_free( root_val );
-                    return;
-                }
-                fprintf(file, ",%.1f,,", json_value_get_number( val ) ); /* rssis,lsnr fields are left empty */
-            }
-            else
-            {
-                printf("ERROR: unknown modulation %s\n", str);
-                json_value_free( root_val );
-                return;
-            }
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-            val = json_object_get_value( rxpk, "size" );
-            if( json_value_get_type( val ) != JSONNumber )
-            {
-                printf( "ERROR: wrong type for size\n" );
-                json_value_free( root_val );
-                return;
-            }
-            size = (uint8_t)json_value_get_number( val );
-            fprintf(file, ",%u", size );
+static bool js_skip_value( json_cursor_t * c )
+{
+    const char * str;
+    int len;
+    int depth = 0;
 
-            val = json_object_get_value( rxpk, "data" );
-            if( json_value_get_type( val ) != JSONString )
-            {
-                printf( "ERROR: wrong type for data\n" );
-                json_value_free( root_val );
-                return;
-            }
-            str = json_value_get_string( val );
-            x = b64_to_bin( str, strlen( str ), payload, sizeof payload );
-            if( x != size )
-            {
-                printf( "ERROR: mismatch between .size and .data size once converter to binary\n" );
-                json_value_free( root_val );
-                return;
-            }
-            fprintf(file, "," );
-            for( j = 0; j < size; j++ )
+    js_skip_ws( c );
+    if( c->p >= c->end )
+    {
+        return false;
+    }
+    if( *c->p == '"' )
+    {
+        return js_string( c, &str, &len );
+    }
+    if( (*c->p != '{') && (*c->p != '[') )
+    {
+        /* number or literal */
+        while( (c->p < c->end) && (*c->p != ',') && (*c->p != '}') && (*c->p != ']') )
+        {
+            c->p++;
+        }
+        return true;
+    }
+    /* object or array, only their boundaries matter */
+    while( c->p < c->end )
+    {
+        if( *c->p == '"' )
+        {
+            if( js_string( c, &str, &len ) == false )
             {
-                fprintf(file, "%02x", payload[j] );
+                return false;
             }
-
-            /* End line */
-            fprintf(file, "\n" );
+            continue;
+        }
+        if( (*c->p == '{') || (*c->p == '[') )
+        {
+            depth++;
+        }
+        else if( (*c->p == '}') || (*c->p == ']') )
+        {
+            depth--;
+        }
+        c->p++;
+        if( depth == 0 )
+        {
+            return true;
         }
     }
-
-    fflush(file);
-    json_value_free( root_val );
+    return false;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-static void usage( void )
+static bool js_is( const char * str, int len, const char * name )
+{
+    return ((int)strlen( name ) == len) && (memcmp( str, name, len ) == 0);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/**
+@brief Parse one rxpk object in a single pass, without building a JSON tree
+@param c cursor on the object
+@param pkt parsed fields
+@return 0 if the packet has all the fields to be logged, -1 otherwise (the cursor is then not usable)
+*/
+static int log_parse_rxpk( json_cursor_t * c, log_rxpk_t * pkt )
+{
+    const char * key;
+    const char * str;
+    int key_len, len, x;
+    double val;
+    short x0, x1;
+    int data_len = -1;
+    bool ok = true;
+    uint32_t found = 0; /* one bit per mandatory field */
+
+    memset( pkt, 0, sizeof *pkt );
+    if( js_expect( c, '{' ) == false )
+    {
+        return -1;
+    }
+    do
+    {
+        if( (js_string( c, &key, &key_len ) == false) || (js_expect( c, ':' ) == false) )
+        {
+            return -1;
+        }
+        js_skip_ws( c );
+        if( js_is( key, key_len, "tmst" ) )
+        {
+            ok = js_number( c, &val );
+            pkt->tmst = (uint32_t)val;
+            found |= 0x001;
+        }
+        else if( js_is( key, key_len, "chan" ) )
+        {
+            ok = js_number( c, &val );
+            pkt->chan = (uint8_t)val;
+            found |= 0x002;
+        }
+        else if( js_is( key, key_len, "rfch" ) )
+        {
+            ok = js_number( c, &val );
+            pkt->rfch = (uint8_t)val;
+            found |= 0x004;
+        }
+        else if( js_is( key, key_len, "freq" ) )
+        {
+            ok = js_number( c, &pkt->freq );
+            found |= 0x008;
+        }
+        else if( js_is( key, key_len, "mid" ) )
+        {
+            ok = js_number( c, &val );
+            pkt->mid = (uint8_t)val;
+            found |= 0x010;
+        }
+        else if( js_is( key, key_len, "stat" ) )
+        {
+            ok = js_number( c, &val );
+            pkt->stat = (int8_t)val;
+            found |= 0x020;
+        }
+        else if( js_is( key, key_len, "modu" ) )
+        {
+            ok = js_string( c, &str, &len );
+            pkt->lora = js_is( str, len, "LORA" );
+            ok = ok && (pkt->lora || js_is( str, len, "FSK" ));
+            found |= 0x040;
+        }
+        else if( js_is( key, key_len, "datr" ) && (*c->p == '"') )
+        {
+            ok = js_string( c, &str, &len );
+            x = sscanf( str, "SF%2hdBW%3hd", &x0, &x1 );
+            ok = ok && (x == 2);
+            pkt->datr = (uint32_t)x0;
+            pkt->bw_khz = (uint16_t)x1;
+            found |= 0x080;
+        }
+        else if( js_is( key, key_len, "datr" ) )
+        {
+            ok = js_number( c, &val );
+            pkt->datr = (uint32_t)val;
+            found |= 0x080;
+        }
+        else if( js_is( key, key_len, "codr" ) )
+        {
+            ok = js_string( c, &str, &len ) && (len < (int)sizeof pkt->codr);
+            if( ok )
+            {
+                memcpy( pkt->codr, str, len );
+            }
+            found |= 0x100;
+        }
+        else if( js_is( key, key_len, "rssi" ) )
+        {
+            ok = js_number( c, &pkt->rssic );
+            found |= 0x200;
+        }
+        else if( js_is( key, key_len, "rssis" ) )
+        {
+            ok = js_number( c, &pkt->rssis );
+            found |= 0x400;
+        }
+        else if( js_is( key, key_len, "lsnr" ) )
+        {
+            ok = js_number( c, &pkt->lsnr );
+            found |= 0x800;
+        }
+        else if( js_is( key, key_len, "size" ) )
+        {
+            ok = js_number( c, &val );
+            pkt->size = (uint8_t)val;
+            found |= 0x1000;
+        }
+        else if( js_is( key, key_len, "data" ) )
+        {
+            ok = js_string( c, &str, &len );
+            data_len = ok ? b64_to_bin( str, len, pkt->payload, sizeof pkt->payload ) : -1;
+            ok = ok && (data_len >= 0);
+            found |= 0x2000;
+        }
+        else
+        {
+            ok = js_skip_value( c );
+        }
+        if( ok == false )
+        {
+            printf( "ERROR: wrong type or format for rxpk.%.*s\n", key_len, key );
+            return -1;
+        }
+    } while( js_expect( c, ',' ) );
+    if( js_expect( c, '}' ) == false )
+    {
+        return -1;
+    }
+
+    /* Same mandatory fields as the CSV columns */
+    if( (found & 0x30FF) != 0x30FF )
+    {
+        printf( "ERROR: missing field in rxpk\n" );
+        return -1;
+    }
+    if( data_len != pkt->size )
+    {
+        printf( "ERROR: mismatch between .size and .data size once converter to binary\n" );
+        return -1;
+    }
+    if( (pkt->lora == true) && ((found & 0xF00) != 0xF00) )
+    {
+        printf( "ERROR: missing LoRa field in rxpk\n" );
+        return -1;
+    }
+    if( (pkt->lora == false) && ((found & 0x200) == 0) )
+    {
+        printf( "ERROR: missing FSK field in rxpk\n" );
+        return -1;
+    }
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int log_format_csv( const log_rxpk_t * pkt, char * line, int size )
+{
+    static const char hex[] = "0123456789abcdef";
+    int n, j;
+
+    n = snprintf( line, size, "%u,%u,%u,%f,%u,%d,%s", pkt->tmst, pkt->chan, pkt->rfch, pkt->freq, pkt->mid, pkt->stat, pkt->lora ? "LORA" : "FSK" );
+    if( pkt->lora == true )
+    {
+        n += snprintf( line + n, size - n, ",%u,%u,%s,%.1f,%.1f,%.1f", pkt->datr, pkt->bw_khz, pkt->codr, pkt->rssic, pkt->rssis, pkt->lsnr );
+    }
+    else
+    {
+        n += snprintf( line + n, size - n, ",%u,,,%.1f,,", pkt->datr, pkt->rssic ); /* bw,codr,rssis,lsnr fields are left empty */
+    }
+    n += snprintf( line + n, size - n, ",%u,", pkt->size );
+    for( j = 0; (j < pkt->size) && (n < (size - 3)); j++ )
+    {
+        line[n++] = hex[pkt->payload[j] >> 4];
+        line[n++] = hex[pkt->payload[j] & 0x0F];
+    }
+    line[n++] = '\n';
+    return n;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint8_t * put_le( uint8_t * dst, uint64_t val, int n )
+{
+    int i;
+
+    for( i = 0; i < n; i++ )
+    {
+        *dst++ = (uint8_t)(val >> (8 * i));
+    }
+    return dst;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int log_format_bin( uint64_t gw_mac, const log_rxpk_t * pkt, uint8_t * rec )
+{
+    uint8_t * p = rec + 2;
+    uint8_t codr = 0;
+
+    if( (pkt->lora == true) && (strlen( pkt->codr ) == 3) && (pkt->codr[0] == '4') && (pkt->codr[1] == '/') )
+    {
+        codr = (uint8_t)(pkt->codr[2] - '0');
+    }
+    p = put_le( p, gw_mac, 8 );
+    p = put_le( p, pkt->tmst, 4 );
+    p = put_le( p, (uint32_t)((pkt->freq * 1E6) + 0.5), 4 );
+    *p++ = pkt->chan;
+    *p++ = pkt->rfch;
+    *p++ = pkt->mid;
+    *p++ = (uint8_t)pkt->stat;
+    *p++ = pkt->lora ? 0 : 1;
+    p = put_le( p, pkt->datr, 4 );
+    p = put_le( p, pkt->bw_khz, 2 );
+    *p++ = codr;
+    p = put_le( p, (uint16_t)(int16_t)lround( pkt->rssic * 10 ), 2 );
+    p = put_le( p, (uint16_t)(int16_t)lround( pkt->rssis * 10 ), 2 );
+    p = put_le( p, (uint16_t)(int16_t)lround( pkt->lsnr * 10 ), 2 );
+    *p++ = pkt->size;
+    memcpy( p, pkt->payload, pkt->size );
+    p += pkt->size;
+    put_le( rec, (uint16_t)(p - rec - 2), 2 );
+    return (int)(p - rec);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int log_open( void )
+{
+    log_file = fopen( log_fname, "w+" ); /* create log file, overwrite if file already exist */
+    if( log_file == NULL )
+    {
+        printf( "ERROR: impossible to create log file %s\n", log_fname );
+        return -1;
+    }
+    setvbuf( log_file, NULL, _IOFBF, LOG_BUFFER_SIZE );
+    log_open_time = log_flush_time = time( NULL );
+    log_size = 0;
+    if( log_format == LOG_BIN )
+    {
+        fwrite( LOG_BIN_MAGIC, 1, strlen( LOG_BIN_MAGIC ), log_file );
+        fputc( LOG_BIN_VERSION, log_file );
+        log_size = strlen( LOG_BIN_MAGIC ) + 1;
+    }
+    else
+    {
+        log_header_pending = true; /* written with the first row, as before rotation existed */
+    }
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void log_close( void )
+{
+    if( log_file != NULL )
+    {
+        fclose( log_file );
+        log_file = NULL;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void log_rotate( void )
+{
+    char name[256];
+    char date[32];
+    int n, i;
+
+    /* Keep the full file under the date it was opened, the log goes on under the configured name */
+    log_close( );
+    strftime( date, sizeof date, "%Y%m%dT%H%M%SZ", gmtime( &log_open_time ) );
+    n = snprintf( name, sizeof name, "%s.%s", log_fname, date );
+    for( i = 1; (access( name, F_OK ) == 0) && (i < 100); i++ )
+    {
+        snprintf( name + n, sizeof name - n, ".%d", i );
+    }
+    if( rename( log_fname, name ) != 0 )
+    {
+        printf( "ERROR: failed to rename %s to %s - %s\n", log_fname, name, strerror( errno ) );
+    }
+    if( log_open( ) != 0 )
+    {
+        log_fname = NULL; /* stop logging */
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void log_tick( void )
+{
+    time_t now;
+
+    if( log_file == NULL )
+    {
+        return;
+    }
+    now = time( NULL );
+    if( (log_rotate_period > 0) && (difftime( now, log_open_time ) >= log_rotate_period) )
+    {
+        log_rotate( );
+    }
+    else if( difftime( now, log_flush_time ) >= LOG_FLUSH_PERIOD_S )
+    {
+        fflush( log_file );
+        log_flush_time = now;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/**
+@brief Log all the rxpk of a PUSH_DATA payload, streaming through the JSON text once
+@param gw_mac gateway that sent the datagram, in the binary format only
+@param buf JSON payload, null terminated
+@param size JSON payload size
+@return number of packets logged, -1 if the payload is malformed
+*/
+static int log_push_data( uint64_t gw_mac, const uint8_t * buf, int size )
+{
+    json_cursor_t c = { (const char *)buf, (const char *)buf + size };
+    log_rxpk_t pkt;
+    const char * key;
+    int key_len;
+    uint8_t line[LOG_LINE_SIZE];
+    int n;
+    int nb_pkt = 0;
+
+    if( log_file == NULL )
+    {
+        return -1;
+    }
+
+    if( (size <= 0) || (js_expect( &c, '{' ) == false) )
+    {
+        printf( "ERROR: not a valid JSON string\n" );
+        return -1;
+    }
+    do
+    {
+        if( (js_string( &c, &key, &key_len ) == false) || (js_expect( &c, ':' ) == false) )
+        {
+            printf( "ERROR: not a valid JSON string\n" );
+            return -1;
+        }
+        if( js_is( key, key_len, "rxpk" ) == false )
+        {
+            if( js_skip_value( &c ) == false )
+            {
+                printf( "ERROR: not a valid JSON string\n" );
+                return -1;
+            }
+            continue;
+        }
+        if( js_expect( &c, '[' ) == false )
+        {
+            printf( "ERROR: wrong type for rxpk\n" );
+            return -1;
+        }
+        if( js_expect( &c, ']' ) == true )
+        {
+            continue;
+        }
+        do
+        {
+            if( log_parse_rxpk( &c, &pkt ) != 0 )
+            {
+                return -1;
+            }
+            if( log_format == LOG_BIN )
+            {
+                n = log_format_bin( gw_mac, &pkt, line );
+            }
+            else
+            {
+                if( log_header_pending == true )
+                {
+                    log_size += fprintf( log_file, "tmst,chan,rfch,freq,mid,stat,modu,datr,bw,codr,rssic,rssis,lsnr,size,data\n" );
+                    log_header_pending = false;
+                }
+                n = log_format_csv( &pkt, (char *)line, sizeof line );
+            }
+            fwrite( line, 1, n, log_file );
+            log_size += n;
+            nb_pkt += 1;
+        } while( js_expect( &c, ',' ) );
+        if( js_expect( &c, ']' ) == false )
+        {
+            printf( "ERROR: not a valid JSON string\n" );
+            return -1;
+        }
+    } while( js_expect( &c, ',' ) );
+
+    if( (log_rotate_size > 0) && (log_size >= log_rotate_size) )
+    {
+        log_rotate( );
+    }
+    return nb_pkt;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void usage( void )
 {
     printf( "~~~ Available options ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n" );
     printf( " -h  print this help\n" );
@@ -1130,12 +1733,22 @@ static void usage( void )
     printf( " -P <udp port>      UDP port of the Packet Forwarder\n" );
     printf( " -A <ip address>    IP address to be used for uplink forwarding (optional)\n" );
     printf( " -F <udp port>      UDP port to be used for uplink forwarding (optional)\n" );
-    printf( " -l <filename>      uplink logging CSV filename (optional)\n" );
+    printf( " -l <filename>      uplink logging filename (optional)\n" );
+    printf( " -o <string>        uplink logging format [\"csv\", \"bin\"] (optional, default csv)\n" );
+    printf( " -S <uint>          uplink log rotation when the file exceeds this size in MB (optional)\n" );
+    printf( " -T <uint>          uplink log rotation period in seconds (optional)\n" );
+    printf( " -y <uint>          artificial latency of PUSH_ACK/PULL_ACK in ms (optional, default 30)\n" );
     printf( " -B                 Bypass downlink, for uplink logging only (optional)\n" );
+    printf( " -R <float>         Load generator: target rate in downlinks per second, -x is the total (0: until Ctrl+C)\n" );
+    printf( " -a <string>        Load generator: arrival law [\"periodic\", \"poisson\", \"burst:<uint>\"]\n" );
+    printf( " -w <uint,uint,uint> Load generator: share in %% of immediate, RX1 and RX2 downlinks\n" );
+    printf( " -D <uint>          Load generator: RX1 delay in seconds [1..15], RX2 is 1 second later\n" );
     printf( "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n" );
     printf( "~~~ Examples ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n" );
     printf( " Log uplinks into a CSV file, no downlink:\n" );
     printf( "   ./net_downlink -P 1730 -l log.csv\n" );
+    printf( " Log uplinks of several gateways into binary files rotated every hour, no downlink:\n" );
+    printf( "   ./net_downlink -P 1730 -l log.bin -o bin -T 3600 -y 0\n" );
     printf( " Send downlinks on RF chain 0 only:\n" );
     printf( "   ./net_downlink -f 865.1 -s 7 -b 125 -r 8 -t 500 -x 10 -P 1730\n" );
     printf( " Send downlinks on RF chain 1 only:\n" );
@@ -1146,6 +1759,8 @@ static void usage( void )
     printf( "   ./net_downlink -f 865.1,865.9 -s 11,12 -x 1,1 -r 65535,65535 -P 1730\n" );
     printf( " Log uplinks into CSV file while continuous TX is running (full_duplex testing):\n" );
     printf( "   ./net_downlink -f 864.5 -s 12 -x 1 -r 65535 -P 1730 -l log.csv\n" );
+    printf( " Load the gateway with 50 downlinks/s, Poisson arrivals, half class C, half class A RX1:\n" );
+    printf( "   ./net_downlink -f 869.525 -j 8:0.2 -s 7 -R 50 -a poisson -w 50,50,0 -P 1730\n" );
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -1429,4 +2044,353 @@ static void * thread_down_rf1( const void * arg )
     return NULL;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint64_t time_us( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return ((uint64_t)t.tv_sec * 1000000) + (t.tv_nsec / 1000);
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void update_counter_ref( const uint8_t * buf )
+{
+    JSON_Value * root_val = NULL;
+    JSON_Array * rxpk_array = NULL;
+    JSON_Value * val = NULL;
+    int rxpk_nb;
+
+    /* Take the concentrator counter of the last uplink of the datagram, 'stat' only datagrams carry none */
+    root_val = json_parse_string( (const char *)buf );
+    rxpk_array = json_object_get_array( json_value_get_object( root_val ), "rxpk" );
+    rxpk_nb = (int)json_array_get_count( rxpk_array );
+    if( rxpk_nb > 0 )
+    {
+        val = json_object_get_value( json_array_get_object( rxpk_array, rxpk_nb - 1 ), "tmst" );
+        if( json_value_get_type( val ) == JSONNumber )
+        {
+            pthread_mutex_lock( &mx_load );
+            counter_ref_tmst = (uint32_t)json_value_get_number( val );
+            counter_ref_us = time_us( );
+            counter_ref_valid = true;
+            pthread_mutex_unlock( &mx_load );
+        }
+    }
+    json_value_free( root_val );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void load_ack( uint8_t token_h, uint8_t token_l, const uint8_t * buf, int size )
+{
+    JSON_Value * root_val = NULL;
+    JSON_Object * ack_obj = NULL;
+    const char * str = NULL;
+    ack_status_t status = ACK_NONE;
+    uint16_t token = ((uint16_t)token_h << 8) | token_l;
+    uint64_t now = time_us( );
+    uint32_t latency;
+    int i;
+
+    /* No payload means no error, otherwise {"txpk_ack":{"error":"<status>",...}} or "warn" */
+    if( size > 0 )
+    {
+        root_val = json_parse_string( (const char *)buf );
+        ack_obj = json_object_get_object( json_value_get_object( root_val ), "txpk_ack" );
+        str = json_object_get_string( ack_obj, "error" );
+        if( str == NULL )
+        {
+            str = json_object_get_string( ack_obj, "warn" );
+        }
+        status = ACK_UNKNOWN;
+        for( i = 0; (str != NULL) && (i < ACK_NB); i++ )
+        {
+            if( strcmp( str, ack_status_name[i] ) == 0 )
+            {
+                status = (ack_status_t)i;
+                break;
+            }
+        }
+        json_value_free( root_val );
+    }
+
+    pthread_mutex_lock( &mx_load );
+    if( load_sent_us[token] == 0 )
+    {
+        load_stats.nb_ack_unexpected += 1;
+    }
+    else
+    {
+        latency = (uint32_t)(now - load_sent_us[token]);
+        load_sent_us[token] = 0;
+        load_stats.nb_ack[status] += 1;
+        load_stats.latency_sum_us += latency;
+        if( latency < load_stats.latency_min_us )
+        {
+            load_stats.latency_min_us = latency;
+        }
+        if( latency > load_stats.latency_max_us )
+        {
+            load_stats.latency_max_us = latency;
+        }
+    }
+    pthread_mutex_unlock( &mx_load );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void load_report( uint64_t start_us )
+{
+    load_stats_t stats;
+    uint32_t nb_sent = 0;
+    uint32_t nb_ack = 0;
+    double elapsed_s;
+    double sending_s;
+    int i;
+
+    pthread_mutex_lock( &mx_load );
+    stats = load_stats;
+    pthread_mutex_unlock( &mx_load );
+
+    for( i = 0; i < WINDOW_NB; i++ )
+    {
+        nb_sent += stats.nb_sent[i];
+    }
+    for( i = 0; i < ACK_NB; i++ )
+    {
+        nb_ack += stats.nb_ack[i];
+    }
+    elapsed_s = (double)(time_us( ) - start_us) / 1E6;
+    sending_s = (double)(stats.last_sent_us - start_us) / 1E6;
+
+    printf( "\n##### LOAD GENERATOR %.1f s #####\n", elapsed_s );
+    printf( "# downlinks sent: %u (%.1f /s)\n", nb_sent, (sending_s > 0.0) ? (nb_sent / sending_s) : 0.0 );
+    for( i = 0; i < WINDOW_NB; i++ )
+    {
+        printf( "#   %-16s %u\n", window_name[i], stats.nb_sent[i] );
+    }
+    printf( "# TX_ACK received: %u (%.1f%%), unexpected: %u\n", nb_ack, (nb_sent > 0) ? (100.0 * nb_ack / nb_sent) : 0.0, stats.nb_ack_unexpected );
+    for( i = 0; i < ACK_NB; i++ )
+    {
+        if( stats.nb_ack[i] > 0 )
+        {
+            printf( "#   %-16s %u\n", ack_status_name[i], stats.nb_ack[i] );
+        }
+    }
+    if( nb_ack > 0 )
+    {
+        printf( "# TX_ACK latency: min %.3f ms, avg %.3f ms, max %.3f ms\n", stats.latency_min_us / 1E3, (double)stats.latency_sum_us / nb_ack / 1E3, stats.latency_max_us / 1E3 );
+    }
+    printf( "# generator lag: max %.3f ms\n", stats.lag_max_us / 1E3 );
+    printf( "##### END #####\n" );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void * thread_load( const void * arg )
+{
+    int i, x;
+    int byte_nb;
+    const thread_params_t *params = ( (thread_params_t*)arg );
+    const uint8_t pl_size = params->pl_size[0];
+
+    /* JSON variables */
+    JSON_Value *root_val = NULL;
+    JSON_Object *obj = NULL;
+    char *serialized_string = NULL;
+
+    /* Pre-serialized txpk, one per channel, closed at send time with the per-packet fields */
+    static char templates[100][LOAD_TEMPLATE_SIZE];
+    size_t templates_len[100];
+
+    /* Downstream data variables */
+    uint8_t databuf_down[4096];
+    uint8_t payload[255];
+    char payload_b64[341];
+    uint32_t nb_loop = params->nb_loop[0];
+    uint32_t pkt_sent = 0;
+    uint16_t token = 0;
+    uint16_t burst_cnt = 0;
+    window_t window;
+    uint32_t tmst = 0;
+
+    /* Scheduling variables */
+    bool ts_needed = (params->load_window[WINDOW_RX1] + params->load_window[WINDOW_RX2]) > 0;
+    double interval_us = 1E6 / params->load_rate;
+    uint64_t start_us, now_us, next_us, report_us;
+    struct timespec next_ts;
+
+    /* Build the templates, removing the fields set for each packet from the regular txpk */
+    for( i = 0; i < params->freq_nb; i++ )
+    {
+        root_val = json_value_init_object( );
+        prepare_downlink_json( params, 0, i, root_val );
+        obj = json_object_get_object( json_value_get_object( root_val ), "txpk" );
+        json_object_remove( obj, "imme" );
+        json_object_remove( obj, "data" );
+        serialized_string = json_serialize_to_string( root_val );
+        templates_len[i] = (serialized_string != NULL) ? strlen( serialized_string ) : 0;
+        if( (templates_len[i] < 2) || (templates_len[i] >= LOAD_TEMPLATE_SIZE) )
+        {
+            printf( "ERROR: failed to prepare the downlink template for channel %d\n", i );
+            json_free_serialized_string( serialized_string );
+            json_value_free( root_val );
+            return NULL;
+        }
+        templates_len[i] -= 2; /* strip the closing "}}" */
+        memcpy( templates[i], serialized_string, templates_len[i] );
+        json_free_serialized_string( serialized_string );
+        json_value_free( root_val );
+    }
+    memset( payload, 0, sizeof payload );
+
+    /* Wait for the packet forwarder, and for an uplink to get its counter if downlinks are timestamped */
+    while( !exit_sig && !quit_sig )
+    {
+        pthread_mutex_lock( &mx_sockaddr );
+        x = (sockaddr_valid == true);
+        pthread_mutex_unlock( &mx_sockaddr );
+        pthread_mutex_lock( &mx_load );
+        x = x && ((ts_needed == false) || (counter_ref_valid == true));
+        pthread_mutex_unlock( &mx_load );
+        if( x )
+        {
+            break;
+        }
+        printf( "Waiting for socket to be ready%s...\n", ts_needed ? " and for an uplink" : "" );
+        usleep( 500000 ); /* 500 ms */
+    }
+
+    printf( "INFO: load generator started, %.1f downlinks/s, %s arrivals\n", params->load_rate,
+            (params->load_arrival == ARRIVAL_POISSON) ? "poisson" : ((params->load_arrival == ARRIVAL_BURST) ? "burst" : "periodic") );
+    srand( (unsigned)time( NULL ) );
+    start_us = next_us = time_us( );
+    report_us = start_us + (LOAD_REPORT_PERIOD_S * 1000000);
+    memset( &load_stats, 0, sizeof load_stats );
+    load_stats.latency_min_us = UINT32_MAX;
+
+    while( !exit_sig && !quit_sig && ((nb_loop == 0) || (pkt_sent < nb_loop)) )
+    {
+        /* Wait for the scheduled time, absolute so that the rate does not drift */
+        next_ts.tv_sec = next_us / 1000000;
+        next_ts.tv_nsec = (next_us % 1000000) * 1000;
+        clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &next_ts, NULL );
+        now_us = time_us( );
+
+        /* Pick the window, timestamped ones target a virtual uplink received now */
+        x = rand( ) % 100;
+        if( x < params->load_window[WINDOW_IMME] )
+        {
+            window = WINDOW_IMME;
+        }
+        else if( x < (params->load_window[WINDOW_IMME] + params->load_window[WINDOW_RX1]) )
+        {
+            window = WINDOW_RX1;
+        }
+        else
+        {
+            window = WINDOW_RX2;
+        }
+        if( window != WINDOW_IMME )
+        {
+            pthread_mutex_lock( &mx_load );
+            tmst = counter_ref_tmst + (uint32_t)(now_us - counter_ref_us) + params->rx1_delay_us;
+            pthread_mutex_unlock( &mx_load );
+            if( window == WINDOW_RX2 )
+            {
+                tmst += RX2_DELAY_US;
+            }
+        }
+
+        /* Fill last bytes of payload with downlink counter (32 bits) */
+        for( i = 0; (i < pl_size) && (i < 4); i++ )
+        {
+            payload[pl_size - (i + 1)] = (uint8_t)((pkt_sent >> (i * 8)) & 0xFF);
+        }
+        if( bin_to_b64( payload, pl_size, payload_b64, sizeof payload_b64 ) < 0 )
+        {
+            printf( "ERROR: failed to convert payload to base64 string\n" );
+            break;
+        }
+
+        /* Complete the template */
+        databuf_down[0] = PROTOCOL_VERSION;
+        databuf_down[1] = (uint8_t)(token >> 8);
+        databuf_down[2] = (uint8_t)(token & 0xFF);
+        databuf_down[3] = PKT_PULL_RESP;
+        i = pkt_sent % params->freq_nb;
+        memcpy( &databuf_down[4], templates[i], templates_len[i] );
+        byte_nb = 4 + templates_len[i];
+        if( window == WINDOW_IMME )
+        {
+            byte_nb += snprintf( (char *)&databuf_down[byte_nb], sizeof databuf_down - byte_nb, ",\"imme\":true,\"data\":\"%s\"}}", payload_b64 );
+        }
+        else
+        {
+            byte_nb += snprintf( (char *)&databuf_down[byte_nb], sizeof databuf_down - byte_nb, ",\"tmst\":%u,\"data\":\"%s\"}}", tmst, payload_b64 );
+        }
+
+        /* Send it, the TX_ACK is accounted by the main thread */
+        pthread_mutex_lock( &mx_load );
+        load_sent_us[token] = now_us;
+        load_stats.nb_sent[window] += 1;
+        load_stats.last_sent_us = now_us;
+        if( (uint32_t)(now_us - next_us) > load_stats.lag_max_us )
+        {
+            load_stats.lag_max_us = (uint32_t)(now_us - next_us);
+        }
+        pthread_mutex_unlock( &mx_load );
+        x = sendto( params->sock, (void *)databuf_down, byte_nb, 0, (struct sockaddr *)&dist_addr_down, addr_len_down );
+        if( x == -1 )
+        {
+            printf( "ERROR: failed to send downlink to socket - %s\n", strerror( errno ) );
+            pthread_mutex_lock( &mx_load );
+            load_sent_us[token] = 0;
+            load_stats.nb_sent[window] -= 1;
+            pthread_mutex_unlock( &mx_load );
+        }
+        else
+        {
+            pkt_sent += 1;
+        }
+        token += 1;
+
+        /* Schedule the next one, late sends are caught up to keep the mean rate */
+        switch( params->load_arrival )
+        {
+            case ARRIVAL_POISSON:
+                next_us += (uint64_t)(-log( 1.0 - ((double)rand( ) / ((double)RAND_MAX + 1.0)) ) * interval_us);
+                break;
+            case ARRIVAL_BURST:
+                burst_cnt += 1;
+                if( burst_cnt >= params->load_burst )
+                {
+                    burst_cnt = 0;
+                    next_us += (uint64_t)(params->load_burst * interval_us);
+                }
+                break;
+            default:
+                next_us += (uint64_t)interval_us;
+                break;
+        }
+
+        if( now_us >= report_us )
+        {
+            load_report( start_us );
+            report_us += LOAD_REPORT_PERIOD_S * 1000000;
+        }
+    }
+
+    /* Give the last TX_ACKs some time before the final report */
+    usleep( LOAD_DRAIN_MS * 1000 );
+    load_report( start_us );
+
+    /* Exit */
+    printf( "\nINFO: End of load generator thread\n" );
+    return NULL;
+}
+
 /* --- EOF ------------------------------------------------------------------ */